@@ -0,0 +1,250 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cbor.h>
+#include <st_dev.h>
+#include <iot_main.h>
+#include <iot_internal.h>
+#include <iot_mem.h>
+#include <iot_trace.h>
+#include "BENCHs.h"
+
+#define BENCH_CAP_EVT_MAX   255
+
+struct bench_cap_evt {
+    int attr_num;
+    IOT_EVENT *events[BENCH_CAP_EVT_MAX];
+};
+
+struct bench_cap_cmd {
+    int cmd_num;
+    char *payload;
+};
+
+static struct iot_context *bench_cap_ctx;
+static IOT_CAP_HANDLE *bench_cap_handle;
+static unsigned int bench_cap_cmd_count;
+
+static void bench_cap_cmd_cb(IOT_CAP_HANDLE *handle, iot_cap_cmd_data_t *cmd_data, void *usr_data)
+{
+    (void)handle;
+    (void)usr_data;
+
+    if (cmd_data->num_args == 1 && cmd_data->cmd_data[0].integer == 50)
+        bench_cap_cmd_count++;
+}
+
+/*
+ * Core has no way to release a context or handles, so one connected-looking
+ * context is made for the whole run. pub_queue is drained by the bench itself.
+ */
+static int bench_cap_prepare(void)
+{
+    if (bench_cap_handle)
+        return 0;
+
+    bench_cap_ctx = calloc(1, sizeof(struct iot_context));
+    if (!bench_cap_ctx)
+        return -1;
+
+    bench_cap_ctx->curr_state = IOT_STATE_CLOUD_CONNECTED;
+    bench_cap_ctx->pub_queue = iot_os_queue_create(IOT_PUB_QUEUE_LENGTH, sizeof(iot_cap_msg_t *));
+    bench_cap_ctx->iot_events = iot_os_eventgroup_create();
+    if (!bench_cap_ctx->pub_queue || !bench_cap_ctx->iot_events)
+        return -1;
+
+    bench_cap_handle = st_cap_handle_init((IOT_CTX *)bench_cap_ctx, "main", "switchLevel", NULL, NULL);
+    if (!bench_cap_handle)
+        return -1;
+
+    return st_cap_cmd_set_cb(bench_cap_handle, "setLevel", bench_cap_cmd_cb, NULL);
+}
+
+int bench_make_cmd_payload(int cmd_num, bool cbor, char **payload, size_t *payload_len)
+{
+    static const char cmd_json[] =
+            "{\"component\":\"main\",\"capability\":\"switchLevel\","
+            "\"command\":\"setLevel\",\"arguments\":[50]}";
+    size_t buf_size = (sizeof(cmd_json) + 1) * cmd_num + 32;
+    CborEncoder root, map, cmds, cmd, args;
+    char *buf;
+    size_t len;
+    int i;
+
+    buf = calloc(1, buf_size);
+    if (!buf)
+        return -1;
+
+    if (!cbor) {
+        len = snprintf(buf, buf_size, "{\"commands\":[");
+        for (i = 0; i < cmd_num; i++)
+            len += snprintf(buf + len, buf_size - len, "%s%s", i ? "," : "", cmd_json);
+        len += snprintf(buf + len, buf_size - len, "]}");
+        goto done;
+    }
+
+    /* same command in CBOR is smaller than JSON, buf_size is enough */
+    cbor_encoder_init(&root, (uint8_t *)buf, buf_size - 1, 0);
+    cbor_encoder_create_map(&root, &map, 1);
+    cbor_encode_text_stringz(&map, "commands");
+    cbor_encoder_create_array(&map, &cmds, cmd_num);
+    for (i = 0; i < cmd_num; i++) {
+        cbor_encoder_create_map(&cmds, &cmd, 4);
+        cbor_encode_text_stringz(&cmd, "component");
+        cbor_encode_text_stringz(&cmd, "main");
+        cbor_encode_text_stringz(&cmd, "capability");
+        cbor_encode_text_stringz(&cmd, "switchLevel");
+        cbor_encode_text_stringz(&cmd, "command");
+        cbor_encode_text_stringz(&cmd, "setLevel");
+        cbor_encode_text_stringz(&cmd, "arguments");
+        cbor_encoder_create_array(&cmd, &args, 1);
+        cbor_encode_int(&args, 50);
+        cbor_encoder_close_container(&cmd, &args);
+        cbor_encoder_close_container(&cmds, &cmd);
+    }
+    cbor_encoder_close_container(&map, &cmds);
+    if (cbor_encoder_close_container(&root, &map) != CborNoError) {
+        free(buf);
+        return -1;
+    }
+    len = cbor_encoder_get_buffer_size(&root, (uint8_t *)buf);
+
+done:
+    *payload = buf;
+    *payload_len = len;
+    return 0;
+}
+
+int BENCH_iot_cap_evt_setup(void **state, int attr_num)
+{
+    struct bench_cap_evt *evt;
+    int i;
+
+    if (attr_num < 1 || attr_num > BENCH_CAP_EVT_MAX || bench_cap_prepare())
+        return -1;
+
+    evt = calloc(1, sizeof(struct bench_cap_evt));
+    if (!evt)
+        return -1;
+
+    /* mix of value types like a multi-attribute device would send */
+    for (i = 0; i < attr_num; i++) {
+        switch (i % 3) {
+        case 0:
+            evt->events[i] = st_cap_attr_create_int("level", i, "%");
+            break;
+        case 1:
+            evt->events[i] = st_cap_attr_create_number("temperature", 23.5 + i, "C");
+            break;
+        default:
+            evt->events[i] = st_cap_attr_create_string("switch", "on", NULL);
+            break;
+        }
+        if (!evt->events[i]) {
+            BENCH_iot_cap_evt_teardown(evt);
+            return -1;
+        }
+        evt->attr_num = i + 1;
+    }
+
+    *state = evt;
+    return 0;
+}
+
+int BENCH_iot_cap_evt_send(void *state)
+{
+    struct bench_cap_evt *evt = (struct bench_cap_evt *)state;
+    iot_cap_msg_t *msg;
+
+    if (st_cap_attr_send(bench_cap_handle, (uint8_t)evt->attr_num, evt->events) < 0)
+        return -1;
+
+    /* take it back as the main task would, otherwise pub_queue is full soon */
+    if (iot_os_queue_receive(bench_cap_ctx->pub_queue, (void **)&msg, 0) == IOT_OS_FALSE)
+        return -1;
+    __atomic_sub_fetch(&bench_cap_ctx->pub_queue_depth, 1, __ATOMIC_RELAXED);
+    IOT_TRACE_END(msg->trace_seq, IOT_TRACE_STAGE_MAX);
+    iot_mem_free(IOT_MEM_TAG_CAP, msg->msg);
+    iot_mem_free(IOT_MEM_TAG_CAP, msg);
+
+    return 0;
+}
+
+void BENCH_iot_cap_evt_teardown(void *state)
+{
+    struct bench_cap_evt *evt = (struct bench_cap_evt *)state;
+    int i;
+
+    if (!evt)
+        return;
+
+    for (i = 0; i < evt->attr_num; i++)
+        st_cap_attr_free(evt->events[i]);
+    free(evt);
+}
+
+int BENCH_iot_cap_cmd_setup(void **state, int cmd_num)
+{
+    struct bench_cap_cmd *cmd;
+    size_t payload_len;
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+    bool cbor = true;
+#else
+    bool cbor = false;
+#endif
+
+    if (cmd_num < 1 || bench_cap_prepare())
+        return -1;
+
+    cmd = calloc(1, sizeof(struct bench_cap_cmd));
+    if (!cmd)
+        return -1;
+
+    if (bench_make_cmd_payload(cmd_num, cbor, &cmd->payload, &payload_len)) {
+        free(cmd);
+        return -1;
+    }
+    cmd->cmd_num = cmd_num;
+
+    *state = cmd;
+    return 0;
+}
+
+int BENCH_iot_cap_cmd_dispatch(void *state)
+{
+    struct bench_cap_cmd *cmd = (struct bench_cap_cmd *)state;
+    unsigned int expected = bench_cap_cmd_count + cmd->cmd_num;
+
+    iot_cap_sub_cb(bench_cap_ctx->cap_handle_list, cmd->payload, 0);
+
+    /* every command should reach the callback with its argument */
+    return (bench_cap_cmd_count == expected) ? 0 : -1;
+}
+
+void BENCH_iot_cap_cmd_teardown(void *state)
+{
+    struct bench_cap_cmd *cmd = (struct bench_cap_cmd *)state;
+
+    if (!cmd)
+        return;
+
+    free(cmd->payload);
+    free(cmd);
+}
@@ -0,0 +1,266 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <iot_mem.h>
+#include <iot_os_util.h>
+#include "es_tcp_httpd.h"
+#include "BENCHs.h"
+
+#define BENCH_HTTPD_PORT        8888
+#define BENCH_HTTPD_RX_MAX      2048
+#define BENCH_HTTPD_MAX_BODY    4096
+#define BENCH_HTTPD_REQ_MAX     (BENCH_HTTPD_MAX_BODY + 256)
+#define BENCH_HTTPD_CONNECT_RETRY   100
+
+/* one onboarding as the mobile app drives it, POST bodies are param sized */
+static const struct {
+    enum cgi_type type;
+    const char *uri;
+} bench_httpd_steps[] = {
+    { GET, "/deviceinfo" },
+    { POST, "/keyinfo" },
+    { POST, "/confirminfo" },
+    { GET, "/wifiscaninfo" },
+    { POST, "/wifiprovisioninginfo" },
+    { POST, "/setupcomplete" },
+};
+#define BENCH_HTTPD_STEP_NUM    (int)(sizeof(bench_httpd_steps) / sizeof(bench_httpd_steps[0]))
+
+static const char bench_httpd_reply[] =
+        "{\"message\":\"UCYKgPmRDcY8Bx8fMLpkqhp8cQlIpUJjVGqAGAJ4ZjGh+9TPtZOvdSg1X8G7dxxG\"}";
+
+struct bench_httpd {
+    int sock;
+    bool keep_alive;
+    char *req[BENCH_HTTPD_STEP_NUM];
+    size_t req_len[BENCH_HTTPD_STEP_NUM];
+    char rx[BENCH_HTTPD_RX_MAX];
+};
+
+/* the easysetup handlers need a running iot context, answer like them instead */
+void http_packet_handle(const char *name, char **buf, char *payload, enum cgi_type type)
+{
+    size_t buffer_len;
+    (void)name;
+    (void)payload;
+    (void)type;
+
+    buffer_len = strlen(bench_httpd_reply) + 128;
+    *buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, buffer_len);
+    if (!*buf)
+        return;
+
+    snprintf(*buf, buffer_len, "%s%s%4d\r\n\r\n%s", "HTTP/1.1 200 OK",
+            "\r\nServer: SmartThings Device SDK\r\nContent-Type: application/json\r\nContent-Length: ",
+            (int)strlen(bench_httpd_reply), bench_httpd_reply);
+}
+
+static int bench_httpd_connect(void)
+{
+    struct sockaddr_in addr;
+    int sock, i;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(BENCH_HTTPD_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    /* the server task may not listen yet right after es_tcp_init() */
+    for (i = 0; i < BENCH_HTTPD_CONNECT_RETRY; i++) {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock < 0)
+            return -1;
+        if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            return sock;
+        close(sock);
+        iot_os_delay(20);
+    }
+
+    return -1;
+}
+
+static int bench_httpd_send(int sock, const char *buf, size_t len)
+{
+    ssize_t ret;
+
+    while (len > 0) {
+        ret = send(sock, buf, len, MSG_NOSIGNAL);
+        if (ret <= 0)
+            return -1;
+        buf += ret;
+        len -= ret;
+    }
+
+    return 0;
+}
+
+/* reads one response, the whole of it has to fit in rx */
+static int bench_httpd_recv(int sock, char *rx)
+{
+    char *body, *content_len;
+    size_t len = 0, total;
+    ssize_t ret;
+
+    while (1) {
+        ret = recv(sock, rx + len, BENCH_HTTPD_RX_MAX - 1 - len, 0);
+        if (ret <= 0)
+            return -1;
+        len += ret;
+        rx[len] = '\0';
+
+        body = strstr(rx, "\r\n\r\n");
+        if (!body)
+            continue;
+
+        content_len = strstr(rx, "Content-Length:");
+        if (!content_len || content_len > body)
+            return -1;
+
+        total = (body - rx) + 4 + strtoul(content_len + strlen("Content-Length:"), NULL, 10);
+        if (total >= BENCH_HTTPD_RX_MAX)
+            return -1;
+        if (len >= total)
+            break;
+    }
+
+    return strncmp(rx, "HTTP/1.1 200", strlen("HTTP/1.1 200")) ? -1 : 0;
+}
+
+static int bench_iot_easysetup_httpd_setup(void **state, int body_len, bool keep_alive)
+{
+    struct bench_httpd *httpd;
+    char *body;
+    int i, len;
+
+    if (body_len < 0 || body_len > BENCH_HTTPD_MAX_BODY)
+        return -1;
+
+    httpd = calloc(1, sizeof(struct bench_httpd));
+    if (!httpd)
+        return -1;
+    httpd->sock = -1;
+    httpd->keep_alive = keep_alive;
+
+    body = malloc(body_len + 1);
+    if (!body) {
+        free(httpd);
+        return -1;
+    }
+    memset(body, 'b', body_len);
+    body[body_len] = '\0';
+
+    for (i = 0; i < BENCH_HTTPD_STEP_NUM; i++) {
+        httpd->req[i] = malloc(BENCH_HTTPD_REQ_MAX);
+        if (!httpd->req[i])
+            goto error;
+
+        if (bench_httpd_steps[i].type == GET) {
+            len = snprintf(httpd->req[i], BENCH_HTTPD_REQ_MAX,
+                    "GET %s HTTP/1.1\r\nHost: 192.168.4.10:8888\r\n%s\r\n",
+                    bench_httpd_steps[i].uri, keep_alive ? "" : "Connection: close\r\n");
+        } else {
+            len = snprintf(httpd->req[i], BENCH_HTTPD_REQ_MAX,
+                    "POST %s HTTP/1.1\r\nHost: 192.168.4.10:8888\r\n%s"
+                    "Content-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
+                    bench_httpd_steps[i].uri, keep_alive ? "" : "Connection: close\r\n",
+                    body_len, body);
+        }
+        if (len < 0 || len >= BENCH_HTTPD_REQ_MAX)
+            goto error;
+        httpd->req_len[i] = len;
+    }
+    free(body);
+    body = NULL;
+
+    es_tcp_init();
+
+    /* keep-alive case pays for the connection once, like the app does */
+    if (keep_alive) {
+        httpd->sock = bench_httpd_connect();
+        if (httpd->sock < 0)
+            goto error;
+    }
+
+    *state = httpd;
+    return 0;
+
+error:
+    free(body);
+    BENCH_iot_easysetup_httpd_teardown(httpd);
+    return -1;
+}
+
+int BENCH_iot_easysetup_httpd_keepalive_setup(void **state, int body_len)
+{
+    return bench_iot_easysetup_httpd_setup(state, body_len, true);
+}
+
+int BENCH_iot_easysetup_httpd_close_setup(void **state, int body_len)
+{
+    return bench_iot_easysetup_httpd_setup(state, body_len, false);
+}
+
+int BENCH_iot_easysetup_httpd_onboarding(void *state)
+{
+    struct bench_httpd *httpd = (struct bench_httpd *)state;
+    int sock = httpd->sock;
+    int i, ret = 0;
+
+    for (i = 0; i < BENCH_HTTPD_STEP_NUM && !ret; i++) {
+        if (!httpd->keep_alive) {
+            sock = bench_httpd_connect();
+            if (sock < 0)
+                return -1;
+        }
+
+        ret = bench_httpd_send(sock, httpd->req[i], httpd->req_len[i]);
+        if (!ret)
+            ret = bench_httpd_recv(sock, httpd->rx);
+
+        /* let the server close first, TIME_WAIT stays on its side */
+        if (!httpd->keep_alive) {
+            while (recv(sock, httpd->rx, BENCH_HTTPD_RX_MAX, 0) > 0)
+                ;
+            close(sock);
+        }
+    }
+
+    return ret;
+}
+
+void BENCH_iot_easysetup_httpd_teardown(void *state)
+{
+    struct bench_httpd *httpd = (struct bench_httpd *)state;
+    int i;
+
+    if (!httpd)
+        return;
+
+    if (httpd->sock >= 0)
+        close(httpd->sock);
+    for (i = 0; i < BENCH_HTTPD_STEP_NUM; i++)
+        free(httpd->req[i]);
+    es_tcp_deinit();
+    free(httpd);
+}
@@ -0,0 +1,144 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <JSON.h>
+#include <iot_common.h>
+#include <iot_main.h>
+#include <iot_easysetup.h>
+#include <iot_mem.h>
+#include "BENCHs.h"
+
+/*
+ * The posix BSP has no radio to scan with, iot_bsp_wifi_get_scan_result() is
+ * wrapped at link time by this neighborhood. Like real scans, a BSSID may be
+ * reported twice and a mesh network shows up with several BSSIDs.
+ */
+static const iot_wifi_scan_result_t bench_scan_table[] = {
+        { {0x00, 0x24, 0xb2, 0x10, 0x00, 0x01}, "HomeMesh", -72, 2412, IOT_WIFI_AUTH_WPA2_PSK },
+        { {0x00, 0x24, 0xb2, 0x10, 0x00, 0x02}, "HomeMesh", -48, 5180, IOT_WIFI_AUTH_WPA2_PSK },
+        { {0x00, 0x24, 0xb2, 0x10, 0x00, 0x03}, "HomeMesh", -61, 2437, IOT_WIFI_AUTH_WPA2_PSK },
+        { {0x3c, 0x5a, 0xb4, 0x20, 0x11, 0x22}, "Neighbor_5G", -80, 5745, IOT_WIFI_AUTH_WPA_WPA2_PSK },
+        { {0x3c, 0x5a, 0xb4, 0x20, 0x11, 0x22}, "Neighbor_5G", -77, 5745, IOT_WIFI_AUTH_WPA_WPA2_PSK },
+        { {0x6c, 0x72, 0x20, 0x30, 0x40, 0x50}, "CoffeeShop", -85, 2462, IOT_WIFI_AUTH_OPEN },
+        { {0x6c, 0x72, 0x20, 0x30, 0x40, 0x51}, "", -70, 2462, IOT_WIFI_AUTH_WPA2_PSK },
+        { {0xa0, 0x63, 0x91, 0x01, 0x02, 0x03}, "OfficeNet", -66, 5200, IOT_WIFI_AUTH_WPA2_ENTERPRISE },
+};
+
+/* a scan keeps the radio busy for a while on a device */
+static volatile unsigned int bench_scan_delay_ms;
+
+uint16_t __wrap_iot_bsp_wifi_get_scan_result(iot_wifi_scan_result_t *scan_result)
+{
+    uint16_t num = sizeof(bench_scan_table) / sizeof(bench_scan_table[0]);
+
+    if (!scan_result)
+        return 0;
+
+    if (bench_scan_delay_ms)
+        usleep(bench_scan_delay_ms * 1000);
+
+    if (num > IOT_WIFI_MAX_SCAN_RESULT)
+        num = IOT_WIFI_MAX_SCAN_RESULT;
+    memcpy(scan_result, bench_scan_table, num * sizeof(iot_wifi_scan_result_t));
+
+    return num;
+}
+
+/* param is how long a scan takes in ms */
+int BENCH_iot_easysetup_scan_sync_setup(void **state, int scan_delay_ms)
+{
+    if (scan_delay_ms < 0)
+        return -1;
+
+    bench_scan_delay_ms = scan_delay_ms;
+    *state = NULL;
+    return 0;
+}
+
+int BENCH_iot_easysetup_scan_sync(void *state)
+{
+    iot_wifi_scan_result_t list[IOT_WIFI_MAX_SCAN_RESULT];
+    char *json = NULL;
+    uint16_t num;
+    (void)state;
+
+    /* what wifiScanInfo took when the radio was scanned on request */
+    num = iot_bsp_wifi_get_scan_result(list);
+    num = iot_easysetup_scan_merge(list, num);
+    if (iot_easysetup_scan_serialize(list, num, &json) != IOT_ERROR_NONE)
+        return -1;
+
+    JSON_FREE(json);
+    return 0;
+}
+
+void BENCH_iot_easysetup_scan_sync_teardown(void *state)
+{
+    (void)state;
+
+    bench_scan_delay_ms = 0;
+}
+
+int BENCH_iot_easysetup_scan_cached_setup(void **state, int scan_delay_ms)
+{
+    struct iot_context *ctx;
+
+    if (scan_delay_ms < 0)
+        return -1;
+
+    ctx = calloc(1, sizeof(struct iot_context));
+    if (!ctx)
+        return -1;
+
+    bench_scan_delay_ms = scan_delay_ms;
+    if (iot_easysetup_scan_start(ctx) != IOT_ERROR_NONE) {
+        free(ctx);
+        return -1;
+    }
+
+    *state = ctx;
+    return 0;
+}
+
+int BENCH_iot_easysetup_scan_cached(void *state)
+{
+    struct iot_context *ctx = (struct iot_context *)state;
+    char *json = NULL;
+
+    if (iot_easysetup_scan_get(ctx, false, NULL, &json, NULL) != IOT_ERROR_NONE)
+        return -1;
+
+    JSON_FREE(json);
+    return 0;
+}
+
+void BENCH_iot_easysetup_scan_cached_teardown(void *state)
+{
+    struct iot_context *ctx = (struct iot_context *)state;
+
+    if (!ctx)
+        return;
+
+    iot_easysetup_scan_stop(ctx);
+    if (ctx->scan_result)
+        iot_mem_free(IOT_MEM_TAG_CORE, ctx->scan_result);
+    free(ctx);
+    bench_scan_delay_ms = 0;
+}
@@ -0,0 +1,243 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <iot_mqtt_packet.h>
+#include "BENCHs.h"
+
+#define BENCH_MQTT_BUF_SIZE     2048
+#define BENCH_MQTT_TOKEN_LEN    400
+#define BENCH_MQTT_FILTER_NUM   3
+
+static char bench_mqtt_client_id[] = "9e1a7ef4-5e8e-4c31-b5a2-5b7ec1e3a3f0";
+static char bench_mqtt_topic[] = "/v1/deviceEvents/9e1a7ef4-5e8e-4c31-b5a2-5b7ec1e3a3f0";
+static char *bench_mqtt_filters[BENCH_MQTT_FILTER_NUM] = {
+        "/v1/commands/9e1a7ef4-5e8e-4c31-b5a2-5b7ec1e3a3f0",
+        "/v1/notifications/9e1a7ef4-5e8e-4c31-b5a2-5b7ec1e3a3f0",
+        "/v1/registrations/notification/9e1a7ef4-5e8e-4c31-b5a2-5b7ec1e3a3f0",
+};
+
+struct bench_mqtt_packet {
+    unsigned char buf[BENCH_MQTT_BUF_SIZE];
+    int len;
+};
+
+struct bench_mqtt {
+    unsigned char out[BENCH_MQTT_BUF_SIZE];
+    MQTTPacket_connectData connect;
+    char token[BENCH_MQTT_TOKEN_LEN + 1];
+    unsigned char *payload;
+    int payload_len;
+    /* inbound packets made once by the server side serializers */
+    struct bench_mqtt_packet connack;
+    struct bench_mqtt_packet publish;
+    struct bench_mqtt_packet puback;
+    struct bench_mqtt_packet suback;
+    struct bench_mqtt_packet unsuback;
+};
+
+static MQTTString bench_mqtt_string(char *cstring)
+{
+    MQTTString str = MQTTString_initializer;
+
+    str.cstring = cstring;
+    return str;
+}
+
+int BENCH_iot_mqtt_setup(void **state, int payload_len)
+{
+    MQTTPacket_connectData initializer = MQTTPacket_connectData_initializer;
+    int granted_qos[BENCH_MQTT_FILTER_NUM] = { 1, 1, 1 };
+    struct bench_mqtt *mqtt;
+
+    if (payload_len < 0 || payload_len > BENCH_MQTT_BUF_SIZE / 2)
+        return -1;
+
+    mqtt = calloc(1, sizeof(struct bench_mqtt));
+    if (!mqtt)
+        return -1;
+
+    /* JWT sized password like the one made for the cloud connection */
+    memset(mqtt->token, 'J', BENCH_MQTT_TOKEN_LEN);
+    mqtt->connect = initializer;
+    mqtt->connect.MQTTVersion = 4;
+    mqtt->connect.clientID = bench_mqtt_string(bench_mqtt_client_id);
+    mqtt->connect.username = bench_mqtt_string(bench_mqtt_client_id);
+    mqtt->connect.password = bench_mqtt_string(mqtt->token);
+    mqtt->connect.keepAliveInterval = 120;
+    mqtt->connect.cleansession = 0;
+
+    mqtt->payload_len = payload_len;
+    mqtt->payload = malloc(payload_len + 1);
+    if (!mqtt->payload) {
+        free(mqtt);
+        return -1;
+    }
+    memset(mqtt->payload, 'p', payload_len);
+
+    mqtt->connack.len = MQTTSerialize_connack(mqtt->connack.buf, BENCH_MQTT_BUF_SIZE, 0, 1);
+    mqtt->publish.len = MQTTSerialize_publish(mqtt->publish.buf, BENCH_MQTT_BUF_SIZE, 0, 1, 0, 7,
+            bench_mqtt_string(bench_mqtt_filters[0]), mqtt->payload, mqtt->payload_len);
+    mqtt->puback.len = MQTTSerialize_puback(mqtt->puback.buf, BENCH_MQTT_BUF_SIZE, 7);
+    mqtt->suback.len = MQTTSerialize_suback(mqtt->suback.buf, BENCH_MQTT_BUF_SIZE, 8,
+            BENCH_MQTT_FILTER_NUM, granted_qos);
+    mqtt->unsuback.len = MQTTSerialize_unsuback(mqtt->unsuback.buf, BENCH_MQTT_BUF_SIZE, 9);
+    if (mqtt->connack.len <= 0 || mqtt->publish.len <= 0 || mqtt->puback.len <= 0 ||
+            mqtt->suback.len <= 0 || mqtt->unsuback.len <= 0) {
+        BENCH_iot_mqtt_teardown(mqtt);
+        return -1;
+    }
+
+    *state = mqtt;
+    return 0;
+}
+
+int BENCH_iot_mqtt_connect_serialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+
+    return (MQTTSerialize_connect(mqtt->out, BENCH_MQTT_BUF_SIZE, &mqtt->connect) > 0) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_connack_deserialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+    unsigned char session_present;
+    unsigned char connack_rc;
+
+    return (MQTTDeserialize_connack(&session_present, &connack_rc,
+            mqtt->connack.buf, mqtt->connack.len) == 1) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_publish_serialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+
+    return (MQTTSerialize_publish(mqtt->out, BENCH_MQTT_BUF_SIZE, 0, 1, 0, 7,
+            bench_mqtt_string(bench_mqtt_topic), mqtt->payload, mqtt->payload_len) > 0) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_publish_deserialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+    MQTTString topic = MQTTString_initializer;
+    unsigned char *payload;
+    unsigned short packet_id;
+    unsigned char retained;
+    unsigned char dup;
+    int payload_len;
+    int qos;
+
+    if (MQTTDeserialize_publish(&dup, &qos, &retained, &packet_id, &topic,
+            &payload, &payload_len, mqtt->publish.buf, mqtt->publish.len) != 1)
+        return -1;
+
+    return (payload_len == mqtt->payload_len) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_puback_serialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+
+    return (MQTTSerialize_puback(mqtt->out, BENCH_MQTT_BUF_SIZE, 7) > 0) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_puback_deserialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+    unsigned short packet_id;
+    unsigned char packet_type;
+    unsigned char dup;
+
+    return (MQTTDeserialize_ack(&packet_type, &dup, &packet_id,
+            mqtt->puback.buf, mqtt->puback.len) == 1) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_subscribe_serialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+    MQTTString filters[BENCH_MQTT_FILTER_NUM];
+    int qos[BENCH_MQTT_FILTER_NUM] = { 1, 1, 1 };
+    int i;
+
+    for (i = 0; i < BENCH_MQTT_FILTER_NUM; i++)
+        filters[i] = bench_mqtt_string(bench_mqtt_filters[i]);
+
+    return (MQTTSerialize_subscribe(mqtt->out, BENCH_MQTT_BUF_SIZE, 0, 8,
+            BENCH_MQTT_FILTER_NUM, filters, qos) > 0) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_suback_deserialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+    int granted_qos[BENCH_MQTT_FILTER_NUM];
+    unsigned short packet_id;
+    int count;
+
+    if (MQTTDeserialize_suback(&packet_id, BENCH_MQTT_FILTER_NUM, &count, granted_qos,
+            mqtt->suback.buf, mqtt->suback.len) != 1)
+        return -1;
+
+    return (count == BENCH_MQTT_FILTER_NUM) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_unsubscribe_serialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+    MQTTString filters[BENCH_MQTT_FILTER_NUM];
+    int i;
+
+    for (i = 0; i < BENCH_MQTT_FILTER_NUM; i++)
+        filters[i] = bench_mqtt_string(bench_mqtt_filters[i]);
+
+    return (MQTTSerialize_unsubscribe(mqtt->out, BENCH_MQTT_BUF_SIZE, 0, 9,
+            BENCH_MQTT_FILTER_NUM, filters) > 0) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_unsuback_deserialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+    unsigned short packet_id;
+
+    return (MQTTDeserialize_unsuback(&packet_id, mqtt->unsuback.buf, mqtt->unsuback.len) == 1) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_pingreq_serialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+
+    return (MQTTSerialize_pingreq(mqtt->out, BENCH_MQTT_BUF_SIZE) > 0) ? 0 : -1;
+}
+
+int BENCH_iot_mqtt_disconnect_serialize(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+
+    return (MQTTSerialize_disconnect(mqtt->out, BENCH_MQTT_BUF_SIZE) > 0) ? 0 : -1;
+}
+
+void BENCH_iot_mqtt_teardown(void *state)
+{
+    struct bench_mqtt *mqtt = (struct bench_mqtt *)state;
+
+    if (!mqtt)
+        return;
+
+    free(mqtt->payload);
+    free(mqtt);
+}
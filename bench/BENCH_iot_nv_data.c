@@ -0,0 +1,65 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <string.h>
+#include <iot_error.h>
+#include <iot_nv_data.h>
+#include <iot_mem.h>
+#include "BENCHs.h"
+
+/* POSIX fs keeps each NV item as a file in the current directory */
+static const char bench_nv_device_id[] = "c236ed2c-5bab-4e54-a1aa-7bbaa1e2dd35";
+
+int BENCH_iot_nv_setup(void **state, int param)
+{
+    (void)state;
+    (void)param;
+
+    if (iot_nv_init(NULL, 0) != IOT_ERROR_NONE)
+        return -1;
+
+    /* get needs an item to read */
+    return (iot_nv_set_device_id(bench_nv_device_id) == IOT_ERROR_NONE) ? 0 : -1;
+}
+
+int BENCH_iot_nv_set_device_id(void *state)
+{
+    (void)state;
+
+    return (iot_nv_set_device_id(bench_nv_device_id) == IOT_ERROR_NONE) ? 0 : -1;
+}
+
+int BENCH_iot_nv_get_device_id(void *state)
+{
+    char *device_id = NULL;
+    size_t len = 0;
+    (void)state;
+
+    if (iot_nv_get_device_id(&device_id, &len) != IOT_ERROR_NONE)
+        return -1;
+
+    iot_mem_free(IOT_MEM_TAG_NV, device_id);
+    return (len == strlen(bench_nv_device_id)) ? 0 : -1;
+}
+
+void BENCH_iot_nv_teardown(void *state)
+{
+    (void)state;
+
+    iot_nv_erase(IOT_NVD_DEVICE_ID);
+    iot_nv_deinit();
+}
@@ -0,0 +1,69 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <iot_error.h>
+#include <iot_serialize.h>
+#include <iot_mem.h>
+#include "BENCHs.h"
+
+struct bench_serialize {
+    char *cbor;
+    size_t cbor_len;
+};
+
+int BENCH_iot_serialize_setup(void **state, int cmd_num)
+{
+    struct bench_serialize *ser;
+
+    ser = calloc(1, sizeof(struct bench_serialize));
+    if (!ser)
+        return -1;
+
+    if (bench_make_cmd_payload(cmd_num, true, &ser->cbor, &ser->cbor_len)) {
+        free(ser);
+        return -1;
+    }
+
+    *state = ser;
+    return 0;
+}
+
+int BENCH_iot_serialize_cbor2json(void *state)
+{
+    struct bench_serialize *ser = (struct bench_serialize *)state;
+    char *json = NULL;
+    size_t json_len = 0;
+
+    if (iot_serialize_cbor2json((uint8_t *)ser->cbor, ser->cbor_len, &json, &json_len) != IOT_ERROR_NONE)
+        return -1;
+
+    iot_mem_free(IOT_MEM_TAG_CORE, json);
+    return (json_len > 0) ? 0 : -1;
+}
+
+void BENCH_iot_serialize_teardown(void *state)
+{
+    struct bench_serialize *ser = (struct bench_serialize *)state;
+
+    if (!ser)
+        return;
+
+    free(ser->cbor);
+    free(ser);
+}
@@ -0,0 +1,63 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <iot_error.h>
+#include <iot_main.h>
+#include <iot_util.h>
+#include "BENCHs.h"
+
+static const char bench_util_uuid_str[] = "c236ed2c-5bab-4e54-a1aa-7bbaa1e2dd35";
+static char bench_util_mac_str[] = "02:43:4e:59:25:7d";
+static struct iot_uuid bench_util_uuid = {
+    .id = { 0xc2, 0x36, 0xed, 0x2c, 0x5b, 0xab, 0x4e, 0x54,
+            0xa1, 0xaa, 0x7b, 0xba, 0xa1, 0xe2, 0xdd, 0x35 },
+};
+static struct iot_mac bench_util_mac = {
+    .addr = { 0x02, 0x43, 0x4e, 0x59, 0x25, 0x7d },
+};
+
+int BENCH_iot_util_convert_str_uuid(void *state)
+{
+    struct iot_uuid uuid;
+    (void)state;
+
+    return (iot_util_convert_str_uuid(bench_util_uuid_str, &uuid) == IOT_ERROR_NONE) ? 0 : -1;
+}
+
+int BENCH_iot_util_convert_uuid_str(void *state)
+{
+    char str[40];
+    (void)state;
+
+    return (iot_util_convert_uuid_str(&bench_util_uuid, str, sizeof(str)) == IOT_ERROR_NONE) ? 0 : -1;
+}
+
+int BENCH_iot_util_convert_str_mac(void *state)
+{
+    struct iot_mac mac;
+    (void)state;
+
+    return (iot_util_convert_str_mac(bench_util_mac_str, &mac) == IOT_ERROR_NONE) ? 0 : -1;
+}
+
+int BENCH_iot_util_convert_mac_str(void *state)
+{
+    char str[20];
+    (void)state;
+
+    return (iot_util_convert_mac_str(&bench_util_mac, str, sizeof(str)) == IOT_ERROR_NONE) ? 0 : -1;
+}
@@ -0,0 +1,361 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <st_dev_version.h>
+#include "BENCHs.h"
+
+#define BENCH_DEFAULT_MIN_TIME_MS   200
+#define BENCH_DEFAULT_REPEAT        3
+#define BENCH_MAX_REPEAT            15
+#define BENCH_MAX_ITERATIONS        100000000UL
+
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+#define BENCH_SERIALIZE             "cbor"
+#else
+#define BENCH_SERIALIZE             "json"
+#endif
+
+enum bench_format {
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON,
+};
+
+struct bench_result {
+    unsigned long iterations;
+    double ns_per_op;
+    double min_ns_per_op;
+};
+
+static const struct bench_case bench_cases[] = {
+        bench_case("iot_capability", "evt_encode", 1, BENCH_iot_cap_evt_setup, BENCH_iot_cap_evt_send, BENCH_iot_cap_evt_teardown),
+        bench_case("iot_capability", "evt_encode", 10, BENCH_iot_cap_evt_setup, BENCH_iot_cap_evt_send, BENCH_iot_cap_evt_teardown),
+        bench_case("iot_capability", "evt_encode", 50, BENCH_iot_cap_evt_setup, BENCH_iot_cap_evt_send, BENCH_iot_cap_evt_teardown),
+        bench_case("iot_capability", "cmd_decode", 1, BENCH_iot_cap_cmd_setup, BENCH_iot_cap_cmd_dispatch, BENCH_iot_cap_cmd_teardown),
+        bench_case("iot_capability", "cmd_decode", 10, BENCH_iot_cap_cmd_setup, BENCH_iot_cap_cmd_dispatch, BENCH_iot_cap_cmd_teardown),
+        bench_case("iot_serialize", "cbor2json", 1, BENCH_iot_serialize_setup, BENCH_iot_serialize_cbor2json, BENCH_iot_serialize_teardown),
+        bench_case("iot_serialize", "cbor2json", 10, BENCH_iot_serialize_setup, BENCH_iot_serialize_cbor2json, BENCH_iot_serialize_teardown),
+        bench_case("iot_mqtt", "connect_serialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_connect_serialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "connack_deserialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_connack_deserialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "publish_serialize", 64, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_publish_serialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "publish_serialize", 1024, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_publish_serialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "publish_deserialize", 64, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_publish_deserialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "publish_deserialize", 1024, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_publish_deserialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "puback_serialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_puback_serialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "puback_deserialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_puback_deserialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "subscribe_serialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_subscribe_serialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "suback_deserialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_suback_deserialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "unsubscribe_serialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_unsubscribe_serialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "unsuback_deserialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_unsuback_deserialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "pingreq_serialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_pingreq_serialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_mqtt", "disconnect_serialize", 0, BENCH_iot_mqtt_setup, BENCH_iot_mqtt_disconnect_serialize, BENCH_iot_mqtt_teardown),
+        bench_case("iot_crypto", "base64_encode", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_encode, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_encode", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_encode, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_encode", 16384, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_encode, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_encode", 65536, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_encode, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_decode", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_decode, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_decode", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_decode, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_decode", 16384, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_decode, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_decode", 65536, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_decode, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_encode_urlsafe", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_encode_urlsafe, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_encode_urlsafe", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_encode_urlsafe, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_encode_urlsafe", 16384, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_encode_urlsafe, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_encode_urlsafe", 65536, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_encode_urlsafe, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_decode_urlsafe", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_decode_urlsafe, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_decode_urlsafe", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_decode_urlsafe, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_decode_urlsafe", 16384, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_decode_urlsafe, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "base64_decode_urlsafe", 65536, BENCH_iot_crypto_setup, BENCH_iot_crypto_base64_decode_urlsafe, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "sha256", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_sha256, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "sha256", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_sha256, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "sha256", 65536, BENCH_iot_crypto_setup, BENCH_iot_crypto_sha256, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "sha256_stream", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_sha256_stream, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "sha256_stream", 65536, BENCH_iot_crypto_setup, BENCH_iot_crypto_sha256_stream, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "hmac_sha256", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_hmac_sha256, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "hmac_sha256", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_hmac_sha256, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "hmac_sha256", 65536, BENCH_iot_crypto_setup, BENCH_iot_crypto_hmac_sha256, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "aes_encrypt", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_aes_encrypt, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "aes_encrypt", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_aes_encrypt, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "aes_decrypt", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_aes_decrypt, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "aes_decrypt", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_aes_decrypt, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "aes_encrypt_session", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_aes_encrypt_session, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "aes_encrypt_session", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_aes_encrypt_session, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "ed25519_sign", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_ed25519_sign, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "ed25519_verify", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_ed25519_verify, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "ed25519_sign_oneshot", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_ed25519_sign_oneshot, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "ed25519_sign_batch8", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_ed25519_sign_batch, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "ecdh_master_secret", 32, BENCH_iot_crypto_setup, BENCH_iot_crypto_ecdh_master_secret, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "random", 16, BENCH_iot_crypto_setup, BENCH_iot_crypto_random, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "random", 1024, BENCH_iot_crypto_setup, BENCH_iot_crypto_random, BENCH_iot_crypto_teardown),
+#if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_RSA)
+        bench_case("iot_crypto", "rsa_sign", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_rsa_sign, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "rsa_verify", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_rsa_verify, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "rsa_sign_oneshot", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_rsa_sign_oneshot, BENCH_iot_crypto_teardown),
+        bench_case("iot_crypto", "rsa_sign_batch8", 64, BENCH_iot_crypto_setup, BENCH_iot_crypto_rsa_sign_batch, BENCH_iot_crypto_teardown),
+#endif
+        bench_case("iot_util", "convert_str_uuid", 0, NULL, BENCH_iot_util_convert_str_uuid, NULL),
+        bench_case("iot_util", "convert_uuid_str", 0, NULL, BENCH_iot_util_convert_uuid_str, NULL),
+        bench_case("iot_util", "convert_str_mac", 0, NULL, BENCH_iot_util_convert_str_mac, NULL),
+        bench_case("iot_util", "convert_mac_str", 0, NULL, BENCH_iot_util_convert_mac_str, NULL),
+        bench_case("iot_nv_data", "set_device_id", 0, BENCH_iot_nv_setup, BENCH_iot_nv_set_device_id, BENCH_iot_nv_teardown),
+        bench_case("iot_nv_data", "get_device_id", 0, BENCH_iot_nv_setup, BENCH_iot_nv_get_device_id, BENCH_iot_nv_teardown),
+        bench_case("iot_easysetup", "onboarding_keepalive", 256, BENCH_iot_easysetup_httpd_keepalive_setup, BENCH_iot_easysetup_httpd_onboarding, BENCH_iot_easysetup_httpd_teardown),
+        bench_case("iot_easysetup", "onboarding_keepalive", 2048, BENCH_iot_easysetup_httpd_keepalive_setup, BENCH_iot_easysetup_httpd_onboarding, BENCH_iot_easysetup_httpd_teardown),
+        bench_case("iot_easysetup", "onboarding_close", 256, BENCH_iot_easysetup_httpd_close_setup, BENCH_iot_easysetup_httpd_onboarding, BENCH_iot_easysetup_httpd_teardown),
+        bench_case("iot_easysetup", "onboarding_close", 2048, BENCH_iot_easysetup_httpd_close_setup, BENCH_iot_easysetup_httpd_onboarding, BENCH_iot_easysetup_httpd_teardown),
+        bench_case("iot_easysetup", "wifiscan_sync", 0, BENCH_iot_easysetup_scan_sync_setup, BENCH_iot_easysetup_scan_sync, BENCH_iot_easysetup_scan_sync_teardown),
+        bench_case("iot_easysetup", "wifiscan_sync", 50, BENCH_iot_easysetup_scan_sync_setup, BENCH_iot_easysetup_scan_sync, BENCH_iot_easysetup_scan_sync_teardown),
+        bench_case("iot_easysetup", "wifiscan_cached", 0, BENCH_iot_easysetup_scan_cached_setup, BENCH_iot_easysetup_scan_cached, BENCH_iot_easysetup_scan_cached_teardown),
+        bench_case("iot_easysetup", "wifiscan_cached", 50, BENCH_iot_easysetup_scan_cached_setup, BENCH_iot_easysetup_scan_cached, BENCH_iot_easysetup_scan_cached_teardown),
+};
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int bench_measure(const struct bench_case *bc, void *state,
+                         unsigned long iterations, uint64_t *elapsed_ns)
+{
+    uint64_t start = bench_now_ns();
+    unsigned long i;
+
+    for (i = 0; i < iterations; i++) {
+        if (bc->run(state))
+            return -1;
+    }
+    *elapsed_ns = bench_now_ns() - start;
+
+    return 0;
+}
+
+static int bench_cmp_double(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
+
+/* Grow iterations until one batch takes min_time, then time repeat batches */
+static int bench_run_case(const struct bench_case *bc, uint64_t min_time_ns,
+                          int repeat, struct bench_result *result)
+{
+    double samples[BENCH_MAX_REPEAT];
+    unsigned long iterations = 1;
+    unsigned long next;
+    uint64_t elapsed;
+    void *state = NULL;
+    int ret = -1;
+    int i;
+
+    if (bc->setup && bc->setup(&state, bc->param))
+        return -1;
+
+    /* warm up caches and lazy initialization outside of the timing */
+    if (bc->run(state))
+        goto out;
+
+    while (1) {
+        if (bench_measure(bc, state, iterations, &elapsed))
+            goto out;
+        if (elapsed >= min_time_ns || iterations >= BENCH_MAX_ITERATIONS)
+            break;
+
+        if (elapsed == 0) {
+            next = iterations * 100;
+        } else {
+            next = (unsigned long)((double)iterations * min_time_ns * 1.2 / elapsed);
+            if (next < iterations * 2)
+                next = iterations * 2;
+            if (next > iterations * 100)
+                next = iterations * 100;
+        }
+        iterations = (next > BENCH_MAX_ITERATIONS) ? BENCH_MAX_ITERATIONS : next;
+    }
+
+    for (i = 0; i < repeat; i++) {
+        if (bench_measure(bc, state, iterations, &elapsed))
+            goto out;
+        samples[i] = (double)elapsed / iterations;
+    }
+    qsort(samples, repeat, sizeof(double), bench_cmp_double);
+
+    result->iterations = iterations;
+    result->ns_per_op = samples[repeat / 2];
+    result->min_ns_per_op = samples[0];
+    ret = 0;
+
+out:
+    if (bc->teardown)
+        bc->teardown(state);
+    return ret;
+}
+
+static void bench_print_header(FILE *out, enum bench_format format,
+                               unsigned int min_time_ms, int repeat)
+{
+    if (format == BENCH_FORMAT_CSV) {
+        fprintf(out, "group,name,param,iterations,ns_per_op,min_ns_per_op,ops_per_sec\n");
+    } else {
+        fprintf(out, "{\n");
+        fprintf(out, "  \"sdk_version\": \"%d.%d.%d\",\n", VER_MAJOR, VER_MINOR, VER_PATCH);
+        fprintf(out, "  \"serialize\": \"%s\",\n", BENCH_SERIALIZE);
+        fprintf(out, "  \"sha256_backend\": \"%s\",\n", bench_crypto_sha256_backend());
+        fprintf(out, "  \"min_time_ms\": %u,\n", min_time_ms);
+        fprintf(out, "  \"repeat\": %d,\n", repeat);
+        fprintf(out, "  \"results\": [");
+    }
+}
+
+static void bench_print_result(FILE *out, enum bench_format format, bool first,
+                               const struct bench_case *bc, const struct bench_result *result)
+{
+    /* throughput of median, e.g. signatures per second for sign cases */
+    double ops_per_sec = (result->ns_per_op > 0) ? 1e9 / result->ns_per_op : 0;
+
+    if (format == BENCH_FORMAT_CSV) {
+        fprintf(out, "%s,%s,%d,%lu,%.1f,%.1f,%.1f\n", bc->group, bc->name, bc->param,
+                result->iterations, result->ns_per_op, result->min_ns_per_op, ops_per_sec);
+    } else {
+        fprintf(out, "%s\n    {\"group\": \"%s\", \"name\": \"%s\", \"param\": %d, "
+                "\"iterations\": %lu, \"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, "
+                "\"ops_per_sec\": %.1f}",
+                first ? "" : ",", bc->group, bc->name, bc->param,
+                result->iterations, result->ns_per_op, result->min_ns_per_op, ops_per_sec);
+    }
+    fflush(out);
+}
+
+static void bench_print_footer(FILE *out, enum bench_format format)
+{
+    if (format == BENCH_FORMAT_JSON)
+        fprintf(out, "\n  ]\n}\n");
+}
+
+static bool bench_match(const struct bench_case *bc, const char *filter)
+{
+    char full_name[128];
+
+    if (!filter)
+        return true;
+
+    snprintf(full_name, sizeof(full_name), "%s/%s/%d", bc->group, bc->name, bc->param);
+    return strstr(full_name, filter) != NULL;
+}
+
+static void bench_usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--format csv|json] [--filter group/name/param]\n"
+            "          [--min-time-ms N] [--repeat N] [--output FILE] [--list]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    enum bench_format format = BENCH_FORMAT_CSV;
+    unsigned int min_time_ms = BENCH_DEFAULT_MIN_TIME_MS;
+    int repeat = BENCH_DEFAULT_REPEAT;
+    const char *filter = NULL;
+    const char *output = NULL;
+    struct bench_result result;
+    bool list = false;
+    bool first = true;
+    int failed = 0;
+    FILE *out;
+    size_t i;
+    int out_fd;
+
+    for (i = 1; i < (size_t)argc; i++) {
+        if (!strcmp(argv[i], "--format") && i + 1 < (size_t)argc) {
+            i++;
+            if (!strcmp(argv[i], "csv")) {
+                format = BENCH_FORMAT_CSV;
+            } else if (!strcmp(argv[i], "json")) {
+                format = BENCH_FORMAT_JSON;
+            } else {
+                bench_usage(argv[0]);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--filter") && i + 1 < (size_t)argc) {
+            filter = argv[++i];
+        } else if (!strcmp(argv[i], "--min-time-ms") && i + 1 < (size_t)argc) {
+            min_time_ms = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--repeat") && i + 1 < (size_t)argc) {
+            repeat = atoi(argv[++i]);
+            if (repeat < 1 || repeat > BENCH_MAX_REPEAT) {
+                fprintf(stderr, "repeat should be 1 ~ %d\n", BENCH_MAX_REPEAT);
+                return 2;
+            }
+        } else if (!strcmp(argv[i], "--output") && i + 1 < (size_t)argc) {
+            output = argv[++i];
+        } else if (!strcmp(argv[i], "--list")) {
+            list = true;
+        } else {
+            bench_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (list) {
+        for (i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+            if (bench_match(&bench_cases[i], filter))
+                printf("%s/%s/%d\n", bench_cases[i].group, bench_cases[i].name, bench_cases[i].param);
+        }
+        return 0;
+    }
+
+    /* SDK logs are printed to stdout, keep them out of the results */
+    if (output) {
+        out = fopen(output, "w");
+    } else {
+        out_fd = dup(STDOUT_FILENO);
+        out = (out_fd < 0) ? NULL : fdopen(out_fd, "w");
+        if (out)
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+    if (!out) {
+        perror("bench output");
+        return 2;
+    }
+
+    bench_print_header(out, format, min_time_ms, repeat);
+    for (i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+        const struct bench_case *bc = &bench_cases[i];
+
+        if (!bench_match(bc, filter))
+            continue;
+
+        if (bench_run_case(bc, (uint64_t)min_time_ms * 1000000, repeat, &result)) {
+            fprintf(stderr, "FAIL %s/%s/%d\n", bc->group, bc->name, bc->param);
+            failed++;
+            continue;
+        }
+        bench_print_result(out, format, first, bc, &result);
+        first = false;
+    }
+    bench_print_footer(out, format);
+    fclose(out);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#ifndef ST_DEVICE_SDK_C_BENCHS_H
+#define ST_DEVICE_SDK_C_BENCHS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A bench case prepares its state once with param, then run() is timed
+ * in a loop. run() does one operation and returns 0 on success.
+ */
+typedef int (*bench_setup_fn)(void **state, int param);
+typedef int (*bench_run_fn)(void *state);
+typedef void (*bench_teardown_fn)(void *state);
+
+struct bench_case {
+    const char *group;
+    const char *name;
+    int param;
+    bench_setup_fn setup;
+    bench_run_fn run;
+    bench_teardown_fn teardown;
+};
+
+#define bench_case(group, name, param, setup, run, teardown) \
+    { group, name, param, setup, run, teardown }
+
+// Helpers for iot_capability.c and iot_serialize.c
+int bench_make_cmd_payload(int cmd_num, bool cbor, char **payload, size_t *payload_len);
+
+// BENCHs for iot_capability.c
+int BENCH_iot_cap_evt_setup(void **state, int attr_num);
+int BENCH_iot_cap_evt_send(void *state);
+void BENCH_iot_cap_evt_teardown(void *state);
+int BENCH_iot_cap_cmd_setup(void **state, int cmd_num);
+int BENCH_iot_cap_cmd_dispatch(void *state);
+void BENCH_iot_cap_cmd_teardown(void *state);
+
+// BENCHs for iot_serialize.c
+int BENCH_iot_serialize_setup(void **state, int cmd_num);
+int BENCH_iot_serialize_cbor2json(void *state);
+void BENCH_iot_serialize_teardown(void *state);
+
+// BENCHs for mqtt/packet
+int BENCH_iot_mqtt_setup(void **state, int payload_len);
+int BENCH_iot_mqtt_connect_serialize(void *state);
+int BENCH_iot_mqtt_connack_deserialize(void *state);
+int BENCH_iot_mqtt_publish_serialize(void *state);
+int BENCH_iot_mqtt_publish_deserialize(void *state);
+int BENCH_iot_mqtt_puback_serialize(void *state);
+int BENCH_iot_mqtt_puback_deserialize(void *state);
+int BENCH_iot_mqtt_subscribe_serialize(void *state);
+int BENCH_iot_mqtt_suback_deserialize(void *state);
+int BENCH_iot_mqtt_unsubscribe_serialize(void *state);
+int BENCH_iot_mqtt_unsuback_deserialize(void *state);
+int BENCH_iot_mqtt_pingreq_serialize(void *state);
+int BENCH_iot_mqtt_disconnect_serialize(void *state);
+void BENCH_iot_mqtt_teardown(void *state);
+
+// BENCHs for iot_crypto.c
+int BENCH_iot_crypto_setup(void **state, int data_len);
+int BENCH_iot_crypto_base64_encode(void *state);
+int BENCH_iot_crypto_base64_decode(void *state);
+int BENCH_iot_crypto_base64_encode_urlsafe(void *state);
+int BENCH_iot_crypto_base64_decode_urlsafe(void *state);
+int BENCH_iot_crypto_sha256(void *state);
+int BENCH_iot_crypto_sha256_stream(void *state);
+int BENCH_iot_crypto_hmac_sha256(void *state);
+const char *bench_crypto_sha256_backend(void);
+int BENCH_iot_crypto_aes_encrypt(void *state);
+int BENCH_iot_crypto_aes_decrypt(void *state);
+int BENCH_iot_crypto_aes_encrypt_session(void *state);
+int BENCH_iot_crypto_ed25519_sign(void *state);
+int BENCH_iot_crypto_ed25519_verify(void *state);
+int BENCH_iot_crypto_ed25519_sign_oneshot(void *state);
+int BENCH_iot_crypto_ed25519_sign_batch(void *state);
+int BENCH_iot_crypto_ecdh_master_secret(void *state);
+int BENCH_iot_crypto_random(void *state);
+#if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_RSA)
+int BENCH_iot_crypto_rsa_sign(void *state);
+int BENCH_iot_crypto_rsa_verify(void *state);
+int BENCH_iot_crypto_rsa_sign_oneshot(void *state);
+int BENCH_iot_crypto_rsa_sign_batch(void *state);
+#endif
+void BENCH_iot_crypto_teardown(void *state);
+
+// BENCHs for iot_util.c
+int BENCH_iot_util_convert_str_uuid(void *state);
+int BENCH_iot_util_convert_uuid_str(void *state);
+int BENCH_iot_util_convert_str_mac(void *state);
+int BENCH_iot_util_convert_mac_str(void *state);
+
+// BENCHs for iot_nv_data.c
+int BENCH_iot_nv_setup(void **state, int param);
+int BENCH_iot_nv_set_device_id(void *state);
+int BENCH_iot_nv_get_device_id(void *state);
+void BENCH_iot_nv_teardown(void *state);
+
+// BENCHs for easysetup/http/iot_easysetup_tcp_httpd.c
+int BENCH_iot_easysetup_httpd_keepalive_setup(void **state, int body_len);
+int BENCH_iot_easysetup_httpd_close_setup(void **state, int body_len);
+int BENCH_iot_easysetup_httpd_onboarding(void *state);
+void BENCH_iot_easysetup_httpd_teardown(void *state);
+
+// BENCHs for easysetup/iot_easysetup_scan.c
+int BENCH_iot_easysetup_scan_sync_setup(void **state, int scan_delay_ms);
+int BENCH_iot_easysetup_scan_sync(void *state);
+void BENCH_iot_easysetup_scan_sync_teardown(void *state);
+int BENCH_iot_easysetup_scan_cached_setup(void **state, int scan_delay_ms);
+int BENCH_iot_easysetup_scan_cached(void *state);
+void BENCH_iot_easysetup_scan_cached_teardown(void *state);
+
+#endif //ST_DEVICE_SDK_C_BENCHS_H
@@ -36,6 +36,7 @@ else ifeq ($(CONFIG_STDK_IOT_CORE_OS_SUPPORT_POSIX),y)
 	COMPONENT_SRCDIRS += port/os/posix
 endif
 
+COMPONENT_SRCDIRS += port/net
 ifeq ($(CONFIG_STDK_IOT_CORE_NET_MBEDTLS),y)
 	COMPONENT_SRCDIRS += port/net/mbedtls
 	COMPONENT_ADD_INCLUDEDIRS += port/net/mbedtls
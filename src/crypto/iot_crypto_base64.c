@@ -0,0 +1,332 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "iot_main.h"
+#include "iot_debug.h"
+
+/*
+ * Both alphabets are handled in a single pass, so urlsafe strings are no
+ * longer copied and translated around the standard codec. Output is the
+ * same as mbedtls_base64_encode, including the '=' padding of urlsafe
+ * output, and well-formed input decodes as it did with mbedtls.
+ */
+
+#define IOT_CRYPTO_B64_DEC_SPACE	0xFD	/* ' ', '\r' and '\n' */
+#define IOT_CRYPTO_B64_DEC_PAD		0xFE	/* '=' */
+#define IOT_CRYPTO_B64_DEC_INVALID	0xFF
+
+static const unsigned char _iot_crypto_b64_enc_std[64] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static const unsigned char _iot_crypto_b64_enc_url[64] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static const unsigned char _iot_crypto_b64_dec_std[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFD, 0xFF, 0xFF, 0xFD, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFD, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF,
+	0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+/* urlsafe decode has always accepted '+' and '/' as well */
+static const unsigned char _iot_crypto_b64_dec_url[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFD, 0xFF, 0xFF, 0xFD, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFD, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0x3E, 0xFF, 0x3F,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFE, 0xFF, 0xFF,
+	0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F,
+	0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static iot_error_t _iot_crypto_b64_encode(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t dst_len, size_t *out_len,
+		const unsigned char *alphabet)
+{
+	unsigned char *out = dst;
+	size_t need;
+	size_t i;
+
+	if (src_len > (SIZE_MAX - 1) / 4 * 3) {
+		*out_len = SIZE_MAX;
+		return IOT_ERROR_CRYPTO_BASE64;
+	}
+
+	need = (src_len + 2) / 3 * 4;
+	if (dst_len < need + 1) {
+		*out_len = need + 1;
+		return IOT_ERROR_CRYPTO_BASE64;
+	}
+
+	for (i = 0; src_len - i >= 3; i += 3) {
+		out[0] = alphabet[src[i] >> 2];
+		out[1] = alphabet[((src[i] & 0x03) << 4) | (src[i + 1] >> 4)];
+		out[2] = alphabet[((src[i + 1] & 0x0F) << 2) | (src[i + 2] >> 6)];
+		out[3] = alphabet[src[i + 2] & 0x3F];
+		out += 4;
+	}
+
+	if (src_len - i == 1) {
+		out[0] = alphabet[src[i] >> 2];
+		out[1] = alphabet[(src[i] & 0x03) << 4];
+		out[2] = '=';
+		out[3] = '=';
+		out += 4;
+	} else if (src_len - i == 2) {
+		out[0] = alphabet[src[i] >> 2];
+		out[1] = alphabet[((src[i] & 0x03) << 4) | (src[i + 1] >> 4)];
+		out[2] = alphabet[(src[i + 1] & 0x0F) << 2];
+		out[3] = '=';
+		out += 4;
+	}
+
+	*out = '\0';
+	*out_len = out - dst;
+
+	return IOT_ERROR_NONE;
+}
+
+/*
+ * Spaces are allowed only right before a line break or at the end of
+ * the string, and a line break is "\n" or "\r\n". Returns where data
+ * continues, or NULL for a space inside a line.
+ */
+static const unsigned char *_iot_crypto_b64_skip_space(const unsigned char *p,
+		const unsigned char *end)
+{
+	while (p < end && *p == ' ')
+		p++;
+
+	if (p == end)
+		return p;
+	if (*p == '\n')
+		return p + 1;
+	if (*p == '\r' && (end - p) >= 2 && p[1] == '\n')
+		return p + 2;
+
+	return NULL;
+}
+
+static iot_error_t _iot_crypto_b64_decode(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t dst_len, size_t *out_len,
+		const unsigned char *map, bool pad_optional)
+{
+	const unsigned char *end = src + src_len;
+	unsigned char *out = dst;
+	unsigned char a, b, c, d;
+	uint32_t acc = 0;
+	unsigned int n = 0;
+	unsigned int pad = 0;
+	size_t data_len = src_len;
+	size_t need;
+	size_t i;
+
+	/* trailing padding and line breaks carry no data */
+	while (data_len > 0 && (map[src[data_len - 1]] == IOT_CRYPTO_B64_DEC_PAD ||
+			map[src[data_len - 1]] == IOT_CRYPTO_B64_DEC_SPACE))
+		data_len--;
+
+	need = data_len / 4 * 3 + (data_len % 4) * 3 / 4;
+	if (dst_len < need) {
+		/* line breaks inside the string make the estimate too big */
+		for (i = 0, data_len = 0; src + i < end; i++) {
+			if (map[src[i]] < 64)
+				data_len++;
+		}
+		need = data_len / 4 * 3 + (data_len % 4) * 3 / 4;
+		if (dst_len < need) {
+			*out_len = need;
+			return IOT_ERROR_CRYPTO_BASE64;
+		}
+	}
+
+	while (src < end) {
+		if (n == 0 && pad == 0) {
+			/* whole groups of four data characters are the common case */
+			while ((end - src) >= 4) {
+				a = map[src[0]];
+				b = map[src[1]];
+				c = map[src[2]];
+				d = map[src[3]];
+				if ((a | b | c | d) & 0xC0)
+					break;
+
+				out[0] = (unsigned char)((a << 2) | (b >> 4));
+				out[1] = (unsigned char)((b << 4) | (c >> 2));
+				out[2] = (unsigned char)((c << 6) | d);
+				out += 3;
+				src += 4;
+			}
+
+			if (src == end)
+				break;
+		}
+
+		a = map[*src];
+		if (a < 64) {
+			if (pad)
+				return IOT_ERROR_CRYPTO_BASE64;
+
+			acc = (acc << 6) | a;
+			if (++n == 4) {
+				out[0] = (unsigned char)(acc >> 16);
+				out[1] = (unsigned char)(acc >> 8);
+				out[2] = (unsigned char)acc;
+				out += 3;
+				acc = 0;
+				n = 0;
+			}
+			src++;
+		} else if (a == IOT_CRYPTO_B64_DEC_PAD) {
+			if (++pad > 2)
+				return IOT_ERROR_CRYPTO_BASE64;
+			src++;
+		} else if (a == IOT_CRYPTO_B64_DEC_SPACE) {
+			src = _iot_crypto_b64_skip_space(src, end);
+			if (!src)
+				return IOT_ERROR_CRYPTO_BASE64;
+		} else {
+			return IOT_ERROR_CRYPTO_BASE64;
+		}
+	}
+
+	/* the last group is "xx==" or "xxx=", urlsafe may leave the '=' out */
+	if (n == 0) {
+		if (pad)
+			return IOT_ERROR_CRYPTO_BASE64;
+	} else if (n == 1) {
+		return IOT_ERROR_CRYPTO_BASE64;
+	} else if (pad_optional ? (n + pad > 4) : (n + pad != 4)) {
+		return IOT_ERROR_CRYPTO_BASE64;
+	}
+
+	if (n == 2) {
+		*out++ = (unsigned char)(acc >> 4);
+	} else if (n == 3) {
+		*out++ = (unsigned char)(acc >> 10);
+		*out++ = (unsigned char)(acc >> 2);
+	}
+
+	*out_len = out - dst;
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_crypto_base64_encode(const unsigned char *src, size_t src_len,
+                                     unsigned char *dst, size_t dst_len,
+                                     size_t *out_len)
+{
+	iot_error_t err;
+
+	if (!src || !dst || !out_len) {
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	err = _iot_crypto_b64_encode(src, src_len, dst, dst_len, out_len,
+			_iot_crypto_b64_enc_std);
+	if (err) {
+		IOT_ERROR("base64 encode failed, need %d bytes", *out_len);
+		return IOT_ERROR_CRYPTO_BASE64;
+	}
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_crypto_base64_decode(const unsigned char *src, size_t src_len,
+                                     unsigned char *dst, size_t dst_len,
+                                     size_t *out_len)
+{
+	iot_error_t err;
+
+	if (!src || !dst || !out_len) {
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	err = _iot_crypto_b64_decode(src, src_len, dst, dst_len, out_len,
+			_iot_crypto_b64_dec_std, false);
+	if (err) {
+		IOT_ERROR("base64 decode failed for %d bytes", src_len);
+		return IOT_ERROR_CRYPTO_BASE64;
+	}
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_crypto_base64_encode_urlsafe(const unsigned char *src, size_t src_len,
+                                             unsigned char *dst, size_t dst_len,
+                                             size_t *out_len)
+{
+	iot_error_t err;
+
+	if (!src || !dst || !out_len) {
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	err = _iot_crypto_b64_encode(src, src_len, dst, dst_len, out_len,
+			_iot_crypto_b64_enc_url);
+	if (err) {
+		IOT_ERROR("urlsafe encode failed, need %d bytes", *out_len);
+		return IOT_ERROR_CRYPTO_BASE64_URLSAFE;
+	}
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_crypto_base64_decode_urlsafe(const unsigned char *src, size_t src_len,
+                                             unsigned char *dst, size_t dst_len,
+                                             size_t *out_len)
+{
+	iot_error_t err;
+
+	if (!src || !dst || !out_len) {
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	err = _iot_crypto_b64_decode(src, src_len, dst, dst_len, out_len,
+			_iot_crypto_b64_dec_url, true);
+	if (err) {
+		IOT_ERROR("urlsafe decode failed for %d bytes", src_len);
+		return IOT_ERROR_CRYPTO_BASE64_URLSAFE;
+	}
+
+	return IOT_ERROR_NONE;
+}
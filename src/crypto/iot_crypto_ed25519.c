@@ -20,6 +20,7 @@
 
 #include "iot_main.h"
 #include "iot_debug.h"
+#include "iot_mem.h"
 
 iot_error_t iot_crypto_ed25519_init_keypair(iot_crypto_ed25519_keypair_t *kp)
 {
@@ -28,13 +29,13 @@ iot_error_t iot_crypto_ed25519_init_keypair(iot_crypto_ed25519_keypair_t *kp)
 
 	/* buffer for ed25519 */
 
-	kp->sign.pubkey = (unsigned char *)malloc(pklen);
+	kp->sign.pubkey = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, pklen);
 	if (!kp->sign.pubkey) {
 		IOT_ERROR("malloc failed for pubkey");
 		goto exit_sign_pk;
 	}
 
-	kp->sign.seckey = (unsigned char *)malloc(sklen);
+	kp->sign.seckey = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, sklen);
 	if (!kp->sign.seckey) {
 		IOT_ERROR("malloc failed for seckey");
 		goto exit_sign_sk;
@@ -42,13 +43,13 @@ iot_error_t iot_crypto_ed25519_init_keypair(iot_crypto_ed25519_keypair_t *kp)
 
 	/* buffer for curve25519 */
 
-	kp->curve.pubkey = (unsigned char *)malloc(pklen);
+	kp->curve.pubkey = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, pklen);
 	if (!kp->curve.pubkey) {
 		IOT_ERROR("malloc failed for pubkey");
 		goto exit_curve_pk;
 	}
 
-	kp->curve.seckey = (unsigned char *)malloc(sklen);
+	kp->curve.seckey = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, sklen);
 	if (!kp->curve.seckey) {
 		IOT_ERROR("malloc failed for seckey");
 		goto exit_curve_sk;
@@ -57,13 +58,13 @@ iot_error_t iot_crypto_ed25519_init_keypair(iot_crypto_ed25519_keypair_t *kp)
 	return IOT_ERROR_NONE;
 
 exit_curve_sk:
-	free((void *)kp->curve.pubkey);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, (void *)kp->curve.pubkey);
 	kp->curve.pubkey = NULL;
 exit_curve_pk:
-	free((void *)kp->sign.seckey);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, (void *)kp->sign.seckey);
 	kp->sign.seckey = NULL;
 exit_sign_sk:
-	free((void *)kp->sign.pubkey);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, (void *)kp->sign.pubkey);
 	kp->sign.pubkey = NULL;
 exit_sign_pk:
 	return IOT_ERROR_MEM_ALLOC;
@@ -72,14 +73,14 @@ exit_sign_pk:
 void iot_crypto_ed25519_free_keypair(iot_crypto_ed25519_keypair_t *kp)
 {
 	if (kp->sign.pubkey)
-		free((void *)kp->sign.pubkey);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, (void *)kp->sign.pubkey);
 	if (kp->sign.seckey)
-		free((void *)kp->sign.seckey);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, (void *)kp->sign.seckey);
 
 	if (kp->curve.pubkey)
-		free((void *)kp->curve.pubkey);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, (void *)kp->curve.pubkey);
 	if (kp->curve.seckey)
-		free((void *)kp->curve.seckey);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, (void *)kp->curve.seckey);
 
 	memset((void *)kp, 0, sizeof(iot_crypto_ed25519_keypair_t));
 }
@@ -150,37 +151,89 @@ iot_error_t iot_crypto_ed25519_convert_seckey(unsigned char *ed25519_key,
 }
 
 //#if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_ED25519)
-static iot_error_t _iot_crypto_pk_ed25519_sign(iot_crypto_pk_context_t *ctx,
-                                          unsigned char *input, size_t ilen,
-                                          unsigned char *sig, size_t *slen)
+static iot_error_t _iot_crypto_pk_ed25519_check_keylen(iot_crypto_pk_info_t *info)
 {
-	int ret;
-	unsigned char skpk[crypto_sign_SECRETKEYBYTES];
-	unsigned long long sig_len;
-
-	IOT_DEBUG("input: %d@%p", ilen, input);
-	IOT_DEBUG("seckey: %d@%p", ctx->info->seckey_len, ctx->info->seckey);
-	IOT_DEBUG("pubkey: %d@%p", ctx->info->pubkey_len, ctx->info->pubkey);
-
-	if (ctx->info->seckey_len != crypto_sign_PUBLICKEYBYTES) {
+	if (info->seckey_len != crypto_sign_PUBLICKEYBYTES) {
 		IOT_ERROR("seckey len (%d) is not '%d'",
-				ctx->info->seckey_len,
+				info->seckey_len,
 				crypto_sign_PUBLICKEYBYTES);
 		return IOT_ERROR_CRYPTO_PK_INVALID_KEYLEN;
 	}
 
-	if (ctx->info->pubkey_len != crypto_sign_PUBLICKEYBYTES) {
+	if (info->pubkey_len != crypto_sign_PUBLICKEYBYTES) {
 		IOT_ERROR("pubkey len (%d) is not '%d'",
-				ctx->info->pubkey_len,
+				info->pubkey_len,
 				crypto_sign_PUBLICKEYBYTES);
 		return IOT_ERROR_CRYPTO_PK_INVALID_KEYLEN;
 	}
 
+	return IOT_ERROR_NONE;
+}
+
+/*
+ * libsodium signs with the 64 bytes secret key (seed || public key),
+ * so it is assembled once here instead of for every signature.
+ * A context without complete key data is still accepted and reports
+ * the key length error when it signs, as it did before.
+ */
+static iot_error_t _iot_crypto_pk_ed25519_init(iot_crypto_pk_context_t *ctx)
+{
+	unsigned char *skpk;
+
+	if (!ctx->info->seckey || !ctx->info->pubkey ||
+	    ctx->info->seckey_len != crypto_sign_PUBLICKEYBYTES ||
+	    ctx->info->pubkey_len != crypto_sign_PUBLICKEYBYTES)
+		return IOT_ERROR_NONE;
+
+	skpk = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, crypto_sign_SECRETKEYBYTES);
+	if (!skpk) {
+		IOT_ERROR("malloc failed for skpk");
+		return IOT_ERROR_MEM_ALLOC;
+	}
+
 	memcpy(skpk, ctx->info->seckey, crypto_sign_PUBLICKEYBYTES);
 	memcpy(skpk + crypto_sign_PUBLICKEYBYTES,
 				ctx->info->pubkey, crypto_sign_PUBLICKEYBYTES);
+	ctx->key = skpk;
+
+	return IOT_ERROR_NONE;
+}
+
+static void _iot_crypto_pk_ed25519_free(iot_crypto_pk_context_t *ctx)
+{
+	sodium_memzero(ctx->key, crypto_sign_SECRETKEYBYTES);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, ctx->key);
+	ctx->key = NULL;
+}
+
+static iot_error_t _iot_crypto_pk_ed25519_sign(iot_crypto_pk_context_t *ctx,
+                                          unsigned char *input, size_t ilen,
+                                          unsigned char *sig, size_t *slen)
+{
+	iot_error_t err;
+	int ret;
+	unsigned char buf[crypto_sign_SECRETKEYBYTES];
+	unsigned char *skpk = (unsigned char *)ctx->key;
+	unsigned long long sig_len;
+
+	IOT_DEBUG("input: %d@%p", ilen, input);
+	IOT_DEBUG("seckey: %d@%p", ctx->info->seckey_len, ctx->info->seckey);
+	IOT_DEBUG("pubkey: %d@%p", ctx->info->pubkey_len, ctx->info->pubkey);
+
+	if (!skpk) {
+		err = _iot_crypto_pk_ed25519_check_keylen(ctx->info);
+		if (err)
+			return err;
+
+		skpk = buf;
+		memcpy(skpk, ctx->info->seckey, crypto_sign_PUBLICKEYBYTES);
+		memcpy(skpk + crypto_sign_PUBLICKEYBYTES,
+					ctx->info->pubkey, crypto_sign_PUBLICKEYBYTES);
+	}
 
 	ret = crypto_sign_detached(sig, &sig_len, input, ilen, skpk);
+	if (skpk == buf)
+		sodium_memzero(buf, sizeof(buf));
 	if (ret) {
 		IOT_ERROR("crypto_sign_detached = %d", ret);
 		return IOT_ERROR_CRYPTO_PK_SIGN;
@@ -225,6 +278,8 @@ static iot_error_t _iot_crypto_pk_ed25519_verify(iot_crypto_pk_context_t *ctx,
 
 const iot_crypto_pk_funcs_t iot_crypto_pk_ed25519_funcs = {
 	.name = "ED25519",
+	.init = _iot_crypto_pk_ed25519_init,
+	.free = _iot_crypto_pk_ed25519_free,
 	.sign = _iot_crypto_pk_ed25519_sign,
 #if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_VERIFY)
 	.verify = _iot_crypto_pk_ed25519_verify,
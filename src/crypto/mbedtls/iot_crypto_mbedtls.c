@@ -22,9 +22,10 @@
 
 #include "iot_main.h"
 #include "iot_debug.h"
+#include "iot_mem.h"
+#include "iot_util.h"
 
 #include "mbedtls/sha256.h"
-#include "mbedtls/base64.h"
 #include "mbedtls/pk.h"
 #include "mbedtls/md.h"
 #include "mbedtls/ctr_drbg.h"
@@ -33,262 +34,262 @@
 #include "mbedtls/ecdh.h"
 #include "mbedtls/cipher.h"
 
-static iot_error_t _iot_crypto_url_encode(char *buf, size_t buf_len)
+#if defined(CONFIG_STDK_IOT_CORE_CRYPTO_DRBG_RESEED_INTERVAL)
+#define IOT_CRYPTO_DRBG_RESEED_INTERVAL	CONFIG_STDK_IOT_CORE_CRYPTO_DRBG_RESEED_INTERVAL
+#else
+#define IOT_CRYPTO_DRBG_RESEED_INTERVAL	10000
+#endif
+
+/*
+ * Seeding a DRBG polls the entropy source and loading a curve group
+ * allocates its parameters, so both are done once per process and
+ * shared by ECDH, signing, IV generation and TLS.
+ */
+static mbedtls_entropy_context _iot_crypto_entropy;
+static mbedtls_ctr_drbg_context _iot_crypto_drbg;
+static mbedtls_ecp_group _iot_crypto_x25519_grp;
+static bool _iot_crypto_drbg_seeded;
+static bool _iot_crypto_x25519_loaded;
+
+static iot_util_once_mutex_t _iot_crypto_mutex;
+
+/* must be called with _iot_crypto_mutex held */
+static int _iot_crypto_drbg_seed(void)
 {
-	size_t i;
+	const char *pers = "iot_crypto";
+	int ret;
 
-	if (!buf) {
-		IOT_ERROR("encode buf is null");
-		return IOT_ERROR_INVALID_ARGS;
-	}
+	if (_iot_crypto_drbg_seeded)
+		return 0;
 
-	if (!buf_len) {
-		IOT_ERROR("encode length is zero");
-		return IOT_ERROR_INVALID_ARGS;
-	}
+	mbedtls_entropy_init(&_iot_crypto_entropy);
+	mbedtls_ctr_drbg_init(&_iot_crypto_drbg);
 
-	for (i = 0; i < buf_len; i++) {
-		switch (buf[i]) {
-		case '+':
-			buf[i] = '-';
-			break;
-		case '/':
-			buf[i] = '_';
-			break;
-		default:
-			break;
-		}
+	ret = mbedtls_ctr_drbg_seed(&_iot_crypto_drbg, mbedtls_entropy_func,
+			&_iot_crypto_entropy, (const unsigned char *)pers, strlen(pers));
+	if (ret) {
+		IOT_ERROR("mbedtls_ctr_drbg_seed = -0x%04X", -ret);
+		mbedtls_ctr_drbg_free(&_iot_crypto_drbg);
+		mbedtls_entropy_free(&_iot_crypto_entropy);
+		return ret;
 	}
 
-	return IOT_ERROR_NONE;
+	mbedtls_ctr_drbg_set_reseed_interval(&_iot_crypto_drbg,
+			IOT_CRYPTO_DRBG_RESEED_INTERVAL);
+	_iot_crypto_drbg_seeded = true;
+
+	return 0;
 }
 
-static iot_error_t _iot_crypto_url_decode(char *buf, size_t buf_len)
+int iot_crypto_rng(void *p_rng, unsigned char *buf, size_t len)
 {
-	size_t i;
+	int ret;
 
-	if (!buf) {
-		IOT_ERROR("decode buf is null");
-		return IOT_ERROR_INVALID_ARGS;
+	(void)p_rng;
+
+	if (iot_util_once_mutex_lock(&_iot_crypto_mutex) != IOT_ERROR_NONE)
+		return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+
+	ret = _iot_crypto_drbg_seed();
+	if (!ret) {
+		/* ctr_drbg hands out at most MBEDTLS_CTR_DRBG_MAX_REQUEST at once */
+		while (len > 0) {
+			size_t chunk = (len > MBEDTLS_CTR_DRBG_MAX_REQUEST) ?
+					MBEDTLS_CTR_DRBG_MAX_REQUEST : len;
+
+			ret = mbedtls_ctr_drbg_random(&_iot_crypto_drbg, buf, chunk);
+			if (ret) {
+				IOT_ERROR("mbedtls_ctr_drbg_random = -0x%04X", -ret);
+				break;
+			}
+			buf += chunk;
+			len -= chunk;
+		}
 	}
+	iot_util_once_mutex_unlock(&_iot_crypto_mutex);
+
+	return ret;
+}
 
-	if (!buf_len) {
-		IOT_ERROR("decode length is zero");
+iot_error_t iot_crypto_random(unsigned char *buf, size_t len)
+{
+	if (!buf || len == 0) {
+		IOT_ERROR("invalid args");
 		return IOT_ERROR_INVALID_ARGS;
 	}
 
-	for (i = 0; i < buf_len; i++) {
-		switch (buf[i]) {
-		case '-':
-			buf[i] = '+';
-			break;
-		case '_':
-			buf[i] = '/';
-			break;
-		default:
-			break;
-		}
-	}
+	if (iot_crypto_rng(NULL, buf, len))
+		return IOT_ERROR_CRYPTO_RNG;
 
 	return IOT_ERROR_NONE;
 }
 
-iot_error_t iot_crypto_base64_encode(const unsigned char *src, size_t src_len,
-                                     unsigned char *dst, size_t dst_len,
-                                     size_t *out_len)
+/*
+ * Montgomery curves keep no precomputed table in the group, so the
+ * loaded group is only read after this and may be used concurrently.
+ */
+static mbedtls_ecp_group *_iot_crypto_x25519_group(void)
 {
+	mbedtls_ecp_group *grp = NULL;
 	int ret;
 
-	if (!src || !dst || !out_len) {
-		return IOT_ERROR_INVALID_ARGS;
-	}
-
-	IOT_DEBUG("plain : %s (%d)", src, src_len);
+	if (iot_util_once_mutex_lock(&_iot_crypto_mutex) != IOT_ERROR_NONE)
+		return NULL;
 
-	ret = mbedtls_base64_encode(dst, dst_len, out_len, src, src_len);
-	if (ret) {
-		IOT_ERROR("mbedtls_base64_encode = -0x%04X", -ret);
-		return IOT_ERROR_CRYPTO_BASE64;
+	if (!_iot_crypto_x25519_loaded) {
+		mbedtls_ecp_group_init(&_iot_crypto_x25519_grp);
+		ret = mbedtls_ecp_group_load(&_iot_crypto_x25519_grp, MBEDTLS_ECP_DP_CURVE25519);
+		if (ret) {
+			IOT_ERROR("mbedtls_ecp_group_load = -0x%04X", -ret);
+			mbedtls_ecp_group_free(&_iot_crypto_x25519_grp);
+		} else {
+			_iot_crypto_x25519_loaded = true;
+		}
 	}
+	if (_iot_crypto_x25519_loaded)
+		grp = &_iot_crypto_x25519_grp;
+	iot_util_once_mutex_unlock(&_iot_crypto_mutex);
 
-	IOT_DEBUG("base64 : %s (%d)", dst, *out_len);
-
-	return IOT_ERROR_NONE;
+	return grp;
 }
 
-iot_error_t iot_crypto_base64_decode(const unsigned char *src, size_t src_len,
-                                     unsigned char *dst, size_t dst_len,
-                                     size_t *out_len)
+/* the hash state lives in iot_crypto_sha256_ctx_t, so it has to fit */
+typedef char _iot_crypto_sha256_state_fits[
+	(sizeof(mbedtls_sha256_context) <= sizeof(((iot_crypto_sha256_ctx_t *)0)->state)) ? 1 : -1];
+
+static iot_error_t _iot_crypto_sha256_mbedtls_init(iot_crypto_sha256_ctx_t *ctx)
 {
+	mbedtls_sha256_context *sha = (mbedtls_sha256_context *)ctx->state;
 	int ret;
 
-	if (!src || !dst || !out_len) {
-		return IOT_ERROR_INVALID_ARGS;
-	}
-
-	IOT_DEBUG("base64 : %s (%d)", src, src_len);
-
-	ret = mbedtls_base64_decode(dst, dst_len, out_len, src, src_len);
+	mbedtls_sha256_init(sha);
+	ret = mbedtls_sha256_starts_ret(sha, 0);
 	if (ret) {
-		IOT_ERROR("mbedtls_base64_decode = -0x%04X", -ret);
-		return IOT_ERROR_CRYPTO_BASE64;
+		IOT_ERROR("mbedtls_sha256_starts_ret = -0x%04X", -ret);
+		mbedtls_sha256_free(sha);
+		return IOT_ERROR_CRYPTO_SHA256;
 	}
 
-	IOT_DEBUG("plain : %s (%d)", dst, *out_len);
-
 	return IOT_ERROR_NONE;
 }
 
-iot_error_t iot_crypto_base64_encode_urlsafe(const unsigned char *src, size_t src_len,
-                                             unsigned char *dst, size_t dst_len,
-                                             size_t *out_len)
+static iot_error_t _iot_crypto_sha256_mbedtls_update(iot_crypto_sha256_ctx_t *ctx,
+			const unsigned char *input, size_t ilen)
 {
 	int ret;
 
-	if (!src || !dst || !out_len) {
-		return IOT_ERROR_INVALID_ARGS;
-	}
-
-	IOT_DEBUG("plain : %s (%d)", src, src_len);
-
-	ret = mbedtls_base64_encode(dst, dst_len, out_len, src, src_len);
+	ret = mbedtls_sha256_update_ret((mbedtls_sha256_context *)ctx->state, input, ilen);
 	if (ret) {
-		IOT_ERROR("mbedtls_base64_encode = -0x%04X", -ret);
-		return IOT_ERROR_CRYPTO_BASE64_URLSAFE;
+		IOT_ERROR("mbedtls_sha256_update_ret = -0x%04X", -ret);
+		return IOT_ERROR_CRYPTO_SHA256;
 	}
 
-	IOT_DEBUG("base64 : %s (%d)", dst, *out_len);
+	return IOT_ERROR_NONE;
+}
+
+static iot_error_t _iot_crypto_sha256_mbedtls_final(iot_crypto_sha256_ctx_t *ctx,
+			unsigned char *dst)
+{
+	mbedtls_sha256_context *sha = (mbedtls_sha256_context *)ctx->state;
+	int ret;
 
-	ret = _iot_crypto_url_encode((char *)dst, *out_len);
+	ret = mbedtls_sha256_finish_ret(sha, dst);
+	mbedtls_sha256_free(sha);
 	if (ret) {
-		IOT_ERROR("_iot_crypto_url_encode = %d", ret);
-		return IOT_ERROR_CRYPTO_BASE64_URLSAFE;
+		IOT_ERROR("mbedtls_sha256_finish_ret = -0x%04X", -ret);
+		return IOT_ERROR_CRYPTO_SHA256;
 	}
 
-	IOT_DEBUG("urlsafe: %s (%d)", dst, *out_len);
-
 	return IOT_ERROR_NONE;
 }
 
-iot_error_t iot_crypto_base64_decode_urlsafe(const unsigned char *src, size_t src_len,
-                                             unsigned char *dst, size_t dst_len,
-                                             size_t *out_len)
+static void _iot_crypto_sha256_mbedtls_free(iot_crypto_sha256_ctx_t *ctx)
 {
-	int ret;
-	iot_error_t err = IOT_ERROR_NONE;
-	unsigned char *src_dup = NULL;
-	size_t pad_len;
-	int i;
-
-	if (!src || !dst || !out_len) {
-		return IOT_ERROR_INVALID_ARGS;
-	}
+	mbedtls_sha256_free((mbedtls_sha256_context *)ctx->state);
+}
 
-	IOT_DEBUG("urlsafe: %s (%d)", src, src_len);
+const iot_crypto_sha256_funcs_t iot_crypto_sha256_mbedtls_funcs = {
+	.name = "mbedtls",
+	.init = _iot_crypto_sha256_mbedtls_init,
+	.update = _iot_crypto_sha256_mbedtls_update,
+	.final = _iot_crypto_sha256_mbedtls_final,
+	.free = _iot_crypto_sha256_mbedtls_free,
+};
 
-	pad_len = IOT_CRYPTO_ALIGN_B64_LEN(src_len);
-	src_dup = (unsigned char *)malloc(pad_len + 1);
-	if (src_dup == NULL) {
-		IOT_ERROR("malloc failed for align buffer");
-		return IOT_ERROR_MEM_ALLOC;
-	}
+#if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_RSA)
+/*
+ * Parsing the PEM/DER key decodes base64 and ASN.1 and rebuilds the CRT
+ * parameters, so it is done once per context instead of per signature.
+ */
+static iot_error_t _iot_crypto_pk_rsa_init(iot_crypto_pk_context_t *ctx)
+{
+	mbedtls_pk_context *pk;
+	int ret;
 
-	memcpy(src_dup, src, src_len);
-	/* consider '=' removed from tail */
-	for (i = src_len; i < pad_len; i++) {
-		src_dup[i] = '=';
+	if (!ctx->info->seckey || ctx->info->seckey_len == 0) {
+		IOT_ERROR("seckey is empty");
+		return IOT_ERROR_CRYPTO_PK_INVALID_KEYLEN;
 	}
-	src_dup[pad_len] = '\0';
 
-	ret = _iot_crypto_url_decode((char *)src_dup, pad_len);
-	if (ret) {
-		IOT_ERROR("_iot_crypto_url_decode = %d", ret);
-		err = IOT_ERROR_CRYPTO_BASE64_URLSAFE;
-		goto exit;
+	pk = (mbedtls_pk_context *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, sizeof(mbedtls_pk_context));
+	if (!pk) {
+		IOT_ERROR("malloc failed for pk");
+		return IOT_ERROR_MEM_ALLOC;
 	}
 
-	IOT_DEBUG("base64 : %s (%d)", src_dup, pad_len);
-
-	ret = mbedtls_base64_decode(dst, dst_len, out_len,
-			(const unsigned char *)src_dup, pad_len);
+	mbedtls_pk_init(pk);
+	ret = mbedtls_pk_parse_key(pk, (const unsigned char *)ctx->info->seckey,
+					ctx->info->seckey_len + 1, NULL, 0);
 	if (ret) {
-		IOT_ERROR("mbedtls_base64_decode = -0x%04X", -ret);
-		err = IOT_ERROR_CRYPTO_BASE64_URLSAFE;
-		goto exit;
+		IOT_ERROR("mbedtls_pk_parse_key = -0x%04X\n", -ret);
+		mbedtls_pk_free(pk);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, pk);
+		return IOT_ERROR_CRYPTO_PK_PARSEKEY;
 	}
 
-	IOT_DEBUG("plain : %s (%d)", dst, *out_len);
-exit:
-	if (src_dup)
-		free(src_dup);
+	ctx->key = pk;
 
-	return err;
+	return IOT_ERROR_NONE;
 }
 
-iot_error_t iot_crypto_sha256(unsigned char *src, size_t src_len, unsigned char *dst)
+static void _iot_crypto_pk_rsa_free(iot_crypto_pk_context_t *ctx)
 {
-	int ret;
-
-	IOT_DEBUG("src: %d@%p, dst: %p", src_len, src, dst);
-
-	ret = mbedtls_sha256_ret(src, src_len, dst, 0);
-	if (ret) {
-		IOT_ERROR("mbedtls_sha256_ret = -0x%04X", -ret);
-		return IOT_ERROR_CRYPTO_SHA256;
-	}
-
-	return IOT_ERROR_NONE;
+	mbedtls_pk_free((mbedtls_pk_context *)ctx->key);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, ctx->key);
+	ctx->key = NULL;
 }
 
-#if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_RSA)
 static iot_error_t _iot_crypto_pk_rsa_sign(iot_crypto_pk_context_t *ctx,
                                           unsigned char *input, size_t ilen,
                                           unsigned char *sig, size_t *slen)
 {
 	int ret;
-	iot_error_t err = IOT_ERROR_NONE;
-	mbedtls_pk_context pk;
-	mbedtls_md_type_t md_alg;
-	unsigned char *hash = NULL;
-	size_t hash_len;
+	iot_error_t err;
+	mbedtls_pk_context *pk = (mbedtls_pk_context *)ctx->key;
+	unsigned char hash[IOT_CRYPTO_SHA256_LEN];
 
 	IOT_DEBUG("input: %d@%p, key: %d@%p", ilen, input,
 				ctx->info->seckey_len, ctx->info->seckey);
 
-	mbedtls_pk_init(&pk);
-	ret = mbedtls_pk_parse_key(&pk, (const unsigned char *)ctx->info->seckey,
-					ctx->info->seckey_len + 1, NULL, 0);
-	if (ret) {
-		IOT_ERROR("mbedtls_pk_parse_key = -0x%04X\n", -ret);
-		err = IOT_ERROR_CRYPTO_PK_PARSEKEY;
-		goto exit;
+	if (!pk) {
+		IOT_ERROR("key is not prepared");
+		return IOT_ERROR_CRYPTO_PK_INVALID_CTX;
 	}
 
-	md_alg = MBEDTLS_MD_SHA256;
-	hash_len = IOT_CRYPTO_SHA256_LEN;
-	hash = (unsigned char *)malloc(hash_len);
-
 	err = iot_crypto_sha256(input, ilen, hash);
 	if (err) {
-		goto exit;
+		return err;
 	}
 
-	ret = mbedtls_pk_sign(&pk, md_alg, hash, hash_len, sig, slen, NULL, NULL);
+	ret = mbedtls_pk_sign(pk, MBEDTLS_MD_SHA256, hash, sizeof(hash), sig, slen, iot_crypto_rng, NULL);
 	if (ret) {
 		IOT_ERROR("mbedtls_pk_sign = -0x%04X\n", -ret);
-		err = IOT_ERROR_CRYPTO_PK_SIGN;
-		goto exit;
+		return IOT_ERROR_CRYPTO_PK_SIGN;
 	}
 
 	IOT_DEBUG("sig: %d@%p", *slen, sig);
-exit:
-	mbedtls_pk_free(&pk);
-
-	if (hash) {
-		free(hash);
-	}
 
-	return err;
+	return IOT_ERROR_NONE;
 }
 
 #if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_VERIFY)
@@ -296,58 +297,42 @@ static iot_error_t _iot_crypto_pk_rsa_verify(iot_crypto_pk_context_t *ctx,
                                           unsigned char *input, size_t ilen,
                                           unsigned char *sig, size_t slen)
 {
-	iot_error_t err = IOT_ERROR_NONE;
-	mbedtls_pk_context pk;
-	mbedtls_md_type_t md_alg;
-	unsigned char *hash = NULL;
-	size_t hash_len;
+	iot_error_t err;
+	mbedtls_pk_context *pk = (mbedtls_pk_context *)ctx->key;
+	unsigned char hash[IOT_CRYPTO_SHA256_LEN];
 	int ret;
 
 	IOT_DEBUG("input: %d@%p, key: %d@%p", ilen, input,
 				ctx->info->seckey_len, ctx->info->seckey);
 
-	mbedtls_pk_init(&pk);
-
-	ret = mbedtls_pk_parse_key(&pk, (const unsigned char *)ctx->info->seckey,
-					ctx->info->seckey_len + 1, NULL, 0);
-	if (ret) {
-		IOT_ERROR("mbedtls_pk_parse_key = 0x%04X\n", ret);
-		err = IOT_ERROR_CRYPTO_PK_PARSEKEY;
-		goto exit;
+	if (!pk) {
+		IOT_ERROR("key is not prepared");
+		return IOT_ERROR_CRYPTO_PK_INVALID_CTX;
 	}
 
-	md_alg = MBEDTLS_MD_SHA256;
-	hash_len = IOT_CRYPTO_SHA256_LEN;
-	hash = (unsigned char *)malloc(hash_len);
-
 	err = iot_crypto_sha256(input, ilen, hash);
 	if (err) {
-		goto exit;
+		return err;
 	}
 
-	IOT_DEBUG("hash: %d@%p", hash_len, hash);
+	IOT_DEBUG("hash: %d@%p", sizeof(hash), hash);
 
-	ret = mbedtls_pk_verify(&pk, md_alg, hash, hash_len, sig, slen);
+	ret = mbedtls_pk_verify(pk, MBEDTLS_MD_SHA256, hash, sizeof(hash), sig, slen);
 	if (ret) {
 		IOT_ERROR("mbedtls_pk_verify = 0x%04X\n", ret);
-		err = IOT_ERROR_CRYPTO_PK_VERIFY;
-		goto exit;
+		return IOT_ERROR_CRYPTO_PK_VERIFY;
 	}
 
 	IOT_DEBUG("sign verify success");
-exit:
-	mbedtls_pk_free(&pk);
-
-	if (hash) {
-		free(hash);
-	}
 
-	return err;
+	return IOT_ERROR_NONE;
 }
 #endif
 
 const iot_crypto_pk_funcs_t iot_crypto_pk_rsa_funcs = {
 	.name = "RSA",
+	.init = _iot_crypto_pk_rsa_init,
+	.free = _iot_crypto_pk_rsa_free,
 	.sign = _iot_crypto_pk_rsa_sign,
 #if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_VERIFY)
 	.verify = _iot_crypto_pk_rsa_verify,
@@ -362,7 +347,7 @@ static unsigned char *_iot_crypto_swap_secret(const unsigned char *key, size_t l
 	unsigned char *swap;
 	int i;
 
-	swap = (unsigned char *)malloc(len);
+	swap = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, len);
 	if (swap == NULL) {
 		IOT_ERROR("malloc failed for swap");
 		return NULL;
@@ -380,31 +365,21 @@ static iot_error_t _iot_crypto_ecdh_gen_premaster_secret(
 		const unsigned char *t_seckey, const unsigned char *s_pubkey)
 {
 	iot_error_t err;
-	mbedtls_ecdh_context ecdh;
-	mbedtls_ctr_drbg_context ctr_drbg;
-	mbedtls_entropy_context entropy;
-	mbedtls_ecp_group_id ecp_grp_id = MBEDTLS_ECP_DP_CURVE25519;
-	const char *pers = "iot_crypto_ecdh";
+	mbedtls_ecp_group *grp;
+	mbedtls_mpi d;
+	mbedtls_mpi z;
+	mbedtls_ecp_point Qp;
 	size_t key_len = IOT_CRYPTO_ED25519_LEN;
 	unsigned char *swap_key = NULL;
 	unsigned char premaster_secret[IOT_CRYPTO_ED25519_LEN];
 	int ret;
 
-	mbedtls_ecdh_init(&ecdh);
-	mbedtls_ctr_drbg_init(&ctr_drbg);
-	mbedtls_entropy_init(&entropy);
+	mbedtls_mpi_init(&d);
+	mbedtls_mpi_init(&z);
+	mbedtls_ecp_point_init(&Qp);
 
-	ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
-	                            (const unsigned char *)pers, strlen(pers));
-	if (ret) {
-		IOT_ERROR("mbedtls_ctr_drbg_seed = -0x%04X", -ret);
-		err = IOT_ERROR_CRYPTO_PK_ECDH;
-		goto exit;
-	}
-
-	ret = mbedtls_ecp_group_load(&ecdh.grp, ecp_grp_id);
-	if (ret) {
-		IOT_ERROR("mbedtls_ecp_group_load = -0x%04X", -ret);
+	grp = _iot_crypto_x25519_group();
+	if (!grp) {
 		err = IOT_ERROR_CRYPTO_PK_ECDH;
 		goto exit;
 	}
@@ -416,15 +391,15 @@ static iot_error_t _iot_crypto_ecdh_gen_premaster_secret(
 		goto exit;
 	}
 
-	ret = mbedtls_mpi_read_binary(&ecdh.d, swap_key, key_len);
+	ret = mbedtls_mpi_read_binary(&d, swap_key, key_len);
 	if (ret) {
 		IOT_ERROR("mbedtls_mpi_read_binary = -0x%04X", -ret);
 		err = IOT_ERROR_CRYPTO_PK_ECDH;
-		free(swap_key);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, swap_key);
 		goto exit;
 	}
 
-	free(swap_key);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, swap_key);
 
 	swap_key = _iot_crypto_swap_secret(s_pubkey, key_len);
 	if (!swap_key) {
@@ -433,25 +408,26 @@ static iot_error_t _iot_crypto_ecdh_gen_premaster_secret(
 		goto exit;
 	}
 
-	ret = mbedtls_mpi_read_binary(&ecdh.Qp.X, swap_key, key_len);
+	ret = mbedtls_mpi_read_binary(&Qp.X, swap_key, key_len);
 	if (ret) {
 		IOT_ERROR("mbedtls_mpi_read_binary = -0x%04X", -ret);
 		err = IOT_ERROR_CRYPTO_PK_ECDH;
-		free(swap_key);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, swap_key);
 		goto exit;
 	}
 
-	free(swap_key);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, swap_key);
 
-	ret = mbedtls_mpi_lset(&ecdh.Qp.Z, 1);
+	ret = mbedtls_mpi_lset(&Qp.Z, 1);
 	if (ret) {
 		IOT_ERROR("mbedtls_mpi_lset = -0x%04X", -ret);
 		err = IOT_ERROR_CRYPTO_PK_ECDH;
 		goto exit;
 	}
 
-	ret = mbedtls_ecdh_compute_shared(&ecdh.grp, &ecdh.z,
-		    &ecdh.Qp, &ecdh.d, mbedtls_ctr_drbg_random, &ctr_drbg);
+	/* the group is shared read-only, the blinding draws from the shared DRBG */
+	ret = mbedtls_ecdh_compute_shared(grp, &z,
+		    &Qp, &d, iot_crypto_rng, NULL);
 	if (ret) {
 		IOT_ERROR("mbedtls_ecdh_compute_shared = -0x%04X", -ret);
 		err = IOT_ERROR_CRYPTO_PK_ECDH;
@@ -460,7 +436,7 @@ static iot_error_t _iot_crypto_ecdh_gen_premaster_secret(
 
 	key_len = sizeof(premaster_secret);
 
-	ret = mbedtls_mpi_write_binary(&ecdh.z, premaster_secret, key_len);
+	ret = mbedtls_mpi_write_binary(&z, premaster_secret, key_len);
 	if (ret) {
 		IOT_ERROR("mbedtls_mpi_write_binary = -0x%04X", -ret);
 		err = IOT_ERROR_CRYPTO_PK_ECDH;
@@ -480,9 +456,9 @@ static iot_error_t _iot_crypto_ecdh_gen_premaster_secret(
 	goto exit;
 
 exit:
-	mbedtls_ecdh_free(&ecdh);
-	mbedtls_ctr_drbg_free(&ctr_drbg);
-	mbedtls_entropy_free(&entropy);
+	mbedtls_mpi_free(&d);
+	mbedtls_mpi_free(&z);
+	mbedtls_ecp_point_free(&Qp);
 
 	return err;
 }
@@ -491,10 +467,9 @@ iot_error_t iot_crypto_ecdh_gen_master_secret(unsigned char *master,
 			size_t mlen, iot_crypto_ecdh_params_t *params)
 {
 	iot_error_t err;
+	iot_crypto_sha256_ctx_t sha;
 	unsigned char *pmsecret = NULL;
-	unsigned char *buf = NULL;
 	size_t pmslen;
-	size_t buf_len;
 
 	if (!master) {
 		IOT_ERROR("master buffer is null");
@@ -518,27 +493,24 @@ iot_error_t iot_crypto_ecdh_gen_master_secret(unsigned char *master,
 		goto exit;
 	}
 
-	buf_len = pmslen + params->hash_token_len;
-	buf = (unsigned char *)malloc(buf_len);
-	if (!buf) {
-		IOT_ERROR("malloc failed for master secret");
-		err = IOT_ERROR_MEM_ALLOC;
+	/* master = sha256(premaster secret + hash token) */
+	err = iot_crypto_sha256_init(&sha);
+	if (err) {
 		goto exit;
 	}
 
-	memcpy(buf, pmsecret, pmslen);
-	memcpy(buf + pmslen, params->hash_token, params->hash_token_len);
-
-	err = iot_crypto_sha256(buf, buf_len, master);
+	err = iot_crypto_sha256_update(&sha, pmsecret, pmslen);
+	if (!err)
+		err = iot_crypto_sha256_update(&sha, params->hash_token, params->hash_token_len);
 	if (err) {
+		iot_crypto_sha256_free(&sha);
 		goto exit;
 	}
+
+	err = iot_crypto_sha256_final(&sha, master);
 exit:
 	if (pmsecret)
-		free(pmsecret);
-
-	if (buf)
-		free(buf);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, pmsecret);
 
 	return err;
 }
@@ -547,10 +519,8 @@ size_t iot_crypto_cipher_get_align_size(iot_crypto_cipher_type_t type,
 			size_t size)
 {
 	const mbedtls_cipher_info_t *cipher_info;
-	mbedtls_cipher_context_t cipher_ctx;
 	mbedtls_cipher_type_t cipher_alg;
 	unsigned int block_size;
-	int ret;
 
 	if (!size) {
 		IOT_ERROR("input size is zero");
@@ -564,27 +534,17 @@ size_t iot_crypto_cipher_get_align_size(iot_crypto_cipher_type_t type,
 		return 0;
 	}
 
+	/* block size is static cipher info, no context has to be set up */
 	cipher_info = mbedtls_cipher_info_from_type(cipher_alg);
 	if (!cipher_info) {
 		IOT_ERROR("mbedtls_cipher_info_from_type returned null");
 		return 0;
 	}
 
-	mbedtls_cipher_init(&cipher_ctx);
-
-	ret = mbedtls_cipher_setup(&cipher_ctx, cipher_info);
-	if (ret) {
-		IOT_ERROR("mbedtls_cipher_setup = -0x%04X", -ret);
-		mbedtls_cipher_free(&cipher_ctx);
-		return 0;
-	}
-
-	block_size = mbedtls_cipher_get_block_size(&cipher_ctx);
+	block_size = cipher_info->block_size;
 
 	size = size + (block_size - (size % block_size));
 
-	mbedtls_cipher_free(&cipher_ctx);
-
 	return size;
 }
 
@@ -694,3 +654,247 @@ exit:
 
 	return err;
 }
+
+struct _iot_crypto_cipher_state {
+	mbedtls_cipher_context_t enc;
+	mbedtls_cipher_context_t dec;
+	mbedtls_cipher_context_t *cur;
+	/* bytes of the current message held back by mbedtls */
+	size_t pending;
+};
+
+static iot_error_t _iot_crypto_cipher_setup(mbedtls_cipher_context_t *cipher_ctx,
+			const mbedtls_cipher_info_t *cipher_info,
+			const unsigned char *key, mbedtls_operation_t mode)
+{
+	int ret;
+
+	ret = mbedtls_cipher_setup(cipher_ctx, cipher_info);
+	if (ret) {
+		IOT_ERROR("mbedtls_cipher_setup = -0x%04X", -ret);
+		return IOT_ERROR_CRYPTO_CIPHER;
+	}
+
+	ret = mbedtls_cipher_setkey(cipher_ctx, key, cipher_info->key_bitlen, mode);
+	if (ret) {
+		IOT_ERROR("mbedtls_cipher_setkey = -0x%04X", -ret);
+		return IOT_ERROR_CRYPTO_CIPHER;
+	}
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_crypto_cipher_init(iot_crypto_cipher_ctx_t *ctx,
+			iot_crypto_cipher_info_t *info)
+{
+	iot_error_t err;
+	const mbedtls_cipher_info_t *cipher_info;
+	struct _iot_crypto_cipher_state *state;
+
+	if (!ctx || !info || !info->key) {
+		IOT_ERROR("invalid args");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	if (info->type != IOT_CRYPTO_CIPHER_AES256) {
+		IOT_ERROR("'%d' is not a supported cipher algorithm", info->type);
+		return IOT_ERROR_CRYPTO_CIPHER_UNKNOWN_TYPE;
+	}
+
+	if (info->key_len != IOT_CRYPTO_SECRET_LEN) {
+		IOT_ERROR("key length '%d' is wrong", info->key_len);
+		return IOT_ERROR_CRYPTO_CIPHER_KEYLEN;
+	}
+
+	cipher_info = mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_256_CBC);
+	if (!cipher_info) {
+		IOT_ERROR("mbedtls_cipher_info_from_type returned null");
+		return IOT_ERROR_CRYPTO_CIPHER_UNKNOWN_TYPE;
+	}
+
+	state = (struct _iot_crypto_cipher_state *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, sizeof(*state));
+	if (!state) {
+		IOT_ERROR("malloc failed for cipher state");
+		return IOT_ERROR_MEM_ALLOC;
+	}
+	memset(state, 0, sizeof(*state));
+
+	mbedtls_cipher_init(&state->enc);
+	mbedtls_cipher_init(&state->dec);
+
+	err = _iot_crypto_cipher_setup(&state->enc, cipher_info, info->key, MBEDTLS_ENCRYPT);
+	if (err)
+		goto exit;
+
+	err = _iot_crypto_cipher_setup(&state->dec, cipher_info, info->key, MBEDTLS_DECRYPT);
+	if (err)
+		goto exit;
+
+	ctx->type = info->type;
+	ctx->state = state;
+
+	return IOT_ERROR_NONE;
+exit:
+	mbedtls_cipher_free(&state->enc);
+	mbedtls_cipher_free(&state->dec);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, state);
+
+	return err;
+}
+
+iot_error_t iot_crypto_cipher_start(iot_crypto_cipher_ctx_t *ctx,
+			iot_crypto_cipher_mode_t mode,
+			const unsigned char *iv, size_t iv_len)
+{
+	struct _iot_crypto_cipher_state *state;
+	mbedtls_cipher_context_t *cipher_ctx;
+	int ret;
+
+	if (!ctx || !iv) {
+		IOT_ERROR("invalid args");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	state = (struct _iot_crypto_cipher_state *)ctx->state;
+	if (!state) {
+		IOT_ERROR("cipher session is not initialized");
+		return IOT_ERROR_CRYPTO_CIPHER_INVALID_CTX;
+	}
+
+	if (mode == IOT_CRYPTO_CIPHER_ENCRYPT) {
+		cipher_ctx = &state->enc;
+	} else if (mode == IOT_CRYPTO_CIPHER_DECRYPT) {
+		cipher_ctx = &state->dec;
+	} else {
+		IOT_ERROR("'%d' is invalid cipher mode", mode);
+		return IOT_ERROR_CRYPTO_CIPHER_UNKNOWN_MODE;
+	}
+
+	if (iv_len != IOT_CRYPTO_IV_LEN) {
+		IOT_ERROR("iv length '%d' is wrong", iv_len);
+		return IOT_ERROR_CRYPTO_CIPHER_IVLEN;
+	}
+
+	state->cur = NULL;
+
+	ret = mbedtls_cipher_set_iv(cipher_ctx, iv, iv_len);
+	if (ret) {
+		IOT_ERROR("mbedtls_cipher_set_iv = -0x%04X", -ret);
+		return IOT_ERROR_CRYPTO_CIPHER;
+	}
+
+	ret = mbedtls_cipher_reset(cipher_ctx);
+	if (ret) {
+		IOT_ERROR("mbedtls_cipher_reset = -0x%04X", -ret);
+		return IOT_ERROR_CRYPTO_CIPHER;
+	}
+
+	state->cur = cipher_ctx;
+	state->pending = 0;
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_crypto_cipher_update(iot_crypto_cipher_ctx_t *ctx,
+			const unsigned char *input, size_t ilen,
+			unsigned char *out, size_t *olen, size_t osize)
+{
+	struct _iot_crypto_cipher_state *state;
+	size_t block_size;
+	size_t total;
+	size_t keep;
+	int ret;
+
+	if (!ctx || !input || !out || !olen) {
+		IOT_ERROR("invalid args");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	state = (struct _iot_crypto_cipher_state *)ctx->state;
+	if (!state || !state->cur) {
+		IOT_ERROR("cipher session is not started");
+		return IOT_ERROR_CRYPTO_CIPHER_INVALID_CTX;
+	}
+
+	if (!ilen) {
+		*olen = 0;
+		return IOT_ERROR_NONE;
+	}
+
+	/*
+	 * mbedtls writes whole blocks only and doesn't take the output size,
+	 * so work out what it will write. Decryption holds back the last
+	 * whole block too, finish has to strip its padding.
+	 */
+	block_size = mbedtls_cipher_get_block_size(state->cur);
+	total = state->pending + ilen;
+	if (state->cur == &state->dec)
+		keep = ((total - 1) % block_size) + 1;
+	else
+		keep = total % block_size;
+
+	if (osize < total - keep) {
+		IOT_ERROR("output buffer size is not sufficient");
+		return IOT_ERROR_CRYPTO_CIPHER_OUTSIZE;
+	}
+
+	ret = mbedtls_cipher_update(state->cur, input, ilen, out, olen);
+	if (ret) {
+		IOT_ERROR("mbedtls_cipher_update = -0x%04X", -ret);
+		state->cur = NULL;
+		return IOT_ERROR_CRYPTO_CIPHER;
+	}
+
+	state->pending = keep;
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_crypto_cipher_finish(iot_crypto_cipher_ctx_t *ctx,
+			unsigned char *out, size_t *olen, size_t osize)
+{
+	struct _iot_crypto_cipher_state *state;
+	int ret;
+
+	if (!ctx || !out || !olen) {
+		IOT_ERROR("invalid args");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	state = (struct _iot_crypto_cipher_state *)ctx->state;
+	if (!state || !state->cur) {
+		IOT_ERROR("cipher session is not started");
+		return IOT_ERROR_CRYPTO_CIPHER_INVALID_CTX;
+	}
+
+	if (osize < mbedtls_cipher_get_block_size(state->cur)) {
+		IOT_ERROR("output buffer size is not sufficient");
+		return IOT_ERROR_CRYPTO_CIPHER_OUTSIZE;
+	}
+
+	ret = mbedtls_cipher_finish(state->cur, out, olen);
+	state->cur = NULL;
+	state->pending = 0;
+	if (ret) {
+		IOT_ERROR("mbedtls_cipher_finish = -0x%04X", -ret);
+		return IOT_ERROR_CRYPTO_CIPHER;
+	}
+
+	return IOT_ERROR_NONE;
+}
+
+void iot_crypto_cipher_free(iot_crypto_cipher_ctx_t *ctx)
+{
+	struct _iot_crypto_cipher_state *state;
+
+	if (!ctx || !ctx->state)
+		return;
+
+	state = (struct _iot_crypto_cipher_state *)ctx->state;
+	/* drops the expanded key schedules too */
+	mbedtls_cipher_free(&state->enc);
+	mbedtls_cipher_free(&state->dec);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, state);
+
+	memset(ctx, 0, sizeof(iot_crypto_cipher_ctx_t));
+}
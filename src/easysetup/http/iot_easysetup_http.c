@@ -22,6 +22,7 @@
 #include "iot_main.h"
 #include "iot_internal.h"
 #include "iot_debug.h"
+#include "iot_mem.h"
 #include "iot_easysetup.h"
 #include "iot_bsp_wifi.h"
 
@@ -35,12 +36,13 @@ static struct iot_context *context;
 static const char http_status_200[] = "HTTP/1.1 200 OK";
 static const char http_status_400[] = "HTTP/1.1 400 Bad Request";
 static const char http_status_500[] = "HTTP/1.1 500 Internal Server Error";
-static const char http_header[] = "\r\nServer: SmartThings Device SDK\r\nConnection: close\r\nContent-Type: application/json\r\nContent-Length: ";
+static const char http_header[] = "\r\nServer: SmartThings Device SDK\r\nContent-Type: application/json\r\nContent-Length: ";
 
 #define MAX_PAYLOAD_LENGTH	1024
 #define ARRAY_SIZE(x) (int)(sizeof(x)/sizeof(x[0]))
 
 static int ref_step;
+static volatile bool es_http_cancel;
 #if defined(CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_LOG_SUPPORT)
 static bool dump_enable;
 static char *log_buffer;
@@ -83,6 +85,30 @@ char *iot_debug_get_log(void)
 }
 #endif
 
+/*
+ * Waits for the iot main task to answer a request. Returns NULL when
+ * easysetup is stopped meanwhile, the main task which should answer is
+ * then the one waiting for this handler to finish.
+ */
+static struct iot_easysetup_payload *_iot_easysetup_wait_response(struct iot_context *ctx)
+{
+	struct iot_easysetup_payload *response = NULL;
+	unsigned int curr_event;
+
+	while (!es_http_cancel) {
+		curr_event = iot_os_eventgroup_wait_bits(ctx->iot_events,
+				IOT_EVENT_BIT_EASYSETUP_RESP, true, false, IOT_OS_MAX_DELAY);
+		if (!(curr_event & IOT_EVENT_BIT_EASYSETUP_RESP) || es_http_cancel)
+			continue;
+
+		if (iot_os_queue_receive(ctx->easysetup_resp_queue, (void **)&response, 0) == IOT_OS_TRUE)
+			break;
+		response = NULL;
+	}
+
+	return response;
+}
+
 /**
  * @brief	http GET method payload handler
  * @details	This function handle GET method cgi request
@@ -137,18 +163,20 @@ iot_error_t _iot_easysetup_gen_get_payload(struct iot_context *ctx, const char *
 		err = IOT_ERROR_EASYSETUP_INTERNAL_SERVER_ERROR;
 		goto get_exit;
 	}
-	osDelay(300);
+	iot_os_delay(300);
 	IOT_INFO("waiting.. response for [%s]", cmd);
-	iot_os_eventgroup_wait_bits(ctx->iot_events,
-			IOT_EVENT_BIT_EASYSETUP_RESP, true, false, IOT_OS_MAX_DELAY);
-	IOT_INFO("after iot_os_eventgroup_wait_bits");
-	err = iot_os_queue_receive(ctx->easysetup_resp_queue, &response, 0);
+	response = _iot_easysetup_wait_response(ctx);
+	if (!response) {
+		IOT_WARN("easysetup is stopped while waiting [%s]", cmd);
+		err = IOT_ERROR_EASYSETUP_INTERNAL_SERVER_ERROR;
+		goto get_exit;
+	}
 	IOT_INFO("after iot_os_queue_receive");
 
 	if (response->step != cur_step) {
 		IOT_ERROR("unexpected response %d:%d", cur_step, response->step);
 		if (response->payload)
-			free(response->payload);
+			cJSON_free(response->payload);
 		err = IOT_ERROR_EASYSETUP_INTERNAL_SERVER_ERROR;
 	} else {
 	        IOT_INFO("ELSE----");
@@ -158,6 +186,7 @@ iot_error_t _iot_easysetup_gen_get_payload(struct iot_context *ctx, const char *
 		}
 		err = response->err;
 	}
+	iot_mem_free(IOT_MEM_TAG_EASYSETUP, response);
 
 fail_status_update:
 	if (err) {
@@ -189,7 +218,6 @@ iot_error_t _iot_easysetup_gen_post_payload(struct iot_context *ctx, const char
 	iot_error_t err = IOT_ERROR_NONE;
 	struct iot_easysetup_payload *response;
 	int cur_step;
-	unsigned int curr_event;
 
 	if (!in_payload)
 		return IOT_ERROR_EASYSETUP_INVALID_REQUEST;
@@ -238,20 +266,17 @@ iot_error_t _iot_easysetup_gen_post_payload(struct iot_context *ctx, const char
 	}
 	IOT_INFO("waiting.. response for [%s]", cmd);
 
-	for( ; ; ) {
-		curr_event = iot_os_eventgroup_wait_bits(ctx->iot_events,
-				IOT_EVENT_BIT_EASYSETUP_RESP, true, false, IOT_OS_MAX_DELAY);
-		if (curr_event & IOT_EVENT_BIT_EASYSETUP_RESP)
-			break;
+	response = _iot_easysetup_wait_response(ctx);
+	if (!response) {
+		IOT_WARN("easysetup is stopped while waiting [%s]", cmd);
+		err = IOT_ERROR_EASYSETUP_INTERNAL_SERVER_ERROR;
+		goto post_exit;
 	}
 
-	IOT_INFO("iot_os_queue_receive for easysetup_resp_queue");
-	err = iot_os_queue_receive(ctx->easysetup_resp_queue, &response, 0);
-
 	if (response->step != cur_step) {
 		IOT_ERROR("unexpected response %d:%d", cur_step, response->step);
 		if (response->payload)
-			free(response->payload);
+			cJSON_free(response->payload);
 		err = IOT_ERROR_EASYSETUP_INTERNAL_SERVER_ERROR;
 	} else {
 		if (!response->err) {
@@ -260,6 +285,7 @@ iot_error_t _iot_easysetup_gen_post_payload(struct iot_context *ctx, const char
 		}
 		err = response->err;
 	}
+	iot_mem_free(IOT_MEM_TAG_EASYSETUP, response);
 
 	if (err) {
 		iot_error_t err1;
@@ -311,7 +337,7 @@ static void http_msg_handler(const char* uri, char **buffer, enum cgi_type type,
 			err = _iot_easysetup_gen_post_payload(context, uri, data_buf, &payload);
 			if (!err) {
 				buffer_len = strlen(payload) + strlen(http_status_200) + strlen(http_header) + 9;
-				buf = malloc(buffer_len);
+				buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, buffer_len);
 				if (!buf) {
 					IOT_ERROR("failed to malloc buffer for the post msg");
 					goto cgi_out;
@@ -328,7 +354,7 @@ static void http_msg_handler(const char* uri, char **buffer, enum cgi_type type,
 		err = _iot_easysetup_gen_get_payload(context, uri, &payload);
 		if (!err) {
 			buffer_len = strlen(payload) + strlen(http_status_200) + strlen(http_header) + 9;
-			buf = malloc(buffer_len);
+			buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, buffer_len);
 			if (!buf) {
 				IOT_ERROR("failed to malloc buffer for the get msg");
 				goto cgi_out;
@@ -366,7 +392,7 @@ static void http_msg_handler(const char* uri, char **buffer, enum cgi_type type,
 		IOT_DEBUG("%s", ptr);
 
 		buffer_len = strlen(ptr) + strlen(http_status_500) + strlen(http_header) + 9;
-		buf = malloc(buffer_len);
+		buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, buffer_len);
 		if (!buf) {
 			IOT_ERROR("failed to malloc buffer for the error msg");
 			goto cgi_out;
@@ -386,9 +412,9 @@ cgi_out:
 	if (root)
 		cJSON_Delete(root);
 	if (payload)
-		free(payload);
+		cJSON_free(payload);
 	if (ptr)
-		free(ptr);
+		cJSON_free(ptr);
 }
 
 void http_packet_handle(const char *name, char **buf, char *payload, enum cgi_type type)
@@ -428,11 +454,24 @@ iot_error_t iot_easysetup_init(struct iot_context *ctx)
 
 	context = ctx;
 
+	/* wake-up or answer left from the previous stop isn't for new requests */
+	es_http_cancel = false;
+	iot_os_eventgroup_clear_bits(ctx->iot_events, IOT_EVENT_BIT_EASYSETUP_RESP);
+	if (ctx->easysetup_resp_queue) {
+		struct iot_easysetup_payload *stale;
+
+		while (iot_os_queue_receive(ctx->easysetup_resp_queue, (void **)&stale, 0) == IOT_OS_TRUE) {
+			if (stale->payload)
+				cJSON_free(stale->payload);
+			iot_mem_free(IOT_MEM_TAG_EASYSETUP, stale);
+		}
+	}
+
 	es_tcp_init();
 	ref_step = 0;
 
 #if defined(CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_LOG_SUPPORT)
-	if ((log_buffer = (char *)malloc(CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_LOG_SIZE)) == NULL) {
+	if ((log_buffer = (char *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_LOG_SIZE)) == NULL) {
 		IOT_ERROR("failed to malloc for log buffer");
 		return IOT_ERROR_MEM_ALLOC;
 		}
@@ -451,22 +490,29 @@ void iot_easysetup_deinit(struct iot_context *ctx)
 	if (!ctx)
 		return;
 
+	/* A handler may wait for this task to answer, release it first.
+	 * The bit stays set for one which is just about to wait.
+	 */
+	es_http_cancel = true;
+	iot_os_eventgroup_set_bits(ctx->iot_events, IOT_EVENT_BIT_EASYSETUP_RESP);
 	es_tcp_deinit();
 
 	if (ctx->es_crypto_cipher_info->iv) {
-		free(ctx->es_crypto_cipher_info->iv);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, ctx->es_crypto_cipher_info->iv);
 		ctx->es_crypto_cipher_info->iv = NULL;
 	}
 
 	if (ctx->es_crypto_cipher_info->key) {
-		free(ctx->es_crypto_cipher_info->key);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, ctx->es_crypto_cipher_info->key);
 		ctx->es_crypto_cipher_info->key = NULL;
 	}
 
+	iot_crypto_cipher_free(&ctx->es_crypto_cipher_ctx);
+
 #if defined(CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_LOG_SUPPORT)
 	if (log_buffer) {
 		dump_enable = false;
-		free(log_buffer);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, log_buffer);
 		log_buffer = NULL;
 	}
 #endif
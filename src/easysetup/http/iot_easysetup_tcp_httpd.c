@@ -28,157 +28,597 @@
  ******************************************************************/
 
 #include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <errno.h>
 #if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#include <sys/select.h>
 #include <netinet/in.h>
 #include <unistd.h>
 #endif
 #include "es_tcp_httpd.h"
 #include "iot_os_util.h"
+#include "iot_mem.h"
 #include "iot_debug.h"
 #include "iot_easysetup.h"
 
 #define PORT 8888
+/* request line and headers have to fit in, bodies are received apart */
 #define RX_BUFFER_MAX    1024
 
-typedef struct { char *name, *value; } header_t;
+#if defined(CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_MAX_CONN)
+#define ES_HTTP_MAX_CONN	CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_MAX_CONN
+#else
+#define ES_HTTP_MAX_CONN	3
+#endif
 
-static header_t reqhdr[17] = {{"\0", "\0"}};
-static char *tx_buffer = NULL;
+#if defined(CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_MAX_BODY)
+#define ES_HTTP_MAX_BODY	CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_MAX_BODY
+#else
+#define ES_HTTP_MAX_BODY	4096
+#endif
 
-// Client request
-char *method, // "GET" or "POST"
-	*uri,     // "/index.html" things before '?'
-	*qs,      // "a=1&b=2"     things after  '?'
-	*prot;    // "HTTP/1.1"
+#define ES_HTTP_IDLE_TIMEOUT_MS	(30 * 1000)
+#define ES_HTTP_SEND_TIMEOUT_MS	(5 * 1000)
+#define ES_HTTP_TICK_MS		1000
 
-static void es_tcp_task(void *pvParameters)
+#if defined(MSG_NOSIGNAL)
+#define ES_HTTP_SEND_FLAGS	MSG_NOSIGNAL
+#else
+#define ES_HTTP_SEND_FLAGS	0
+#endif
+
+enum es_http_state {
+	ES_HTTP_STATE_HEADER = 0,
+	ES_HTTP_STATE_BODY,
+};
+
+struct es_http_conn {
+	int sock;
+	enum es_http_state state;
+	char *rx_buffer;	/* request line and headers, may hold pipelined bytes */
+	size_t rx_len;
+	size_t scan_pos;	/* where to resume looking for the end of headers */
+	size_t req_len;		/* bytes of rx_buffer owned by the current request */
+	enum cgi_type type;
+	char *uri;			/* points into rx_buffer */
+	char *body;
+	size_t content_len;
+	size_t body_len;
+	bool keep_alive;
+	iot_os_timer idle_timer;
+};
+
+static const char es_http_conn_close[] = "\r\nConnection: close";
+
+static struct es_http_conn es_conn[ES_HTTP_MAX_CONN];
+static int es_listen_sock = -1;
+static volatile bool es_tcp_stop;
+static volatile bool es_tcp_running;
+
+static bool _es_http_token_eq(const char *str, size_t len, const char *token)
 {
-	char *payload = NULL;
-	char rx_buffer[RX_BUFFER_MAX];
-	int addr_family, ip_protocol, listen_sock, sock, err, len;
-	struct sockaddr_in sourceAddr;
-	uint addrLen;
+	size_t i;
 
-	while (1) {
-		struct sockaddr_in destAddr;
-		destAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-		destAddr.sin_family = AF_INET;
-		destAddr.sin_port = htons(PORT);
-		addr_family = AF_INET;
-		ip_protocol = IPPROTO_IP;
-
-		listen_sock = socket(addr_family, SOCK_STREAM, ip_protocol);
-		if (listen_sock < 0) {
-			IOT_ERROR("Unable to create socket: errno %d", errno);
-			break;
+	for (i = 0; i < len; i++) {
+		if (!token[i] || tolower((unsigned char)str[i]) != token[i])
+			return false;
+	}
+
+	return (token[len] == '\0');
+}
+
+static char *_es_http_find_eol(char *str, char *end)
+{
+	for (; str + 1 < end; str++) {
+		if (str[0] == '\r' && str[1] == '\n')
+			return str;
+	}
+
+	return NULL;
+}
+
+static bool _es_http_find_header_end(struct es_http_conn *conn)
+{
+	size_t i;
+
+	for (i = conn->scan_pos; i + 4 <= conn->rx_len; i++) {
+		if (!memcmp(conn->rx_buffer + i, "\r\n\r\n", 4)) {
+			conn->req_len = i + 4;
+			return true;
 		}
+	}
+	conn->scan_pos = (conn->rx_len > 3) ? conn->rx_len - 3 : 0;
 
-		err = bind(listen_sock, (struct sockaddr *)&destAddr, sizeof(destAddr));
-		if (err != 0) {
-			IOT_ERROR("Socket unable to bind: errno %d", errno);
-			break;
+	return false;
+}
+
+static bool _es_http_parse_content_length(const char *value, size_t len, size_t *content_len)
+{
+	size_t i, num = 0;
+
+	if (len == 0)
+		return false;
+
+	for (i = 0; i < len; i++) {
+		if (value[i] < '0' || value[i] > '9')
+			return false;
+		num = num * 10 + (value[i] - '0');
+		if (num > ES_HTTP_MAX_BODY) {
+			IOT_ERROR("request body is too large");
+			return false;
 		}
+	}
+	*content_len = num;
+
+	return true;
+}
+
+static void _es_http_parse_connection(const char *value, size_t len, bool *keep_alive)
+{
+	size_t start = 0, end, i;
+
+	for (i = 0; i <= len; i++) {
+		if (i < len && value[i] != ',')
+			continue;
+
+		end = i;
+		while (start < end && (value[start] == ' ' || value[start] == '\t'))
+			start++;
+		while (end > start && (value[end - 1] == ' ' || value[end - 1] == '\t'))
+			end--;
+
+		if (_es_http_token_eq(value + start, end - start, "close"))
+			*keep_alive = false;
+		else if (_es_http_token_eq(value + start, end - start, "keep-alive"))
+			*keep_alive = true;
+		start = i + 1;
+	}
+}
 
-		err = listen(listen_sock, 1);
-		if (err != 0) {
-			IOT_ERROR("Error occurred during listen: errno %d", errno);
+/*
+ * Parses rx_buffer[0, req_len) in place. Returns false when the request
+ * can't be framed, the connection isn't usable after that.
+ */
+static bool _es_http_parse_header(struct es_http_conn *conn)
+{
+	char *end = conn->rx_buffer + conn->req_len - 2;
+	char *line = conn->rx_buffer;
+	char *eol, *target, *version, *colon, *value, *value_end, *qs;
+	size_t method_len, version_len, content_len;
+	bool has_content_len = false;
+
+	conn->type = ERROR;
+	conn->uri = NULL;
+	conn->content_len = 0;
+	conn->keep_alive = false;
+
+	/* request-line = method SP request-target SP HTTP-version */
+	eol = _es_http_find_eol(line, end + 2);
+	target = memchr(line, ' ', eol - line);
+	if (!target || target == line)
+		return false;
+	method_len = target - line;
+	*target++ = '\0';
+
+	version = memchr(target, ' ', eol - target);
+	if (!version || version == target)
+		return false;
+	*version++ = '\0';
+	version_len = eol - version;
+	*eol = '\0';
+
+	if (version_len == 8 && !memcmp(version, "HTTP/1.1", 8))
+		conn->keep_alive = true;
+	else if (version_len != 8 || memcmp(version, "HTTP/1.0", 8))
+		return false;
+
+	qs = strchr(target, '?');
+	if (qs)
+		*qs = '\0';
+	conn->uri = target;
+
+	if (method_len == 3 && !memcmp(line, "GET", 3))
+		conn->type = GET;
+	else if (method_len == 4 && !memcmp(line, "POST", 4))
+		conn->type = POST;
+	else
+		IOT_ERROR("not support method %s", line);
+
+	for (line = eol + 2; line < end; line = eol + 2) {
+		eol = _es_http_find_eol(line, end + 2);
+
+		/* obsolete line folding isn't accepted */
+		if (*line == ' ' || *line == '\t')
+			return false;
+
+		colon = memchr(line, ':', eol - line);
+		if (!colon || colon == line)
+			return false;
+
+		value = colon + 1;
+		value_end = eol;
+		while (value < value_end && (*value == ' ' || *value == '\t'))
+			value++;
+		while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+			value_end--;
+
+		if (_es_http_token_eq(line, colon - line, "content-length")) {
+			if (!_es_http_parse_content_length(value, value_end - value, &content_len))
+				return false;
+			if (has_content_len && content_len != conn->content_len)
+				return false;
+			conn->content_len = content_len;
+			has_content_len = true;
+		} else if (_es_http_token_eq(line, colon - line, "transfer-encoding")) {
+			IOT_ERROR("transfer-encoding isn't supported");
+			return false;
+		} else if (_es_http_token_eq(line, colon - line, "connection")) {
+			_es_http_parse_connection(value, value_end - value, &conn->keep_alive);
+		}
+	}
+
+	return true;
+}
+
+/* "Connection: close" goes right after the status line */
+static char *_es_http_add_conn_close(char *tx_buffer, size_t *len)
+{
+	char *status_end, *reply;
+	size_t head, hdr_len = sizeof(es_http_conn_close) - 1;
+
+	status_end = strstr(tx_buffer, "\r\n");
+	if (!status_end)
+		return tx_buffer;
+
+	reply = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, *len + hdr_len + 1);
+	if (!reply) {
+		IOT_WARN("no memory to add connection header");
+		return tx_buffer;
+	}
+
+	head = status_end - tx_buffer;
+	memcpy(reply, tx_buffer, head);
+	memcpy(reply + head, es_http_conn_close, hdr_len);
+	memcpy(reply + head + hdr_len, status_end, *len - head + 1);
+	*len += hdr_len;
+	iot_mem_free(IOT_MEM_TAG_EASYSETUP, tx_buffer);
+
+	return reply;
+}
+
+static int _es_http_reply(struct es_http_conn *conn, const char *uri, char *payload, enum cgi_type type, bool close)
+{
+	char *tx_buffer = NULL;
+	size_t len, sent = 0;
+	int ret;
+
+	http_packet_handle(uri, &tx_buffer, payload, type);
+	if (!tx_buffer) {
+		IOT_ERROR("tx_buffer is NULL");
+		return -1;
+	}
+
+	/* easysetup is being stopped, the answer is for nobody */
+	if (es_tcp_stop) {
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, tx_buffer);
+		return -1;
+	}
+
+	len = strlen(tx_buffer);
+	if (close)
+		tx_buffer = _es_http_add_conn_close(tx_buffer, &len);
+
+	while (sent < len) {
+		ret = send(conn->sock, tx_buffer + sent, len - sent, ES_HTTP_SEND_FLAGS);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			IOT_ERROR("Error occured during sending: errno %d", errno);
 			break;
 		}
+		sent += ret;
+	}
+	iot_mem_free(IOT_MEM_TAG_EASYSETUP, tx_buffer);
 
-		while (1) {
-			addrLen = sizeof(sourceAddr);
+	return (sent == len) ? 0 : -1;
+}
 
-			sock = accept(listen_sock, (struct sockaddr *)&sourceAddr, &addrLen);
-			if (sock < 0) {
-				IOT_ERROR("Unable to accept connection: errno %d", errno);
-				break;
-			}
+static void _es_http_next_request(struct es_http_conn *conn)
+{
+	size_t left = conn->rx_len - conn->req_len;
+
+	if (conn->body) {
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, conn->body);
+		conn->body = NULL;
+	}
+
+	/* keep pipelined bytes for the next request */
+	memmove(conn->rx_buffer, conn->rx_buffer + conn->req_len, left);
+	conn->rx_len = left;
+	conn->rx_buffer[left] = '\0';
+	conn->scan_pos = 0;
+	conn->req_len = 0;
+	conn->content_len = 0;
+	conn->body_len = 0;
+	conn->state = ES_HTTP_STATE_HEADER;
+}
 
-			memset(rx_buffer, '\0', sizeof(rx_buffer));
+/* serves every complete request in the buffers, returns -1 to close */
+static int _es_http_process(struct es_http_conn *conn)
+{
+	char empty[1] = "";
+	size_t avail;
 
-			len = recv(sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
-			IOT_DEBUG("rx_buffer : %s", rx_buffer);
+	while (1) {
+		if (conn->state == ES_HTTP_STATE_HEADER) {
+			if (!_es_http_find_header_end(conn)) {
+				if (conn->rx_len < RX_BUFFER_MAX - 1)
+					return 0;
+				IOT_ERROR("request header is too long");
+				_es_http_reply(conn, "ERROR", empty, ERROR, true);
+				return -1;
+			}
 
-			if (len < 0) {
-				IOT_ERROR("recv failed: errno %d", errno);
-				break;
+			if (!_es_http_parse_header(conn)) {
+				IOT_ERROR("malformed request");
+				_es_http_reply(conn, "ERROR", empty, ERROR, true);
+				return -1;
 			}
-			else if (len == 0) {
-				IOT_ERROR("Connection closed");
-				break;
+
+			if (conn->content_len > 0) {
+				conn->body = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, conn->content_len + 1);
+				if (!conn->body) {
+					IOT_ERROR("failed to malloc for the request body");
+					return -1;
+				}
+
+				avail = conn->rx_len - conn->req_len;
+				if (avail > conn->content_len)
+					avail = conn->content_len;
+				memcpy(conn->body, conn->rx_buffer + conn->req_len, avail);
+				conn->body_len = avail;
+				conn->req_len += avail;
 			}
-			else {
-				rx_buffer[len] = '\0';
+			conn->state = ES_HTTP_STATE_BODY;
+		}
 
-				method = strtok(rx_buffer, " \t\r\n");
-				uri = strtok(NULL, " \t");
-				prot = strtok(NULL, " \t\r\n");
+		if (conn->body_len < conn->content_len)
+			return 0;
 
-				header_t *h = reqhdr;
-				char *t = NULL;
+		if (conn->body)
+			conn->body[conn->content_len] = '\0';
+		IOT_DEBUG("uri : %s", conn->uri);
 
-				while (h < reqhdr + 16) {
-				  char *k, *v;
+		if (es_tcp_stop)
+			return -1;
+		if (_es_http_reply(conn, conn->uri, conn->body ? conn->body : empty,
+				conn->type, !conn->keep_alive) < 0)
+			return -1;
+		if (!conn->keep_alive)
+			return -1;
 
-				  k = strtok(NULL, "\r\n: \t");
-				  if (!k)
-					break;
+		_es_http_next_request(conn);
+	}
+}
 
-				  v = strtok(NULL, "\r\n");
-				  while (*v && *v == ' ')
-					v++;
+static int _es_http_recv(struct es_http_conn *conn)
+{
+	int len;
+
+	if (conn->state == ES_HTTP_STATE_BODY)
+		len = recv(conn->sock, conn->body + conn->body_len, conn->content_len - conn->body_len, 0);
+	else
+		len = recv(conn->sock, conn->rx_buffer + conn->rx_len, RX_BUFFER_MAX - 1 - conn->rx_len, 0);
+
+	if (len < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return 0;
+		IOT_ERROR("recv failed: errno %d", errno);
+		return -1;
+	} else if (len == 0) {
+		IOT_DEBUG("Connection closed");
+		return -1;
+	}
 
-				  h->name = k;
-				  h->value = v;
-				  h++;
+	if (conn->state == ES_HTTP_STATE_BODY) {
+		conn->body_len += len;
+	} else {
+		conn->rx_len += len;
+		conn->rx_buffer[conn->rx_len] = '\0';
+	}
+	iot_os_timer_count_ms(conn->idle_timer, ES_HTTP_IDLE_TIMEOUT_MS);
 
-				  t = v + 1 + strlen(v);
+	return 0;
+}
 
-				  if (t[1] == '\r' && t[2] == '\n')
-					break;
-				}
+static void _es_http_conn_close(struct es_http_conn *conn)
+{
+	if (conn->sock < 0)
+		return;
 
-				t++;
-				payload = t;
-				IOT_DEBUG("payload : %s", payload);
-
-				if (!strcmp(method,  "GET"))
-					http_packet_handle(uri, &tx_buffer, payload, GET);
-				else if (!strcmp(method,  "POST"))
-					http_packet_handle(uri, &tx_buffer, payload, POST);
-				else {
-					IOT_ERROR("not support type");
-					http_packet_handle("ERROR", &tx_buffer, payload, ERROR);
-				}
+	shutdown(conn->sock, SHUT_RDWR);
+	close(conn->sock);
+	conn->sock = -1;
 
-				if (!tx_buffer) {
-					IOT_ERROR("tx_buffer is NULL");
-					break;
-				}
+	if (conn->body) {
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, conn->body);
+		conn->body = NULL;
+	}
+	if (conn->rx_buffer) {
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, conn->rx_buffer);
+		conn->rx_buffer = NULL;
+	}
+	if (conn->idle_timer) {
+		iot_os_timer_destroy(&conn->idle_timer);
+		conn->idle_timer = NULL;
+	}
+}
 
-				len = strlen((char *)tx_buffer);
-				tx_buffer[len] = 0;
+static void _es_http_conn_accept(void)
+{
+	struct es_http_conn *conn = NULL;
+	struct sockaddr_in source_addr;
+	socklen_t addr_len = sizeof(source_addr);
+	struct timeval send_timeout;
+	int sock, i;
+
+	sock = accept(es_listen_sock, (struct sockaddr *)&source_addr, &addr_len);
+	if (sock < 0) {
+		IOT_ERROR("Unable to accept connection: errno %d", errno);
+		return;
+	}
 
-				err = send(sock, tx_buffer, len, 0);
-				if (err < 0) {
-					IOT_ERROR("Error occured during sending: errno %d", err);
-					break;
-				}
-				if (tx_buffer) {
-					free(tx_buffer);
-					tx_buffer = NULL;
-				}
+	for (i = 0; i < ES_HTTP_MAX_CONN; i++) {
+		if (es_conn[i].sock < 0) {
+			conn = &es_conn[i];
+			break;
+		}
+	}
+	if (!conn) {
+		IOT_WARN("no room for a new connection");
+		close(sock);
+		return;
+	}
+
+	/* a peer which stops reading can't hold the task in send() for long */
+	send_timeout.tv_sec = ES_HTTP_SEND_TIMEOUT_MS / 1000;
+	send_timeout.tv_usec = (ES_HTTP_SEND_TIMEOUT_MS % 1000) * 1000;
+	if (setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout)) != 0)
+		IOT_WARN("failed to set SO_SNDTIMEO: errno %d", errno);
+
+	memset(conn, 0, sizeof(struct es_http_conn));
+	conn->sock = sock;
+	conn->rx_buffer = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, RX_BUFFER_MAX);
+	if (!conn->rx_buffer || iot_os_timer_init(&conn->idle_timer) != IOT_ERROR_NONE) {
+		IOT_ERROR("failed to prepare a new connection");
+		_es_http_conn_close(conn);
+		return;
+	}
+	conn->rx_buffer[0] = '\0';
+	iot_os_timer_count_ms(conn->idle_timer, ES_HTTP_IDLE_TIMEOUT_MS);
+}
+
+static int _es_tcp_listen(void)
+{
+	struct sockaddr_in dest_addr;
+	int sock, opt = 1;
+
+	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+	if (sock < 0) {
+		IOT_ERROR("Unable to create socket: errno %d", errno);
+		return -1;
+	}
+
+	/* easysetup may restart while the old port is in TIME_WAIT */
+	if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) != 0)
+		IOT_WARN("failed to set SO_REUSEADDR: errno %d", errno);
+
+	memset(&dest_addr, 0, sizeof(dest_addr));
+	dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	dest_addr.sin_family = AF_INET;
+	dest_addr.sin_port = htons(PORT);
+
+	if (bind(sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr)) != 0) {
+		IOT_ERROR("Socket unable to bind: errno %d", errno);
+		close(sock);
+		return -1;
+	}
+
+	if (listen(sock, ES_HTTP_MAX_CONN) != 0) {
+		IOT_ERROR("Error occurred during listen: errno %d", errno);
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+static void _es_tcp_cleanup(void)
+{
+	int i;
+
+	for (i = 0; i < ES_HTTP_MAX_CONN; i++)
+		_es_http_conn_close(&es_conn[i]);
+
+	if (es_listen_sock >= 0) {
+		close(es_listen_sock);
+		es_listen_sock = -1;
+	}
+}
+
+static void es_tcp_task(void *pvParameters)
+{
+	struct es_http_conn *conn;
+	struct timeval timeout;
+	fd_set rfdset;
+	bool has_room;
+	int i, max_fd, ret;
+
+	while (!es_tcp_stop) {
+		if (es_listen_sock < 0) {
+			es_listen_sock = _es_tcp_listen();
+			if (es_listen_sock < 0) {
+				iot_os_delay(ES_HTTP_TICK_MS);
+				continue;
+			}
+		}
+
+		FD_ZERO(&rfdset);
+		max_fd = -1;
+		has_room = false;
+		for (i = 0; i < ES_HTTP_MAX_CONN; i++) {
+			if (es_conn[i].sock < 0) {
+				has_room = true;
+				continue;
 			}
+			FD_SET(es_conn[i].sock, &rfdset);
+			if (es_conn[i].sock > max_fd)
+				max_fd = es_conn[i].sock;
 		}
+		/* pending connections wait in the backlog until a slot is free */
+		if (has_room) {
+			FD_SET(es_listen_sock, &rfdset);
+			if (es_listen_sock > max_fd)
+				max_fd = es_listen_sock;
+		}
+
+		timeout.tv_sec = ES_HTTP_TICK_MS / 1000;
+		timeout.tv_usec = (ES_HTTP_TICK_MS % 1000) * 1000;
+
+		ret = select(max_fd + 1, &rfdset, NULL, NULL, &timeout);
+		if (ret < 0) {
+			if (errno != EINTR) {
+				IOT_ERROR("select failed: errno %d", errno);
+				iot_os_delay(ES_HTTP_TICK_MS);
+			}
+			continue;
+		}
+		if (es_tcp_stop)
+			break;
 
-		if (sock != -1) {
-			IOT_ERROR("Shutting down socket and restarting...");
-			shutdown(sock, SHUT_RD);
-			close(sock);
+		for (i = 0; i < ES_HTTP_MAX_CONN; i++) {
+			conn = &es_conn[i];
+			if (conn->sock < 0)
+				continue;
+
+			if (ret > 0 && FD_ISSET(conn->sock, &rfdset)) {
+				if (_es_http_recv(conn) < 0 || _es_http_process(conn) < 0)
+					_es_http_conn_close(conn);
+			} else if (iot_os_timer_isexpired(conn->idle_timer)) {
+				IOT_INFO("close idle connection");
+				_es_http_conn_close(conn);
+			}
 		}
+
+		if (ret > 0 && has_room && FD_ISSET(es_listen_sock, &rfdset))
+			_es_http_conn_accept();
 	}
+
+	_es_tcp_cleanup();
+	es_tcp_running = false;
 	iot_os_thread_delete(NULL);
 }
 
@@ -186,22 +626,39 @@ static iot_os_thread es_tcp_task_handle = NULL;
 
 void es_tcp_init(void)
 {
+	int i;
+
 	IOT_INFO("es_tcp_init!!");
-	iot_os_thread_create(es_tcp_task, "es_tcp_task", 4096, NULL, 5, (iot_os_thread * const)(&es_tcp_task_handle));
+
+	for (i = 0; i < ES_HTTP_MAX_CONN; i++)
+		es_conn[i].sock = -1;
+	es_tcp_stop = false;
+	es_tcp_running = true;
+
+	if (iot_os_thread_create(es_tcp_task, "es_tcp_task", 4096, NULL, 5,
+			(iot_os_thread * const)(&es_tcp_task_handle)) != IOT_OS_TRUE) {
+		IOT_ERROR("failed to create es_tcp_task");
+		es_tcp_running = false;
+	}
 }
 
+/*
+ * The task is joined, never deleted: it owns the sockets and buffers, and
+ * may be inside a handler. The caller has released a handler waiting for
+ * the iot main task, others finish within a tick or a send timeout.
+ */
 void es_tcp_deinit(void)
 {
-	if (es_tcp_task_handle) {
-		iot_os_thread_delete(es_tcp_task_handle);
-		es_tcp_task_handle = NULL;
-	}
-
-	if (tx_buffer) {
-		free(tx_buffer);
-		tx_buffer = NULL;
+	unsigned int wait_ms = 0;
+
+	es_tcp_stop = true;
+	while (es_tcp_running) {
+		iot_os_delay(10);
+		wait_ms += 10;
+		if (wait_ms % (10 * ES_HTTP_TICK_MS) == 0)
+			IOT_WARN("es_tcp_task is still busy (%u ms)", wait_ms);
 	}
+	es_tcp_task_handle = NULL;
 
 	IOT_INFO("es_tcp_deinit!!");
 }
-
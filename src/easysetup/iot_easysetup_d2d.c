@@ -19,20 +19,20 @@
 #include <string.h>
 #include "JSON.h"
 #include "iot_main.h"
-#include "iot_bsp_random.h"
 #include "iot_easysetup.h"
 #include "iot_internal.h"
 #include "iot_nv_data.h"
 #include "iot_util.h"
 #include "iot_uuid.h"
 #include "iot_debug.h"
+#include "iot_mem.h"
 
 #define HASH_SIZE (4)
 #define PIN_SIZE	8
 #define MAC_ADDR_BUFFER_SIZE	20
 #define URL_BUFFER_SIZE		64
-#define WIFIINFO_BUFFER_SIZE	20
 #define ES_CONFIRM_MAX_DELAY	10000
+#define ES_CIPHER_CHUNK_SIZE	(IOT_CRYPTO_IV_LEN * 3 * 4)
 
 
 STATIC_FUNCTION
@@ -56,7 +56,7 @@ char *_es_json_parse_string(JSON_H *json, const char *name)
 	IOT_DEBUG("'%s' (%d): %s",
 			name, buf_len, recv->valuestring);
 
-	if ((buf = (char *)iot_os_malloc(buf_len)) == NULL) {
+	if ((buf = (char *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, buf_len)) == NULL) {
 		IOT_ERROR("failed to malloc for buf");
 		return NULL;
 	}
@@ -69,20 +69,22 @@ char *_es_json_parse_string(JSON_H *json, const char *name)
 STATIC_FUNCTION
 iot_error_t _es_crypto_cipher_gen_iv(iot_crypto_cipher_info_t *iv_info)
 {
-	int i;
 	iot_error_t err = IOT_ERROR_NONE;
 	size_t iv_len;
 	unsigned char *iv;
 
 	iv_len = IOT_CRYPTO_IV_LEN;
-	if ((iv = (unsigned char *)iot_os_malloc(iv_len)) == NULL) {
+	if ((iv = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, iv_len)) == NULL) {
 		IOT_ERROR("failed to malloc for iv");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto out;
 	}
 
-	for (i = 0; i < iv_len; i++) {
-		iv[i] = (unsigned char)iot_bsp_random();
+	err = iot_crypto_random(iv, iv_len);
+	if (err) {
+		IOT_ERROR("iot_crypto_random = %d", err);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, iv);
+		goto out;
 	}
 	iv_info->iv = iv;
 	iv_info->iv_len = iv_len;
@@ -92,23 +94,155 @@ out:
 }
 
 STATIC_FUNCTION
-iot_error_t _es_crypto_cipher_aes(iot_crypto_cipher_info_t *iv_info, iot_crypto_cipher_mode_t mode,
+iot_crypto_cipher_ctx_t *_es_crypto_cipher_session(struct iot_context *ctx)
+{
+	iot_error_t err;
+
+	/* keyed once per master secret, each message only loads the iv */
+	if (!ctx->es_crypto_cipher_ctx.state) {
+		err = iot_crypto_cipher_init(&ctx->es_crypto_cipher_ctx, ctx->es_crypto_cipher_info);
+		if (err) {
+			IOT_ERROR("iot_crypto_cipher_init = %d", err);
+			return NULL;
+		}
+	}
+
+	return &ctx->es_crypto_cipher_ctx;
+}
+
+STATIC_FUNCTION
+iot_error_t _es_crypto_cipher_aes(struct iot_context *ctx, iot_crypto_cipher_mode_t mode,
 			unsigned char *input, unsigned char *output, size_t input_len, size_t output_len, size_t *dst_len)
 {
+	iot_crypto_cipher_ctx_t *cipher;
+	iot_crypto_cipher_info_t *info = ctx->es_crypto_cipher_info;
 	iot_error_t err;
 	size_t olen;
+	size_t flen;
+
+	if ((cipher = _es_crypto_cipher_session(ctx)) == NULL)
+		return IOT_ERROR_CRYPTO_CIPHER;
+
+	err = iot_crypto_cipher_start(cipher, mode, info->iv, info->iv_len);
+	if (err) {
+		IOT_ERROR("iot_crypto_cipher_start = %d", err);
+		goto exit;
+	}
 
-	iv_info->mode = mode;
-	err = iot_crypto_cipher_aes(iv_info, input, input_len, output, &olen, output_len);
+	err = iot_crypto_cipher_update(cipher, input, input_len, output, &olen, output_len);
 	if (err) {
-		IOT_ERROR("iot_crypto_cipher_aes = %d", err);
+		IOT_ERROR("iot_crypto_cipher_update = %d", err);
 		goto exit;
 	}
-	*dst_len = olen;
+
+	err = iot_crypto_cipher_finish(cipher, output + olen, &flen, output_len - olen);
+	if (err) {
+		IOT_ERROR("iot_crypto_cipher_finish = %d", err);
+		goto exit;
+	}
+	*dst_len = olen + flen;
 exit:
 	return err;
 }
 
+/*
+ * Encrypts plain and base64url encodes it straight into the final
+ * {"message":"..."} response, ES_CIPHER_CHUNK_SIZE bytes at a time.
+ * The chunk is whole AES blocks and whole base64 quanta, only up to two
+ * cipher bytes are carried over to the next round of encoding.
+ */
+STATIC_FUNCTION
+iot_error_t _es_crypto_encrypt_message(struct iot_context *ctx, const char *plain, char **out_payload)
+{
+	static const char prefix[] = "{\"message\":\"";
+	static const char suffix[] = "\"}";
+	iot_crypto_cipher_ctx_t *cipher;
+	iot_crypto_cipher_info_t *info = ctx->es_crypto_cipher_info;
+	unsigned char crypt_buf[2 + ES_CIPHER_CHUNK_SIZE + IOT_CRYPTO_IV_LEN];
+	iot_error_t err;
+	char *payload = NULL;
+	size_t plain_len;
+	size_t payload_len;
+	size_t pos;
+	size_t off;
+	size_t chunk;
+	size_t carry = 0;
+	size_t olen;
+	size_t written;
+
+	if (!plain || !plain[0]) {
+		IOT_ERROR("json print failed");
+		return IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
+	}
+	plain_len = strlen(plain);
+
+	if ((cipher = _es_crypto_cipher_session(ctx)) == NULL)
+		return IOT_ERROR_EASYSETUP_AES256_ENCRYPTION_ERROR;
+
+	/* PKCS7 always pads, get_align_size is the exact cipher text length */
+	payload_len = (sizeof(prefix) - 1) +
+			IOT_CRYPTO_CAL_B64_LEN(iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, plain_len)) +
+			(sizeof(suffix) - 1);
+	if ((payload = (char *)JSON_MALLOC(payload_len)) == NULL) {
+		IOT_ERROR("failed to malloc for payload");
+		return IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
+	}
+	memcpy(payload, prefix, sizeof(prefix) - 1);
+	pos = sizeof(prefix) - 1;
+
+	err = iot_crypto_cipher_start(cipher, IOT_CRYPTO_CIPHER_ENCRYPT, info->iv, info->iv_len);
+	if (err) {
+		IOT_ERROR("iot_crypto_cipher_start = %d", err);
+		err = IOT_ERROR_EASYSETUP_AES256_ENCRYPTION_ERROR;
+		goto out;
+	}
+
+	for (off = 0; off <= plain_len; off += chunk) {
+		chunk = plain_len - off;
+		if (chunk > ES_CIPHER_CHUNK_SIZE)
+			chunk = ES_CIPHER_CHUNK_SIZE;
+
+		if (chunk) {
+			err = iot_crypto_cipher_update(cipher, (const unsigned char *)plain + off, chunk,
+						crypt_buf + carry, &olen, sizeof(crypt_buf) - carry);
+		} else {
+			err = iot_crypto_cipher_finish(cipher, crypt_buf + carry, &olen, sizeof(crypt_buf) - carry);
+		}
+		if (err) {
+			IOT_ERROR("AES256 Encryption error!! : %d", err);
+			err = IOT_ERROR_EASYSETUP_AES256_ENCRYPTION_ERROR;
+			goto out;
+		}
+		carry += olen;
+
+		/* after finish the leftover is encoded with its padding */
+		olen = chunk ? (carry - (carry % 3)) : carry;
+		if (olen) {
+			err = iot_crypto_base64_encode_urlsafe(crypt_buf, olen, (unsigned char *)payload + pos,
+							payload_len - pos, &written);
+			if (err != IOT_ERROR_NONE) {
+				IOT_ERROR("base64 encode error!!");
+				err = IOT_ERROR_EASYSETUP_BASE64_ENCODE_ERROR;
+				goto out;
+			}
+			pos += written;
+			carry -= olen;
+			memmove(crypt_buf, crypt_buf + olen, carry);
+		}
+
+		if (!chunk)
+			break;
+	}
+
+	memcpy(payload + pos, suffix, sizeof(suffix));
+	*out_payload = payload;
+	payload = NULL;
+out:
+	if (payload)
+		JSON_FREE(payload);
+	return err;
+}
+
 iot_error_t iot_easysetup_create_ssid(struct iot_devconf_prov_data *devconf, char *ssid, size_t ssid_len)
 {
 	char *serial = NULL;
@@ -140,7 +274,7 @@ iot_error_t iot_easysetup_create_ssid(struct iot_devconf_prov_data *devconf, cha
 		goto out;
 
 	if (base64_written >= HASH_SIZE) {
-		devconf->hashed_sn = iot_os_malloc(base64_written + 1);
+		devconf->hashed_sn = iot_mem_malloc(IOT_MEM_TAG_CORE, base64_written + 1);
 		if (!devconf->hashed_sn) {
 			err = IOT_ERROR_MEM_ALLOC;
 			goto out;
@@ -170,11 +304,11 @@ iot_error_t iot_easysetup_create_ssid(struct iot_devconf_prov_data *devconf, cha
 	memcpy(ssid, ssid_build, ssid_len < strlen(ssid_build) ? ssid_len : strlen(ssid_build));
 out:
 	if (err && devconf->hashed_sn) {
-		free(devconf->hashed_sn);
+		iot_mem_free(IOT_MEM_TAG_CORE, devconf->hashed_sn);
 		devconf->hashed_sn = NULL;
 	}
 	if (serial)
-		free(serial);
+		iot_mem_free(IOT_MEM_TAG_NV, serial);
 	return err;
 }
 
@@ -209,7 +343,7 @@ iot_error_t _es_deviceinfo_handler(struct iot_context *ctx, char **out_payload)
 	}
 
 	encode_buf_len = IOT_CRYPTO_CAL_B64_LEN(ctx->es_crypto_cipher_info->iv_len);
-	if ((encode_buf = (unsigned char *)iot_os_malloc(encode_buf_len)) == NULL) {
+	if ((encode_buf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, encode_buf_len)) == NULL) {
 		IOT_ERROR("failed to malloc for encode_buf");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto out;
@@ -229,7 +363,7 @@ iot_error_t _es_deviceinfo_handler(struct iot_context *ctx, char **out_payload)
 	*out_payload = output_ptr;
 out:
 	if (encode_buf)
-		free(encode_buf);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, encode_buf);
 	if (root)
 		JSON_DELETE(root);
 	return err;
@@ -239,131 +373,63 @@ STATIC_FUNCTION
 iot_error_t _es_wifiscaninfo_handler(struct iot_context *ctx, char **out_payload)
 {
 	char *ptr = NULL;
-	char *output_ptr = NULL;
-	char wifi_bssid[WIFIINFO_BUFFER_SIZE] = {0, };
-	JSON_H *root = NULL;
-	JSON_H *array = NULL;
-	JSON_H *array_obj = NULL;
-	int i;
+	unsigned int generation = 0;
 	iot_error_t err = IOT_ERROR_NONE;
-	size_t input_len = 0;
-	size_t output_len = 0;
-	size_t result_len = 0;
-	unsigned char *encode_buf = NULL;
-	unsigned char *encrypt_buf = NULL;
 
 	if (!ctx) {
 	    return IOT_ERROR_EASYSETUP_INTERNAL_SERVER_ERROR;
 	}
 
-	if (!ctx->scan_num)
-		return IOT_ERROR_EASYSETUP_WIFI_SCAN_NOT_FOUND;
-
-	array = JSON_CREATE_ARRAY();
-	if (!array) {
-		IOT_ERROR("json_array create failed");
-		return IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
-	}
-
-	for(i = 0; i < ctx->scan_num; i++) {
-		if ((ctx->scan_result[i].authmode <  IOT_WIFI_AUTH_OPEN) ||
-			(ctx->scan_result[i].authmode >= IOT_WIFI_AUTH_WPA2_ENTERPRISE)) {
-			IOT_DEBUG("Unsupported authType %d, %s", ctx->scan_result[i].authmode,
-								(char *)ctx->scan_result[i].ssid);
-			continue;
-		}
-		snprintf(wifi_bssid, sizeof(wifi_bssid), "%02X:%02X:%02X:%02X:%02X:%02X",
-						ctx->scan_result[i].bssid[0], ctx->scan_result[i].bssid[1],
-						ctx->scan_result[i].bssid[2], ctx->scan_result[i].bssid[3],
-						ctx->scan_result[i].bssid[4], ctx->scan_result[i].bssid[5]);
-
-		array_obj = JSON_CREATE_OBJECT();
-		if (!array_obj) {
-			IOT_ERROR("json create failed");
-			err = IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
+	if (ctx->scan_cache) {
+		/* the list is frozen from here, ssid and authType of wifiprovisioninginfo are checked against it */
+		err = iot_easysetup_scan_get(ctx, true, &generation, &ptr, out_payload);
+		if (err != IOT_ERROR_NONE || *out_payload)
 			goto out;
-		}
-		JSON_ADD_ITEM_TO_OBJECT(array_obj, "bssid", JSON_CREATE_STRING(wifi_bssid));
-		JSON_ADD_ITEM_TO_OBJECT(array_obj, "ssid", JSON_CREATE_STRING((char*)ctx->scan_result[i].ssid));
-		JSON_ADD_NUMBER_TO_OBJECT(array_obj, "rssi", (double) ctx->scan_result[i].rssi);
-		JSON_ADD_NUMBER_TO_OBJECT(array_obj, "frequency", (double) ctx->scan_result[i].freq);
-		JSON_ADD_NUMBER_TO_OBJECT(array_obj, "authType", ctx->scan_result[i].authmode);
-		JSON_ADD_ITEM_TO_ARRAY(array, array_obj);
-	}
 
-	root = JSON_CREATE_OBJECT();
-	if (!root) {
-		IOT_ERROR("json create failed");
-		err = IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
+		err = _es_crypto_encrypt_message(ctx, ptr, out_payload);
+		if (err == IOT_ERROR_NONE)
+			iot_easysetup_scan_set_payload(ctx, generation, *out_payload);
 		goto out;
 	}
-	JSON_ADD_ITEM_TO_OBJECT(root, "wifiScanInfo", array);
 
-	ptr = JSON_PRINT(root);
-
-	input_len = strlen(ptr);
-	output_len = iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, input_len);
-	if ((encrypt_buf = iot_os_malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encrypt_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
+	if (!ctx->scan_num)
+		return IOT_ERROR_EASYSETUP_WIFI_SCAN_NOT_FOUND;
 
-	err = _es_crypto_cipher_aes(ctx->es_crypto_cipher_info, IOT_CRYPTO_CIPHER_ENCRYPT,
-					(unsigned char *) ptr, encrypt_buf, input_len, output_len, &result_len);
-	if (err) {
-		IOT_ERROR("AES256 Encryption error!! : %d", err);
-		err = IOT_ERROR_EASYSETUP_AES256_ENCRYPTION_ERROR;
-		goto out;
-	}
+	err = iot_easysetup_scan_serialize(ctx->scan_result, ctx->scan_num, &ptr);
+	if (err != IOT_ERROR_NONE)
+		return err;
 
-	input_len = result_len;
-	output_len = IOT_CRYPTO_CAL_B64_LEN(input_len);
-	if ((encode_buf = iot_os_malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encode_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
+	err = _es_crypto_encrypt_message(ctx, ptr, out_payload);
+out:
+	if (ptr)
+		JSON_FREE(ptr);
+	return err;
+}
 
-	err = iot_crypto_base64_encode_urlsafe(encrypt_buf, input_len,
-						encode_buf, output_len, &result_len);
-	if (err != IOT_ERROR_NONE) {
-		IOT_ERROR("base64 encode error!!");
-		err = IOT_ERROR_EASYSETUP_BASE64_ENCODE_ERROR;
-		goto out;
-	}
+/*
+ * encrypts wifiScanInfo while the app is busy with the keyinfo reply.
+ * The list keeps refreshing until the app asks for it, a newer list drops this payload.
+ */
+static void _es_wifiscaninfo_prepare(struct iot_context *ctx)
+{
+	char *ptr = NULL;
+	char *payload = NULL;
+	unsigned int generation = 0;
 
-	if (root)
-		JSON_DELETE(root);
-	root = NULL;
+	if (iot_easysetup_scan_get(ctx, false, &generation, &ptr, NULL) != IOT_ERROR_NONE)
+		return;
 
-	root = JSON_CREATE_OBJECT();
-	if (!root) {
-		IOT_ERROR("json create failed");
-		err = IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
-		goto out;
+	if (_es_crypto_encrypt_message(ctx, ptr, &payload) == IOT_ERROR_NONE) {
+		iot_easysetup_scan_set_payload(ctx, generation, payload);
+		JSON_FREE(payload);
 	}
-	JSON_ADD_ITEM_TO_OBJECT(root, "message", JSON_CREATE_STRING((char *) encode_buf));
-	output_ptr = JSON_PRINT(root);
-
-	*out_payload = output_ptr;
-out:
-	if (ptr)
-		free(ptr);
-	if (encode_buf)
-		free(encode_buf);
-	if (encrypt_buf)
-		free(encrypt_buf);
-	if (root)
-		JSON_DELETE(root);
-	return err;
+	JSON_FREE(ptr);
 }
 
 STATIC_FUNCTION
 iot_error_t _es_keyinfo_handler(struct iot_context *ctx, char *in_payload, char **out_payload)
 {
 	char *ptr = NULL;
-	char *output_ptr = NULL;
 	char tmp[3] = {0};
 	char rand_asc[IOT_CRYPTO_SHA256_LEN * 2 + 1] = { 0 };
 	JSON_H *recv = NULL;
@@ -377,14 +443,9 @@ iot_error_t _es_keyinfo_handler(struct iot_context *ctx, char *in_payload, char
 	unsigned char key_tsec_curve[IOT_CRYPTO_ED25519_LEN];
 	unsigned char key_spub_sign[IOT_CRYPTO_ED25519_LEN];
 	unsigned char key_rand[IOT_CRYPTO_SHA256_LEN];
-	unsigned char *encode_buf = NULL;
-	unsigned char *encrypt_buf = NULL;
 	unsigned char *master_secret = NULL;
 	unsigned char *p_spub_str = NULL;
 	unsigned char *p_rand_str = NULL;
-	size_t input_len = 0;
-	size_t output_len = 0;
-	size_t result_len = 0;
 	size_t spub_len = 0;
 	size_t rand_asc_len = 0;
 
@@ -467,7 +528,7 @@ iot_error_t _es_keyinfo_handler(struct iot_context *ctx, char *in_payload, char
 		goto exit;
 	}
 
-	master_secret = iot_os_malloc(IOT_CRYPTO_SECRET_LEN + 1);
+	master_secret = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, IOT_CRYPTO_SECRET_LEN + 1);
 	if (!master_secret) {
 		IOT_ERROR("failed to malloc for master_secret");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
@@ -492,6 +553,10 @@ iot_error_t _es_keyinfo_handler(struct iot_context *ctx, char *in_payload, char
 	ctx->es_crypto_cipher_info->type = IOT_CRYPTO_CIPHER_AES256;
 	ctx->es_crypto_cipher_info->key = master_secret;
 	ctx->es_crypto_cipher_info->key_len = IOT_CRYPTO_SECRET_LEN;
+	/* new master secret, the session is keyed again on the next message */
+	iot_crypto_cipher_free(&ctx->es_crypto_cipher_ctx);
+	/* wifiScanInfo encrypted with the old key can't be served anymore */
+	iot_easysetup_scan_set_payload(ctx, 0, NULL);
 
 	if (root)
 		JSON_DELETE(root);
@@ -519,61 +584,12 @@ iot_error_t _es_keyinfo_handler(struct iot_context *ctx, char *in_payload, char
 
 	ptr = JSON_PRINT(root);
 
-	input_len = strlen(ptr);
-	output_len = iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, input_len);
-	if ((encrypt_buf = iot_os_malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encrypt_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto exit;
-	}
-
-	err = _es_crypto_cipher_aes(ctx->es_crypto_cipher_info, IOT_CRYPTO_CIPHER_ENCRYPT,
-						(unsigned char *) ptr, encrypt_buf, input_len, output_len, &result_len);
-	if (err) {
-		IOT_ERROR("AES256 Encryption error!! : %d", err);
-		err = IOT_ERROR_EASYSETUP_AES256_ENCRYPTION_ERROR;
-		goto exit_secret;
-	}
-
-	input_len = result_len;
-	output_len = IOT_CRYPTO_CAL_B64_LEN(input_len);
-	if ((encode_buf = iot_os_malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encode_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto exit_secret;
-	}
-
-	err = iot_crypto_base64_encode_urlsafe(encrypt_buf, input_len,
-						encode_buf, output_len, &result_len);
-	if (err != IOT_ERROR_NONE) {
-		IOT_ERROR("base64 encode error!!");
-		err = IOT_ERROR_EASYSETUP_BASE64_ENCODE_ERROR;
-		goto exit_secret;
-	}
-
-	if (root)
-		JSON_DELETE(root);
-	root = NULL;
-
-	root = JSON_CREATE_OBJECT();
-	if (!root) {
-		IOT_ERROR("json create failed");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto exit_secret;
-	}
-	JSON_ADD_ITEM_TO_OBJECT(root, "message", JSON_CREATE_STRING((char *) encode_buf));
-	output_ptr = JSON_PRINT(root);
-
-	*out_payload = output_ptr;
+	err = _es_crypto_encrypt_message(ctx, ptr, out_payload);
 exit_secret:
 	if (ptr)
-		free(ptr);
-	if (encode_buf)
-		free(encode_buf);
-	if (encrypt_buf)
-		free(encrypt_buf);
+		JSON_FREE(ptr);
 	if (err && master_secret)
-		free(master_secret);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, master_secret);
 exit_pk:
 		iot_es_crypto_free_pk(&pk_info);
 exit:
@@ -669,7 +685,6 @@ STATIC_FUNCTION
 iot_error_t _es_confirminfo_handler(struct iot_context *ctx, char *in_payload, char **out_payload)
 {
 	char *ptr = NULL;
-	char *output_ptr = NULL;
 	char *rev_message = NULL;
 	JSON_H *recv = NULL;
 	JSON_H *root = NULL;
@@ -678,9 +693,7 @@ iot_error_t _es_confirminfo_handler(struct iot_context *ctx, char *in_payload, c
 	size_t output_len = 0;
 	size_t result_len = 0;
 	unsigned char *decode_buf = NULL;
-	unsigned char *encode_buf = NULL;
 	unsigned char *decrypt_buf = NULL;
-	unsigned char *encrypt_buf = NULL;
 
 	if (!ctx || !in_payload) {
 	    return IOT_ERROR_EASYSETUP_INTERNAL_SERVER_ERROR;
@@ -703,7 +716,7 @@ iot_error_t _es_confirminfo_handler(struct iot_context *ctx, char *in_payload, c
 
 	input_len = (unsigned int)strlen(rev_message);
 	output_len = input_len;
-	if ((decode_buf = iot_os_malloc(output_len)) == NULL) {
+	if ((decode_buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, output_len)) == NULL) {
 		IOT_ERROR("failed to malloc for decode_buf");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto out;
@@ -720,13 +733,13 @@ iot_error_t _es_confirminfo_handler(struct iot_context *ctx, char *in_payload, c
 
 	input_len = result_len;
 	output_len = iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, input_len);
-	if ((decrypt_buf = iot_os_malloc(output_len)) == NULL) {
+	if ((decrypt_buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, output_len)) == NULL) {
 		IOT_ERROR("failed to malloc for decrypt_buf");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto out;
 	}
 
-	err = _es_crypto_cipher_aes(ctx->es_crypto_cipher_info, IOT_CRYPTO_CIPHER_DECRYPT,
+	err = _es_crypto_cipher_aes(ctx, IOT_CRYPTO_CIPHER_DECRYPT,
 						decode_buf, decrypt_buf, input_len, output_len, &result_len);
 	if (err) {
 		IOT_ERROR("AES256 Encryption error!! : %d", err);
@@ -781,65 +794,16 @@ iot_error_t _es_confirminfo_handler(struct iot_context *ctx, char *in_payload, c
 
 	ptr = JSON_PRINT(root);
 
-	input_len = (unsigned int)strlen(ptr);
-	output_len = iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, input_len);
-	if ((encrypt_buf = iot_os_malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encrypt_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
-
-	err = _es_crypto_cipher_aes(ctx->es_crypto_cipher_info, IOT_CRYPTO_CIPHER_ENCRYPT,
-						(unsigned char *) ptr, encrypt_buf, input_len, output_len, &result_len);
-	if (err) {
-		IOT_ERROR("AES256 Encryption error!! : %d", err);
-		err = IOT_ERROR_EASYSETUP_AES256_ENCRYPTION_ERROR;
-		goto out;
-	}
-
-	input_len = result_len;
-	output_len = IOT_CRYPTO_CAL_B64_LEN(input_len);
-	if ((encode_buf = (unsigned char *)iot_os_malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encode_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
-
-	err = iot_crypto_base64_encode_urlsafe(encrypt_buf, input_len,
-						encode_buf, output_len, &result_len);
-	if (err != IOT_ERROR_NONE) {
-		IOT_ERROR("base64 encode error!!");
-		err = IOT_ERROR_EASYSETUP_BASE64_ENCODE_ERROR;
-		goto out;
-	}
-
-	if (root)
-		JSON_DELETE(root);
-	root = NULL;
-
-	root = JSON_CREATE_OBJECT();
-	if (!root) {
-		IOT_ERROR("json create failed");
-		err = IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
-		goto out;
-	}
-	JSON_ADD_ITEM_TO_OBJECT(root, "message", JSON_CREATE_STRING((char *) encode_buf));
-	output_ptr = JSON_PRINT(root);
-
-	*out_payload = output_ptr;
+	err = _es_crypto_encrypt_message(ctx, ptr, out_payload);
 out:
 	if (ptr)
-		free(ptr);
+		JSON_FREE(ptr);
 	if (rev_message)
-		free(rev_message);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, rev_message);
 	if (decode_buf)
-		free(decode_buf);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, decode_buf);
 	if (decrypt_buf)
-		free(decrypt_buf);
-	if (encrypt_buf)
-		free(encrypt_buf);
-	if (encode_buf)
-		free(encode_buf);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, decrypt_buf);
 	if (root)
 		JSON_DELETE(root);
 	return err;
@@ -851,7 +815,6 @@ iot_error_t _es_confirm_handler(struct iot_context *ctx, char *in_payload, char
 	bool validation = true;
 	char pin[PIN_SIZE + 1];
 	char *ptr = NULL;
-	char *output_ptr = NULL;
 	char *rev_message = NULL;
 	JSON_H *recv = NULL;
 	JSON_H *root = NULL;
@@ -862,8 +825,6 @@ iot_error_t _es_confirm_handler(struct iot_context *ctx, char *in_payload, char
 	size_t result_len = 0;
 	unsigned char *decode_buf = NULL;
 	unsigned char *decrypt_buf = NULL;
-	unsigned char *encode_buf = NULL;
-	unsigned char *encrypt_buf = NULL;
 
 	if (!ctx || !ctx->pin) {
 		IOT_ERROR("no pin from device app");
@@ -892,7 +853,7 @@ iot_error_t _es_confirm_handler(struct iot_context *ctx, char *in_payload, char
 
 	input_len = (unsigned int)strlen(rev_message);
 	output_len = input_len;
-	if ((decode_buf = malloc(output_len)) == NULL) {
+	if ((decode_buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, output_len)) == NULL) {
 		IOT_ERROR("failed to malloc for decode_buf");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto out;
@@ -907,13 +868,13 @@ iot_error_t _es_confirm_handler(struct iot_context *ctx, char *in_payload, char
 
 	input_len = result_len;
 	output_len = iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, input_len);
-	if ((decrypt_buf = malloc(output_len)) == NULL) {
+	if ((decrypt_buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, output_len)) == NULL) {
 		IOT_ERROR("failed to malloc for decrypt_buf");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto out;
 	}
 
-	err = _es_crypto_cipher_aes(ctx->es_crypto_cipher_info, IOT_CRYPTO_CIPHER_DECRYPT,
+	err = _es_crypto_cipher_aes(ctx, IOT_CRYPTO_CIPHER_DECRYPT,
 						decode_buf, decrypt_buf, input_len, output_len, &result_len);
 	if (err) {
 		IOT_ERROR("AES256 Encryption error!! : %d", err);
@@ -976,63 +937,14 @@ iot_error_t _es_confirm_handler(struct iot_context *ctx, char *in_payload, char
 	}
 	ptr = JSON_PRINT(root);
 
-	input_len = (unsigned int)strlen(ptr);
-	output_len = iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, input_len);
-	if ((encrypt_buf = malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encrypt_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
-
-	err = _es_crypto_cipher_aes(ctx->es_crypto_cipher_info, IOT_CRYPTO_CIPHER_ENCRYPT,
-						(unsigned char *) ptr, encrypt_buf, input_len, output_len, &result_len);
-	if (err) {
-		IOT_ERROR("AES256 Encryption error!! : %d", err);
-		err = IOT_ERROR_EASYSETUP_AES256_ENCRYPTION_ERROR;
-		goto out;
-	}
-
-	input_len = result_len;
-	output_len = IOT_CRYPTO_CAL_B64_LEN(input_len);
-	if ((encode_buf = malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc encode_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
-
-	err = iot_crypto_base64_encode_urlsafe(encrypt_buf, input_len,
-						encode_buf, output_len, &result_len);
-	if (err != IOT_ERROR_NONE) {
-		IOT_ERROR("base64 encode error!!");
-		err = IOT_ERROR_EASYSETUP_BASE64_ENCODE_ERROR;
-		goto out;
-	}
-
-	if (root)
-		JSON_DELETE(root);
-	root = NULL;
-
-	root = JSON_CREATE_OBJECT();
-	if (!root) {
-		IOT_ERROR("json create failed");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
-	JSON_ADD_ITEM_TO_OBJECT(root, "message", JSON_CREATE_STRING((char *) encode_buf));
-	output_ptr = JSON_PRINT(root);
-
-	*out_payload = output_ptr;
+	err = _es_crypto_encrypt_message(ctx, ptr, out_payload);
 out:
 	if (ptr)
-		free(ptr);
+		JSON_FREE(ptr);
 	if (decode_buf)
-		free(decode_buf);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, decode_buf);
 	if (decrypt_buf)
-		free(decrypt_buf);
-	if (encrypt_buf)
-		free(encrypt_buf);
-	if (encode_buf)
-		free(encode_buf);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, decrypt_buf);
 	if (root)
 		JSON_DELETE(root);
 	return err;
@@ -1062,7 +974,7 @@ iot_error_t _es_wifi_prov_parse(struct iot_context *ctx, char *in_payload)
 		goto wifi_parse_out;
 	}
 
-	if ((wifi_prov = (struct iot_wifi_prov_data *)malloc(sizeof(struct iot_wifi_prov_data))) == NULL) {
+	if ((wifi_prov = (struct iot_wifi_prov_data *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, sizeof(struct iot_wifi_prov_data))) == NULL) {
 		IOT_ERROR("failed to malloc for wifi_prov_data");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto wifi_parse_out;
@@ -1136,7 +1048,7 @@ iot_error_t _es_wifi_prov_parse(struct iot_context *ctx, char *in_payload)
 
 wifi_parse_out:
 	if (wifi_prov)
-		free(wifi_prov);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, wifi_prov);
 	if (root)
 		JSON_DELETE(root);
 	return err;
@@ -1160,7 +1072,7 @@ iot_error_t _es_cloud_prov_parse(char *in_payload)
 		goto cloud_parse_out;
 	}
 
-	if ((cloud_prov = (struct iot_cloud_prov_data *)malloc(sizeof(struct iot_cloud_prov_data))) == NULL) {
+	if ((cloud_prov = (struct iot_cloud_prov_data *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, sizeof(struct iot_cloud_prov_data))) == NULL) {
 		IOT_ERROR("failed to alloc mem");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto cloud_parse_out;
@@ -1226,19 +1138,19 @@ iot_error_t _es_cloud_prov_parse(char *in_payload)
 cloud_parse_out:
 	if (err) {
 		if (url.domain)
-			free(url.domain);
+			iot_mem_free(IOT_MEM_TAG_CORE, url.domain);
 	}
 
 	if (url.protocol)
-		free(url.protocol);
+		iot_mem_free(IOT_MEM_TAG_CORE, url.protocol);
 	if (full_url)
-		free(full_url);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, full_url);
 	if (cloud_prov)
-		free(cloud_prov);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, cloud_prov);
 	if (location_id_str)
-		free(location_id_str);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, location_id_str);
 	if (room_id_str)
-		free(room_id_str);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, room_id_str);
 	if (root)
 		JSON_DELETE(root);
 	return err;
@@ -1249,7 +1161,6 @@ iot_error_t _es_wifiprovisioninginfo_handler(struct iot_context *ctx, char *in_p
 {
 	struct iot_uuid uuid;
 	char *ptr = NULL;
-	char *output_ptr = NULL;
 	char *rev_message = NULL;
 	JSON_H *root = NULL;
 	int uuid_len = 40;
@@ -1258,9 +1169,7 @@ iot_error_t _es_wifiprovisioninginfo_handler(struct iot_context *ctx, char *in_p
 	size_t output_len = 0;
 	size_t result_len = 0;
 	unsigned char *decode_buf = NULL;
-	unsigned char *encode_buf = NULL;
 	unsigned char *decrypt_buf = NULL;
-	unsigned char *encrypt_buf = NULL;
 
 	root = JSON_PARSE(in_payload);
 	if (!root) {
@@ -1273,7 +1182,7 @@ iot_error_t _es_wifiprovisioninginfo_handler(struct iot_context *ctx, char *in_p
 
 	input_len = strlen(rev_message);
 	output_len = input_len;
-	if ((decode_buf = malloc(output_len)) == NULL) {
+	if ((decode_buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, output_len)) == NULL) {
 		IOT_ERROR("failed to malloc for decode_buf");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto out;
@@ -1294,13 +1203,13 @@ iot_error_t _es_wifiprovisioninginfo_handler(struct iot_context *ctx, char *in_p
 
 	input_len = result_len;
 	output_len = iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, input_len);
-	if ((decrypt_buf = malloc(output_len)) == NULL) {
+	if ((decrypt_buf = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, output_len)) == NULL) {
 		IOT_ERROR("failed to malloc for decrypt_buf");
 		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
 		goto out;
 	}
 
-	err = _es_crypto_cipher_aes(ctx->es_crypto_cipher_info, IOT_CRYPTO_CIPHER_DECRYPT,
+	err = _es_crypto_cipher_aes(ctx, IOT_CRYPTO_CIPHER_DECRYPT,
 						decode_buf, decrypt_buf, input_len, output_len, &result_len);
 	if (err) {
 		IOT_ERROR("AES256 Decryption error!! : %d", err);
@@ -1327,7 +1236,7 @@ iot_error_t _es_wifiprovisioninginfo_handler(struct iot_context *ctx, char *in_p
 		goto out;
 	}
 
-	ctx->lookup_id = (char *) malloc(uuid_len);
+	ctx->lookup_id = (char *) iot_mem_malloc(IOT_MEM_TAG_CORE, uuid_len);
 
 	err = iot_util_convert_uuid_str(&uuid, ctx->lookup_id, uuid_len);
 	if (err) {
@@ -1348,52 +1257,9 @@ iot_error_t _es_wifiprovisioninginfo_handler(struct iot_context *ctx, char *in_p
 
 	ptr = JSON_PRINT(root);
 
-	input_len = (unsigned int)strlen(ptr);
-	output_len = iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, input_len);
-	if ((encrypt_buf = malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encrypt_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
+	err = _es_crypto_encrypt_message(ctx, ptr, out_payload);
+	if (err)
 		goto out;
-	}
-
-	err = _es_crypto_cipher_aes(ctx->es_crypto_cipher_info, IOT_CRYPTO_CIPHER_ENCRYPT,
-						(unsigned char *) ptr, encrypt_buf, input_len, output_len, &result_len);
-	if (err) {
-		IOT_ERROR("AES256 Encryption error!! : %d", err);
-		err = IOT_ERROR_EASYSETUP_AES256_ENCRYPTION_ERROR;
-		goto out;
-	}
-
-	input_len = result_len;
-	output_len = IOT_CRYPTO_CAL_B64_LEN(input_len);
-	if ((encode_buf = malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encode_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
-
-	err = iot_crypto_base64_encode_urlsafe(encrypt_buf, input_len,
-						encode_buf, output_len, &result_len);
-	if (err != IOT_ERROR_NONE) {
-		IOT_ERROR("base64 encode error!!");
-		err = IOT_ERROR_EASYSETUP_BASE64_ENCODE_ERROR;
-		goto out;
-	}
-
-	if (root)
-		JSON_DELETE(root);
-	root = NULL;
-
-	root = JSON_CREATE_OBJECT();
-	if (!root) {
-		IOT_ERROR("json create failed");
-		err = IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
-		goto out;
-	}
-	JSON_ADD_ITEM_TO_OBJECT(root, "message", JSON_CREATE_STRING((char *) encode_buf));
-	output_ptr = JSON_PRINT(root);
-
-	*out_payload = output_ptr;
 
 	err = iot_nv_get_prov_data(&ctx->prov_data);
 	if (err) {
@@ -1404,17 +1270,13 @@ iot_error_t _es_wifiprovisioninginfo_handler(struct iot_context *ctx, char *in_p
 	}
 out:
 	if (ptr)
-		free(ptr);
+		JSON_FREE(ptr);
 	if (rev_message)
-		free(rev_message);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, rev_message);
 	if (decode_buf)
-		free(decode_buf);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, decode_buf);
 	if (decrypt_buf)
-		free(decrypt_buf);
-	if (encrypt_buf)
-		free(encrypt_buf);
-	if (encode_buf)
-		free(encode_buf);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, decrypt_buf);
 	if (root)
 		JSON_DELETE(root);
 	return err;
@@ -1424,14 +1286,8 @@ STATIC_FUNCTION
 iot_error_t _es_setupcomplete_handler(struct iot_context *ctx, char *in_payload, char **out_payload)
 {
 	char *ptr = NULL;
-	char *output_ptr = NULL;
 	JSON_H *root = NULL;
 	iot_error_t err = IOT_ERROR_NONE;
-	size_t input_len = 0;
-	size_t output_len = 0;
-	size_t result_len = 0;
-	unsigned char *encode_buf = NULL;
-	unsigned char *encrypt_buf = NULL;
 
 	root = JSON_CREATE_OBJECT();
 	if (!root) {
@@ -1442,60 +1298,13 @@ iot_error_t _es_setupcomplete_handler(struct iot_context *ctx, char *in_payload,
 
 	ptr = JSON_PRINT(root);
 
-	input_len = strlen(ptr);
-	output_len = iot_crypto_cipher_get_align_size(IOT_CRYPTO_CIPHER_AES256, input_len);
-	if ((encrypt_buf = malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encrypt_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
-
-	err = _es_crypto_cipher_aes(ctx->es_crypto_cipher_info, IOT_CRYPTO_CIPHER_ENCRYPT,
-						(unsigned char *) ptr, encrypt_buf, input_len, output_len, &result_len);
-	if (err) {
-		IOT_ERROR("AES256 Encryption error!! : %d", err);
-		err = IOT_ERROR_EASYSETUP_AES256_ENCRYPTION_ERROR;
-		goto out;
-	}
-
-	input_len = result_len;
-	output_len = (input_len * 2);
-	if ((encode_buf = (unsigned char *)malloc(output_len)) == NULL) {
-		IOT_ERROR("failed to malloc for encode_buf");
-		err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
-		goto out;
-	}
-
-	err = iot_crypto_base64_encode_urlsafe(encrypt_buf, input_len,
-						encode_buf, output_len, &result_len);
-	if (err != IOT_ERROR_NONE) {
-		IOT_ERROR("base64 encode error!!");
-		err = IOT_ERROR_EASYSETUP_BASE64_ENCODE_ERROR;
-		goto out;
-	}
-
-	if (root)
-		JSON_DELETE(root);
-	root = NULL;
-
-	root = JSON_CREATE_OBJECT();
-	if (!root) {
-		IOT_ERROR("json create failed");
-		err = IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
+	err = _es_crypto_encrypt_message(ctx, ptr, out_payload);
+	if (err)
 		goto out;
-	}
-	JSON_ADD_ITEM_TO_OBJECT(root, "message", JSON_CREATE_STRING((char *) encode_buf));
-	output_ptr = JSON_PRINT(root);
-
-	*out_payload = output_ptr;
 
 out:
 	if (ptr)
-		free(ptr);
-	if (encrypt_buf)
-		free(encrypt_buf);
-	if (encode_buf)
-		free(encode_buf);
+		JSON_FREE(ptr);
 	if (root)
 		JSON_DELETE(root);
 	return err;
@@ -1592,11 +1401,18 @@ iot_error_t iot_easysetup_request_handler(struct iot_context *ctx, struct iot_ea
 {
 	iot_error_t err = IOT_ERROR_NONE;
 	int ret = IOT_OS_TRUE;
-	struct iot_easysetup_payload *response = malloc(sizeof(struct iot_easysetup_payload));
+	struct iot_easysetup_payload *response;
+	bool keyed;
 
 	if (!ctx)
 		return IOT_ERROR_EASYSETUP_INTERNAL_SERVER_ERROR;
 
+	response = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, sizeof(struct iot_easysetup_payload));
+	if (!response) {
+		IOT_ERROR("failed to malloc for easysetup response");
+		return IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
+	}
+
 	response->step = request.step;
 	response->payload = NULL;
 
@@ -1670,12 +1486,16 @@ iot_error_t iot_easysetup_request_handler(struct iot_context *ctx, struct iot_ea
 	}
 
 	response->err = err;
+	keyed = (request.step == IOT_EASYSETUP_STEP_KEYINFO) && (err == IOT_ERROR_NONE);
 
 	if (ctx->easysetup_resp_queue) {
 		IOT_ERROR("Send to easysetup_resp_queue Queue");
-		ret = iot_os_queue_send(ctx->easysetup_resp_queue, response, 0);
+		ret = iot_os_queue_send(ctx->easysetup_resp_queue, &response, 0);
 		if (ret != IOT_OS_TRUE) {
 			IOT_ERROR("Cannot put the response into easysetup_resp_queue");
+			if (response->payload)
+				JSON_FREE(response->payload);
+			iot_mem_free(IOT_MEM_TAG_EASYSETUP, response);
 			err = IOT_ERROR_EASYSETUP_INTERNAL_SERVER_ERROR;
 		} else {
 			IOT_ERROR("IOT_EVENT_BIT_EASYSETUP_RESP");
@@ -1685,8 +1505,15 @@ iot_error_t iot_easysetup_request_handler(struct iot_context *ctx, struct iot_ea
 		}
 	} else {
 		IOT_ERROR("easysetup_resp_queue is deleted");
+		if (response->payload)
+			JSON_FREE(response->payload);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, response);
 		err = IOT_ERROR_NONE;
 	}
 
+	/* the app asks for wifiScanInfo right after keyinfo, have it ready */
+	if (keyed && ctx->scan_cache)
+		_es_wifiscaninfo_prepare(ctx);
+
 	return err;
 }
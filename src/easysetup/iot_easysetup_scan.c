@@ -0,0 +1,387 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <string.h>
+#include "JSON.h"
+#include "iot_main.h"
+#include "iot_easysetup.h"
+#include "iot_internal.h"
+#include "iot_debug.h"
+#include "iot_mem.h"
+
+#if defined(CONFIG_STDK_IOT_CORE_EASYSETUP_WIFI_SCAN_INTERVAL)
+#define ES_SCAN_INTERVAL_MS	CONFIG_STDK_IOT_CORE_EASYSETUP_WIFI_SCAN_INTERVAL
+#else
+#define ES_SCAN_INTERVAL_MS	20000
+#endif
+
+#define ES_SCAN_POLL_MS			100
+#define ES_SCAN_STOP_WAIT_MS	5000
+#define ES_SCAN_TASK_STACK_SIZE	4096
+#define ES_SCAN_TASK_PRIORITY	(IOT_TASK_PRIORITY - 1)
+#define WIFIINFO_BUFFER_SIZE	20
+
+uint16_t iot_easysetup_scan_merge(iot_wifi_scan_result_t *list, uint16_t num)
+{
+	iot_wifi_scan_result_t *ap;
+	uint16_t i, j, n = 0;
+
+	if (!list)
+		return 0;
+
+	for (i = 0; i < num; i++) {
+		ap = &list[i];
+		for (j = 0; j < n; j++) {
+			if (!memcmp(list[j].bssid, ap->bssid, IOT_WIFI_MAX_BSSID_LEN))
+				break;
+			if (ap->ssid[0] && !strcmp((char *)list[j].ssid, (char *)ap->ssid))
+				break;
+		}
+
+		if (j == n) {
+			if (n != i)
+				list[n] = *ap;
+			n++;
+		} else if (ap->rssi > list[j].rssi) {
+			/* keeps the place of the first one found */
+			memcpy(list[j].bssid, ap->bssid, IOT_WIFI_MAX_BSSID_LEN);
+			list[j].rssi = ap->rssi;
+			list[j].freq = ap->freq;
+			list[j].authmode = ap->authmode;
+		}
+	}
+
+	return n;
+}
+
+iot_error_t iot_easysetup_scan_serialize(const iot_wifi_scan_result_t *list, uint16_t num, char **json)
+{
+	char wifi_bssid[WIFIINFO_BUFFER_SIZE] = {0, };
+	JSON_H *root = NULL;
+	JSON_H *array = NULL;
+	JSON_H *array_obj = NULL;
+	iot_error_t err = IOT_ERROR_NONE;
+	int i;
+
+	if (!list || !json)
+		return IOT_ERROR_INVALID_ARGS;
+
+	array = JSON_CREATE_ARRAY();
+	if (!array) {
+		IOT_ERROR("json_array create failed");
+		return IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
+	}
+
+	for (i = 0; i < num; i++) {
+		if ((list[i].authmode < IOT_WIFI_AUTH_OPEN) ||
+			(list[i].authmode >= IOT_WIFI_AUTH_WPA2_ENTERPRISE)) {
+			IOT_DEBUG("Unsupported authType %d, %s", list[i].authmode,
+								(char *)list[i].ssid);
+			continue;
+		}
+		snprintf(wifi_bssid, sizeof(wifi_bssid), "%02X:%02X:%02X:%02X:%02X:%02X",
+						list[i].bssid[0], list[i].bssid[1],
+						list[i].bssid[2], list[i].bssid[3],
+						list[i].bssid[4], list[i].bssid[5]);
+
+		array_obj = JSON_CREATE_OBJECT();
+		if (!array_obj) {
+			IOT_ERROR("json create failed");
+			JSON_DELETE(array);
+			return IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
+		}
+		JSON_ADD_ITEM_TO_OBJECT(array_obj, "bssid", JSON_CREATE_STRING(wifi_bssid));
+		JSON_ADD_ITEM_TO_OBJECT(array_obj, "ssid", JSON_CREATE_STRING((char *)list[i].ssid));
+		JSON_ADD_NUMBER_TO_OBJECT(array_obj, "rssi", (double) list[i].rssi);
+		JSON_ADD_NUMBER_TO_OBJECT(array_obj, "frequency", (double) list[i].freq);
+		JSON_ADD_NUMBER_TO_OBJECT(array_obj, "authType", list[i].authmode);
+		JSON_ADD_ITEM_TO_ARRAY(array, array_obj);
+	}
+
+	root = JSON_CREATE_OBJECT();
+	if (!root) {
+		IOT_ERROR("json create failed");
+		JSON_DELETE(array);
+		return IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
+	}
+	JSON_ADD_ITEM_TO_OBJECT(root, "wifiScanInfo", array);
+
+	*json = JSON_PRINT(root);
+	if (!*json) {
+		IOT_ERROR("json print failed");
+		err = IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR;
+	}
+	JSON_DELETE(root);
+
+	return err;
+}
+
+static char *_iot_es_scan_strdup(const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *dup;
+
+	dup = (char *)JSON_MALLOC(len);
+	if (dup)
+		memcpy(dup, str, len);
+
+	return dup;
+}
+
+static void _iot_es_scan_free(struct iot_wifi_scan_cache *cache)
+{
+	if (cache->json)
+		JSON_FREE(cache->json);
+	if (cache->payload)
+		JSON_FREE(cache->payload);
+	iot_os_mutex_destroy(&cache->lock);
+	iot_mem_free(IOT_MEM_TAG_EASYSETUP, cache);
+}
+
+/* merges and serializes cache->scan out of the lock, then swaps it in */
+static void _iot_es_scan_publish(struct iot_wifi_scan_cache *cache, uint16_t num)
+{
+	char *json = NULL;
+	char *old_json;
+	char *old_payload;
+
+	if (num > IOT_WIFI_MAX_SCAN_RESULT)
+		num = IOT_WIFI_MAX_SCAN_RESULT;
+
+	num = iot_easysetup_scan_merge(cache->scan, num);
+	if (!num) {
+		IOT_INFO("no ap found, keep the last list");
+		return;
+	}
+
+	if (iot_easysetup_scan_serialize(cache->scan, num, &json) != IOT_ERROR_NONE)
+		return;
+
+	iot_os_mutex_lock(&cache->lock);
+	if (cache->frozen || cache->stop) {
+		iot_os_mutex_unlock(&cache->lock);
+		JSON_FREE(json);
+		return;
+	}
+	memcpy(cache->list, cache->scan, num * sizeof(iot_wifi_scan_result_t));
+	cache->num = num;
+	old_json = cache->json;
+	old_payload = cache->payload;
+	cache->json = json;
+	cache->payload = NULL;
+	cache->generation++;
+	iot_os_mutex_unlock(&cache->lock);
+
+	if (old_json)
+		JSON_FREE(old_json);
+	if (old_payload)
+		JSON_FREE(old_payload);
+	IOT_DEBUG("scan list %u published with %d aps", cache->generation, num);
+}
+
+static bool _iot_es_scan_refreshing(struct iot_wifi_scan_cache *cache)
+{
+	bool refreshing;
+
+	iot_os_mutex_lock(&cache->lock);
+	refreshing = !cache->stop && !cache->frozen;
+	iot_os_mutex_unlock(&cache->lock);
+
+	return refreshing;
+}
+
+static void _iot_es_scan_task(void *data)
+{
+	struct iot_wifi_scan_cache *cache = (struct iot_wifi_scan_cache *)data;
+	unsigned int waited_ms = 0;
+	bool orphan;
+
+	while (_iot_es_scan_refreshing(cache)) {
+		iot_os_delay(ES_SCAN_POLL_MS);
+		waited_ms += ES_SCAN_POLL_MS;
+		if (waited_ms < ES_SCAN_INTERVAL_MS)
+			continue;
+
+		waited_ms = 0;
+		memset(cache->scan, 0, sizeof(cache->scan));
+		_iot_es_scan_publish(cache, iot_bsp_wifi_get_scan_result(cache->scan));
+	}
+
+	iot_os_mutex_lock(&cache->lock);
+	cache->running = false;
+	orphan = cache->orphan;
+	iot_os_mutex_unlock(&cache->lock);
+
+	if (orphan)
+		_iot_es_scan_free(cache);
+	iot_os_thread_delete(NULL);
+}
+
+iot_error_t iot_easysetup_scan_start(struct iot_context *ctx)
+{
+	struct iot_wifi_scan_cache *cache;
+
+	if (!ctx)
+		return IOT_ERROR_INVALID_ARGS;
+
+	iot_easysetup_scan_stop(ctx);
+
+	cache = (struct iot_wifi_scan_cache *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP,
+			sizeof(struct iot_wifi_scan_cache));
+	if (!cache) {
+		IOT_ERROR("failed to malloc for scan cache");
+		return IOT_ERROR_MEM_ALLOC;
+	}
+	memset(cache, 0, sizeof(struct iot_wifi_scan_cache));
+
+	if (iot_os_mutex_init(&cache->lock) != IOT_OS_TRUE) {
+		IOT_ERROR("failed to init scan cache lock");
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, cache);
+		return IOT_ERROR_MEM_ALLOC;
+	}
+
+	/* first scan stays in place, before soft-ap comes up */
+	_iot_es_scan_publish(cache, iot_bsp_wifi_get_scan_result(cache->scan));
+	ctx->scan_cache = cache;
+
+	if (ES_SCAN_INTERVAL_MS > 0) {
+		cache->running = true;
+		if (iot_os_thread_create(_iot_es_scan_task, "es_scan_task", ES_SCAN_TASK_STACK_SIZE,
+				cache, ES_SCAN_TASK_PRIORITY, NULL) != IOT_OS_TRUE) {
+			IOT_WARN("failed to create es_scan_task, no refresh");
+			cache->running = false;
+		}
+	}
+
+	return IOT_ERROR_NONE;
+}
+
+void iot_easysetup_scan_stop(struct iot_context *ctx)
+{
+	struct iot_wifi_scan_cache *cache;
+	unsigned int waited_ms = 0;
+	bool running;
+
+	if (!ctx || !ctx->scan_cache)
+		return;
+
+	cache = ctx->scan_cache;
+	ctx->scan_cache = NULL;
+
+	iot_os_mutex_lock(&cache->lock);
+	cache->stop = true;
+	running = cache->running;
+	iot_os_mutex_unlock(&cache->lock);
+
+	/* a scan in progress can't be cut, give it a while */
+	while (running && waited_ms < ES_SCAN_STOP_WAIT_MS) {
+		iot_os_delay(10);
+		waited_ms += 10;
+
+		iot_os_mutex_lock(&cache->lock);
+		running = cache->running;
+		cache->orphan = running && (waited_ms >= ES_SCAN_STOP_WAIT_MS);
+		iot_os_mutex_unlock(&cache->lock);
+	}
+
+	if (running) {
+		IOT_WARN("scan is still in progress, es_scan_task frees the cache");
+		return;
+	}
+
+	_iot_es_scan_free(cache);
+}
+
+iot_error_t iot_easysetup_scan_get(struct iot_context *ctx, bool freeze,
+		unsigned int *generation, char **json, char **payload)
+{
+	struct iot_wifi_scan_cache *cache;
+	iot_error_t err = IOT_ERROR_NONE;
+
+	if (!ctx || !ctx->scan_cache)
+		return IOT_ERROR_INVALID_ARGS;
+	cache = ctx->scan_cache;
+
+	if (json)
+		*json = NULL;
+	if (payload)
+		*payload = NULL;
+
+	if (!ctx->scan_result) {
+		ctx->scan_result = (iot_wifi_scan_result_t *)iot_mem_malloc(IOT_MEM_TAG_CORE,
+				IOT_WIFI_MAX_SCAN_RESULT * sizeof(iot_wifi_scan_result_t));
+		if (!ctx->scan_result) {
+			IOT_ERROR("failed to malloc for iot_wifi_scan_result_t");
+			return IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
+		}
+		memset(ctx->scan_result, 0, IOT_WIFI_MAX_SCAN_RESULT * sizeof(iot_wifi_scan_result_t));
+	}
+
+	iot_os_mutex_lock(&cache->lock);
+	if (!cache->generation) {
+		err = IOT_ERROR_EASYSETUP_WIFI_SCAN_NOT_FOUND;
+		goto out;
+	}
+
+	/* the list served to the app must stay the one wifiprovisioninginfo is checked against */
+	if (freeze)
+		cache->frozen = true;
+
+	memcpy(ctx->scan_result, cache->list, cache->num * sizeof(iot_wifi_scan_result_t));
+	ctx->scan_num = cache->num;
+	if (generation)
+		*generation = cache->generation;
+
+	if (payload && cache->payload && (cache->payload_generation == cache->generation)) {
+		*payload = _iot_es_scan_strdup(cache->payload);
+		if (!*payload)
+			err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
+		goto out;
+	}
+
+	if (json) {
+		*json = _iot_es_scan_strdup(cache->json);
+		if (!*json)
+			err = IOT_ERROR_EASYSETUP_MEM_ALLOC_ERROR;
+	}
+out:
+	iot_os_mutex_unlock(&cache->lock);
+	return err;
+}
+
+void iot_easysetup_scan_set_payload(struct iot_context *ctx, unsigned int generation, const char *payload)
+{
+	struct iot_wifi_scan_cache *cache;
+	char *old_payload;
+
+	if (!ctx || !ctx->scan_cache)
+		return;
+	cache = ctx->scan_cache;
+
+	iot_os_mutex_lock(&cache->lock);
+	old_payload = cache->payload;
+	cache->payload = NULL;
+	if (payload && generation && (generation == cache->generation)) {
+		cache->payload = _iot_es_scan_strdup(payload);
+		cache->payload_generation = generation;
+	}
+	iot_os_mutex_unlock(&cache->lock);
+
+	if (old_payload)
+		JSON_FREE(old_payload);
+}
@@ -30,6 +30,7 @@
 #include "iot_wt.h"
 #include "iot_crypto.h"
 #include "iot_os_util.h"
+#include "iot_mem.h"
 #include "iot_bsp_system.h"
 #include "iot_uuid.h"
 
@@ -43,7 +44,7 @@ void _iot_mqtt_noti_sub_callback(st_mqtt_msg *md, void *userData)
 	struct iot_context *ctx = (struct iot_context *)userData;
 	char *mqtt_payload = md->payload;
 
-	iot_noti_sub_cb(ctx, mqtt_payload);
+	iot_noti_sub_cb(ctx, mqtt_payload, md->payloadlen);
 	IOT_DEBUG("raw msg (len:%d) : %s", md->payloadlen, mqtt_payload);
 }
 
@@ -52,99 +53,90 @@ void _iot_mqtt_cmd_sub_callback(st_mqtt_msg *md, void *userData)
 	struct iot_context *ctx = (struct iot_context *)userData;
 	char *mqtt_payload = md->payload;
 
-	iot_cap_sub_cb(ctx->cap_handle_list, mqtt_payload);
+	iot_cap_sub_cb(ctx->cap_handle_list, mqtt_payload, md->trace_seq);
 	IOT_DEBUG("raw msg (len:%d) : %s", md->payloadlen, mqtt_payload);
 }
 
+static iot_error_t _iot_es_mqtt_get_string(st_mqtt_msg *md, const char *key,
+		char *buf, size_t buf_len)
+{
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+	return iot_serialize_cbor_get_string((const uint8_t *)md->payload,
+			md->payloadlen, key, buf, buf_len);
+#else
+	return iot_util_json_get_string((const char *)md->payload,
+			md->payloadlen, key, buf, buf_len);
+#endif
+}
+
+static iot_error_t _iot_es_mqtt_get_int(st_mqtt_msg *md, const char *key,
+		int64_t *val)
+{
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+	return iot_serialize_cbor_get_int((const uint8_t *)md->payload,
+			md->payloadlen, key, val);
+#else
+	return iot_util_json_get_int((const char *)md->payload,
+			md->payloadlen, key, val);
+#endif
+}
+
 static void mqtt_reg_sub_cb(st_mqtt_msg *md, void *userData)
 {
 	struct iot_context *ctx = (struct iot_context *)userData;
 	struct iot_registered_data *reged_data = &ctx->iot_reg_data;
-	char * mqtt_payload = md->payload;
-	char * registered_msg = NULL;
-	JSON_H *json = NULL;
-	JSON_H *svr_did = NULL;
-	JSON_H *event = NULL;
-	JSON_H *cur_time = NULL;
-	char time_str[11] = {0,};
-	char *svr_did_str = NULL;
+	char event[32];
+	char svr_did[IOT_REG_UUID_STR_LEN * 2];
+	char time_str[21] = {0,};
+	int64_t cur_time;
 	enum iot_command_type iot_cmd;
 
-	/*parsing mqtt_payload*/
-#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
-	iot_error_t err;
-	char *payload_json = NULL;
-	size_t payload_json_len = 0;
-
-	err = iot_serialize_cbor2json((uint8_t *)mqtt_payload,
-			strlen(mqtt_payload),
-			&payload_json, &payload_json_len);
-	if (err) {
-		IOT_ERROR("iot_serialize_cbor2json = %d", err);
-		goto reg_sub_out;
-	}
-
-	if ((payload_json == NULL) || (payload_json_len == 0)) {
-		IOT_ERROR("cbor2json failed (json buffer is null)");
-		goto reg_sub_out;
+	if (md->payload == NULL || md->payloadlen <= 0) {
+		IOT_ERROR("There are no registered msg");
+		return;
 	}
 
-	json = JSON_PARSE(payload_json);
-	free(payload_json);
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+	IOT_INFO("Registered MSG (cbor len:%d)", md->payloadlen);
 #else
-	json = JSON_PARSE(mqtt_payload);
+	if (!iot_util_json_is_valid((const char *)md->payload, md->payloadlen)) {
+		IOT_ERROR("mqtt_payload parsing failed");
+		return;
+	}
+	IOT_INFO("Registered MSG : %.*s", md->payloadlen, (char *)md->payload);
 #endif
-	if (json == NULL) {
-		IOT_ERROR("mqtt_payload(%s) parsing failed", mqtt_payload);
-		goto reg_sub_out;
-	}
-
-	registered_msg = JSON_PRINT(json);
-	if (registered_msg == NULL) {
-		IOT_ERROR("There are no registered msg, payload : %s", mqtt_payload);
-		goto reg_sub_out;
-	}
-	IOT_INFO("Registered MSG : %s", registered_msg);
-
-	event = JSON_GET_OBJECT_ITEM(json, "event");
-	if (event != NULL) {
-		if (!strncmp(event->valuestring, "expired.jwt", 11)) {
-			cur_time = JSON_GET_OBJECT_ITEM(json, "currentTime");
-			if (cur_time == NULL) {
-				IOT_ERROR("%s : there is no currentTime in json, mqtt_payload : \n%s",
-					__func__, mqtt_payload);
-				goto reg_sub_out;
+
+	/* members are read in place, nothing is allocated for parsing */
+	if (_iot_es_mqtt_get_string(md, "event", event, sizeof(event)) == IOT_ERROR_NONE) {
+		if (!strncmp(event, "expired.jwt", 11)) {
+			if (_iot_es_mqtt_get_int(md, "currentTime", &cur_time) != IOT_ERROR_NONE) {
+				IOT_ERROR("%s : there is no currentTime in payload", __func__);
+				return;
 			}
 
-			snprintf(time_str, sizeof(time_str), "%d", cur_time->valueint);
+			iot_util_convert_u64_str((cur_time < 0) ? 0 : (uint64_t)cur_time,
+					time_str, sizeof(time_str));
 			IOT_INFO("Set SNTP with current time %s", time_str);
 			iot_bsp_system_set_time_in_sec(time_str);
 
 			iot_cmd = IOT_COMMAND_CLOUD_REGISTERING;
 			if (iot_command_send(ctx, iot_cmd, NULL, 0) != IOT_ERROR_NONE)
 				IOT_ERROR("Cannot send cloud registering cmd!!");
-		} else if (!strncmp(event->valuestring, "error", 5)) {
+		} else if (!strncmp(event, "error", 5)) {
 			bool reboot;
 			reboot = true;
 			iot_command_send(ctx, IOT_COMMAND_SELF_CLEANUP, &reboot, sizeof(bool));
-			goto reg_sub_out;
+			return;
 		} else {
-			IOT_ERROR("event type %s is not defined", event->valuestring);
-			goto reg_sub_out;
+			IOT_ERROR("event type %s is not defined", event);
+			return;
 		}
 	}
 
-	svr_did = JSON_GET_OBJECT_ITEM(json, "deviceId");
-	if (svr_did != NULL && !reged_data->updated) {
-		svr_did_str = JSON_PRINT(svr_did);
-		if (svr_did_str == NULL) {
-			IOT_ERROR("Can't print server's did str!!");
-			goto reg_sub_out;
-		}
-
+	if (!reged_data->updated && _iot_es_mqtt_get_string(md, "deviceId",
+			svr_did, sizeof(svr_did)) == IOT_ERROR_NONE) {
 		memset(reged_data->deviceId, 0, IOT_REG_UUID_STR_LEN + 1);
-		/* svr_did_str has/included ["] also - "xxxxx-xxxx-xxx" */
-		memcpy(reged_data->deviceId, (svr_did_str + 1), IOT_REG_UUID_STR_LEN);
+		strncpy(reged_data->deviceId, svr_did, IOT_REG_UUID_STR_LEN);
 
 		reged_data->updated = true;
 		reged_data->new_reged = false;
@@ -153,16 +145,6 @@ static void mqtt_reg_sub_cb(st_mqtt_msg *md, void *userData)
 		if (iot_command_send(ctx, iot_cmd, NULL, 0) != IOT_ERROR_NONE)
 			IOT_ERROR("Cannot send cloud registered cmd!!");
 	}
-
-reg_sub_out:
-	if (svr_did_str != NULL)
-		free(svr_did_str);
-
-	if (registered_msg != NULL)
-		free(registered_msg);
-
-	if (json != NULL)
-		JSON_DELETE(json);
 }
 
 #if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
@@ -184,7 +166,7 @@ static void *_iot_es_mqtt_registration_cbor(struct iot_context *ctx,
 retry:
 	buflen += 128;
 
-	buf = (uint8_t *)malloc(buflen);
+	buf = (uint8_t *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, buflen);
 	if (buf == NULL) {
 		IOT_ERROR("failed to malloc for cbor");
 		return NULL;
@@ -230,7 +212,7 @@ retry:
 
 	olen = cbor_encoder_get_buffer_size(&root, buf);
 	if (olen < buflen) {
-		tmp = (uint8_t *)realloc(buf, olen + 1);
+		tmp = (uint8_t *)iot_mem_realloc(IOT_MEM_TAG_EASYSETUP, buf, buflen, olen + 1);
 		if (!tmp) {
 			IOT_WARN("realloc failed for cbor");
 		} else {
@@ -240,7 +222,7 @@ retry:
 		IOT_ERROR("allocated size is not enough (%d < %d)",
 				(int)buflen, (int)olen);
 		if (buflen < IOT_CBOR_MAX_BUF_LEN) {
-			free(buf);
+			iot_mem_free(IOT_MEM_TAG_EASYSETUP, buf);
 			goto retry;
 		} else {
 			goto exit_failed;
@@ -250,7 +232,7 @@ retry:
 	return (void *)buf;
 
 exit_failed:
-	free(buf);
+	iot_mem_free(IOT_MEM_TAG_EASYSETUP, buf);
 
 	return NULL;
 }
@@ -328,7 +310,7 @@ iot_error_t _iot_es_mqtt_registration(struct iot_context *ctx, st_mqtt_client mq
 	/* Step 2. Publish target's registration info to server */
 	ctx->iot_reg_data.updated = false;
 
-	location_id = (char *)malloc(str_id_len);
+	location_id = (char *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, str_id_len);
 	if (!location_id) {
 		IOT_ERROR("malloc failed for location id");
 		iot_err = IOT_ERROR_MEM_ALLOC;
@@ -349,7 +331,7 @@ iot_error_t _iot_es_mqtt_registration(struct iot_context *ctx, st_mqtt_client mq
 		valid_id |= ctx->prov_data.cloud.room_id.id[i];
 
 	if (valid_id) {
-		room_id = (char *)malloc(str_id_len);
+		room_id = (char *)iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, str_id_len);
 		if (!room_id) {
 			IOT_ERROR("malloc failed for room id");
 			iot_err = IOT_ERROR_MEM_ALLOC;
@@ -382,6 +364,7 @@ iot_error_t _iot_es_mqtt_registration(struct iot_context *ctx, st_mqtt_client mq
 		msg.retained = false;
 		msg.payloadlen = strlen(msg.payload);
 		msg.topic = IOT_PUB_TOPIC_REGISTRATION;
+		msg.trace_seq = 0;
 
 		ret = st_mqtt_publish(mqtt_ctx, &msg);
 		if (ret) {
@@ -390,7 +373,7 @@ iot_error_t _iot_es_mqtt_registration(struct iot_context *ctx, st_mqtt_client mq
 		}
 
 #if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
-		free(msg.payload);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, msg.payload);
 #else
 		JSON_FREE(msg.payload);
 #endif
@@ -398,10 +381,10 @@ iot_error_t _iot_es_mqtt_registration(struct iot_context *ctx, st_mqtt_client mq
 
 failed_regist:
 	if (location_id)
-		free(location_id);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, location_id);
 
 	if (room_id)
-		free(room_id);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, room_id);
 
 	return iot_err;
 }
@@ -422,73 +405,177 @@ void _iot_es_mqtt_disconnect(struct iot_context *ctx, st_mqtt_client target_cli)
 		IOT_WARN("Disconnect error(%d)", ret);
 }
 
-iot_error_t _iot_es_mqtt_connect(struct iot_context *ctx, st_mqtt_client target_cli,
-		char *username, char *sign_data)
+/*
+ * Loads everything which does not change over reconnection only once.
+ * It is kept in ctx->mqtt_warm until iot_es_release_warm_data() is called.
+ */
+static iot_error_t _iot_es_mqtt_load_warm_data(struct iot_context *ctx)
 {
-	st_mqtt_connect_data conn_data = st_mqtt_connect_data_initializer;
-	st_mqtt_broker_info_t broker_info;
-	int ret;
-	iot_error_t iot_ret = IOT_ERROR_NONE;
-	bool reboot;
+	struct iot_mqtt_warm_data *warm = &ctx->mqtt_warm;
 	struct iot_uuid iot_uuid;
-	char *client_id = NULL;
-	struct iot_cloud_prov_data *cloud_prov;
-	char *root_cert = NULL;
-	size_t root_cert_len;
+	iot_error_t iot_ret;
+
+	if (warm->loaded)
+		return IOT_ERROR_NONE;
+
+	iot_ret = iot_nv_get_serial_number(&warm->dev_sn, &warm->dev_sn_len);
+	if (iot_ret != IOT_ERROR_NONE) {
+		IOT_ERROR("failed to get serial num");
+		goto load_fail;
+	}
+
+	iot_es_crypto_init_pk(&warm->pk_info, ctx->devconf.pk_type);
+	iot_ret = iot_es_crypto_load_pk(&warm->pk_info);
+	if (iot_ret != IOT_ERROR_NONE) {
+		IOT_ERROR("failed to load pk");
+		goto load_fail;
+	}
+
+	/* key is parsed once here, every web token is signed with this context */
+	iot_ret = iot_crypto_pk_init(&warm->pk_ctx, &warm->pk_info);
+	if (iot_ret != IOT_ERROR_NONE) {
+		IOT_ERROR("failed to init pk context");
+		goto load_fail;
+	}
+
+	iot_ret = iot_nv_get_root_certificate(&warm->root_cert, &warm->root_cert_len);
+	if (iot_ret != IOT_ERROR_NONE) {
+		IOT_ERROR("failed to get root cert");
+		goto load_fail;
+	}
 
 	/* Use mac based random client_id for GreatGate */
 	iot_ret = iot_random_uuid_from_mac(&iot_uuid);
 	if (iot_ret != IOT_ERROR_NONE) {
 		IOT_ERROR("Cannot get mac based random uuid");
-		return iot_ret;
+		goto load_fail;
 	}
 
-	client_id = (char *)malloc(40);
-	if (!client_id) {
-		IOT_ERROR("Cannot malloc for client_id");
-		return IOT_ERROR_MEM_ALLOC;
-	}
-
-	iot_ret = iot_util_convert_uuid_str(&iot_uuid, client_id, 40);
+	iot_ret = iot_util_convert_uuid_str(&iot_uuid, warm->client_id, sizeof(warm->client_id));
 	if (iot_ret != IOT_ERROR_NONE) {
 		IOT_ERROR("Cannot convert str for client_id");
-		goto done_mqtt_connect;
+		goto load_fail;
+	}
+
+	warm->loaded = true;
+	return IOT_ERROR_NONE;
+
+load_fail:
+	iot_es_release_warm_data(ctx);
+	return iot_ret;
+}
+
+static iot_error_t _iot_es_mqtt_make_topics(struct iot_context *ctx)
+{
+	struct iot_mqtt_warm_data *warm = &ctx->mqtt_warm;
+	char *device_id = ctx->iot_reg_data.deviceId;
+
+	if (warm->event_topic && !strcmp(warm->device_id, device_id))
+		return IOT_ERROR_NONE;
+
+	if (!warm->noti_topic)
+		warm->noti_topic = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, IOT_TOPIC_SIZE);
+	if (!warm->cmd_topic)
+		warm->cmd_topic = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, IOT_TOPIC_SIZE);
+	if (!warm->event_topic)
+		warm->event_topic = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, IOT_TOPIC_SIZE);
+
+	if (!warm->noti_topic || !warm->cmd_topic || !warm->event_topic) {
+		IOT_ERROR("failed to malloc for topics");
+		return IOT_ERROR_MEM_ALLOC;
 	}
 
+	snprintf(warm->noti_topic, IOT_TOPIC_SIZE, IOT_SUB_TOPIC_NOTIFICATION, device_id);
+	snprintf(warm->cmd_topic, IOT_TOPIC_SIZE, IOT_SUB_TOPIC_COMMAND, device_id);
+	snprintf(warm->event_topic, IOT_TOPIC_SIZE, IOT_PUB_TOPIC_EVENT, device_id);
+	strncpy(warm->device_id, device_id, IOT_REG_UUID_STR_LEN);
+	warm->device_id[IOT_REG_UUID_STR_LEN] = '\0';
+
+	return IOT_ERROR_NONE;
+}
+
+void iot_es_release_warm_data(struct iot_context *ctx)
+{
+	struct iot_mqtt_warm_data *warm;
+	bool persistent_session;
+
+	if (!ctx)
+		return;
+
+	warm = &ctx->mqtt_warm;
+
+	if (warm->mqttcli)
+		st_mqtt_destroy(warm->mqttcli);
+
+	iot_crypto_pk_free(&warm->pk_ctx);
+	iot_es_crypto_free_pk(&warm->pk_info);
+
+	if (warm->dev_sn)
+		iot_mem_free(IOT_MEM_TAG_NV, warm->dev_sn);
+
+	if (warm->root_cert)
+		iot_mem_free(IOT_MEM_TAG_NV, warm->root_cert);
+
+	if (warm->noti_topic)
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, warm->noti_topic);
+
+	if (warm->cmd_topic)
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, warm->cmd_topic);
+
+	if (ctx->mqtt_event_topic == warm->event_topic)
+		ctx->mqtt_event_topic = NULL;
+
+	if (warm->event_topic)
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, warm->event_topic);
+
+	persistent_session = warm->persistent_session;
+	memset(warm, 0, sizeof(struct iot_mqtt_warm_data));
+	warm->persistent_session = persistent_session;
+}
+
+iot_error_t _iot_es_mqtt_connect(struct iot_context *ctx, st_mqtt_client target_cli,
+		char *username, char *sign_data, unsigned char *session_present)
+{
+	st_mqtt_connect_data conn_data = st_mqtt_connect_data_initializer;
+	st_mqtt_broker_info_t broker_info;
+	int ret;
+	iot_error_t iot_ret = IOT_ERROR_NONE;
+	bool reboot;
+	struct iot_cloud_prov_data *cloud_prov;
 
 	cloud_prov = &ctx->prov_data.cloud;
 	if (!cloud_prov->broker_url) {
 		IOT_ERROR("cloud_prov_data url does not exist!");
-		iot_ret = IOT_ERROR_INVALID_ARGS;
-		goto done_mqtt_connect;
-	}
-
-	iot_ret = iot_nv_get_root_certificate(&root_cert, &root_cert_len);
-	if (iot_ret != IOT_ERROR_NONE) {
-		IOT_ERROR("failed to get root cert");
-		goto done_mqtt_connect;
+		return IOT_ERROR_INVALID_ARGS;
 	}
 
 	broker_info.url = cloud_prov->broker_url;
 	broker_info.port = cloud_prov->broker_port;
-	broker_info.ca_cert = (const unsigned char *)root_cert;
-	broker_info.ca_cert_len = root_cert_len;
+	broker_info.ca_cert = (const unsigned char *)ctx->mqtt_warm.root_cert;
+	broker_info.ca_cert_len = ctx->mqtt_warm.root_cert_len;
 	broker_info.ssl = 1;
 
 	IOT_INFO("url: %s, port: %d", cloud_prov->broker_url, cloud_prov->broker_port);
 
-	conn_data.clientid  = client_id;
+	conn_data.clientid  = ctx->mqtt_warm.client_id;
 	conn_data.username  = username;
 	conn_data.password  = sign_data;
+	/* only communication connection asks session_present */
+	if (session_present && ctx->mqtt_warm.persistent_session)
+		conn_data.cleansession = 0;
+#if defined(CONFIG_STDK_IOT_CORE_MQTT_V5)
+	conn_data.mqtt_ver = 5;
+#endif
 
 	IOT_INFO("mqtt connect,\nid : %s\nusername : %s\npassword : %s",
 		 conn_data.clientid,
 		 conn_data.username,
 		 conn_data.password);
 
-	ret = st_mqtt_connect(target_cli, &broker_info, &conn_data);
+	ret = st_mqtt_connect_with_session(target_cli, &broker_info, &conn_data, session_present);
 	if (ret) {
-		IOT_ERROR("%s error(%d)", __func__, ret);
+		IOT_ERROR("%s error(%d), reason(0x%02x)", __func__, ret,
+				st_mqtt_get_reason_code(target_cli));
 		switch (ret) {
 		case E_ST_MQTT_UNNACCEPTABLE_PROTOCOL:
 			/* fall through */
@@ -529,27 +616,25 @@ iot_error_t _iot_es_mqtt_connect(struct iot_context *ctx, st_mqtt_client target_
             IOT_ERROR("Returned code from start tasks is %d", ret);
 			st_mqtt_disconnect(target_cli);
 			iot_ret = IOT_ERROR_MQTT_CONNECT_FAIL;
-			goto done_mqtt_connect;
+			return iot_ret;
 		} else
 			IOT_INFO("Use MQTTStartTask");
 #endif
 
-done_mqtt_connect:
-	if (root_cert)
-		free((void *)root_cert);
-
-	free(client_id);
 	return iot_ret;
 }
 
 iot_error_t iot_es_connect(struct iot_context *ctx, int conn_type)
 {
+	struct iot_mqtt_warm_data *warm;
 	st_mqtt_client mqtt_cli = NULL;
-	char *dev_sn = NULL;
-	size_t devsn_len;
 	char *wt_data = NULL;
-	struct iot_crypto_pk_info pk_info = { 0, };
 	char *topicfilter = NULL;
+	st_mqtt_sub_filter sub_filters[2];
+	unsigned char session_present = 0;
+	bool resumable = false;
+	bool reused = false;
+	bool connected = false;
 	iot_error_t iot_ret;
 	int ret;
 
@@ -558,111 +643,119 @@ iot_error_t iot_es_connect(struct iot_context *ctx, int conn_type)
 		return IOT_ERROR_INVALID_ARGS;
 	}
 
-	ret = st_mqtt_create(&mqtt_cli, IOT_DEFAULT_TIMEOUT);
-	if (ret) {
-		IOT_ERROR("Cannot create mqtt client");
-		return IOT_ERROR_MEM_ALLOC;
-	}
-
-	iot_ret = iot_nv_get_serial_number(&dev_sn, &devsn_len);
-	if (iot_ret != IOT_ERROR_NONE) {
-		IOT_ERROR("failed to get serial num");
-		goto out;
-	}
+	warm = &ctx->mqtt_warm;
+	iot_ret = _iot_es_mqtt_load_warm_data(ctx);
+	if (iot_ret != IOT_ERROR_NONE)
+		return iot_ret;
 
-	iot_es_crypto_init_pk(&pk_info, ctx->devconf.pk_type);
-	iot_ret = iot_es_crypto_load_pk(&pk_info);
-	if (iot_ret != IOT_ERROR_NONE) {
-		IOT_ERROR("failed to load pk");
-		goto out;
+	if (conn_type == IOT_CONNECT_TYPE_COMMUNICATION && warm->mqttcli) {
+		/* warm reconnect, only TCP/TLS connection & MQTT CONNECT are redone */
+		IOT_INFO("reuse mqtt client for warm reconnect");
+		mqtt_cli = warm->mqttcli;
+		warm->mqttcli = NULL;
+		reused = true;
+		/* reused client keeps message handlers of persistent session */
+		resumable = warm->persistent_session;
+	} else {
+		ret = st_mqtt_create(&mqtt_cli, IOT_DEFAULT_TIMEOUT);
+		if (ret) {
+			IOT_ERROR("Cannot create mqtt client");
+			return IOT_ERROR_MEM_ALLOC;
+		}
 	}
 
-	iot_ret = iot_wt_create(&wt_data, dev_sn, &pk_info);
+	/* web token has issued time, so it is made for every connection */
+	iot_ret = iot_wt_create_with_ctx(&wt_data, warm->dev_sn, &warm->pk_ctx);
 	if (iot_ret != IOT_ERROR_NONE) {
 		IOT_ERROR("failed to make wt-token");
 		goto out;
 	}
 
-	topicfilter = malloc(IOT_TOPIC_SIZE);
-	if (!topicfilter) {
-		IOT_ERROR("failed to malloc topicfilter");
-		iot_ret = IOT_ERROR_MEM_ALLOC;
-		goto out;
-	}
 	if (conn_type == IOT_CONNECT_TYPE_COMMUNICATION) {
 		IOT_INFO("connect_type: log-in");
 		/* Using for new MQTT PUB/SUB connection after registration */
 		if (!ctx->iot_reg_data.updated) {
 			IOT_ERROR("failed to get user id");
+			iot_ret = IOT_ERROR_REG_UPDATED;
 			goto out;
 		}
 
-		iot_ret = _iot_es_mqtt_connect(ctx, mqtt_cli, (char *)ctx->iot_reg_data.deviceId, wt_data);
+		/* subscriptions of resumed session are for previous topics */
+		if (!warm->event_topic || strcmp(warm->device_id, ctx->iot_reg_data.deviceId))
+			resumable = false;
+
+		iot_ret = _iot_es_mqtt_make_topics(ctx);
+		if (iot_ret != IOT_ERROR_NONE)
+			goto out;
+
+		st_mqtt_set_stats(mqtt_cli, &ctx->mqtt_stats);
+		iot_ret = _iot_es_mqtt_connect(ctx, mqtt_cli, (char *)ctx->iot_reg_data.deviceId,
+				wt_data, &session_present);
 		if (iot_ret != IOT_ERROR_NONE) {
 			IOT_ERROR("failed to connect");
 			goto out;
 		} else {
 			IOT_INFO("MQTT connect success");
+			connected = true;
 		}
 
-		snprintf(topicfilter, IOT_TOPIC_SIZE, IOT_SUB_TOPIC_NOTIFICATION, ctx->iot_reg_data.deviceId);
-		IOT_DEBUG("noti subscribe topic : %s", topicfilter);
-		ret = st_mqtt_subscribe(mqtt_cli, topicfilter, st_mqtt_qos1,
-				_iot_mqtt_noti_sub_callback, ctx);
-		if (ret) {
-			IOT_WARN("subscribe error(%d)", ret);
-			iot_ret = IOT_ERROR_BAD_REQ;
-			_iot_es_mqtt_disconnect(ctx, mqtt_cli);
-			goto out;
-		}
-
-		snprintf(topicfilter, IOT_TOPIC_SIZE, IOT_SUB_TOPIC_COMMAND, ctx->iot_reg_data.deviceId);
-		IOT_DEBUG("cmd subscribe topic : %s", topicfilter);
-		ret = st_mqtt_subscribe(mqtt_cli, topicfilter, st_mqtt_qos1,
-				_iot_mqtt_cmd_sub_callback, ctx);
-		if (ret) {
-			IOT_WARN("failed cmd sub registration(%d)", ret);
-			iot_ret = IOT_ERROR_BAD_REQ;
-			_iot_es_mqtt_disconnect(ctx, mqtt_cli);
-			goto out;
-		}
-
-		ctx->mqtt_event_topic = malloc(IOT_TOPIC_SIZE);
-		if (!ctx->mqtt_event_topic) {
-			IOT_ERROR("failed to malloc for mqtt_event_topic");
-			iot_ret = IOT_ERROR_MEM_ALLOC;
-			_iot_es_mqtt_disconnect(ctx, mqtt_cli);
-			goto out;
+		if (session_present && resumable) {
+			IOT_INFO("session is resumed, skip subscription");
+		} else {
+			IOT_DEBUG("noti subscribe topic : %s", warm->noti_topic);
+			IOT_DEBUG("cmd subscribe topic : %s", warm->cmd_topic);
+			sub_filters[0].topic = warm->noti_topic;
+			sub_filters[0].qos = st_mqtt_qos1;
+			sub_filters[0].handler = _iot_mqtt_noti_sub_callback;
+			sub_filters[0].user_data = ctx;
+			sub_filters[1].topic = warm->cmd_topic;
+			sub_filters[1].qos = st_mqtt_qos1;
+			sub_filters[1].handler = _iot_mqtt_cmd_sub_callback;
+			sub_filters[1].user_data = ctx;
+
+			/* one SUBSCRIBE & SUBACK round trip for both topics */
+			ret = st_mqtt_subscribe_many(mqtt_cli, sub_filters, 2);
+			if (ret) {
+				IOT_WARN("subscribe error(%d)", ret);
+				iot_ret = IOT_ERROR_BAD_REQ;
+				goto out;
+			}
 		}
-		snprintf(ctx->mqtt_event_topic, IOT_TOPIC_SIZE, IOT_PUB_TOPIC_EVENT, ctx->iot_reg_data.deviceId);
 
+		ctx->mqtt_event_topic = warm->event_topic;
 		ctx->evt_mqttcli = mqtt_cli;
 	} else {
 		IOT_INFO("connect_type: registration");
-		iot_ret = _iot_es_mqtt_connect(ctx, mqtt_cli, (char *)dev_sn, wt_data);
+		iot_ret = _iot_es_mqtt_connect(ctx, mqtt_cli, warm->dev_sn, wt_data, NULL);
 		if (iot_ret != IOT_ERROR_NONE) {
 			IOT_ERROR("failed to connect");
 			goto out;
 		} else {
 			IOT_INFO("MQTT connect success");
+			connected = true;
+		}
+
+		topicfilter = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, IOT_TOPIC_SIZE);
+		if (!topicfilter) {
+			IOT_ERROR("failed to malloc topicfilter");
+			iot_ret = IOT_ERROR_MEM_ALLOC;
+			goto out;
 		}
 
 		/* register notification subscribe for registration */
-		snprintf(topicfilter, IOT_TOPIC_SIZE, IOT_SUB_TOPIC_REGISTRATION, dev_sn);
+		snprintf(topicfilter, IOT_TOPIC_SIZE, IOT_SUB_TOPIC_REGISTRATION, warm->dev_sn);
 		IOT_DEBUG("noti subscribe topic : %s", topicfilter);
 		ret = st_mqtt_subscribe(mqtt_cli, topicfilter, st_mqtt_qos1,
 				mqtt_reg_sub_cb, ctx);
 		if (ret) {
 			IOT_ERROR("%s error MQTTsub(%d)", __func__, ret);
 			iot_ret = IOT_ERROR_BAD_REQ;
-			_iot_es_mqtt_disconnect(ctx, mqtt_cli);
 			goto out;
 		}
 
 		iot_ret = _iot_es_mqtt_registration(ctx, mqtt_cli);
 		if (iot_ret != IOT_ERROR_NONE) {
 			IOT_ERROR("failed to register");
-			_iot_es_mqtt_disconnect(ctx, mqtt_cli);
 			goto out;
 		}
 
@@ -670,19 +763,24 @@ iot_error_t iot_es_connect(struct iot_context *ctx, int conn_type)
 	}
 
 out:
-	iot_es_crypto_free_pk(&pk_info);
-
-	if (dev_sn)
-		free((void *)dev_sn);
-
 	if (wt_data)
-		free(wt_data);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, wt_data);
 
 	if (topicfilter)
-		free(topicfilter);
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, topicfilter);
 
-	if (iot_ret)
-		st_mqtt_destroy(mqtt_cli);
+	if (iot_ret) {
+		/* only once, for every failure after MQTT connection is made */
+		if (connected)
+			_iot_es_mqtt_disconnect(ctx, mqtt_cli);
+
+		if (reused && !warm->mqttcli) {
+			/* park it again, handlers of persistent session are kept for the next trial */
+			warm->mqttcli = mqtt_cli;
+		} else {
+			st_mqtt_destroy(mqtt_cli);
+		}
+	}
 
 	return iot_ret;
 }
@@ -698,8 +796,7 @@ iot_error_t iot_es_disconnect(struct iot_context *ctx, int conn_type)
 
 	if (conn_type == IOT_CONNECT_TYPE_COMMUNICATION) {
 		target_cli = ctx->evt_mqttcli;
-		if (ctx->mqtt_event_topic)
-			free(ctx->mqtt_event_topic);
+		/* event topic is owned by ctx->mqtt_warm */
 		ctx->mqtt_event_topic = NULL;
 		ctx->evt_mqttcli = NULL;
 	} else {
@@ -718,7 +815,12 @@ iot_error_t iot_es_disconnect(struct iot_context *ctx, int conn_type)
 
 	_iot_es_mqtt_disconnect(ctx, target_cli);
 
-	st_mqtt_destroy(target_cli);
+	if (conn_type == IOT_CONNECT_TYPE_COMMUNICATION && !ctx->mqtt_warm.mqttcli) {
+		/* park the client, next iot_es_connect() reuses it */
+		ctx->mqtt_warm.mqttcli = target_cli;
+	} else {
+		st_mqtt_destroy(target_cli);
+	}
 
 	return IOT_ERROR_NONE;
 }
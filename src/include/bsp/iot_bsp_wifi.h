@@ -112,7 +112,10 @@ iot_error_t iot_bsp_wifi_set_mode(iot_wifi_conf *conf);
 /**
  * @brief  Get the AP scan result
  *
- * This function get the scan result
+ * This function get the scan result.
+ * Easysetup also calls it while soft-AP is up to refresh the AP list.
+ * A BSP which can't scan in soft-AP mode returns 0 there, and the list
+ * scanned before soft-AP is kept.
  *
  * @param[out] iot_wifi_scan_result_t array to save AP list
  * @return
@@ -82,6 +82,10 @@ static inline JSON_H *JSON_CREATE_NUMBER(double num) {
     return cJSON_CreateNumber(num);
 }
 
+static inline void *JSON_MALLOC(size_t size) {
+    return cJSON_malloc(size);
+}
+
 static inline void JSON_FREE(void *obj) {
     return cJSON_free(obj);
 }
@@ -110,6 +114,7 @@ JSON_H *JSON_GET_ARRAY_ITEM(const JSON_H *array, int index);
 JSON_H *JSON_PARSE(const char *value);
 char *JSON_GET_STRING_VALUE(JSON_H *item);
 JSON_H *JSON_CREATE_NUMBER(double num);
+void *JSON_MALLOC(size_t size);
 void JSON_FREE(void *obj);
 bool JSON_IS_STRING(const JSON_H * const item);
 bool JSON_IS_NUMBER(const JSON_H * const item);
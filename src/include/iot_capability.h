@@ -113,6 +113,16 @@ struct iot_cap_handle {
 	void *init_usr_data;	/**< @brief User data for init_cb. */
 
 	struct iot_context *ctx;	/**< @brief ctx */
+
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+	/**
+	 * @brief Pre-encoded CBOR bytes for invariant part of each deviceEvent.
+	 *
+	 * "component", "capability" pairs of this handle and "attribute" key.
+	 */
+	uint8_t *evt_tmpl;
+	size_t evt_tmpl_len;	/**< @brief Size of evt_tmpl in bytes. */
+#endif
 };
 
 /**
@@ -135,6 +145,7 @@ struct iot_cap_handle_list {
 typedef struct iot_cap_msg {
 	char *msg;	/**< @brief final message for network handling layer such as MQTT */
 	int msglen; /**< @brief final message length */
+	unsigned int trace_seq; /**< @brief latency trace of this message, 0 if not traced */
 } iot_cap_msg_t;
 
 #endif /* _IOT_CAPABILITY_H_ */
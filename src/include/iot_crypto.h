@@ -23,11 +23,13 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include "sodium.h"
 
 #define IOT_ERROR_CRYPTO_BASE64		(IOT_ERROR_CRYPTO_BASE - 1)
 #define IOT_ERROR_CRYPTO_BASE64_URLSAFE	(IOT_ERROR_CRYPTO_BASE - 2)
 #define IOT_ERROR_CRYPTO_SHA256		(IOT_ERROR_CRYPTO_BASE - 10)
+#define IOT_ERROR_CRYPTO_SHA256_INVALID_CTX (IOT_ERROR_CRYPTO_BASE - 11)
 #define IOT_ERROR_CRYPTO_PK_SIGN	(IOT_ERROR_CRYPTO_BASE - 20)
 #define IOT_ERROR_CRYPTO_PK_VERIFY	(IOT_ERROR_CRYPTO_BASE - 21)
 #define IOT_ERROR_CRYPTO_PK_PARSEKEY	(IOT_ERROR_CRYPTO_BASE - 22)
@@ -45,7 +47,9 @@ extern "C" {
 #define IOT_ERROR_CRYPTO_CIPHER_IVLEN	(IOT_ERROR_CRYPTO_BASE - 64)
 #define IOT_ERROR_CRYPTO_CIPHER_OUTSIZE	(IOT_ERROR_CRYPTO_BASE - 65)
 #define IOT_ERROR_CRYPTO_CIPHER_ALIGN	(IOT_ERROR_CRYPTO_BASE - 66)
+#define IOT_ERROR_CRYPTO_CIPHER_INVALID_CTX (IOT_ERROR_CRYPTO_BASE - 67)
 #define IOT_ERROR_CRYPTO_SS_KDF		(IOT_ERROR_CRYPTO_BASE - 80)
+#define IOT_ERROR_CRYPTO_RNG		(IOT_ERROR_CRYPTO_BASE - 90)
 
 #define IOT_CRYPTO_PK_TYPE_RSA		"RSA"
 #define IOT_CRYPTO_PK_TYPE_ED25519	"ED25519"
@@ -54,6 +58,14 @@ extern "C" {
 #define IOT_CRYPTO_SECRET_LEN		32
 #define IOT_CRYPTO_IV_LEN		16
 #define IOT_CRYPTO_SHA256_LEN		32
+#define IOT_CRYPTO_SHA256_BLOCK_LEN	64
+
+/* room for the backend hash state, in 8 byte words */
+#if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SHA256_STATE_WORDS)
+#define IOT_CRYPTO_SHA256_STATE_WORDS	CONFIG_STDK_IOT_CORE_CRYPTO_SHA256_STATE_WORDS
+#else
+#define IOT_CRYPTO_SHA256_STATE_WORDS	32
+#endif
 //#if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_ED25519)
 #define IOT_CRYPTO_SIGNATURE_LEN	64
 //#elif defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_RSA)
@@ -94,15 +106,15 @@ iot_error_t iot_crypto_base64_decode(const unsigned char *src, size_t src_len,
 
 /**
  * @brief	Encode a string as a urlsafe base64 string
- * @details	This function replaces url unsafe characters ('+', '/') to
- *		url safe character ('-', '_')
+ * @details	This function encodes with url safe characters ('-', '_')
+ *		in place of url unsafe characters ('+', '/') and keeps
+ *		the '=' padding
  * @param[in]	src	a pointer to a buffer to encode
  * @param[in]	src_len	the size of buffer pointed by src in bytes
  * @param[out]	dst	a pointer to a buffer to store base64 string
  * @param[in]	dst_len	the size of buffer pointed by dst in bytes
  * @param[out]	out_len	the bytes written to dst
  * @retval	IOT_ERROR_NONE	the string is sucessfully encoded
- * @retval	IOT_ERROR_CRYPTO_BASE64	failed to encode the string in 3rd lib
  * @retval	IOT_ERROR_CRYPTO_BASE64_URLSAFE	failed to encode the string as
  *		urlsafe
  */
@@ -112,14 +124,14 @@ iot_error_t iot_crypto_base64_encode_urlsafe(const unsigned char *src, size_t sr
 
 /**
  * @brief	Decode a urlsafe base64 string as a string
+ * @details	The '=' padding may be left out, '+' and '/' are also accepted
  * @param[in]	src	a pointer to a buffer to decode
  * @param[in]	src_len	the size of buffer pointed by src in bytes
  * @param[out]	dst	a pointer to a buffer to store base64 string
  * @param[in]	dst_len	the size of buffer pointed by dst in bytes
  * @param[out]	out_len	the bytes written to dst
  * @retval	IOT_ERROR_NONE	the string is sucessfully decoded
- * @retval	IOT_ERROR_CRYPTO_BASE64	failed to decode the string
- * @retval	IOT_ERROR_CRYPTO_BASE64_URLSAFE	failed to encode the string as
+ * @retval	IOT_ERROR_CRYPTO_BASE64_URLSAFE	failed to decode the string as
  *		urlsafe
  */
 iot_error_t iot_crypto_base64_decode_urlsafe(const unsigned char *src, size_t src_len,
@@ -136,6 +148,172 @@ iot_error_t iot_crypto_base64_decode_urlsafe(const unsigned char *src, size_t sr
  */
 iot_error_t iot_crypto_sha256(unsigned char *src, size_t src_len, unsigned char *dst);
 
+typedef struct iot_crypto_sha256_ctx iot_crypto_sha256_ctx_t;
+
+/**
+ * @brief Contains sha256 backend function lists.
+ */
+typedef struct iot_crypto_sha256_funcs {
+	const char *name;		/** @brief string name to know this */
+	/**
+	 * @brief a pointer to a function to start a new digest in ctx->state
+	 */
+	iot_error_t (*init)(iot_crypto_sha256_ctx_t *ctx);
+	/**
+	 * @brief a pointer to a function to feed a part of the message
+	 */
+	iot_error_t (*update)(iot_crypto_sha256_ctx_t *ctx,
+				const unsigned char *input, size_t ilen);
+	/**
+	 * @brief a pointer to a function to write the digest and release
+	 *	what init prepared, also on failure
+	 */
+	iot_error_t (*final)(iot_crypto_sha256_ctx_t *ctx, unsigned char *dst);
+	/**
+	 * @brief a pointer to a function to release an unfinished digest,
+	 *	may be null
+	 */
+	void (*free)(iot_crypto_sha256_ctx_t *ctx);
+} iot_crypto_sha256_funcs_t;
+
+/**
+ * @brief Contains a sha256 digest in progress
+ */
+struct iot_crypto_sha256_ctx {
+	const iot_crypto_sha256_funcs_t *fn;/** @brief backend of this digest */
+	/** @brief backend hash state, kept in place to avoid allocation */
+	uint64_t state[IOT_CRYPTO_SHA256_STATE_WORDS];
+};
+
+/**
+ * @brief Contains a HMAC-SHA256 in progress
+ */
+typedef struct iot_crypto_hmac_sha256_ctx {
+	iot_crypto_sha256_ctx_t sha;	/** @brief inner digest */
+	/** @brief key xor opad for the outer digest */
+	unsigned char okey[IOT_CRYPTO_SHA256_BLOCK_LEN];
+} iot_crypto_hmac_sha256_ctx_t;
+
+/**
+ * @brief	Replace the sha256 backend
+ * @details	Lets a port hand sha256 to a hardware accelerator. Digests
+ *		started later use the new backend, so it should be set
+ *		before the device is started.
+ * @param[in]	fn	a pointer to backend functions, null to restore
+ *		the default backend
+ * @retval	IOT_ERROR_NONE	backend is replaced
+ * @retval	IOT_ERROR_INVALID_ARGS	init, update or final is null
+ */
+iot_error_t iot_crypto_sha256_set_funcs(const iot_crypto_sha256_funcs_t *fn);
+
+/**
+ * @brief	Get the current sha256 backend
+ * @retval	a pointer to backend functions, null if there is no backend
+ */
+const iot_crypto_sha256_funcs_t *iot_crypto_sha256_get_funcs(void);
+
+/**
+ * @brief	Start a sha256 digest
+ * @param[out]	ctx	a pointer to a digest context to start
+ * @retval	IOT_ERROR_NONE	digest is started
+ * @retval	IOT_ERROR_INVALID_ARGS	ctx is null
+ * @retval	IOT_ERROR_CRYPTO_SHA256	no backend or backend failure
+ */
+iot_error_t iot_crypto_sha256_init(iot_crypto_sha256_ctx_t *ctx);
+
+/**
+ * @brief	Feed a part of the message to a sha256 digest
+ * @param[in]	ctx	a pointer to a started digest context
+ * @param[in]	input	a pointer to a part of the message
+ * @param[in]	ilen	the size of buffer pointed by input in bytes
+ * @retval	IOT_ERROR_NONE	input is consumed
+ * @retval	IOT_ERROR_INVALID_ARGS	ctx is null or input is null
+ * @retval	IOT_ERROR_CRYPTO_SHA256_INVALID_CTX digest is not started
+ * @retval	IOT_ERROR_CRYPTO_SHA256	backend failure
+ */
+iot_error_t iot_crypto_sha256_update(iot_crypto_sha256_ctx_t *ctx,
+			const unsigned char *input, size_t ilen);
+
+/**
+ * @brief	Finish a sha256 digest
+ * @details	The context is released, also on failure, and can be
+ *		started again.
+ * @param[in]	ctx	a pointer to a started digest context
+ * @param[out]	dst	a pointer to a buffer of IOT_CRYPTO_SHA256_LEN bytes
+ * @retval	IOT_ERROR_NONE	digest is written
+ * @retval	IOT_ERROR_INVALID_ARGS	ctx or dst is null
+ * @retval	IOT_ERROR_CRYPTO_SHA256_INVALID_CTX digest is not started
+ * @retval	IOT_ERROR_CRYPTO_SHA256	backend failure
+ */
+iot_error_t iot_crypto_sha256_final(iot_crypto_sha256_ctx_t *ctx, unsigned char *dst);
+
+/**
+ * @brief	Abandon an unfinished sha256 digest
+ * @details	Safe to call on a zeroed or already finished context.
+ * @param[in]	ctx	a pointer to a digest context
+ */
+void iot_crypto_sha256_free(iot_crypto_sha256_ctx_t *ctx);
+
+/**
+ * @brief	Start a HMAC-SHA256
+ * @param[out]	ctx	a pointer to a HMAC context to start
+ * @param[in]	key	a pointer to a key, hashed first if longer than
+ *		IOT_CRYPTO_SHA256_BLOCK_LEN
+ * @param[in]	key_len	the size of buffer pointed by key in bytes
+ * @retval	IOT_ERROR_NONE	HMAC is started
+ * @retval	IOT_ERROR_INVALID_ARGS	ctx is null or key is null with key_len
+ * @retval	IOT_ERROR_CRYPTO_SHA256	no backend or backend failure
+ */
+iot_error_t iot_crypto_hmac_sha256_init(iot_crypto_hmac_sha256_ctx_t *ctx,
+			const unsigned char *key, size_t key_len);
+
+/**
+ * @brief	Feed a part of the message to a HMAC-SHA256
+ * @param[in]	ctx	a pointer to a started HMAC context
+ * @param[in]	input	a pointer to a part of the message
+ * @param[in]	ilen	the size of buffer pointed by input in bytes
+ * @retval	IOT_ERROR_NONE	input is consumed
+ * @retval	IOT_ERROR_INVALID_ARGS	ctx is null or input is null
+ * @retval	IOT_ERROR_CRYPTO_SHA256_INVALID_CTX HMAC is not started
+ * @retval	IOT_ERROR_CRYPTO_SHA256	backend failure
+ */
+iot_error_t iot_crypto_hmac_sha256_update(iot_crypto_hmac_sha256_ctx_t *ctx,
+			const unsigned char *input, size_t ilen);
+
+/**
+ * @brief	Finish a HMAC-SHA256
+ * @details	The context is released, also on failure.
+ * @param[in]	ctx	a pointer to a started HMAC context
+ * @param[out]	dst	a pointer to a buffer of IOT_CRYPTO_SHA256_LEN bytes
+ * @retval	IOT_ERROR_NONE	mac is written
+ * @retval	IOT_ERROR_INVALID_ARGS	ctx or dst is null
+ * @retval	IOT_ERROR_CRYPTO_SHA256_INVALID_CTX HMAC is not started
+ * @retval	IOT_ERROR_CRYPTO_SHA256	backend failure
+ */
+iot_error_t iot_crypto_hmac_sha256_final(iot_crypto_hmac_sha256_ctx_t *ctx,
+			unsigned char *dst);
+
+/**
+ * @brief	Abandon an unfinished HMAC-SHA256
+ * @details	Safe to call on a zeroed or already finished context.
+ * @param[in]	ctx	a pointer to a HMAC context
+ */
+void iot_crypto_hmac_sha256_free(iot_crypto_hmac_sha256_ctx_t *ctx);
+
+/**
+ * @brief	Generate a HMAC-SHA256 of a message in one call
+ * @param[in]	key	a pointer to a key
+ * @param[in]	key_len	the size of buffer pointed by key in bytes
+ * @param[in]	input	a pointer to a message
+ * @param[in]	ilen	the size of buffer pointed by input in bytes
+ * @param[out]	dst	a pointer to a buffer of IOT_CRYPTO_SHA256_LEN bytes
+ * @retval	IOT_ERROR_NONE	mac is written
+ * @retval	IOT_ERROR_INVALID_ARGS	a pointer is null
+ * @retval	IOT_ERROR_CRYPTO_SHA256	no backend or backend failure
+ */
+iot_error_t iot_crypto_hmac_sha256(const unsigned char *key, size_t key_len,
+			const unsigned char *input, size_t ilen, unsigned char *dst);
+
 /*
  * Public Key based operations
  */
@@ -167,6 +345,16 @@ typedef struct iot_crypto_pk_info {
  */
 typedef struct iot_crypto_pk_funcs {
 	const char *name;		/** @brief string name to know this */
+	/**
+	 * @brief a pointer to a function to prepare key material once,
+	 *	may be null
+	 */
+	iot_error_t (*init)(iot_crypto_pk_context_t *ctx);
+	/**
+	 * @brief a pointer to a function to release what init prepared,
+	 *	may be null
+	 */
+	void (*free)(iot_crypto_pk_context_t *ctx);
 	/**
 	 * @brief a pointer to a function to create a signature
 	 */
@@ -187,8 +375,19 @@ typedef struct iot_crypto_pk_funcs {
 struct iot_crypto_pk_context {
 	iot_crypto_pk_info_t *info;	/** @brief a pointer to a key pair info */
 	const iot_crypto_pk_funcs_t *fn;/** @brief a pointer to a function lists */
+	void *key;			/** @brief key material prepared by init */
 };
 
+/**
+ * @brief Contains one input and its signature for batch signing
+ */
+typedef struct iot_crypto_pk_sign_req {
+	unsigned char *input;		/** @brief a pointer to data to sign */
+	size_t ilen;			/** @brief length of data to sign */
+	unsigned char *sig;		/** @brief a pointer to a buffer for signature */
+	size_t slen;			/** @brief bytes written to sig */
+} iot_crypto_pk_sign_req_t;
+
 /**
  * @brief Contains public and private keys for Ed25519
  */
@@ -235,6 +434,9 @@ typedef struct iot_crypto_ecdh_params {
 
 /**
  * @brief	Initialize a context by passed private key data
+ * @details	Key material is parsed and prepared here, so a context can
+ *		be kept and used for many signatures. info must stay valid
+ *		until iot_crypto_pk_free() is called.
  * @param[in]	ctx	a pointer to a buffer to handle crypto context
  * @param[in]	info	a pointer to a buffer containing private key data
  * @retval	IOT_ERROR_NONE	context is sucessfully initialized
@@ -242,12 +444,16 @@ typedef struct iot_crypto_ecdh_params {
  * @retval	IOT_ERROR_CRYPTO_PK_INVALID_ARG	info is null
  * @retval	IOT_ERROR_CRYPTO_PK_UNKNOWN_KEYTYPE	private key data has
  *		not supported algorithm
+ * @retval	IOT_ERROR_CRYPTO_PK_PARSEKEY	failed to parse private key
+ * @retval	IOT_ERROR_MEM_ALLOC	failed to alloc buffer for key material
  */
 iot_error_t iot_crypto_pk_init(iot_crypto_pk_context_t *ctx,
                                iot_crypto_pk_info_t *info);
 
 /**
  * @brief	Cleanup the context
+ * @details	Prepared key material is wiped and released. Key data
+ *		pointed by info is not touched.
  * @param[in]	ctx	a pointer to a buffer to cleanup
  */
 void iot_crypto_pk_free(iot_crypto_pk_context_t *ctx);
@@ -291,6 +497,25 @@ iot_error_t iot_crypto_pk_verify(iot_crypto_pk_context_t *ctx,
                                  unsigned char *input, size_t ilen,
                                  unsigned char *sig, size_t slen);
 
+/**
+ * @brief	Generate signatures of several inputs with one context
+ * @details	Requests are signed in order and it stops at the first
+ *		failure. The context is not locked, so callers sharing a
+ *		context between tasks have to serialize the calls.
+ * @param[in]	ctx	a pointer to a buffer containing crypto context
+ * @param[in,out]	reqs	an array of requests, slen of each is filled
+ * @param[in]	count	the number of requests in reqs
+ * @param[out]	done	the number of signed requests, may be null
+ * @retval	IOT_ERROR_NONE	all signatures are sucessfully generated
+ * @retval	IOT_ERROR_CRYPTO_PK_INVALID_CTX	ctx is null
+ * @retval	IOT_ERROR_CRYPTO_PK_INVALID_ARG	reqs is null or has null buffer
+ * @retval	IOT_ERROR_CRYPTO_PK_NULL_FUNC	sign function is not implemented
+ * @retval	IOT_ERROR_CRYPTO_PK_SIGN	failed to generate signature
+ */
+iot_error_t iot_crypto_pk_sign_batch(iot_crypto_pk_context_t *ctx,
+                                     iot_crypto_pk_sign_req_t *reqs, size_t count,
+                                     size_t *done);
+
 /**
  * @brief	Prepare a buffer to store the ed25519 and curve25519 keypair
  * @param[in]	kp	a pointer to a structure of the keypair buffers
@@ -359,6 +584,36 @@ iot_error_t iot_crypto_ed25519_convert_seckey(unsigned char *ed25519_key,
 iot_error_t iot_crypto_ecdh_gen_master_secret(unsigned char *master,
 			size_t mlen, iot_crypto_ecdh_params_t *params);
 
+/*
+ * Random number generation
+ */
+
+/**
+ * @brief	Fill a buffer with random bytes
+ * @details	Bytes are drawn from the process wide DRBG which is seeded
+ *		from the entropy source on first use and reseeded
+ *		periodically. It is safe to call from any task.
+ * @param[out]	buf	a pointer to a buffer to fill
+ * @param[in]	len	the size of buffer pointed by buf in bytes
+ * @retval	IOT_ERROR_NONE	the buffer is sucessfully filled
+ * @retval	IOT_ERROR_INVALID_ARGS	buf is null or len is zero
+ * @retval	IOT_ERROR_CRYPTO_RNG	failed to seed or to draw from DRBG
+ */
+iot_error_t iot_crypto_random(unsigned char *buf, size_t len);
+
+/**
+ * @brief	Random callback over the process wide DRBG
+ * @details	This has the f_rng prototype of the crypto backend, so that
+ *		ECDH, signing and TLS can be given the shared DRBG instead
+ *		of seeding one of their own.
+ * @param[in]	p_rng	unused, may be null
+ * @param[out]	buf	a pointer to a buffer to fill
+ * @param[in]	len	the size of buffer pointed by buf in bytes
+ * @retval	0	the buffer is sucessfully filled
+ * @retval	non-zero	backend error code
+ */
+int iot_crypto_rng(void *p_rng, unsigned char *buf, size_t len);
+
 /*
  * Symmetric Key based operations
  */
@@ -440,6 +695,95 @@ iot_error_t iot_crypto_cipher_aes(iot_crypto_cipher_info_t *info,
 			unsigned char *input, size_t ilen,
 			unsigned char *out, size_t *olen, size_t osize);
 
+/**
+ * @brief Contains a cipher session keyed once for many messages
+ */
+typedef struct iot_crypto_cipher_ctx {
+	/**
+	 * @brief type of cipher algorithm
+	 */
+	iot_crypto_cipher_type_t type;
+	/**
+	 * @brief backend cipher state, null until the session is initialized
+	 */
+	void *state;
+} iot_crypto_cipher_ctx_t;
+
+/**
+ * @brief	Initialize a cipher session
+ * @details	Sets up the backend cipher and expands the key of info once
+ *		for both directions, so that following messages only have
+ *		to load their IV. info->mode and info->iv are not used here.
+ * @param[out]	ctx	a pointer to a cipher session to initialize
+ * @param[in]	info	a pointer to cipher informations holding the key
+ * @retval	IOT_ERROR_NONE	session is ready
+ * @retval	IOT_ERROR_CRYPTO_CIPHER_UNKNOWN_TYPE not supported cipher
+ * @retval	IOT_ERROR_CRYPTO_CIPHER_KEYLEN	key length is wrong
+ * @retval	IOT_ERROR_CRYPTO_CIPHER	failed to set up the backend cipher
+ */
+iot_error_t iot_crypto_cipher_init(iot_crypto_cipher_ctx_t *ctx,
+			iot_crypto_cipher_info_t *info);
+
+/**
+ * @brief	Start a new message on a cipher session
+ * @param[in]	ctx	a pointer to an initialized cipher session
+ * @param[in]	mode	direction of the message
+ * @param[in]	iv	a pointer to a IV for the message
+ * @param[in]	iv_len	the size of buffer pointed by iv in bytes
+ * @retval	IOT_ERROR_NONE	message is started
+ * @retval	IOT_ERROR_CRYPTO_CIPHER_INVALID_CTX session is not initialized
+ * @retval	IOT_ERROR_CRYPTO_CIPHER_UNKNOWN_MODE invalid cipher mode
+ * @retval	IOT_ERROR_CRYPTO_CIPHER_IVLEN	iv length is wrong
+ */
+iot_error_t iot_crypto_cipher_start(iot_crypto_cipher_ctx_t *ctx,
+			iot_crypto_cipher_mode_t mode,
+			const unsigned char *iv, size_t iv_len);
+
+/**
+ * @brief	Feed a part of the message to a started cipher session
+ * @details	Input doesn't have to be block aligned, incomplete blocks are
+ *		kept in the session until more input or finish arrives.
+ *		An output buffer of ilen + IOT_CRYPTO_IV_LEN bytes is
+ *		always large enough.
+ * @param[in]	ctx	a pointer to a started cipher session
+ * @param[in]	input	a pointer to a buffer to encrypt/decrypt
+ * @param[in]	ilen	the size of buffer pointed by input in bytes
+ * @param[out]	out	a pointer to a buffer to store the result
+ * @param[out]	olen	the bytes written to out
+ * @param[in]	osize	the size of buffer pointed by out in bytes
+ * @retval	IOT_ERROR_NONE	input is consumed
+ * @retval	IOT_ERROR_CRYPTO_CIPHER_INVALID_CTX session is not started
+ * @retval	IOT_ERROR_CRYPTO_CIPHER_OUTSIZE	output buffer is too small
+ * @retval	IOT_ERROR_CRYPTO_CIPHER	failed while encrypting/decrypting
+ */
+iot_error_t iot_crypto_cipher_update(iot_crypto_cipher_ctx_t *ctx,
+			const unsigned char *input, size_t ilen,
+			unsigned char *out, size_t *olen, size_t osize);
+
+/**
+ * @brief	Finish the current message of a cipher session
+ * @details	Writes the padded last block on encryption or the last
+ *		block with its padding removed on decryption.
+ * @param[in]	ctx	a pointer to a started cipher session
+ * @param[out]	out	a pointer to a buffer to store the result
+ * @param[out]	olen	the bytes written to out
+ * @param[in]	osize	the size of buffer pointed by out in bytes, at
+ *		least IOT_CRYPTO_IV_LEN
+ * @retval	IOT_ERROR_NONE	message is finished
+ * @retval	IOT_ERROR_CRYPTO_CIPHER_INVALID_CTX session is not started
+ * @retval	IOT_ERROR_CRYPTO_CIPHER_OUTSIZE	output buffer is too small
+ * @retval	IOT_ERROR_CRYPTO_CIPHER	bad padding or backend failure
+ */
+iot_error_t iot_crypto_cipher_finish(iot_crypto_cipher_ctx_t *ctx,
+			unsigned char *out, size_t *olen, size_t osize);
+
+/**
+ * @brief	Free a cipher session
+ * @details	Safe to call on a zeroed or already freed session.
+ * @param[in]	ctx	a pointer to a cipher session
+ */
+void iot_crypto_cipher_free(iot_crypto_cipher_ctx_t *ctx);
+
 /**
  * @brief	Encryption of the input data
  * @details	The encryption key is generated from device unique value
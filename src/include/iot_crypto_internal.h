@@ -31,6 +31,10 @@ extern const iot_crypto_pk_funcs_t iot_crypto_pk_rsa_funcs;
 extern const iot_crypto_pk_funcs_t iot_crypto_pk_ed25519_funcs;
 //#endif
 
+#if defined(CONFIG_STDK_IOT_CORE_USE_MBEDTLS)
+extern const iot_crypto_sha256_funcs_t iot_crypto_sha256_mbedtls_funcs;
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -153,6 +153,74 @@ iot_error_t iot_easysetup_init(struct iot_context *ctx);
  */
 void iot_easysetup_deinit(struct iot_context *ctx);
 
+/**
+ * @brief	Start wifi scan cache for easy-setup
+ * @details	This function scans once in place, same as before soft-ap comes up, then
+ * 		a background task scans again every STDK_IOT_CORE_EASYSETUP_WIFI_SCAN_INTERVAL ms.<br>
+ * 		Each scan is merged and serialized as wifiScanInfo before it's published.
+ * @param[in]	ctx	iot_context handle
+ * @return	iot_error_t
+ * @retval	IOT_ERROR_NONE		success
+ */
+iot_error_t iot_easysetup_scan_start(struct iot_context *ctx);
+
+/**
+ * @brief	Stop wifi scan cache
+ * @details	This function waits for a scan in progress, up to a while, then frees the cache.
+ * @param[in]	ctx	iot_context handle
+ * @return	void
+ */
+void iot_easysetup_scan_stop(struct iot_context *ctx);
+
+/**
+ * @brief	Get the latest wifi scan list
+ * @details	This function copies the latest list into ctx->scan_result, the list wifi provisioning
+ * 		is checked against. With freeze, background scan stops so the list won't change anymore.
+ * @param[in]	ctx		iot_context handle
+ * @param[in]	freeze		stop refreshing the list
+ * @param[out]	generation	generation of the list
+ * @param[out]	json		copy of wifiScanInfo, free with JSON_FREE. NULL to skip,
+ * 				left NULL when payload is returned
+ * @param[out]	payload		copy of encrypted response of this generation if any, free with JSON_FREE. NULL to skip
+ * @return	iot_error_t
+ * @retval	IOT_ERROR_NONE				success
+ * @retval	IOT_ERROR_EASYSETUP_WIFI_SCAN_NOT_FOUND	no ap has been found yet
+ */
+iot_error_t iot_easysetup_scan_get(struct iot_context *ctx, bool freeze,
+		unsigned int *generation, char **json, char **payload);
+
+/**
+ * @brief	Keep encrypted response of a scan list
+ * @param[in]	ctx		iot_context handle
+ * @param[in]	generation	generation the payload is made from
+ * @param[in]	payload		encrypted response to copy, NULL to drop the kept one
+ * @return	void
+ */
+void iot_easysetup_scan_set_payload(struct iot_context *ctx, unsigned int generation, const char *payload);
+
+/**
+ * @brief	Merge wifi scan results
+ * @details	Duplicated BSSIDs are dropped and APs of the same SSID are merged into the
+ * 		first one found, with BSSID, RSSI, frequency and auth mode of the strongest.
+ * 		Hidden APs are only merged by BSSID.
+ * @param[in,out]	list	scan results
+ * @param[in]		num	number of scan results
+ * @return	number of scan results left
+ */
+uint16_t iot_easysetup_scan_merge(iot_wifi_scan_result_t *list, uint16_t num);
+
+/**
+ * @brief	Serialize wifi scan results as wifiScanInfo
+ * @details	APs of unsupported auth mode are left out.
+ * @param[in]	list	scan results
+ * @param[in]	num	number of scan results
+ * @param[out]	json	{"wifiScanInfo":[...]}, free with JSON_FREE
+ * @return	iot_error_t
+ * @retval	IOT_ERROR_NONE				success
+ * @retval	IOT_ERROR_EASYSETUP_JSON_CREATE_ERROR	error
+ */
+iot_error_t iot_easysetup_scan_serialize(const iot_wifi_scan_result_t *list, uint16_t num, char **json);
+
 #ifdef __cplusplus
 }
 #endif
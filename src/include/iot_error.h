@@ -66,6 +66,7 @@ typedef enum iot_error_t {
 	IOT_ERROR_MQTT_SERVER_UNAVAIL = -202,
 	IOT_ERROR_MQTT_PUBLISH_FAIL = -203,
 	IOT_ERROR_MQTT_REJECT_CONNECT = -204,
+	IOT_ERROR_MQTT_REJECT_PUBLISH = -205,
 
 	IOT_ERROR_NET_INVALID_INTERFACE = -300,
 	IOT_ERROR_NET_CONNECT = -301,
@@ -29,6 +29,7 @@
 #define IOT_TASK_PRIORITY (4)
 #define IOT_QUEUE_LENGTH (10)
 #define IOT_PUB_QUEUE_LENGTH (10)
+#define IOT_PUB_BATCH_MAX (4)
 
 #define IOT_TOPIC_SIZE (100)
 #define IOT_PAYLOAD_SIZE (1024)
@@ -232,13 +233,22 @@ iot_error_t iot_es_connect(struct iot_context *ctx, int conn_type);
 
 /**
  * @brief	easy setup disconnect
- * @details	this function tries to disconnect server for registration or communication process
+ * @details	this function tries to disconnect server for registration or communication process.
+ *		mqtt client of communication is kept for warm reconnect by next iot_es_connect()
  * @param[in]	ctx		iot-core context
  * @param[in]	conn_type	set connection type. registration or communication with server
  * @retval	IOT_ERROR_NONE	success.
  */
 iot_error_t iot_es_disconnect(struct iot_context *ctx, int conn_type);
 
+/**
+ * @brief	release warm reconnect data
+ * @details	this function frees the parked mqtt client, loaded key, serial number,
+ *		root certificate and topics kept for warm reconnect of communication
+ * @param[in]	ctx		iot-core context
+ */
+void iot_es_release_warm_data(struct iot_context *ctx);
+
 /**
  * @brief	initialize the buffer for pubkey information
  * @details	this function uses to initialize
@@ -267,16 +277,19 @@ void iot_es_crypto_free_pk(iot_crypto_pk_info_t *pk_info);
  * @details	this function is used to handle command message from server
  * @param[in]	cap_handle_list		allocated capability handle list
  * @param[in]	payload			received raw message from server
+ * @param[in]	trace_seq		latency trace of the message, 0 if not traced
  */
-void iot_cap_sub_cb(iot_cap_handle_list_t *cap_handle_list, char *payload);
+void iot_cap_sub_cb(iot_cap_handle_list_t *cap_handle_list, char *payload,
+		unsigned int trace_seq);
 
 /**
  * @brief	callback for mqtt noti msg
  * @details	this function is used to handle notification message from server
  * @param[in]	ctx		iot-core context
  * @param[in]	payload		received raw message from server
+ * @param[in]	payload_len	length of payload in bytes
  */
-void iot_noti_sub_cb(struct iot_context *ctx, char *payload);
+void iot_noti_sub_cb(struct iot_context *ctx, char *payload, size_t payload_len);
 
 /**
  * @brief	call init callback
@@ -313,5 +326,13 @@ iot_error_t iot_get_time_in_sec_by_long(long *sec);
  */
 iot_error_t iot_get_time_in_ms(char *buf, size_t buf_len);
 
+/**
+ * @brief	get time data in msec by 64bit value
+ * @details	this function tries to get time value in millisecond without string formatting
+ * @param[out]	msec		point to contain millisecond based value
+ * @retval	IOT_ERROR_NONE                  success.
+ */
+iot_error_t iot_get_time_in_ms_by_long(uint64_t *msec);
+
 #endif /* _IOT_INTERNAL_H_ */
 
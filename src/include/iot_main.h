@@ -188,6 +188,59 @@ struct iot_registered_data {
 	bool new_reged;								/**< @brief reflect that it is new registration process or not */
 };
 
+#define IOT_MQTT_CLIENT_ID_LEN		(40)
+
+/**
+ * @brief Contains connection data kept over reconnection (warm reconnect)
+ */
+struct iot_mqtt_warm_data {
+	bool loaded;						/**< @brief serial number, key, root cert & client id are loaded */
+	char *dev_sn;						/**< @brief device serial number */
+	size_t dev_sn_len;					/**< @brief length of device serial number */
+	iot_crypto_pk_info_t pk_info;		/**< @brief device key pair to sign web token */
+	iot_crypto_pk_context_t pk_ctx;		/**< @brief signing context prepared once from pk_info */
+	char *root_cert;					/**< @brief root certificate for server */
+	size_t root_cert_len;				/**< @brief length of root certificate */
+	char client_id[IOT_MQTT_CLIENT_ID_LEN];	/**< @brief mac based random client id */
+
+	char device_id[IOT_REG_UUID_STR_LEN + 1];	/**< @brief device id which topics are made for */
+	char *noti_topic;					/**< @brief subscribe topic for notification */
+	char *cmd_topic;					/**< @brief subscribe topic for command */
+	char *event_topic;					/**< @brief publish topic for event */
+
+	st_mqtt_client mqttcli;				/**< @brief parked MQTT client of last communication connection */
+	bool persistent_session;			/**< @brief connect with cleansession 0 for communication */
+};
+
+/**
+ * @brief Contains wifi scan results kept fresh in background for easy-setup
+ */
+struct iot_wifi_scan_cache {
+	iot_os_mutex lock;					/**< @brief guards the cache between iot-task and scan task */
+	bool running;						/**< @brief scan task still refers to the cache */
+	bool stop;							/**< @brief scan task should quit */
+	bool orphan;						/**< @brief scan task frees the cache as it quits */
+	bool frozen;						/**< @brief list is in use by the mobile, no more refresh */
+	unsigned int generation;			/**< @brief bumped by each published scan, 0 before any */
+	uint16_t num;						/**< @brief number of merged scan results */
+	iot_wifi_scan_result_t list[IOT_WIFI_MAX_SCAN_RESULT];	/**< @brief merged scan results */
+	iot_wifi_scan_result_t scan[IOT_WIFI_MAX_SCAN_RESULT];	/**< @brief scan task's own buffer */
+	char *json;							/**< @brief wifiScanInfo serialized from list */
+	char *payload;						/**< @brief encrypted response made from json */
+	unsigned int payload_generation;	/**< @brief generation which payload was made from */
+};
+
+/**
+ * @brief Contains reconnect delay data for decorrelated jitter backoff
+ */
+struct iot_backoff {
+	unsigned int base_ms;		/**< @brief minimum delay */
+	unsigned int cap_ms;		/**< @brief maximum delay */
+	unsigned int prev_ms;		/**< @brief last returned delay */
+	unsigned int floor_ms;		/**< @brief one-shot minimum delay hinted by server */
+	unsigned int attempts;		/**< @brief delays returned since last reset */
+};
+
 /**
  * @brief Contains "device's information" data
  */
@@ -227,18 +280,27 @@ struct iot_context {
 	st_mqtt_client evt_mqttcli;			/**< @brief SmartThings MQTT Client for event & commands */
 	st_mqtt_client reg_mqttcli;			/**< @brief SmartThings MQTT Client for registration */
 	char *mqtt_event_topic;				/**< @brief mqtt topic for event publish */
+	struct iot_mqtt_warm_data mqtt_warm;	/**< @brief connection data reused for warm reconnect */
+
+	struct iot_backoff reconn_backoff;	/**< @brief reconnect delay state for communication connection */
+	iot_os_timer reconn_timer;			/**< @brief pending reconnect delay, or connection stability time while connected */
+	unsigned int reconn_delay_ms;		/**< @brief delay to apply on next CLOUD_CONNECTING command */
+	bool reconn_pending;				/**< @brief delayed CLOUD_CONNECTING is waiting for reconn_timer */
+	bool steady_mem_checked;			/**< @brief memory is reported once events flow on this connection */
 
 	struct iot_device_prov_data prov_data;	/**< @brief allocated device provisioning data */
 	struct iot_devconf_prov_data devconf;	/**< @brief allocated device configuration data */
 	struct iot_device_info device_info;		/**< @brief allocated device information data */
 
 	iot_crypto_cipher_info_t *es_crypto_cipher_info;	/**< @brief cipher context ref. for easy-setup process */
+	iot_crypto_cipher_ctx_t es_crypto_cipher_ctx;	/**< @brief cipher session keyed from es_crypto_cipher_info */
 
 	struct iot_registered_data iot_reg_data;	/**< @brief allocated registration data from server */
 	void *es_httpd_handle;						/**< @brief httpd handler for easy-setup process */
 
 	uint16_t scan_num;						/**< @brief number of wifi ap scan result */
 	iot_wifi_scan_result_t *scan_result;	/**< @brief actual data lists of each wifi ap scan result */
+	struct iot_wifi_scan_cache *scan_cache;	/**< @brief background scan results while easy-setup */
 	char *lookup_id;						/**< @brief device's lookup id for server & mobile side notification */
 
 	st_cap_noti_cb noti_cb;		/**< @brief notification handling callback for each capability */
@@ -255,6 +317,15 @@ struct iot_context {
 	unsigned int cmd_err;						/**< @brief current command handling error checking value */
 	unsigned int cmd_status;					/**< @brief current command status */
 	uint16_t cmd_count[IOT_COMMAND_TYPE_MAX];	/**< @brief current queued command counts */
+
+	uint32_t evt_sqnum;		/**< @brief last allocated event sequence number, updated atomically */
+
+	st_conn_stats_t conn_stats;		/**< @brief core counters for st_conn_get_stats, updated atomically */
+	st_mqtt_stats mqtt_stats;		/**< @brief counters of communication MQTT clients, updated atomically */
+	unsigned int pub_queue_depth;	/**< @brief events in pub_queue, updated atomically */
+#if defined(CONFIG_STDK_IOT_CORE_CONN_STATS_REPORT)
+	iot_os_timer stats_timer;		/**< @brief period to print the counters */
+#endif
 };
 
 #endif /* _IOT_MAIN_H_ */
@@ -0,0 +1,134 @@
+/* ***************************************************************************
+ *
+ * Copyright 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#ifndef _IOT_MEM_H_
+#define _IOT_MEM_H_
+
+#include <stddef.h>
+#include "iot_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Subsystem which owns an allocation
+ */
+typedef enum iot_mem_tag {
+	IOT_MEM_TAG_CORE = 0,	/**< @brief context, api and util */
+	IOT_MEM_TAG_CAP,	/**< @brief capability handles, events and commands */
+	IOT_MEM_TAG_MQTT,	/**< @brief mqtt client and packet buffers */
+	IOT_MEM_TAG_EASYSETUP,	/**< @brief easysetup and registration */
+	IOT_MEM_TAG_NV,		/**< @brief nv data read from the file system */
+	IOT_MEM_TAG_CRYPTO,	/**< @brief crypto, keys and web tokens */
+	IOT_MEM_TAG_MAX,
+} iot_mem_tag_t;
+
+/**
+ * @brief Heap backend of the allocator
+ */
+typedef struct iot_mem_allocator {
+	void *(*alloc)(size_t size);	/**< @brief allocate size bytes, NULL on failure */
+	void (*dealloc)(void *ptr);	/**< @brief free a pointer returned by alloc */
+} iot_mem_allocator_t;
+
+/**
+ * @brief Allocation counters of one tag
+ */
+typedef struct iot_mem_stats {
+	unsigned int live;		/**< @brief allocations not freed yet */
+	unsigned int peak;		/**< @brief maximum of live */
+	unsigned int alloc_cnt;		/**< @brief allocations since boot */
+	unsigned int pool_cnt;		/**< @brief allocations served by the pools */
+	unsigned int fail_cnt;		/**< @brief failed allocations */
+	size_t alloc_bytes;		/**< @brief bytes requested since boot */
+} iot_mem_stats_t;
+
+/**
+ * @brief	Replace the heap backend
+ * @details	Every allocation which isn't served by the pools goes to this backend.
+ * The default backend is iot_os_malloc and iot_os_free. It must be set before
+ * any allocation, because pointers are freed with the backend of the time.
+ * @param[in]	allocator	heap backend to use, NULL restores the default one
+ */
+void iot_mem_set_allocator(const iot_mem_allocator_t *allocator);
+
+/**
+ * @brief	Allocate memory
+ * @details	Small sizes are served from the size-class pools when
+ * CONFIG_STDK_IOT_CORE_MEM_POOL is enabled, the others from the heap backend.
+ * @param[in]	tag	subsystem which owns the memory
+ * @param[in]	size	bytes to allocate
+ * @return	pointer to the memory, NULL on failure
+ */
+void *iot_mem_malloc(iot_mem_tag_t tag, size_t size);
+
+/**
+ * @brief	Allocate zero-filled memory for an array
+ * @param[in]	tag	subsystem which owns the memory
+ * @param[in]	nmemb	count of elements
+ * @param[in]	size	bytes of an element
+ * @return	pointer to the memory, NULL on failure
+ */
+void *iot_mem_calloc(iot_mem_tag_t tag, size_t nmemb, size_t size);
+
+/**
+ * @brief	Change the size of memory
+ * @details	Contents are kept up to the smaller of old_size and size.
+ * The backend has no realloc, so old_size must be given by the caller.
+ * On failure ptr is left untouched.
+ * @param[in]	tag	subsystem which owns the memory
+ * @param[in]	ptr	memory from iot_mem_malloc, or NULL
+ * @param[in]	old_size	bytes currently allocated for ptr
+ * @param[in]	size	new size in bytes
+ * @return	pointer to the resized memory, NULL on failure
+ */
+void *iot_mem_realloc(iot_mem_tag_t tag, void *ptr, size_t old_size, size_t size);
+
+/**
+ * @brief	Duplicate a string
+ * @param[in]	tag	subsystem which owns the memory
+ * @param[in]	src	null-terminated string to duplicate
+ * @return	pointer to the new string, NULL on failure
+ */
+char *iot_mem_strdup(iot_mem_tag_t tag, const char *src);
+
+/**
+ * @brief	Free memory
+ * @details	Memory allocated by the libraries (cJSON, tinycbor...) must be
+ * freed with their own free function, not with this one.
+ * @param[in]	tag	subsystem which allocated the memory
+ * @param[in]	ptr	memory to free, NULL is ignored
+ */
+void iot_mem_free(iot_mem_tag_t tag, void *ptr);
+
+/**
+ * @brief	Get the allocation counters of a tag
+ * @details	Allocation rate can be derived from two alloc_cnt samples.
+ * @param[in]	tag	subsystem to query
+ * @param[out]	stats	counters of the tag
+ * @return	IOT_ERROR_NONE on success, IOT_ERROR_INVALID_ARGS on wrong parameters,
+ *		IOT_ERROR_MEM_ALLOC when the lock can't be created
+ */
+iot_error_t iot_mem_get_stats(iot_mem_tag_t tag, iot_mem_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IOT_MEM_H_ */
@@ -75,10 +75,32 @@ typedef struct st_mqtt_msg {
 
 	int qos;						/**< @brief MQTT publish packet QoS */
 	unsigned char retained;			/**< @brief MQTT publish packet retained */
+	unsigned int trace_seq;			/**< @brief latency trace of this message, 0 if not traced */
+	unsigned char refused;			/**< @brief set by publish when server refused this message */
 } st_mqtt_msg;
 
 typedef void (*st_mqtt_msg_handler)(st_mqtt_msg *, void *);
 
+/* Counters kept by the owner of the client, updated with relaxed atomics */
+typedef struct st_mqtt_stats {
+	unsigned int puback_timeout_cnt;	/**< @brief publish trials which didn't get PUBACK in time */
+	unsigned int publish_retry_cnt;		/**< @brief PUBLISH packets sent again */
+	unsigned int bytes_out;				/**< @brief bytes written to network, wraps around */
+	unsigned int bytes_in;				/**< @brief bytes read from network, wraps around */
+	unsigned int ping_rtt_ms;			/**< @brief round trip time of last PINGREQ */
+	unsigned int ping_rtt_max_ms;		/**< @brief maximum of ping_rtt_ms */
+} st_mqtt_stats;
+
+#define st_mqtt_subscribe_max_filters	8
+#define st_mqtt_publish_max_msgs		8
+
+typedef struct st_mqtt_sub_filter {
+	const char *topic;				/**< @brief topic filter to subscribe to */
+	int qos;						/**< @brief request subscribe QoS level */
+	st_mqtt_msg_handler handler;	/**< @brief callback function when subscribed packet arrive */
+	void *user_data;				/**< @brief callback function user parameter */
+} st_mqtt_sub_filter;
+
 enum {
 	st_mqtt_qos0,					/* MQTT QoS0 */
 	st_mqtt_qos1,					/* MQTT QoS1 */
@@ -94,6 +116,40 @@ enum {
 	E_ST_MQTT_CLIENTID_REJECTED = -6,				/* MQTT connection client id not allowed by server */
 	E_ST_MQTT_BAD_USERNAME_OR_PASSWORD = -7,		/* MQTT connection username or password is malformed */
 	E_ST_MQTT_NOT_AUTHORIZED = -8,					/* MQTT client is not authorized to connect */
+	E_ST_MQTT_REFUSED = -9,							/* MQTT 5.0 server refused the request, see st_mqtt_get_reason_code */
+};
+
+/* MQTT 5.0 reason codes which server reports by CONNACK, PUBACK, SUBACK and DISCONNECT */
+enum {
+	ST_MQTT_RC_SUCCESS = 0x00,
+	ST_MQTT_RC_NO_MATCHING_SUBSCRIBERS = 0x10,
+	ST_MQTT_RC_UNSPECIFIED_ERROR = 0x80,
+	ST_MQTT_RC_MALFORMED_PACKET = 0x81,
+	ST_MQTT_RC_PROTOCOL_ERROR = 0x82,
+	ST_MQTT_RC_IMPLEMENTATION_SPECIFIC_ERROR = 0x83,
+	ST_MQTT_RC_UNSUPPORTED_PROTOCOL_VERSION = 0x84,
+	ST_MQTT_RC_CLIENT_IDENTIFIER_NOT_VALID = 0x85,
+	ST_MQTT_RC_BAD_USER_NAME_OR_PASSWORD = 0x86,
+	ST_MQTT_RC_NOT_AUTHORIZED = 0x87,
+	ST_MQTT_RC_SERVER_UNAVAILABLE = 0x88,
+	ST_MQTT_RC_SERVER_BUSY = 0x89,
+	ST_MQTT_RC_BANNED = 0x8A,
+	ST_MQTT_RC_SERVER_SHUTTING_DOWN = 0x8B,
+	ST_MQTT_RC_BAD_AUTHENTICATION_METHOD = 0x8C,
+	ST_MQTT_RC_KEEP_ALIVE_TIMEOUT = 0x8D,
+	ST_MQTT_RC_SESSION_TAKEN_OVER = 0x8E,
+	ST_MQTT_RC_TOPIC_FILTER_INVALID = 0x8F,
+	ST_MQTT_RC_TOPIC_NAME_INVALID = 0x90,
+	ST_MQTT_RC_PACKET_IDENTIFIER_IN_USE = 0x91,
+	ST_MQTT_RC_RECEIVE_MAXIMUM_EXCEEDED = 0x93,
+	ST_MQTT_RC_TOPIC_ALIAS_INVALID = 0x94,
+	ST_MQTT_RC_PACKET_TOO_LARGE = 0x95,
+	ST_MQTT_RC_MESSAGE_RATE_TOO_HIGH = 0x96,
+	ST_MQTT_RC_QUOTA_EXCEEDED = 0x97,
+	ST_MQTT_RC_PAYLOAD_FORMAT_INVALID = 0x99,
+	ST_MQTT_RC_USE_ANOTHER_SERVER = 0x9C,
+	ST_MQTT_RC_SERVER_MOVED = 0x9D,
+	ST_MQTT_RC_CONNECTION_RATE_EXCEEDED = 0x9F,
 };
 
 /**
@@ -112,6 +168,16 @@ DLLExport int st_mqtt_create(st_mqtt_client *client, unsigned int command_timeou
  */
 DLLExport int st_mqtt_connect(st_mqtt_client client, st_mqtt_broker_info_t *broker, st_mqtt_connect_data *connect_data);
 
+/** MQTT Connect - same as st_mqtt_connect, and reports the session present flag of Connack
+ *  @param client - the client object to use
+ *  @param broker - broker network information
+ *  @param connect_data - MQTT connect data
+ *  @param session_present - set to 1 when server resumed the previous session, otherwise 0
+ *  @return success code
+ */
+DLLExport int st_mqtt_connect_with_session(st_mqtt_client client, st_mqtt_broker_info_t *broker,
+		st_mqtt_connect_data *connect_data, unsigned char *session_present);
+
 /** MQTT Publish - send an MQTT publish packet and wait for all acks to complete for all QoSs
  *  @param client - the client object to use
  *  @param msg - the publish packet message to send
@@ -119,6 +185,16 @@ DLLExport int st_mqtt_connect(st_mqtt_client client, st_mqtt_broker_info_t *brok
  */
 DLLExport int st_mqtt_publish(st_mqtt_client client, st_mqtt_msg *msg);
 
+/** MQTT Publish many - send MQTT publish packets of several messages with one
+ *  network write and wait for all acks to complete for all QoSs.
+ *  @param client - the client object to use
+ *  @param msgs - the publish packet messages to send
+ *  @param count - number of messages, sent by st_mqtt_publish_max_msgs at once
+ *  @return success code, E_ST_MQTT_REFUSED when server refused any message,
+ *  refused ones are marked in their refused field
+ */
+DLLExport int st_mqtt_publish_many(st_mqtt_client client, st_mqtt_msg *msgs, int count);
+
 /** MQTT Subscribe - send an MQTT subscribe packet and wait for suback before returning.
  *  @param client - the client object to use
  *  @param topic - the topic filter to subscribe to
@@ -129,6 +205,15 @@ DLLExport int st_mqtt_publish(st_mqtt_client client, st_mqtt_msg *msg);
  */
 DLLExport int st_mqtt_subscribe(st_mqtt_client client, const char *topic, int qos, st_mqtt_msg_handler handler, void *user_data);
 
+/** MQTT Subscribe many - send one MQTT subscribe packet for several topic filters
+ *  and wait for suback before returning.
+ *  @param client - the client object to use
+ *  @param filters - topic filters with QoS level & callback function
+ *  @param count - number of filters, up to st_mqtt_subscribe_max_filters
+ *  @return success code, fails when any filter is refused by server
+ */
+DLLExport int st_mqtt_subscribe_many(st_mqtt_client client, st_mqtt_sub_filter *filters, int count);
+
 /** MQTT Subscribe - send an MQTT unsubscribe packet and wait for unsuback before returning.
  *  @param client - the client object to use
  *  @param topic - the topic filter to unsubscribe from
@@ -148,6 +233,19 @@ DLLExport int st_mqtt_disconnect(st_mqtt_client client);
  */
 DLLExport void st_mqtt_destroy(st_mqtt_client client);
 
+/** MQTT reason code - last MQTT 5.0 reason code reported by server
+ *  @param client - the client object to use
+ *  @return reason code of last CONNACK, PUBACK, SUBACK or DISCONNECT from server,
+ *          ST_MQTT_RC_SUCCESS for MQTT 3.1.1 connection
+ */
+DLLExport unsigned char st_mqtt_get_reason_code(st_mqtt_client client);
+
+/** MQTT statistics - count the traffic of client into stats
+ *  @param client - the client object to use
+ *  @param stats - counters to update, kept over clients of reconnections. NULL stops counting
+ */
+DLLExport void st_mqtt_set_stats(st_mqtt_client client, st_mqtt_stats *stats);
+
 /** MQTT Yield - MQTT background
  *  @param client - the client object to use
  *  @param time - the time, in milliseconds, to yield for
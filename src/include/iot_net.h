@@ -27,6 +27,33 @@ extern "C" {
 
 typedef struct iot_net_interface iot_net_interface_t;
 
+/**
+ * @brief Maximum number of addresses kept for one server
+ */
+#define IOT_NET_ADDR_MAX		4
+
+/**
+ * @brief Resolved addresses are reused for this long before looking up again
+ */
+#ifndef IOT_NET_RESOLVE_TTL_MS
+#define IOT_NET_RESOLVE_TTL_MS		(5 * 60 * 1000)
+#endif
+
+/**
+ * @brief Delay before next address is tried in parallel with slower ones
+ */
+#ifndef IOT_NET_CONNECT_ATTEMPT_DELAY_MS
+#define IOT_NET_CONNECT_ATTEMPT_DELAY_MS	250
+#endif
+
+/**
+ * @brief Contains one resolved address of server
+ */
+typedef struct iot_net_addr {
+	int family;			/**< @brief AF_INET or AF_INET6 */
+	unsigned char ip[16];		/**< @brief address in network byte order */
+} iot_net_addr_t;
+
 /**
  * @brief Contains server related information
  *
@@ -41,8 +68,26 @@ typedef struct iot_net_connection {
 	unsigned int cert_len;		/**< @brief a size of device certificate */
 	const unsigned char *key;	/**< @brief a pointer to a private key */
 	unsigned int key_len;		/**< @brief a size of private key */
+	iot_net_addr_t addr[IOT_NET_ADDR_MAX];	/**< @brief resolved addresses of url */
+	int addr_cnt;			/**< @brief number of addr, 0 to resolve url at connect */
 } iot_net_connection_t;
 
+/**
+ * @brief One buffer of a gathered write
+ */
+typedef struct iot_net_iovec {
+	unsigned char *base;		/**< @brief start of the buffer */
+	int len;			/**< @brief length of the buffer */
+} iot_net_iovec_t;
+
+/**
+ * @brief Buffers smaller than this are gathered into one TLS record by writev.
+ * Bigger ones are written as they are, without copy.
+ */
+#ifndef IOT_NET_WRITEV_BUF_SIZE
+#define IOT_NET_WRITEV_BUF_SIZE		1024
+#endif
+
 /**
  * @brief Contains "network management structure" data
  */
@@ -62,6 +107,9 @@ typedef struct iot_net_interface {
 	int (*read)(iot_net_interface_t *, unsigned char *, int, iot_os_timer);
 	/**< @brief write to network */
 	int (*write)(iot_net_interface_t *, unsigned char *, int, iot_os_timer);
+	/**< @brief write several buffers to network as few TLS records as possible,
+	 * returns the number of bytes written. Can be NULL */
+	int (*writev)(iot_net_interface_t *, iot_net_iovec_t *, int, iot_os_timer);
 	/**< @brief show socket status on console */
 	void (*show_status)(iot_net_interface_t *);
 } iot_net_interface_t;
@@ -77,6 +125,45 @@ typedef struct iot_net_interface {
  */
 iot_error_t iot_net_init(iot_net_interface_t *net);
 
+/**
+ * @brief Resolve server name to addresses
+ *
+ * Addresses are cached for IOT_NET_RESOLVE_TTL_MS. After that, expired
+ * addresses are still returned at once while a lookup runs on its own
+ * task, so reconnection doesn't wait for DNS.
+ *
+ * @param[in] host - server name or numeric address
+ * @param[out] addr - resolved addresses, IPv6 and IPv4 interleaved
+ * @param[in] addr_max - number of addr can have
+ * @param[in] timeout_ms - time to wait when there is nothing cached
+ *
+ * @return number of addresses, 0 if host couldn't be resolved in time
+ */
+int iot_net_resolve(const char *host, iot_net_addr_t *addr, int addr_max, unsigned int timeout_ms);
+
+/**
+ * @brief Drop cached addresses of server, e.g. when none of them is reachable
+ *
+ * @param[in] host - server name
+ */
+void iot_net_resolve_invalidate(const char *host);
+
+/**
+ * @brief Connect TCP socket to one of the addresses
+ *
+ * Addresses are tried in order. When one doesn't connect within
+ * IOT_NET_CONNECT_ATTEMPT_DELAY_MS, next one is tried in parallel and
+ * the first connected socket is used.
+ *
+ * @param[in] addr - addresses of server
+ * @param[in] addr_cnt - number of addr
+ * @param[in] port - server port
+ * @param[in] timeout_ms - time to wait for connection
+ *
+ * @return non-blocking socket, or -1 if no address is connected
+ */
+int iot_net_connect_addr(iot_net_addr_t *addr, int addr_cnt, int port, unsigned int timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,40 @@ extern "C" {
  */
 iot_error_t iot_serialize_cbor2json(uint8_t *cbor, size_t cborlen, char **json, size_t *jsonlen);
 
+/**
+ * @brief	Read a text string member of top level cbor map
+ * @details	This function decodes cbor payload in place and copies the
+ *		value of key into buf with null terminator, without any allocation
+ * @param[in]	cbor	a pointer to a buffer of cbor payload
+ * @param[in]	cborlen	the size of buffer pointed by cbor in bytes
+ * @param[in]	key	member name to find
+ * @param[out]	buf	a pointer to a buffer to store the value
+ * @param[in]	buf_len	the size of buffer pointed by buf in bytes
+ * @return	iot_state_t
+ * @retval	IOT_ERROR_NONE		value successfully copied
+ * @retval	IOT_ERROR_INVALID_ARG	there is something wrong with the inputs
+ * @retval	IOT_ERROR_CBOR_PARSE	failed to parse cbor payload
+ * @retval	IOT_ERROR_BAD_REQ	key is not found, is not a text string or does not fit in buf
+ */
+iot_error_t iot_serialize_cbor_get_string(const uint8_t *cbor, size_t cborlen,
+		const char *key, char *buf, size_t buf_len);
+
+/**
+ * @brief	Read a number member of top level cbor map
+ * @details	Floating point numbers are truncated toward zero
+ * @param[in]	cbor	a pointer to a buffer of cbor payload
+ * @param[in]	cborlen	the size of buffer pointed by cbor in bytes
+ * @param[in]	key	member name to find
+ * @param[out]	val	value of key
+ * @return	iot_state_t
+ * @retval	IOT_ERROR_NONE		value successfully read
+ * @retval	IOT_ERROR_INVALID_ARG	there is something wrong with the inputs
+ * @retval	IOT_ERROR_CBOR_PARSE	failed to parse cbor payload
+ * @retval	IOT_ERROR_BAD_REQ	key is not found or is not a number
+ */
+iot_error_t iot_serialize_cbor_get_int(const uint8_t *cbor, size_t cborlen,
+		const char *key, int64_t *val);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,126 @@
+/* ***************************************************************************
+ *
+ * Copyright 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#ifndef _IOT_TRACE_H_
+#define _IOT_TRACE_H_
+
+#include "iot_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Stages of the event and command paths
+ * @details Each stage is the time since the previous mark of the same trace.
+ */
+typedef enum iot_trace_stage {
+	IOT_TRACE_EVT_ENCODE = 0,	/**< @brief st_cap_attr_send until the event data is made */
+	IOT_TRACE_EVT_ENQUEUE,		/**< @brief event data until handed to pub_queue */
+	IOT_TRACE_EVT_WAKEUP,		/**< @brief pub_queue until taken by the main task */
+	IOT_TRACE_EVT_PUBLISH,		/**< @brief main task until passed to st_mqtt_publish */
+	IOT_TRACE_EVT_SERIALIZE,	/**< @brief st_mqtt_publish until the packet is serialized */
+	IOT_TRACE_EVT_WRITE,		/**< @brief serialized packet until written to the network */
+	IOT_TRACE_EVT_PUBACK,		/**< @brief network write until PUBACK is received */
+	IOT_TRACE_EVT_TOTAL,		/**< @brief st_cap_attr_send until PUBACK */
+	IOT_TRACE_CMD_READ,		/**< @brief first byte of PUBLISH until the packet is read */
+	IOT_TRACE_CMD_DISPATCH,		/**< @brief packet read until cmd_cb is called */
+	IOT_TRACE_CMD_CALLBACK,		/**< @brief cmd_cb until it returns */
+	IOT_TRACE_CMD_TOTAL,		/**< @brief first byte of PUBLISH until the last cmd_cb returns */
+	IOT_TRACE_STAGE_MAX,
+} iot_trace_stage_t;
+
+/**
+ * @brief Latency summary of one stage
+ * @details Percentiles come from log2 buckets of microseconds, so they are
+ * the upper bound of the bucket and never above max_us.
+ */
+typedef struct iot_trace_stats {
+	unsigned int count;		/**< @brief samples since the last reset */
+	unsigned int avg_us;		/**< @brief average */
+	unsigned int p50_us;		/**< @brief median */
+	unsigned int p90_us;		/**< @brief 90th percentile */
+	unsigned int p99_us;		/**< @brief 99th percentile */
+	unsigned int max_us;		/**< @brief maximum */
+} iot_trace_stats_t;
+
+/**
+ * @brief	Start a trace
+ * @details	Only a few traces are kept in flight, the oldest one is
+ * dropped when a new one needs its slot.
+ * @return	sequence number of the trace, 0 when it can't be recorded
+ */
+unsigned int iot_trace_begin(void);
+
+/**
+ * @brief	Record a stage of a trace
+ * @details	Unknown, finished or 0 sequence numbers are ignored.
+ * @param[in]	seq	sequence number from iot_trace_begin
+ * @param[in]	stage	stage which ends now
+ */
+void iot_trace_mark(unsigned int seq, iot_trace_stage_t stage);
+
+/**
+ * @brief	Finish a trace
+ * @details	Time since iot_trace_begin is recorded to total stage and
+ * the trace is released. A trace which is dropped without a result is
+ * ended with IOT_TRACE_STAGE_MAX.
+ * @param[in]	seq	sequence number from iot_trace_begin
+ * @param[in]	total	stage for the whole path, IOT_TRACE_STAGE_MAX records nothing
+ */
+void iot_trace_end(unsigned int seq, iot_trace_stage_t total);
+
+/**
+ * @brief	Get the latency summary of a stage
+ * @param[in]	stage	stage to query
+ * @param[out]	stats	summary of the stage
+ * @return	IOT_ERROR_NONE on success, IOT_ERROR_INVALID_ARGS on wrong parameters,
+ *		IOT_ERROR_MEM_ALLOC when the lock can't be created
+ */
+iot_error_t iot_trace_get_stats(iot_trace_stage_t stage, iot_trace_stats_t *stats);
+
+/**
+ * @brief	Clear the histograms of all stages
+ * @details	Traces in flight are kept.
+ */
+void iot_trace_reset(void);
+
+/**
+ * @brief	Print the latency summary of all stages which have samples
+ */
+void iot_trace_dump(void);
+
+/*
+ * Core marks its paths through these macros,
+ * so that they cost nothing without CONFIG_STDK_IOT_CORE_LATENCY_TRACE
+ */
+#if defined(CONFIG_STDK_IOT_CORE_LATENCY_TRACE)
+#define IOT_TRACE_BEGIN()		iot_trace_begin()
+#define IOT_TRACE_MARK(seq, stage)	iot_trace_mark(seq, stage)
+#define IOT_TRACE_END(seq, total)	iot_trace_end(seq, total)
+#else
+#define IOT_TRACE_BEGIN()		0
+#define IOT_TRACE_MARK(seq, stage)	do { (void)(seq); } while (0)
+#define IOT_TRACE_END(seq, total)	do { (void)(seq); (void)(total); } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IOT_TRACE_H_ */
@@ -111,6 +111,150 @@ iot_error_t iot_util_convert_mac_str(struct iot_mac* mac, char* str, int max_sz)
  */
 uint16_t iot_util_convert_channel_freq(uint8_t channel);
 
+/**
+ * @brief	To convert unsigned 64bit value into decimal string
+ * @details	This function converts two digits at a time through a lookup table,
+ *		so it is cheaper than snprintf on the event publish path
+ * @param[in]	val	converting wanted value
+ * @param[in]	str	allocated memory pointer for converted decimal string
+ * @param[in]	max_sz	max size of allocated memory pointer
+ * @return	iot_error_t
+ * @retval	IOT_ERROR_NONE	success
+ * @retval	IOT_ERROR_INVALID_ARGS	invalid arguments or not enough buffer
+ */
+iot_error_t iot_util_convert_u64_str(uint64_t val, char* str, int max_sz);
+
+/**
+ * @brief	To get the length of string after JSON escaping
+ * @details	This function counts bytes which iot_util_json_escape writes
+ *		for the same input, without quotation marks and null terminator
+ * @param[in]	str	string to be escaped
+ * @param[in]	len	length of str in bytes
+ * @return	length of escaped string in bytes
+ */
+size_t iot_util_json_escaped_len(const char *str, size_t len);
+
+/**
+ * @brief	To write string with JSON escaping
+ * @details	This function escapes '"', '\\' and control characters like cJSON
+ *		does. It does not write quotation marks and null terminator.
+ * @param[in]	dst	buffer which has iot_util_json_escaped_len() bytes at least
+ * @param[in]	str	string to be escaped
+ * @param[in]	len	length of str in bytes
+ * @return	a pointer to the next byte of written string in dst
+ */
+char *iot_util_json_escape(char *dst, const char *str, size_t len);
+
+/**
+ * @brief	To check whether the buffer holds one complete JSON value
+ * @param[in]	json	buffer to be checked, null terminator is not required
+ * @param[in]	len	length of json in bytes
+ * @return	true if json is well-formed, otherwise false
+ */
+bool iot_util_json_is_valid(const char *json, size_t len);
+
+/**
+ * @brief	To read a string member of top level JSON object
+ * @details	This function scans json in place and copies unescaped value
+ *		of key into buf with null terminator, without any allocation
+ * @param[in]	json	JSON object, null terminator is not required
+ * @param[in]	json_len	length of json in bytes
+ * @param[in]	key	member name to find
+ * @param[out]	buf	buffer to store the value
+ * @param[in]	buf_len	size of buf in bytes
+ * @retval	IOT_ERROR_NONE	success
+ * @retval	IOT_ERROR_INVALID_ARGS	invalid parameter
+ * @retval	IOT_ERROR_BAD_REQ	key is not found, is not a string or does not fit in buf
+ */
+iot_error_t iot_util_json_get_string(const char *json, size_t json_len,
+		const char *key, char *buf, size_t buf_len);
+
+/**
+ * @brief	To read a number member of top level JSON object
+ * @details	Fractional numbers are truncated toward zero
+ * @param[in]	json	JSON object, null terminator is not required
+ * @param[in]	json_len	length of json in bytes
+ * @param[in]	key	member name to find
+ * @param[out]	val	value of key
+ * @retval	IOT_ERROR_NONE	success
+ * @retval	IOT_ERROR_INVALID_ARGS	invalid parameter
+ * @retval	IOT_ERROR_BAD_REQ	key is not found or is not a number
+ */
+iot_error_t iot_util_json_get_int(const char *json, size_t json_len,
+		const char *key, int64_t *val);
+
+/**
+ * @brief	To initialize reconnect delay state
+ * @param[out]	backoff	delay state to initialize
+ * @param[in]	base_ms	minimum delay in ms, 0 is treated as 1
+ * @param[in]	cap_ms	maximum delay in ms, raised to base_ms if smaller
+ */
+void iot_util_backoff_init(struct iot_backoff *backoff,
+		unsigned int base_ms, unsigned int cap_ms);
+
+/**
+ * @brief	To get next reconnect delay
+ * @details	This function returns a "decorrelated jitter" delay which is
+ *		picked randomly between base_ms and three times of previous delay,
+ *		limited by cap_ms. So the delay grows exponentially on average,
+ *		while devices failed at the same moment are spread over time.
+ * @param[in]	backoff	delay state
+ * @return	delay in ms
+ */
+unsigned int iot_util_backoff_next(struct iot_backoff *backoff);
+
+/**
+ * @brief	To give a minimum delay for next iot_util_backoff_next
+ * @details	Used when server tells it is unavailable. Next delay is picked
+ *		from floor_ms at least, and the hint is used only once.
+ * @param[in]	backoff	delay state
+ * @param[in]	floor_ms	minimum delay for next trial in ms
+ */
+void iot_util_backoff_hint(struct iot_backoff *backoff, unsigned int floor_ms);
+
+/**
+ * @brief	To start over from minimum delay after stable connection
+ * @param[in]	backoff	delay state
+ */
+void iot_util_backoff_reset(struct iot_backoff *backoff);
+
+/**
+ * @brief	To raise a counter to value if it is bigger
+ * @details	Safe against other tasks updating the same counter,
+ *		used for high-water marks of statistics.
+ * @param[in]	target	counter to update
+ * @param[in]	value	new sample
+ */
+void iot_util_atomic_max(unsigned int *target, unsigned int value);
+
+/**
+ * @brief Contains a mutex which is created by its first user
+ *
+ * For modules without init call which may be entered by several tasks
+ * at once. Zero initialized static storage is a valid initial state.
+ */
+typedef struct iot_util_once_mutex {
+	unsigned int state;		/**< @brief creation state, only touched atomically */
+	iot_os_mutex mutex;		/**< @brief mutex valid after creation */
+} iot_util_once_mutex_t;
+
+/**
+ * @brief	To lock a mutex, creating it on first use
+ * @details	Only one task creates the mutex, others wait for it. Failed
+ *		creation is tried again by the next caller. The caller must not
+ *		touch what the mutex protects when this fails.
+ * @param[in]	once_mutex	mutex to lock
+ * @retval	IOT_ERROR_NONE		locked
+ * @retval	IOT_ERROR_MEM_ALLOC	mutex can't be created, not locked
+ */
+iot_error_t iot_util_once_mutex_lock(iot_util_once_mutex_t *once_mutex);
+
+/**
+ * @brief	To unlock a mutex locked by iot_util_once_mutex_lock()
+ * @param[in]	once_mutex	mutex to unlock
+ */
+void iot_util_once_mutex_unlock(iot_util_once_mutex_t *once_mutex);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,6 +37,21 @@ extern "C" {
  */
 iot_error_t iot_wt_create(char **token, const char *sn, iot_crypto_pk_info_t *pk_info);
 
+/**
+ * @brief	Create a Web Token with a prepared signing context
+ * @details	Same as iot_wt_create() but the key is not parsed again,
+ *		so a context made once by iot_crypto_pk_init() can be
+ *		reused for every connection.
+ * @param[out]	token	a pointer of buffer to store a formatted and signed string
+ * @param[in]	sn	device serial number as user name
+ * @param[in]	pk_ctx	signing context initialized with private key data
+ * @retval	IOT_ERROR_NONE		Web Token is sucessfully generated
+ * @retval	IOT_ERROR_INVALID_ARGS	token, sn or pk_ctx is null
+ * @retval	IOT_ERROR_MEM_ALLOC	no more available heap memory
+ * @retval	IOT_ERROR_WEBTOKEN_FAIL	failed to make json
+ */
+iot_error_t iot_wt_create_with_ctx(char **token, const char *sn, iot_crypto_pk_context_t *pk_ctx);
+
 #ifdef __cplusplus
 }
 #endif
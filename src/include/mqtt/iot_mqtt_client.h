@@ -37,12 +37,10 @@ extern "C" {
 
 #include "st_dev.h"
 #include "iot_mqtt_packet.h"
+#include "iot_mqtt_topic_tree.h"
 #include "iot_os_util.h"
 
-#define MQTT_PUB_NOCOPY					1
-
 #define MAX_PACKET_ID 					65535 	/* according to the MQTT specification - do not change! */
-#define MAX_MESSAGE_HANDLERS 			5 		/* redefinable - how many subscriptions do you want? */
 #define DEFAULT_COMMNAD_TIMEOUT 		30000
 #define MQTT_PUBLISH_RETRY 				3
 #define MQTT_PING_RETRY 				3
@@ -51,6 +49,11 @@ extern "C" {
 #define MQTT_PUBACK_MAX_SIZE			5
 #define MQTT_PINGREQ_MAX_SIZE			5
 
+/* MQTT 5.0 */
+#define MQTT_TOPIC_ALIAS_MAX			4			/* topic aliases used toward server */
+#define MQTT_RECEIVE_MAXIMUM			8			/* QoS1 & QoS2 publishes server can send before acks */
+#define MQTT_SESSION_EXPIRY_INTERVAL	0xFFFFFFFF	/* keep session like MQTT 3.1.1, server can limit it */
+
 #define MQTT_TASK_STACK_SIZE 			2048
 #define MQTT_TASK_PRIORITY 				4
 #define MQTT_TASK_CYCLE 				100
@@ -74,12 +77,18 @@ typedef struct MQTTClient {
 	int ping_retry_count;
 	int isconnected;
 	int cleansession;
-
-	struct MessageHandlers {
-		char *topicFilter;
-		void (*fp)(st_mqtt_msg *, void *);
-		void *userData;
-	} messageHandlers[MAX_MESSAGE_HANDLERS];	  /* Message handlers are indexed by subscription topic */
+	unsigned short unacked_id;	/* QoS1 message delivered but not acked before connection lost */
+
+	unsigned char mqtt_ver;			/* protocol version of current connection */
+	unsigned char reason_code;		/* last MQTT 5.0 reason code from server */
+	unsigned short receive_max;		/* server receive maximum, publish keeps one QoS1 or QoS2 message in flight */
+	unsigned int max_packet_size;	/* server maximum packet size, 0 if not limited */
+	int topic_alias_max;			/* topic aliases usable in this connection */
+	char *topic_alias[MQTT_TOPIC_ALIAS_MAX];	/* topic of alias (index + 1) */
+	unsigned int trace_seq;			/* latency trace of PUBLISH being read */
+	st_mqtt_stats *stats;			/* counters of owner, NULL if not counted */
+
+	MQTTTopicNode *subscriptions;	  /* Message handlers are indexed by subscription topic filter */
 
 	void (*defaultMessageHandler)(st_mqtt_msg *, void *);
 	void *defaultUserData;
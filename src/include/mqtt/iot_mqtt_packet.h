@@ -93,6 +93,7 @@ int MQTTstrlen(MQTTString mqttstring);
 #include "iot_mqtt_subscribe.h"
 #include "iot_mqtt_unsubscribe.h"
 #include "iot_mqtt_format.h"
+#include "iot_mqtt_v5.h"
 
 DLLExport int MQTTSerialize_ack(unsigned char* buf, int buflen, unsigned char type, unsigned char dup, unsigned short packetid);
 DLLExport int MQTTDeserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned short* packetid, unsigned char* buf, int buflen);
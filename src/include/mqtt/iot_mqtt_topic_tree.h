@@ -0,0 +1,79 @@
+/* ***************************************************************************
+ *
+ * Copyright 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#ifndef MQTTTOPICTREE_H_
+#define MQTTTOPICTREE_H_
+
+#include <stddef.h>
+#include "iot_mqtt.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* One topic level of subscribed topic filters.
+ * Exact levels are kept sorted in children for binary search,
+ * '+' and '#' levels have their own links.
+ */
+typedef struct MQTTTopicNode {
+	struct MQTTTopicNode **children;	/* exact levels, sorted by length and bytes */
+	int child_count;
+	int child_size;
+	struct MQTTTopicNode *plus;			/* '+' level */
+	struct MQTTTopicNode *hash;			/* '#' level */
+
+	st_mqtt_msg_handler fp;				/* handler of topic filter ending at this level */
+	void *userData;
+
+	size_t level_len;
+	char level[];						/* level name, not null terminated */
+} MQTTTopicNode;
+
+/** MQTT TopicTree add - set message handler for topic filter
+ *  @param root - pointer to root node, created on first add
+ *  @param topicFilter - null terminated topic filter, '+' and '#' have to fill a whole level
+ *  @param fp - message handler, replaces previous handler of same topic filter
+ *  @param userData - user data for fp
+ *  @return 0 on success, E_ST_MQTT_FAILURE on invalid topic filter or malloc failure
+ */
+int MQTTTopicTree_add(MQTTTopicNode **root, const char *topicFilter, st_mqtt_msg_handler fp, void *userData);
+
+/** MQTT TopicTree remove - remove message handler of topic filter
+ *  @param root - pointer to root node, freed when the last topic filter is removed
+ *  @param topicFilter - null terminated topic filter
+ *  @return 0 on success, E_ST_MQTT_FAILURE if topic filter isn't found
+ */
+int MQTTTopicTree_remove(MQTTTopicNode **root, const char *topicFilter);
+
+/** MQTT TopicTree deliver - call every handler whose topic filter matches message topic
+ *  @param root - root node, can be NULL
+ *  @param message - message which has topic & topiclen
+ *  @return number of called handlers
+ */
+int MQTTTopicTree_deliver(MQTTTopicNode *root, st_mqtt_msg *message);
+
+/** MQTT TopicTree free - remove all topic filters
+ *  @param root - pointer to root node, set to NULL
+ */
+void MQTTTopicTree_free(MQTTTopicNode **root);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MQTTTOPICTREE_H_ */
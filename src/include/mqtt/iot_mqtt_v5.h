@@ -0,0 +1,127 @@
+/* ***************************************************************************
+ *
+ * Copyright 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#ifndef MQTTV5_H_
+#define MQTTV5_H_
+
+#if !defined(DLLImport)
+  #define DLLImport
+#endif
+#if !defined(DLLExport)
+  #define DLLExport
+#endif
+
+#define MQTTV5_PROTOCOL_VERSION		5
+
+enum MQTTV5PropertyCodes
+{
+	MQTTV5_PROPERTY_PAYLOAD_FORMAT_INDICATOR = 0x01,
+	MQTTV5_PROPERTY_MESSAGE_EXPIRY_INTERVAL = 0x02,
+	MQTTV5_PROPERTY_CONTENT_TYPE = 0x03,
+	MQTTV5_PROPERTY_RESPONSE_TOPIC = 0x08,
+	MQTTV5_PROPERTY_CORRELATION_DATA = 0x09,
+	MQTTV5_PROPERTY_SUBSCRIPTION_IDENTIFIER = 0x0B,
+	MQTTV5_PROPERTY_SESSION_EXPIRY_INTERVAL = 0x11,
+	MQTTV5_PROPERTY_ASSIGNED_CLIENT_IDENTIFIER = 0x12,
+	MQTTV5_PROPERTY_SERVER_KEEP_ALIVE = 0x13,
+	MQTTV5_PROPERTY_AUTHENTICATION_METHOD = 0x15,
+	MQTTV5_PROPERTY_AUTHENTICATION_DATA = 0x16,
+	MQTTV5_PROPERTY_REQUEST_PROBLEM_INFORMATION = 0x17,
+	MQTTV5_PROPERTY_WILL_DELAY_INTERVAL = 0x18,
+	MQTTV5_PROPERTY_REQUEST_RESPONSE_INFORMATION = 0x19,
+	MQTTV5_PROPERTY_RESPONSE_INFORMATION = 0x1A,
+	MQTTV5_PROPERTY_SERVER_REFERENCE = 0x1C,
+	MQTTV5_PROPERTY_REASON_STRING = 0x1F,
+	MQTTV5_PROPERTY_RECEIVE_MAXIMUM = 0x21,
+	MQTTV5_PROPERTY_TOPIC_ALIAS_MAXIMUM = 0x22,
+	MQTTV5_PROPERTY_TOPIC_ALIAS = 0x23,
+	MQTTV5_PROPERTY_MAXIMUM_QOS = 0x24,
+	MQTTV5_PROPERTY_RETAIN_AVAILABLE = 0x25,
+	MQTTV5_PROPERTY_USER_PROPERTY = 0x26,
+	MQTTV5_PROPERTY_MAXIMUM_PACKET_SIZE = 0x27,
+	MQTTV5_PROPERTY_WILDCARD_SUBSCRIPTION_AVAILABLE = 0x28,
+	MQTTV5_PROPERTY_SUBSCRIPTION_IDENTIFIER_AVAILABLE = 0x29,
+	MQTTV5_PROPERTY_SHARED_SUBSCRIPTION_AVAILABLE = 0x2A,
+};
+
+/* bits of MQTTV5Properties.present */
+#define MQTTV5_HAS_SESSION_EXPIRY_INTERVAL	(1 << 0)
+#define MQTTV5_HAS_RECEIVE_MAXIMUM			(1 << 1)
+#define MQTTV5_HAS_TOPIC_ALIAS_MAXIMUM		(1 << 2)
+#define MQTTV5_HAS_TOPIC_ALIAS				(1 << 3)
+#define MQTTV5_HAS_MAXIMUM_PACKET_SIZE		(1 << 4)
+#define MQTTV5_HAS_SERVER_KEEP_ALIVE		(1 << 5)
+#define MQTTV5_HAS_MAXIMUM_QOS				(1 << 6)
+
+/**
+ * Properties of MQTT 5.0 packets which are used by this client.
+ * Other properties are skipped on read and never written.
+ */
+typedef struct
+{
+	unsigned int present;				/**< MQTTV5_HAS_xxx bits of valid members */
+	unsigned int sessionExpiryInterval;
+	unsigned int maximumPacketSize;
+	unsigned short receiveMaximum;
+	unsigned short topicAliasMaximum;
+	unsigned short topicAlias;
+	unsigned short serverKeepAlive;
+	unsigned char maximumQoS;
+} MQTTV5Properties;
+
+#define MQTTV5Properties_initializer { 0, 0, 0, 0, 0, 0, 0, 0 }
+
+DLLExport int MQTTV5Properties_len(MQTTV5Properties* properties);
+DLLExport int MQTTV5Properties_write(unsigned char** pptr, MQTTV5Properties* properties);
+DLLExport int MQTTV5Properties_read(MQTTV5Properties* properties, unsigned char** pptr, unsigned char* enddata);
+
+/*
+ * MQTT 5.0 variants of the packet functions. NULL properties serialize
+ * or deserialize the MQTT 3.1.1 packet format, so the MQTTSerialize_xxx
+ * functions call these with NULL.
+ */
+DLLExport int MQTTV5Serialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData* options,
+		MQTTV5Properties* connectProperties);
+DLLExport int MQTTV5Serialize_connect_size(MQTTPacket_connectData* options, MQTTV5Properties* connectProperties);
+DLLExport int MQTTV5Deserialize_connack(MQTTV5Properties* connackProperties, unsigned char* sessionPresent,
+		unsigned char* connack_rc, unsigned char* buf, int buflen);
+DLLExport int MQTTV5Deserialize_disconnect(MQTTV5Properties* disconnectProperties, unsigned char* reasonCode,
+		unsigned char* buf, int buflen);
+
+DLLExport int MQTTV5Serialize_publish(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained,
+		unsigned short packetid, MQTTString topicName, MQTTV5Properties* properties, unsigned char* payload, int payloadlen);
+DLLExport int MQTTV5Serialize_publish_size(int qos, MQTTString topicName, MQTTV5Properties* properties, int payloadlen);
+DLLExport int MQTTV5Serialize_publish_header(unsigned char* buf, unsigned char dup, int qos, unsigned char retained,
+		unsigned short packetid, MQTTString topicName, MQTTV5Properties* properties, int payloadlen);
+DLLExport int MQTTV5Deserialize_publish(unsigned char* dup, int* qos, unsigned char* retained, unsigned short* packetid,
+		MQTTString* topicName, MQTTV5Properties* properties, unsigned char** payload, int* payloadlen,
+		unsigned char* buf, int buflen);
+DLLExport int MQTTV5Deserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned short* packetid,
+		unsigned char* reasonCode, MQTTV5Properties* properties, unsigned char* buf, int buflen);
+
+DLLExport int MQTTV5Serialize_subscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid,
+		MQTTV5Properties* properties, int count, MQTTString topicFilters[], int requestedQoSs[]);
+DLLExport int MQTTV5Serialize_subscribe_size(MQTTV5Properties* properties, int count, MQTTString topicFilters[]);
+DLLExport int MQTTV5Deserialize_suback(unsigned short* packetid, MQTTV5Properties* properties, int maxcount, int* count,
+		int reasonCodes[], unsigned char* buf, int buflen);
+
+DLLExport int MQTTV5Serialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid,
+		MQTTV5Properties* properties, int count, MQTTString topicFilters[]);
+DLLExport int MQTTV5Serialize_unsubscribe_size(MQTTV5Properties* properties, int count, MQTTString topicFilters[]);
+
+#endif /* MQTTV5_H_ */
@@ -404,6 +404,57 @@ void iot_os_free(void *ptr);
  *
  */
 char *iot_os_strdup(const char *src);
+
+#define IOT_OS_THREAD_NAME_LEN	16
+
+/**
+ * @brief Contains heap usage of the memory allocated by iot_os_malloc.
+ */
+typedef struct iot_os_heap_info {
+	size_t used;		/**< @brief bytes in use */
+	size_t peak;		/**< @brief maximum of used since boot */
+	size_t phase_peak;	/**< @brief maximum of used since the last phase reset */
+	size_t arena;		/**< @brief bytes held by the process heap */
+	unsigned int frag;	/**< @brief percent of arena which is free but can't be released */
+} iot_os_heap_info_t;
+
+/**
+ * @brief Contains stack usage of a thread created by iot_os_thread_create.
+ */
+typedef struct iot_os_stack_info {
+	char name[IOT_OS_THREAD_NAME_LEN];	/**< @brief name of thread */
+	size_t stack_size;	/**< @brief stack size requested by iot_os_thread_create */
+	size_t high_water;	/**< @brief maximum stack bytes used by the threads of this name */
+	int running;		/**< @brief whether the thread is still alive */
+} iot_os_stack_info_t;
+
+/**
+ * @brief	get heap usage
+ *
+ * This function gets the usage of the memory allocated by iot_os_malloc,
+ * iot_os_calloc and iot_os_strdup
+ *
+ * @param[out] info heap usage
+ * @param[in] reset_phase restart phase_peak from the current usage if not 0
+ *
+ */
+void iot_os_heap_get_info(iot_os_heap_info_t *info, int reset_phase);
+
+/**
+ * @brief	get stack high-water marks
+ *
+ * This function gets stack high-water marks of the threads created by
+ * iot_os_thread_create. Stacks are painted on creation and measured by
+ * the bytes which are overwritten, so it works only if
+ * CONFIG_STDK_DEBUG_MEMORY_CHECK is enabled.
+ *
+ * @param[out] info array of stack usage
+ * @param[in] max count of info
+ *
+ * @return
+ *	count of info filled
+ */
+int iot_os_thread_get_stack_info(iot_os_stack_info_t *info, int max);
 #else
 #include <string.h>
 static inline void *iot_os_malloc(size_t size) { return malloc(size); }
@@ -399,6 +399,45 @@ int st_conn_cleanup(IOT_CTX *iot_ctx, bool reboot);
 */
 void st_conn_ownership_confirm(IOT_CTX *iot_ctx, bool confirm);
 
+/**
+ * @brief Causes of reconnection counted in st_conn_stats_t
+ */
+typedef enum st_conn_reconn_cause {
+	ST_CONN_RECONN_PUBLISH_FAIL = 0,	/**< @brief event publish failed */
+	ST_CONN_RECONN_LINK_LOST,		/**< @brief connection dropped while waiting for packets */
+	ST_CONN_RECONN_CONNECT_TIMEOUT,		/**< @brief connecting didn't finish on time */
+	ST_CONN_RECONN_CAUSE_MAX,
+} st_conn_reconn_cause_t;
+
+/**
+ * @brief Connection and throughput counters of st-iot-core
+ */
+typedef struct st_conn_stats {
+	unsigned int pub_cnt;			/**< @brief events acked by server */
+	unsigned int pub_fail_cnt;		/**< @brief events refused by server or lost with a failed publish */
+	unsigned int puback_timeout_cnt;	/**< @brief publish trials which didn't get PUBACK in time */
+	unsigned int pub_retry_cnt;		/**< @brief events sent again, once per resend of each */
+	unsigned int reconn_cnt[ST_CONN_RECONN_CAUSE_MAX];	/**< @brief reconnections by cause */
+	unsigned int bytes_out;			/**< @brief MQTT bytes sent, wraps around */
+	unsigned int bytes_in;			/**< @brief MQTT bytes received, wraps around */
+	unsigned int ping_rtt_ms;		/**< @brief round trip time of last keepalive ping */
+	unsigned int ping_rtt_max_ms;		/**< @brief maximum round trip time of keepalive ping */
+	unsigned int pub_queue_hwm;		/**< @brief maximum events waiting in publish queue */
+	unsigned int evt_drop_cnt;		/**< @brief events dropped from publish queue by disconnection */
+} st_conn_stats_t;
+
+/**
+* @brief	st-iot-core statistics function
+* @details	This function takes a snapshot of the connection and throughput counters.
+* Counters run from st_conn_init or from the last reset, so the rate of events and
+* bytes can be made from two snapshots.
+* @param[in]	iot_ctx		iot_context handle generated by st_conn_init()
+* @param[out]	stats		snapshot of the counters
+* @param[in]	reset		clear the counters after the snapshot
+* @return 		return `(0)` if it works successfully, non-zero for error case.
+*/
+int st_conn_get_stats(IOT_CTX *iot_ctx, st_conn_stats_t *stats, bool reset);
+
 #ifdef __cplusplus
 }
 #endif
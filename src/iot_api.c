@@ -22,25 +22,33 @@
 
 #include "iot_main.h"
 #include "iot_internal.h"
+#include "iot_util.h"
 #include "iot_debug.h"
 #include "iot_easysetup.h"
 #include "iot_crypto.h"
 #include "iot_nv_data.h"
 #include "iot_os_util.h"
+#include "iot_mem.h"
 
 #include "JSON.h"
 
 iot_error_t iot_command_send(struct iot_context *ctx,
 	enum iot_command_type new_cmd, const void *param, int param_size)
 {
-	struct iot_command *cmd_data = (struct iot_command *)malloc(sizeof(struct iot_command));
+	struct iot_command *cmd_data = (struct iot_command *)iot_mem_malloc(IOT_MEM_TAG_CORE, sizeof(struct iot_command));
 	int ret;
 	iot_error_t err;
 
+	if (!cmd_data) {
+		IOT_ERROR("failed to malloc for iot_command");
+		return IOT_ERROR_MEM_ALLOC;
+	}
+
 	if (param && (param_size > 0)) {
-		cmd_data->param = malloc(param_size);
+		cmd_data->param = iot_mem_malloc(IOT_MEM_TAG_CORE, param_size);
 		if (!cmd_data->param) {
 			IOT_ERROR("failed to malloc for iot_command param");
+			iot_mem_free(IOT_MEM_TAG_CORE, cmd_data);
 			return IOT_ERROR_MEM_ALLOC;
 		}
 
@@ -52,11 +60,12 @@ iot_error_t iot_command_send(struct iot_context *ctx,
 	cmd_data->cmd_type = new_cmd;
 
 	IOT_ERROR("Send to CMD Queue");
-	ret = iot_os_queue_send(ctx->cmd_queue, cmd_data, 0);
+	ret = iot_os_queue_send(ctx->cmd_queue, &cmd_data, 0);
 	if (ret != IOT_OS_TRUE) {
 		IOT_ERROR("Cannot put the cmd into cmd_queue");
 		if (cmd_data->param)
-			free(cmd_data->param);
+			iot_mem_free(IOT_MEM_TAG_CORE, cmd_data->param);
+		iot_mem_free(IOT_MEM_TAG_CORE, cmd_data);
 		err = IOT_ERROR_BAD_REQ;
 	} else {
 		if (new_cmd != IOT_CMD_STATE_HANDLE) {
@@ -128,10 +137,15 @@ iot_error_t iot_wifi_ctrl_request(struct iot_context *ctx,
 iot_error_t iot_easysetup_request(struct iot_context *ctx,
 				enum iot_easysetup_step step, const void *payload)
 {
-	struct iot_easysetup_payload *request = malloc(sizeof(struct iot_easysetup_payload));
+	struct iot_easysetup_payload *request = iot_mem_malloc(IOT_MEM_TAG_EASYSETUP, sizeof(struct iot_easysetup_payload));
 	int ret;
 	iot_error_t err;
 
+	if (!request) {
+		IOT_ERROR("failed to malloc for easysetup request");
+		return IOT_ERROR_MEM_ALLOC;
+	}
+
 	if (payload) {
 		request->payload = (char *)payload;
 	} else {
@@ -142,9 +156,10 @@ iot_error_t iot_easysetup_request(struct iot_context *ctx,
 
 	if (ctx->easysetup_req_queue) {
 		IOT_ERROR("Send to easysetup_req_queue Queue");
-		ret = iot_os_queue_send(ctx->easysetup_req_queue, request, 0);
+		ret = iot_os_queue_send(ctx->easysetup_req_queue, &request, 0);
 		if (ret != IOT_OS_TRUE) {
 			IOT_ERROR("Cannot put the request into easysetup_req_queue");
+			iot_mem_free(IOT_MEM_TAG_EASYSETUP, request);
 			err = IOT_ERROR_BAD_REQ;
 		} else {
 			iot_os_eventgroup_set_bits(ctx->iot_events,
@@ -153,6 +168,7 @@ iot_error_t iot_easysetup_request(struct iot_context *ctx,
 		}
 	} else {
 		IOT_ERROR("easysetup_req_queue is deleted");
+		iot_mem_free(IOT_MEM_TAG_EASYSETUP, request);
 		err = IOT_ERROR_BAD_REQ;
 	}
 
@@ -194,15 +210,15 @@ void iot_api_onboarding_config_mem_free(struct iot_devconf_prov_data *devconf)
 		return;
 
 	if (devconf->device_onboarding_id)
-		iot_os_free(devconf->device_onboarding_id);
+		iot_mem_free(IOT_MEM_TAG_CORE, devconf->device_onboarding_id);
 	if (devconf->mnid)
-		iot_os_free(devconf->mnid);
+		iot_mem_free(IOT_MEM_TAG_CORE, devconf->mnid);
 	if (devconf->setupid)
-		iot_os_free(devconf->setupid);
+		iot_mem_free(IOT_MEM_TAG_CORE, devconf->setupid);
 	if (devconf->vid)
-		iot_os_free(devconf->vid);
+		iot_mem_free(IOT_MEM_TAG_CORE, devconf->vid);
 	if (devconf->device_type)
-		iot_os_free(devconf->device_type);
+		iot_mem_free(IOT_MEM_TAG_CORE, devconf->device_type);
 }
 
 static const char name_onboardingConfig[] = "onboardingConfig";
@@ -236,7 +252,7 @@ iot_error_t iot_api_onboarding_config_load(unsigned char *onboarding_config,
 	if (!onboarding_config || !devconf || onboarding_config_len == 0)
 		return IOT_ERROR_INVALID_ARGS;
 
-	data = iot_os_malloc((size_t) onboarding_config_len + 1);
+	data = iot_mem_malloc(IOT_MEM_TAG_CORE, (size_t) onboarding_config_len + 1);
 	if (!data)
 		return IOT_ERROR_MEM_ALLOC;
 	memcpy(data, onboarding_config, onboarding_config_len);
@@ -263,7 +279,7 @@ iot_error_t iot_api_onboarding_config_load(unsigned char *onboarding_config,
 		iot_err = IOT_ERROR_UNINITIALIZED;
 		goto load_out;
 	}
-	device_onboarding_id = iot_os_malloc(str_len + 1);
+	device_onboarding_id = iot_mem_malloc(IOT_MEM_TAG_CORE, str_len + 1);
 	if (!device_onboarding_id) {
 		iot_err = IOT_ERROR_MEM_ALLOC;
 		goto load_out;
@@ -279,7 +295,7 @@ iot_error_t iot_api_onboarding_config_load(unsigned char *onboarding_config,
 		goto load_out;
 	}
 	str_len = strlen(JSON_GET_STRING_VALUE(item));
-	mnid = iot_os_malloc(str_len + 1);
+	mnid = iot_mem_malloc(IOT_MEM_TAG_CORE, str_len + 1);
 	if (!mnid) {
 		iot_err = IOT_ERROR_MEM_ALLOC;
 		goto load_out;
@@ -295,7 +311,7 @@ iot_error_t iot_api_onboarding_config_load(unsigned char *onboarding_config,
 		goto load_out;
 	}
 	str_len = strlen(JSON_GET_STRING_VALUE(item));
-	setupid = iot_os_malloc(str_len + 1);
+	setupid = iot_mem_malloc(IOT_MEM_TAG_CORE, str_len + 1);
 	if (!setupid) {
 		iot_err = IOT_ERROR_MEM_ALLOC;
 		goto load_out;
@@ -311,7 +327,7 @@ iot_error_t iot_api_onboarding_config_load(unsigned char *onboarding_config,
 		goto load_out;
 	}
 	str_len = strlen(JSON_GET_STRING_VALUE(item));
-	vid = iot_os_malloc(str_len + 1);
+	vid = iot_mem_malloc(IOT_MEM_TAG_CORE, str_len + 1);
 	if (!vid) {
 		iot_err = IOT_ERROR_MEM_ALLOC;
 		goto load_out;
@@ -327,7 +343,7 @@ iot_error_t iot_api_onboarding_config_load(unsigned char *onboarding_config,
 		goto load_out;
 	}
 	str_len = strlen(JSON_GET_STRING_VALUE(item));
-	devicetypeid = iot_os_malloc(str_len + 1);
+	devicetypeid = iot_mem_malloc(IOT_MEM_TAG_CORE, str_len + 1);
 	if (!devicetypeid) {
 		iot_err = IOT_ERROR_MEM_ALLOC;
 		goto load_out;
@@ -392,7 +408,7 @@ iot_error_t iot_api_onboarding_config_load(unsigned char *onboarding_config,
 	if (root)
 		JSON_DELETE(root);
 	if (data)
-		iot_os_free(data);
+		iot_mem_free(IOT_MEM_TAG_CORE, data);
 
 	return iot_err;
 
@@ -407,25 +423,25 @@ load_out:
 		}
 	}
 	if (device_onboarding_id) {
-		iot_os_free(device_onboarding_id);
+		iot_mem_free(IOT_MEM_TAG_CORE, device_onboarding_id);
 	}
 	if (mnid) {
-		iot_os_free(mnid);
+		iot_mem_free(IOT_MEM_TAG_CORE, mnid);
 	}
 	if (setupid) {
-		iot_os_free(setupid);
+		iot_mem_free(IOT_MEM_TAG_CORE, setupid);
 	}
 	if (vid) {
-		iot_os_free(vid);
+		iot_mem_free(IOT_MEM_TAG_CORE, vid);
 	}
 	if (devicetypeid) {
-		iot_os_free(devicetypeid);
+		iot_mem_free(IOT_MEM_TAG_CORE, devicetypeid);
 	}
 	if (root) {
 		JSON_DELETE(root);
 	}
 	if (data) {
-		iot_os_free(data);
+		iot_mem_free(IOT_MEM_TAG_CORE, data);
 	}
 
 	return iot_err;
@@ -463,16 +479,29 @@ iot_error_t iot_get_time_in_sec_by_long(long *sec)
 
 iot_error_t iot_get_time_in_ms(char *buf, size_t buf_len)
 {
-	struct timeval tv_now;
+	uint64_t time_in_ms;
 
 	if (!buf) {
 		IOT_ERROR("buffer for time is NULL");
 		return IOT_ERROR_INVALID_ARGS;
 	}
 
+	iot_get_time_in_ms_by_long(&time_in_ms);
+
+	return iot_util_convert_u64_str(time_in_ms, buf, (int)buf_len);
+}
+
+iot_error_t iot_get_time_in_ms_by_long(uint64_t *msec)
+{
+	struct timeval tv_now;
+
+	if (!msec) {
+		IOT_ERROR("buffer for time is NULL");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
 	gettimeofday(&tv_now, NULL);
-	snprintf(buf, buf_len, "%ld%03ld",
-		tv_now.tv_sec, (tv_now.tv_usec / 1000));
+	*msec = ((uint64_t)tv_now.tv_sec * 1000) + (tv_now.tv_usec / 1000);
 
 	return IOT_ERROR_NONE;
 }
@@ -483,7 +512,7 @@ void iot_api_device_info_mem_free(struct iot_device_info *device_info)
 		return;
 
 	if (device_info->firmware_version) {
-		iot_os_free(device_info->firmware_version);
+		iot_mem_free(IOT_MEM_TAG_CORE, device_info->firmware_version);
 		device_info->firmware_version = NULL;
 	}
 }
@@ -515,7 +544,7 @@ iot_error_t iot_api_device_info_load(unsigned char *device_info,
 	if (!device_info || !info || device_info_len == 0)
 		return IOT_ERROR_INVALID_ARGS;
 
-	data = iot_os_malloc((size_t) device_info_len + 1);
+	data = iot_mem_malloc(IOT_MEM_TAG_CORE, (size_t) device_info_len + 1);
 	if (!data)
 		return IOT_ERROR_MEM_ALLOC;
 	memcpy(data, device_info, device_info_len);
@@ -537,7 +566,7 @@ iot_error_t iot_api_device_info_load(unsigned char *device_info,
 		goto load_out;
 	}
 	str_len = strlen(JSON_GET_STRING_VALUE(item));
-	firmware_version = iot_os_malloc(str_len + 1);
+	firmware_version = iot_mem_malloc(IOT_MEM_TAG_CORE, str_len + 1);
 	if (!firmware_version) {
 		iot_err = IOT_ERROR_MEM_ALLOC;
 		goto load_out;
@@ -550,7 +579,7 @@ iot_error_t iot_api_device_info_load(unsigned char *device_info,
 	if (root)
 		JSON_DELETE(root);
 	if (data)
-		iot_os_free(data);
+		iot_mem_free(IOT_MEM_TAG_CORE, data);
 
 	_dump_device_info(info);
 
@@ -572,11 +601,11 @@ load_out:
 		}
 	}
 	if (firmware_version)
-		iot_os_free(firmware_version);
+		iot_mem_free(IOT_MEM_TAG_CORE, firmware_version);
 	if (root)
 		JSON_DELETE(root);
 	if (data)
-		iot_os_free(data);
+		iot_mem_free(IOT_MEM_TAG_CORE, data);
 
 	return iot_err;
 }
@@ -587,10 +616,10 @@ void iot_api_prov_data_mem_free(struct iot_device_prov_data *prov)
 		return;
 
 	if (prov->cloud.broker_url)
-		free(prov->cloud.broker_url);
+		iot_mem_free(IOT_MEM_TAG_CORE, prov->cloud.broker_url);
 
 	if (prov->cloud.label)
-		free(prov->cloud.label);
+		iot_mem_free(IOT_MEM_TAG_CORE, prov->cloud.label);
 
 	return;
 }
@@ -611,7 +640,7 @@ iot_error_t iot_api_read_device_identity(unsigned char* nv_prof,
 	if (!nv_prof || !nv_data || nv_prof_len == 0)
 		return IOT_ERROR_INVALID_ARGS;
 
-	data = iot_os_malloc((size_t) nv_prof_len + 1);
+	data = iot_mem_malloc(IOT_MEM_TAG_CORE, (size_t) nv_prof_len + 1);
 	if (!data)
 		return IOT_ERROR_MEM_ALLOC;
 	memcpy(data, nv_prof, nv_prof_len);
@@ -633,7 +662,7 @@ iot_error_t iot_api_read_device_identity(unsigned char* nv_prof,
 	}
 
 	str_len = strlen(JSON_GET_STRING_VALUE(item));
-	object_data = iot_os_malloc(str_len + 1);
+	object_data = iot_mem_malloc(IOT_MEM_TAG_NV, str_len + 1);
 	if (!object_data) {
 		iot_err = IOT_ERROR_MEM_ALLOC;
 		goto load_out;
@@ -647,7 +676,7 @@ iot_error_t iot_api_read_device_identity(unsigned char* nv_prof,
 	if (root)
 		JSON_DELETE(root);
 	if (data)
-		free(data);
+		iot_mem_free(IOT_MEM_TAG_CORE, data);
 
 	return iot_err;
 
@@ -665,7 +694,7 @@ load_out:
 	if (root)
 		JSON_DELETE(root);
 	if (data)
-		free(data);
+		iot_mem_free(IOT_MEM_TAG_CORE, data);
 
 	return iot_err;
 }
@@ -692,11 +721,13 @@ iot_error_t iot_device_cleanup(struct iot_context *ctx)
 	if((iot_err = iot_es_disconnect(ctx, IOT_CONNECT_TYPE_COMMUNICATION)) != IOT_ERROR_NONE)
 		IOT_ERROR("%s: mqtt disconnect failed %d", __func__, iot_err);
 
+	iot_es_release_warm_data(ctx);
+
 	config.mode = IOT_WIFI_MODE_OFF;
 	iot_bsp_wifi_set_mode(&config);
 
 	if(ctx->lookup_id) {
-		free(ctx->lookup_id);
+		iot_mem_free(IOT_MEM_TAG_CORE, ctx->lookup_id);
 		ctx->lookup_id = NULL;
 	}
 
@@ -17,7 +17,10 @@
  ****************************************************************************/
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <limits.h>
+#include <math.h>
 #include <cJSON.h>
 #if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
 #include <cbor.h>
@@ -28,17 +31,21 @@
 #include "iot_debug.h"
 #include "iot_capability.h"
 #include "iot_os_util.h"
+#include "iot_mem.h"
+#include "iot_trace.h"
 #include "iot_bsp_system.h"
 
 #define MAX_SQNUM 0x7FFFFFFF
 
-static int32_t sqnum = 0;
-
-static iot_error_t _iot_parse_noti_data(void *data, iot_noti_data_t *noti_data);
+STATIC_FUNCTION iot_error_t _iot_parse_noti_data(void *data, size_t data_len, iot_noti_data_t *noti_data);
 static iot_error_t _iot_parse_cmd_data(cJSON* cmditem, char** component,
 			char** capability, char** command, iot_cap_cmd_data_t* cmd_data);
-static iot_error_t _iot_make_evt_data(const char* component, const char* capability,
-			uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr, iot_cap_msg_t *msg);
+static iot_error_t _iot_make_evt_data(struct iot_cap_handle *handle,
+			uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr,
+			int32_t seq_num, const char *time_in_ms, iot_cap_msg_t *msg);
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+STATIC_FUNCTION iot_error_t _iot_make_evt_tmpl_cbor(struct iot_cap_handle *handle);
+#endif
 static void _iot_free_val(iot_cap_val_t* val);
 static void _iot_free_unit(iot_cap_unit_t* unit);
 static void _iot_free_cmd_data(iot_cap_cmd_data_t* cmd_data);
@@ -57,20 +64,20 @@ IOT_EVENT* st_cap_attr_create_int(const char *attribute, int integer, const char
 		return NULL;
 	}
 
-	evt_data = iot_os_malloc(sizeof(iot_cap_evt_data_t));
+	evt_data = iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(iot_cap_evt_data_t));
 	if (!evt_data) {
 		IOT_ERROR("failed to malloc for evt_data");
 		return NULL;
 	}
 
 	memset(evt_data, 0, sizeof(iot_cap_evt_data_t));
-	evt_data->evt_type = iot_os_strdup(attribute);
+	evt_data->evt_type = iot_mem_strdup(IOT_MEM_TAG_CAP, attribute);
 	evt_data->evt_value.type = IOT_CAP_VAL_TYPE_INTEGER;
 	evt_data->evt_value.integer = integer;
 
 	if (unit != NULL) {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_STRING;
-		evt_data->evt_unit.string = iot_os_strdup(unit);
+		evt_data->evt_unit.string = iot_mem_strdup(IOT_MEM_TAG_CAP, unit);
 	} else {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_UNUSED;
 	}
@@ -87,20 +94,20 @@ IOT_EVENT* st_cap_attr_create_number(const char *attribute, double number, const
 		return NULL;
 	}
 
-	evt_data = iot_os_malloc(sizeof(iot_cap_evt_data_t));
+	evt_data = iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(iot_cap_evt_data_t));
 	if (!evt_data) {
 		IOT_ERROR("failed to malloc for evt_data");
 		return NULL;
 	}
 
 	memset(evt_data, 0, sizeof(iot_cap_evt_data_t));
-	evt_data->evt_type = iot_os_strdup(attribute);
+	evt_data->evt_type = iot_mem_strdup(IOT_MEM_TAG_CAP, attribute);
 	evt_data->evt_value.type = IOT_CAP_VAL_TYPE_NUMBER;
 	evt_data->evt_value.number = number;
 
 	if (unit != NULL) {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_STRING;
-		evt_data->evt_unit.string = iot_os_strdup(unit);
+		evt_data->evt_unit.string = iot_mem_strdup(IOT_MEM_TAG_CAP, unit);
 	} else {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_UNUSED;
 	}
@@ -117,20 +124,20 @@ IOT_EVENT* st_cap_attr_create_string(const char *attribute, char *string, const
 		return NULL;
 	}
 
-	evt_data = iot_os_malloc(sizeof(iot_cap_evt_data_t));
+	evt_data = iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(iot_cap_evt_data_t));
 	if (!evt_data) {
 		IOT_ERROR("failed to malloc for evt_data");
 		return NULL;
 	}
 
 	memset(evt_data, 0, sizeof(iot_cap_evt_data_t));
-	evt_data->evt_type = iot_os_strdup(attribute);
+	evt_data->evt_type = iot_mem_strdup(IOT_MEM_TAG_CAP, attribute);
 	evt_data->evt_value.type = IOT_CAP_VAL_TYPE_STRING;
-	evt_data->evt_value.string = iot_os_strdup(string);
+	evt_data->evt_value.string = iot_mem_strdup(IOT_MEM_TAG_CAP, string);
 
 	if (unit != NULL) {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_STRING;
-		evt_data->evt_unit.string = iot_os_strdup(unit);
+		evt_data->evt_unit.string = iot_mem_strdup(IOT_MEM_TAG_CAP, unit);
 	} else {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_UNUSED;
 	}
@@ -153,7 +160,7 @@ IOT_EVENT* st_cap_attr_create_string_array(const char *attribute,
 		return NULL;
 	}
 
-	evt_data = iot_os_malloc(sizeof(iot_cap_evt_data_t));
+	evt_data = iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(iot_cap_evt_data_t));
 	if (!evt_data) {
 		IOT_ERROR("failed to malloc for evt_data");
 		return NULL;
@@ -162,22 +169,22 @@ IOT_EVENT* st_cap_attr_create_string_array(const char *attribute,
 	memset(evt_data, 0, sizeof(iot_cap_evt_data_t));
 	evt_data->evt_value.type = IOT_CAP_VAL_TYPE_STR_ARRAY;
 	evt_data->evt_value.str_num = str_num;
-	evt_data->evt_value.strings = iot_os_malloc(str_num * sizeof(char*));
+	evt_data->evt_value.strings = iot_mem_malloc(IOT_MEM_TAG_CAP, str_num * sizeof(char*));
 	if (!evt_data->evt_value.strings) {
 		IOT_ERROR("failed to malloc for string array");
-		free(evt_data);
+		iot_mem_free(IOT_MEM_TAG_CAP, evt_data);
 		return NULL;
 	}
 
 	for (int i = 0; i < str_num; i++) {
 		if (string_array[i])
-			evt_data->evt_value.strings[i] = iot_os_strdup(string_array[i]);
+			evt_data->evt_value.strings[i] = iot_mem_strdup(IOT_MEM_TAG_CAP, string_array[i]);
 	}
 
-	evt_data->evt_type = iot_os_strdup(attribute);
+	evt_data->evt_type = iot_mem_strdup(IOT_MEM_TAG_CAP, attribute);
 	if (unit != NULL) {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_STRING;
-		evt_data->evt_unit.string = iot_os_strdup(unit);
+		evt_data->evt_unit.string = iot_mem_strdup(IOT_MEM_TAG_CAP, unit);
 	} else {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_UNUSED;
 	}
@@ -200,7 +207,7 @@ IOT_EVENT* st_cap_attr_create(const char *attribute,
 		return NULL;
 	}
 
-	evt_data = iot_os_malloc(sizeof(iot_cap_evt_data_t));
+	evt_data = iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(iot_cap_evt_data_t));
 	if (!evt_data) {
 		IOT_ERROR("failed to malloc for evt_data");
 		return NULL;
@@ -208,7 +215,7 @@ IOT_EVENT* st_cap_attr_create(const char *attribute,
 	memset(evt_data, 0, sizeof(iot_cap_evt_data_t));
 
 
-	evt_data->evt_type = iot_os_strdup(attribute);
+	evt_data->evt_type = iot_mem_strdup(IOT_MEM_TAG_CAP, attribute);
 	switch (value->type) {
 	case IOT_CAP_VAL_TYPE_INTEGER:
 		evt_data->evt_value.type = IOT_CAP_VAL_TYPE_INTEGER;
@@ -220,41 +227,41 @@ IOT_EVENT* st_cap_attr_create(const char *attribute,
 		break;
 	case IOT_CAP_VAL_TYPE_STRING:
 		evt_data->evt_value.type = IOT_CAP_VAL_TYPE_STRING;
-		evt_data->evt_value.string = iot_os_strdup(value->string);
+		evt_data->evt_value.string = iot_mem_strdup(IOT_MEM_TAG_CAP, value->string);
 		break;
 	case IOT_CAP_VAL_TYPE_STR_ARRAY:
 		evt_data->evt_value.type = IOT_CAP_VAL_TYPE_STR_ARRAY;
 		evt_data->evt_value.str_num = value->str_num;
-		evt_data->evt_value.strings = iot_os_malloc(value->str_num * sizeof(char*));
+		evt_data->evt_value.strings = iot_mem_malloc(IOT_MEM_TAG_CAP, value->str_num * sizeof(char*));
 		if (!evt_data->evt_value.strings) {
 			IOT_ERROR("failed to malloc for string array");
-			free(evt_data);
+			iot_mem_free(IOT_MEM_TAG_CAP, evt_data);
 			return NULL;
 		}
 		for (int i = 0; i < value->str_num; i++) {
 			if (value->strings[i])
-				evt_data->evt_value.strings[i] = iot_os_strdup(value->strings[i]);
+				evt_data->evt_value.strings[i] = iot_mem_strdup(IOT_MEM_TAG_CAP, value->strings[i]);
 		}
 		break;
 	case IOT_CAP_VAL_TYPE_JSON_OBJECT:
 		evt_data->evt_value.type = IOT_CAP_VAL_TYPE_JSON_OBJECT;
-		evt_data->evt_value.json_object = iot_os_strdup(value->json_object);
+		evt_data->evt_value.json_object = iot_mem_strdup(IOT_MEM_TAG_CAP, value->json_object);
 		break;
 	default:
 		IOT_ERROR("unknown attribute data type");
-		free(evt_data);
+		iot_mem_free(IOT_MEM_TAG_CAP, evt_data);
 		return NULL;
 	}
 
 	if (unit != NULL) {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_STRING;
-		evt_data->evt_unit.string = iot_os_strdup(unit);
+		evt_data->evt_unit.string = iot_mem_strdup(IOT_MEM_TAG_CAP, unit);
 	} else {
 		evt_data->evt_unit.type = IOT_CAP_UNIT_TYPE_UNUSED;
 	}
 
 	if (data != NULL) {
-		evt_data->evt_value_data = iot_os_strdup(data);
+		evt_data->evt_value_data = iot_mem_strdup(IOT_MEM_TAG_CAP, data);
 	}
 
 	return (IOT_EVENT*)evt_data;
@@ -266,7 +273,7 @@ void st_cap_attr_free(IOT_EVENT* event)
 
 	if (evt_data) {
 		_iot_free_evt_data(evt_data);
-		iot_os_free(evt_data);
+		iot_mem_free(IOT_MEM_TAG_CAP, evt_data);
 	}
 }
 
@@ -282,7 +289,7 @@ IOT_CAP_HANDLE *st_cap_handle_init(IOT_CTX *iot_ctx, const char *component,
 	    return NULL;
 	}
 
-	handle = iot_os_malloc(sizeof(struct iot_cap_handle));
+	handle = iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(struct iot_cap_handle));
 	if (!handle) {
 		IOT_ERROR("failed to malloc for iot_cap_handle");
 		return NULL;
@@ -291,32 +298,44 @@ IOT_CAP_HANDLE *st_cap_handle_init(IOT_CTX *iot_ctx, const char *component,
 	memset(handle, 0, sizeof(struct iot_cap_handle));
 
 	if (component) {
-		handle->component = iot_os_strdup(component);
+		handle->component = iot_mem_strdup(IOT_MEM_TAG_CAP, component);
 	} else {
-		handle->component = iot_os_strdup("main");
+		handle->component = iot_mem_strdup(IOT_MEM_TAG_CAP, "main");
 	}
 	if (!handle->component) {
 		IOT_ERROR("failed to malloc for component");
-		iot_os_free(handle);
+		iot_mem_free(IOT_MEM_TAG_CAP, handle);
 		return NULL;
 	}
 
-	handle->capability = iot_os_strdup(capability);
+	handle->capability = iot_mem_strdup(IOT_MEM_TAG_CAP, capability);
 	if (!handle->capability) {
 		IOT_ERROR("failed to malloc for capability");
-		iot_os_free((void *)handle->component);
-		iot_os_free(handle);
+		iot_mem_free(IOT_MEM_TAG_CAP, (void *)handle->component);
+		iot_mem_free(IOT_MEM_TAG_CAP, handle);
 		return NULL;
 	}
 
 	handle->cmd_list = NULL;
 
-	new_list = (iot_cap_handle_list_t *)iot_os_malloc(sizeof(iot_cap_handle_list_t));
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+	if (_iot_make_evt_tmpl_cbor(handle) != IOT_ERROR_NONE) {
+		iot_mem_free(IOT_MEM_TAG_CAP, (void *)handle->component);
+		iot_mem_free(IOT_MEM_TAG_CAP, (void *)handle->capability);
+		iot_mem_free(IOT_MEM_TAG_CAP, handle);
+		return NULL;
+	}
+#endif
+
+	new_list = (iot_cap_handle_list_t *)iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(iot_cap_handle_list_t));
 	if (!new_list) {
 		IOT_ERROR("failed to malloc for handle list");
-		iot_os_free((void *)handle->component);
-		iot_os_free((void *)handle->capability);
-		iot_os_free(handle);
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+		iot_mem_free(IOT_MEM_TAG_CAP, handle->evt_tmpl);
+#endif
+		iot_mem_free(IOT_MEM_TAG_CAP, (void *)handle->component);
+		iot_mem_free(IOT_MEM_TAG_CAP, (void *)handle->capability);
+		iot_mem_free(IOT_MEM_TAG_CAP, handle);
 		return NULL;
 	}
 
@@ -390,19 +409,19 @@ int st_cap_cmd_set_cb(IOT_CAP_HANDLE *cap_handle, const char *cmd_type,
 		cur_list = cur_list->next;
 	}
 
-	command = (iot_cap_cmd_set_t *)iot_os_malloc(sizeof(iot_cap_cmd_set_t));
+	command = (iot_cap_cmd_set_t *)iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(iot_cap_cmd_set_t));
 	if (!command) {
 		IOT_ERROR("failed to malloc for cmd set");
 		return IOT_ERROR_MEM_ALLOC;
 	}
-	command->cmd_type = iot_os_strdup(needle_str);
+	command->cmd_type = iot_mem_strdup(IOT_MEM_TAG_CAP, needle_str);
 	command->cmd_cb = cmd_cb;
 	command->usr_data = usr_data;
 
-	new_list = (iot_cap_cmd_set_list_t *)iot_os_malloc(sizeof(iot_cap_cmd_set_list_t));
+	new_list = (iot_cap_cmd_set_list_t *)iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(iot_cap_cmd_set_list_t));
 	if (!new_list) {
 		IOT_ERROR("failed to malloc for cmd set list");
-		iot_os_free(command);
+		iot_mem_free(IOT_MEM_TAG_CAP, command);
 		return IOT_ERROR_MEM_ALLOC;
 	}
 	new_list->command = command;
@@ -418,8 +437,13 @@ int st_cap_attr_send(IOT_CAP_HANDLE *cap_handle,
 	iot_cap_evt_data_t** evt_data = (iot_cap_evt_data_t**)event;
 	int ret;
 	struct iot_context *ctx;
-	iot_cap_msg_t *final_msg = (iot_cap_msg_t *)malloc(sizeof(iot_cap_msg_t));
+	iot_cap_msg_t *final_msg;
 	struct iot_cap_handle *handle = (struct iot_cap_handle*)cap_handle;
+	char time_in_ms[21]; /* 155934720000 is '2019-06-01 00:00:00.00 UTC' */
+	char *timestamp = time_in_ms;
+	int32_t sqnum;
+	unsigned int trace_seq;
+	unsigned int depth;
 	iot_error_t err;
 
 	if (!handle || !evt_data || !evt_num) {
@@ -433,21 +457,48 @@ int st_cap_attr_send(IOT_CAP_HANDLE *cap_handle,
 		return IOT_ERROR_BAD_REQ;
 	}
 
-	sqnum = (sqnum + 1) & MAX_SQNUM;	// Use only positive number
+	trace_seq = IOT_TRACE_BEGIN();
+
+	final_msg = (iot_cap_msg_t *)iot_mem_malloc(IOT_MEM_TAG_CAP, sizeof(iot_cap_msg_t));
+	if (!final_msg) {
+		IOT_ERROR("failed to malloc for final_msg");
+		IOT_TRACE_END(trace_seq, IOT_TRACE_STAGE_MAX);
+		return IOT_ERROR_MEM_ALLOC;
+	}
+
+	/* Sequence number and timestamp are shared by all events of this batch */
+	sqnum = (int32_t)(__atomic_add_fetch(&ctx->evt_sqnum, 1, __ATOMIC_RELAXED)
+			& MAX_SQNUM);	// Use only positive number
+	if (iot_get_time_in_ms(time_in_ms, sizeof(time_in_ms)) != IOT_ERROR_NONE) {
+		IOT_WARN("Cannot add optional timestamp value");
+		timestamp = NULL;
+	}
 
 	/* Make event data format & enqueue data */
-	err = _iot_make_evt_data(handle->component,
-			handle->capability, evt_num, evt_data, final_msg);
+	err = _iot_make_evt_data(handle, evt_num, evt_data,
+			sqnum, timestamp, final_msg);
 	if (err != IOT_ERROR_NONE) {
 		IOT_ERROR("Cannot make evt_data!!");
+		iot_mem_free(IOT_MEM_TAG_CAP, final_msg);
+		IOT_TRACE_END(trace_seq, IOT_TRACE_STAGE_MAX);
 		return err;
 	}
+	IOT_TRACE_MARK(trace_seq, IOT_TRACE_EVT_ENCODE);
+	final_msg->trace_seq = trace_seq;
 
 	IOT_ERROR("Send to pub_queue Queue");
-	ret = iot_os_queue_send(ctx->pub_queue, final_msg, 0);
+	/* main task can take the message before queue_send returns, so mark before */
+	IOT_TRACE_MARK(trace_seq, IOT_TRACE_EVT_ENQUEUE);
+	/* counted before send for the same reason */
+	depth = __atomic_add_fetch(&ctx->pub_queue_depth, 1, __ATOMIC_RELAXED);
+	iot_util_atomic_max(&ctx->conn_stats.pub_queue_hwm, depth);
+	ret = iot_os_queue_send(ctx->pub_queue, &final_msg, 0);
 	if (ret != IOT_OS_TRUE) {
 		IOT_WARN("Cannot put the paylod into pub_queue");
-		free(final_msg->msg);
+		__atomic_sub_fetch(&ctx->pub_queue_depth, 1, __ATOMIC_RELAXED);
+		IOT_TRACE_END(trace_seq, IOT_TRACE_STAGE_MAX);
+		iot_mem_free(IOT_MEM_TAG_CAP, final_msg->msg);
+		iot_mem_free(IOT_MEM_TAG_CAP, final_msg);
 
 		return IOT_ERROR_BAD_REQ;
 	} else {
@@ -458,166 +509,114 @@ int st_cap_attr_send(IOT_CAP_HANDLE *cap_handle,
 	}
 }
 
-static iot_error_t _iot_parse_noti_data(void *data, iot_noti_data_t *noti_data)
+static iot_error_t _iot_noti_get_string(void *data, size_t data_len,
+		const char *key, char *buf, size_t buf_len)
 {
-	iot_error_t err = IOT_ERROR_NONE;
-	size_t noti_str_len;
-	cJSON *json = NULL;
-	cJSON *noti_type = NULL;
-	cJSON *item = NULL;
-	char *payload = NULL;
-	char time_str[11] = {0,};
-
 #if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
-	char *payload_json = NULL;
-	size_t payload_json_len = 0;
+	return iot_serialize_cbor_get_string((const uint8_t *)data, data_len,
+			key, buf, buf_len);
+#else
+	return iot_util_json_get_string((const char *)data, data_len,
+			key, buf, buf_len);
+#endif
+}
 
-	if (iot_serialize_cbor2json((uint8_t *)data, strlen(data), &payload_json, &payload_json_len)) {
-		IOT_ERROR("cbor2json failed");
-		return IOT_ERROR_BAD_REQ;
-	}
+static iot_error_t _iot_noti_get_int(void *data, size_t data_len,
+		const char *key, int *val)
+{
+	iot_error_t err;
+	int64_t num;
 
-	if ((payload_json == NULL) || (payload_json_len == 0)) {
-		IOT_ERROR("json buffer is null");
+#if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+	err = iot_serialize_cbor_get_int((const uint8_t *)data, data_len, key, &num);
+#else
+	err = iot_util_json_get_int((const char *)data, data_len, key, &num);
+#endif
+	if (err != IOT_ERROR_NONE) {
+		IOT_ERROR("there is no %s in raw_msgn", key);
 		return IOT_ERROR_BAD_REQ;
 	}
 
-	json = cJSON_Parse(payload_json);
-	free(payload_json);
-#else
-	json = cJSON_Parse(data);
-#endif
-	if (json == NULL) {
+	if (num > INT_MAX)
+		*val = INT_MAX;
+	else if (num < INT_MIN)
+		*val = INT_MIN;
+	else
+		*val = (int)num;
+
+	return IOT_ERROR_NONE;
+}
+
+/*
+ * Reads each member straight out of the received payload,
+ * so no json tree or converted copy is built for a notification
+ */
+STATIC_FUNCTION iot_error_t _iot_parse_noti_data(void *data, size_t data_len, iot_noti_data_t *noti_data)
+{
+	iot_error_t err = IOT_ERROR_NONE;
+	char noti_type[32];
+	char time_str[11] = {0,};
+	int cur_time;
+
+	if (!data || !data_len || !noti_data)
+		return IOT_ERROR_INVALID_ARGS;
+
+#if !defined(STDK_IOT_CORE_SERIALIZE_CBOR)
+	if (!iot_util_json_is_valid((const char *)data, data_len)) {
 		IOT_ERROR("Cannot parse by json");
 		return IOT_ERROR_BAD_REQ;
 	}
+	IOT_INFO("payload : %.*s", (int)data_len, (const char *)data);
+#endif
 
-	payload = cJSON_PrintUnformatted(json);
-	IOT_INFO("payload : %s", payload);
-	free(payload);
-
-	noti_type = cJSON_GetObjectItem(json, "event");
-	if (noti_type == NULL) {
+	if (_iot_noti_get_string(data, data_len, "event",
+			noti_type, sizeof(noti_type)) != IOT_ERROR_NONE) {
 		IOT_ERROR("there is no event in raw_msgn");
-		err = IOT_ERROR_BAD_REQ;
-		goto out_noti_parse;
+		return IOT_ERROR_BAD_REQ;
 	}
 
-	noti_str_len = strlen(noti_type->valuestring);
-	switch (noti_type->valuestring[0]) {
-	case 'd':	/* device.deleted */
-		if (noti_str_len != 14) {
-			IOT_ERROR("Untargeted event str_len : %s",
-				noti_type->valuestring);
-			err = IOT_ERROR_BAD_REQ;
-			break;
-		}
-
+	if (!strcmp(noti_type, "device.deleted")) {
 		noti_data->type = _IOT_NOTI_TYPE_DEV_DELETED;
-		break;
-
-	case 'e':	/* expired.jwt */
-		if (noti_str_len != 11) {
-			IOT_ERROR("Untargeted event str_len : %s",
-				noti_type->valuestring);
-			err = IOT_ERROR_BAD_REQ;
-			break;
-		}
-
+	} else if (!strcmp(noti_type, "expired.jwt")) {
 		noti_data->type = _IOT_NOTI_TYPE_JWT_EXPIRED;
 
-		item = cJSON_GetObjectItem(json, "currentTime");
-		if (item == NULL) {
-			IOT_ERROR("there is no currentTime in raw_msgn");
-			err = IOT_ERROR_BAD_REQ;
-			goto out_noti_parse;
-		}
+		err = _iot_noti_get_int(data, data_len, "currentTime", &cur_time);
+		if (err != IOT_ERROR_NONE)
+			return err;
 
-		snprintf(time_str, sizeof(time_str), "%d", item->valueint);
+		snprintf(time_str, sizeof(time_str), "%d", cur_time);
 		IOT_INFO("Set SNTP with current time %s", time_str);
 		iot_bsp_system_set_time_in_sec(time_str);
-		break;
-
-	case 'r':	/* rate.limit.reached */
-		if (noti_str_len != 18) {
-			IOT_ERROR("Untargeted event str_len : %s",
-				noti_type->valuestring);
-			err = IOT_ERROR_BAD_REQ;
-			break;
-		}
-
+	} else if (!strcmp(noti_type, "rate.limit.reached")) {
 		noti_data->type = _IOT_NOTI_TYPE_RATE_LIMIT;
 
-		item = cJSON_GetObjectItem(json, "count");
-		if (item == NULL) {
-			IOT_ERROR("there is no count in raw_msgn");
-			err = IOT_ERROR_BAD_REQ;
-			goto out_noti_parse;
-		}
-		noti_data->raw.rate_limit.count = item->valueint;
-
-		item = cJSON_GetObjectItem(json, "threshold");
-		if (item == NULL) {
-			IOT_ERROR("there is no threshold in raw_msgn");
-			err = IOT_ERROR_BAD_REQ;
-			goto out_noti_parse;
-		}
-		noti_data->raw.rate_limit.threshold = item->valueint;
-
-		item = cJSON_GetObjectItem(json, "remainingTime");
-		if (item == NULL) {
-			IOT_ERROR("there is no remainingTime in raw_msgn");
-			err = IOT_ERROR_BAD_REQ;
-			goto out_noti_parse;
-		}
-		noti_data->raw.rate_limit.remainingTime = item->valueint;
-
-		item = cJSON_GetObjectItem(json, "sequenceNumber");
-		if (item == NULL) {
-			IOT_ERROR("there is no sequenceNumber in raw_msgn");
-			err = IOT_ERROR_BAD_REQ;
-			goto out_noti_parse;
-		}
-		noti_data->raw.rate_limit.sequenceNumber = item->valueint;
-		break;
-	case 'q':	/* quota.reached */
-		if (noti_str_len != 13) {
-			IOT_ERROR("Untargeted event str_len : %s",
-				noti_type->valuestring);
-			err = IOT_ERROR_BAD_REQ;
-			break;
-		}
-
+		if ((err = _iot_noti_get_int(data, data_len, "count",
+				&noti_data->raw.rate_limit.count)) != IOT_ERROR_NONE
+			|| (err = _iot_noti_get_int(data, data_len, "threshold",
+				&noti_data->raw.rate_limit.threshold)) != IOT_ERROR_NONE
+			|| (err = _iot_noti_get_int(data, data_len, "remainingTime",
+				&noti_data->raw.rate_limit.remainingTime)) != IOT_ERROR_NONE
+			|| (err = _iot_noti_get_int(data, data_len, "sequenceNumber",
+				&noti_data->raw.rate_limit.sequenceNumber)) != IOT_ERROR_NONE)
+			return err;
+	} else if (!strcmp(noti_type, "quota.reached")) {
 		noti_data->type = _IOT_NOTI_TYPE_QUOTA_REACHED;
 
-		item = cJSON_GetObjectItem(json, "used");
-		if (item == NULL) {
-			IOT_ERROR("there is no used in raw_msgn");
-			err = IOT_ERROR_BAD_REQ;
-			goto out_noti_parse;
-		}
-		noti_data->raw.quota.used = item->valueint;
-
-		item = cJSON_GetObjectItem(json, "limit");
-		if (item == NULL) {
-			IOT_ERROR("there is no limit in raw_msgn");
-			err = IOT_ERROR_BAD_REQ;
-			goto out_noti_parse;
-		}
-		noti_data->raw.quota.limit = item->valueint;
-		break;
+		if ((err = _iot_noti_get_int(data, data_len, "used",
+				&noti_data->raw.quota.used)) != IOT_ERROR_NONE
+			|| (err = _iot_noti_get_int(data, data_len, "limit",
+				&noti_data->raw.quota.limit)) != IOT_ERROR_NONE)
+			return err;
+	} else {
+		IOT_ERROR("Untargeted event : %s", noti_type);
+		err = IOT_ERROR_BAD_REQ;
 	}
 
-out_noti_parse:
-
-	if (json)
-		cJSON_Delete(json);
-
 	return err;
 }
 
 
-void iot_noti_sub_cb(struct iot_context *ctx, char *payload)
+void iot_noti_sub_cb(struct iot_context *ctx, char *payload, size_t payload_len)
 {
 	iot_error_t err;
 	iot_noti_data_t noti_data;
@@ -629,7 +628,7 @@ void iot_noti_sub_cb(struct iot_context *ctx, char *payload)
 
 	memset(&noti_data, 0, sizeof(iot_noti_data_t));
 
-	err = _iot_parse_noti_data((void *)payload, &noti_data);
+	err = _iot_parse_noti_data((void *)payload, payload_len, &noti_data);
 	if (err != IOT_ERROR_NONE) {
 		IOT_ERROR("Cannot parse notification data");
 		return;
@@ -639,7 +638,8 @@ void iot_noti_sub_cb(struct iot_context *ctx, char *payload)
 		&noti_data, sizeof(noti_data));
 }
 
-void iot_cap_sub_cb(iot_cap_handle_list_t *cap_handle_list, char *payload)
+void iot_cap_sub_cb(iot_cap_handle_list_t *cap_handle_list, char *payload,
+		unsigned int trace_seq)
 {
 	cJSON *json = NULL;
 	cJSON *cap_cmds = NULL;
@@ -656,6 +656,7 @@ void iot_cap_sub_cb(iot_cap_handle_list_t *cap_handle_list, char *payload)
 	struct iot_cap_cmd_set_list *command_list;
 	int k;
 	int arr_size = 0;
+	iot_trace_stage_t trace_total = IOT_TRACE_STAGE_MAX;
 
 	if (!cap_handle_list || !payload) {
 		IOT_ERROR("There is no cap_handle_list or payload");
@@ -678,7 +679,7 @@ void iot_cap_sub_cb(iot_cap_handle_list_t *cap_handle_list, char *payload)
 	}
 
 	json = cJSON_Parse(payload_json);
-	free(payload_json);
+	iot_mem_free(IOT_MEM_TAG_CORE, payload_json);
 #else
 	json = cJSON_Parse(payload);
 #endif
@@ -689,7 +690,7 @@ void iot_cap_sub_cb(iot_cap_handle_list_t *cap_handle_list, char *payload)
 
 	raw_data = cJSON_PrintUnformatted(json);
 	IOT_INFO("command : %s", raw_data);
-	free(raw_data);
+	cJSON_free(raw_data);
 
 	cap_cmds = cJSON_GetObjectItem(json, "commands");
 	if (cap_cmds == NULL) {
@@ -742,8 +743,11 @@ void iot_cap_sub_cb(iot_cap_handle_list_t *cap_handle_list, char *payload)
 		while (command_list != NULL) {
 			command = command_list->command;
 			if (!strcmp(cmd, command->cmd_type)) {
+				IOT_TRACE_MARK(trace_seq, IOT_TRACE_CMD_DISPATCH);
 				command->cmd_cb((IOT_CAP_HANDLE *)handle,
 					&cmd_data, command->usr_data);
+				IOT_TRACE_MARK(trace_seq, IOT_TRACE_CMD_CALLBACK);
+				trace_total = IOT_TRACE_CMD_TOTAL;
 				break;
 			}
 
@@ -760,17 +764,17 @@ void iot_cap_sub_cb(iot_cap_handle_list_t *cap_handle_list, char *payload)
 		}
 
 		if (com != NULL) {
-			free(com);
+			iot_mem_free(IOT_MEM_TAG_CAP, com);
 			com = NULL;
 		}
 
 		if (cap != NULL) {
-			free(cap);
+			iot_mem_free(IOT_MEM_TAG_CAP, cap);
 			cap = NULL;
 		}
 
 		if (cmd != NULL) {
-			free(cmd);
+			iot_mem_free(IOT_MEM_TAG_CAP, cmd);
 			cmd = NULL;
 		}
 	}
@@ -780,16 +784,18 @@ out:
 		_iot_free_cmd_data(&cmd_data);
 
 	if (com != NULL)
-		free(com);
+		iot_mem_free(IOT_MEM_TAG_CAP, com);
 
 	if (cap != NULL)
-		free(cap);
+		iot_mem_free(IOT_MEM_TAG_CAP, cap);
 
 	if (cmd != NULL)
-		free(cmd);
+		iot_mem_free(IOT_MEM_TAG_CAP, cmd);
 
 	if (json != NULL)
 		cJSON_Delete(json);
+
+	IOT_TRACE_END(trace_seq, trace_total);
 }
 
 
@@ -815,9 +821,9 @@ static iot_error_t _iot_parse_cmd_data(cJSON* cmditem, char** component,
 		return IOT_ERROR_BAD_REQ;
 	}
 
-	*component = iot_os_strdup(cap_component->valuestring);
-	*capability = iot_os_strdup(cap_capability->valuestring);
-	*command = iot_os_strdup(cap_command->valuestring);
+	*component = iot_mem_strdup(IOT_MEM_TAG_CAP, cap_component->valuestring);
+	*capability = iot_mem_strdup(IOT_MEM_TAG_CAP, cap_capability->valuestring);
+	*command = iot_mem_strdup(IOT_MEM_TAG_CAP, cap_command->valuestring);
 
 	IOT_DEBUG("component:%s, capability:%s command:%s", *component, *capability, *command);
 
@@ -839,13 +845,17 @@ static iot_error_t _iot_parse_cmd_data(cJSON* cmditem, char** component,
 				IOT_DEBUG("[%d] %s", num_args, cJSON_GetStringValue(subitem));
 				cmd_data->args_str[num_args] = NULL;
 				cmd_data->cmd_data[num_args].type = IOT_CAP_VAL_TYPE_STRING;
-				cmd_data->cmd_data[num_args].string = iot_os_strdup(cJSON_GetStringValue(subitem));
+				cmd_data->cmd_data[num_args].string = iot_mem_strdup(IOT_MEM_TAG_CAP, cJSON_GetStringValue(subitem));
 				num_args++;
 			}
 			else if (cJSON_IsObject(subitem)) {
+				char *json_object = cJSON_PrintUnformatted(subitem);
+
 				cmd_data->args_str[num_args] = NULL;
 				cmd_data->cmd_data[num_args].type = IOT_CAP_VAL_TYPE_JSON_OBJECT;
-				cmd_data->cmd_data[num_args].json_object = cJSON_PrintUnformatted(subitem);
+				/* cJSON owns the printed buffer, keep it tagged like other values */
+				cmd_data->cmd_data[num_args].json_object = iot_mem_strdup(IOT_MEM_TAG_CAP, json_object);
+				cJSON_free(json_object);
 				IOT_DEBUG("[%d] %s", num_args, cmd_data->cmd_data[num_args].json_object);
 				num_args++;
 			}
@@ -859,245 +869,525 @@ static iot_error_t _iot_parse_cmd_data(cJSON* cmditem, char** component,
 
 
 #if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
-static iot_error_t _iot_make_evt_data_cbor(const char* component, const char* capability,
-			uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr, iot_cap_msg_t *msg)
+/* Pre-encoded CBOR text strings for the constant keys of deviceEvents */
+static const char _cbor_key_device_events[] = "\x6c" "deviceEvents";
+static const char _cbor_key_component[] = "\x69" "component";
+static const char _cbor_key_capability[] = "\x6a" "capability";
+static const char _cbor_key_attribute[] = "\x69" "attribute";
+static const char _cbor_key_value[] = "\x65" "value";
+static const char _cbor_key_unit[] = "\x64" "unit";
+static const char _cbor_key_provider_data[] = "\x6c" "providerData";
+static const char _cbor_key_sequence_number[] = "\x6e" "sequenceNumber";
+static const char _cbor_key_timestamp[] = "\x69" "timestamp";
+
+#define _IOT_CBOR_KEY_LEN(key)	(sizeof(key) - 1)
+#define _IOT_CBOR_PUT_KEY(p, key) \
+	do { \
+		memcpy(p, key, _IOT_CBOR_KEY_LEN(key)); \
+		p += _IOT_CBOR_KEY_LEN(key); \
+	} while (0)
+
+#define _IOT_CBOR_MAJOR_UINT	0
+#define _IOT_CBOR_MAJOR_NINT	1
+#define _IOT_CBOR_MAJOR_TEXT	3
+#define _IOT_CBOR_MAJOR_ARRAY	4
+#define _IOT_CBOR_MAJOR_MAP	5
+#define _IOT_CBOR_DOUBLE	0xfb
+
+static size_t _iot_cbor_head_len(uint64_t val)
+{
+	if (val < 24)
+		return 1;
+	else if (val <= 0xff)
+		return 2;
+	else if (val <= 0xffff)
+		return 3;
+	else if (val <= 0xffffffff)
+		return 5;
+	else
+		return 9;
+}
+
+static uint8_t *_iot_cbor_put_head(uint8_t *p, uint8_t major, uint64_t val)
+{
+	size_t len = _iot_cbor_head_len(val);
+	int shift;
+
+	if (len == 1) {
+		*p++ = (uint8_t)((major << 5) | val);
+		return p;
+	}
+
+	/* additional info 24, 25, 26, 27 for 1, 2, 4, 8 bytes argument */
+	*p++ = (uint8_t)((major << 5) | (len == 2 ? 24 : len == 3 ? 25 : len == 5 ? 26 : 27));
+	for (shift = (int)(len - 2) * 8; shift >= 0; shift -= 8)
+		*p++ = (uint8_t)(val >> shift);
+
+	return p;
+}
+
+static size_t _iot_cbor_text_len(const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+
+	return _iot_cbor_head_len(len) + len;
+}
+
+static uint8_t *_iot_cbor_put_text(uint8_t *p, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+
+	p = _iot_cbor_put_head(p, _IOT_CBOR_MAJOR_TEXT, len);
+	if (len) {
+		memcpy(p, str, len);
+		p += len;
+	}
+
+	return p;
+}
+
+static size_t _iot_cbor_int_len(int64_t val)
+{
+	if (val < 0)
+		return _iot_cbor_head_len((uint64_t)(-1 - val));
+
+	return _iot_cbor_head_len((uint64_t)val);
+}
+
+static uint8_t *_iot_cbor_put_int(uint8_t *p, int64_t val)
+{
+	if (val < 0)
+		return _iot_cbor_put_head(p, _IOT_CBOR_MAJOR_NINT, (uint64_t)(-1 - val));
+
+	return _iot_cbor_put_head(p, _IOT_CBOR_MAJOR_UINT, (uint64_t)val);
+}
+
+static uint8_t *_iot_cbor_put_double(uint8_t *p, double val)
 {
-	CborEncoder root = {0};
-	CborEncoder root_map = {0};
-	CborEncoder event_array = {0};
-	CborEncoder event_map = {0};
-	CborEncoder sub_array = {0};
-	CborEncoder provider_map = {0};
-	char time_in_ms[16] = {0}; /* 155934720000 is '2019-06-01 00:00:00.00 UTC' */
+	uint64_t bits;
+	int shift;
+
+	memcpy(&bits, &val, sizeof(bits));
+	*p++ = _IOT_CBOR_DOUBLE;
+	for (shift = 56; shift >= 0; shift -= 8)
+		*p++ = (uint8_t)(bits >> shift);
+
+	return p;
+}
+
+STATIC_FUNCTION
+iot_error_t _iot_make_evt_tmpl_cbor(struct iot_cap_handle *handle)
+{
+	uint8_t *tmpl;
+	uint8_t *p;
+	size_t tmpl_len;
+
+	/* "component": <component>, "capability": <capability>, "attribute" */
+	tmpl_len = _IOT_CBOR_KEY_LEN(_cbor_key_component)
+			+ _iot_cbor_text_len(handle->component)
+			+ _IOT_CBOR_KEY_LEN(_cbor_key_capability)
+			+ _iot_cbor_text_len(handle->capability)
+			+ _IOT_CBOR_KEY_LEN(_cbor_key_attribute);
+
+	tmpl = (uint8_t *)iot_mem_malloc(IOT_MEM_TAG_CAP, tmpl_len);
+	if (!tmpl) {
+		IOT_ERROR("failed to malloc for cbor template");
+		return IOT_ERROR_MEM_ALLOC;
+	}
+
+	p = tmpl;
+	_IOT_CBOR_PUT_KEY(p, _cbor_key_component);
+	p = _iot_cbor_put_text(p, handle->component);
+	_IOT_CBOR_PUT_KEY(p, _cbor_key_capability);
+	p = _iot_cbor_put_text(p, handle->capability);
+	_IOT_CBOR_PUT_KEY(p, _cbor_key_attribute);
+
+	handle->evt_tmpl = tmpl;
+	handle->evt_tmpl_len = tmpl_len;
+
+	return IOT_ERROR_NONE;
+}
+
+static size_t _iot_cbor_evt_value_len(iot_cap_val_t *value)
+{
+	size_t len;
+	int i;
+
+	switch (value->type) {
+	case IOT_CAP_VAL_TYPE_INTEGER:
+		return _iot_cbor_int_len(value->integer);
+	case IOT_CAP_VAL_TYPE_NUMBER:
+		return 1 + sizeof(double);
+	case IOT_CAP_VAL_TYPE_STRING:
+		return _iot_cbor_text_len(value->string);
+	case IOT_CAP_VAL_TYPE_STR_ARRAY:
+		len = _iot_cbor_head_len(value->str_num);
+		for (i = 0; i < value->str_num; i++)
+			len += _iot_cbor_text_len(value->strings[i]);
+		return len;
+	default:
+		return 0;
+	}
+}
+
+static uint8_t *_iot_cbor_put_evt_value(uint8_t *p, iot_cap_val_t *value)
+{
+	int i;
+
+	switch (value->type) {
+	case IOT_CAP_VAL_TYPE_INTEGER:
+		return _iot_cbor_put_int(p, value->integer);
+	case IOT_CAP_VAL_TYPE_NUMBER:
+		return _iot_cbor_put_double(p, value->number);
+	case IOT_CAP_VAL_TYPE_STRING:
+		return _iot_cbor_put_text(p, value->string);
+	case IOT_CAP_VAL_TYPE_STR_ARRAY:
+		p = _iot_cbor_put_head(p, _IOT_CBOR_MAJOR_ARRAY, value->str_num);
+		for (i = 0; i < value->str_num; i++)
+			p = _iot_cbor_put_text(p, value->strings[i]);
+		return p;
+	default:
+		return p;
+	}
+}
+
+STATIC_FUNCTION
+iot_error_t _iot_make_evt_data_cbor(struct iot_cap_handle *handle,
+			uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr,
+			int32_t seq_num, const char *time_in_ms, iot_cap_msg_t *msg)
+{
+	iot_cap_evt_data_t *evt_data;
 	uint8_t *buf;
-	uint8_t *tmp;
-	size_t buflen = 128;
+	uint8_t *p;
+	size_t provider_len;
 	size_t olen;
-	char **str_array_ptr;
 	int i;
-	int j;
 
 	if (!msg) {
 		IOT_ERROR("msg is NULL");
 		return IOT_ERROR_INVALID_ARGS;
 	}
-retry:
-	buflen += 128;
 
-	buf = (uint8_t *)iot_os_malloc(buflen);
-	if (buf == NULL) {
-		IOT_ERROR("failed to malloc for cbor");
-		return IOT_ERROR_MEM_ALLOC;
+	if (!handle->evt_tmpl) {
+		IOT_ERROR("cbor template is not ready");
+		return IOT_ERROR_INVALID_ARGS;
 	}
-	memset(buf, 0, buflen);
-
-	cbor_encoder_init(&root, buf, buflen, 0);
-
-	cbor_encoder_create_map(&root, &root_map, CborIndefiniteLength);
 
-	cbor_encode_text_stringz(&root_map, "deviceEvents");
-	cbor_encoder_create_array(&root_map, &event_array, CborIndefiniteLength);
-
-	cbor_encoder_create_map(&event_array, &event_map, CborIndefiniteLength);
+	/* providerData is same for all events in this batch */
+	provider_len = _IOT_CBOR_KEY_LEN(_cbor_key_provider_data) + 1
+			+ _IOT_CBOR_KEY_LEN(_cbor_key_sequence_number)
+			+ _iot_cbor_int_len(seq_num);
+	if (time_in_ms) {
+		provider_len += _IOT_CBOR_KEY_LEN(_cbor_key_timestamp)
+				+ _iot_cbor_text_len(time_in_ms);
+	}
 
+	/* Calculate exact payload size first, so it is encoded in one pass */
+	olen = 1 + _IOT_CBOR_KEY_LEN(_cbor_key_device_events)
+			+ _iot_cbor_head_len(arr_size);
 	for (i = 0; i < arr_size; i++) {
-		/* component */
-		cbor_encode_text_stringz(&event_map, "component");
-		cbor_encode_text_stringz(&event_map, component);
-
-		/* capability */
-		cbor_encode_text_stringz(&event_map, "capability");
-		cbor_encode_text_stringz(&event_map, capability);
-
-		/* attribute */
-		cbor_encode_text_stringz(&event_map, "attribute");
-		cbor_encode_text_stringz(&event_map, evt_data_arr[i]->evt_type);
+		evt_data = evt_data_arr[i];
 
-		/* value */
-		cbor_encode_text_stringz(&event_map, "value");
-		switch (evt_data_arr[i]->evt_value.type) {
+		switch (evt_data->evt_value.type) {
 		case IOT_CAP_VAL_TYPE_INTEGER:
-			cbor_encode_int(&event_map, evt_data_arr[i]->evt_value.integer);
-			break;
 		case IOT_CAP_VAL_TYPE_NUMBER:
-			cbor_encode_double(&event_map, evt_data_arr[i]->evt_value.number);
-			break;
 		case IOT_CAP_VAL_TYPE_STRING:
-			cbor_encode_text_stringz(&event_map, evt_data_arr[i]->evt_value.string);
-			break;
 		case IOT_CAP_VAL_TYPE_STR_ARRAY:
-			cbor_encoder_create_array(&event_map, &sub_array, CborIndefiniteLength);
-			str_array_ptr = (char **)evt_data_arr[i]->evt_value.strings;
-			for (j = 0; j < evt_data_arr[i]->evt_value.str_num; j++) {
-				cbor_encode_text_stringz(&sub_array, str_array_ptr[j]);
-			}
-			cbor_encoder_close_container_checked(&event_map, &sub_array);
 			break;
 		default:
-			IOT_ERROR("'%s' is not supported event type",
-					evt_data_arr[i]->evt_value.type);
-			goto exit_failed;
+			IOT_ERROR("'%d' is not supported event type",
+					evt_data->evt_value.type);
+			return IOT_ERROR_INVALID_ARGS;
 		}
 
-		/* unit */
-		if (evt_data_arr[i]->evt_unit.type == IOT_CAP_UNIT_TYPE_STRING) {
-			cbor_encode_text_stringz(&event_map, "unit");
-			cbor_encode_text_stringz(&event_map, evt_data_arr[i]->evt_unit.string);
+		olen += 1 + handle->evt_tmpl_len
+				+ _iot_cbor_text_len(evt_data->evt_type)
+				+ _IOT_CBOR_KEY_LEN(_cbor_key_value)
+				+ _iot_cbor_evt_value_len(&evt_data->evt_value)
+				+ provider_len;
+		if (evt_data->evt_unit.type == IOT_CAP_UNIT_TYPE_STRING) {
+			olen += _IOT_CBOR_KEY_LEN(_cbor_key_unit)
+					+ _iot_cbor_text_len(evt_data->evt_unit.string);
 		}
+	}
 
-		/* providerData */
-		cbor_encode_text_stringz(&event_map, "providerData");
-		cbor_encoder_create_map(&event_map, &provider_map, CborIndefiniteLength);
-		cbor_encode_text_stringz(&provider_map, "sequenceNumber");
-		cbor_encode_int(&provider_map, sqnum);
-		if (iot_get_time_in_ms(time_in_ms, sizeof(time_in_ms))) {
-			IOT_WARN("cannot add timestamp");
-		} else {
-			cbor_encode_text_stringz(&provider_map, "timestamp");
-			cbor_encode_text_stringz(&provider_map, time_in_ms);
-		}
-		cbor_encoder_close_container_checked(&event_map, &provider_map);
+	if (olen >= IOT_CBOR_MAX_BUF_LEN) {
+		IOT_ERROR("cbor payload is too large (%d >= %d)",
+				(int)olen, IOT_CBOR_MAX_BUF_LEN);
+		return IOT_ERROR_INVALID_ARGS;
 	}
 
-	cbor_encoder_close_container_checked(&event_array, &event_map);
-	cbor_encoder_close_container_checked(&root_map, &event_array);
-	cbor_encoder_close_container_checked(&root, &root_map);
+	buf = (uint8_t *)iot_mem_malloc(IOT_MEM_TAG_CAP, olen + 1);
+	if (buf == NULL) {
+		IOT_ERROR("failed to malloc for cbor");
+		return IOT_ERROR_MEM_ALLOC;
+	}
+
+	p = _iot_cbor_put_head(buf, _IOT_CBOR_MAJOR_MAP, 1);
+	_IOT_CBOR_PUT_KEY(p, _cbor_key_device_events);
+	p = _iot_cbor_put_head(p, _IOT_CBOR_MAJOR_ARRAY, arr_size);
+
+	for (i = 0; i < arr_size; i++) {
+		evt_data = evt_data_arr[i];
+
+		/* component, capability, attribute, value, [unit,] providerData */
+		if (evt_data->evt_unit.type == IOT_CAP_UNIT_TYPE_STRING)
+			p = _iot_cbor_put_head(p, _IOT_CBOR_MAJOR_MAP, 6);
+		else
+			p = _iot_cbor_put_head(p, _IOT_CBOR_MAJOR_MAP, 5);
+
+		memcpy(p, handle->evt_tmpl, handle->evt_tmpl_len);
+		p += handle->evt_tmpl_len;
+		p = _iot_cbor_put_text(p, evt_data->evt_type);
+
+		_IOT_CBOR_PUT_KEY(p, _cbor_key_value);
+		p = _iot_cbor_put_evt_value(p, &evt_data->evt_value);
 
-	olen = cbor_encoder_get_buffer_size(&root, buf);
-	if (olen < buflen) {
-		tmp = (uint8_t *)realloc(buf, olen + 1);
-		if (!tmp) {
-			IOT_WARN("realloc failed for cbor");
-		} else {
-			buf = tmp;
+		if (evt_data->evt_unit.type == IOT_CAP_UNIT_TYPE_STRING) {
+			_IOT_CBOR_PUT_KEY(p, _cbor_key_unit);
+			p = _iot_cbor_put_text(p, evt_data->evt_unit.string);
 		}
-	} else {
-		IOT_ERROR("allocated size is not enough (%d < %d)",
-				(int)buflen, (int)olen);
-		if (buflen < IOT_CBOR_MAX_BUF_LEN) {
-			free(buf);
-			goto retry;
-		} else {
-			goto exit_failed;
+
+		_IOT_CBOR_PUT_KEY(p, _cbor_key_provider_data);
+		p = _iot_cbor_put_head(p, _IOT_CBOR_MAJOR_MAP, time_in_ms ? 2 : 1);
+		_IOT_CBOR_PUT_KEY(p, _cbor_key_sequence_number);
+		p = _iot_cbor_put_int(p, seq_num);
+		if (time_in_ms) {
+			_IOT_CBOR_PUT_KEY(p, _cbor_key_timestamp);
+			p = _iot_cbor_put_text(p, time_in_ms);
 		}
 	}
+	*p = '\0';
 
 	msg->msg = (char *)buf;
 	msg->msglen = olen;
 
 	return IOT_ERROR_NONE;
+}
+
+#else /* !STDK_IOT_CORE_SERIALIZE_CBOR */
+/*
+ * Streaming writer for deviceEvents payload. When buf is NULL, it only
+ * counts bytes, so same emit sequence is used for size preflight and
+ * for actual writing into the exactly sized publish buffer.
+ */
+struct _iot_json_writer {
+	char *buf;
+	size_t pos;
+};
+
+static void _iot_jw_raw(struct _iot_json_writer *w, const char *str, size_t len)
+{
+	if (w->buf)
+		memcpy(w->buf + w->pos, str, len);
+	w->pos += len;
+}
+
+#define _IOT_JW_LITERAL(w, lit)	_iot_jw_raw(w, lit, sizeof(lit) - 1)
 
-exit_failed:
-	free(buf);
+static void _iot_jw_string(struct _iot_json_writer *w, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
 
-	return IOT_ERROR_INVALID_ARGS;
+	if (w->buf) {
+		w->buf[w->pos] = '"';
+		w->pos = iot_util_json_escape(w->buf + w->pos + 1, str, len) - w->buf;
+		w->buf[w->pos++] = '"';
+	} else {
+		w->pos += iot_util_json_escaped_len(str, len) + 2;
+	}
 }
 
-#else /* !STDK_IOT_CORE_SERIALIZE_CBOR */
-static iot_error_t _iot_make_evt_data_json(const char* component, const char* capability,
-			uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr, iot_cap_msg_t *msg)
+static void _iot_jw_int(struct _iot_json_writer *w, int64_t val)
 {
-	char *data = NULL;
-	cJSON *evt_root = NULL;
-	cJSON *evt_arr = NULL;
-	cJSON *evt_item = NULL;
-	cJSON *evt_subarr = NULL;
-	cJSON *evt_subjson = NULL;
-	cJSON *evt_subdata = NULL;
-	cJSON *prov_data = NULL;
-	char time_in_ms[16]; /* 155934720000 is '2019-06-01 00:00:00.00 UTC' */
-	iot_error_t err = IOT_ERROR_NONE;
+	char num_str[22];
+	uint64_t abs_val;
+	size_t len = 0;
 
-	if (!msg) {
-		IOT_ERROR("msg is NULL");
-		return IOT_ERROR_INVALID_ARGS;
+	if (val < 0) {
+		num_str[len++] = '-';
+		abs_val = (uint64_t)(-(val + 1)) + 1;
+	} else {
+		abs_val = (uint64_t)val;
 	}
+	iot_util_convert_u64_str(abs_val, &num_str[len], sizeof(num_str) - len);
 
-	evt_root = cJSON_CreateObject();
-	evt_arr = cJSON_CreateArray();
+	_iot_jw_raw(w, num_str, strlen(num_str));
+}
+
+static void _iot_jw_number(struct _iot_json_writer *w, double val)
+{
+	char num_str[26];
+	double test;
+
+	/* Same number format with cJSON_PrintUnformatted */
+	if (isnan(val) || isinf(val)) {
+		_IOT_JW_LITERAL(w, "null");
+		return;
+	} else if (val >= INT_MIN && val <= INT_MAX && val == (double)(int)val) {
+		_iot_jw_int(w, (int)val);
+		return;
+	}
 
-	for (int i = 0; i < arr_size; i++) {
-		evt_item = cJSON_CreateObject();
+	snprintf(num_str, sizeof(num_str), "%1.15g", val);
+	if (sscanf(num_str, "%lg", &test) != 1 || test != val)
+		snprintf(num_str, sizeof(num_str), "%1.17g", val);
+
+	_iot_jw_raw(w, num_str, strlen(num_str));
+}
+
+static iot_error_t _iot_jw_evt_data(struct _iot_json_writer *w,
+			struct iot_cap_handle *handle, uint8_t arr_size,
+			iot_cap_evt_data_t** evt_data_arr, int32_t seq_num, const char *time_in_ms)
+{
+	iot_cap_evt_data_t *evt_data;
+	int i;
+	int j;
+
+	_IOT_JW_LITERAL(w, "{\"deviceEvents\":[");
+
+	for (i = 0; i < arr_size; i++) {
+		evt_data = evt_data_arr[i];
+
+		if (i > 0)
+			_IOT_JW_LITERAL(w, ",");
 
 		/* component */
-		cJSON_AddStringToObject(evt_item, "component", component);
+		_IOT_JW_LITERAL(w, "{\"component\":");
+		_iot_jw_string(w, handle->component);
 
 		/* capability */
-		cJSON_AddStringToObject(evt_item, "capability", capability);
+		_IOT_JW_LITERAL(w, ",\"capability\":");
+		_iot_jw_string(w, handle->capability);
 
 		/* attribute */
-		cJSON_AddStringToObject(evt_item, "attribute", evt_data_arr[i]->evt_type);
+		_IOT_JW_LITERAL(w, ",\"attribute\":");
+		_iot_jw_string(w, evt_data->evt_type);
 
 		/* value */
-		if (evt_data_arr[i]->evt_value.type == IOT_CAP_VAL_TYPE_INTEGER) {
-			cJSON_AddNumberToObject(evt_item, "value", evt_data_arr[i]->evt_value.integer);
-		} else if (evt_data_arr[i]->evt_value.type == IOT_CAP_VAL_TYPE_NUMBER) {
-			cJSON_AddNumberToObject(evt_item, "value", evt_data_arr[i]->evt_value.number);
-		} else if (evt_data_arr[i]->evt_value.type == IOT_CAP_VAL_TYPE_STRING) {
-			cJSON_AddStringToObject(evt_item, "value", evt_data_arr[i]->evt_value.string);
-		} else if (evt_data_arr[i]->evt_value.type == IOT_CAP_VAL_TYPE_STR_ARRAY) {
-			evt_subarr = cJSON_CreateStringArray(
-				(const char**)evt_data_arr[i]->evt_value.strings, evt_data_arr[i]->evt_value.str_num);
-			cJSON_AddItemToObject(evt_item, "value", evt_subarr);
-		} else if (evt_data_arr[i]->evt_value.type == IOT_CAP_VAL_TYPE_JSON_OBJECT) {
-			evt_subjson = cJSON_Parse(evt_data_arr[i]->evt_value.json_object);
-			cJSON_AddItemToObject(evt_item, "value", evt_subjson);
-		} else {
-			IOT_ERROR("Event data value type error :%d", evt_data_arr[i]->evt_value.type);
-			err = IOT_ERROR_INVALID_ARGS;
-			goto out;
+		_IOT_JW_LITERAL(w, ",\"value\":");
+		switch (evt_data->evt_value.type) {
+		case IOT_CAP_VAL_TYPE_INTEGER:
+			_iot_jw_int(w, evt_data->evt_value.integer);
+			break;
+		case IOT_CAP_VAL_TYPE_NUMBER:
+			_iot_jw_number(w, evt_data->evt_value.number);
+			break;
+		case IOT_CAP_VAL_TYPE_STRING:
+			_iot_jw_string(w, evt_data->evt_value.string);
+			break;
+		case IOT_CAP_VAL_TYPE_STR_ARRAY:
+			_IOT_JW_LITERAL(w, "[");
+			for (j = 0; j < evt_data->evt_value.str_num; j++) {
+				if (j > 0)
+					_IOT_JW_LITERAL(w, ",");
+				_iot_jw_string(w, evt_data->evt_value.strings[j]);
+			}
+			_IOT_JW_LITERAL(w, "]");
+			break;
+		case IOT_CAP_VAL_TYPE_JSON_OBJECT:
+			/* validated in preflight, spliced as it is */
+			_iot_jw_raw(w, evt_data->evt_value.json_object,
+					strlen(evt_data->evt_value.json_object));
+			break;
+		default:
+			IOT_ERROR("Event data value type error :%d", evt_data->evt_value.type);
+			return IOT_ERROR_INVALID_ARGS;
 		}
 
 		/* unit */
-		if (evt_data_arr[i]->evt_unit.type == IOT_CAP_UNIT_TYPE_STRING)
-			cJSON_AddStringToObject(evt_item, "unit", evt_data_arr[i]->evt_unit.string);
+		if (evt_data->evt_unit.type == IOT_CAP_UNIT_TYPE_STRING) {
+			_IOT_JW_LITERAL(w, ",\"unit\":");
+			_iot_jw_string(w, evt_data->evt_unit.string);
+		}
 
 		/* data */
-		if (evt_data_arr[i]->evt_value_data) {
-			evt_subdata = cJSON_Parse(evt_data_arr[i]->evt_value_data);
-			cJSON_AddItemToObject(evt_item, "data", evt_subdata);
+		if (evt_data->evt_value_data) {
+			_IOT_JW_LITERAL(w, ",\"data\":");
+			_iot_jw_raw(w, evt_data->evt_value_data,
+					strlen(evt_data->evt_value_data));
 		}
 
 		/* providerData */
-		prov_data = cJSON_CreateObject();
-		cJSON_AddNumberToObject(prov_data, "sequenceNumber", sqnum);
+		_IOT_JW_LITERAL(w, ",\"providerData\":{\"sequenceNumber\":");
+		_iot_jw_int(w, seq_num);
+		if (time_in_ms) {
+			_IOT_JW_LITERAL(w, ",\"timestamp\":");
+			_iot_jw_string(w, time_in_ms);
+		}
+		_IOT_JW_LITERAL(w, "}}");
+	}
 
-		if (iot_get_time_in_ms(time_in_ms, sizeof(time_in_ms)) != IOT_ERROR_NONE)
-			IOT_WARN("Cannot add optional timestamp value");
-		else
-			cJSON_AddStringToObject(prov_data, "timestamp", time_in_ms);
+	_IOT_JW_LITERAL(w, "]}");
 
-		cJSON_AddItemToObject(evt_item, "providerData", prov_data);
+	return IOT_ERROR_NONE;
+}
+
+STATIC_FUNCTION
+iot_error_t _iot_make_evt_data_json(struct iot_cap_handle *handle,
+			uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr,
+			int32_t seq_num, const char *time_in_ms, iot_cap_msg_t *msg)
+{
+	struct _iot_json_writer writer = {0};
+	iot_error_t err;
+	int i;
 
-		cJSON_AddItemToArray(evt_arr, evt_item);
+	if (!msg) {
+		IOT_ERROR("msg is NULL");
+		return IOT_ERROR_INVALID_ARGS;
 	}
 
-	cJSON_AddItemToObject(evt_root, "deviceEvents", evt_arr);
+	/* JSON fragments from user are spliced without reparsing, check them first */
+	for (i = 0; i < arr_size; i++) {
+		if (evt_data_arr[i]->evt_value.type == IOT_CAP_VAL_TYPE_JSON_OBJECT
+				&& (!evt_data_arr[i]->evt_value.json_object
+				|| !iot_util_json_is_valid(evt_data_arr[i]->evt_value.json_object,
+					strlen(evt_data_arr[i]->evt_value.json_object)))) {
+			IOT_ERROR("Invalid json object value for '%s'", evt_data_arr[i]->evt_type);
+			return IOT_ERROR_INVALID_ARGS;
+		}
 
-	data = cJSON_PrintUnformatted(evt_root);
-	if (!data) {
-		err = IOT_ERROR_MEM_ALLOC;
-	} else {
-		IOT_DEBUG("%s", data);
-		msg->msg = data;
-		msg->msglen = strlen(data);
+		if (evt_data_arr[i]->evt_value_data
+				&& !iot_util_json_is_valid(evt_data_arr[i]->evt_value_data,
+					strlen(evt_data_arr[i]->evt_value_data))) {
+			IOT_ERROR("Invalid json data for '%s'", evt_data_arr[i]->evt_type);
+			return IOT_ERROR_INVALID_ARGS;
+		}
 	}
 
-out:
-	if (evt_root != NULL)
-		cJSON_Delete(evt_root);
+	/* Calculate exact payload size first */
+	err = _iot_jw_evt_data(&writer, handle, arr_size, evt_data_arr, seq_num, time_in_ms);
+	if (err != IOT_ERROR_NONE)
+		return err;
 
-	return err;
+	writer.buf = (char *)iot_mem_malloc(IOT_MEM_TAG_CAP, writer.pos + 1);
+	if (!writer.buf) {
+		IOT_ERROR("failed to malloc for event payload");
+		return IOT_ERROR_MEM_ALLOC;
+	}
+	writer.pos = 0;
+
+	_iot_jw_evt_data(&writer, handle, arr_size, evt_data_arr, seq_num, time_in_ms);
+	writer.buf[writer.pos] = '\0';
+
+	IOT_DEBUG("%s", writer.buf);
+	msg->msg = writer.buf;
+	msg->msglen = writer.pos;
+
+	return IOT_ERROR_NONE;
 }
 #endif /* STDK_IOT_CORE_SERIALIZE_CBOR */
 
-static iot_error_t _iot_make_evt_data(const char* component, const char* capability,
-			uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr, iot_cap_msg_t *msg)
+static iot_error_t _iot_make_evt_data(struct iot_cap_handle *handle,
+			uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr,
+			int32_t seq_num, const char *time_in_ms, iot_cap_msg_t *msg)
 {
 #if defined(STDK_IOT_CORE_SERIALIZE_CBOR)
-	return _iot_make_evt_data_cbor(component, capability, arr_size, evt_data_arr, msg);
+	return _iot_make_evt_data_cbor(handle, arr_size,
+			evt_data_arr, seq_num, time_in_ms, msg);
 #else
-	return _iot_make_evt_data_json(component, capability, arr_size, evt_data_arr, msg);
+	return _iot_make_evt_data_json(handle, arr_size,
+			evt_data_arr, seq_num, time_in_ms, msg);
 #endif
 }
 
@@ -1131,18 +1421,18 @@ static void _iot_free_val(iot_cap_val_t* val)
 
 	if (val->type == IOT_CAP_VAL_TYPE_STRING
 				&& val->string != NULL) {
-		iot_os_free(val->string);
+		iot_mem_free(IOT_MEM_TAG_CAP, val->string);
 	}
 	else if (val->type == IOT_CAP_VAL_TYPE_STR_ARRAY
 				&& val->strings != NULL) {
 		for (int i = 0; i < val->str_num; i++) {
 			if (val->strings[i] != NULL) {
-				iot_os_free(val->strings[i]);
+				iot_mem_free(IOT_MEM_TAG_CAP, val->strings[i]);
 			}
 		}
-		iot_os_free(val->strings);
+		iot_mem_free(IOT_MEM_TAG_CAP, val->strings);
 	} else if (val->type == IOT_CAP_VAL_TYPE_JSON_OBJECT) {
-		iot_os_free(val->json_object);
+		iot_mem_free(IOT_MEM_TAG_CAP, val->json_object);
 	}
 }
 
@@ -1154,7 +1444,7 @@ static void _iot_free_unit(iot_cap_unit_t* unit)
 
 	if (unit->type == IOT_CAP_UNIT_TYPE_STRING
 				&& unit->string != NULL) {
-		iot_os_free(unit->string);
+		iot_mem_free(IOT_MEM_TAG_CAP, unit->string);
 	}
 }
 
@@ -1166,7 +1456,7 @@ static void _iot_free_cmd_data(iot_cap_cmd_data_t* cmd_data)
 
 	for (int i = 0; i < cmd_data->num_args; i++) {
 		if (cmd_data->args_str[i] != NULL) {
-			free(cmd_data->args_str[i]);
+			iot_mem_free(IOT_MEM_TAG_CAP, cmd_data->args_str[i]);
 		}
 		_iot_free_val(&cmd_data->cmd_data[i]);
 	}
@@ -1179,13 +1469,13 @@ static void _iot_free_evt_data(iot_cap_evt_data_t* evt_data)
 	}
 
 	if (evt_data->evt_type != NULL) {
-		iot_os_free((void *)evt_data->evt_type);
+		iot_mem_free(IOT_MEM_TAG_CAP, (void *)evt_data->evt_type);
 	}
 	_iot_free_val(&evt_data->evt_value);
 	_iot_free_unit(&evt_data->evt_unit);
 
 	if (evt_data->evt_value_data != NULL) {
-		iot_os_free(evt_data->evt_value_data);
+		iot_mem_free(IOT_MEM_TAG_CAP, evt_data->evt_value_data);
 	}
 }
 /* External API */
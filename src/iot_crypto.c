@@ -25,6 +25,8 @@
 iot_error_t iot_crypto_pk_init(iot_crypto_pk_context_t *ctx,
                                iot_crypto_pk_info_t *info)
 {
+	iot_error_t err;
+
 	if (ctx == NULL) {
 		IOT_ERROR("context is null");
 		return IOT_ERROR_CRYPTO_PK_INVALID_CTX;
@@ -36,6 +38,8 @@ iot_error_t iot_crypto_pk_init(iot_crypto_pk_context_t *ctx,
 	}
 
 	ctx->info = info;
+	ctx->fn = NULL;
+	ctx->key = NULL;
 	IOT_ERROR("info->type = %d", info->type);
 	switch (info->type) {
 #if defined(CONFIG_STDK_IOT_CORE_CRYPTO_SUPPORT_RSA)
@@ -53,11 +57,24 @@ iot_error_t iot_crypto_pk_init(iot_crypto_pk_context_t *ctx,
 		return IOT_ERROR_CRYPTO_PK_UNKNOWN_KEYTYPE;
 	}
 
+	/* parse or expand the key once, not for every signature */
+	if (ctx->fn->init) {
+		err = ctx->fn->init(ctx);
+		if (err) {
+			IOT_ERROR("%s init returned error : %d", ctx->fn->name, err);
+			memset(ctx, 0, sizeof(iot_crypto_pk_context_t));
+			return err;
+		}
+	}
+
 	return IOT_ERROR_NONE;
 }
 
 void iot_crypto_pk_free(iot_crypto_pk_context_t *ctx)
 {
+	if (ctx->fn && ctx->fn->free && ctx->key)
+		ctx->fn->free(ctx);
+
 	memset(ctx, 0, sizeof(iot_crypto_pk_context_t));
 }
 
@@ -98,3 +115,302 @@ iot_error_t iot_crypto_pk_verify(iot_crypto_pk_context_t *ctx,
 
 	return err;
 }
+
+iot_error_t iot_crypto_pk_sign_batch(iot_crypto_pk_context_t *ctx,
+                                     iot_crypto_pk_sign_req_t *reqs, size_t count,
+                                     size_t *done)
+{
+	iot_error_t err = IOT_ERROR_NONE;
+	size_t i;
+
+	if (done)
+		*done = 0;
+
+	if (ctx == NULL || ctx->fn == NULL) {
+		IOT_ERROR("context is null");
+		return IOT_ERROR_CRYPTO_PK_INVALID_CTX;
+	}
+
+	if (reqs == NULL && count > 0) {
+		IOT_ERROR("requests are null");
+		return IOT_ERROR_CRYPTO_PK_INVALID_ARG;
+	}
+
+	if (ctx->fn->sign == NULL) {
+		IOT_ERROR("%s sign is not supported", ctx->fn->name);
+		return IOT_ERROR_CRYPTO_PK_NULL_FUNC;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].input == NULL || reqs[i].sig == NULL) {
+			IOT_ERROR("request %d has null buffer", (int)i);
+			err = IOT_ERROR_CRYPTO_PK_INVALID_ARG;
+			break;
+		}
+
+		err = ctx->fn->sign(ctx, reqs[i].input, reqs[i].ilen,
+				reqs[i].sig, &reqs[i].slen);
+		if (err) {
+			IOT_ERROR("%s sign of request %d returned error : %d",
+					ctx->fn->name, (int)i, err);
+			break;
+		}
+	}
+
+	if (done)
+		*done = i;
+
+	return err;
+}
+
+#if defined(CONFIG_STDK_IOT_CORE_USE_MBEDTLS)
+static const iot_crypto_sha256_funcs_t *_iot_crypto_sha256_fn = &iot_crypto_sha256_mbedtls_funcs;
+#else
+static const iot_crypto_sha256_funcs_t *_iot_crypto_sha256_fn = NULL;
+#endif
+
+iot_error_t iot_crypto_sha256_set_funcs(const iot_crypto_sha256_funcs_t *fn)
+{
+	if (fn == NULL) {
+#if defined(CONFIG_STDK_IOT_CORE_USE_MBEDTLS)
+		_iot_crypto_sha256_fn = &iot_crypto_sha256_mbedtls_funcs;
+#else
+		_iot_crypto_sha256_fn = NULL;
+#endif
+		return IOT_ERROR_NONE;
+	}
+
+	if (!fn->init || !fn->update || !fn->final) {
+		IOT_ERROR("%s has null function", fn->name ? fn->name : "sha256");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	IOT_INFO("sha256 backend : %s", fn->name ? fn->name : "unnamed");
+	_iot_crypto_sha256_fn = fn;
+
+	return IOT_ERROR_NONE;
+}
+
+const iot_crypto_sha256_funcs_t *iot_crypto_sha256_get_funcs(void)
+{
+	return _iot_crypto_sha256_fn;
+}
+
+iot_error_t iot_crypto_sha256_init(iot_crypto_sha256_ctx_t *ctx)
+{
+	iot_error_t err;
+
+	if (ctx == NULL) {
+		IOT_ERROR("context is null");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	ctx->fn = NULL;
+	if (_iot_crypto_sha256_fn == NULL) {
+		IOT_ERROR("no sha256 backend");
+		return IOT_ERROR_CRYPTO_SHA256;
+	}
+
+	err = _iot_crypto_sha256_fn->init(ctx);
+	if (err) {
+		IOT_ERROR("%s init returned error : %d", _iot_crypto_sha256_fn->name, err);
+		return err;
+	}
+
+	/* a backend replaced later doesn't touch digests already started */
+	ctx->fn = _iot_crypto_sha256_fn;
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_crypto_sha256_update(iot_crypto_sha256_ctx_t *ctx,
+			const unsigned char *input, size_t ilen)
+{
+	if (ctx == NULL || (input == NULL && ilen > 0)) {
+		IOT_ERROR("invalid args");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	if (ctx->fn == NULL) {
+		IOT_ERROR("digest is not started");
+		return IOT_ERROR_CRYPTO_SHA256_INVALID_CTX;
+	}
+
+	if (ilen == 0)
+		return IOT_ERROR_NONE;
+
+	return ctx->fn->update(ctx, input, ilen);
+}
+
+iot_error_t iot_crypto_sha256_final(iot_crypto_sha256_ctx_t *ctx, unsigned char *dst)
+{
+	iot_error_t err;
+
+	if (ctx == NULL || dst == NULL) {
+		IOT_ERROR("invalid args");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	if (ctx->fn == NULL) {
+		IOT_ERROR("digest is not started");
+		return IOT_ERROR_CRYPTO_SHA256_INVALID_CTX;
+	}
+
+	err = ctx->fn->final(ctx, dst);
+	ctx->fn = NULL;
+
+	return err;
+}
+
+void iot_crypto_sha256_free(iot_crypto_sha256_ctx_t *ctx)
+{
+	if (ctx == NULL || ctx->fn == NULL)
+		return;
+
+	if (ctx->fn->free)
+		ctx->fn->free(ctx);
+	ctx->fn = NULL;
+}
+
+iot_error_t iot_crypto_sha256(unsigned char *src, size_t src_len, unsigned char *dst)
+{
+	iot_crypto_sha256_ctx_t ctx;
+	iot_error_t err;
+
+	IOT_DEBUG("src: %d@%p, dst: %p", src_len, src, dst);
+
+	err = iot_crypto_sha256_init(&ctx);
+	if (err)
+		return err;
+
+	err = iot_crypto_sha256_update(&ctx, src, src_len);
+	if (err) {
+		iot_crypto_sha256_free(&ctx);
+		return err;
+	}
+
+	return iot_crypto_sha256_final(&ctx, dst);
+}
+
+iot_error_t iot_crypto_hmac_sha256_init(iot_crypto_hmac_sha256_ctx_t *ctx,
+			const unsigned char *key, size_t key_len)
+{
+	unsigned char ikey[IOT_CRYPTO_SHA256_BLOCK_LEN];
+	iot_error_t err;
+	size_t i;
+
+	if (ctx == NULL || (key == NULL && key_len > 0)) {
+		IOT_ERROR("invalid args");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	ctx->sha.fn = NULL;
+	memset(ctx->okey, 0, sizeof(ctx->okey));
+
+	/* RFC 2104, a key longer than a block is replaced by its digest */
+	if (key_len > IOT_CRYPTO_SHA256_BLOCK_LEN) {
+		err = iot_crypto_sha256((unsigned char *)key, key_len, ctx->okey);
+		if (err)
+			return err;
+	} else if (key_len > 0) {
+		memcpy(ctx->okey, key, key_len);
+	}
+
+	for (i = 0; i < IOT_CRYPTO_SHA256_BLOCK_LEN; i++) {
+		ikey[i] = ctx->okey[i] ^ 0x36;
+		ctx->okey[i] ^= 0x5c;
+	}
+
+	err = iot_crypto_sha256_init(&ctx->sha);
+	if (!err) {
+		err = iot_crypto_sha256_update(&ctx->sha, ikey, sizeof(ikey));
+		if (err)
+			iot_crypto_sha256_free(&ctx->sha);
+	}
+
+	memset(ikey, 0, sizeof(ikey));
+	if (err)
+		memset(ctx->okey, 0, sizeof(ctx->okey));
+
+	return err;
+}
+
+iot_error_t iot_crypto_hmac_sha256_update(iot_crypto_hmac_sha256_ctx_t *ctx,
+			const unsigned char *input, size_t ilen)
+{
+	if (ctx == NULL) {
+		IOT_ERROR("context is null");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	return iot_crypto_sha256_update(&ctx->sha, input, ilen);
+}
+
+iot_error_t iot_crypto_hmac_sha256_final(iot_crypto_hmac_sha256_ctx_t *ctx,
+			unsigned char *dst)
+{
+	unsigned char inner[IOT_CRYPTO_SHA256_LEN];
+	iot_error_t err;
+
+	if (ctx == NULL || dst == NULL) {
+		IOT_ERROR("invalid args");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	err = iot_crypto_sha256_final(&ctx->sha, inner);
+	if (err)
+		goto exit;
+
+	err = iot_crypto_sha256_init(&ctx->sha);
+	if (err)
+		goto exit;
+
+	err = iot_crypto_sha256_update(&ctx->sha, ctx->okey, sizeof(ctx->okey));
+	if (!err)
+		err = iot_crypto_sha256_update(&ctx->sha, inner, sizeof(inner));
+	if (err) {
+		iot_crypto_sha256_free(&ctx->sha);
+		goto exit;
+	}
+
+	err = iot_crypto_sha256_final(&ctx->sha, dst);
+
+exit:
+	memset(inner, 0, sizeof(inner));
+	memset(ctx->okey, 0, sizeof(ctx->okey));
+
+	return err;
+}
+
+void iot_crypto_hmac_sha256_free(iot_crypto_hmac_sha256_ctx_t *ctx)
+{
+	if (ctx == NULL)
+		return;
+
+	iot_crypto_sha256_free(&ctx->sha);
+	memset(ctx->okey, 0, sizeof(ctx->okey));
+}
+
+iot_error_t iot_crypto_hmac_sha256(const unsigned char *key, size_t key_len,
+			const unsigned char *input, size_t ilen, unsigned char *dst)
+{
+	iot_crypto_hmac_sha256_ctx_t ctx;
+	iot_error_t err;
+
+	if (dst == NULL) {
+		IOT_ERROR("dst is null");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	err = iot_crypto_hmac_sha256_init(&ctx, key, key_len);
+	if (err)
+		return err;
+
+	err = iot_crypto_hmac_sha256_update(&ctx, input, ilen);
+	if (err) {
+		iot_crypto_hmac_sha256_free(&ctx);
+		return err;
+	}
+
+	return iot_crypto_hmac_sha256_final(&ctx, dst);
+}
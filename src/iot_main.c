@@ -28,6 +28,8 @@
 #include "iot_easysetup.h"
 #include "iot_capability.h"
 #include "iot_os_util.h"
+#include "iot_mem.h"
+#include "iot_trace.h"
 #include "iot_util.h"
 #include "iot_bsp_system.h"
 
@@ -35,6 +37,32 @@
 #define EASYSETUP_TIMEOUT_MS	(300000) /* 5 min */
 #define RECOVER_TRY_MAX			(5)
 
+#if defined(CONFIG_STDK_IOT_CORE_RECONNECT_BACKOFF_BASE_MS)
+#define RECONNECT_BACKOFF_BASE_MS	CONFIG_STDK_IOT_CORE_RECONNECT_BACKOFF_BASE_MS
+#else
+#define RECONNECT_BACKOFF_BASE_MS	(1000)
+#endif
+#if defined(CONFIG_STDK_IOT_CORE_RECONNECT_BACKOFF_CAP_MS)
+#define RECONNECT_BACKOFF_CAP_MS	CONFIG_STDK_IOT_CORE_RECONNECT_BACKOFF_CAP_MS
+#else
+#define RECONNECT_BACKOFF_CAP_MS	(60000)
+#endif
+#if defined(CONFIG_STDK_IOT_CORE_RECONNECT_STABLE_MS)
+#define RECONNECT_STABLE_MS			CONFIG_STDK_IOT_CORE_RECONNECT_STABLE_MS
+#else
+#define RECONNECT_STABLE_MS			(60000)
+#endif
+#if defined(CONFIG_STDK_IOT_CORE_RECONNECT_SERVER_UNAVAIL_MS)
+#define RECONNECT_SERVER_UNAVAIL_MS	CONFIG_STDK_IOT_CORE_RECONNECT_SERVER_UNAVAIL_MS
+#else
+#define RECONNECT_SERVER_UNAVAIL_MS	(30000)
+#endif
+#if defined(CONFIG_STDK_IOT_CORE_RECONNECT_WIFI_RESET_TRIALS)
+#define RECONNECT_WIFI_RESET_TRIALS	CONFIG_STDK_IOT_CORE_RECONNECT_WIFI_RESET_TRIALS
+#else
+#define RECONNECT_WIFI_RESET_TRIALS	(10)
+#endif
+
 static int rcv_try_cnt;
 static iot_state_t rcv_fail_state;
 
@@ -79,7 +107,7 @@ static iot_error_t _create_easysetup_resources(struct iot_context *ctx, iot_pin_
 	/* If PIN type used, iot_pin_t should be set */
 	if (ctx->devconf.ownership_validation_type & IOT_OVF_TYPE_PIN) {
 		if (!ctx->pin) {
-			if ((ctx->pin = malloc(sizeof(iot_pin_t))) == NULL) {
+			if ((ctx->pin = iot_mem_malloc(IOT_MEM_TAG_CORE, sizeof(iot_pin_t))) == NULL) {
 				IOT_ERROR("failed to malloc for pin");
 				return IOT_ERROR_MEM_ALLOC;
 			}
@@ -91,10 +119,10 @@ static iot_error_t _create_easysetup_resources(struct iot_context *ctx, iot_pin_
 			return IOT_ERROR_INVALID_ARGS;
 	}
 
-	if ((ctx->es_crypto_cipher_info = (iot_crypto_cipher_info_t *) malloc(sizeof(iot_crypto_cipher_info_t))) == NULL) {
+	if ((ctx->es_crypto_cipher_info = (iot_crypto_cipher_info_t *) iot_mem_malloc(IOT_MEM_TAG_CORE, sizeof(iot_crypto_cipher_info_t))) == NULL) {
 		IOT_ERROR("failed to malloc for cipher info");
 		if (ctx->pin) {
-			free(ctx->pin);
+			iot_mem_free(IOT_MEM_TAG_CORE, ctx->pin);
 			ctx->pin = NULL;
 		}
 
@@ -104,14 +132,14 @@ static iot_error_t _create_easysetup_resources(struct iot_context *ctx, iot_pin_
 	}
 
 	if (!ctx->easysetup_req_queue) {
-		ctx->easysetup_req_queue = iot_os_queue_create(1, sizeof(struct iot_easysetup_payload));
+		ctx->easysetup_req_queue = iot_os_queue_create(1, sizeof(struct iot_easysetup_payload *));
 		if (!ctx->easysetup_req_queue) {
 			IOT_ERROR("failed to create Queue for easysetup request\n");
-			free(ctx->es_crypto_cipher_info);
+			iot_mem_free(IOT_MEM_TAG_CORE, ctx->es_crypto_cipher_info);
 			ctx->es_crypto_cipher_info = NULL;
 
 			if (ctx->pin) {
-				free(ctx->pin);
+				iot_mem_free(IOT_MEM_TAG_CORE, ctx->pin);
 				ctx->pin = NULL;
 			}
 			return IOT_ERROR_BAD_REQ;
@@ -119,17 +147,17 @@ static iot_error_t _create_easysetup_resources(struct iot_context *ctx, iot_pin_
 	}
 
 	if (!ctx->easysetup_resp_queue) {
-		ctx->easysetup_resp_queue = iot_os_queue_create(1, sizeof(struct iot_easysetup_payload));
+		ctx->easysetup_resp_queue = iot_os_queue_create(1, sizeof(struct iot_easysetup_payload *));
 		if (!ctx->easysetup_resp_queue) {
 			IOT_ERROR("failed to create Queue for easysetup response\n");
 			iot_os_queue_delete(ctx->easysetup_req_queue);
 			ctx->easysetup_req_queue = NULL;
 
-			free(ctx->es_crypto_cipher_info);
+			iot_mem_free(IOT_MEM_TAG_CORE, ctx->es_crypto_cipher_info);
 			ctx->es_crypto_cipher_info = NULL;
 
 			if (ctx->pin) {
-				free(ctx->pin);
+				iot_mem_free(IOT_MEM_TAG_CORE, ctx->pin);
 				ctx->pin = NULL;
 			}
 			return IOT_ERROR_BAD_REQ;
@@ -146,11 +174,11 @@ static void _delete_easysetup_resources_all(struct iot_context *ctx)
 
 	if (ctx->pin) {
 		// if device connected to cloud successfully. We don't need pin anymore
-		free(ctx->pin);
+		iot_mem_free(IOT_MEM_TAG_CORE, ctx->pin);
 		ctx->pin = NULL;
 	}
 	if (ctx->es_crypto_cipher_info) {
-		free(ctx->es_crypto_cipher_info);
+		iot_mem_free(IOT_MEM_TAG_CORE, ctx->es_crypto_cipher_info);
 		ctx->es_crypto_cipher_info = NULL;
 	}
 	if (ctx->easysetup_req_queue) {
@@ -162,11 +190,106 @@ static void _delete_easysetup_resources_all(struct iot_context *ctx)
 		ctx->easysetup_resp_queue = NULL;
 	}
 	if (ctx->devconf.hashed_sn) {
-		free(ctx->devconf.hashed_sn);
+		iot_mem_free(IOT_MEM_TAG_CORE, ctx->devconf.hashed_sn);
 		ctx->devconf.hashed_sn = NULL;
 	}
 }
 
+/* Pick the delay for the next CLOUD_CONNECTING command.
+ * Lost connection which was stable enough starts over from minimum delay.
+ */
+static void _do_reconnect_schedule(struct iot_context *ctx, st_conn_reconn_cause_t cause)
+{
+	__atomic_add_fetch(&ctx->conn_stats.reconn_cnt[cause], 1, __ATOMIC_RELAXED);
+
+	if ((ctx->curr_state == IOT_STATE_CLOUD_CONNECTED) &&
+			iot_os_timer_isexpired(ctx->reconn_timer))
+		iot_util_backoff_reset(&ctx->reconn_backoff);
+
+	/* MQTT 5.0 server tells when it wants clients to stay away for a while */
+	if (ctx->evt_mqttcli) {
+		switch (st_mqtt_get_reason_code(ctx->evt_mqttcli)) {
+		case ST_MQTT_RC_SERVER_BUSY:
+		case ST_MQTT_RC_SERVER_SHUTTING_DOWN:
+		case ST_MQTT_RC_QUOTA_EXCEEDED:
+		case ST_MQTT_RC_USE_ANOTHER_SERVER:
+		case ST_MQTT_RC_SERVER_MOVED:
+		case ST_MQTT_RC_CONNECTION_RATE_EXCEEDED:
+			iot_util_backoff_hint(&ctx->reconn_backoff, RECONNECT_SERVER_UNAVAIL_MS);
+			break;
+		default:
+			break;
+		}
+	}
+
+	ctx->reconn_delay_ms = iot_util_backoff_next(&ctx->reconn_backoff);
+	IOT_WARN("Reconnect trial %u after %u ms",
+		ctx->reconn_backoff.attempts, ctx->reconn_delay_ms);
+}
+
+/* Restarting wifi on every failed trial would undo the backoff spreading,
+ * so it is only done after the reconnect delay grew over many trials.
+ */
+static bool _do_reconnect_wifi_reset(struct iot_context *ctx)
+{
+	if (RECONNECT_WIFI_RESET_TRIALS == 0 ||
+			ctx->reconn_backoff.attempts < RECONNECT_WIFI_RESET_TRIALS)
+		return false;
+
+	IOT_WARN("Restart wifi after %u reconnect trials", ctx->reconn_backoff.attempts);
+	return true;
+}
+
+/* Events waiting in pub_queue are dropped when connection is gone */
+static void _iot_pub_queue_drop(struct iot_context *ctx)
+{
+	iot_cap_msg_t *msg;
+	unsigned int dropped = 0;
+
+	while (iot_os_queue_receive(ctx->pub_queue, &msg, 0) != IOT_OS_FALSE) {
+		IOT_TRACE_END(msg->trace_seq, IOT_TRACE_STAGE_MAX);
+		iot_mem_free(IOT_MEM_TAG_CAP, msg->msg);
+		iot_mem_free(IOT_MEM_TAG_CAP, msg);
+		dropped++;
+	}
+
+	if (dropped) {
+		IOT_WARN("%u events are dropped", dropped);
+		__atomic_sub_fetch(&ctx->pub_queue_depth, dropped, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&ctx->conn_stats.evt_drop_cnt, dropped, __ATOMIC_RELAXED);
+	}
+}
+
+#if defined(CONFIG_STDK_IOT_CORE_CONN_STATS_REPORT)
+/* Print the counters when the period is over, returns ms to the next report */
+static unsigned int _iot_conn_stats_report(struct iot_context *ctx)
+{
+	const unsigned int period_ms = CONFIG_STDK_IOT_CORE_CONN_STATS_REPORT_SEC * 1000;
+	st_conn_stats_t stats;
+
+	if (!ctx->stats_timer) {
+		if (iot_os_timer_init(&ctx->stats_timer) != IOT_ERROR_NONE)
+			return iot_os_max_delay;
+		iot_os_timer_count_ms(ctx->stats_timer, period_ms);
+	}
+
+	if (iot_os_timer_isexpired(ctx->stats_timer)) {
+		iot_os_timer_count_ms(ctx->stats_timer, period_ms);
+		st_conn_get_stats((IOT_CTX *)ctx, &stats, false);
+		IOT_INFO("[CONNSTAT] pub:%u fail:%u timeout:%u retry:%u reconn:%u/%u/%u",
+			stats.pub_cnt, stats.pub_fail_cnt, stats.puback_timeout_cnt, stats.pub_retry_cnt,
+			stats.reconn_cnt[ST_CONN_RECONN_PUBLISH_FAIL],
+			stats.reconn_cnt[ST_CONN_RECONN_LINK_LOST],
+			stats.reconn_cnt[ST_CONN_RECONN_CONNECT_TIMEOUT]);
+		IOT_INFO("[CONNSTAT] out:%u in:%u rtt:%u/%u qmax:%u drop:%u",
+			stats.bytes_out, stats.bytes_in, stats.ping_rtt_ms, stats.ping_rtt_max_ms,
+			stats.pub_queue_hwm, stats.evt_drop_cnt);
+	}
+
+	return iot_os_timer_left_ms(ctx->stats_timer);
+}
+#endif
+
 static void _do_update_timeout(struct iot_context *ctx, unsigned int needed_tout)
 {
 	IOT_INFO("Current timeout : %u for %d", needed_tout, ctx->req_state);
@@ -349,6 +472,11 @@ static iot_error_t _do_iot_main_command(struct iot_context *ctx,
 						next_state, state_opt);
 				break;
 			}
+
+			/* no background scan while the radio leaves the provisioning mode */
+			if ((conf->mode == IOT_WIFI_MODE_OFF) || (conf->mode == IOT_WIFI_MODE_STATION))
+				iot_easysetup_scan_stop(ctx);
+
 			err = iot_bsp_wifi_set_mode(conf);
 			if (err < 0) {
 				IOT_ERROR("failed to set wifi_set_mode\n");
@@ -365,14 +493,14 @@ static iot_error_t _do_iot_main_command(struct iot_context *ctx,
 			case IOT_WIFI_MODE_STATION:
 				iot_easysetup_deinit(ctx);
 				if (ctx->scan_result) {
-					free(ctx->scan_result);
+					iot_mem_free(IOT_MEM_TAG_CORE, ctx->scan_result);
 					ctx->scan_result = NULL;
 				}
 				ctx->scan_num = 0;
 				break;
 			case IOT_WIFI_MODE_SCAN:
 				if(!ctx->scan_result) {
-					ctx->scan_result = (iot_wifi_scan_result_t *) malloc(IOT_WIFI_MAX_SCAN_RESULT * sizeof(iot_wifi_scan_result_t));
+					ctx->scan_result = (iot_wifi_scan_result_t *) iot_mem_malloc(IOT_MEM_TAG_CORE, IOT_WIFI_MAX_SCAN_RESULT * sizeof(iot_wifi_scan_result_t));
 					if(!ctx->scan_result){
 						IOT_ERROR("failed to malloc for iot_wifi_scan_result_t\n");
 						break;
@@ -380,7 +508,13 @@ static iot_error_t _do_iot_main_command(struct iot_context *ctx,
 				}
 				memset(ctx->scan_result, 0x0, (IOT_WIFI_MAX_SCAN_RESULT * sizeof(iot_wifi_scan_result_t)));
 
-				ctx->scan_num = iot_bsp_wifi_get_scan_result(ctx->scan_result);
+				/* keeps refreshing the list in background until the app asks for it */
+				if (iot_easysetup_scan_start(ctx) != IOT_ERROR_NONE) {
+					ctx->scan_num = iot_bsp_wifi_get_scan_result(ctx->scan_result);
+					break;
+				}
+				ctx->scan_num = 0;
+				iot_easysetup_scan_get(ctx, false, NULL, NULL, NULL);
 				break;
 			case IOT_WIFI_MODE_SOFTAP:
 				if (ctx->req_state == IOT_STATE_PROV_ENTER) {
@@ -478,7 +612,7 @@ static iot_error_t _do_iot_main_command(struct iot_context *ctx,
 					ctx->iot_reg_data.updated = true;
 					next_state = IOT_STATE_CLOUD_CONNECTING;
 
-					free(usr_id);
+					iot_mem_free(IOT_MEM_TAG_NV, usr_id);
 				}
 			}
 
@@ -540,9 +674,20 @@ static iot_error_t _do_iot_main_command(struct iot_context *ctx,
 			break;
 
 		case IOT_COMMAND_CLOUD_CONNECTING:
+			/* Postpone reconnecting, main task sends this command again
+			 * when reconn_timer is expired
+			 */
+			if (ctx->reconn_delay_ms) {
+				iot_os_timer_count_ms(ctx->reconn_timer, ctx->reconn_delay_ms);
+				ctx->reconn_delay_ms = 0;
+				ctx->reconn_pending = true;
+				break;
+			}
+			ctx->reconn_pending = false;
+
 			/* we don't need this lookup_id anymore */
 			if (ctx->lookup_id) {
-				free(ctx->lookup_id);
+				iot_mem_free(IOT_MEM_TAG_CORE, ctx->lookup_id);
 				ctx->lookup_id = NULL;
 			}
 
@@ -563,10 +708,18 @@ static iot_error_t _do_iot_main_command(struct iot_context *ctx,
 				next_state = IOT_STATE_UNKNOWN;
 			} else if (err != IOT_ERROR_NONE) {
 				IOT_ERROR("failed to iot_es_connect for communication\n");
+				if (err == IOT_ERROR_MQTT_SERVER_UNAVAIL)
+					iot_util_backoff_hint(&ctx->reconn_backoff,
+						RECONNECT_SERVER_UNAVAIL_MS);
 				ctx->cmd_err |= (1 << cmd->cmd_type);
 				next_state = IOT_STATE_CHANGE_FAILED;
 				state_opt = ctx->req_state;
 			} else {
+				/* backoff is reset if this connection lasts long enough */
+				iot_os_timer_count_ms(ctx->reconn_timer, RECONNECT_STABLE_MS);
+				/* flush events kept while reconnecting was delayed */
+				iot_os_eventgroup_set_bits(ctx->iot_events, IOT_EVENT_BIT_CAPABILITY);
+				ctx->steady_mem_checked = false;
 				next_state = IOT_STATE_CLOUD_CONNECTED;
 			}
 
@@ -677,11 +830,16 @@ static void _do_cmd_tout_check(struct iot_context *ctx)
 	}
 }
 
-static iot_error_t _publish_event(struct iot_context *ctx, iot_cap_msg_t *cap_msg)
+/* fail_cnt gets the lost events, the refused ones if server refused some, otherwise all on failure */
+static iot_error_t _publish_event(struct iot_context *ctx, iot_cap_msg_t **cap_msgs, int count,
+		int *fail_cnt)
 {
 	int ret;
 	iot_error_t result = IOT_ERROR_NONE;
-	st_mqtt_msg msg;
+	st_mqtt_msg msgs[IOT_PUB_BATCH_MAX];
+	int i;
+
+	*fail_cnt = count;
 
 	if (ctx == NULL) {
 		IOT_ERROR("ctx is not intialized");
@@ -693,24 +851,40 @@ static iot_error_t _publish_event(struct iot_context *ctx, iot_cap_msg_t *cap_ms
 		return IOT_ERROR_INVALID_ARGS;
 	}
 
-	if (!cap_msg) {
+	if (!cap_msgs || count <= 0 || count > IOT_PUB_BATCH_MAX) {
 		IOT_ERROR("capability msg is NULL");
 		return IOT_ERROR_INVALID_ARGS;
 	}
 
-	msg.qos = st_mqtt_qos1;
-	msg.retained = false;
+	for (i = 0; i < count; i++) {
+		msgs[i].qos = st_mqtt_qos1;
+		msgs[i].retained = false;
 
-	msg.payload = cap_msg->msg;
-	msg.payloadlen = cap_msg->msglen;
-	msg.topic = ctx->mqtt_event_topic;
+		msgs[i].payload = cap_msgs[i]->msg;
+		msgs[i].payloadlen = cap_msgs[i]->msglen;
+		msgs[i].topic = ctx->mqtt_event_topic;
+		msgs[i].trace_seq = cap_msgs[i]->trace_seq;
 
-	IOT_INFO("publish event, topic : %s, payload :\n%s", ctx->mqtt_event_topic, msg.payload);
+		IOT_INFO("publish event, topic : %s, payload :\n%s", ctx->mqtt_event_topic, msgs[i].payload);
+		IOT_TRACE_MARK(msgs[i].trace_seq, IOT_TRACE_EVT_PUBLISH);
+	}
 
-	ret = st_mqtt_publish(ctx->evt_mqttcli, &msg);
-	if (ret) {
+	/* queued events go out together in one network write */
+	ret = st_mqtt_publish_many(ctx->evt_mqttcli, msgs, count);
+	if (ret == E_ST_MQTT_REFUSED) {
+		/* connection is fine, server doesn't take some of the events */
+		IOT_WARN("MQTT pub refused(0x%02x)", st_mqtt_get_reason_code(ctx->evt_mqttcli));
+		result = IOT_ERROR_MQTT_REJECT_PUBLISH;
+		*fail_cnt = 0;
+		for (i = 0; i < count; i++) {
+			if (msgs[i].refused)
+				(*fail_cnt)++;
+		}
+	} else if (ret) {
 		IOT_WARN("MQTT pub error(%d)", ret);
 		result = IOT_ERROR_MQTT_PUBLISH_FAIL;
+	} else {
+		*fail_cnt = 0;
 	}
 
 	return result;
@@ -722,19 +896,50 @@ static void _iot_main_task(struct iot_context *ctx)
 	unsigned int curr_events;
 	iot_error_t err = IOT_ERROR_NONE;
 	iot_cap_msg_t *final_msg;
+	iot_cap_msg_t *pub_msgs[IOT_PUB_BATCH_MAX];
+	int pub_cnt, fail_cnt, i;
 	struct iot_easysetup_payload *easysetup_req;
 	iot_state_t next_state;
+	unsigned int wait_ms;
+#if defined(CONFIG_STDK_IOT_CORE_CONN_STATS_REPORT)
+	unsigned int stats_ms;
+#endif
 
 	thread_sleep_for(1000);
 //	IOT_ERROR("START _iot_main_task");
 	for( ; ; ) {
+		/* wake up for delayed reconnecting */
+		if (ctx->reconn_pending)
+			wait_ms = iot_os_timer_left_ms(ctx->reconn_timer);
+		else
+			wait_ms = iot_os_max_delay;
+
+#if defined(CONFIG_STDK_IOT_CORE_CONN_STATS_REPORT)
+		/* wake up for the report too */
+		stats_ms = _iot_conn_stats_report(ctx);
+		if (stats_ms < wait_ms)
+			wait_ms = stats_ms;
+#endif
+
 #if defined(STDK_MQTT_TASK)
 		curr_events = iot_os_eventgroup_wait_bits(ctx->iot_events,
-			IOT_EVENT_BIT_ALL, true, false, iot_os_max_delay);
+			IOT_EVENT_BIT_ALL, true, false, wait_ms);
 #else
 		curr_events = iot_os_eventgroup_wait_bits(ctx->iot_events,
-			IOT_EVENT_BIT_ALL, true, false, iot_os_max_delay);
+			IOT_EVENT_BIT_ALL, true, false, wait_ms);
 #endif
+		if (ctx->reconn_pending && iot_os_timer_isexpired(ctx->reconn_timer)) {
+			ctx->reconn_pending = false;
+			if ((ctx->req_state == IOT_STATE_CLOUD_CONNECTING) ||
+					(ctx->req_state == IOT_STATE_CHANGE_FAILED)) {
+				IOT_WARN("Try delayed MQTT reconnecting..");
+				err = iot_command_send(ctx, IOT_COMMAND_CLOUD_CONNECTING, NULL, 0);
+				if (err != IOT_ERROR_NONE)
+					IOT_ERROR("Can't send reconnecting command(%d)", err);
+			} else {
+				IOT_INFO("Drop delayed reconnecting for state %d", ctx->req_state);
+			}
+		}
 //		IOT_ERROR("curr_events :  0x%08x", curr_events);
 		if (curr_events & IOT_EVENT_BIT_COMMAND) {
 //			cmd.param = NULL;
@@ -744,12 +949,13 @@ static void _iot_main_task(struct iot_context *ctx)
 				IOT_DEBUG("cmd: %d\n", cmd->cmd_type);
 
 				err = _do_iot_main_command(ctx, cmd);
-				if (cmd->param)
-					free(cmd->param);
-
 				if (err != IOT_ERROR_NONE)
 					IOT_ERROR("failed handle cmd (%d): %d\n", cmd->cmd_type, err);
 
+				if (cmd->param)
+					iot_mem_free(IOT_MEM_TAG_CORE, cmd->param);
+				iot_mem_free(IOT_MEM_TAG_CORE, cmd);
+
 				/* Set bit again to check whether the several cmds are already
 				 * stacked up in the queue.
 				 */
@@ -757,30 +963,59 @@ static void _iot_main_task(struct iot_context *ctx)
 			}
 		}
 
-		if (curr_events & IOT_EVENT_BIT_CAPABILITY) {
+		/* Keep events in pub_queue until delayed reconnecting is done */
+		if ((curr_events & IOT_EVENT_BIT_CAPABILITY) && !ctx->reconn_pending) {
 			if (iot_os_queue_receive(ctx->pub_queue,
 					&final_msg, 0) != IOT_OS_FALSE) {
 
+				__atomic_sub_fetch(&ctx->pub_queue_depth, 1, __ATOMIC_RELAXED);
+				IOT_TRACE_MARK(final_msg->trace_seq, IOT_TRACE_EVT_WAKEUP);
 				if (ctx->curr_state < IOT_STATE_CLOUD_CONNECTING) {
 					IOT_WARN("MQTT already disconnected. reset all pub_queue");
-					iot_os_queue_reset(ctx->pub_queue);
+					IOT_TRACE_END(final_msg->trace_seq, IOT_TRACE_STAGE_MAX);
+					iot_mem_free(IOT_MEM_TAG_CAP, final_msg->msg);
+					iot_mem_free(IOT_MEM_TAG_CAP, final_msg);
+					__atomic_add_fetch(&ctx->conn_stats.evt_drop_cnt, 1, __ATOMIC_RELAXED);
+					_iot_pub_queue_drop(ctx);
 				} else {
-					err = _publish_event(ctx, final_msg);
-					free(final_msg->msg);
+					/* take the events stacked up meanwhile too */
+					pub_msgs[0] = final_msg;
+					pub_cnt = 1;
+					while ((pub_cnt < IOT_PUB_BATCH_MAX) && (iot_os_queue_receive(ctx->pub_queue,
+							&pub_msgs[pub_cnt], 0) != IOT_OS_FALSE)) {
+						__atomic_sub_fetch(&ctx->pub_queue_depth, 1, __ATOMIC_RELAXED);
+						IOT_TRACE_MARK(pub_msgs[pub_cnt]->trace_seq, IOT_TRACE_EVT_WAKEUP);
+						pub_cnt++;
+					}
+
+					err = _publish_event(ctx, pub_msgs, pub_cnt, &fail_cnt);
+					__atomic_add_fetch(&ctx->conn_stats.pub_cnt, pub_cnt - fail_cnt, __ATOMIC_RELAXED);
+					__atomic_add_fetch(&ctx->conn_stats.pub_fail_cnt, fail_cnt, __ATOMIC_RELAXED);
+					for (i = 0; i < pub_cnt; i++) {
+						/* acked ones are finished already */
+						IOT_TRACE_END(pub_msgs[i]->trace_seq, IOT_TRACE_STAGE_MAX);
+						iot_mem_free(IOT_MEM_TAG_CAP, pub_msgs[i]->msg);
+						iot_mem_free(IOT_MEM_TAG_CAP, pub_msgs[i]);
+					}
 
 					if (err != IOT_ERROR_NONE) {
 						IOT_ERROR("failed publish event_data : %d", err);
 						if (err == IOT_ERROR_MQTT_PUBLISH_FAIL) {
+							_do_reconnect_schedule(ctx, ST_CONN_RECONN_PUBLISH_FAIL);
 							iot_es_disconnect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
 							IOT_WARN("Report Disconnected..");
 							next_state = IOT_STATE_CLOUD_DISCONNECTED;
 							err = iot_state_update(ctx, next_state, 0);
 
 							IOT_WARN("Try MQTT reconnecting..");
-							iot_os_queue_reset(ctx->pub_queue);
+							_iot_pub_queue_drop(ctx);
 							next_state = IOT_STATE_CLOUD_CONNECTING;
 							err = iot_state_update(ctx, next_state, 0);
 						}
+					} else if (!ctx->steady_mem_checked) {
+						/* first events delivered, connection is in steady state */
+						ctx->steady_mem_checked = true;
+						IOT_MEM_CHECK("CLOUD_CONNECTED STEADY >>PT<<");
 					}
 
 					/* Set bit again to check whether the several cmds are already
@@ -800,6 +1035,7 @@ static void _iot_main_task(struct iot_context *ctx)
 				err = iot_easysetup_request_handler(ctx, *easysetup_req);
 				if (err != IOT_ERROR_NONE)
 					IOT_ERROR("failed handle easysetup request step %d: %d\n", easysetup_req->step, err);
+				iot_mem_free(IOT_MEM_TAG_EASYSETUP, easysetup_req);
 
 				/* Set bit again to check whether the several cmds are already
 				 * stacked up in the queue.
@@ -819,9 +1055,10 @@ static void _iot_main_task(struct iot_context *ctx)
 			IOT_WARN("Try MQTT self re-registering..\n");
 			next_state = IOT_STATE_CLOUD_REGISTERING;
 			err = iot_state_update(ctx, next_state, 0);
-			iot_os_queue_reset(ctx->pub_queue);
+			_iot_pub_queue_drop(ctx);
 
 		} else if (ctx->evt_mqttcli && st_mqtt_yield(ctx->evt_mqttcli, 0) < 0) {
+			_do_reconnect_schedule(ctx, ST_CONN_RECONN_LINK_LOST);
 			iot_es_disconnect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
 			IOT_WARN("Report Disconnected..");
 			next_state = IOT_STATE_CLOUD_DISCONNECTED;
@@ -830,7 +1067,7 @@ static void _iot_main_task(struct iot_context *ctx)
 			IOT_WARN("Try MQTT self re-connecting..\n");
 			next_state = IOT_STATE_CLOUD_CONNECTING;
 			err = iot_state_update(ctx, next_state, 0);
-			iot_os_queue_reset(ctx->pub_queue);
+			_iot_pub_queue_drop(ctx);
 		}
 #endif
 		_do_cmd_tout_check(ctx);
@@ -850,7 +1087,7 @@ IOT_CTX* st_conn_init(unsigned char *onboarding_config, unsigned int onboarding_
 		return NULL;
 	}
 
-	ctx = iot_os_malloc(sizeof(struct iot_context));
+	ctx = iot_mem_malloc(IOT_MEM_TAG_CORE, sizeof(struct iot_context));
 	if (!ctx) {
 		IOT_ERROR("failed to malloc for iot_context\n");
 		return NULL;
@@ -862,9 +1099,19 @@ IOT_CTX* st_conn_init(unsigned char *onboarding_config, unsigned int onboarding_
 	iot_err = iot_os_timer_init(&ctx->state_timer);
 	if (iot_err != IOT_ERROR_NONE) {
 		IOT_ERROR("failed to malloc for state_timer\n");
-		free(ctx);
+		iot_mem_free(IOT_MEM_TAG_CORE, ctx);
 		return NULL;
 	}
+
+	iot_err = iot_os_timer_init(&ctx->reconn_timer);
+	if (iot_err != IOT_ERROR_NONE) {
+		IOT_ERROR("failed to malloc for reconn_timer\n");
+		iot_os_timer_destroy(&ctx->state_timer);
+		iot_mem_free(IOT_MEM_TAG_CORE, ctx);
+		return NULL;
+	}
+	iot_util_backoff_init(&ctx->reconn_backoff,
+		RECONNECT_BACKOFF_BASE_MS, RECONNECT_BACKOFF_CAP_MS);
 	IOT_ERROR("Init Device\n");
 	// Initialize device nv section
 	iot_err = iot_nv_init(device_info, device_info_len);
@@ -894,7 +1141,7 @@ IOT_CTX* st_conn_init(unsigned char *onboarding_config, unsigned int onboarding_
 	/* create queue */
 	IOT_ERROR("Create Command Queue\n");
 	ctx->cmd_queue = iot_os_queue_create(IOT_QUEUE_LENGTH,
-			sizeof(struct iot_command));
+			sizeof(struct iot_command *));
 
 	if (!ctx->cmd_queue) {
 		IOT_ERROR("failed to create Queue for iot core task\n");
@@ -911,7 +1158,7 @@ IOT_CTX* st_conn_init(unsigned char *onboarding_config, unsigned int onboarding_
 	IOT_ERROR("Create Publish Queue\n");
 	/* create msg queue for publish */
 	ctx->pub_queue = iot_os_queue_create(IOT_PUB_QUEUE_LENGTH,
-		sizeof(iot_cap_msg_t));
+		sizeof(iot_cap_msg_t *));
 
 	if (!ctx->pub_queue) {
 		IOT_ERROR("failed to create Queue for publish data\n");
@@ -927,6 +1174,9 @@ IOT_CTX* st_conn_init(unsigned char *onboarding_config, unsigned int onboarding_
 	}
 
 	ctx->iot_reg_data.new_reged = false;
+#if defined(CONFIG_STDK_IOT_CORE_MQTT_PERSISTENT_SESSION)
+	ctx->mqtt_warm.persistent_session = true;
+#endif
 	ctx->curr_state = ctx->req_state = IOT_STATE_UNKNOWN;
 
 	IOT_ERROR("OS Thread Create\n");
@@ -972,8 +1222,9 @@ error_main_load_onboarding_config:
 	iot_nv_deinit();
 
 error_main_bsp_init:
+	iot_os_timer_destroy(&ctx->reconn_timer);
 	iot_os_timer_destroy(&ctx->state_timer);
-	free(ctx);
+	iot_mem_free(IOT_MEM_TAG_CORE, ctx);
 
 	return NULL;
 }
@@ -1001,6 +1252,10 @@ static iot_error_t _do_recovery(struct iot_context *ctx,
 		case IOT_STATE_CLOUD_REGISTERING:
 			/* fall through */
 		case IOT_STATE_CLOUD_CONNECTING:
+			if ((fail_state == IOT_STATE_CLOUD_CONNECTING) &&
+					!_do_reconnect_wifi_reset(ctx))
+				break;
+
 			/* wifi off */
 			iot_err = iot_wifi_ctrl_request(ctx, IOT_WIFI_MODE_OFF);
 			if (iot_err != IOT_ERROR_NONE) {
@@ -1037,7 +1292,7 @@ static iot_error_t _do_recovery(struct iot_context *ctx,
 		case IOT_STATE_PROV_CONFIRMING:
 			IOT_ERROR("Failed process [%d] on time", fail_state);
 			if (ctx->scan_result) {
-				free(ctx->scan_result);
+				iot_mem_free(IOT_MEM_TAG_CORE, ctx->scan_result);
 				ctx->scan_result = NULL;
 			}
 			ctx->scan_num = 0;
@@ -1059,23 +1314,26 @@ static iot_error_t _do_recovery(struct iot_context *ctx,
 
 		case IOT_STATE_CLOUD_CONNECTING:
 			IOT_ERROR("Failed to go to CLOUD_CONNECTED on time");
-			/* wifi off */
-			iot_err = iot_wifi_ctrl_request(ctx, IOT_WIFI_MODE_OFF);
-			if (iot_err != IOT_ERROR_NONE) {
-				IOT_ERROR("Can't send WIFI off command(%d)",
-					iot_err);
-				break;
-			}
+			if (_do_reconnect_wifi_reset(ctx)) {
+				/* wifi off */
+				iot_err = iot_wifi_ctrl_request(ctx, IOT_WIFI_MODE_OFF);
+				if (iot_err != IOT_ERROR_NONE) {
+					IOT_ERROR("Can't send WIFI off command(%d)",
+						iot_err);
+					break;
+				}
 
-			/* wifi on againg for station */
-			iot_err = iot_wifi_ctrl_request(ctx, IOT_WIFI_MODE_STATION);
-			if (iot_err != IOT_ERROR_NONE) {
-				IOT_ERROR("Can't send WIFI station command(%d)",
-					iot_err);
-				break;
+				/* wifi on againg for station */
+				iot_err = iot_wifi_ctrl_request(ctx, IOT_WIFI_MODE_STATION);
+				if (iot_err != IOT_ERROR_NONE) {
+					IOT_ERROR("Can't send WIFI station command(%d)",
+						iot_err);
+					break;
+				}
 			}
 
 			/* retry CLOUD_CONNECTING */
+			_do_reconnect_schedule(ctx, ST_CONN_RECONN_CONNECT_TIMEOUT);
 			iot_err = iot_command_send(ctx,
 						IOT_COMMAND_CLOUD_CONNECTING,
 						NULL, 0);
@@ -1097,7 +1355,7 @@ static iot_error_t _do_recovery(struct iot_context *ctx,
 			IOT_ERROR("Failed to do process [%d] on time, retry",
 				fail_state);
 			if (ctx->scan_result) {
-				free(ctx->scan_result);
+				iot_mem_free(IOT_MEM_TAG_CORE, ctx->scan_result);
 				ctx->scan_result = NULL;
 			}
 			ctx->scan_num = 0;
@@ -1137,6 +1395,8 @@ static iot_error_t _do_recovery(struct iot_context *ctx,
 					iot_err);
 
 			IOT_WARN("Self retry/recovery it again\n");
+			if (fail_state == IOT_STATE_CLOUD_CONNECTING)
+				_do_reconnect_schedule(ctx, ST_CONN_RECONN_CONNECT_TIMEOUT);
 			iot_err = iot_state_update(ctx, fail_state, 0);
 			break;
 
@@ -1221,6 +1481,9 @@ static iot_error_t _do_state_updating(struct iot_context *ctx,
 		if (ctx->es_res_created)
 			_delete_easysetup_resources_all(ctx);
 
+		/* Give enough time to connect after delayed reconnecting */
+		*timeout_ms += ctx->reconn_delay_ms;
+
 		iot_cmd = IOT_COMMAND_CLOUD_CONNECTING;
 		iot_err = iot_command_send(ctx, iot_cmd, NULL, 0);
 		break;
@@ -1320,6 +1583,46 @@ int st_conn_start(IOT_CTX *iot_ctx, st_status_cb status_cb,
 	return IOT_ERROR_NONE;
 }
 
+static unsigned int _iot_stats_take(unsigned int *counter, bool reset)
+{
+	if (reset)
+		return __atomic_exchange_n(counter, 0, __ATOMIC_RELAXED);
+
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+int st_conn_get_stats(IOT_CTX *iot_ctx, st_conn_stats_t *stats, bool reset)
+{
+	struct iot_context *ctx = (struct iot_context*)iot_ctx;
+	int i;
+
+	if (!ctx || !stats) {
+		IOT_ERROR("There is no ctx or stats");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	stats->pub_cnt = _iot_stats_take(&ctx->conn_stats.pub_cnt, reset);
+	stats->pub_fail_cnt = _iot_stats_take(&ctx->conn_stats.pub_fail_cnt, reset);
+	for (i = 0; i < ST_CONN_RECONN_CAUSE_MAX; i++)
+		stats->reconn_cnt[i] = _iot_stats_take(&ctx->conn_stats.reconn_cnt[i], reset);
+	stats->pub_queue_hwm = _iot_stats_take(&ctx->conn_stats.pub_queue_hwm, reset);
+	stats->evt_drop_cnt = _iot_stats_take(&ctx->conn_stats.evt_drop_cnt, reset);
+
+	stats->puback_timeout_cnt = _iot_stats_take(&ctx->mqtt_stats.puback_timeout_cnt, reset);
+	stats->pub_retry_cnt = _iot_stats_take(&ctx->mqtt_stats.publish_retry_cnt, reset);
+	stats->bytes_out = _iot_stats_take(&ctx->mqtt_stats.bytes_out, reset);
+	stats->bytes_in = _iot_stats_take(&ctx->mqtt_stats.bytes_in, reset);
+	stats->ping_rtt_ms = _iot_stats_take(&ctx->mqtt_stats.ping_rtt_ms, reset);
+	stats->ping_rtt_max_ms = _iot_stats_take(&ctx->mqtt_stats.ping_rtt_max_ms, reset);
+
+	/* high-water mark starts over from events waiting now */
+	if (reset)
+		iot_util_atomic_max(&ctx->conn_stats.pub_queue_hwm,
+			__atomic_load_n(&ctx->pub_queue_depth, __ATOMIC_RELAXED));
+
+	return IOT_ERROR_NONE;
+}
+
 int st_conn_cleanup(IOT_CTX *iot_ctx, bool reboot)
 {
 	iot_error_t iot_err;
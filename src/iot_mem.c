@@ -0,0 +1,273 @@
+/* ***************************************************************************
+ *
+ * Copyright 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "iot_mem.h"
+#include "iot_os_util.h"
+#include "iot_util.h"
+
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL_BLOCKS)
+#define IOT_MEM_POOL_BLOCKS	CONFIG_STDK_IOT_CORE_MEM_POOL_BLOCKS
+#else
+#define IOT_MEM_POOL_BLOCKS	8
+#endif
+
+/*
+ * Size classes for the hot fixed sizes : attribute and command names,
+ * event data, published messages and command structs.
+ * Blocks are long long arrays to keep the alignment malloc gives.
+ */
+static long long _iot_mem_pool_32[IOT_MEM_POOL_BLOCKS][32 / sizeof(long long)];
+static long long _iot_mem_pool_64[IOT_MEM_POOL_BLOCKS][64 / sizeof(long long)];
+static long long _iot_mem_pool_128[IOT_MEM_POOL_BLOCKS][128 / sizeof(long long)];
+
+struct iot_mem_pool {
+	unsigned char *base;
+	size_t block_size;
+	unsigned char free_list[IOT_MEM_POOL_BLOCKS];
+	unsigned int free_cnt;
+};
+
+static struct iot_mem_pool _iot_mem_pools[] = {
+	{ (unsigned char *)_iot_mem_pool_32, sizeof(_iot_mem_pool_32[0]) },
+	{ (unsigned char *)_iot_mem_pool_64, sizeof(_iot_mem_pool_64[0]) },
+	{ (unsigned char *)_iot_mem_pool_128, sizeof(_iot_mem_pool_128[0]) },
+};
+
+#define IOT_MEM_POOL_NUM	(sizeof(_iot_mem_pools) / sizeof(_iot_mem_pools[0]))
+#endif
+
+static const iot_mem_allocator_t _iot_mem_default_allocator = {
+	.alloc = iot_os_malloc,
+	.dealloc = iot_os_free,
+};
+
+static const iot_mem_allocator_t *_iot_mem_allocator = &_iot_mem_default_allocator;
+static iot_mem_stats_t _iot_mem_stats[IOT_MEM_TAG_MAX];
+static iot_util_once_mutex_t _iot_mem_mutex;
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+static bool _iot_mem_pool_ready;
+#endif
+
+static iot_error_t _iot_mem_lock(void)
+{
+	if (iot_util_once_mutex_lock(&_iot_mem_mutex) != IOT_ERROR_NONE)
+		return IOT_ERROR_MEM_ALLOC;
+
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+	if (!_iot_mem_pool_ready) {
+		unsigned int i, j;
+
+		for (i = 0; i < IOT_MEM_POOL_NUM; i++) {
+			for (j = 0; j < IOT_MEM_POOL_BLOCKS; j++)
+				_iot_mem_pools[i].free_list[j] = IOT_MEM_POOL_BLOCKS - 1 - j;
+			_iot_mem_pools[i].free_cnt = IOT_MEM_POOL_BLOCKS;
+		}
+		_iot_mem_pool_ready = true;
+	}
+#endif
+	return IOT_ERROR_NONE;
+}
+
+static void _iot_mem_unlock(void)
+{
+	iot_util_once_mutex_unlock(&_iot_mem_mutex);
+}
+
+static iot_mem_stats_t *_iot_mem_tag_stats(iot_mem_tag_t tag)
+{
+	if ((unsigned int)tag >= IOT_MEM_TAG_MAX)
+		tag = IOT_MEM_TAG_CORE;
+
+	return &_iot_mem_stats[tag];
+}
+
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+/* Must be called with the lock held */
+static void *_iot_mem_pool_alloc(size_t size)
+{
+	struct iot_mem_pool *pool;
+	unsigned int i;
+
+	for (i = 0; i < IOT_MEM_POOL_NUM; i++) {
+		pool = &_iot_mem_pools[i];
+		if (size <= pool->block_size && pool->free_cnt > 0) {
+			pool->free_cnt--;
+			return pool->base + pool->free_list[pool->free_cnt] * pool->block_size;
+		}
+	}
+
+	return NULL;
+}
+
+static struct iot_mem_pool *_iot_mem_pool_find(void *ptr)
+{
+	unsigned char *p = (unsigned char *)ptr;
+	struct iot_mem_pool *pool;
+	unsigned int i;
+
+	for (i = 0; i < IOT_MEM_POOL_NUM; i++) {
+		pool = &_iot_mem_pools[i];
+		if (p >= pool->base && p < pool->base + pool->block_size * IOT_MEM_POOL_BLOCKS)
+			return pool;
+	}
+
+	return NULL;
+}
+#endif
+
+void iot_mem_set_allocator(const iot_mem_allocator_t *allocator)
+{
+	if (allocator && allocator->alloc && allocator->dealloc)
+		_iot_mem_allocator = allocator;
+	else
+		_iot_mem_allocator = &_iot_mem_default_allocator;
+}
+
+void *iot_mem_malloc(iot_mem_tag_t tag, size_t size)
+{
+	iot_mem_stats_t *stats = _iot_mem_tag_stats(tag);
+	void *ptr = NULL;
+
+	if (_iot_mem_lock() != IOT_ERROR_NONE)
+		return NULL;
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+	if (size > 0) {
+		ptr = _iot_mem_pool_alloc(size);
+		if (ptr)
+			stats->pool_cnt++;
+	}
+#endif
+	_iot_mem_unlock();
+
+	if (!ptr)
+		ptr = _iot_mem_allocator->alloc(size);
+
+	if (_iot_mem_lock() != IOT_ERROR_NONE)
+		return ptr;
+	if (ptr) {
+		stats->alloc_cnt++;
+		stats->alloc_bytes += size;
+		if (++stats->live > stats->peak)
+			stats->peak = stats->live;
+	} else {
+		stats->fail_cnt++;
+	}
+	_iot_mem_unlock();
+
+	return ptr;
+}
+
+void *iot_mem_calloc(iot_mem_tag_t tag, size_t nmemb, size_t size)
+{
+	void *ptr;
+
+	if (size && nmemb > (size_t)-1 / size)
+		return NULL;
+
+	ptr = iot_mem_malloc(tag, nmemb * size);
+	if (ptr)
+		memset(ptr, 0, nmemb * size);
+
+	return ptr;
+}
+
+void *iot_mem_realloc(iot_mem_tag_t tag, void *ptr, size_t old_size, size_t size)
+{
+	void *new_ptr;
+
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+	struct iot_mem_pool *pool = ptr ? _iot_mem_pool_find(ptr) : NULL;
+
+	if (pool && size > 0 && size <= pool->block_size)
+		return ptr;
+#endif
+	new_ptr = iot_mem_malloc(tag, size);
+	if (!new_ptr)
+		return NULL;
+
+	if (ptr) {
+		memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+		iot_mem_free(tag, ptr);
+	}
+
+	return new_ptr;
+}
+
+char *iot_mem_strdup(iot_mem_tag_t tag, const char *src)
+{
+	size_t size;
+	char *dest;
+
+	if (!src)
+		return NULL;
+
+	size = strlen(src) + 1;
+	dest = iot_mem_malloc(tag, size);
+	if (dest)
+		memcpy(dest, src, size);
+
+	return dest;
+}
+
+void iot_mem_free(iot_mem_tag_t tag, void *ptr)
+{
+	iot_mem_stats_t *stats = _iot_mem_tag_stats(tag);
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+	struct iot_mem_pool *pool;
+#endif
+
+	if (!ptr)
+		return;
+
+	/* Without the mutex nothing came from the pools yet */
+	if (_iot_mem_lock() != IOT_ERROR_NONE) {
+		_iot_mem_allocator->dealloc(ptr);
+		return;
+	}
+	if (stats->live > 0)
+		stats->live--;
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+	pool = _iot_mem_pool_find(ptr);
+	if (pool) {
+		pool->free_list[pool->free_cnt++] =
+			((unsigned char *)ptr - pool->base) / pool->block_size;
+		_iot_mem_unlock();
+		return;
+	}
+#endif
+	_iot_mem_unlock();
+
+	_iot_mem_allocator->dealloc(ptr);
+}
+
+iot_error_t iot_mem_get_stats(iot_mem_tag_t tag, iot_mem_stats_t *stats)
+{
+	if ((unsigned int)tag >= IOT_MEM_TAG_MAX || !stats)
+		return IOT_ERROR_INVALID_ARGS;
+
+	if (_iot_mem_lock() != IOT_ERROR_NONE)
+		return IOT_ERROR_MEM_ALLOC;
+	memcpy(stats, &_iot_mem_stats[tag], sizeof(iot_mem_stats_t));
+	_iot_mem_unlock();
+
+	return IOT_ERROR_NONE;
+}
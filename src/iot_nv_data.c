@@ -24,6 +24,7 @@
 #include "iot_bsp_nv_data.h"
 #include "iot_debug.h"
 #include "iot_util.h"
+#include "iot_mem.h"
 #include "certs/root_ca.h"
 #if !defined(CONFIG_STDK_IOT_CORE_SUPPORT_STNV_PARTITION)
 #include "iot_internal.h"
@@ -217,7 +218,7 @@ iot_error_t iot_nv_get_wifi_prov_data(struct iot_wifi_prov_data* wifi_prov)
 	unsigned int size;
 	char* data = NULL;
 
-	data = malloc(sizeof(char) * DATA_SIZE);
+	data = iot_mem_malloc(IOT_MEM_TAG_NV, sizeof(char) * DATA_SIZE);
 	IOT_WARN_CHECK(data == NULL, IOT_ERROR_NV_DATA_ERROR, "memory alloc fail");
 
 	/* CHECK IOT_NVD_WIFI_PROV_STATUS */
@@ -299,7 +300,7 @@ iot_error_t iot_nv_get_wifi_prov_data(struct iot_wifi_prov_data* wifi_prov)
 	}
 
 exit:
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 	return ret;
 }
@@ -322,7 +323,7 @@ iot_error_t iot_nv_set_wifi_prov_data(struct iot_wifi_prov_data* wifi_prov)
 	int state;
 	char* data = NULL;
 
-	data = malloc(sizeof(char) * DATA_SIZE);
+	data = iot_mem_malloc(IOT_MEM_TAG_NV, sizeof(char) * DATA_SIZE);
 	IOT_WARN_CHECK(data == NULL, IOT_ERROR_NV_DATA_ERROR, "memory alloc fail");
 
 	/* IOT_NVD_WIFI_PROV_STATUS - NONE */
@@ -420,7 +421,7 @@ iot_error_t iot_nv_set_wifi_prov_data(struct iot_wifi_prov_data* wifi_prov)
 	}
 
 exit:
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 	return ret;
 }
@@ -444,7 +445,7 @@ iot_error_t iot_nv_get_cloud_prov_data(struct iot_cloud_prov_data* cloud_prov)
 	char* data = NULL;
 	char* new_buff = NULL;
 
-	data = malloc(sizeof(char) * DATA_SIZE);
+	data = iot_mem_malloc(IOT_MEM_TAG_NV, sizeof(char) * DATA_SIZE);
 	IOT_WARN_CHECK(data == NULL, IOT_ERROR_NV_DATA_ERROR, "memory alloc fail");
 
 	/* CHECK IOT_NVD_CLOUD_PROV_STATUS */
@@ -465,7 +466,7 @@ iot_error_t iot_nv_get_cloud_prov_data(struct iot_cloud_prov_data* cloud_prov)
 	ret = _iot_nv_read_data(iot_bsp_nv_get_data_path(IOT_NVD_SERVER_URL), data, DATA_SIZE);
 	if (ret == IOT_ERROR_NONE) {
 		size = strlen(data);
-		new_buff = (char *)malloc(size + 1);
+		new_buff = (char *)iot_mem_malloc(IOT_MEM_TAG_CORE, size + 1);
 		if (new_buff == NULL) {
 			IOT_WARN("failed to malloc for new_buff");
 			ret = IOT_ERROR_NV_DATA_ERROR;
@@ -544,7 +545,7 @@ iot_error_t iot_nv_get_cloud_prov_data(struct iot_cloud_prov_data* cloud_prov)
 	ret = _iot_nv_read_data(iot_bsp_nv_get_data_path(IOT_NVD_LABEL), data, DATA_SIZE);
 	if (ret == IOT_ERROR_NONE) {
 		size = strlen(data);
-		new_buff = (char *)malloc(size + 1);
+		new_buff = (char *)iot_mem_malloc(IOT_MEM_TAG_CORE, size + 1);
 		if (new_buff == NULL) {
 			IOT_WARN("failed to malloc for new_buff");
 			ret = IOT_ERROR_NV_DATA_ERROR;
@@ -565,7 +566,7 @@ iot_error_t iot_nv_get_cloud_prov_data(struct iot_cloud_prov_data* cloud_prov)
 	}
 
 exit:
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 	return ret;
 }
@@ -590,7 +591,7 @@ iot_error_t iot_nv_set_cloud_prov_data(struct iot_cloud_prov_data* cloud_prov)
 	char* data = NULL;
 	char valid_id;
 
-	data = malloc(sizeof(char) * DATA_SIZE);
+	data = iot_mem_malloc(IOT_MEM_TAG_NV, sizeof(char) * DATA_SIZE);
 	IOT_WARN_CHECK(data == NULL, IOT_ERROR_NV_DATA_ERROR, "memory alloc fail");
 
 	/* IOT_NVD_CLOUD_PROV_STATUS - NONE */
@@ -715,7 +716,7 @@ iot_error_t iot_nv_set_cloud_prov_data(struct iot_cloud_prov_data* cloud_prov)
 	}
 
 exit:
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 	return ret;
 }
@@ -742,7 +743,7 @@ iot_error_t iot_nv_get_private_key(char** key, size_t* len)
 	}
 
 	size = strlen(data);
-	new_buff = (char*)malloc(size + 1);
+	new_buff = (char*)iot_mem_malloc(IOT_MEM_TAG_NV, size + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		ret = IOT_ERROR_NV_DATA_ERROR;
@@ -755,7 +756,7 @@ iot_error_t iot_nv_get_private_key(char** key, size_t* len)
 	*key = new_buff;
 	*len = size;
 
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 exit:
 	return ret;
@@ -766,7 +767,7 @@ exit:
 	char* data = NULL;
 	char* new_buff = NULL;
 
-	data = malloc(sizeof(char) * DATA_SIZE);
+	data = iot_mem_malloc(IOT_MEM_TAG_NV, sizeof(char) * DATA_SIZE);
 	IOT_WARN_CHECK(data == NULL, IOT_ERROR_NV_DATA_ERROR, "failed to malloc for data");
 
 	ret = _iot_nv_read_data_from_stnv(iot_bsp_nv_get_data_path(IOT_NVD_PRIVATE_KEY), data, DATA_SIZE);
@@ -777,7 +778,7 @@ exit:
 	}
 
 	size = strlen(data);
-	new_buff = (char*)malloc(size + 1);
+	new_buff = (char*)iot_mem_malloc(IOT_MEM_TAG_NV, size + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		ret = IOT_ERROR_NV_DATA_ERROR;
@@ -791,7 +792,7 @@ exit:
 	*len = size;
 
 exit:
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 	return ret;
 #endif
@@ -819,7 +820,7 @@ iot_error_t iot_nv_get_public_key(char** key, size_t* len)
 	}
 
 	size = strlen(data);
-	new_buff = (char*)malloc(size + 1);
+	new_buff = (char*)iot_mem_malloc(IOT_MEM_TAG_NV, size + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		ret = IOT_ERROR_NV_DATA_ERROR;
@@ -832,7 +833,7 @@ iot_error_t iot_nv_get_public_key(char** key, size_t* len)
 	*key = new_buff;
 	*len = size;
 
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 exit:
 	return ret;
@@ -843,7 +844,7 @@ exit:
 	char* data = NULL;
 	char* new_buff = NULL;
 
-	data = malloc(sizeof(char) * DATA_SIZE);
+	data = iot_mem_malloc(IOT_MEM_TAG_NV, sizeof(char) * DATA_SIZE);
 	IOT_WARN_CHECK(data == NULL, IOT_ERROR_NV_DATA_ERROR, "memory alloc fail");
 
 	ret = _iot_nv_read_data_from_stnv(iot_bsp_nv_get_data_path(IOT_NVD_PUBLIC_KEY), data, DATA_SIZE);
@@ -854,7 +855,7 @@ exit:
 	}
 
 	size = strlen(data);
-	new_buff = (char *)malloc(size + 1);
+	new_buff = (char *)iot_mem_malloc(IOT_MEM_TAG_NV, size + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		ret = IOT_ERROR_NV_DATA_ERROR;
@@ -868,7 +869,7 @@ exit:
 	*len = size;
 
 exit:
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 	return ret;
 #endif
@@ -881,7 +882,7 @@ iot_error_t iot_nv_get_root_certificate(char** cert, size_t* len)
 
 	char* new_buff = NULL;
 
-	new_buff = (char*)iot_os_malloc(st_root_ca_len + 1);
+	new_buff = (char*)iot_mem_malloc(IOT_MEM_TAG_NV, st_root_ca_len + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		return IOT_ERROR_NV_DATA_ERROR;
@@ -919,7 +920,7 @@ iot_error_t iot_nv_get_client_certificate(char** cert, size_t* len)
 	}
 
 	size = strlen(data);
-	new_buff = (char*)malloc(size + 1);
+	new_buff = (char*)iot_mem_malloc(IOT_MEM_TAG_NV, size + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		ret = IOT_ERROR_NV_DATA_ERROR;
@@ -932,7 +933,7 @@ iot_error_t iot_nv_get_client_certificate(char** cert, size_t* len)
 	*cert = new_buff;
 	*len = size;
 
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 exit:
 	return ret;
@@ -943,7 +944,7 @@ exit:
 	char* data = NULL;
 	char* new_buff = NULL;
 
-	data = malloc(sizeof(char) * DATA_SIZE);
+	data = iot_mem_malloc(IOT_MEM_TAG_NV, sizeof(char) * DATA_SIZE);
 	IOT_WARN_CHECK(data == NULL, IOT_ERROR_NV_DATA_ERROR, "memory alloc fail");
 
 	ret = _iot_nv_read_data_from_stnv(iot_bsp_nv_get_data_path(IOT_NVD_SUB_CERT), data, DATA_SIZE);
@@ -954,7 +955,7 @@ exit:
 	}
 
 	size = strlen(data);
-	new_buff = (char*)malloc(size + 1);
+	new_buff = (char*)iot_mem_malloc(IOT_MEM_TAG_NV, size + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		ret = IOT_ERROR_NV_DATA_ERROR;
@@ -968,7 +969,7 @@ exit:
 	*len = size;
 
 exit:
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 	return ret;
 #endif
@@ -988,7 +989,7 @@ iot_error_t iot_nv_get_device_id(char** device_id, size_t* len)
 	char* data = NULL;
 	char* new_buff = NULL;
 
-	data = malloc(sizeof(char) * DATA_SIZE);
+	data = iot_mem_malloc(IOT_MEM_TAG_NV, sizeof(char) * DATA_SIZE);
 	IOT_WARN_CHECK(data == NULL, IOT_ERROR_NV_DATA_ERROR, "memory alloc fail");
 
 	ret = _iot_nv_read_data(iot_bsp_nv_get_data_path(IOT_NVD_DEVICE_ID), data, DATA_SIZE);
@@ -999,7 +1000,7 @@ iot_error_t iot_nv_get_device_id(char** device_id, size_t* len)
 	}
 
 	size = strlen(data);
-	new_buff = (char*)malloc(size + 1);
+	new_buff = (char*)iot_mem_malloc(IOT_MEM_TAG_NV, size + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		ret = IOT_ERROR_NV_DATA_ERROR;
@@ -1013,7 +1014,7 @@ iot_error_t iot_nv_get_device_id(char** device_id, size_t* len)
 	*len = size;
 
 exit:
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 	return ret;
 }
@@ -1056,7 +1057,7 @@ iot_error_t iot_nv_get_serial_number(char** sn, size_t* len)
 	}
 
 	size = strlen(data);
-	new_buff = (char*)malloc(size + 1);
+	new_buff = (char*)iot_mem_malloc(IOT_MEM_TAG_NV, size + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		ret = IOT_ERROR_NV_DATA_ERROR;
@@ -1069,7 +1070,7 @@ iot_error_t iot_nv_get_serial_number(char** sn, size_t* len)
 	*sn = new_buff;
 	*len = size;
 
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 exit:
 	return ret;
@@ -1080,7 +1081,7 @@ exit:
 	char* data = NULL;
 	char* new_buff = NULL;
 
-	data = malloc(sizeof(char) * DATA_SIZE);
+	data = iot_mem_malloc(IOT_MEM_TAG_NV, sizeof(char) * DATA_SIZE);
 	IOT_WARN_CHECK(data == NULL, IOT_ERROR_NV_DATA_ERROR, "memory alloc fail");
 
 	ret = _iot_nv_read_data_from_stnv(iot_bsp_nv_get_data_path(IOT_NVD_SERIAL_NUM), data, DATA_SIZE);
@@ -1091,7 +1092,7 @@ exit:
 	}
 
 	size = strlen(data);
-	new_buff = (char*)malloc(size + 1);
+	new_buff = (char*)iot_mem_malloc(IOT_MEM_TAG_NV, size + 1);
 	if (new_buff == NULL) {
 		IOT_WARN("failed to malloc for new_buff");
 		ret = IOT_ERROR_NV_DATA_ERROR;
@@ -1105,7 +1106,7 @@ exit:
 	*len = size;
 
 exit:
-	free(data);
+	iot_mem_free(IOT_MEM_TAG_NV, data);
 
 	return ret;
 #endif
@@ -21,177 +21,289 @@
 #include <string.h>
 #include <math.h>
 
-#include <cJSON.h>
 #include <cbor.h>
 
 #include "iot_debug.h"
 #include "iot_error.h"
 #include "iot_internal.h"
+#include "iot_util.h"
+#include "iot_mem.h"
 
 #include <inttypes.h>
 #include "compilersupport_p.h"
+#include "cborinternal_p.h"
 
-static CborError _iot_cbor_value_to_json(CborValue *it, char *out, size_t *olen);
+#define IOT_CBOR2JSON_MAX_DEPTH		16
 
-static CborError _iot_cbor_array_to_json(CborValue *it, char *out, size_t *olen)
+/*
+ * Output sink of transcoder. When buf is NULL, it only counts bytes,
+ * so same transcoding pass gives exact json size before writing.
+ */
+struct _iot_json_sink {
+	char *buf;
+	size_t pos;
+};
+
+static void _iot_sink_put(struct _iot_json_sink *sink, const char *str, size_t len)
+{
+	if (sink->buf)
+		memcpy(sink->buf + sink->pos, str, len);
+	sink->pos += len;
+}
+
+static void _iot_sink_putc(struct _iot_json_sink *sink, char c)
+{
+	if (sink->buf)
+		sink->buf[sink->pos] = c;
+	sink->pos++;
+}
+
+static void _iot_sink_put_escaped(struct _iot_json_sink *sink, const char *str, size_t len)
+{
+	if (sink->buf)
+		sink->pos = iot_util_json_escape(sink->buf + sink->pos, str, len) - sink->buf;
+	else
+		sink->pos += iot_util_json_escaped_len(str, len);
+}
+
+static CborError _iot_cbor_value_to_json(CborValue *it, struct _iot_json_sink *sink, int depth);
+
+static CborError _iot_cbor_string_to_json(CborValue *it, struct _iot_json_sink *sink)
 {
 	CborError err;
-	const char *comma = "";
-	size_t n = 0;
-	int c = 0;
+	CborValue next = *it;
+	const void *chunk;
+	size_t chunk_len;
+
+	_iot_sink_putc(sink, '"');
+
+	/* Copy string chunks straight from cbor buffer, no duplication */
+	while (1) {
+		err = _cbor_value_get_string_chunk(&next, &chunk, &chunk_len, &next);
+		if (err)
+			return err;
+		if (!chunk)
+			break;
+
+		_iot_sink_put_escaped(sink, (const char *)chunk, chunk_len);
+	}
+
+	_iot_sink_putc(sink, '"');
+
+	*it = next;
+
+	return CborNoError;
+}
+
+/* JSON has no binary, so byte strings go out as a string of lowercase hex */
+static CborError _iot_cbor_bytes_to_json(CborValue *it, struct _iot_json_sink *sink)
+{
+	static const char hex[] = "0123456789abcdef";
+	CborError err;
+	CborValue next = *it;
+	const void *chunk;
+	const uint8_t *bytes;
+	size_t chunk_len;
+	size_t i;
+
+	_iot_sink_putc(sink, '"');
+
+	while (1) {
+		err = _cbor_value_get_string_chunk(&next, &chunk, &chunk_len, &next);
+		if (err)
+			return err;
+		if (!chunk)
+			break;
+
+		bytes = (const uint8_t *)chunk;
+		for (i = 0; i < chunk_len; i++) {
+			_iot_sink_putc(sink, hex[bytes[i] >> 4]);
+			_iot_sink_putc(sink, hex[bytes[i] & 0x0f]);
+		}
+	}
+
+	_iot_sink_putc(sink, '"');
+
+	*it = next;
+
+	return CborNoError;
+}
+
+static CborError _iot_cbor_array_to_json(CborValue *it, struct _iot_json_sink *sink, int depth)
+{
+	CborError err;
+	bool first = true;
 
 	while (!cbor_value_at_end(it)) {
-		c += sprintf(out + c, "%s", comma);
-		comma = ",";
+		if (!first)
+			_iot_sink_putc(sink, ',');
+		first = false;
 
-		err = _iot_cbor_value_to_json(it, out + c, &n);
+		err = _iot_cbor_value_to_json(it, sink, depth);
 		if (err) {
 			return err;
 		}
-
-		c += (int)n;
 	}
 
-	*olen = (size_t)c;
-
 	return CborNoError;
 }
 
-static CborError _iot_cbor_map_to_json(CborValue *it, char *out, size_t *olen)
+static CborError _iot_cbor_map_to_json(CborValue *it, struct _iot_json_sink *sink, int depth)
 {
 	CborError err;
-	CborType key_type;
-	const char *comma = "";
-	char *key;
-	size_t n = 0;
-	int c = 0;
+	bool first = true;
 
 	while (!cbor_value_at_end(it)) {
-		c += sprintf(out + c, "%s", comma);
-		comma = ",";
+		if (!first)
+			_iot_sink_putc(sink, ',');
+		first = false;
 
-		key_type = cbor_value_get_type(it);
-		if (key_type != CborTextStringType) {
+		/* key */
+		if (cbor_value_get_type(it) != CborTextStringType) {
 			return CborErrorJsonObjectKeyNotString;
 		}
 
-		/* key */
-		err = cbor_value_dup_text_string(it, &key, &n, it);
+		err = _iot_cbor_string_to_json(it, sink);
 		if (err) {
 			return err;
 		}
 
-		c += sprintf(out + c, "\"%s\":", key);
-		free(key);
+		_iot_sink_putc(sink, ':');
 
 		/* value */
-		err = _iot_cbor_value_to_json(it, out + c, &n);
-		c += (int)n;
-
+		err = _iot_cbor_value_to_json(it, sink, depth);
 		if (err) {
 			return err;
 		}
 	}
 
-	*olen = (size_t)c;
+	return CborNoError;
+}
+
+static void _iot_cbor_uint_to_json(uint64_t val, bool negative, struct _iot_json_sink *sink)
+{
+	char num_str[22];
+
+	if (negative) {
+		/* cbor negative integer is -1 - val */
+		_iot_sink_putc(sink, '-');
+		if (val == UINT64_MAX) {
+			_iot_sink_put(sink, "18446744073709551616", 20);
+			return;
+		}
+		val++;
+	}
+
+	iot_util_convert_u64_str(val, num_str, sizeof(num_str));
+	_iot_sink_put(sink, num_str, strlen(num_str));
+}
+
+static CborError _iot_cbor_double_to_json(double val, struct _iot_json_sink *sink)
+{
+	char num_str[32];
+	int len;
+
+	if (fpclassify(val) == FP_NAN || fpclassify(val) == FP_INFINITE) {
+		return CborErrorIO;
+	}
+
+	if (fabs(val) < 18446744073709551616.0 && floor(val) == val) {
+		/* print as integer so we get the full precision */
+		if (val < 0)
+			_iot_sink_putc(sink, '-');
+		_iot_cbor_uint_to_json((uint64_t)fabs(val), false, sink);
+		return CborNoError;
+	}
+
+	/* this number is definitely not a 64-bit integer */
+	len = snprintf(num_str, sizeof(num_str), "%." DBL_DECIMAL_DIG_STR "g", val);
+	_iot_sink_put(sink, num_str, (size_t)len);
 
 	return CborNoError;
 }
 
-static CborError _iot_cbor_value_to_json(CborValue *it, char *out, size_t *olen)
+static CborError _iot_cbor_value_to_json(CborValue *it, struct _iot_json_sink *sink, int depth)
 {
 	CborError err;
 	CborType type;
 	CborValue recursed;
-	char *str;
-	int c = 0;
-	size_t n = 0;
-	uint64_t val_i64;
+	uint64_t val_u64;
+	uint16_t val_half;
+	float val_flt;
 	double val_dbl;
+	bool val_bool;
 
 	type = cbor_value_get_type(it);
 
 	switch (type) {
 	case CborArrayType:
 	case CborMapType:
+		if (depth >= IOT_CBOR2JSON_MAX_DEPTH) {
+			return CborErrorNestingTooDeep;
+		}
+
 		err = cbor_value_enter_container(it, &recursed);
 		if (err) {
 			it->ptr = recursed.ptr;
 			return err;
 		}
 
-		c += sprintf(out + c, "%c", type == CborArrayType ? '[' : '{');
+		_iot_sink_putc(sink, type == CborArrayType ? '[' : '{');
 
 		if (type == CborArrayType)
-			err = _iot_cbor_array_to_json(&recursed, out + c, &n);
+			err = _iot_cbor_array_to_json(&recursed, sink, depth + 1);
 		else
-			err = _iot_cbor_map_to_json(&recursed, out + c, &n);
+			err = _iot_cbor_map_to_json(&recursed, sink, depth + 1);
 
 		if (err) {
 			it->ptr = recursed.ptr;
 			return err;
 		}
 
-		c += (int)n;
-
-		c += sprintf(out + c, "%c", type == CborArrayType ? ']' : '}');
-
-		err = cbor_value_leave_container(it, &recursed);
-		if (err) {
-			return err;
-		}
-
-		*olen = (size_t)c;
+		_iot_sink_putc(sink, type == CborArrayType ? ']' : '}');
 
-		return CborNoError;
+		return cbor_value_leave_container(it, &recursed);
 	case CborByteStringType:
+		return _iot_cbor_bytes_to_json(it, sink);
 	case CborTextStringType:
-		err = cbor_value_dup_text_string(it, &str, &n, it);
-		if (err) {
-			return err;
-		}
-
-		c += sprintf(out + c, "\"%s\"", str);
-		free(str);
-
-		*olen = (size_t)c;
-
-		return CborNoError;
+		return _iot_cbor_string_to_json(it, sink);
 	case CborIntegerType:
-		cbor_value_get_raw_integer(it, &val_i64);
-		val_dbl = (double)val_i64;
-
-		if (cbor_value_is_negative_integer(it)) {
-			/* convert to negative */
-			val_dbl = -val_dbl - 1;
-		}
-
-		c += sprintf(out + c, "%.0f", val_dbl);
-
+		cbor_value_get_raw_integer(it, &val_u64);
+		_iot_cbor_uint_to_json(val_u64, cbor_value_is_negative_integer(it), sink);
+		break;
+	case CborBooleanType:
+		cbor_value_get_boolean(it, &val_bool);
+		if (val_bool)
+			_iot_sink_put(sink, "true", 4);
+		else
+			_iot_sink_put(sink, "false", 5);
+		break;
+	case CborNullType:
+	case CborUndefinedType:
+		_iot_sink_put(sink, "null", 4);
+		break;
+	case CborHalfFloatType:
+		cbor_value_get_half_float(it, &val_half);
+		err = _iot_cbor_double_to_json(decode_half(val_half), sink);
+		if (err)
+			return err;
+		break;
+	case CborFloatType:
+		cbor_value_get_float(it, &val_flt);
+		err = _iot_cbor_double_to_json(val_flt, sink);
+		if (err)
+			return err;
 		break;
 	case CborDoubleType:
 		cbor_value_get_double(it, &val_dbl);
-
-		if (fpclassify(val_dbl) < 0) {
-			return CborErrorIO;
-		}
-
-		val_i64 = (uint64_t)fabs(val_dbl);
-		if ((double)val_i64 == fabs(val_dbl)) {
-			/* print as integer so we get the full precision */
-			c += sprintf(out + c, "%s%" PRIu64, val_dbl < 0 ? "-" : "", val_i64);
-		} else {
-			/* this number is definitely not a 64-bit integer */
-			c += sprintf(out + c, "%." DBL_DECIMAL_DIG_STR "g", val_dbl);
-		}
-
+		err = _iot_cbor_double_to_json(val_dbl, sink);
+		if (err)
+			return err;
 		break;
 	default:
 		return CborErrorUnknownType;
 	}
 
-	*olen = (size_t)c;
-
 	return cbor_value_advance_fixed(it);
 }
 
@@ -200,10 +312,7 @@ iot_error_t iot_serialize_cbor2json(uint8_t *cbor, size_t cborlen, char **json,
 	CborParser parser;
 	CborValue it;
 	CborError err;
-	char *buf;
-	char *tmp;
-	size_t len;
-	size_t olen = 0;
+	struct _iot_json_sink sink = {0};
 
 	if ((cbor == NULL) || (cborlen == 0) ||
 	    (json == NULL) || (jsonlen == NULL)) {
@@ -213,46 +322,130 @@ iot_error_t iot_serialize_cbor2json(uint8_t *cbor, size_t cborlen, char **json,
 
 	IOT_DEBUG("cbor 0x%x@%p", (int)cborlen, cbor);
 
+	/* 1st pass : calculate exact json size */
 	err = cbor_parser_init(cbor, cborlen, 0, &parser, &it);
 	if (err) {
 		IOT_ERROR("cbor_parser_init = %d", err);
 		return IOT_ERROR_CBOR_PARSE;
 	}
 
-	len = cborlen * 4 / 3;
-	buf = (char *)malloc(len);
-	if (!buf) {
+	err = _iot_cbor_value_to_json(&it, &sink, 0);
+	if (err) {
+		IOT_ERROR("_iot_cbor_value_to_json = %d", err);
+		return IOT_ERROR_CBOR_TO_JSON;
+	}
+
+	sink.buf = (char *)iot_mem_malloc(IOT_MEM_TAG_CORE, sink.pos + 1);
+	if (!sink.buf) {
 		IOT_ERROR("malloc failed for json");
 		return IOT_ERROR_MEM_ALLOC;
 	}
 
-	memset(buf, 0, len);
-
-	err = _iot_cbor_value_to_json(&it, buf, &olen);
+	/* 2nd pass : write json into exactly sized buffer */
+	sink.pos = 0;
+	cbor_parser_init(cbor, cborlen, 0, &parser, &it);
+	err = _iot_cbor_value_to_json(&it, &sink, 0);
 	if (err) {
-		IOT_ERROR("_iot_cbor_value_to_json_advance = %d", err);
-		free(buf);
+		IOT_ERROR("_iot_cbor_value_to_json = %d", err);
+		iot_mem_free(IOT_MEM_TAG_CORE, sink.buf);
 		return IOT_ERROR_CBOR_TO_JSON;
 	}
+	sink.buf[sink.pos] = '\0';
 
-	if (olen < len) {
-		tmp = (char *)realloc(buf, olen + 1);
-		if (!tmp) {
-			IOT_WARN("realloc failed for json, use origin");
-		} else {
-			buf = tmp;
-		}
-	} else {
-		IOT_ERROR("allocated size is not enough (%d < %d)",
-				(int)len, (int)olen);
-		free(buf);
-		return IOT_ERROR_MEM_ALLOC;
-	}
-
-	*json = buf;
-	*jsonlen = olen;
+	*json = sink.buf;
+	*jsonlen = sink.pos;
 
 	IOT_DEBUG("json 0x%x@%p", (int)*jsonlen, *json);
 
 	return IOT_ERROR_NONE;
 }
+
+static iot_error_t _iot_serialize_cbor_find(const uint8_t *cbor, size_t cborlen,
+		const char *key, CborParser *parser, CborValue *value)
+{
+	CborValue it;
+
+	if (cbor_parser_init(cbor, cborlen, 0, parser, &it) != CborNoError)
+		return IOT_ERROR_CBOR_PARSE;
+
+	if (!cbor_value_is_map(&it))
+		return IOT_ERROR_CBOR_PARSE;
+
+	if (cbor_value_map_find_value(&it, key, value) != CborNoError)
+		return IOT_ERROR_CBOR_PARSE;
+
+	if (cbor_value_get_type(value) == CborInvalidType)
+		return IOT_ERROR_BAD_REQ;
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_serialize_cbor_get_string(const uint8_t *cbor, size_t cborlen,
+		const char *key, char *buf, size_t buf_len)
+{
+	CborParser parser;
+	CborValue value;
+	iot_error_t err;
+
+	if (!cbor || !cborlen || !key || !buf || !buf_len)
+		return IOT_ERROR_INVALID_ARGS;
+
+	err = _iot_serialize_cbor_find(cbor, cborlen, key, &parser, &value);
+	if (err)
+		return err;
+
+	if (!cbor_value_is_text_string(&value))
+		return IOT_ERROR_BAD_REQ;
+
+	/* tinycbor appends null terminator when buf has a room for it */
+	buf_len--;
+	if (cbor_value_copy_text_string(&value, buf, &buf_len, NULL) != CborNoError)
+		return IOT_ERROR_BAD_REQ;
+	buf[buf_len] = '\0';
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_serialize_cbor_get_int(const uint8_t *cbor, size_t cborlen,
+		const char *key, int64_t *val)
+{
+	CborParser parser;
+	CborValue value;
+	iot_error_t err;
+	double dval;
+	float fval;
+
+	if (!cbor || !cborlen || !key || !val)
+		return IOT_ERROR_INVALID_ARGS;
+
+	err = _iot_serialize_cbor_find(cbor, cborlen, key, &parser, &value);
+	if (err)
+		return err;
+
+	switch (cbor_value_get_type(&value)) {
+	case CborIntegerType:
+		if (cbor_value_get_int64_checked(&value, val) != CborNoError)
+			return IOT_ERROR_BAD_REQ;
+		return IOT_ERROR_NONE;
+	case CborFloatType:
+		cbor_value_get_float(&value, &fval);
+		dval = fval;
+		break;
+	case CborDoubleType:
+		cbor_value_get_double(&value, &dval);
+		break;
+	default:
+		return IOT_ERROR_BAD_REQ;
+	}
+
+	if (isnan(dval))
+		return IOT_ERROR_BAD_REQ;
+	if (dval >= 9223372036854775807.0)
+		*val = INT64_MAX;
+	else if (dval <= -9223372036854775808.0)
+		*val = INT64_MIN;
+	else
+		*val = (int64_t)dval;
+
+	return IOT_ERROR_NONE;
+}
@@ -0,0 +1,251 @@
+/* ***************************************************************************
+ *
+ * Copyright 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "iot_trace.h"
+#include "iot_os_util.h"
+#include "iot_debug.h"
+#include "iot_util.h"
+
+/* Traces in flight, events waiting in pub_queue plus one inbound command */
+#define IOT_TRACE_INFLIGHT	16
+/* Bucket n keeps latencies from 2^n us to 2^(n+1) - 1 us */
+#define IOT_TRACE_BUCKETS	32
+
+#if defined(CONFIG_STDK_IOT_CORE_LATENCY_TRACE_DUMP_SEC)
+#define IOT_TRACE_DUMP_SEC	CONFIG_STDK_IOT_CORE_LATENCY_TRACE_DUMP_SEC
+#else
+#define IOT_TRACE_DUMP_SEC	0
+#endif
+
+struct iot_trace_rec {
+	unsigned int seq;
+	uint64_t start_us;
+	uint64_t last_us;
+};
+
+struct iot_trace_hist {
+	unsigned int count;
+	unsigned int max_us;
+	uint64_t sum_us;
+	unsigned int bucket[IOT_TRACE_BUCKETS];
+};
+
+static const char *_iot_trace_stage_name[IOT_TRACE_STAGE_MAX] = {
+	"EVT_ENCODE", "EVT_ENQUEUE", "EVT_WAKEUP", "EVT_PUBLISH",
+	"EVT_SERIALIZE", "EVT_WRITE", "EVT_PUBACK", "EVT_TOTAL",
+	"CMD_READ", "CMD_DISPATCH", "CMD_CALLBACK", "CMD_TOTAL",
+};
+
+static struct iot_trace_rec _iot_trace_recs[IOT_TRACE_INFLIGHT];
+static struct iot_trace_hist _iot_trace_hists[IOT_TRACE_STAGE_MAX];
+static unsigned int _iot_trace_seq;
+static uint64_t _iot_trace_dump_us;
+static iot_util_once_mutex_t _iot_trace_mutex;
+
+/* Wall clock can jump by SNTP, so use monotonic clock where it exists */
+static uint64_t _iot_trace_now_us(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* Must be called with the lock held */
+static struct iot_trace_rec *_iot_trace_find(unsigned int seq)
+{
+	struct iot_trace_rec *rec;
+
+	if (seq == 0)
+		return NULL;
+
+	rec = &_iot_trace_recs[seq % IOT_TRACE_INFLIGHT];
+	if (rec->seq != seq)
+		return NULL;
+
+	return rec;
+}
+
+/* Must be called with the lock held */
+static void _iot_trace_add(iot_trace_stage_t stage, uint64_t from_us, uint64_t to_us)
+{
+	struct iot_trace_hist *hist = &_iot_trace_hists[stage];
+	uint64_t diff = (to_us > from_us) ? to_us - from_us : 0;
+	unsigned int us = (diff > UINT32_MAX) ? UINT32_MAX : (unsigned int)diff;
+	unsigned int idx = 0;
+
+	while ((us >> (idx + 1)) && (idx < IOT_TRACE_BUCKETS - 1))
+		idx++;
+
+	hist->bucket[idx]++;
+	hist->count++;
+	hist->sum_us += us;
+	if (us > hist->max_us)
+		hist->max_us = us;
+}
+
+static unsigned int _iot_trace_percentile(const struct iot_trace_hist *hist, unsigned int percent)
+{
+	unsigned int target = (unsigned int)(((uint64_t)hist->count * percent + 99) / 100);
+	unsigned int sum = 0;
+	unsigned int idx;
+	unsigned int upper;
+
+	for (idx = 0; idx < IOT_TRACE_BUCKETS; idx++) {
+		sum += hist->bucket[idx];
+		if (sum >= target)
+			break;
+	}
+
+	if (idx >= IOT_TRACE_BUCKETS - 1)
+		return hist->max_us;
+
+	upper = (2U << idx) - 1;
+	return (upper < hist->max_us) ? upper : hist->max_us;
+}
+
+unsigned int iot_trace_begin(void)
+{
+	struct iot_trace_rec *rec;
+	unsigned int seq;
+
+	if (iot_util_once_mutex_lock(&_iot_trace_mutex) != IOT_ERROR_NONE)
+		return 0;
+
+	if (++_iot_trace_seq == 0)
+		_iot_trace_seq = 1;
+	seq = _iot_trace_seq;
+
+	rec = &_iot_trace_recs[seq % IOT_TRACE_INFLIGHT];
+	rec->seq = seq;
+	rec->start_us = _iot_trace_now_us();
+	rec->last_us = rec->start_us;
+	iot_util_once_mutex_unlock(&_iot_trace_mutex);
+
+	return seq;
+}
+
+void iot_trace_mark(unsigned int seq, iot_trace_stage_t stage)
+{
+	struct iot_trace_rec *rec;
+	uint64_t now_us;
+
+	if ((unsigned int)stage >= IOT_TRACE_STAGE_MAX)
+		return;
+
+	now_us = _iot_trace_now_us();
+	if (iot_util_once_mutex_lock(&_iot_trace_mutex) != IOT_ERROR_NONE)
+		return;
+
+	rec = _iot_trace_find(seq);
+	if (rec) {
+		_iot_trace_add(stage, rec->last_us, now_us);
+		rec->last_us = now_us;
+	}
+	iot_util_once_mutex_unlock(&_iot_trace_mutex);
+}
+
+void iot_trace_end(unsigned int seq, iot_trace_stage_t total)
+{
+	struct iot_trace_rec *rec;
+	uint64_t now_us = _iot_trace_now_us();
+	bool dump = false;
+
+	if (iot_util_once_mutex_lock(&_iot_trace_mutex) != IOT_ERROR_NONE)
+		return;
+
+	rec = _iot_trace_find(seq);
+	if (rec) {
+		if ((unsigned int)total < IOT_TRACE_STAGE_MAX) {
+			_iot_trace_add(total, rec->start_us, now_us);
+#if IOT_TRACE_DUMP_SEC > 0
+			if (now_us - _iot_trace_dump_us >= (uint64_t)IOT_TRACE_DUMP_SEC * 1000000) {
+				_iot_trace_dump_us = now_us;
+				dump = true;
+			}
+#endif
+		}
+		rec->seq = 0;
+	}
+	iot_util_once_mutex_unlock(&_iot_trace_mutex);
+
+	if (dump)
+		iot_trace_dump();
+}
+
+iot_error_t iot_trace_get_stats(iot_trace_stage_t stage, iot_trace_stats_t *stats)
+{
+	struct iot_trace_hist *hist;
+
+	if ((unsigned int)stage >= IOT_TRACE_STAGE_MAX || !stats)
+		return IOT_ERROR_INVALID_ARGS;
+
+	memset(stats, 0, sizeof(iot_trace_stats_t));
+
+	if (iot_util_once_mutex_lock(&_iot_trace_mutex) != IOT_ERROR_NONE)
+		return IOT_ERROR_MEM_ALLOC;
+
+	hist = &_iot_trace_hists[stage];
+	if (hist->count > 0) {
+		stats->count = hist->count;
+		stats->avg_us = (unsigned int)(hist->sum_us / hist->count);
+		stats->p50_us = _iot_trace_percentile(hist, 50);
+		stats->p90_us = _iot_trace_percentile(hist, 90);
+		stats->p99_us = _iot_trace_percentile(hist, 99);
+		stats->max_us = hist->max_us;
+	}
+	iot_util_once_mutex_unlock(&_iot_trace_mutex);
+
+	return IOT_ERROR_NONE;
+}
+
+void iot_trace_reset(void)
+{
+	if (iot_util_once_mutex_lock(&_iot_trace_mutex) != IOT_ERROR_NONE)
+		return;
+
+	memset(_iot_trace_hists, 0, sizeof(_iot_trace_hists));
+	iot_util_once_mutex_unlock(&_iot_trace_mutex);
+}
+
+void iot_trace_dump(void)
+{
+	iot_trace_stats_t stats;
+	int stage;
+
+	for (stage = 0; stage < IOT_TRACE_STAGE_MAX; stage++) {
+		if (iot_trace_get_stats(stage, &stats) != IOT_ERROR_NONE || stats.count == 0)
+			continue;
+
+		IOT_INFO("[TRACE] %s n:%u avg:%u p50:%u p90:%u p99:%u max:%u (us)",
+			_iot_trace_stage_name[stage], stats.count, stats.avg_us,
+			stats.p50_us, stats.p90_us, stats.p99_us, stats.max_us);
+	}
+}
@@ -17,12 +17,14 @@
  ****************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "iot_main.h"
 #include "iot_util.h"
 #include "iot_debug.h"
 #include "iot_bsp_random.h"
+#include "iot_mem.h"
 
 static int _isalpha(char c)
 {
@@ -330,6 +332,452 @@ uint16_t iot_util_convert_channel_freq(uint8_t channel)
 	return 0;
 }
 
+static const char _digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+iot_error_t iot_util_convert_u64_str(uint64_t val, char* str, int max_sz)
+{
+	char tmp[20];	/* 18446744073709551615 */
+	int pos = sizeof(tmp);
+	int idx;
+
+	if (!str || max_sz <= 0) {
+		IOT_ERROR("Invalid arguments");
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	while (val >= 100) {
+		idx = (int)(val % 100) * 2;
+		val /= 100;
+		tmp[--pos] = _digit_pairs[idx + 1];
+		tmp[--pos] = _digit_pairs[idx];
+	}
+
+	if (val >= 10) {
+		idx = (int)val * 2;
+		tmp[--pos] = _digit_pairs[idx + 1];
+		tmp[--pos] = _digit_pairs[idx];
+	} else {
+		tmp[--pos] = (char)('0' + val);
+	}
+
+	if ((int)sizeof(tmp) - pos >= max_sz) {
+		IOT_ERROR("Not enough buffer for %d digits", (int)sizeof(tmp) - pos);
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	memcpy(str, &tmp[pos], sizeof(tmp) - pos);
+	str[sizeof(tmp) - pos] = '\0';
+
+	return IOT_ERROR_NONE;
+}
+
+size_t iot_util_json_escaped_len(const char *str, size_t len)
+{
+	size_t escaped_len = len;
+	unsigned char c;
+
+	while (len--) {
+		c = (unsigned char)*str++;
+		switch (c) {
+		case '"':
+		case '\\':
+		case '\b':
+		case '\f':
+		case '\n':
+		case '\r':
+		case '\t':
+			escaped_len += 1;
+			break;
+		default:
+			if (c < 32)
+				escaped_len += 5;	/* \u00XX */
+			break;
+		}
+	}
+
+	return escaped_len;
+}
+
+char *iot_util_json_escape(char *dst, const char *str, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	unsigned char c;
+
+	while (len--) {
+		c = (unsigned char)*str++;
+		if (c >= 32 && c != '"' && c != '\\') {
+			*dst++ = (char)c;
+			continue;
+		}
+
+		*dst++ = '\\';
+		switch (c) {
+		case '"':
+		case '\\':
+			*dst++ = (char)c;
+			break;
+		case '\b':
+			*dst++ = 'b';
+			break;
+		case '\f':
+			*dst++ = 'f';
+			break;
+		case '\n':
+			*dst++ = 'n';
+			break;
+		case '\r':
+			*dst++ = 'r';
+			break;
+		case '\t':
+			*dst++ = 't';
+			break;
+		default:
+			*dst++ = 'u';
+			*dst++ = '0';
+			*dst++ = '0';
+			*dst++ = hex[c >> 4];
+			*dst++ = hex[c & 0x0f];
+			break;
+		}
+	}
+
+	return dst;
+}
+
+#define IOT_UTIL_JSON_MAX_DEPTH	16
+
+static int _iot_util_hex_val(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+static const char *_iot_util_json_skip_ws(const char *p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		p++;
+
+	return p;
+}
+
+static bool _iot_util_json_match(const char *p, const char *end, const char *word)
+{
+	size_t len = strlen(word);
+
+	return ((size_t)(end - p) >= len && !memcmp(p, word, len));
+}
+
+static const char *_iot_util_json_skip_digits(const char *p, const char *end)
+{
+	while (p < end && *p >= '0' && *p <= '9')
+		p++;
+
+	return p;
+}
+
+/* Returns the end of one JSON value starting at p, or NULL if it is malformed */
+static const char *_iot_util_json_skip_value(const char *p, const char *end, int depth)
+{
+	const char *digits;
+	char close;
+
+	p = _iot_util_json_skip_ws(p, end);
+	if (p >= end)
+		return NULL;
+
+	switch (*p) {
+	case '"':
+		for (p++; p < end && *p != '"'; p++) {
+			if ((unsigned char)*p < 32)
+				return NULL;
+			if (*p != '\\')
+				continue;
+			if (++p >= end)
+				return NULL;
+			if (*p == 'u') {
+				if (end - p < 5 || _iot_util_hex_val(p[1]) < 0 || _iot_util_hex_val(p[2]) < 0
+						|| _iot_util_hex_val(p[3]) < 0 || _iot_util_hex_val(p[4]) < 0)
+					return NULL;
+				p += 4;
+			} else if (!memchr("\"\\/bfnrt", *p, 8)) {
+				return NULL;
+			}
+		}
+		return (p < end) ? p + 1 : NULL;
+	case '{':
+	case '[':
+		if (depth >= IOT_UTIL_JSON_MAX_DEPTH)
+			return NULL;
+
+		close = (*p++ == '{') ? '}' : ']';
+		p = _iot_util_json_skip_ws(p, end);
+		if (p < end && *p == close)
+			return p + 1;
+
+		while (1) {
+			if (close == '}') {
+				p = _iot_util_json_skip_ws(p, end);
+				if (p >= end || *p != '"')
+					return NULL;
+				p = _iot_util_json_skip_value(p, end, depth + 1);
+				if (!p)
+					return NULL;
+				p = _iot_util_json_skip_ws(p, end);
+				if (p >= end || *p++ != ':')
+					return NULL;
+			}
+			p = _iot_util_json_skip_value(p, end, depth + 1);
+			if (!p)
+				return NULL;
+			p = _iot_util_json_skip_ws(p, end);
+			if (p >= end)
+				return NULL;
+			if (*p == close)
+				return p + 1;
+			if (*p++ != ',')
+				return NULL;
+		}
+	case 't':
+		return _iot_util_json_match(p, end, "true") ? p + 4 : NULL;
+	case 'f':
+		return _iot_util_json_match(p, end, "false") ? p + 5 : NULL;
+	case 'n':
+		return _iot_util_json_match(p, end, "null") ? p + 4 : NULL;
+	default:
+		/* -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? as RFC 8259 */
+		if (*p == '-')
+			p++;
+		if (p >= end || *p < '0' || *p > '9')
+			return NULL;
+		if (*p == '0')
+			p++;
+		else
+			p = _iot_util_json_skip_digits(p, end);
+
+		if (p < end && *p == '.') {
+			digits = ++p;
+			p = _iot_util_json_skip_digits(p, end);
+			if (p == digits)
+				return NULL;
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			if (++p < end && (*p == '+' || *p == '-'))
+				p++;
+			digits = p;
+			p = _iot_util_json_skip_digits(p, end);
+			if (p == digits)
+				return NULL;
+		}
+		return p;
+	}
+}
+
+bool iot_util_json_is_valid(const char *json, size_t len)
+{
+	const char *end;
+
+	if (!json)
+		return false;
+
+	end = _iot_util_json_skip_value(json, json + len, 0);
+
+	return (end && _iot_util_json_skip_ws(end, json + len) == json + len);
+}
+
+/* Returns the value of key in the top level object, or NULL if it is not found */
+static const char *_iot_util_json_find(const char *json, size_t len, const char *key)
+{
+	const char *end = json + len;
+	const char *p;
+	const char *name;
+	size_t key_len = strlen(key);
+
+	p = _iot_util_json_skip_ws(json, end);
+	if (p >= end || *p++ != '{')
+		return NULL;
+
+	p = _iot_util_json_skip_ws(p, end);
+	if (p < end && *p == '}')
+		return NULL;
+
+	while (1) {
+		p = _iot_util_json_skip_ws(p, end);
+		if (p >= end || *p != '"')
+			return NULL;
+		name = p + 1;
+		p = _iot_util_json_skip_value(p, end, 1);
+		if (!p)
+			return NULL;
+
+		/* p points next to the closing quotation mark */
+		if ((size_t)(p - 1 - name) == key_len && !memcmp(name, key, key_len)) {
+			p = _iot_util_json_skip_ws(p, end);
+			if (p >= end || *p++ != ':')
+				return NULL;
+			p = _iot_util_json_skip_ws(p, end);
+			return (p < end) ? p : NULL;
+		}
+
+		p = _iot_util_json_skip_ws(p, end);
+		if (p >= end || *p++ != ':')
+			return NULL;
+		p = _iot_util_json_skip_value(p, end, 1);
+		if (!p)
+			return NULL;
+		p = _iot_util_json_skip_ws(p, end);
+		if (p >= end || *p++ != ',')
+			return NULL;
+	}
+}
+
+iot_error_t iot_util_json_get_string(const char *json, size_t json_len,
+		const char *key, char *buf, size_t buf_len)
+{
+	const char *p;
+	const char *end;
+	size_t pos = 0;
+	unsigned int cp;
+	int i, v;
+
+	if (!json || !key || !buf || !buf_len)
+		return IOT_ERROR_INVALID_ARGS;
+
+	p = _iot_util_json_find(json, json_len, key);
+	if (!p || *p != '"')
+		return IOT_ERROR_BAD_REQ;
+
+	end = _iot_util_json_skip_value(p, json + json_len, 1);
+	if (!end)
+		return IOT_ERROR_BAD_REQ;
+
+	/* unescape between the quotation marks */
+	for (p++, end--; p < end; p++) {
+		if (*p != '\\') {
+			if (pos + 1 >= buf_len)
+				return IOT_ERROR_BAD_REQ;
+			buf[pos++] = *p;
+			continue;
+		}
+
+		switch (*(++p)) {
+		case 'b':
+			cp = '\b';
+			break;
+		case 'f':
+			cp = '\f';
+			break;
+		case 'n':
+			cp = '\n';
+			break;
+		case 'r':
+			cp = '\r';
+			break;
+		case 't':
+			cp = '\t';
+			break;
+		case 'u':
+			if (end - p < 5)
+				return IOT_ERROR_BAD_REQ;
+			for (cp = 0, i = 1; i <= 4; i++) {
+				v = _iot_util_hex_val(p[i]);
+				if (v < 0)
+					return IOT_ERROR_BAD_REQ;
+				cp = (cp << 4) | v;
+			}
+			p += 4;
+			/* surrogate pairs are not expected in server messages */
+			if (cp >= 0xd800 && cp <= 0xdfff)
+				return IOT_ERROR_BAD_REQ;
+			break;
+		case '"':
+		case '\\':
+		case '/':
+			cp = (unsigned char)*p;
+			break;
+		default:
+			return IOT_ERROR_BAD_REQ;
+		}
+
+		if (cp < 0x80) {
+			if (pos + 1 >= buf_len)
+				return IOT_ERROR_BAD_REQ;
+			buf[pos++] = (char)cp;
+		} else if (cp < 0x800) {
+			if (pos + 2 >= buf_len)
+				return IOT_ERROR_BAD_REQ;
+			buf[pos++] = (char)(0xc0 | (cp >> 6));
+			buf[pos++] = (char)(0x80 | (cp & 0x3f));
+		} else {
+			if (pos + 3 >= buf_len)
+				return IOT_ERROR_BAD_REQ;
+			buf[pos++] = (char)(0xe0 | (cp >> 12));
+			buf[pos++] = (char)(0x80 | ((cp >> 6) & 0x3f));
+			buf[pos++] = (char)(0x80 | (cp & 0x3f));
+		}
+	}
+	buf[pos] = '\0';
+
+	return IOT_ERROR_NONE;
+}
+
+iot_error_t iot_util_json_get_int(const char *json, size_t json_len,
+		const char *key, int64_t *val)
+{
+	const char *p;
+	const char *end;
+	char num_str[32];
+	size_t len;
+	double dval;
+
+	if (!json || !key || !val)
+		return IOT_ERROR_INVALID_ARGS;
+
+	p = _iot_util_json_find(json, json_len, key);
+	if (!p || (*p != '-' && (*p < '0' || *p > '9')))
+		return IOT_ERROR_BAD_REQ;
+
+	end = _iot_util_json_skip_value(p, json + json_len, 1);
+	if (!end)
+		return IOT_ERROR_BAD_REQ;
+
+	len = end - p;
+	if (len >= sizeof(num_str))
+		return IOT_ERROR_BAD_REQ;
+	memcpy(num_str, p, len);
+	num_str[len] = '\0';
+
+	if (strpbrk(num_str, ".eE")) {
+		dval = strtod(num_str, NULL);
+		if (dval >= 9223372036854775807.0)
+			*val = INT64_MAX;
+		else if (dval <= -9223372036854775808.0)
+			*val = INT64_MIN;
+		else
+			*val = (int64_t)dval;
+	} else {
+		*val = strtoll(num_str, NULL, 10);
+	}
+
+	return IOT_ERROR_NONE;
+}
+
 iot_error_t iot_util_url_parse(char *url, url_parse_t *output)
 {
 	char *p1 = NULL;
@@ -350,14 +798,14 @@ iot_error_t iot_util_url_parse(char *url, url_parse_t *output)
 		return IOT_ERROR_INVALID_ARGS;
 
 	p_port = p2 + 1;
-	output->protocol = calloc(sizeof(char), p1 - url + 1);
+	output->protocol = iot_mem_calloc(IOT_MEM_TAG_CORE, sizeof(char), p1 - url + 1);
 	if (!output->protocol)
 		return IOT_ERROR_MEM_ALLOC;
 	strncpy(output->protocol, url, p1 - url);
 
-	output->domain = calloc(sizeof(char), p2 - p_domain + 1);
+	output->domain = iot_mem_calloc(IOT_MEM_TAG_CORE, sizeof(char), p2 - p_domain + 1);
 	if (!output->domain) {
-		free(output->protocol);
+		iot_mem_free(IOT_MEM_TAG_CORE, output->protocol);
 		output->protocol = NULL;
 		return IOT_ERROR_MEM_ALLOC;
 	}
@@ -367,3 +815,110 @@ iot_error_t iot_util_url_parse(char *url, url_parse_t *output)
 
 	return IOT_ERROR_NONE;
 }
+
+void iot_util_backoff_init(struct iot_backoff *backoff,
+		unsigned int base_ms, unsigned int cap_ms)
+{
+	if (!backoff)
+		return;
+
+	backoff->base_ms = base_ms ? base_ms : 1;
+	backoff->cap_ms = (cap_ms < backoff->base_ms) ? backoff->base_ms : cap_ms;
+	iot_util_backoff_reset(backoff);
+}
+
+unsigned int iot_util_backoff_next(struct iot_backoff *backoff)
+{
+	unsigned long long hi;
+	unsigned int lo;
+	unsigned int delay;
+
+	if (!backoff)
+		return 0;
+
+	/* sleep = min(cap, random_between(base, sleep * 3)) */
+	hi = (unsigned long long)backoff->prev_ms * 3;
+	if (hi < (unsigned long long)backoff->floor_ms * 3)
+		hi = (unsigned long long)backoff->floor_ms * 3;
+	if (hi > backoff->cap_ms)
+		hi = backoff->cap_ms;
+
+	lo = (backoff->floor_ms > backoff->base_ms) ? backoff->floor_ms : backoff->base_ms;
+	if (lo > hi)
+		lo = (unsigned int)hi;
+
+	delay = lo + (unsigned int)(iot_bsp_random() % ((unsigned int)hi - lo + 1));
+
+	backoff->prev_ms = delay;
+	backoff->floor_ms = 0;
+	backoff->attempts++;
+
+	return delay;
+}
+
+void iot_util_backoff_hint(struct iot_backoff *backoff, unsigned int floor_ms)
+{
+	if (!backoff)
+		return;
+
+	if (floor_ms > backoff->floor_ms)
+		backoff->floor_ms = floor_ms;
+}
+
+void iot_util_backoff_reset(struct iot_backoff *backoff)
+{
+	if (!backoff)
+		return;
+
+	backoff->prev_ms = backoff->base_ms;
+	backoff->floor_ms = 0;
+	backoff->attempts = 0;
+}
+
+void iot_util_atomic_max(unsigned int *target, unsigned int value)
+{
+	unsigned int curr = __atomic_load_n(target, __ATOMIC_RELAXED);
+
+	while (value > curr) {
+		if (__atomic_compare_exchange_n(target, &curr, value, true,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+}
+
+#define IOT_UTIL_ONCE_NONE	0
+#define IOT_UTIL_ONCE_BUSY	1
+#define IOT_UTIL_ONCE_READY	2
+
+iot_error_t iot_util_once_mutex_lock(iot_util_once_mutex_t *once_mutex)
+{
+	unsigned int state;
+
+	while ((state = __atomic_load_n(&once_mutex->state, __ATOMIC_ACQUIRE)) != IOT_UTIL_ONCE_READY) {
+		if (state == IOT_UTIL_ONCE_BUSY) {
+			/* other task is creating it */
+			iot_os_delay(1);
+			continue;
+		}
+
+		if (!__atomic_compare_exchange_n(&once_mutex->state, &state, IOT_UTIL_ONCE_BUSY,
+				false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			continue;
+
+		if (iot_os_mutex_init(&once_mutex->mutex) != IOT_OS_TRUE) {
+			IOT_ERROR("failed to create mutex");
+			__atomic_store_n(&once_mutex->state, IOT_UTIL_ONCE_NONE, __ATOMIC_RELEASE);
+			return IOT_ERROR_MEM_ALLOC;
+		}
+		__atomic_store_n(&once_mutex->state, IOT_UTIL_ONCE_READY, __ATOMIC_RELEASE);
+	}
+
+	iot_os_mutex_lock(&once_mutex->mutex);
+
+	return IOT_ERROR_NONE;
+}
+
+void iot_util_once_mutex_unlock(iot_util_once_mutex_t *once_mutex)
+{
+	iot_os_mutex_unlock(&once_mutex->mutex);
+}
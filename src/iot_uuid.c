@@ -24,6 +24,7 @@
 #include "iot_uuid.h"
 #include "iot_bsp_random.h"
 #include "iot_debug.h"
+#include "iot_mem.h"
 
 iot_error_t iot_random_uuid_from_mac(struct iot_uuid *uuid)
 {
@@ -54,7 +55,7 @@ iot_error_t iot_random_uuid_from_mac(struct iot_uuid *uuid)
 
 	buf_len = sizeof(mac) + sizeof(tv);
 
-	buf = (unsigned char *)iot_os_malloc(buf_len);
+	buf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CORE, buf_len);
 	if (!buf) {
 		IOT_ERROR("malloc failed for buf");
 		return IOT_ERROR_MEM_ALLOC;
@@ -70,13 +71,13 @@ iot_error_t iot_random_uuid_from_mac(struct iot_uuid *uuid)
 	err = iot_crypto_sha256(buf, buf_len, hash);
 	if (err) {
 		IOT_ERROR("iot_crypto_sha256 failed, ret = %d", err);
-		free((void *)buf);
+		iot_mem_free(IOT_MEM_TAG_CORE, (void *)buf);
 		return err;
 	}
 
 	memcpy((void *)uuid, hash, sizeof(struct iot_uuid));
 
-	free((void *)buf);
+	iot_mem_free(IOT_MEM_TAG_CORE, (void *)buf);
 
 	return IOT_ERROR_NONE;
 }
@@ -102,7 +103,7 @@ iot_error_t iot_uuid_from_mac(struct iot_uuid *uuid)
 
 	buf_len = sizeof(mac);
 
-	buf = (unsigned char *)iot_os_malloc(buf_len);
+	buf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CORE, buf_len);
 	if (!buf) {
 		IOT_ERROR("malloc failed for buf");
 		return IOT_ERROR_MEM_ALLOC;
@@ -117,13 +118,13 @@ iot_error_t iot_uuid_from_mac(struct iot_uuid *uuid)
 	err = iot_crypto_sha256(buf, buf_len, hash);
 	if (err) {
 		IOT_ERROR("iot_crypto_sha256 failed, err = %d", err);
-		free((void *)buf);
+		iot_mem_free(IOT_MEM_TAG_CORE, (void *)buf);
 		return err;
 	}
 
 	memcpy((void *)uuid, hash, sizeof(struct iot_uuid));
 
-	free((void *)buf);
+	iot_mem_free(IOT_MEM_TAG_CORE, (void *)buf);
 
 	return IOT_ERROR_NONE;
 }
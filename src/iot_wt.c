@@ -26,6 +26,7 @@
 #include "iot_crypto.h"
 #include "iot_wt.h"
 #include "iot_util.h"
+#include "iot_mem.h"
 
 static char * _iot_wt_alloc_b64_buffer(size_t plain_len, size_t *out_len)
 {
@@ -34,7 +35,7 @@ static char * _iot_wt_alloc_b64_buffer(size_t plain_len, size_t *out_len)
 
 	b64_len = IOT_CRYPTO_CAL_B64_LEN(plain_len);
 
-	b64_buf = (char *)malloc(b64_len);
+	b64_buf = (char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, b64_len);
 	if (!b64_buf) {
 		IOT_ERROR("malloc failed for base64 token");
 		return NULL;
@@ -112,7 +113,7 @@ static iot_error_t _iot_cwt_create_protected(
 retry:
 	buflen += 32;
 
-	cborbuf = (unsigned char *)malloc(buflen);
+	cborbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, buflen);
 	if (cborbuf == NULL) {
 		IOT_ERROR("failed to malloc for cwt");
 		return IOT_ERROR_MEM_ALLOC;
@@ -133,7 +134,7 @@ retry:
 		break;
 	default:
 		IOT_ERROR("'%d' not yet supported", pk_type);
-		free(cborbuf);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf);
 		return IOT_ERROR_WEBTOKEN_FAIL;
 	}
 
@@ -141,7 +142,7 @@ retry:
 
 	olen = cbor_encoder_get_buffer_size(&root, cborbuf);
 	if (olen < buflen) {
-		tmp = (unsigned char *)realloc(cborbuf, olen + 1);
+		tmp = (unsigned char *)iot_mem_realloc(IOT_MEM_TAG_CRYPTO, cborbuf, buflen, olen + 1);
 		if (tmp) {
 			cborbuf = tmp;
 			cborbuf[olen] = 0;
@@ -149,7 +150,7 @@ retry:
 	} else {
 		IOT_ERROR("allocated size is not enough (%d < %d)",
 				(int)buflen, (int)olen);
-		free(cborbuf);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf);
 		if (buflen < IOT_CBOR_MAX_BUF_LEN) {
 			goto retry;
 		} else {
@@ -212,7 +213,7 @@ static iot_error_t _iot_cwt_create_payload(
 retry:
 	buflen += 128;
 
-	cborbuf = (unsigned char *)malloc(buflen);
+	cborbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, buflen);
 	if (cborbuf == NULL) {
 		IOT_ERROR("failed to malloc for cwt");
 		return IOT_ERROR_MEM_ALLOC;
@@ -240,7 +241,7 @@ retry:
 
 	olen = cbor_encoder_get_buffer_size(&root, cborbuf);
 	if (olen < buflen) {
-		tmp = (unsigned char *)realloc(cborbuf, olen + 1);
+		tmp = (unsigned char *)iot_mem_realloc(IOT_MEM_TAG_CRYPTO, cborbuf, buflen, olen + 1);
 		if (tmp) {
 			cborbuf = tmp;
 			cborbuf[olen] = 0;
@@ -248,7 +249,7 @@ retry:
 	} else {
 		IOT_ERROR("allocated size is not enough (%d < %d)",
 				(int)buflen, (int)olen);
-		free(cborbuf);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf);
 		if (buflen < IOT_CBOR_MAX_BUF_LEN) {
 			goto retry;
 		} else {
@@ -265,7 +266,7 @@ retry:
 static iot_error_t _iot_cwt_create_signature(
 		unsigned char **sig, size_t *sig_len,
 		struct cwt_tobesign_info *tbs_info,
-		iot_crypto_pk_info_t *pk_info)
+		iot_crypto_pk_context_t *pk_ctx)
 {
 	iot_error_t err;
 	CborEncoder root = {0};
@@ -276,12 +277,11 @@ static iot_error_t _iot_cwt_create_signature(
 	size_t buflen = 128;
 	size_t olen;
 
-	iot_crypto_pk_context_t pk_ctx;
 	unsigned char *sigbuf;
 	size_t sigbuflen;
 	const char *context = "Signature1";
 
-	if (!sig || !sig_len || !tbs_info || !pk_info) {
+	if (!sig || !sig_len || !tbs_info || !pk_ctx) {
 		IOT_ERROR("invalid args");
 		return IOT_ERROR_INVALID_ARGS;
 	}
@@ -292,25 +292,20 @@ static iot_error_t _iot_cwt_create_signature(
 		return IOT_ERROR_INVALID_ARGS;
 	}
 
-	sigbuf = (unsigned char *)malloc(IOT_CRYPTO_SIGNATURE_LEN);
+	sigbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, IOT_CRYPTO_SIGNATURE_LEN);
 	if (!sigbuf) {
 		IOT_ERROR("malloc failed for cwt");
 		return IOT_ERROR_MEM_ALLOC;
 	}
 
-	err = iot_crypto_pk_init(&pk_ctx, pk_info);
-	if (err) {
-		IOT_ERROR("iot_crypto_pk_init returned error : %d", err);
-		goto exit_sig;
-	}
-
 retry:
 	buflen += 128;
 
-	cborbuf = (unsigned char *)malloc(buflen);
+	cborbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, buflen);
 	if (cborbuf == NULL) {
 		IOT_ERROR("failed to malloc for cwt");
-		goto exit_pk;
+		err = IOT_ERROR_MEM_ALLOC;
+		goto exit_sig;
 	}
 
 	memset(cborbuf, 0, buflen);
@@ -328,7 +323,7 @@ retry:
 
 	olen = cbor_encoder_get_buffer_size(&root, cborbuf);
 	if (olen < buflen) {
-		tmp = (unsigned char *)realloc(cborbuf, olen + 1);
+		tmp = (unsigned char *)iot_mem_realloc(IOT_MEM_TAG_CRYPTO, cborbuf, buflen, olen + 1);
 		if (tmp) {
 			cborbuf = tmp;
 			cborbuf[olen] = 0;
@@ -336,22 +331,22 @@ retry:
 	} else {
 		IOT_ERROR("allocated size is not enough (%d < %d)",
 				(int)buflen, (int)olen);
-		free(cborbuf);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf);
 		if (buflen < IOT_CBOR_MAX_BUF_LEN) {
 			goto retry;
 		} else {
-			goto exit_pk;
+			err = IOT_ERROR_WEBTOKEN_FAIL;
+			goto exit_sig;
 		}
 	}
 
-	err = iot_crypto_pk_sign(&pk_ctx, cborbuf, olen, sigbuf, &sigbuflen);
+	err = iot_crypto_pk_sign(pk_ctx, cborbuf, olen, sigbuf, &sigbuflen);
 	if (err) {
 		IOT_ERROR("iot_crypto_pk_sign returned error : %d", err);
 		goto exit_cborbuf;
 	}
 
-	free(cborbuf);
-	iot_crypto_pk_free(&pk_ctx);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf);
 
 	*sig = sigbuf;
 	*sig_len = sigbuflen;
@@ -359,16 +354,14 @@ retry:
 	return IOT_ERROR_NONE;
 
 exit_cborbuf:
-	free(cborbuf);
-exit_pk:
-	iot_crypto_pk_free(&pk_ctx);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf);
 exit_sig:
-	free(sigbuf);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, sigbuf);
 
 	return err;
 }
 
-static iot_error_t _iot_cwt_create(char **token, const char *sn, iot_crypto_pk_info_t *pk_info)
+static iot_error_t _iot_cwt_create(char **token, const char *sn, iot_crypto_pk_context_t *pk_ctx)
 {
 	iot_error_t err;
 	CborEncoder root = {0};
@@ -388,14 +381,14 @@ static iot_error_t _iot_cwt_create(char **token, const char *sn, iot_crypto_pk_i
 	size_t b64_len;
 	struct cwt_tobesign_info tbs_info;
 
-	if (!token || !sn || !pk_info) {
+	if (!token || !sn || !pk_ctx || !pk_ctx->info) {
 		return IOT_ERROR_INVALID_ARGS;
 	}
 
 retry:
 	buflen += 128;
 
-	cborbuf = (unsigned char *)malloc(buflen);
+	cborbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, buflen);
 	if (cborbuf == NULL) {
 		IOT_ERROR("failed to malloc for cbor");
 		return IOT_ERROR_MEM_ALLOC;
@@ -413,7 +406,7 @@ retry:
 	cbor_encoder_create_array(&root, &array, array_num);
 
 	/* protected */
-	err = _iot_cwt_create_protected(&protected, &protected_len, pk_info->type);
+	err = _iot_cwt_create_protected(&protected, &protected_len, pk_ctx->info->type);
 	if (err)
 		goto exit_cborbuf;
 
@@ -436,7 +429,7 @@ retry:
 	tbs_info.protected_len = protected_len;
 	tbs_info.payload = payload;
 	tbs_info.payload_len = payload_len;
-	err = _iot_cwt_create_signature(&signature, &olen, &tbs_info, pk_info);
+	err = _iot_cwt_create_signature(&signature, &olen, &tbs_info, pk_ctx);
 	if (err)
 		goto exit_payload;
 
@@ -446,7 +439,7 @@ retry:
 
 	olen = cbor_encoder_get_buffer_size(&root, cborbuf);
 	if (olen < buflen) {
-		tmp = (unsigned char *)realloc(cborbuf, olen + 1);
+		tmp = (unsigned char *)iot_mem_realloc(IOT_MEM_TAG_CRYPTO, cborbuf, buflen, olen + 1);
 		if (tmp) {
 			cborbuf = tmp;
 			cborbuf[olen] = 0;
@@ -458,7 +451,7 @@ retry:
 	} else {
 		IOT_ERROR("allocated size is not enough (%d < %d)",
 				(int)buflen, (int)olen);
-		free(cborbuf);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf);
 		if (buflen < IOT_CBOR_MAX_BUF_LEN) {
 			goto retry;
 		} else {
@@ -475,7 +468,7 @@ retry:
 	err = iot_crypto_base64_encode(cborbuf, cbor_len, (unsigned char *)cborbuf_b64, b64_len, &olen);
 	if (err) {
 		IOT_ERROR("iot_crypto_base64_encode returned error : %d", err);
-		free(cborbuf_b64);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf_b64);
 		goto exit_failed;
 	}
 
@@ -486,16 +479,16 @@ retry:
 	err = IOT_ERROR_NONE;
 
 exit_failed:
-	free(cborbuf);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf);
 exit_signature:
-	free(signature);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, signature);
 exit_payload:
-	free(payload);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, payload);
 exit_unprotected:
 exit_protected:
-	free(protected);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, protected);
 exit_cborbuf:
-	free(cborbuf);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, cborbuf);
 
 	return err;
 }
@@ -620,9 +613,9 @@ static iot_error_t _iot_jwt_create_b64h(char **buf, size_t *out_len,
 	goto exit_hdr;
 
 exit_b64_buf:
-	free(b64_buf);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, b64_buf);
 exit_hdr:
-	free(hdr);
+	JSON_FREE(hdr);
 exit:
 	return err;
 }
@@ -710,47 +703,37 @@ static iot_error_t _iot_jwt_create_b64p(char **buf, size_t *out_len)
 	goto exit_payload;
 
 exit_b64_buf:
-	free(b64_buf);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, b64_buf);
 exit_payload:
-	free(payload);
+	JSON_FREE(payload);
 exit:
 	return err;
 }
 
 static iot_error_t _iot_jwt_create_b64s(char **buf, size_t *out_len,
                                         char *b64hp, size_t hp_len,
-					iot_crypto_pk_info_t *pk_info)
+					iot_crypto_pk_context_t *pk_ctx)
 {
 	iot_error_t err;
-	iot_crypto_pk_context_t pk_ctx;
 	char *sig;
 	char *b64_buf;
 	size_t sig_len;
 	size_t b64_len;
 
-	sig = (char *)malloc(IOT_CRYPTO_SIGNATURE_LEN);
+	sig = (char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, IOT_CRYPTO_SIGNATURE_LEN);
 	if (!sig) {
 		IOT_ERROR("malloc returned NULL");
 		err = IOT_ERROR_MEM_ALLOC;
 		goto exit;
 	}
 
-	err = iot_crypto_pk_init(&pk_ctx, pk_info);
-	if (err) {
-		IOT_ERROR("iot_crypto_pk_init returned error : %d", err);
-		goto exit_sig;
-	}
-
-	err = iot_crypto_pk_sign(&pk_ctx, (unsigned char *)b64hp, hp_len,
+	err = iot_crypto_pk_sign(pk_ctx, (unsigned char *)b64hp, hp_len,
 	                            (unsigned char *)sig, &sig_len);
 	if (err) {
 		IOT_ERROR("iot_crypto_pk_sign returned error : %d", err);
-		iot_crypto_pk_free(&pk_ctx);
 		goto exit_sig;
 	}
 
-	iot_crypto_pk_free(&pk_ctx);
-
 	b64_buf = _iot_wt_alloc_b64_buffer(sig_len, &b64_len);
 	if (!b64_buf) {
 		IOT_ERROR("_iot_wt_alloc_b64_buffer returned NULL");
@@ -768,14 +751,14 @@ static iot_error_t _iot_jwt_create_b64s(char **buf, size_t *out_len,
 	goto exit_sig;
 
 exit_b64_buf:
-	free(b64_buf);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, b64_buf);
 exit_sig:
-	free(sig);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, sig);
 exit:
 	return err;
 }
 
-static iot_error_t _iot_jwt_create(char **token, const char *sn, iot_crypto_pk_info_t *pk_info)
+static iot_error_t _iot_jwt_create(char **token, const char *sn, iot_crypto_pk_context_t *pk_ctx)
 {
 	iot_error_t err;
 	char *b64h;
@@ -788,13 +771,13 @@ static iot_error_t _iot_jwt_create(char **token, const char *sn, iot_crypto_pk_i
 	size_t token_len;
 	size_t written = 0;
 
-	if (!token || !sn || !pk_info) {
+	if (!token || !sn || !pk_ctx || !pk_ctx->info) {
 		return IOT_ERROR_INVALID_ARGS;
 	}
 
 	/* b64h = b64(header) */
 
-	err = _iot_jwt_create_b64h(&b64h, &b64h_len, sn, pk_info->type);
+	err = _iot_jwt_create_b64h(&b64h, &b64h_len, sn, pk_ctx->info->type);
 	if (err) {
 		IOT_ERROR("_iot_jwt_create_b64h returned error : %d", err);
 		goto exit;
@@ -812,7 +795,7 @@ static iot_error_t _iot_jwt_create(char **token, const char *sn, iot_crypto_pk_i
 
 	token_len = b64h_len + b64p_len + IOT_CRYPTO_CAL_B64_LEN(IOT_CRYPTO_SIGNATURE_LEN) + 3;
 
-	tmp = (char *)malloc(token_len);
+	tmp = (char *)iot_mem_malloc(IOT_MEM_TAG_CRYPTO, token_len);
 	if (tmp == NULL) {
 		IOT_ERROR("malloc returned NULL");
 		err = IOT_ERROR_MEM_ALLOC;
@@ -829,10 +812,10 @@ static iot_error_t _iot_jwt_create(char **token, const char *sn, iot_crypto_pk_i
 
 	/* b64s = b64(sign(sha256(b64h.b64p))) */
 
-	err = _iot_jwt_create_b64s(&b64s, &b64s_len, tmp, written, pk_info);
+	err = _iot_jwt_create_b64s(&b64s, &b64s_len, tmp, written, pk_ctx);
 	if (err) {
 		IOT_ERROR("_iot_jwt_create_b64s returned error : %d", err);
-		free(tmp);
+		iot_mem_free(IOT_MEM_TAG_CRYPTO, tmp);
 		goto exit_payload;
 	}
 
@@ -852,22 +835,44 @@ static iot_error_t _iot_jwt_create(char **token, const char *sn, iot_crypto_pk_i
 	goto exit_signature;
 
 exit_signature:
-	free(b64s);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, b64s);
 exit_payload:
-	free(b64p);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, b64p);
 exit_header:
-	free(b64h);
+	iot_mem_free(IOT_MEM_TAG_CRYPTO, b64h);
 exit:
 	return err;
 }
 
 #endif /* STDK_IOT_CORE_WEBTOKEN_CBOR */
 
-iot_error_t iot_wt_create(char **token, const char *sn, iot_crypto_pk_info_t *pk_info)
+iot_error_t iot_wt_create_with_ctx(char **token, const char *sn, iot_crypto_pk_context_t *pk_ctx)
 {
 #if defined(STDK_IOT_CORE_WEBTOKEN_CBOR)
-	return _iot_cwt_create(token, sn, pk_info);
+	return _iot_cwt_create(token, sn, pk_ctx);
 #else
-	return _iot_jwt_create(token, sn, pk_info);
+	return _iot_jwt_create(token, sn, pk_ctx);
 #endif
 }
+
+iot_error_t iot_wt_create(char **token, const char *sn, iot_crypto_pk_info_t *pk_info)
+{
+	iot_error_t err;
+	iot_crypto_pk_context_t pk_ctx;
+
+	if (!token || !sn || !pk_info) {
+		return IOT_ERROR_INVALID_ARGS;
+	}
+
+	err = iot_crypto_pk_init(&pk_ctx, pk_info);
+	if (err) {
+		IOT_ERROR("iot_crypto_pk_init returned error : %d", err);
+		return err;
+	}
+
+	err = iot_wt_create_with_ctx(token, sn, &pk_ctx);
+
+	iot_crypto_pk_free(&pk_ctx);
+
+	return err;
+}
@@ -22,6 +22,8 @@
 #include "iot_util.h"
 #include "iot_main.h"
 #include "iot_debug.h"
+#include "iot_mem.h"
+#include "iot_trace.h"
 #include "iot_mqtt_client.h"
 
 static int getNextPacketId(MQTTClient *c)
@@ -29,12 +31,27 @@ static int getNextPacketId(MQTTClient *c)
 	return c->next_packetid = (c->next_packetid == MAX_PACKET_ID) ? 1 : c->next_packetid + 1;
 }
 
+#define MQTT_STATS_ADD(c, field, n) do { \
+		if ((c)->stats) \
+			__atomic_add_fetch(&(c)->stats->field, (n), __ATOMIC_RELAXED); \
+	} while (0)
+
+/* Owner may reset the counter meanwhile, so compare and swap until it holds */
+#define MQTT_STATS_MAX(c, field, v) do { \
+		if ((c)->stats) { \
+			unsigned int _curr = __atomic_load_n(&(c)->stats->field, __ATOMIC_RELAXED); \
+			while ((v) > _curr && !__atomic_compare_exchange_n(&(c)->stats->field, \
+					&_curr, (v), true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) \
+				; \
+		} \
+	} while (0)
+
 static int sendPacket(MQTTClient *c, unsigned char *buf, int length, iot_os_timer timer)
 {
 	int rc = E_ST_MQTT_FAILURE, sent = 0;
 
 	while (sent < length && !iot_os_timer_isexpired(timer)) {
-		rc = c->net->write(c->net, &buf[sent], length, timer);
+		rc = c->net->write(c->net, &buf[sent], length - sent, timer);
 
 		if (rc < 0) { // there was an error writing the data
 			break;
@@ -42,6 +59,7 @@ static int sendPacket(MQTTClient *c, unsigned char *buf, int length, iot_os_time
 
 		sent += rc;
 	}
+	MQTT_STATS_ADD(c, bytes_out, sent);
 
 	if (sent == length) {
 		iot_os_timer_count_ms(c->last_sent, c->keepAliveInterval * 1000); // record the fact that we have successfully sent the packet
@@ -53,14 +71,55 @@ static int sendPacket(MQTTClient *c, unsigned char *buf, int length, iot_os_time
 	return rc;
 }
 
-int st_mqtt_create(st_mqtt_client *client, unsigned int command_timeout_ms)
+/* Send buffers of iov as one packet stream. iov is consumed while sending */
+static int sendPacketv(MQTTClient *c, iot_net_iovec_t *iov, int iovcnt, iot_os_timer timer)
 {
+	int rc = E_ST_MQTT_FAILURE, sent = 0, length = 0;
 	int i;
+
+	for (i = 0; i < iovcnt; i++)
+		length += iov[i].len;
+
+	while (sent < length && !iot_os_timer_isexpired(timer)) {
+		if (c->net->writev)
+			rc = c->net->writev(c->net, iov, iovcnt, timer);
+		else
+			rc = c->net->write(c->net, iov->base, iov->len, timer);
+
+		if (rc < 0) { // there was an error writing the data
+			break;
+		}
+
+		sent += rc;
+		while (iovcnt > 0 && rc >= iov->len) {
+			rc -= iov->len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->base += rc;
+			iov->len -= rc;
+		}
+	}
+	MQTT_STATS_ADD(c, bytes_out, sent);
+
+	if (sent == length) {
+		iot_os_timer_count_ms(c->last_sent, c->keepAliveInterval * 1000); // record the fact that we have successfully sent the packet
+		rc = 0;
+	} else {
+		rc = E_ST_MQTT_FAILURE;
+	}
+
+	return rc;
+}
+
+int st_mqtt_create(st_mqtt_client *client, unsigned int command_timeout_ms)
+{
 	MQTTClient *c = NULL;
 	int rc = E_ST_MQTT_FAILURE;
 	iot_error_t iot_err;
 
-	*client = malloc(sizeof(MQTTClient));
+	*client = iot_mem_malloc(IOT_MEM_TAG_MQTT, sizeof(MQTTClient));
 	if (*client == NULL) {
 		IOT_ERROR("buf malloc fail");
 		goto error_handle;
@@ -69,9 +128,7 @@ int st_mqtt_create(st_mqtt_client *client, unsigned int command_timeout_ms)
 
 	c = *client;
 
-	for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
-		c->messageHandlers[i].topicFilter = 0;
-	}
+	c->subscriptions = NULL;
 
 	if (command_timeout_ms != 0) {
 		c->command_timeout_ms = command_timeout_ms;
@@ -79,7 +136,7 @@ int st_mqtt_create(st_mqtt_client *client, unsigned int command_timeout_ms)
 		c->command_timeout_ms = DEFAULT_COMMNAD_TIMEOUT;
 	}
 
-	c->net = malloc(sizeof(iot_net_interface_t));
+	c->net = iot_mem_malloc(IOT_MEM_TAG_MQTT, sizeof(iot_net_interface_t));
 	if (c->net == NULL) {
 		IOT_ERROR("buf malloc fail");
 		goto error_handle;
@@ -120,7 +177,7 @@ int st_mqtt_create(st_mqtt_client *client, unsigned int command_timeout_ms)
 error_handle:
 	if (c) {
 		if (c->net)
-			free(c->net);
+			iot_mem_free(IOT_MEM_TAG_MQTT, c->net);
 		if (c->last_sent)
 			iot_os_timer_destroy(&c->last_sent);
 		if (c->last_received)
@@ -129,22 +186,57 @@ error_handle:
 			iot_os_timer_destroy(&c->ping_wait);
 		if (c->mutex.sem)
 			iot_os_mutex_destroy(&c->mutex);
-		free(c);
+		iot_mem_free(IOT_MEM_TAG_MQTT, c);
 		*client = NULL;
 	}
 	return rc;
 }
 
-void MQTTCleanSession(MQTTClient *c)
+static void _iot_mqtt_reset_topic_alias(MQTTClient *c)
+{
+	int i;
+
+	for (i = 0; i < MQTT_TOPIC_ALIAS_MAX; i++) {
+		if (c->topic_alias[i] != NULL) {
+			iot_mem_free(IOT_MEM_TAG_MQTT, c->topic_alias[i]);
+			c->topic_alias[i] = NULL;
+		}
+	}
+}
+
+/* Find the topic alias of topic or assign a free one, 0 if there is none.
+ * known is set when the alias was sent to server with its topic already.
+ */
+static unsigned short _iot_mqtt_topic_alias(MQTTClient *c, const char *topic, int *known)
 {
-	int i = 0;
+	size_t len;
+	int i;
 
-	for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
-		if (c->messageHandlers[i].topicFilter != NULL) {
-			free(c->messageHandlers[i].topicFilter);
-			c->messageHandlers[i].topicFilter = NULL;
+	*known = 0;
+	for (i = 0; i < c->topic_alias_max; i++) {
+		if (c->topic_alias[i] == NULL)
+			break;
+		if (!strcmp(c->topic_alias[i], topic)) {
+			*known = 1;
+			return i + 1;
 		}
 	}
+
+	if (i == c->topic_alias_max)
+		return 0;
+
+	len = strlen(topic);
+	c->topic_alias[i] = iot_mem_malloc(IOT_MEM_TAG_MQTT, len + 1);
+	if (c->topic_alias[i] == NULL)
+		return 0;
+	memcpy(c->topic_alias[i], topic, len + 1);
+
+	return i + 1;
+}
+
+void MQTTCleanSession(MQTTClient *c)
+{
+	MQTTTopicTree_free(&c->subscriptions);
 }
 
 static void _iot_mqtt_close_session(MQTTClient *c)
@@ -171,7 +263,9 @@ void st_mqtt_destroy(st_mqtt_client client)
 	if (c->isconnected) {
 		_iot_mqtt_close_session(c);
 	}
-	free(c->net);
+	MQTTTopicTree_free(&c->subscriptions);
+	_iot_mqtt_reset_topic_alias(c);
+	iot_mem_free(IOT_MEM_TAG_MQTT, c->net);
 
 	iot_os_timer_destroy(&c->last_sent);
 	iot_os_timer_destroy(&c->last_received);
@@ -179,7 +273,7 @@ void st_mqtt_destroy(st_mqtt_client client)
 	iot_os_mutex_unlock(&c->mutex);
 
 	iot_os_mutex_destroy(&c->mutex);
-	free(c);
+	iot_mem_free(IOT_MEM_TAG_MQTT, c);
 }
 
 static int decodePacket(MQTTClient *c, int *value, iot_os_timer timer)
@@ -228,14 +322,18 @@ static int readPacket(MQTTClient *c, iot_os_timer timer)
 	}
 	len = 1;
 
+	/* inbound message is traced from its first byte */
+	if ((i >> 4) == PUBLISH)
+		c->trace_seq = IOT_TRACE_BEGIN();
+
 	/* 2. read the remaining length.  This is variable in itself */
 	decodePacket(c, &rem_len, timer);
 	if (c->readbuf != NULL) {
-		free(c->readbuf);
+		iot_mem_free(IOT_MEM_TAG_MQTT, c->readbuf);
 		c->readbuf = NULL;
 	}
 	c->readbuf_size = 5 + rem_len;
-	c->readbuf = (unsigned char *)malloc(c->readbuf_size);
+	c->readbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_MQTT, c->readbuf_size);
 	if (c->readbuf == NULL) {
 		IOT_ERROR("buf malloc failed");
 		rc = E_ST_MQTT_BUFFER_OVERFLOW;
@@ -251,6 +349,7 @@ static int readPacket(MQTTClient *c, iot_os_timer timer)
 		goto exit;
 	}
 
+	MQTT_STATS_ADD(c, bytes_in, len + rem_len);
 	header.byte = c->readbuf[0];
 	rc = header.bits.type;
 
@@ -263,62 +362,13 @@ exit:
 }
 
 
-// assume topic filter and name is in correct format
-// # can only be at end
-// + and # can only be next to separator
-static char isTopicMatched(char *topicFilter, MQTTString *topicName)
-{
-	char *curf = topicFilter;
-	char *curn = topicName->lenstring.data;
-	char *curn_end = curn + topicName->lenstring.len;
-
-	while (*curf && curn < curn_end) {
-		if (*curn == '/' && *curf != '/') {
-			break;
-		}
-
-		if (*curf != '+' && *curf != '#' && *curf != *curn) {
-			break;
-		}
-
-		if (*curf == '+') {
-			// skip until we meet the next separator, or end of string
-			char *nextpos = curn + 1;
-
-			while (nextpos < curn_end && *nextpos != '/') {
-				nextpos = ++curn + 1;
-			}
-		} else if (*curf == '#') {
-			curn = curn_end - 1;	// skip until end of string
-		}
-
-		curf++;
-		curn++;
-	};
-
-	return (curn == curn_end) && (*curf == '\0');
-}
-
-
 int deliverMessage(MQTTClient *c, st_mqtt_msg *message)
 {
-	int i;
 	int rc = E_ST_MQTT_FAILURE;
-	MQTTString topic;
-	topic.cstring = NULL;
-	topic.lenstring.data = message->topic;
-	topic.lenstring.len = message->topiclen;
-
-	// we have to find the right message handler - indexed by topic
-	for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
-		if (c->messageHandlers[i].topicFilter != 0 && (MQTTPacket_equals(&topic, (char *)c->messageHandlers[i].topicFilter) ||
-				isTopicMatched((char *)c->messageHandlers[i].topicFilter, &topic))) {
-			if (c->messageHandlers[i].fp != NULL) {
-				c->messageHandlers[i].fp(message, c->messageHandlers[i].userData);
-				rc = 0;
-			}
-		}
-	}
+
+	// every handler whose topic filter matches, by one walk of topic levels
+	if (MQTTTopicTree_deliver(c->subscriptions, message) > 0)
+		rc = 0;
 
 	if (rc == E_ST_MQTT_FAILURE && c->defaultMessageHandler != NULL) {
 		c->defaultMessageHandler(message, c->defaultUserData);
@@ -394,9 +444,11 @@ int cycle(MQTTClient *c, iot_os_timer timer)
 		int intQoS;
 		unsigned char dup;
 		unsigned short id;
+		MQTTV5Properties props;
 		msg.payloadlen = 0; /* this is a size_t, but deserialize publish sets this as int */
 
-		if (MQTTDeserialize_publish(&dup, &intQoS, &msg.retained, &id, &topicName,
+		if (MQTTV5Deserialize_publish(&dup, &intQoS, &msg.retained, &id, &topicName,
+									(c->mqtt_ver == MQTTV5_PROTOCOL_VERSION) ? &props : NULL,
 									(unsigned char **)&msg.payload, (int *)&msg.payloadlen, c->readbuf, c->readbuf_size) != 1) {
 			goto exit;
 		}
@@ -404,9 +456,17 @@ int cycle(MQTTClient *c, iot_os_timer timer)
 		msg.qos = intQoS;
 		msg.topic = topicName.lenstring.data;
 		msg.topiclen = topicName.lenstring.len;
-		deliverMessage(c, &msg);
+		msg.trace_seq = c->trace_seq;
+		IOT_TRACE_MARK(msg.trace_seq, IOT_TRACE_CMD_READ);
+		if (dup && msg.qos == st_mqtt_qos1 && c->unacked_id == id) {
+			/* resumed session redelivers message which was handled already */
+			IOT_INFO("skip redelivered message(%d)", id);
+		} else {
+			deliverMessage(c, &msg);
+		}
+		c->unacked_id = 0;
 		if (c->readbuf != NULL) {
-			free(c->readbuf);
+			iot_mem_free(IOT_MEM_TAG_MQTT, c->readbuf);
 			c->readbuf = NULL;
 		}
 		if (msg.qos != st_mqtt_qos0) {
@@ -423,6 +483,8 @@ int cycle(MQTTClient *c, iot_os_timer timer)
 				rc = sendPacket(c, pbuf, len, timer);
 			}
 			if (rc == E_ST_MQTT_FAILURE) {
+				if (msg.qos == st_mqtt_qos1)
+					c->unacked_id = id;
 				goto exit;	  // there was a problem
 			}
 		}
@@ -444,7 +506,7 @@ int cycle(MQTTClient *c, iot_os_timer timer)
 		} else if ((rc = sendPacket(c, pbuf, len, timer))) { // send the PUBREL packet
 			rc = E_ST_MQTT_FAILURE;	 // there was a problem
 		}
-		free(c->readbuf);
+		iot_mem_free(IOT_MEM_TAG_MQTT, c->readbuf);
 		c->readbuf = NULL;
 		if (rc == E_ST_MQTT_FAILURE) {
 			goto exit;	  // there was a problem
@@ -457,9 +519,28 @@ int cycle(MQTTClient *c, iot_os_timer timer)
 		break;
 
 	case PINGRESP:
+		if (c->ping_outstanding && c->stats) {
+			unsigned int rtt = c->command_timeout_ms - iot_os_timer_left_ms(c->ping_wait);
+
+			__atomic_store_n(&c->stats->ping_rtt_ms, rtt, __ATOMIC_RELAXED);
+			MQTT_STATS_MAX(c, ping_rtt_max_ms, rtt);
+		}
 		c->ping_outstanding = 0;
 		c->ping_retry_count = 0;
 		break;
+
+	case DISCONNECT: {
+		unsigned char reason;
+
+		/* MQTT 5.0 server tells why it closes the connection */
+		if (MQTTV5Deserialize_disconnect(NULL, &reason, c->readbuf, c->readbuf_size) == 1)
+			c->reason_code = reason;
+		IOT_WARN("mqtt disconnected by server(0x%02x)", c->reason_code);
+		iot_mem_free(IOT_MEM_TAG_MQTT, c->readbuf);
+		c->readbuf = NULL;
+		rc = E_ST_MQTT_FAILURE;
+		goto exit;
+	}
 	}
 
 	if (keepalive(c)) {
@@ -468,6 +549,12 @@ int cycle(MQTTClient *c, iot_os_timer timer)
 	}
 
 exit:
+	/* command handler finishes its trace, others are just released */
+	if (c->trace_seq) {
+		IOT_TRACE_END(c->trace_seq, IOT_TRACE_STAGE_MAX);
+		c->trace_seq = 0;
+	}
+
 	if (!rc) {
 		rc = packet_type;
 	}
@@ -608,6 +695,62 @@ int waitfor(MQTTClient *c, int packet_type, iot_os_timer timer)
 	return rc;
 }
 
+/* Convert CONNACK return code, or MQTT 5.0 reason code, to st_mqtt error */
+static int _iot_mqtt_connack_rc(MQTTClient *c, unsigned char connack_rc)
+{
+	if (c->mqtt_ver != MQTTV5_PROTOCOL_VERSION) {
+		switch (connack_rc) {
+		case MQTT_CONNECTION_ACCEPTED : return 0;
+		case MQTT_UNNACCEPTABLE_PROTOCOL : return E_ST_MQTT_UNNACCEPTABLE_PROTOCOL;
+		case MQTT_SERVER_UNAVAILABLE : return E_ST_MQTT_SERVER_UNAVAILABLE;
+		case MQTT_CLIENTID_REJECTED : return E_ST_MQTT_CLIENTID_REJECTED;
+		case MQTT_BAD_USERNAME_OR_PASSWORD : return E_ST_MQTT_BAD_USERNAME_OR_PASSWORD;
+		case MQTT_NOT_AUTHORIZED : return E_ST_MQTT_NOT_AUTHORIZED;
+		default : return E_ST_MQTT_FAILURE;
+		}
+	}
+
+	c->reason_code = connack_rc;
+	switch (connack_rc) {
+	case ST_MQTT_RC_SUCCESS:
+		return 0;
+	case ST_MQTT_RC_UNSUPPORTED_PROTOCOL_VERSION:
+		return E_ST_MQTT_UNNACCEPTABLE_PROTOCOL;
+	case ST_MQTT_RC_CLIENT_IDENTIFIER_NOT_VALID:
+		return E_ST_MQTT_CLIENTID_REJECTED;
+	case ST_MQTT_RC_BAD_USER_NAME_OR_PASSWORD:
+	case ST_MQTT_RC_BAD_AUTHENTICATION_METHOD:
+		return E_ST_MQTT_BAD_USERNAME_OR_PASSWORD;
+	case ST_MQTT_RC_NOT_AUTHORIZED:
+		return E_ST_MQTT_NOT_AUTHORIZED;
+	case ST_MQTT_RC_SERVER_UNAVAILABLE:
+	case ST_MQTT_RC_SERVER_BUSY:
+	case ST_MQTT_RC_BANNED:		/* not a credential problem, so don't let device clean up */
+	case ST_MQTT_RC_QUOTA_EXCEEDED:
+	case ST_MQTT_RC_USE_ANOTHER_SERVER:
+	case ST_MQTT_RC_SERVER_MOVED:
+	case ST_MQTT_RC_CONNECTION_RATE_EXCEEDED:
+		return E_ST_MQTT_SERVER_UNAVAILABLE;
+	default:
+		return E_ST_MQTT_FAILURE;
+	}
+}
+
+static void _iot_mqtt_connack_properties(MQTTClient *c, MQTTV5Properties *props)
+{
+	if ((props->present & MQTTV5_HAS_RECEIVE_MAXIMUM) && props->receiveMaximum)
+		c->receive_max = props->receiveMaximum;
+	if (props->present & MQTTV5_HAS_TOPIC_ALIAS_MAXIMUM)
+		c->topic_alias_max = (props->topicAliasMaximum < MQTT_TOPIC_ALIAS_MAX) ?
+				props->topicAliasMaximum : MQTT_TOPIC_ALIAS_MAX;
+	if (props->present & MQTTV5_HAS_MAXIMUM_PACKET_SIZE)
+		c->max_packet_size = props->maximumPacketSize;
+	if (props->present & MQTTV5_HAS_SERVER_KEEP_ALIVE) {
+		c->keepAliveInterval = props->serverKeepAlive;
+		iot_os_timer_count_ms(c->last_received, c->keepAliveInterval * 1000);
+	}
+}
+
 int MQTTConnectWithResults(st_mqtt_client client, st_mqtt_broker_info_t *broker, st_mqtt_connect_data *connect_data,
 									 MQTTConnackData *data)
 {
@@ -616,6 +759,8 @@ int MQTTConnectWithResults(st_mqtt_client client, st_mqtt_broker_info_t *broker,
 	int rc = E_ST_MQTT_FAILURE;
 	iot_error_t iot_err;
 	MQTTPacket_connectData options = MQTTPacket_connectData_initializer;
+	MQTTV5Properties props = MQTTV5Properties_initializer;
+	MQTTV5Properties *connect_props = NULL;
 	int len = 0, pbuf_size, connect_retry;
 	unsigned char *pbuf = NULL;
 
@@ -685,13 +830,32 @@ int MQTTConnectWithResults(st_mqtt_client client, st_mqtt_broker_info_t *broker,
 	c->cleansession = options.cleansession;
 	iot_os_timer_count_ms(c->last_received, c->keepAliveInterval * 1000);
 
-	pbuf_size = MQTTSerialize_connect_size(&options);
-	pbuf = (unsigned char *)malloc(pbuf_size);
+	/* topic aliases and server limits belong to one connection */
+	c->mqtt_ver = options.MQTTVersion;
+	c->reason_code = ST_MQTT_RC_SUCCESS;
+	c->receive_max = 65535;
+	c->max_packet_size = 0;
+	c->topic_alias_max = 0;
+	_iot_mqtt_reset_topic_alias(c);
+
+	if (c->mqtt_ver == MQTTV5_PROTOCOL_VERSION) {
+		props.present = MQTTV5_HAS_RECEIVE_MAXIMUM;
+		props.receiveMaximum = MQTT_RECEIVE_MAXIMUM;
+		/* MQTT 5.0 session ends with the connection unless it has expiry interval */
+		if (!options.cleansession) {
+			props.present |= MQTTV5_HAS_SESSION_EXPIRY_INTERVAL;
+			props.sessionExpiryInterval = MQTT_SESSION_EXPIRY_INTERVAL;
+		}
+		connect_props = &props;
+	}
+
+	pbuf_size = MQTTV5Serialize_connect_size(&options, connect_props);
+	pbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_MQTT, pbuf_size);
 	if (pbuf == NULL) {
 		IOT_ERROR("buf malloc fail");
 		goto exit_with_netcon;
 	}
-	if ((len = MQTTSerialize_connect(pbuf, pbuf_size, &options)) <= 0) {
+	if ((len = MQTTV5Serialize_connect(pbuf, pbuf_size, &options, connect_props)) <= 0) {
 		goto exit_with_netcon;
 	}
 
@@ -699,7 +863,7 @@ int MQTTConnectWithResults(st_mqtt_client client, st_mqtt_broker_info_t *broker,
 	if (rc) { // send the connect packet
 		goto exit_with_netcon;	  // there was a problem
 	}
-	free(pbuf);
+	iot_mem_free(IOT_MEM_TAG_MQTT, pbuf);
 	pbuf = NULL;
 
 	// this will be a blocking call, wait for the connack
@@ -707,18 +871,15 @@ int MQTTConnectWithResults(st_mqtt_client client, st_mqtt_broker_info_t *broker,
 		data->rc = 0;
 		data->sessionPresent = 0;
 
-		if (MQTTDeserialize_connack(&data->sessionPresent, &data->rc, c->readbuf, c->readbuf_size) == 1) {
-			switch (data->rc) {
-			case MQTT_UNNACCEPTABLE_PROTOCOL : rc = E_ST_MQTT_UNNACCEPTABLE_PROTOCOL; break;
-			case MQTT_SERVER_UNAVAILABLE : rc = E_ST_MQTT_SERVER_UNAVAILABLE; break;
-			case MQTT_CLIENTID_REJECTED : rc = E_ST_MQTT_CLIENTID_REJECTED; break;
-			case MQTT_BAD_USERNAME_OR_PASSWORD : rc = E_ST_MQTT_BAD_USERNAME_OR_PASSWORD; break;
-			case MQTT_NOT_AUTHORIZED : rc = E_ST_MQTT_NOT_AUTHORIZED; break;
-			}
+		if (MQTTV5Deserialize_connack(connect_props, &data->sessionPresent, &data->rc,
+					c->readbuf, c->readbuf_size) == 1) {
+			rc = _iot_mqtt_connack_rc(c, data->rc);
+			if (!rc && connect_props)
+				_iot_mqtt_connack_properties(c, connect_props);
 		} else {
 			rc = E_ST_MQTT_FAILURE;
 		}
-		free(c->readbuf);
+		iot_mem_free(IOT_MEM_TAG_MQTT, c->readbuf);
 		c->readbuf = NULL;
 	} else {
 		rc = E_ST_MQTT_FAILURE;
@@ -731,10 +892,16 @@ exit_with_netcon:
 		c->isconnected = 1;
 		c->ping_outstanding = 0;
 		c->ping_retry_count = 0;
+
+		/* server has no previous session, so local session state is stale */
+		if (!data->sessionPresent) {
+			MQTTCleanSession(c);
+			c->unacked_id = 0;
+		}
 	}
 
 	if (pbuf != NULL)
-		free(pbuf);
+		iot_mem_free(IOT_MEM_TAG_MQTT, pbuf);
 
 	if (connect_timer != NULL)
 		iot_os_timer_destroy(&connect_timer);
@@ -751,59 +918,41 @@ int st_mqtt_connect(st_mqtt_client client, st_mqtt_broker_info_t *broker, st_mqt
 	return MQTTConnectWithResults(client, broker, connect_data, &data);
 }
 
-int MQTTSetMessageHandler(st_mqtt_client client, const char *topic, st_mqtt_msg_handler handler, void *user_data)
+int st_mqtt_connect_with_session(st_mqtt_client client, st_mqtt_broker_info_t *broker,
+		st_mqtt_connect_data *connect_data, unsigned char *session_present)
 {
-	MQTTClient *c = client;
-	int rc = E_ST_MQTT_FAILURE;
-	int i = -1;
-
-	/* first check for an existing matching slot */
-	for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
-		if (c->messageHandlers[i].topicFilter != NULL && strcmp(c->messageHandlers[i].topicFilter, topic) == 0) {
-			if (handler == NULL) { /* remove existing */
-				free(c->messageHandlers[i].topicFilter);
-				c->messageHandlers[i].topicFilter = NULL;
-				c->messageHandlers[i].fp = NULL;
-				c->messageHandlers[i].userData = user_data;
-			}
-
-			rc = 0; /* return i when adding new subscription */
-			break;
-		}
-	}
-
-	/* if no existing, look for empty slot (unless we are removing) */
-	if (handler != NULL) {
-		if (rc == E_ST_MQTT_FAILURE) {
-			for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
-				if (c->messageHandlers[i].topicFilter == NULL) {
-					rc = 0;
-					break;
-				}
-			}
-		}
+	MQTTConnackData data;
+	int rc;
 
-		if (i < MAX_MESSAGE_HANDLERS) {
-			c->messageHandlers[i].topicFilter = strdup(topic);
-			c->messageHandlers[i].fp = handler;
-			c->messageHandlers[i].userData = user_data;
-		}
-	}
+	data.sessionPresent = 0;
+	rc = MQTTConnectWithResults(client, broker, connect_data, &data);
+	if (session_present)
+		*session_present = (rc == 0) ? data.sessionPresent : 0;
 
 	return rc;
 }
 
-int MQTTSubscribeWithResults(st_mqtt_client client, const char *topic, int qos, st_mqtt_msg_handler handler,
-							MQTTSubackData *data, void *user_data)
+int MQTTSetMessageHandler(st_mqtt_client client, const char *topic, st_mqtt_msg_handler handler, void *user_data)
 {
 	MQTTClient *c = client;
+
+	if (handler == NULL) /* remove existing */
+		return MQTTTopicTree_remove(&c->subscriptions, topic);
+
+	return MQTTTopicTree_add(&c->subscriptions, topic, handler, user_data);
+}
+
+static int _iot_mqtt_subscribe(MQTTClient *c, st_mqtt_sub_filter *filters, int count, int *granted_qos)
+{
 	int rc = E_ST_MQTT_FAILURE;
 	iot_error_t iot_err;
 	iot_os_timer timer = NULL;
-	int len = 0, pbuf_size;
+	int len = 0, pbuf_size, i;
 	unsigned char *pbuf = NULL;
-	MQTTString Topic = MQTTString_initializer;
-	Topic.cstring = (char *)topic;
+	MQTTString *Topics = NULL;
+	int *qoss = NULL;
+	MQTTV5Properties props = MQTTV5Properties_initializer;
+	MQTTV5Properties *sub_props = NULL;
 
 	iot_os_mutex_lock(&c->mutex);
 
@@ -812,6 +961,19 @@ int MQTTSubscribeWithResults(st_mqtt_client client, const char *topic, int qos,
 		goto exit;
 	}
 
+	Topics = (MQTTString *)iot_mem_calloc(IOT_MEM_TAG_MQTT, count, sizeof(MQTTString));
+	qoss = (int *)iot_mem_malloc(IOT_MEM_TAG_MQTT, count * sizeof(int));
+	if (Topics == NULL || qoss == NULL) {
+		IOT_ERROR("buf malloc fail");
+		goto exit;
+	}
+
+	for (i = 0; i < count; i++) {
+		Topics[i].cstring = (char *)filters[i].topic;
+		qoss[i] = filters[i].qos;
+		granted_qos[i] = 0x80;
+	}
+
 	iot_err = iot_os_timer_init(&timer);
 	if (iot_err) {
 		IOT_ERROR("fail to init timer");
@@ -819,14 +981,17 @@ int MQTTSubscribeWithResults(st_mqtt_client client, const char *topic, int qos,
 	}
 	iot_os_timer_count_ms(timer, c->command_timeout_ms);
 
-	pbuf_size = MQTTSerialize_subscribe_size(1, &Topic);
-	pbuf = (unsigned char *)malloc(pbuf_size);
+	if (c->mqtt_ver == MQTTV5_PROTOCOL_VERSION)
+		sub_props = &props;
+
+	pbuf_size = MQTTV5Serialize_subscribe_size(sub_props, count, Topics);
+	pbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_MQTT, pbuf_size);
 	if (pbuf == NULL) {
 		IOT_ERROR("buf malloc fail");
 		goto exit;
 	}
 
-	len = MQTTSerialize_subscribe(pbuf, pbuf_size, 0, getNextPacketId(c), 1, &Topic, (int *)&qos);
+	len = MQTTV5Serialize_subscribe(pbuf, pbuf_size, 0, getNextPacketId(c), sub_props, count, Topics, qoss);
 
 	if (len <= 0) {
 		goto exit;
@@ -836,20 +1001,28 @@ int MQTTSubscribeWithResults(st_mqtt_client client, const char *topic, int qos,
 	if (rc) { // send the subscribe packet
 		goto exit;	  // there was a problem
 	}
-	free(pbuf);
+	iot_mem_free(IOT_MEM_TAG_MQTT, pbuf);
 	pbuf = NULL;
 
 	if (waitfor(c, SUBACK, timer) == SUBACK) {	  // wait for suback
-		int count = 0;
+		int granted = 0;
 		unsigned short mypacketid;
-		data->granted_qos = st_mqtt_qos0;
 
-		if (MQTTDeserialize_suback(&mypacketid, 1, &count, (int *)&data->granted_qos, c->readbuf, c->readbuf_size) == 1) {
-			if (data->granted_qos != 0x80) {
-				rc = MQTTSetMessageHandler(client, topic, handler, user_data);
+		rc = E_ST_MQTT_FAILURE;
+		if (MQTTV5Deserialize_suback(&mypacketid, sub_props, count, &granted, granted_qos,
+					c->readbuf, c->readbuf_size) == 1) {
+			rc = 0;
+			for (i = 0; i < count; i++) {
+				/* one refused filter fails the request, granted ones still get handler */
+				if (i < granted && sub_props)
+					c->reason_code = granted_qos[i];
+				if (i >= granted || granted_qos[i] >= 0x80)
+					rc = E_ST_MQTT_FAILURE;
+				else if (MQTTSetMessageHandler(c, filters[i].topic, filters[i].handler, filters[i].user_data))
+					rc = E_ST_MQTT_FAILURE;
 			}
 		}
-		free(c->readbuf);
+		iot_mem_free(IOT_MEM_TAG_MQTT, c->readbuf);
 		c->readbuf = NULL;
 	} else {
 		rc = E_ST_MQTT_FAILURE;
@@ -857,7 +1030,13 @@ int MQTTSubscribeWithResults(st_mqtt_client client, const char *topic, int qos,
 
 exit:
 	if (pbuf != NULL)
-		free(pbuf);
+		iot_mem_free(IOT_MEM_TAG_MQTT, pbuf);
+
+	if (Topics != NULL)
+		iot_mem_free(IOT_MEM_TAG_MQTT, Topics);
+
+	if (qoss != NULL)
+		iot_mem_free(IOT_MEM_TAG_MQTT, qoss);
 
 	if (timer != NULL)
 		iot_os_timer_destroy(&timer);
@@ -867,12 +1046,35 @@ exit:
 	return rc;
 }
 
+int MQTTSubscribeWithResults(st_mqtt_client client, const char *topic, int qos, st_mqtt_msg_handler handler,
+							MQTTSubackData *data, void *user_data)
+{
+	st_mqtt_sub_filter filter;
+
+	filter.topic = topic;
+	filter.qos = qos;
+	filter.handler = handler;
+	filter.user_data = user_data;
+
+	return _iot_mqtt_subscribe(client, &filter, 1, &data->granted_qos);
+}
+
 int st_mqtt_subscribe(st_mqtt_client client, const char *topic, int qos, st_mqtt_msg_handler handler, void *user_data)
 {
 	MQTTSubackData data;
 	return MQTTSubscribeWithResults(client, topic, qos, handler, &data, user_data);
 }
 
+int st_mqtt_subscribe_many(st_mqtt_client client, st_mqtt_sub_filter *filters, int count)
+{
+	int granted_qos[st_mqtt_subscribe_max_filters];
+
+	if (client == NULL || filters == NULL || count <= 0 || count > st_mqtt_subscribe_max_filters)
+		return E_ST_MQTT_FAILURE;
+
+	return _iot_mqtt_subscribe(client, filters, count, granted_qos);
+}
+
 int st_mqtt_unsubscribe(st_mqtt_client client, const char *topic)
 {
 	MQTTClient *c = client;
@@ -883,6 +1085,8 @@ int st_mqtt_unsubscribe(st_mqtt_client client, const char *topic)
 	Topic.cstring = (char *)topic;
 	int len = 0, pbuf_size;
 	unsigned char *pbuf = NULL;
+	MQTTV5Properties props = MQTTV5Properties_initializer;
+	MQTTV5Properties *unsub_props = NULL;
 
 	iot_os_mutex_lock(&c->mutex);
 
@@ -898,14 +1102,17 @@ int st_mqtt_unsubscribe(st_mqtt_client client, const char *topic)
 	}
 	iot_os_timer_count_ms(timer, c->command_timeout_ms);
 
-	pbuf_size = MQTTSerialize_unsubscribe_size(1, &Topic);
-	pbuf = (unsigned char *)malloc(pbuf_size);
+	if (c->mqtt_ver == MQTTV5_PROTOCOL_VERSION)
+		unsub_props = &props;
+
+	pbuf_size = MQTTV5Serialize_unsubscribe_size(unsub_props, 1, &Topic);
+	pbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_MQTT, pbuf_size);
 	if (pbuf == NULL) {
 		IOT_ERROR("buf malloc fail");
 		goto exit;
 	}
 
-	if ((len = MQTTSerialize_unsubscribe(pbuf, pbuf_size, 0, getNextPacketId(c), 1, &Topic)) <= 0) {
+	if ((len = MQTTV5Serialize_unsubscribe(pbuf, pbuf_size, 0, getNextPacketId(c), unsub_props, 1, &Topic)) <= 0) {
 		goto exit;
 	}
 
@@ -913,7 +1120,7 @@ int st_mqtt_unsubscribe(st_mqtt_client client, const char *topic)
 	if (rc) { // send the subscribe packet
 		goto exit;	  // there was a problem
 	}
-	free(pbuf);
+	iot_mem_free(IOT_MEM_TAG_MQTT, pbuf);
 	pbuf = NULL;
 
 	if (waitfor(c, UNSUBACK, timer) == UNSUBACK) {
@@ -923,7 +1130,7 @@ int st_mqtt_unsubscribe(st_mqtt_client client, const char *topic)
 			/* remove the subscription message handler associated with this topic, if there is one */
 			MQTTSetMessageHandler(client, topic, NULL, NULL);
 		}
-		free(c->readbuf);
+		iot_mem_free(IOT_MEM_TAG_MQTT, c->readbuf);
 		c->readbuf = NULL;
 	} else {
 		rc = E_ST_MQTT_FAILURE;
@@ -931,7 +1138,7 @@ int st_mqtt_unsubscribe(st_mqtt_client client, const char *topic)
 
 exit:
 	if (pbuf != NULL)
-		free(pbuf);
+		iot_mem_free(IOT_MEM_TAG_MQTT, pbuf);
 
 	if (timer != NULL)
 		iot_os_timer_destroy(&timer);
@@ -941,115 +1148,244 @@ exit:
 	return rc;
 }
 
-int st_mqtt_publish(st_mqtt_client client, st_mqtt_msg *msg)
+/* Send PUBLISH packets of msgs with one gathered write and wait for their acks.
+ * Unacked messages are sent again until retry count runs out.
+ */
+static int _iot_mqtt_publish(MQTTClient *c, st_mqtt_msg *msgs, int count, iot_os_timer timer)
 {
-	MQTTClient *c = client;
-	int rc = E_ST_MQTT_FAILURE;
-	iot_error_t iot_err;
-	iot_os_timer timer = NULL;
+	iot_net_iovec_t iov[st_mqtt_publish_max_msgs * 2];
+	MQTTString pub_topic[st_mqtt_publish_max_msgs];
+	unsigned short alias[st_mqtt_publish_max_msgs];
+	unsigned short msg_id[st_mqtt_publish_max_msgs];
+	unsigned char done[st_mqtt_publish_max_msgs];
+	int hdr_size[st_mqtt_publish_max_msgs];
+	MQTTV5Properties props = MQTTV5Properties_initializer;
+	MQTTV5Properties *pub_props = NULL;
 	MQTTString topic = MQTTString_initializer;
-	topic.cstring = (char *)msg->topic;
-	int len = 0, pbuf_size;
 	unsigned char *pbuf = NULL;
-	unsigned short msg_id = 0;
-
-	iot_os_mutex_lock(&c->mutex);
-
-	if (!c->isconnected) {
-		rc = E_ST_MQTT_DISCONNECTED;
-		goto exit;
-	}
+	unsigned char reason = ST_MQTT_RC_SUCCESS;
+	int pbuf_size, offset, iovcnt, len, known;
+	int refused = 0, alias_invalid = 0;
+	int retry = 0;
+	int rc = E_ST_MQTT_FAILURE;
+	int i, j;
 
-	iot_err = iot_os_timer_init(&timer);
-	if (iot_err) {
-		IOT_ERROR("fail to init timer");
-		goto exit;
-	}
-	iot_os_timer_count_ms(timer, c->command_timeout_ms);
+	if (c->mqtt_ver == MQTTV5_PROTOCOL_VERSION)
+		pub_props = &props;
 
-	if (msg->qos == st_mqtt_qos1 || msg->qos == st_mqtt_qos2) {
-		msg_id = getNextPacketId(c);
+	for (i = 0; i < count; i++) {
+		done[i] = 0;
+		msg_id[i] = 0;
+		if (msgs[i].qos == st_mqtt_qos1 || msgs[i].qos == st_mqtt_qos2)
+			msg_id[i] = getNextPacketId(c);
 	}
 
-	int retry = 0;
 	do {
 		iot_os_timer_count_ms(timer, c->command_timeout_ms);
-		if (retry)
+		if (retry) {
 			IOT_WARN("mqtt publish retry(%d)", retry);
-		retry++;
-#if defined(MQTT_PUB_NOCOPY)
-		/* First, send MQTT Connect header */
-		pbuf_size = MQTTSerialize_publish_size(msg->qos, topic, msg->payloadlen) - msg->payloadlen;
-		pbuf = (unsigned char *)malloc(pbuf_size);
-		if (pbuf == NULL) {
-			IOT_ERROR("buf malloc fail");
-			goto exit;
+			for (i = 0; i < count; i++) {
+				if (!done[i])
+					MQTT_STATS_ADD(c, publish_retry_cnt, 1);
+			}
 		}
-		len = MQTTSerialize_publish_header(pbuf, 0, msg->qos, msg->retained, msg_id,
-									topic, msg->payloadlen);
-		if (len <= 0 || (rc = sendPacket(c, pbuf, len, timer))) { // send the subscribe packet
-			goto exit;	  // there was a problem
+
+		/* Decide topic or alias of each message to know header sizes */
+		pbuf_size = 0;
+		for (i = 0; i < count; i++) {
+			if (done[i])
+				continue;
+
+			topic.cstring = (char *)msgs[i].topic;
+			pub_topic[i] = topic;
+			alias[i] = 0;
+			if (pub_props) {
+				alias[i] = _iot_mqtt_topic_alias(c, msgs[i].topic, &known);
+				props.present = alias[i] ? MQTTV5_HAS_TOPIC_ALIAS : 0;
+				props.topicAlias = alias[i];
+				/* retry sends the topic again, in case previous trial didn't reach server */
+				if (alias[i] && known && !retry)
+					pub_topic[i].cstring = "";
+			}
+
+			len = MQTTV5Serialize_publish_size(msgs[i].qos, pub_topic[i], pub_props, msgs[i].payloadlen);
+			if (c->max_packet_size && (unsigned int)len > c->max_packet_size) {
+				IOT_ERROR("publish size(%d) is over server maximum(%u)", len, c->max_packet_size);
+				c->reason_code = ST_MQTT_RC_PACKET_TOO_LARGE;
+				refused = 1;
+				msgs[i].refused = 1;
+				done[i] = 1;
+				continue;
+			}
+			hdr_size[i] = len - msgs[i].payloadlen;
+			pbuf_size += hdr_size[i];
 		}
-		free(pbuf);
-		/* Second, send application payload itself(no-copy) */
-		pbuf = msg->payload;
-		len = msg->payloadlen;
-		rc = sendPacket(c, pbuf, len, timer);
-		pbuf = NULL;
-		if (rc) { // send the subscribe packet
-			goto exit;	  // there was a problem
+
+		if (pbuf_size == 0) {
+			rc = 0;
+			break;
 		}
-#else
-		pbuf_size = MQTTSerialize_publish_size(msg->qos, topic, msg->payloadlen);
-		pbuf = (unsigned char *)malloc(pbuf_size);
+
+		/* Headers share one buffer and payloads are sent from where they are */
+		pbuf = (unsigned char *)iot_mem_malloc(IOT_MEM_TAG_MQTT, pbuf_size);
 		if (pbuf == NULL) {
 			IOT_ERROR("buf malloc fail");
+			rc = E_ST_MQTT_FAILURE;
 			goto exit;
 		}
-		len = MQTTSerialize_publish(pbuf, pbuf_size, 0, msg->qos, msg->retained, msg_id,
-									topic, (unsigned char *)msg->payload, msg->payloadlen);
 
-		if (len <= 0 || (rc = sendPacket(c, pbuf, len, timer))) { // send the subscribe packet
-			goto exit;	  // there was a problem
+		offset = 0;
+		iovcnt = 0;
+		for (i = 0; i < count; i++) {
+			if (done[i])
+				continue;
+
+			props.present = alias[i] ? MQTTV5_HAS_TOPIC_ALIAS : 0;
+			props.topicAlias = alias[i];
+			len = MQTTV5Serialize_publish_header(pbuf + offset, retry && msg_id[i], msgs[i].qos, msgs[i].retained,
+					msg_id[i], pub_topic[i], pub_props, msgs[i].payloadlen);
+			if (len != hdr_size[i]) {
+				rc = E_ST_MQTT_FAILURE;
+				goto exit;
+			}
+			iov[iovcnt].base = pbuf + offset;
+			iov[iovcnt++].len = len;
+			iov[iovcnt].base = msgs[i].payload;
+			iov[iovcnt++].len = msgs[i].payloadlen;
+			offset += len;
+			IOT_TRACE_MARK(msgs[i].trace_seq, IOT_TRACE_EVT_SERIALIZE);
 		}
-		free(pbuf);
+
+		rc = sendPacketv(c, iov, iovcnt, timer);
+		iot_mem_free(IOT_MEM_TAG_MQTT, pbuf);
 		pbuf = NULL;
-#endif
-		if (msg->qos == st_mqtt_qos1) {
-			if (waitfor(c, PUBACK, timer) == PUBACK) {
+		if (rc) {
+			goto exit;
+		}
+		retry++;
+
+		for (i = 0; i < count; i++) {
+			if (!done[i])
+				IOT_TRACE_MARK(msgs[i].trace_seq, IOT_TRACE_EVT_WRITE);
+		}
+
+		for (i = 0; i < count; i++) {
+			if (msgs[i].qos == st_mqtt_qos0) {
+				done[i] = 1;
+				IOT_TRACE_END(msgs[i].trace_seq, IOT_TRACE_STAGE_MAX);
+			}
+		}
+
+		/* Server acks in the order it has received */
+		for (i = 0; i < count && !rc; i++) {
+			while (!done[i]) {
+				int ack_type = (msgs[i].qos == st_mqtt_qos2) ? PUBCOMP : PUBACK;
 				unsigned short mypacketid;
 				unsigned char dup, type;
 
-				if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1) {
+				if (waitfor(c, ack_type, timer) != ack_type) {
+					if (iot_os_timer_isexpired(timer))
+						MQTT_STATS_ADD(c, puback_timeout_cnt, 1);
 					rc = E_ST_MQTT_FAILURE;
+					break;
 				}
+
+				reason = ST_MQTT_RC_SUCCESS;
+				len = MQTTV5Deserialize_ack(&type, &dup, &mypacketid,
+						(pub_props && ack_type == PUBACK) ? &reason : NULL, NULL,
+						c->readbuf, c->readbuf_size);
 				if (c->readbuf != NULL) {
-					free(c->readbuf);
+					iot_mem_free(IOT_MEM_TAG_MQTT, c->readbuf);
 					c->readbuf = NULL;
 				}
-			} else {
-				rc = E_ST_MQTT_FAILURE;
-			}
-		} else if (msg->qos == st_mqtt_qos2) {
-			if (waitfor(c, PUBCOMP, timer) == PUBCOMP) {
-				unsigned short mypacketid;
-				unsigned char dup, type;
-
-				if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1) {
+				if (len != 1) {
 					rc = E_ST_MQTT_FAILURE;
+					break;
+				}
+
+				for (j = 0; j < count; j++) {
+					if (done[j] || msg_id[j] != mypacketid)
+						continue;
+					done[j] = 1;
+					IOT_TRACE_MARK(msgs[j].trace_seq, IOT_TRACE_EVT_PUBACK);
+					IOT_TRACE_END(msgs[j].trace_seq, IOT_TRACE_EVT_TOTAL);
+					if (pub_props) {
+						c->reason_code = reason;
+						if (reason >= ST_MQTT_RC_UNSPECIFIED_ERROR) {
+							IOT_WARN("mqtt publish refused(0x%02x)", reason);
+							refused = 1;
+							msgs[j].refused = 1;
+						}
+						if (reason == ST_MQTT_RC_TOPIC_ALIAS_INVALID)
+							alias_invalid = 1;
+					}
 				}
-				free(c->readbuf);
-				c->readbuf = NULL;
-			} else {
-				rc = E_ST_MQTT_FAILURE;
 			}
 		}
 	} while (rc && retry < MQTT_PUBLISH_RETRY);
 
+	if (!rc && refused)
+		rc = E_ST_MQTT_REFUSED;
+
 exit:
+	/* server may not know the topic of alias assigned for these messages */
+	if (rc == E_ST_MQTT_FAILURE || alias_invalid)
+		_iot_mqtt_reset_topic_alias(c);
+
 	if (pbuf != NULL)
-		free(pbuf);
+		iot_mem_free(IOT_MEM_TAG_MQTT, pbuf);
+
+	return rc;
+}
+
+int st_mqtt_publish(st_mqtt_client client, st_mqtt_msg *msg)
+{
+	return st_mqtt_publish_many(client, msg, 1);
+}
+
+int st_mqtt_publish_many(st_mqtt_client client, st_mqtt_msg *msgs, int count)
+{
+	MQTTClient *c = client;
+	int rc = E_ST_MQTT_FAILURE;
+	int refused = 0;
+	iot_error_t iot_err;
+	iot_os_timer timer = NULL;
+	int batch, sent;
+
+	if (client == NULL || msgs == NULL || count <= 0)
+		return E_ST_MQTT_FAILURE;
+
+	for (sent = 0; sent < count; sent++)
+		msgs[sent].refused = 0;
+
+	iot_os_mutex_lock(&c->mutex);
+
+	if (!c->isconnected) {
+		rc = E_ST_MQTT_DISCONNECTED;
+		goto exit;
+	}
+
+	iot_err = iot_os_timer_init(&timer);
+	if (iot_err) {
+		IOT_ERROR("fail to init timer");
+		goto exit;
+	}
 
+	/* Server limits publishes waiting for ack with receive maximum */
+	batch = (c->receive_max < st_mqtt_publish_max_msgs) ? c->receive_max : st_mqtt_publish_max_msgs;
+	for (sent = 0; sent < count; sent += batch) {
+		rc = _iot_mqtt_publish(c, &msgs[sent], (count - sent < batch) ? count - sent : batch, timer);
+		if (rc == E_ST_MQTT_REFUSED) {
+			refused = 1;
+		} else if (rc) {
+			break;
+		}
+	}
+
+	if (!rc && refused)
+		rc = E_ST_MQTT_REFUSED;
+
+exit:
 	if (timer != NULL)
 		iot_os_timer_destroy(&timer);
 
@@ -1097,3 +1433,18 @@ exit:
 
 	return rc;
 }
+
+unsigned char st_mqtt_get_reason_code(st_mqtt_client client)
+{
+	MQTTClient *c = client;
+
+	return c->reason_code;
+}
+
+void st_mqtt_set_stats(st_mqtt_client client, st_mqtt_stats *stats)
+{
+	MQTTClient *c = client;
+
+	if (c)
+		c->stats = stats;
+}
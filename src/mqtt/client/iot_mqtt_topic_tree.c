@@ -0,0 +1,324 @@
+/* ***************************************************************************
+ *
+ * Copyright 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include "iot_mem.h"
+#include "iot_mqtt_topic_tree.h"
+
+#define MQTT_TOPIC_CHILDREN_INIT	4
+
+static int _compare_level(const MQTTTopicNode *node, const char *level, size_t len)
+{
+	if (node->level_len != len)
+		return (node->level_len < len) ? -1 : 1;
+
+	return memcmp(node->level, level, len);
+}
+
+/* returns index of matched child, or -(insert position) - 1 */
+static int _find_child(const MQTTTopicNode *node, const char *level, size_t len)
+{
+	int low = 0;
+	int high = node->child_count - 1;
+	int mid, cmp;
+
+	while (low <= high) {
+		mid = (low + high) / 2;
+		cmp = _compare_level(node->children[mid], level, len);
+		if (cmp == 0)
+			return mid;
+		else if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+
+	return -low - 1;
+}
+
+static MQTTTopicNode **_wildcard_link(MQTTTopicNode *node, const char *level, size_t len)
+{
+	if (len == 1 && level[0] == '+')
+		return &node->plus;
+	if (len == 1 && level[0] == '#')
+		return &node->hash;
+
+	return NULL;
+}
+
+static MQTTTopicNode *_new_node(const char *level, size_t len)
+{
+	MQTTTopicNode *node = iot_mem_malloc(IOT_MEM_TAG_MQTT, sizeof(MQTTTopicNode) + len);
+
+	if (node == NULL)
+		return NULL;
+
+	memset(node, '\0', sizeof(MQTTTopicNode));
+	if (len)
+		memcpy(node->level, level, len);
+	node->level_len = len;
+
+	return node;
+}
+
+static void _free_node(MQTTTopicNode *node)
+{
+	int i;
+
+	for (i = 0; i < node->child_count; i++)
+		_free_node(node->children[i]);
+	if (node->plus)
+		_free_node(node->plus);
+	if (node->hash)
+		_free_node(node->hash);
+
+	iot_mem_free(IOT_MEM_TAG_MQTT, node->children);
+	iot_mem_free(IOT_MEM_TAG_MQTT, node);
+}
+
+static int _is_empty(const MQTTTopicNode *node)
+{
+	return node->fp == NULL && node->child_count == 0 && node->plus == NULL && node->hash == NULL;
+}
+
+static MQTTTopicNode *_get_child(MQTTTopicNode *node, const char *level, size_t len)
+{
+	MQTTTopicNode **link = _wildcard_link(node, level, len);
+	MQTTTopicNode **children;
+	MQTTTopicNode *child;
+	int idx, size;
+
+	if (link) {
+		if (*link == NULL)
+			*link = _new_node(level, len);
+		return *link;
+	}
+
+	idx = _find_child(node, level, len);
+	if (idx >= 0)
+		return node->children[idx];
+	idx = -idx - 1;
+
+	if (node->child_count == node->child_size) {
+		size = node->child_size ? node->child_size * 2 : MQTT_TOPIC_CHILDREN_INIT;
+		children = iot_mem_realloc(IOT_MEM_TAG_MQTT, node->children,
+				node->child_size * sizeof(MQTTTopicNode *), size * sizeof(MQTTTopicNode *));
+		if (children == NULL)
+			return NULL;
+		node->children = children;
+		node->child_size = size;
+	}
+
+	child = _new_node(level, len);
+	if (child == NULL)
+		return NULL;
+
+	memmove(&node->children[idx + 1], &node->children[idx],
+			(node->child_count - idx) * sizeof(MQTTTopicNode *));
+	node->children[idx] = child;
+	node->child_count++;
+
+	return child;
+}
+
+/* Remove handler of filter below node and free emptied levels on the way back */
+static void _remove_filter(MQTTTopicNode *node, const char *filter, int *found)
+{
+	const char *sep = strchr(filter, '/');
+	size_t len = sep ? (size_t)(sep - filter) : strlen(filter);
+	MQTTTopicNode **link = _wildcard_link(node, filter, len);
+	MQTTTopicNode *child;
+	int idx = -1;
+
+	if (link) {
+		child = *link;
+	} else {
+		idx = _find_child(node, filter, len);
+		child = (idx >= 0) ? node->children[idx] : NULL;
+	}
+
+	if (child == NULL)
+		return;
+
+	if (sep) {
+		_remove_filter(child, sep + 1, found);
+	} else if (child->fp) {
+		child->fp = NULL;
+		child->userData = NULL;
+		*found = 1;
+	}
+
+	if (!_is_empty(child))
+		return;
+
+	if (link) {
+		*link = NULL;
+	} else {
+		memmove(&node->children[idx], &node->children[idx + 1],
+				(node->child_count - idx - 1) * sizeof(MQTTTopicNode *));
+		node->child_count--;
+	}
+	_free_node(child);
+}
+
+// '+' and '#' have to fill a whole level, and '#' can only be at the last level
+static int _is_valid_filter(const char *filter)
+{
+	const char *level = filter;
+	const char *p;
+
+	if (filter == NULL || *filter == '\0')
+		return 0;
+
+	for (p = filter; ; p++) {
+		if (*p == '/' || *p == '\0') {
+			if (p - level == 1 && *level == '#' && *p != '\0')
+				return 0;
+			if (*p == '\0')
+				break;
+			level = p + 1;
+		} else if ((*p == '+' || *p == '#') && (p != level || (p[1] != '/' && p[1] != '\0'))) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int MQTTTopicTree_add(MQTTTopicNode **root, const char *topicFilter, st_mqtt_msg_handler fp, void *userData)
+{
+	MQTTTopicNode *node;
+	const char *level;
+	const char *sep;
+	int found = 0;
+
+	if (root == NULL || fp == NULL || !_is_valid_filter(topicFilter))
+		return E_ST_MQTT_FAILURE;
+
+	if (*root == NULL) {
+		*root = _new_node(NULL, 0);
+		if (*root == NULL)
+			return E_ST_MQTT_FAILURE;
+	}
+
+	node = *root;
+	level = topicFilter;
+	do {
+		sep = strchr(level, '/');
+		node = _get_child(node, level, sep ? (size_t)(sep - level) : strlen(level));
+		if (node == NULL) {
+			/* free levels made for this filter */
+			_remove_filter(*root, topicFilter, &found);
+			if (_is_empty(*root))
+				MQTTTopicTree_free(root);
+			return E_ST_MQTT_FAILURE;
+		}
+		level = sep + 1;
+	} while (sep);
+
+	node->fp = fp;
+	node->userData = userData;
+
+	return 0;
+}
+
+int MQTTTopicTree_remove(MQTTTopicNode **root, const char *topicFilter)
+{
+	int found = 0;
+
+	if (root == NULL || *root == NULL || topicFilter == NULL)
+		return E_ST_MQTT_FAILURE;
+
+	_remove_filter(*root, topicFilter, &found);
+	if (_is_empty(*root))
+		MQTTTopicTree_free(root);
+
+	return found ? 0 : E_ST_MQTT_FAILURE;
+}
+
+static int _call_handler(MQTTTopicNode *node, st_mqtt_msg *message)
+{
+	if (node->fp == NULL)
+		return 0;
+
+	node->fp(message, node->userData);
+	return 1;
+}
+
+static int _match_level(MQTTTopicNode *node, const char *level, const char *end, int first, st_mqtt_msg *message);
+
+/* node matched a topic level, sep points the separator after that level or NULL at the last level */
+static int _match_next(MQTTTopicNode *node, const char *sep, const char *end, st_mqtt_msg *message)
+{
+	int count = 0;
+
+	if (sep == NULL) {
+		count += _call_handler(node, message);
+		/* "a/#" matches "a" also */
+		if (node->hash)
+			count += _call_handler(node->hash, message);
+		return count;
+	}
+
+	return _match_level(node, sep + 1, end, 0, message);
+}
+
+static int _match_level(MQTTTopicNode *node, const char *level, const char *end, int first, st_mqtt_msg *message)
+{
+	const char *sep = memchr(level, '/', end - level);
+	size_t len = sep ? (size_t)(sep - level) : (size_t)(end - level);
+	int count = 0;
+	int idx;
+
+	/* wildcards don't match topics beginning with '$' */
+	if (!(first && len > 0 && level[0] == '$')) {
+		if (node->hash)
+			count += _call_handler(node->hash, message);
+		if (node->plus)
+			count += _match_next(node->plus, sep, end, message);
+	}
+
+	if (node->child_count) {
+		idx = _find_child(node, level, len);
+		if (idx >= 0)
+			count += _match_next(node->children[idx], sep, end, message);
+	}
+
+	return count;
+}
+
+int MQTTTopicTree_deliver(MQTTTopicNode *root, st_mqtt_msg *message)
+{
+	const char *topic;
+
+	if (root == NULL || message == NULL || message->topic == NULL)
+		return 0;
+
+	topic = (const char *)message->topic;
+	return _match_level(root, topic, topic + message->topiclen, 1, message);
+}
+
+void MQTTTopicTree_free(MQTTTopicNode **root)
+{
+	if (root == NULL || *root == NULL)
+		return;
+
+	_free_node(*root);
+	*root = NULL;
+}
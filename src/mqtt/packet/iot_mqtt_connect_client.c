@@ -22,9 +22,10 @@
 /**
   * Determines the length of the MQTT connect packet that would be produced using the supplied connect options.
   * @param options the options to be used to build the connect packet
+  * @param connectProperties MQTT 5.0 properties, NULL for MQTT 3.1 & 3.1.1
   * @return the length of buffer needed to contain the serialized version of the packet
   */
-int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
+static int MQTTV5Serialize_connectLength(MQTTPacket_connectData* options, MQTTV5Properties* connectProperties)
 {
 	int len = 0;
 
@@ -32,12 +33,23 @@ int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
 
 	if (options->MQTTVersion == 3)
 		len = 12; /* variable depending on MQTT or MQIsdp */
-	else if (options->MQTTVersion == 4)
+	else if (options->MQTTVersion >= 4)
 		len = 10;
 
+	if (connectProperties)
+	{
+		int proplen = MQTTV5Properties_len(connectProperties);
+
+		len += MQTTPacket_len(proplen) - 1; /* properties & their length */
+	}
+
 	len += MQTTstrlen(options->clientID)+2;
 	if (options->willFlag)
+	{
 		len += MQTTstrlen(options->will.topicName)+2 + MQTTstrlen(options->will.message)+2;
+		if (connectProperties)
+			len += 1; /* empty will properties */
+	}
 	if (options->username.cstring || options->username.lenstring.data)
 		len += MQTTstrlen(options->username)+2;
 	if (options->password.cstring || options->password.lenstring.data)
@@ -47,15 +59,22 @@ int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
 	return len;
 }
 
+int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
+{
+	return MQTTV5Serialize_connectLength(options, NULL);
+}
+
 
 /**
   * Serializes the connect options into the buffer.
   * @param buf the buffer into which the packet will be serialized
   * @param len the length in bytes of the supplied buffer
   * @param options the options to be used to build the connect packet
+  * @param connectProperties MQTT 5.0 properties, NULL for MQTT 3.1 & 3.1.1
   * @return serialized length, or error if 0
   */
-int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData* options)
+int MQTTV5Serialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData* options,
+		MQTTV5Properties* connectProperties)
 {
 	unsigned char *ptr = buf;
 	MQTTHeader header = {0};
@@ -64,7 +83,7 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 	int rc = -1;
 
 	FUNC_ENTRY;
-	if (MQTTPacket_len(len = MQTTSerialize_connectLength(options)) > buflen)
+	if (MQTTPacket_len(len = MQTTV5Serialize_connectLength(options, connectProperties)) > buflen)
 	{
 		rc = MQTTPACKET_BUFFER_TOO_SHORT;
 		goto exit;
@@ -76,10 +95,10 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 
 	ptr += MQTTPacket_encode(ptr, len); /* write remaining length */
 
-	if (options->MQTTVersion == 4)
+	if (options->MQTTVersion >= 4)
 	{
 		writeCString(&ptr, "MQTT");
-		writeChar(&ptr, (char) 4);
+		writeChar(&ptr, (char) (connectProperties ? MQTTV5_PROTOCOL_VERSION : 4));
 	}
 	else
 	{
@@ -103,9 +122,13 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 
 	writeChar(&ptr, flags.all);
 	writeInt(&ptr, options->keepAliveInterval);
+	if (connectProperties)
+		MQTTV5Properties_write(&ptr, connectProperties);
 	writeMQTTString(&ptr, options->clientID);
 	if (options->willFlag)
 	{
+		if (connectProperties)
+			writeChar(&ptr, 0); /* no will properties */
 		writeMQTTString(&ptr, options->will.topicName);
 		writeMQTTString(&ptr, options->will.message);
 	}
@@ -120,20 +143,32 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 	return rc;
 }
 
+int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData* options)
+{
+	return MQTTV5Serialize_connect(buf, buflen, options, NULL);
+}
+
+int MQTTV5Serialize_connect_size(MQTTPacket_connectData* options, MQTTV5Properties* connectProperties)
+{
+	return MQTTPacket_len(MQTTV5Serialize_connectLength(options, connectProperties));
+}
+
 int MQTTSerialize_connect_size(MQTTPacket_connectData* options)
 {
-	return MQTTPacket_len(MQTTSerialize_connectLength(options));
+	return MQTTV5Serialize_connect_size(options, NULL);
 }
 
 /**
   * Deserializes the supplied (wire) buffer into connack data - return code
-  * @param sessionPresent the session present flag returned (only for MQTT 3.1.1)
-  * @param connack_rc returned integer value of the connack return code
+  * @param connackProperties MQTT 5.0 properties returned, NULL for MQTT 3.1.1
+  * @param sessionPresent the session present flag returned (only for MQTT 3.1.1 & 5.0)
+  * @param connack_rc returned integer value of the connack return code, or MQTT 5.0 reason code
   * @param buf the raw buffer data, of the correct length determined by the remaining length field
   * @param len the length in bytes of the data in the supplied buffer
   * @return error code.  1 is success, 0 is failure
   */
-int MQTTDeserialize_connack(unsigned char* sessionPresent, unsigned char* connack_rc, unsigned char* buf, int buflen)
+int MQTTV5Deserialize_connack(MQTTV5Properties* connackProperties, unsigned char* sessionPresent,
+		unsigned char* connack_rc, unsigned char* buf, int buflen)
 {
 	MQTTHeader header = {0};
 	unsigned char* curdata = buf;
@@ -147,7 +182,7 @@ int MQTTDeserialize_connack(unsigned char* sessionPresent, unsigned char* connac
 	if (header.bits.type != CONNACK)
 		goto exit;
 
-	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
 	enddata = curdata + mylen;
 	if (enddata - curdata < 2)
 		goto exit;
@@ -156,6 +191,55 @@ int MQTTDeserialize_connack(unsigned char* sessionPresent, unsigned char* connac
 	*sessionPresent = flags.bits.sessionpresent;
 	*connack_rc = readChar(&curdata);
 
+	if (connackProperties)
+	{
+		memset(connackProperties, 0, sizeof(MQTTV5Properties));
+		if (curdata < enddata && !MQTTV5Properties_read(connackProperties, &curdata, enddata))
+			goto exit;
+	}
+
+	rc = 1;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+int MQTTDeserialize_connack(unsigned char* sessionPresent, unsigned char* connack_rc, unsigned char* buf, int buflen)
+{
+	return MQTTV5Deserialize_connack(NULL, sessionPresent, connack_rc, buf, buflen);
+}
+
+/**
+  * Deserializes the supplied (wire) buffer into MQTT 5.0 disconnect data sent by server
+  * @param disconnectProperties properties returned, can be NULL
+  * @param reasonCode returned disconnect reason code, 0 when not given
+  * @param buf the raw buffer data, of the correct length determined by the remaining length field
+  * @param buflen the length in bytes of the data in the supplied buffer
+  * @return error code.  1 is success, 0 is failure
+  */
+int MQTTV5Deserialize_disconnect(MQTTV5Properties* disconnectProperties, unsigned char* reasonCode,
+		unsigned char* buf, int buflen)
+{
+	MQTTHeader header = {0};
+	unsigned char* curdata = buf;
+	unsigned char* enddata = NULL;
+	int rc = 0;
+	int mylen;
+
+	FUNC_ENTRY;
+	header.byte = readChar(&curdata);
+	if (header.bits.type != DISCONNECT)
+		goto exit;
+
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
+	enddata = curdata + mylen;
+
+	*reasonCode = 0;
+	if (curdata < enddata)
+		*reasonCode = readChar(&curdata);
+	if (curdata < enddata && !MQTTV5Properties_read(disconnectProperties, &curdata, enddata))
+		goto exit;
+
 	rc = 1;
 exit:
 	FUNC_EXIT_RC(rc);
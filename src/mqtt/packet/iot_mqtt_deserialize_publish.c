@@ -27,14 +27,16 @@
   * @param retained returned integer - the MQTT retained flag
   * @param packetid returned integer - the MQTT packet identifier
   * @param topicName returned MQTTString - the MQTT topic in the publish
+  * @param properties returned MQTT 5.0 properties, NULL for MQTT 3.1.1
   * @param payload returned byte buffer - the MQTT publish payload
   * @param payloadlen returned integer - the length of the MQTT payload
   * @param buf the raw buffer data, of the correct length determined by the remaining length field
   * @param buflen the length in bytes of the data in the supplied buffer
   * @return error code.  1 is success
   */
-int MQTTDeserialize_publish(unsigned char* dup, int* qos, unsigned char* retained, unsigned short* packetid, MQTTString* topicName,
-		unsigned char** payload, int* payloadlen, unsigned char* buf, int buflen)
+int MQTTV5Deserialize_publish(unsigned char* dup, int* qos, unsigned char* retained, unsigned short* packetid,
+		MQTTString* topicName, MQTTV5Properties* properties, unsigned char** payload, int* payloadlen,
+		unsigned char* buf, int buflen)
 {
 	MQTTHeader header = {0};
 	unsigned char* curdata = buf;
@@ -50,7 +52,7 @@ int MQTTDeserialize_publish(unsigned char* dup, int* qos, unsigned char* retaine
 	*qos = header.bits.qos;
 	*retained = header.bits.retain;
 
-	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
 	enddata = curdata + mylen;
 
 	if (!readMQTTLenString(topicName, &curdata, enddata) ||
@@ -60,6 +62,12 @@ int MQTTDeserialize_publish(unsigned char* dup, int* qos, unsigned char* retaine
 	if (*qos > 0)
 		*packetid = readInt(&curdata);
 
+	if (properties && !MQTTV5Properties_read(properties, &curdata, enddata))
+	{
+		rc = 0;
+		goto exit;
+	}
+
 	*payloadlen = enddata - curdata;
 	*payload = curdata;
 	rc = 1;
@@ -68,6 +76,12 @@ exit:
 	return rc;
 }
 
+int MQTTDeserialize_publish(unsigned char* dup, int* qos, unsigned char* retained, unsigned short* packetid, MQTTString* topicName,
+		unsigned char** payload, int* payloadlen, unsigned char* buf, int buflen)
+{
+	return MQTTV5Deserialize_publish(dup, qos, retained, packetid, topicName, NULL, payload, payloadlen, buf, buflen);
+}
+
 
 
 /**
@@ -75,11 +89,14 @@ exit:
   * @param packettype returned integer - the MQTT packet type
   * @param dup returned integer - the MQTT dup flag
   * @param packetid returned integer - the MQTT packet identifier
+  * @param reasonCode returned MQTT 5.0 reason code, 0 when not given. Can be NULL for MQTT 3.1.1
+  * @param properties returned MQTT 5.0 properties, can be NULL
   * @param buf the raw buffer data, of the correct length determined by the remaining length field
   * @param buflen the length in bytes of the data in the supplied buffer
   * @return error code.  1 is success, 0 is failure
   */
-int MQTTDeserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned short* packetid, unsigned char* buf, int buflen)
+int MQTTV5Deserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned short* packetid,
+		unsigned char* reasonCode, MQTTV5Properties* properties, unsigned char* buf, int buflen)
 {
 	MQTTHeader header = {0};
 	unsigned char* curdata = buf;
@@ -92,16 +109,33 @@ int MQTTDeserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned
 	*dup = header.bits.dup;
 	*packettype = header.bits.type;
 
-	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
 	enddata = curdata + mylen;
 
 	if (enddata - curdata < 2)
 		goto exit;
 	*packetid = readInt(&curdata);
 
+	if (reasonCode)
+	{
+		*reasonCode = 0;
+		if (curdata < enddata)
+			*reasonCode = readChar(&curdata);
+		if (curdata < enddata && !MQTTV5Properties_read(properties, &curdata, enddata))
+		{
+			rc = 0;
+			goto exit;
+		}
+	}
+
 	rc = 1;
 exit:
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
 
+int MQTTDeserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned short* packetid, unsigned char* buf, int buflen)
+{
+	return MQTTV5Deserialize_ack(packettype, dup, packetid, NULL, NULL, buf, buflen);
+}
+
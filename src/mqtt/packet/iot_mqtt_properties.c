@@ -0,0 +1,292 @@
+/* ***************************************************************************
+ *
+ * Copyright 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include "iot_mqtt_packet.h"
+#include "iot_mqtt_stacktrace.h"
+
+#include <string.h>
+
+static void writeInt4(unsigned char** pptr, unsigned int anInt)
+{
+	writeChar(pptr, (char)(anInt >> 24));
+	writeChar(pptr, (char)(anInt >> 16));
+	writeChar(pptr, (char)(anInt >> 8));
+	writeChar(pptr, (char)anInt);
+}
+
+static unsigned int readInt4(unsigned char** pptr)
+{
+	unsigned char* ptr = *pptr;
+	unsigned int value = ((unsigned int)ptr[0] << 24) | ((unsigned int)ptr[1] << 16) |
+			((unsigned int)ptr[2] << 8) | ptr[3];
+
+	*pptr += 4;
+	return value;
+}
+
+/**
+  * Reads a variable byte integer without going beyond enddata
+  * @return 1 if successful, 0 if not
+  */
+static int readVBI(unsigned char** pptr, unsigned char* enddata, int* value)
+{
+	int multiplier = 1;
+	int len = 0;
+	unsigned char c;
+
+	*value = 0;
+	do
+	{
+		if (*pptr >= enddata || ++len > 4)
+			return 0;
+		c = **pptr;
+		(*pptr)++;
+		*value += (c & 127) * multiplier;
+		multiplier *= 128;
+	} while ((c & 128) != 0);
+
+	return 1;
+}
+
+/**
+  * Determines the length of the properties, without their own length field
+  * @param properties the properties to be written
+  * @return the length of the properties
+  */
+int MQTTV5Properties_len(MQTTV5Properties* properties)
+{
+	int len = 0;
+
+	if (properties == NULL)
+		return 0;
+
+	if (properties->present & MQTTV5_HAS_SESSION_EXPIRY_INTERVAL)
+		len += 1 + 4;
+	if (properties->present & MQTTV5_HAS_MAXIMUM_PACKET_SIZE)
+		len += 1 + 4;
+	if (properties->present & MQTTV5_HAS_RECEIVE_MAXIMUM)
+		len += 1 + 2;
+	if (properties->present & MQTTV5_HAS_TOPIC_ALIAS_MAXIMUM)
+		len += 1 + 2;
+	if (properties->present & MQTTV5_HAS_TOPIC_ALIAS)
+		len += 1 + 2;
+	if (properties->present & MQTTV5_HAS_SERVER_KEEP_ALIVE)
+		len += 1 + 2;
+	if (properties->present & MQTTV5_HAS_MAXIMUM_QOS)
+		len += 1 + 1;
+
+	return len;
+}
+
+/**
+  * Writes the properties with their length field to an output buffer
+  * @param pptr pointer to the output buffer - incremented by the number of bytes used & returned
+  * @param properties the properties to be written
+  * @return the number of bytes written
+  */
+int MQTTV5Properties_write(unsigned char** pptr, MQTTV5Properties* properties)
+{
+	unsigned char* start = *pptr;
+	int len = MQTTV5Properties_len(properties);
+
+	*pptr += MQTTPacket_encode(*pptr, len);
+	if (len == 0)
+		goto exit;
+
+	if (properties->present & MQTTV5_HAS_SESSION_EXPIRY_INTERVAL)
+	{
+		writeChar(pptr, MQTTV5_PROPERTY_SESSION_EXPIRY_INTERVAL);
+		writeInt4(pptr, properties->sessionExpiryInterval);
+	}
+	if (properties->present & MQTTV5_HAS_MAXIMUM_PACKET_SIZE)
+	{
+		writeChar(pptr, MQTTV5_PROPERTY_MAXIMUM_PACKET_SIZE);
+		writeInt4(pptr, properties->maximumPacketSize);
+	}
+	if (properties->present & MQTTV5_HAS_RECEIVE_MAXIMUM)
+	{
+		writeChar(pptr, MQTTV5_PROPERTY_RECEIVE_MAXIMUM);
+		writeInt(pptr, properties->receiveMaximum);
+	}
+	if (properties->present & MQTTV5_HAS_TOPIC_ALIAS_MAXIMUM)
+	{
+		writeChar(pptr, MQTTV5_PROPERTY_TOPIC_ALIAS_MAXIMUM);
+		writeInt(pptr, properties->topicAliasMaximum);
+	}
+	if (properties->present & MQTTV5_HAS_TOPIC_ALIAS)
+	{
+		writeChar(pptr, MQTTV5_PROPERTY_TOPIC_ALIAS);
+		writeInt(pptr, properties->topicAlias);
+	}
+	if (properties->present & MQTTV5_HAS_SERVER_KEEP_ALIVE)
+	{
+		writeChar(pptr, MQTTV5_PROPERTY_SERVER_KEEP_ALIVE);
+		writeInt(pptr, properties->serverKeepAlive);
+	}
+	if (properties->present & MQTTV5_HAS_MAXIMUM_QOS)
+	{
+		writeChar(pptr, MQTTV5_PROPERTY_MAXIMUM_QOS);
+		writeChar(pptr, properties->maximumQoS);
+	}
+
+exit:
+	return *pptr - start;
+}
+
+/**
+  * Reads properties with their length field. Properties which aren't
+  * members of MQTTV5Properties are skipped.
+  * @param properties the properties read, can be NULL to skip all
+  * @param pptr pointer to the input buffer - incremented by the number of bytes used & returned
+  * @param enddata pointer to the end of the data: do not read beyond
+  * @return 1 if successful, 0 if not
+  */
+int MQTTV5Properties_read(MQTTV5Properties* properties, unsigned char** pptr, unsigned char* enddata)
+{
+	unsigned char* propend;
+	unsigned char id;
+	int len, value;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (properties)
+		memset(properties, 0, sizeof(MQTTV5Properties));
+
+	if (!readVBI(pptr, enddata, &len) || len > enddata - *pptr)
+		goto exit;
+	propend = *pptr + len;
+
+	while (*pptr < propend)
+	{
+		id = readChar(pptr);
+		switch (id)
+		{
+		case MQTTV5_PROPERTY_PAYLOAD_FORMAT_INDICATOR:
+		case MQTTV5_PROPERTY_REQUEST_PROBLEM_INFORMATION:
+		case MQTTV5_PROPERTY_REQUEST_RESPONSE_INFORMATION:
+		case MQTTV5_PROPERTY_MAXIMUM_QOS:
+		case MQTTV5_PROPERTY_RETAIN_AVAILABLE:
+		case MQTTV5_PROPERTY_WILDCARD_SUBSCRIPTION_AVAILABLE:
+		case MQTTV5_PROPERTY_SUBSCRIPTION_IDENTIFIER_AVAILABLE:
+		case MQTTV5_PROPERTY_SHARED_SUBSCRIPTION_AVAILABLE:
+			if (propend - *pptr < 1)
+				goto exit;
+			value = (unsigned char)readChar(pptr);
+			if (properties && id == MQTTV5_PROPERTY_MAXIMUM_QOS)
+			{
+				properties->maximumQoS = value;
+				properties->present |= MQTTV5_HAS_MAXIMUM_QOS;
+			}
+			break;
+
+		case MQTTV5_PROPERTY_SERVER_KEEP_ALIVE:
+		case MQTTV5_PROPERTY_RECEIVE_MAXIMUM:
+		case MQTTV5_PROPERTY_TOPIC_ALIAS_MAXIMUM:
+		case MQTTV5_PROPERTY_TOPIC_ALIAS:
+			if (propend - *pptr < 2)
+				goto exit;
+			value = readInt(pptr);
+			if (properties == NULL)
+				break;
+			if (id == MQTTV5_PROPERTY_SERVER_KEEP_ALIVE)
+			{
+				properties->serverKeepAlive = value;
+				properties->present |= MQTTV5_HAS_SERVER_KEEP_ALIVE;
+			}
+			else if (id == MQTTV5_PROPERTY_RECEIVE_MAXIMUM)
+			{
+				properties->receiveMaximum = value;
+				properties->present |= MQTTV5_HAS_RECEIVE_MAXIMUM;
+			}
+			else if (id == MQTTV5_PROPERTY_TOPIC_ALIAS_MAXIMUM)
+			{
+				properties->topicAliasMaximum = value;
+				properties->present |= MQTTV5_HAS_TOPIC_ALIAS_MAXIMUM;
+			}
+			else
+			{
+				properties->topicAlias = value;
+				properties->present |= MQTTV5_HAS_TOPIC_ALIAS;
+			}
+			break;
+
+		case MQTTV5_PROPERTY_MESSAGE_EXPIRY_INTERVAL:
+		case MQTTV5_PROPERTY_SESSION_EXPIRY_INTERVAL:
+		case MQTTV5_PROPERTY_WILL_DELAY_INTERVAL:
+		case MQTTV5_PROPERTY_MAXIMUM_PACKET_SIZE:
+		{
+			unsigned int value4;
+
+			if (propend - *pptr < 4)
+				goto exit;
+			value4 = readInt4(pptr);
+			if (properties && id == MQTTV5_PROPERTY_SESSION_EXPIRY_INTERVAL)
+			{
+				properties->sessionExpiryInterval = value4;
+				properties->present |= MQTTV5_HAS_SESSION_EXPIRY_INTERVAL;
+			}
+			else if (properties && id == MQTTV5_PROPERTY_MAXIMUM_PACKET_SIZE)
+			{
+				properties->maximumPacketSize = value4;
+				properties->present |= MQTTV5_HAS_MAXIMUM_PACKET_SIZE;
+			}
+			break;
+		}
+
+		case MQTTV5_PROPERTY_SUBSCRIPTION_IDENTIFIER:
+			if (!readVBI(pptr, propend, &value))
+				goto exit;
+			break;
+
+		case MQTTV5_PROPERTY_USER_PROPERTY:
+			/* string pair */
+			if (propend - *pptr < 2)
+				goto exit;
+			len = readInt(pptr);
+			if (propend - *pptr < len)
+				goto exit;
+			*pptr += len;
+			/* fall through */
+		case MQTTV5_PROPERTY_CONTENT_TYPE:
+		case MQTTV5_PROPERTY_RESPONSE_TOPIC:
+		case MQTTV5_PROPERTY_CORRELATION_DATA:
+		case MQTTV5_PROPERTY_ASSIGNED_CLIENT_IDENTIFIER:
+		case MQTTV5_PROPERTY_AUTHENTICATION_METHOD:
+		case MQTTV5_PROPERTY_AUTHENTICATION_DATA:
+		case MQTTV5_PROPERTY_RESPONSE_INFORMATION:
+		case MQTTV5_PROPERTY_SERVER_REFERENCE:
+		case MQTTV5_PROPERTY_REASON_STRING:
+			if (propend - *pptr < 2)
+				goto exit;
+			len = readInt(pptr);
+			if (propend - *pptr < len)
+				goto exit;
+			*pptr += len;
+			break;
+
+		default:
+			/* unknown property, can't know its length */
+			goto exit;
+		}
+	}
+
+	rc = 1;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
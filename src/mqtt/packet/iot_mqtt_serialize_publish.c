@@ -25,19 +25,31 @@
   * Determines the length of the MQTT publish packet that would be produced using the supplied parameters
   * @param qos the MQTT QoS of the publish (packetid is omitted for QoS 0)
   * @param topicName the topic name to be used in the publish  
+  * @param properties MQTT 5.0 properties, NULL for MQTT 3.1.1
   * @param payloadlen the length of the payload to be sent
   * @return the length of buffer needed to contain the serialized version of the packet
   */
-int MQTTSerialize_publishLength(int qos, MQTTString topicName, int payloadlen)
+static int MQTTV5Serialize_publishLength(int qos, MQTTString topicName, MQTTV5Properties* properties, int payloadlen)
 {
 	int len = 0;
 
 	len += 2 + MQTTstrlen(topicName) + payloadlen;
 	if (qos > 0)
 		len += 2; /* packetid */
+	if (properties)
+	{
+		int proplen = MQTTV5Properties_len(properties);
+
+		len += MQTTPacket_len(proplen) - 1; /* properties & their length */
+	}
 	return len;
 }
 
+int MQTTSerialize_publishLength(int qos, MQTTString topicName, int payloadlen)
+{
+	return MQTTV5Serialize_publishLength(qos, topicName, NULL, payloadlen);
+}
+
 
 /**
   * Serializes the supplied publish data into the supplied buffer, ready for sending
@@ -47,63 +59,62 @@ int MQTTSerialize_publishLength(int qos, MQTTString topicName, int payloadlen)
   * @param qos integer - the MQTT QoS value
   * @param retained integer - the MQTT retained flag
   * @param packetid integer - the MQTT packet identifier
-  * @param topicName MQTTString - the MQTT topic in the publish
+  * @param topicName MQTTString - the MQTT topic in the publish, can be empty with topic alias property
+  * @param properties MQTT 5.0 properties, NULL for MQTT 3.1.1
   * @param payload byte buffer - the MQTT publish payload
   * @param payloadlen integer - the length of the MQTT payload
   * @return the length of the serialized data.  <= 0 indicates error
   */
-int MQTTSerialize_publish(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
-		MQTTString topicName, unsigned char* payload, int payloadlen)
+int MQTTV5Serialize_publish(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained,
+		unsigned short packetid, MQTTString topicName, MQTTV5Properties* properties, unsigned char* payload, int payloadlen)
 {
-	unsigned char *ptr = buf;
-	MQTTHeader header = {0};
-	int rem_len = 0;
 	int rc = 0;
 
 	FUNC_ENTRY;
-	if (MQTTPacket_len(rem_len = MQTTSerialize_publishLength(qos, topicName, payloadlen)) > buflen)
+	if (MQTTV5Serialize_publish_size(qos, topicName, properties, payloadlen) > buflen)
 	{
 		rc = MQTTPACKET_BUFFER_TOO_SHORT;
 		goto exit;
 	}
 
-	header.bits.type = PUBLISH;
-	header.bits.dup = dup;
-	header.bits.qos = qos;
-	header.bits.retain = retained;
-	writeChar(&ptr, header.byte); /* write header */
-
-	ptr += MQTTPacket_encode(ptr, rem_len); /* write remaining length */;
-
-	writeMQTTString(&ptr, topicName);
-
-	if (qos > 0)
-		writeInt(&ptr, packetid);
-
-	memcpy(ptr, payload, payloadlen);
-	ptr += payloadlen;
-
-	rc = ptr - buf;
+	rc = MQTTV5Serialize_publish_header(buf, dup, qos, retained, packetid, topicName, properties, payloadlen);
+	memcpy(buf + rc, payload, payloadlen);
+	rc += payloadlen;
 
 exit:
 	FUNC_EXIT_RC(rc);
 	return rc;
 }
 
+int MQTTSerialize_publish(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
+		MQTTString topicName, unsigned char* payload, int payloadlen)
+{
+	return MQTTV5Serialize_publish(buf, buflen, dup, qos, retained, packetid, topicName, NULL, payload, payloadlen);
+}
+
+int MQTTV5Serialize_publish_size(int qos, MQTTString topicName, MQTTV5Properties* properties, int payloadlen)
+{
+	return MQTTPacket_len(MQTTV5Serialize_publishLength(qos, topicName, properties, payloadlen));
+}
+
 int MQTTSerialize_publish_size(int qos, MQTTString topicName, int payloadlen)
 {
-	return MQTTPacket_len(MQTTSerialize_publishLength(qos, topicName, payloadlen));
+	return MQTTV5Serialize_publish_size(qos, topicName, NULL, payloadlen);
 }
 
-int MQTTSerialize_publish_header(unsigned char* buf, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
-		MQTTString topicName, int payloadlen)
+/**
+  * Serializes the publish packet except its payload, so the payload can be sent without copy
+  * @return the length of the serialized data
+  */
+int MQTTV5Serialize_publish_header(unsigned char* buf, unsigned char dup, int qos, unsigned char retained,
+		unsigned short packetid, MQTTString topicName, MQTTV5Properties* properties, int payloadlen)
 {
 	unsigned char *ptr = buf;
 	MQTTHeader header = {0};
 	int rem_len = 0;
 	int rc = 0;
 
-	rem_len = MQTTSerialize_publishLength(qos, topicName, payloadlen);
+	rem_len = MQTTV5Serialize_publishLength(qos, topicName, properties, payloadlen);
 
 	header.bits.type = PUBLISH;
 	header.bits.dup = dup;
@@ -118,11 +129,20 @@ int MQTTSerialize_publish_header(unsigned char* buf, unsigned char dup, int qos,
 	if (qos > 0)
 		writeInt(&ptr, packetid);
 
+	if (properties)
+		MQTTV5Properties_write(&ptr, properties);
+
 	rc = ptr - buf;
 
 	return rc;
 }
 
+int MQTTSerialize_publish_header(unsigned char* buf, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
+		MQTTString topicName, int payloadlen)
+{
+	return MQTTV5Serialize_publish_header(buf, dup, qos, retained, packetid, topicName, NULL, payloadlen);
+}
+
 /**
   * Serializes the ack packet into the supplied buffer.
   * @param buf the buffer into which the packet will be serialized
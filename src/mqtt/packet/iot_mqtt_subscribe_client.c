@@ -23,18 +23,30 @@
   * Determines the length of the MQTT subscribe packet that would be produced using the supplied parameters
   * @param count the number of topic filter strings in topicFilters
   * @param topicFilters the array of topic filter strings to be used in the publish
+  * @param properties MQTT 5.0 properties, NULL for MQTT 3.1.1
   * @return the length of buffer needed to contain the serialized version of the packet
   */
-int MQTTSerialize_subscribeLength(int count, MQTTString topicFilters[])
+static int MQTTV5Serialize_subscribeLength(MQTTV5Properties* properties, int count, MQTTString topicFilters[])
 {
 	int i;
 	int len = 2; /* packetid */
 
+	if (properties)
+	{
+		int proplen = MQTTV5Properties_len(properties);
+
+		len += MQTTPacket_len(proplen) - 1; /* properties & their length */
+	}
 	for (i = 0; i < count; ++i)
 		len += 2 + MQTTstrlen(topicFilters[i]) + 1; /* length + topic + req_qos */
 	return len;
 }
 
+int MQTTSerialize_subscribeLength(int count, MQTTString topicFilters[])
+{
+	return MQTTV5Serialize_subscribeLength(NULL, count, topicFilters);
+}
+
 
 /**
   * Serializes the supplied subscribe data into the supplied buffer, ready for sending
@@ -42,13 +54,14 @@ int MQTTSerialize_subscribeLength(int count, MQTTString topicFilters[])
   * @param buflen the length in bytes of the supplied bufferr
   * @param dup integer - the MQTT dup flag
   * @param packetid integer - the MQTT packet identifier
+  * @param properties MQTT 5.0 properties, NULL for MQTT 3.1.1
   * @param count - number of members in the topicFilters and reqQos arrays
   * @param topicFilters - array of topic filter names
-  * @param requestedQoSs - array of requested QoS
+  * @param requestedQoSs - array of requested QoS, which are subscription options of MQTT 5.0
   * @return the length of the serialized data.  <= 0 indicates error
   */
-int MQTTSerialize_subscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid, int count,
-		MQTTString topicFilters[], int requestedQoSs[])
+int MQTTV5Serialize_subscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid,
+		MQTTV5Properties* properties, int count, MQTTString topicFilters[], int requestedQoSs[])
 {
 	unsigned char *ptr = buf;
 	MQTTHeader header = {0};
@@ -57,7 +70,7 @@ int MQTTSerialize_subscribe(unsigned char* buf, int buflen, unsigned char dup, u
 	int i = 0;
 
 	FUNC_ENTRY;
-	if (MQTTPacket_len(rem_len = MQTTSerialize_subscribeLength(count, topicFilters)) > buflen)
+	if (MQTTPacket_len(rem_len = MQTTV5Serialize_subscribeLength(properties, count, topicFilters)) > buflen)
 	{
 		rc = MQTTPACKET_BUFFER_TOO_SHORT;
 		goto exit;
@@ -73,6 +86,9 @@ int MQTTSerialize_subscribe(unsigned char* buf, int buflen, unsigned char dup, u
 
 	writeInt(&ptr, packetid);
 
+	if (properties)
+		MQTTV5Properties_write(&ptr, properties);
+
 	for (i = 0; i < count; ++i)
 	{
 		writeMQTTString(&ptr, topicFilters[i]);
@@ -85,22 +101,35 @@ exit:
 	return rc;
 }
 
+int MQTTSerialize_subscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid, int count,
+		MQTTString topicFilters[], int requestedQoSs[])
+{
+	return MQTTV5Serialize_subscribe(buf, buflen, dup, packetid, NULL, count, topicFilters, requestedQoSs);
+}
+
+int MQTTV5Serialize_subscribe_size(MQTTV5Properties* properties, int count, MQTTString topicFilters[])
+{
+	return MQTTPacket_len(MQTTV5Serialize_subscribeLength(properties, count, topicFilters));
+}
+
 int MQTTSerialize_subscribe_size(int count, MQTTString topicFilters[])
 {
-	return MQTTPacket_len(MQTTSerialize_subscribeLength(count, topicFilters));
+	return MQTTV5Serialize_subscribe_size(NULL, count, topicFilters);
 }
 
 /**
   * Deserializes the supplied (wire) buffer into suback data
   * @param packetid returned integer - the MQTT packet identifier
+  * @param properties returned MQTT 5.0 properties, NULL for MQTT 3.1.1
   * @param maxcount - the maximum number of members allowed in the grantedQoSs array
   * @param count returned integer - number of members in the grantedQoSs array
-  * @param grantedQoSs returned array of integers - the granted qualities of service
+  * @param grantedQoSs returned array of integers - the granted qualities of service, or reason codes of MQTT 5.0
   * @param buf the raw buffer data, of the correct length determined by the remaining length field
   * @param buflen the length in bytes of the data in the supplied buffer
   * @return error code.  1 is success, 0 is failure
   */
-int MQTTDeserialize_suback(unsigned short* packetid, int maxcount, int* count, int grantedQoSs[], unsigned char* buf, int buflen)
+int MQTTV5Deserialize_suback(unsigned short* packetid, MQTTV5Properties* properties, int maxcount, int* count,
+		int grantedQoSs[], unsigned char* buf, int buflen)
 {
 	MQTTHeader header = {0};
 	unsigned char* curdata = buf;
@@ -113,22 +142,28 @@ int MQTTDeserialize_suback(unsigned short* packetid, int maxcount, int* count, i
 	if (header.bits.type != SUBACK)
 		goto exit;
 
-	curdata += (rc = MQTTPacket_decodeBuf(curdata, &mylen)); /* read remaining length */
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
 	enddata = curdata + mylen;
 	if (enddata - curdata < 2)
 		goto exit;
 
 	*packetid = readInt(&curdata);
 
+	if (properties && !MQTTV5Properties_read(properties, &curdata, enddata))
+	{
+		rc = 0;
+		goto exit;
+	}
+
 	*count = 0;
 	while (curdata < enddata)
 	{
-		if (*count > maxcount)
+		if (*count >= maxcount)
 		{
 			rc = -1;
 			goto exit;
 		}
-		grantedQoSs[(*count)++] = readChar(&curdata);
+		grantedQoSs[(*count)++] = (unsigned char)readChar(&curdata);
 	}
 
 	rc = 1;
@@ -137,4 +172,9 @@ exit:
 	return rc;
 }
 
+int MQTTDeserialize_suback(unsigned short* packetid, int maxcount, int* count, int grantedQoSs[], unsigned char* buf, int buflen)
+{
+	return MQTTV5Deserialize_suback(packetid, NULL, maxcount, count, grantedQoSs, buf, buflen);
+}
+
 
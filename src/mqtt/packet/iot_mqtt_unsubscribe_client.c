@@ -23,18 +23,30 @@
   * Determines the length of the MQTT unsubscribe packet that would be produced using the supplied parameters
   * @param count the number of topic filter strings in topicFilters
   * @param topicFilters the array of topic filter strings to be used in the publish
+  * @param properties MQTT 5.0 properties, NULL for MQTT 3.1.1
   * @return the length of buffer needed to contain the serialized version of the packet
   */
-int MQTTSerialize_unsubscribeLength(int count, MQTTString topicFilters[])
+static int MQTTV5Serialize_unsubscribeLength(MQTTV5Properties* properties, int count, MQTTString topicFilters[])
 {
 	int i;
 	int len = 2; /* packetid */
 
+	if (properties)
+	{
+		int proplen = MQTTV5Properties_len(properties);
+
+		len += MQTTPacket_len(proplen) - 1; /* properties & their length */
+	}
 	for (i = 0; i < count; ++i)
 		len += 2 + MQTTstrlen(topicFilters[i]); /* length + topic*/
 	return len;
 }
 
+int MQTTSerialize_unsubscribeLength(int count, MQTTString topicFilters[])
+{
+	return MQTTV5Serialize_unsubscribeLength(NULL, count, topicFilters);
+}
+
 
 /**
   * Serializes the supplied unsubscribe data into the supplied buffer, ready for sending
@@ -42,12 +54,13 @@ int MQTTSerialize_unsubscribeLength(int count, MQTTString topicFilters[])
   * @param buflen the length in bytes of the data in the supplied buffer
   * @param dup integer - the MQTT dup flag
   * @param packetid integer - the MQTT packet identifier
+  * @param properties MQTT 5.0 properties, NULL for MQTT 3.1.1
   * @param count - number of members in the topicFilters array
   * @param topicFilters - array of topic filter names
   * @return the length of the serialized data.  <= 0 indicates error
   */
-int MQTTSerialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid,
-		int count, MQTTString topicFilters[])
+int MQTTV5Serialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid,
+		MQTTV5Properties* properties, int count, MQTTString topicFilters[])
 {
 	unsigned char *ptr = buf;
 	MQTTHeader header = {0};
@@ -56,7 +69,7 @@ int MQTTSerialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup,
 	int i = 0;
 
 	FUNC_ENTRY;
-	if (MQTTPacket_len(rem_len = MQTTSerialize_unsubscribeLength(count, topicFilters)) > buflen)
+	if (MQTTPacket_len(rem_len = MQTTV5Serialize_unsubscribeLength(properties, count, topicFilters)) > buflen)
 	{
 		rc = MQTTPACKET_BUFFER_TOO_SHORT;
 		goto exit;
@@ -72,6 +85,9 @@ int MQTTSerialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup,
 
 	writeInt(&ptr, packetid);
 
+	if (properties)
+		MQTTV5Properties_write(&ptr, properties);
+
 	for (i = 0; i < count; ++i)
 		writeMQTTString(&ptr, topicFilters[i]);
 
@@ -81,9 +97,20 @@ exit:
 	return rc;
 }
 
+int MQTTSerialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid,
+		int count, MQTTString topicFilters[])
+{
+	return MQTTV5Serialize_unsubscribe(buf, buflen, dup, packetid, NULL, count, topicFilters);
+}
+
+int MQTTV5Serialize_unsubscribe_size(MQTTV5Properties* properties, int count, MQTTString topicFilters[])
+{
+	return MQTTPacket_len(MQTTV5Serialize_unsubscribeLength(properties, count, topicFilters));
+}
+
 int MQTTSerialize_unsubscribe_size(int count, MQTTString topicFilters[])
 {
-	return MQTTPacket_len(MQTTSerialize_unsubscribeLength(count, topicFilters));
+	return MQTTV5Serialize_unsubscribe_size(NULL, count, topicFilters);
 }
 
 /**
@@ -327,10 +327,30 @@ uint16_t iot_bsp_wifi_get_scan_result(iot_wifi_scan_result_t *scan_result)
 	uint16_t i;
 	wifi_scan_config_t config;
 	wifi_ap_record_t *ap_list = NULL;
+	wifi_mode_t mode = WIFI_MODE_NULL;
+	esp_err_t ret;
 
 	memset(&config, 0x0, sizeof(config));
 
-	esp_wifi_scan_start(&config, true);
+	/* soft-ap has no station to scan with, add it while scanning */
+	esp_wifi_get_mode(&mode);
+	if(mode == WIFI_MODE_AP) {
+		if(esp_wifi_set_mode(WIFI_MODE_APSTA) != ESP_OK) {
+			IOT_ERROR("failed to switch to APSTA for scan");
+			return 0;
+		}
+	}
+
+	ret = esp_wifi_scan_start(&config, true);
+
+	if(mode == WIFI_MODE_AP)
+		esp_wifi_set_mode(WIFI_MODE_AP);
+
+	if(ret != ESP_OK) {
+		IOT_ERROR("failed to start scan : %d", ret);
+		return 0;
+	}
+
 	if(esp_wifi_scan_get_ap_num(&ap_num) == ESP_OK) {
 		ap_num = (ap_num > IOT_WIFI_MAX_SCAN_RESULT) ?
 				IOT_WIFI_MAX_SCAN_RESULT : ap_num;
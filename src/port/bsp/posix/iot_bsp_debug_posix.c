@@ -21,6 +21,7 @@
 #include <stdarg.h>
 
 #include "iot_bsp_debug.h"
+#include "iot_os_util.h"
 
 #define COLOR_RED "\x1b[31m"
 #define COLOR_GREEN "\x1b[32m"
@@ -58,39 +59,43 @@ void iot_bsp_debug(iot_debug_level_t level, const char* tag, const char* fmt, ..
 	}
 }
 
-static unsigned int _iot_bsp_debug_get_free_heap_size(void)
-{
-	return 0;
-}
-
-static unsigned int _iot_bsp_debug_get_minimum_free_heap_size(void)
-{
-	return 0;
-}
-
-static unsigned int _iot_bsp_debug_get_maximum_heap_size(void)
-{
-	return 0;
-}
+#define STACK_INFO_MAX 8
 
+/*
+ * Heap figures come from the os port accounting of iot_os_malloc.
+ * CU/PU are current and peak usage, PP is the peak since the previous
+ * check, so each lifecycle phase gets its own peak, and FR estimates
+ * fragmentation of the process heap. Stack lines are printed only if
+ * CONFIG_STDK_DEBUG_MEMORY_CHECK paints the thread stacks.
+ */
 void iot_bsp_debug_check_heap(const char* tag, const char* func, const int line, const char* fmt, ...)
 {
 	static int count = 0;
 	char buf[BUF_SIZE] = {0,};
+	iot_os_heap_info_t heap;
+	iot_os_stack_info_t stack[STACK_INFO_MAX];
+	int stack_cnt;
 	int ret;
+	int i;
 	va_list va;
 
 	va_start(va, fmt);
 	ret = vsnprintf(buf, BUF_SIZE, fmt, va);
 	va_end(va);
 
+	iot_os_heap_get_info(&heap, 1);
+
 	if (count == 0) {
-		iot_bsp_debug(IOT_DEBUG_LEVEL_WARN, tag, "%s(%d) > [MEMCHK][%d] Heap total size : %d", func, line, count, _iot_bsp_debug_get_maximum_heap_size());
+		iot_bsp_debug(IOT_DEBUG_LEVEL_WARN, tag, "%s(%d) > [MEMCHK][%d] Heap arena size : %u", func, line, count, (unsigned int)heap.arena);
 	}
 
-	iot_bsp_debug(IOT_DEBUG_LEVEL_WARN, tag, "%s(%d) > [MEMCHK][%d][%s] CU:%d, CR:%d, PU:%d, PR:%d", func, line, ++count, buf,
-			_iot_bsp_debug_get_maximum_heap_size() - _iot_bsp_debug_get_free_heap_size(),
-			_iot_bsp_debug_get_free_heap_size(),
-			_iot_bsp_debug_get_maximum_heap_size() - _iot_bsp_debug_get_minimum_free_heap_size(),
-			_iot_bsp_debug_get_minimum_free_heap_size());
+	iot_bsp_debug(IOT_DEBUG_LEVEL_WARN, tag, "%s(%d) > [MEMCHK][%d][%s] CU:%u, PU:%u, PP:%u, FR:%u%%", func, line, ++count, buf,
+			(unsigned int)heap.used, (unsigned int)heap.peak, (unsigned int)heap.phase_peak, heap.frag);
+
+	stack_cnt = iot_os_thread_get_stack_info(stack, STACK_INFO_MAX);
+	for (i = 0; i < stack_cnt; i++) {
+		iot_bsp_debug(IOT_DEBUG_LEVEL_WARN, tag, "%s(%d) > [MEMCHK][%d][%s] ST:%s %u/%u%s", func, line, count, buf,
+				stack[i].name, (unsigned int)stack[i].high_water, (unsigned int)stack[i].stack_size,
+				(stack[i].high_water > stack[i].stack_size) ? " OVER" : "");
+	}
 }
@@ -0,0 +1,485 @@
+/* ***************************************************************************
+ *
+ * Copyright 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#if defined(CONFIG_STDK_IOT_CORE_NET_MBEDTLS) && !defined(CONFIG_STDK_IOT_CORE_OS_SUPPORT_POSIX)
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "iot_main.h"
+#include "iot_util.h"
+#include "iot_debug.h"
+
+#if defined(LWIP_IPV6) && !LWIP_IPV6
+#define IOT_NET_NO_IPV6
+#endif
+
+#define IOT_NET_RESOLVE_CACHE_NUM	2
+#define IOT_NET_RESOLVE_HOST_LEN	64
+#define IOT_NET_RESOLVE_DONE(i)		(1u << (i))	/* lookup for cache entry i is done */
+#define IOT_NET_RESOLVE_STACK_SIZE	(1024*4)
+#define IOT_NET_RESOLVE_PRIORITY	4
+
+struct iot_net_resolve_entry {
+	char host[IOT_NET_RESOLVE_HOST_LEN];
+	iot_net_addr_t addr[IOT_NET_ADDR_MAX];
+	int addr_cnt;
+	iot_os_timer expiry;	/* addresses are fresh until this expires */
+	bool pending;		/* lookup task is running for this entry */
+	unsigned int waiters;	/* callers waiting for the lookup task */
+	unsigned int used;	/* last use, to replace least recently used one */
+};
+
+static struct iot_net_resolve_entry resolve_cache[IOT_NET_RESOLVE_CACHE_NUM];
+static iot_util_once_mutex_t resolve_mutex;
+static iot_os_eventgroup *resolve_event;
+static unsigned int resolve_used;
+static bool resolve_ready;	/* protected by resolve_mutex */
+
+/* Looks up host, IPv6 and IPv4 addresses are interleaved starting with IPv6 */
+static int _iot_net_resolve_lookup(const char *host, iot_net_addr_t *addr, int addr_max)
+{
+	struct addrinfo hints;
+	struct addrinfo *res = NULL;
+	struct addrinfo *ai;
+	iot_net_addr_t v4[IOT_NET_ADDR_MAX];
+#if !defined(IOT_NET_NO_IPV6)
+	iot_net_addr_t v6[IOT_NET_ADDR_MAX];
+#endif
+	int v4_cnt = 0, v6_cnt = 0;
+	int addr_cnt = 0;
+	int ret;
+	int i;
+
+	memset(&hints, 0, sizeof(hints));
+#if defined(IOT_NET_NO_IPV6)
+	hints.ai_family = AF_INET;
+#else
+	hints.ai_family = AF_UNSPEC;
+#endif
+	hints.ai_socktype = SOCK_STREAM;
+
+	ret = getaddrinfo(host, NULL, &hints, &res);
+	if (ret || res == NULL) {
+		IOT_ERROR("getaddrinfo(%s) = %d", host, ret);
+		return 0;
+	}
+
+	for (ai = res; ai != NULL; ai = ai->ai_next) {
+		if (ai->ai_family == AF_INET && v4_cnt < IOT_NET_ADDR_MAX) {
+			v4[v4_cnt].family = AF_INET;
+			memcpy(v4[v4_cnt++].ip, &((struct sockaddr_in *)ai->ai_addr)->sin_addr, 4);
+		}
+#if !defined(IOT_NET_NO_IPV6)
+		else if (ai->ai_family == AF_INET6 && v6_cnt < IOT_NET_ADDR_MAX) {
+			v6[v6_cnt].family = AF_INET6;
+			memcpy(v6[v6_cnt++].ip, &((struct sockaddr_in6 *)ai->ai_addr)->sin6_addr, 16);
+		}
+#endif
+	}
+	freeaddrinfo(res);
+
+	for (i = 0; addr_cnt < addr_max && (i < v4_cnt || i < v6_cnt); i++) {
+#if !defined(IOT_NET_NO_IPV6)
+		if (i < v6_cnt)
+			addr[addr_cnt++] = v6[i];
+#endif
+		if (i < v4_cnt && addr_cnt < addr_max)
+			addr[addr_cnt++] = v4[i];
+	}
+
+	return addr_cnt;
+}
+
+/* Locks the cache, setting it up on first use */
+static bool _iot_net_resolve_lock(void)
+{
+	int i;
+
+	if (iot_util_once_mutex_lock(&resolve_mutex) != IOT_ERROR_NONE)
+		return false;
+
+	if (resolve_ready)
+		return true;
+
+	resolve_event = iot_os_eventgroup_create();
+	if (resolve_event == NULL)
+		goto fail;
+
+	for (i = 0; i < IOT_NET_RESOLVE_CACHE_NUM; i++) {
+		if (iot_os_timer_init(&resolve_cache[i].expiry) != IOT_ERROR_NONE) {
+			while (i--)
+				iot_os_timer_destroy(&resolve_cache[i].expiry);
+			iot_os_eventgroup_delete(resolve_event);
+			resolve_event = NULL;
+			goto fail;
+		}
+	}
+
+	resolve_ready = true;
+	return true;
+
+fail:
+	iot_util_once_mutex_unlock(&resolve_mutex);
+	return false;
+}
+
+static void _iot_net_resolve_unlock(void)
+{
+	iot_util_once_mutex_unlock(&resolve_mutex);
+}
+
+/* Returns the entry of host, or replaces least recently used one. Called with lock */
+static struct iot_net_resolve_entry *_iot_net_resolve_entry(const char *host)
+{
+	struct iot_net_resolve_entry *entry = NULL;
+	int i;
+
+	for (i = 0; i < IOT_NET_RESOLVE_CACHE_NUM; i++) {
+		if (!strcmp(resolve_cache[i].host, host)) {
+			entry = &resolve_cache[i];
+			goto exit;
+		}
+	}
+
+	for (i = 0; i < IOT_NET_RESOLVE_CACHE_NUM; i++) {
+		if (resolve_cache[i].pending)
+			continue;
+		if (entry == NULL || resolve_cache[i].used < entry->used)
+			entry = &resolve_cache[i];
+	}
+
+	if (entry) {
+		strcpy(entry->host, host);
+		entry->addr_cnt = 0;
+	}
+
+exit:
+	if (entry)
+		entry->used = ++resolve_used;
+	return entry;
+}
+
+static void _iot_net_resolve_store(struct iot_net_resolve_entry *entry, iot_net_addr_t *addr, int addr_cnt)
+{
+	if (addr_cnt <= 0)
+		return;
+
+	memcpy(entry->addr, addr, addr_cnt * sizeof(iot_net_addr_t));
+	entry->addr_cnt = addr_cnt;
+	iot_os_timer_count_ms(entry->expiry, IOT_NET_RESOLVE_TTL_MS);
+}
+
+static int _iot_net_resolve_copy(struct iot_net_resolve_entry *entry, iot_net_addr_t *addr, int addr_max)
+{
+	int addr_cnt = (entry->addr_cnt < addr_max) ? entry->addr_cnt : addr_max;
+
+	memcpy(addr, entry->addr, addr_cnt * sizeof(iot_net_addr_t));
+	return addr_cnt;
+}
+
+static void _iot_net_resolve_task(struct iot_net_resolve_entry *entry)
+{
+	char host[IOT_NET_RESOLVE_HOST_LEN];
+	iot_net_addr_t addr[IOT_NET_ADDR_MAX];
+	int addr_cnt;
+
+	_iot_net_resolve_lock();
+	strcpy(host, entry->host);
+	_iot_net_resolve_unlock();
+
+	addr_cnt = _iot_net_resolve_lookup(host, addr, IOT_NET_ADDR_MAX);
+
+	_iot_net_resolve_lock();
+	/* entry is invalidated while looking up */
+	if (!strcmp(entry->host, host))
+		_iot_net_resolve_store(entry, addr, addr_cnt);
+	entry->pending = false;
+	/* under the lock, so the bit can't outlive a lookup started after this */
+	if (entry->waiters)
+		iot_os_eventgroup_set_bits(resolve_event, IOT_NET_RESOLVE_DONE(entry - resolve_cache));
+	_iot_net_resolve_unlock();
+
+	iot_os_thread_delete(NULL);
+}
+
+int iot_net_resolve(const char *host, iot_net_addr_t *addr, int addr_max, unsigned int timeout_ms)
+{
+	struct iot_net_resolve_entry *entry;
+	iot_net_addr_t found[IOT_NET_ADDR_MAX];
+	iot_os_timer timer = NULL;
+	unsigned int done_bit;
+	int addr_cnt = 0;
+
+	if (host == NULL || addr == NULL || addr_max <= 0) {
+		IOT_ERROR("invalid args");
+		return 0;
+	}
+
+	if (strlen(host) >= IOT_NET_RESOLVE_HOST_LEN || !_iot_net_resolve_lock())
+		return _iot_net_resolve_lookup(host, addr, addr_max);
+
+	entry = _iot_net_resolve_entry(host);
+	if (entry == NULL) {
+		_iot_net_resolve_unlock();
+		return _iot_net_resolve_lookup(host, addr, addr_max);
+	}
+
+	if (entry->addr_cnt && !iot_os_timer_isexpired(entry->expiry)) {
+		addr_cnt = _iot_net_resolve_copy(entry, addr, addr_max);
+		_iot_net_resolve_unlock();
+		return addr_cnt;
+	}
+
+	done_bit = IOT_NET_RESOLVE_DONE(entry - resolve_cache);
+	if (!entry->pending) {
+		entry->pending = true;
+		if (iot_os_thread_create(_iot_net_resolve_task, "iot_resolve_task",
+				IOT_NET_RESOLVE_STACK_SIZE, (void *)entry,
+				IOT_NET_RESOLVE_PRIORITY, NULL) != IOT_OS_TRUE) {
+			IOT_WARN("fail to create resolve task");
+			entry->pending = false;
+			_iot_net_resolve_unlock();
+
+			addr_cnt = _iot_net_resolve_lookup(host, found, IOT_NET_ADDR_MAX);
+			_iot_net_resolve_lock();
+			if (!strcmp(entry->host, host))
+				_iot_net_resolve_store(entry, found, addr_cnt);
+			_iot_net_resolve_unlock();
+			addr_cnt = (addr_cnt < addr_max) ? addr_cnt : addr_max;
+			memcpy(addr, found, addr_cnt * sizeof(iot_net_addr_t));
+			return addr_cnt;
+		}
+		/* task can't finish before this as it needs the lock */
+		iot_os_eventgroup_clear_bits(resolve_event, done_bit);
+	}
+
+	/* expired addresses are likely still valid, don't wait for refresh */
+	if (entry->addr_cnt) {
+		IOT_INFO("refreshing %s in background", host);
+		addr_cnt = _iot_net_resolve_copy(entry, addr, addr_max);
+		_iot_net_resolve_unlock();
+		return addr_cnt;
+	}
+	_iot_net_resolve_unlock();
+
+	if (iot_os_timer_init(&timer) != IOT_ERROR_NONE) {
+		IOT_ERROR("fail to init timer");
+		return 0;
+	}
+	iot_os_timer_count_ms(timer, timeout_ms);
+
+	_iot_net_resolve_lock();
+	entry->waiters++;
+	while (entry->pending && !strcmp(entry->host, host) &&
+			!iot_os_timer_isexpired(timer)) {
+		_iot_net_resolve_unlock();
+		/* bit isn't cleared, every waiter of this entry sees it */
+		iot_os_eventgroup_wait_bits(resolve_event, done_bit,
+				false, false, iot_os_timer_left_ms(timer));
+		_iot_net_resolve_lock();
+	}
+	entry->waiters--;
+
+	if (entry->pending && !strcmp(entry->host, host)) {
+		IOT_ERROR("resolving %s timeout", host);
+	} else {
+		if (!strcmp(entry->host, host))
+			addr_cnt = _iot_net_resolve_copy(entry, addr, addr_max);
+		/* some ports consume the event on wake up, hand it on */
+		if (entry->waiters)
+			iot_os_eventgroup_set_bits(resolve_event, done_bit);
+	}
+	_iot_net_resolve_unlock();
+
+	iot_os_timer_destroy(&timer);
+	return addr_cnt;
+}
+
+void iot_net_resolve_invalidate(const char *host)
+{
+	int i;
+
+	if (host == NULL || !_iot_net_resolve_lock())
+		return;
+
+	for (i = 0; i < IOT_NET_RESOLVE_CACHE_NUM; i++) {
+		if (!strcmp(resolve_cache[i].host, host)) {
+			resolve_cache[i].host[0] = '\0';
+			resolve_cache[i].addr_cnt = 0;
+		}
+	}
+	_iot_net_resolve_unlock();
+}
+
+static int _iot_net_connect_start(iot_net_addr_t *addr, int port)
+{
+	struct sockaddr_in sin;
+#if !defined(IOT_NET_NO_IPV6)
+	struct sockaddr_in6 sin6;
+#endif
+	struct sockaddr *sa;
+	socklen_t sa_len;
+	int sock;
+	int flags;
+
+	if (addr->family == AF_INET) {
+		memset(&sin, 0, sizeof(sin));
+		sin.sin_family = AF_INET;
+		sin.sin_port = htons(port);
+		memcpy(&sin.sin_addr, addr->ip, 4);
+		sa = (struct sockaddr *)&sin;
+		sa_len = sizeof(sin);
+	}
+#if !defined(IOT_NET_NO_IPV6)
+	else if (addr->family == AF_INET6) {
+		memset(&sin6, 0, sizeof(sin6));
+		sin6.sin6_family = AF_INET6;
+		sin6.sin6_port = htons(port);
+		memcpy(&sin6.sin6_addr, addr->ip, 16);
+		sa = (struct sockaddr *)&sin6;
+		sa_len = sizeof(sin6);
+	}
+#endif
+	else {
+		return -1;
+	}
+
+	sock = socket(addr->family, SOCK_STREAM, 0);
+	if (sock < 0)
+		return -1;
+
+	flags = fcntl(sock, F_GETFL, 0);
+	if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+		close(sock);
+		return -1;
+	}
+
+	if (connect(sock, sa, sa_len) < 0 && errno != EINPROGRESS) {
+		IOT_WARN("connect error %d (family %d)", errno, addr->family);
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+int iot_net_connect_addr(iot_net_addr_t *addr, int addr_cnt, int port, unsigned int timeout_ms)
+{
+	int sock[IOT_NET_ADDR_MAX];
+	iot_os_timer timer = NULL;
+	iot_os_timer attempt = NULL;
+	struct timeval tv;
+	fd_set wfdset;
+	unsigned int wait_ms;
+	int started = 0, alive = 0;
+	int connected = -1;
+	int sock_err;
+	socklen_t err_len;
+	int fd_max;
+	int i;
+
+	if (addr == NULL || addr_cnt <= 0) {
+		IOT_ERROR("no address to connect");
+		return -1;
+	}
+	if (addr_cnt > IOT_NET_ADDR_MAX)
+		addr_cnt = IOT_NET_ADDR_MAX;
+
+	if (iot_os_timer_init(&timer) != IOT_ERROR_NONE ||
+			iot_os_timer_init(&attempt) != IOT_ERROR_NONE) {
+		IOT_ERROR("fail to init timer");
+		goto exit;
+	}
+	iot_os_timer_count_ms(timer, timeout_ms);
+
+	while (connected < 0 && !iot_os_timer_isexpired(timer)) {
+		/* next address when previous ones are slow or all failed */
+		if (started < addr_cnt && (alive == 0 || iot_os_timer_isexpired(attempt))) {
+			sock[started] = _iot_net_connect_start(&addr[started], port);
+			if (sock[started] >= 0)
+				alive++;
+			started++;
+			iot_os_timer_count_ms(attempt, IOT_NET_CONNECT_ATTEMPT_DELAY_MS);
+			continue;
+		}
+
+		if (alive == 0)
+			break;
+
+		FD_ZERO(&wfdset);
+		fd_max = -1;
+		for (i = 0; i < started; i++) {
+			if (sock[i] < 0)
+				continue;
+			FD_SET(sock[i], &wfdset);
+			if (sock[i] > fd_max)
+				fd_max = sock[i];
+		}
+
+		wait_ms = iot_os_timer_left_ms(timer);
+		if (started < addr_cnt && iot_os_timer_left_ms(attempt) < wait_ms)
+			wait_ms = iot_os_timer_left_ms(attempt);
+		tv.tv_sec = wait_ms / 1000;
+		tv.tv_usec = (wait_ms % 1000) * 1000;
+
+		if (select(fd_max + 1, NULL, &wfdset, NULL, &tv) <= 0)
+			continue;
+
+		for (i = 0; i < started && connected < 0; i++) {
+			if (sock[i] < 0 || !FD_ISSET(sock[i], &wfdset))
+				continue;
+
+			sock_err = 0;
+			err_len = sizeof(sock_err);
+			getsockopt(sock[i], SOL_SOCKET, SO_ERROR, &sock_err, &err_len);
+			if (sock_err == 0) {
+				connected = i;
+			} else {
+				IOT_WARN("connect error %d (family %d)", sock_err, addr[i].family);
+				close(sock[i]);
+				sock[i] = -1;
+				alive--;
+			}
+		}
+	}
+
+	for (i = 0; i < started; i++) {
+		if (i != connected && sock[i] >= 0)
+			close(sock[i]);
+	}
+
+exit:
+	if (timer)
+		iot_os_timer_destroy(&timer);
+	if (attempt)
+		iot_os_timer_destroy(&attempt);
+
+	return (connected < 0) ? -1 : sock[connected];
+}
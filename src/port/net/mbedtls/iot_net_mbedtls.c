@@ -27,6 +27,8 @@
 #include "iot_main.h"
 #include "iot_debug.h"
 
+#define IOT_NET_MBEDTLS_CONNECT_TIMEOUT_MS	(30 * 1000)
+
 static iot_error_t _iot_net_check_interface(iot_net_interface_t *net)
 {
 	if (net == NULL) {
@@ -103,16 +105,21 @@ static void _iot_net_cleanup_platform_context(iot_net_interface_t *net)
 	mbedtls_x509_crt_free(&net->context.cacert);
 	mbedtls_ssl_free(&net->context.ssl);
 	mbedtls_ssl_config_free(&net->context.conf);
-	mbedtls_ctr_drbg_free(&net->context.ctr_drbg);
-	mbedtls_entropy_free(&net->context.entropy);
+
+	if (net->context.writev_buf) {
+		free(net->context.writev_buf);
+		net->context.writev_buf = NULL;
+	}
 }
 
 static iot_error_t _iot_net_tls_connect(iot_net_interface_t *net)
 {
 	iot_error_t err;
-	const char *pers = "iot_net_mbedtls";
-	char port[5] = {0};
+	iot_net_addr_t resolved[IOT_NET_ADDR_MAX];
+	iot_net_addr_t *addr = net->connection.addr;
+	int addr_cnt = net->connection.addr_cnt;
 	unsigned int flags;
+	int nodelay = 1;
 	int ret;
 
 	err = _iot_net_check_interface(net);
@@ -124,16 +131,6 @@ static iot_error_t _iot_net_tls_connect(iot_net_interface_t *net)
 	mbedtls_ssl_init(&net->context.ssl);
 	mbedtls_ssl_config_init(&net->context.conf);
 	mbedtls_x509_crt_init(&net->context.cacert);
-	mbedtls_ctr_drbg_init(&net->context.ctr_drbg);
-
-	mbedtls_entropy_init(&net->context.entropy);
-	ret = mbedtls_ctr_drbg_seed(&net->context.ctr_drbg,
-				mbedtls_entropy_func, &net->context.entropy,
-				(const unsigned char *)pers, strlen((char *)pers));
-	if (ret) {
-		IOT_ERROR("mbedtls_ctr_drbg_seed = -0x%04X", -ret);
-		goto exit;
-	}
 
 	if ((net->connection.ca_cert == NULL) ||
 	    (net->connection.ca_cert_len == 0)) {
@@ -164,14 +161,30 @@ static iot_error_t _iot_net_tls_connect(iot_net_interface_t *net)
 
 	IOT_DEBUG("Connecting to %s:%d", net->connection.url, net->connection.port);
 
-	snprintf(port, sizeof(port), "%d", net->connection.port);
-	ret = mbedtls_net_connect(&net->context.server_fd,
-				net->connection.url, port,
-				MBEDTLS_NET_PROTO_TCP);
-	if (ret) {
-		IOT_ERROR("mbedtls_net_connect = -0x%04X", -ret);
+	if (addr_cnt == 0) {
+		addr = resolved;
+		addr_cnt = iot_net_resolve(net->connection.url, resolved,
+					IOT_NET_ADDR_MAX, IOT_NET_MBEDTLS_CONNECT_TIMEOUT_MS);
+		if (addr_cnt == 0) {
+			ret = IOT_ERROR_NET_CONNECT;
+			goto exit;
+		}
+	}
+
+	net->context.server_fd.fd = iot_net_connect_addr(addr, addr_cnt,
+				net->connection.port, IOT_NET_MBEDTLS_CONNECT_TIMEOUT_MS);
+	if (net->context.server_fd.fd < 0) {
+		IOT_ERROR("iot_net_connect_addr failed");
+		/* cached addresses may have been changed */
+		if (addr == resolved)
+			iot_net_resolve_invalidate(net->connection.url);
+		ret = IOT_ERROR_NET_CONNECT;
 		goto exit;
 	}
+	mbedtls_net_set_block(&net->context.server_fd);
+
+	/* writes are whole MQTT packets, don't hold them for coalescing */
+	setsockopt(net->context.server_fd.fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
 
 	ret = mbedtls_ssl_config_defaults(&net->context.conf,
 				MBEDTLS_SSL_IS_CLIENT,
@@ -184,8 +197,8 @@ static iot_error_t _iot_net_tls_connect(iot_net_interface_t *net)
 
 	mbedtls_ssl_conf_authmode(&net->context.conf, MBEDTLS_SSL_VERIFY_REQUIRED);
 	mbedtls_ssl_conf_ca_chain(&net->context.conf, &net->context.cacert, NULL);
-	mbedtls_ssl_conf_rng(&net->context.conf, mbedtls_ctr_drbg_random,
-				&net->context.ctr_drbg);
+	/* reconnects reuse the DRBG seeded once in the crypto layer */
+	mbedtls_ssl_conf_rng(&net->context.conf, iot_crypto_rng, NULL);
 
 	ret = mbedtls_ssl_setup(&net->context.ssl, &net->context.conf);
 	if (ret) {
@@ -300,6 +313,83 @@ static int _iot_net_tls_write(iot_net_interface_t *net,
 	return (int)ret;
 }
 
+static int _iot_net_tls_write_all(iot_net_interface_t *net,
+		unsigned char *buf, int len, iot_os_timer timer)
+{
+	int sent = 0;
+	int ret;
+
+	while (sent < len) {
+		ret = _iot_net_tls_write(net, buf + sent, len - sent, timer);
+		if (ret <= 0) {
+			return sent ? sent : ret;
+		}
+		sent += ret;
+	}
+
+	return sent;
+}
+
+static int _iot_net_tls_writev(iot_net_interface_t *net,
+		iot_net_iovec_t *iov, int iovcnt, iot_os_timer timer)
+{
+	unsigned char *buf;
+	int limit;
+	int staged = 0;
+	int written = 0;
+	int ret = 0;
+	int i;
+
+	if (_iot_net_check_interface(net)) {
+		return 0;
+	}
+
+	/* mbedtls_ssl_write() makes one record per call, so small buffers
+	 * are gathered to be encrypted together
+	 */
+	if (net->context.writev_buf == NULL) {
+		net->context.writev_buf = malloc(IOT_NET_WRITEV_BUF_SIZE);
+	}
+	buf = net->context.writev_buf;
+	limit = buf ? IOT_NET_WRITEV_BUF_SIZE : 0;
+
+	for (i = 0; i <= iovcnt; i++) {
+		if (staged && ((i == iovcnt) || (iov[i].len >= limit) ||
+				(staged + iov[i].len > limit))) {
+			ret = _iot_net_tls_write_all(net, buf, staged, timer);
+			if (ret != staged) {
+				goto exit;
+			}
+			written += staged;
+			staged = 0;
+		}
+
+		if (i == iovcnt) {
+			break;
+		}
+
+		if (iov[i].len >= limit) {
+			ret = _iot_net_tls_write_all(net, iov[i].base, iov[i].len, timer);
+			if (ret != iov[i].len) {
+				goto exit;
+			}
+			written += ret;
+		} else {
+			memcpy(buf + staged, iov[i].base, iov[i].len);
+			staged += iov[i].len;
+		}
+	}
+
+	return written;
+
+exit:
+	if (ret > 0) {
+		written += ret;
+	}
+
+	return written ? written : ret;
+}
+
 iot_error_t iot_net_init(iot_net_interface_t *net)
 {
 	iot_error_t err;
@@ -314,6 +404,7 @@ iot_error_t iot_net_init(iot_net_interface_t *net)
 	net->select = _iot_net_select;
 	net->read = _iot_net_tls_read;
 	net->write = _iot_net_tls_write;
+	net->writev = _iot_net_tls_writev;
 	net->show_status = _iot_net_show_status;
 
 	return IOT_ERROR_NONE;
@@ -22,8 +22,6 @@
 #include "mbedtls/platform.h"
 #include "mbedtls/net.h"
 #include "mbedtls/ssl.h"
-#include "mbedtls/entropy.h"
-#include "mbedtls/ctr_drbg.h"
 #include "mbedtls/certs.h"
 #include "mbedtls/x509.h"
 
@@ -37,10 +35,9 @@ typedef struct iot_net_platform_context {
 	mbedtls_ssl_context ssl;
 	mbedtls_ssl_config conf;
 
-	mbedtls_entropy_context entropy;
-	mbedtls_ctr_drbg_context ctr_drbg;
-
 	mbedtls_x509_crt cacert;
+
+	unsigned char *writev_buf;
 } iot_net_platform_context_t;
 
 #ifdef __cplusplus
@@ -19,6 +19,8 @@
 #include <string.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/time.h>
 #include <errno.h>
 #include <unistd.h>
@@ -26,12 +28,27 @@
 #include "iot_main.h"
 #include "iot_debug.h"
 
+#define IOT_NET_SSL_CONNECT_TIMEOUT_MS	(30 * 1000)
+
+/* OpenSSL 1.1 and later has it as a macro and initializes itself */
+#if !defined(SSL_library_init)
 void __SSL_library_init(void)
 {
 	return;
 }
 
 void SSL_library_init(void) __attribute__((weak, alias("__SSL_library_init")));
+#endif
+
+/* Writes are non-blocking and may time out with a record pending. The caller
+ * continues from the bytes that were reported written, with another pointer
+ * (writev re-stages them in writev_buf), which OpenSSL refuses as a bad write
+ * retry unless the buffer is allowed to move. Partial write makes SSL_write
+ * report each record as soon as it is out, so the count is exact.
+ */
+#if defined(SSL_MODE_ENABLE_PARTIAL_WRITE) && defined(SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER)
+#define IOT_NET_SSL_WRITE_MODE	(SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER)
+#endif
 
 static void _iot_net_show_status(iot_net_interface_t *n)
 {
@@ -71,96 +88,155 @@ static int _iot_net_select(iot_net_interface_t *n, unsigned int timeout_ms)
 	return ret;
 }
 
+/* Waits until socket is ready for what SSL wants, within the timer.
+ * Returns 1 if ready, 0 if the timer expired and -1 for socket error
+ */
+static int _iot_net_ssl_wait(iot_net_interface_t *n, int ssl_error, iot_os_timer timer)
+{
+	struct timeval timeout;
+	fd_set fdset;
+	unsigned int left_ms;
+	int ret;
+
+	do {
+		FD_ZERO(&fdset);
+		FD_SET(n->context.socket, &fdset);
+
+		left_ms = iot_os_timer_left_ms(timer);
+		timeout.tv_sec = left_ms / 1000;
+		timeout.tv_usec = (left_ms % 1000) * 1000;
+
+		if (ssl_error == SSL_ERROR_WANT_WRITE)
+			ret = select(n->context.socket + 1, NULL, &fdset, NULL, &timeout);
+		else
+			ret = select(n->context.socket + 1, &fdset, NULL, NULL, &timeout);
+	} while (ret < 0 && errno == EINTR);
+
+	return (ret > 0) ? 1 : ret;
+}
+
 static int _iot_net_ssl_read(iot_net_interface_t *n, unsigned char *buffer, int len, iot_os_timer timer)
 {
 	int recvLen = 0, rc = 0;
+	int error;
 
-	struct timeval timeout;
-	fd_set fdset;
+	do {
+		rc = SSL_read(n->context.ssl, buffer + recvLen, len - recvLen);
+		if (rc > 0) {
+			recvLen += rc;
+			continue;
+		}
 
-	FD_ZERO(&fdset);
-	FD_SET(n->context.socket, &fdset);
+		error = SSL_get_error(n->context.ssl, rc);
+		if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+			IOT_WARN("recv error %d %d %d\n", rc, error, errno);
+			recvLen = -1;
+			break;
+		}
 
-	timeout.tv_sec =  iot_os_timer_left_ms(timer) / 1000;
-	timeout.tv_usec = (iot_os_timer_left_ms(timer) % 1000) * 1000;
-
-	if (SSL_pending(n->context.ssl) > 0 || select(n->context.socket + 1, &fdset, NULL, NULL, &timeout) > 0) {
-		do {
-			rc = SSL_read(n->context.ssl, buffer + recvLen, len - recvLen);
-
-			if (rc > 0)
-				recvLen += rc;
-			else if (rc <= 0) {
-				int error = 0;
-				error = SSL_get_error(n->context.ssl, rc);
-				IOT_WARN("recv error %d %d %d\n", rc, error, errno);
-				switch (error) {
-				case SSL_ERROR_WANT_READ:
-					if (errno == ECONNABORTED) {
-						recvLen = -1;
-						goto exit;
-					}
-					iot_os_delay(1000);
-					break;
-				default:
-					recvLen = -1;
-					goto exit;
-				}
-			}
-		} while (recvLen < len && !iot_os_timer_isexpired(timer));
-	}
+		/* rest of record hasn't arrived yet */
+		rc = _iot_net_ssl_wait(n, error, timer);
+		if (rc < 0) {
+			IOT_WARN("recv wait error %d\n", errno);
+			recvLen = -1;
+			break;
+		} else if (rc == 0) {
+			break;
+		}
+	} while (recvLen < len && !iot_os_timer_isexpired(timer));
 
-exit:
 	return recvLen;
 }
 
 static int _iot_net_ssl_write(iot_net_interface_t *n, unsigned char *buffer, int len, iot_os_timer timer)
 {
-	int sentLen = 0, rc = 0, ret = 0;
+	int sentLen = 0, rc = 0;
+	int error;
+
+	do {
+		rc = SSL_write(n->context.ssl, buffer + sentLen, len - sentLen);
+		if (rc > 0) {
+			sentLen += rc;
+			continue;
+		}
 
-	struct timeval timeout;
-	fd_set fdset;
+		error = SSL_get_error(n->context.ssl, rc);
+		if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+			IOT_WARN("write error %d %d %d\n", rc, error, errno);
+			sentLen = -1;
+			break;
+		}
 
-	FD_ZERO(&fdset);
-	FD_SET(n->context.socket, &fdset);
+		/* SSL_write has to be called again with same arguments */
+		rc = _iot_net_ssl_wait(n, error, timer);
+		if (rc <= 0) {
+			struct timeval tv;
+			int sock_err = 0;
+			socklen_t err_len = sizeof(sock_err);
+
+			getsockopt(n->context.socket, SOL_SOCKET, SO_ERROR, &sock_err, &err_len);
+			gettimeofday(&tv, NULL);
+			IOT_ERROR("[%ld] Socket Network Error write_sel_rc %d sock_err %d errno %d select expired=%u",
+				tv.tv_sec, rc, sock_err, errno, iot_os_timer_left_ms(timer));
+			if (rc < 0 || sentLen == 0)
+				sentLen = rc;
+			break;
+		}
+	} while (sentLen < len && !iot_os_timer_isexpired(timer));
 
-	timeout.tv_sec =  iot_os_timer_left_ms(timer) / 1000;
-	timeout.tv_usec = (iot_os_timer_left_ms(timer) % 1000) * 1000;
-
-	errno = 0;
-	ret = select(n->context.socket + 1, NULL, &fdset, NULL, &timeout);
-
-	if (ret <= 0) {
-		struct timeval tv;
-		int error = 0;
-		long expired = 0;
-		socklen_t err_len = sizeof(error);
-		expired = iot_os_timer_left_ms(timer);
-		getsockopt(n->context.socket, SOL_SOCKET, SO_ERROR, &error, &err_len);
-		gettimeofday(&tv, NULL);
-		IOT_ERROR("[%ld] Socket Network Error write_sel_rc %d sock_err %d errno %d select expired=%ld",
-			tv.tv_sec, ret, error, errno, expired);
-		return ret;
-	}
+	return sentLen;
+}
+
+static int _iot_net_ssl_writev(iot_net_interface_t *n, iot_net_iovec_t *iov, int iovcnt, iot_os_timer timer)
+{
+	unsigned char *buf;
+	int limit;
+	int staged = 0, sentLen = 0, rc = 0;
+	int i;
+
+	/* SSL_write() makes one record per call, so small buffers are gathered
+	 * to be encrypted together
+	 */
+	if (n->context.writev_buf == NULL)
+		n->context.writev_buf = malloc(IOT_NET_WRITEV_BUF_SIZE);
+	buf = n->context.writev_buf;
+	limit = buf ? IOT_NET_WRITEV_BUF_SIZE : 0;
+
+	for (i = 0; i <= iovcnt; i++) {
+		if (staged && ((i == iovcnt) || (iov[i].len >= limit) ||
+				(staged + iov[i].len > limit))) {
+			rc = _iot_net_ssl_write(n, buf, staged, timer);
+			if (rc != staged)
+				goto partial;
+			sentLen += staged;
+			staged = 0;
+		}
 
-	if (FD_ISSET(n->context.socket, &fdset)) {
-		do {
-			rc = SSL_write(n->context.ssl, buffer + sentLen, len - sentLen);
-
-			if (rc > 0) {
-				sentLen += rc;
-			}
-			else if (rc <= 0){
-				int error = 0;
-				error = SSL_get_error(n->context.ssl, rc);
-				IOT_WARN("write error %d %d %d\n", rc, error, errno);
-				sentLen = -1;
-				break;
-			}
-		} while (sentLen < len && !iot_os_timer_isexpired(timer));
+		if (i == iovcnt)
+			break;
+
+		if (iov[i].len >= limit) {
+			rc = _iot_net_ssl_write(n, iov[i].base, iov[i].len, timer);
+			if (rc != iov[i].len)
+				goto partial;
+			sentLen += rc;
+		} else {
+			memcpy(buf + staged, iov[i].base, iov[i].len);
+			staged += iov[i].len;
+		}
 	}
 
 	return sentLen;
+
+partial:
+	/* Only what was written is reported, wherever it ends in the iovs.
+	 * The caller restarts there and the record left pending in SSL is
+	 * written again from the same bytes, now at another address.
+	 */
+	if (rc > 0)
+		return sentLen + rc;
+
+	return sentLen ? sentLen : rc;
 }
 
 static void _iot_net_ssl_disconnect(iot_net_interface_t *n)
@@ -169,23 +245,36 @@ static void _iot_net_ssl_disconnect(iot_net_interface_t *n)
 	SSL_free(n->context.ssl);
 	SSL_CTX_free(n->context.ctx);
 	n->context.read_count = 0;
+
+	if (n->context.writev_buf) {
+		free(n->context.writev_buf);
+		n->context.writev_buf = NULL;
+	}
 }
 
 static iot_error_t _iot_net_ssl_connect(iot_net_interface_t *n)
 {
-	struct sockaddr_in sAddr;
+	iot_net_addr_t resolved[IOT_NET_ADDR_MAX];
+	iot_net_addr_t *addr = n->connection.addr;
+	int addr_cnt = n->connection.addr_cnt;
 	int retVal = -1;
-	struct hostent *ipAddress;
-#if defined(LWIP_SO_SNDRCVTIMEO_NONSTANDARD) && (LWIP_SO_SNDRCVTIMEO_NONSTANDARD == 0)
-	struct timeval sock_timeout = {30, 0};
-#else
-	unsigned int sock_timeout = 30* 1000;
-#endif
+	iot_os_timer timer = NULL;
 
 	SSL_library_init();
 
-	if ((ipAddress = gethostbyname(n->connection.url)) == 0) {
-		goto exit;
+	if (iot_os_timer_init(&timer) != IOT_ERROR_NONE) {
+		IOT_ERROR("fail to init timer");
+		return IOT_ERROR_NET_CONNECT;
+	}
+	iot_os_timer_count_ms(timer, IOT_NET_SSL_CONNECT_TIMEOUT_MS);
+
+	if (addr_cnt == 0) {
+		addr = resolved;
+		addr_cnt = iot_net_resolve(n->connection.url, resolved, IOT_NET_ADDR_MAX, iot_os_timer_left_ms(timer));
+		if (addr_cnt == 0) {
+			retVal = IOT_ERROR_NET_CONNECT;
+			goto exit;
+		}
 	}
 
 	n->context.ctx = SSL_CTX_new(n->context.method);
@@ -193,6 +282,9 @@ static iot_error_t _iot_net_ssl_connect(iot_net_interface_t *n)
 	if (!n->context.ctx) {
 		goto exit;
 	}
+#if defined(IOT_NET_SSL_WRITE_MODE)
+	SSL_CTX_set_mode(n->context.ctx, IOT_NET_SSL_WRITE_MODE);
+#endif
 #if defined(CONFIG_STDK_IOT_CORE_OS_SUPPORT_FREERTOS) || defined(CONFIG_STDK_IOT_CORE_OS_SUPPORT_TIZENRT)
 	if (n->connection.ca_cert) {
 		retVal = SSL_CTX_load_verify_buffer(n->context.ctx, n->connection.ca_cert, n->connection.ca_cert_len);
@@ -222,18 +314,17 @@ static iot_error_t _iot_net_ssl_connect(iot_net_interface_t *n)
 		SSL_CTX_set_verify(n->context.ctx, SSL_VERIFY_NONE, NULL);
 	}
 
-	sAddr.sin_family = AF_INET;
-	sAddr.sin_addr.s_addr = ((struct in_addr *)(ipAddress->h_addr))->s_addr;
-	sAddr.sin_port = htons(n->connection.port);
-
-	if ((n->context.socket = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+	n->context.socket = iot_net_connect_addr(addr, addr_cnt, n->connection.port, iot_os_timer_left_ms(timer));
+	if (n->context.socket < 0) {
+		/* cached addresses may have been changed */
+		if (addr == resolved)
+			iot_net_resolve_invalidate(n->connection.url);
 		goto exit1;
 	}
-	setsockopt(n->context.socket, SOL_SOCKET, SO_RCVTIMEO, &sock_timeout, sizeof(sock_timeout));
-	setsockopt(n->context.socket, SOL_SOCKET, SO_SNDTIMEO, &sock_timeout, sizeof(sock_timeout));
-	if ((retVal = connect(n->context.socket, (struct sockaddr *)&sAddr, sizeof(sAddr))) < 0) {
-		goto exit2;
-	}
+
+	/* writes are whole MQTT packets, don't hold them for coalescing */
+	retVal = 1;
+	setsockopt(n->context.socket, IPPROTO_TCP, TCP_NODELAY, &retVal, sizeof(retVal));
 
 	n->context.ssl = SSL_new(n->context.ctx);
 
@@ -241,14 +332,24 @@ static iot_error_t _iot_net_ssl_connect(iot_net_interface_t *n)
 		goto exit2;
 	}
 
+#if defined(IOT_NET_SSL_WRITE_MODE)
+	SSL_set_mode(n->context.ssl, IOT_NET_SSL_WRITE_MODE);
+#endif
 	SSL_set_fd(n->context.ssl, n->context.socket);
 
-	if ((retVal = SSL_connect(n->context.ssl)) <= 0) {
-		goto exit3;
-	} else {
-		retVal = IOT_ERROR_NONE;
-		goto exit;
+	while ((retVal = SSL_connect(n->context.ssl)) <= 0) {
+		retVal = SSL_get_error(n->context.ssl, retVal);
+		if (retVal != SSL_ERROR_WANT_READ && retVal != SSL_ERROR_WANT_WRITE) {
+			IOT_ERROR("handshake error %d", retVal);
+			goto exit3;
+		}
+		if (_iot_net_ssl_wait(n, retVal, timer) <= 0) {
+			IOT_ERROR("handshake timeout");
+			goto exit3;
+		}
 	}
+	retVal = IOT_ERROR_NONE;
+	goto exit;
 
 exit3:
 	SSL_free(n->context.ssl);
@@ -258,6 +359,7 @@ exit1:
 	SSL_CTX_free(n->context.ctx);
 	retVal = IOT_ERROR_NET_CONNECT;
 exit:
+	iot_os_timer_destroy(&timer);
 	return retVal;
 }
 
@@ -277,6 +379,7 @@ iot_error_t iot_net_init(iot_net_interface_t *n)
 	n->select = _iot_net_select;
 	n->read = _iot_net_ssl_read;
 	n->write = _iot_net_ssl_write;
+	n->writev = _iot_net_ssl_writev;
 	n->show_status = _iot_net_show_status;
 
 	return IOT_ERROR_NONE;
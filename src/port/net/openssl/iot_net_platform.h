@@ -35,6 +35,7 @@ typedef struct iot_net_platform_context {
 	SSL *ssl;			/**< @brief SSL Handle */
 	SSL_CTX *ctx;			/**< @brief set SSL context */
 	const SSL_METHOD *method;	/**< @brief set SSL method */
+	unsigned char *writev_buf;	/**< @brief gathers small buffers of writev */
 } iot_net_platform_context_t;
 
 #ifdef __cplusplus
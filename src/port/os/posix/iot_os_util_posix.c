@@ -26,6 +26,10 @@
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
+#include <limits.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 #include "iot_debug.h"
 #include "iot_error.h"
 #include "iot_os_util.h"
@@ -35,7 +39,277 @@ const unsigned int iot_os_max_delay = 0xFFFFFFFF;
 const unsigned int iot_os_true = true;
 const unsigned int iot_os_false = false;
 
+/* Heap accounting of iot_os_malloc by the usable size of each block */
+#if defined(__GLIBC__)
+#define _iot_os_heap_block_size(ptr)	malloc_usable_size(ptr)
+#else
+/* no way to size a block, used and peaks stay 0 */
+#define _iot_os_heap_block_size(ptr)	0
+#endif
+
+static pthread_mutex_t heap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t heap_used;
+static size_t heap_peak;
+static size_t heap_phase_peak;
+
+static void _iot_os_heap_add(void *ptr)
+{
+	if (ptr == NULL)
+		return;
+
+	pthread_mutex_lock(&heap_mutex);
+	heap_used += _iot_os_heap_block_size(ptr);
+	if (heap_used > heap_peak)
+		heap_peak = heap_used;
+	if (heap_used > heap_phase_peak)
+		heap_phase_peak = heap_used;
+	pthread_mutex_unlock(&heap_mutex);
+}
+
+static void _iot_os_heap_sub(void *ptr)
+{
+	size_t size;
+
+	if (ptr == NULL)
+		return;
+
+	size = _iot_os_heap_block_size(ptr);
+	pthread_mutex_lock(&heap_mutex);
+	/* blocks from plain malloc may be freed here too */
+	heap_used = (heap_used > size) ? heap_used - size : 0;
+	pthread_mutex_unlock(&heap_mutex);
+}
+
+void iot_os_heap_get_info(iot_os_heap_info_t *info, int reset_phase)
+{
+	size_t arena = 0;
+	size_t trapped = 0;
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 mi = mallinfo2();
+
+	arena = mi.arena;
+	trapped = mi.fordblks - mi.keepcost;
+#else
+	struct mallinfo mi = mallinfo();
+
+	arena = (unsigned int)mi.arena;
+	trapped = (unsigned int)(mi.fordblks - mi.keepcost);
+#endif
+#endif
+
+	if (info == NULL)
+		return;
+
+	pthread_mutex_lock(&heap_mutex);
+	info->used = heap_used;
+	info->peak = heap_peak;
+	info->phase_peak = heap_phase_peak;
+	if (reset_phase)
+		heap_phase_peak = heap_used;
+	pthread_mutex_unlock(&heap_mutex);
+
+	/* free chunks below the top chunk are holes between live blocks */
+	info->arena = arena;
+	info->frag = arena ? (unsigned int)(trapped * 100 / arena) : 0;
+}
+
 /* Thread */
+#if defined(CONFIG_STDK_DEBUG_MEMORY_CHECK) && defined(__GLIBC__)
+/* exited threads are found by pthread_tryjoin_np, elsewhere stacks aren't measured */
+#define IOT_OS_STACK_MEASURE
+#endif
+
+#if defined(IOT_OS_STACK_MEASURE)
+#define IOT_OS_STACK_PAINT		0xA5
+#define IOT_OS_STACK_THREAD_MAX		8
+
+#if !defined(PTHREAD_STACK_MIN)
+#define PTHREAD_STACK_MIN		16384
+#endif
+/*
+ * Added to the requested size. The libc keeps the thread descriptor and
+ * static TLS at the top of a given stack and its calls run deeper than
+ * on an MCU, PTHREAD_STACK_MIN only covers a thread doing nothing.
+ * Usage is measured below the entry frame, so this isn't counted.
+ */
+#define IOT_OS_STACK_HEADROOM		(PTHREAD_STACK_MIN + 16 * 1024)
+
+/*
+ * Threads get a painted stack from here and are kept joinable, so that
+ * the stack can be measured after the thread exits and freed then.
+ * Entries are kept by name to report the worst of every instance.
+ */
+struct iot_os_stack_entry {
+	char name[IOT_OS_THREAD_NAME_LEN];
+	pthread_t thread;
+	void *(*function)(void *);
+	void *data;
+	unsigned char *stack;
+	unsigned char *entry_sp;
+	size_t stack_size;
+	size_t buf_size;
+	size_t high_water;
+	bool running;
+};
+
+static pthread_mutex_t stack_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct iot_os_stack_entry stack_entry[IOT_OS_STACK_THREAD_MAX];
+
+/*
+ * Stack grows down, so bytes still painted are at the lowest addresses.
+ * Usage is counted from the frame of the thread entry, the libc keeps
+ * thread descriptor and TLS above it which MCU tasks don't have.
+ */
+static size_t _iot_os_stack_used(struct iot_os_stack_entry *entry)
+{
+	unsigned char *top = entry->entry_sp;
+	size_t untouched = 0;
+
+	if (top == NULL)
+		return 0;
+
+	while (untouched < entry->buf_size && entry->stack[untouched] == IOT_OS_STACK_PAINT)
+		untouched++;
+
+	return (size_t)(top - (entry->stack + untouched));
+}
+
+static void *_iot_os_stack_thread_start(void *arg)
+{
+	struct iot_os_stack_entry *entry = arg;
+
+	pthread_mutex_lock(&stack_mutex);
+	entry->entry_sp = __builtin_frame_address(0);
+	pthread_mutex_unlock(&stack_mutex);
+
+	return entry->function(entry->data);
+}
+
+/* Must be called with stack_mutex held */
+static void _iot_os_stack_reap(void)
+{
+	struct iot_os_stack_entry *entry;
+	size_t used;
+	int i;
+
+	for (i = 0; i < IOT_OS_STACK_THREAD_MAX; i++) {
+		entry = &stack_entry[i];
+		if (!entry->running || pthread_tryjoin_np(entry->thread, NULL))
+			continue;
+
+		used = _iot_os_stack_used(entry);
+		if (used > entry->high_water)
+			entry->high_water = used;
+		free(entry->stack);
+		entry->stack = NULL;
+		entry->running = false;
+	}
+}
+
+/* Must be called with stack_mutex held */
+static struct iot_os_stack_entry *_iot_os_stack_entry(const char *name)
+{
+	struct iot_os_stack_entry *empty = NULL;
+	int i;
+
+	for (i = 0; i < IOT_OS_STACK_THREAD_MAX; i++) {
+		if (stack_entry[i].name[0] == '\0') {
+			if (empty == NULL)
+				empty = &stack_entry[i];
+		} else if (!stack_entry[i].running &&
+				!strncmp(stack_entry[i].name, name, IOT_OS_THREAD_NAME_LEN - 1)) {
+			return &stack_entry[i];
+		}
+	}
+
+	if (empty)
+		snprintf(empty->name, sizeof(empty->name), "%s", name);
+
+	return empty;
+}
+
+static int _iot_os_stack_thread_create(pthread_t *thread, pthread_attr_t *attr,
+		void *thread_function, const char *name, int stack_size, void *data)
+{
+	struct iot_os_stack_entry *entry;
+	size_t buf_size;
+	void *stack;
+	int ret = -1;
+
+	/* posix_memalign and pthread_attr_setstack want whole pages */
+	buf_size = (size_t)stack_size + IOT_OS_STACK_HEADROOM;
+	buf_size = (buf_size + getpagesize() - 1) & ~((size_t)getpagesize() - 1);
+
+	pthread_mutex_lock(&stack_mutex);
+	_iot_os_stack_reap();
+
+	entry = _iot_os_stack_entry(name ? name : "");
+	if (entry == NULL || posix_memalign(&stack, getpagesize(), buf_size)) {
+		pthread_mutex_unlock(&stack_mutex);
+		return -1;
+	}
+
+	memset(stack, IOT_OS_STACK_PAINT, buf_size);
+	pthread_attr_setstack(attr, stack, buf_size);
+	pthread_attr_setdetachstate(attr, PTHREAD_CREATE_JOINABLE);
+
+	entry->function = thread_function;
+	entry->data = data;
+	entry->stack = stack;
+	entry->entry_sp = NULL;
+	entry->stack_size = stack_size;
+	entry->buf_size = buf_size;
+
+	ret = pthread_create(thread, attr, _iot_os_stack_thread_start, entry);
+	if (ret) {
+		free(stack);
+		entry->stack = NULL;
+	} else {
+		entry->thread = *thread;
+		entry->running = true;
+	}
+	pthread_mutex_unlock(&stack_mutex);
+
+	return ret;
+}
+#endif
+
+int iot_os_thread_get_stack_info(iot_os_stack_info_t *info, int max)
+{
+	int count = 0;
+#if defined(IOT_OS_STACK_MEASURE)
+	struct iot_os_stack_entry *entry;
+	size_t used;
+	int i;
+
+	if (info == NULL)
+		return 0;
+
+	pthread_mutex_lock(&stack_mutex);
+	_iot_os_stack_reap();
+	for (i = 0; i < IOT_OS_STACK_THREAD_MAX && count < max; i++) {
+		entry = &stack_entry[i];
+		if (entry->name[0] == '\0')
+			continue;
+
+		if (entry->running) {
+			used = _iot_os_stack_used(entry);
+			if (used > entry->high_water)
+				entry->high_water = used;
+		}
+
+		memcpy(info[count].name, entry->name, sizeof(info[count].name));
+		info[count].stack_size = entry->stack_size;
+		info[count].high_water = entry->high_water;
+		info[count].running = entry->running;
+		count++;
+	}
+	pthread_mutex_unlock(&stack_mutex);
+#endif
+	return count;
+}
+
 int iot_os_thread_create(void * thread_function, const char* name, int stack_size,
 		void* data, int priority, iot_os_thread* thread_handle)
 {
@@ -43,9 +317,19 @@ int iot_os_thread_create(void * thread_function, const char* name, int stack_siz
 	pthread_attr_t attr;
 
 	pthread_attr_init(&attr);
+#if defined(IOT_OS_STACK_MEASURE)
+	if (_iot_os_stack_thread_create(thread, &attr, thread_function, name, stack_size, data)) {
+		/* no more entries, run without measurement */
+		pthread_attr_destroy(&attr);
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		pthread_create(thread, &attr, thread_function, data);
+	}
+#else
 	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
 
 	pthread_create(thread, &attr, thread_function, data);
+#endif
 
 	pthread_attr_destroy(&attr);
 
@@ -398,20 +682,30 @@ void iot_os_timer_destroy(iot_os_timer *timer)
 
 void *iot_os_malloc(size_t size)
 {
-    return malloc(size);
+    void *ptr = malloc(size);
+
+    _iot_os_heap_add(ptr);
+    return ptr;
 }
 
 void *iot_os_calloc(size_t nmemb, size_t size)
 {
-    return calloc(nmemb, size);
+    void *ptr = calloc(nmemb, size);
+
+    _iot_os_heap_add(ptr);
+    return ptr;
 }
 
 void iot_os_free(void *ptr)
 {
+    _iot_os_heap_sub(ptr);
     return free(ptr);
 }
 
 char *iot_os_strdup(const char *src)
 {
-    return strdup(src);
+    char *ptr = strdup(src);
+
+    _iot_os_heap_add(ptr);
+    return ptr;
 }
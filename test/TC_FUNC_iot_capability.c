@@ -23,6 +23,7 @@
 #include <st_dev.h>
 #include <string.h>
 #include <iot_capability.h>
+#include <cJSON.h>
 #include "TC_MOCK_functions.h"
 
 #define UNUSED(x) (void*)(x)
@@ -572,4 +573,174 @@ void TC_st_cap_cmd_set_cb_success(void **state)
     iot_os_free(internal_handle->cmd_list->command);
     iot_os_free(internal_handle->cmd_list);
     free(internal_handle);
-}
\ No newline at end of file
+}
+// Static function of STDK declared to test
+extern iot_error_t _iot_make_evt_data_json(struct iot_cap_handle *handle,
+        uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr,
+        int32_t seq_num, const char *time_in_ms, iot_cap_msg_t *msg);
+extern iot_error_t _iot_parse_noti_data(void *data, size_t data_len, iot_noti_data_t *noti_data);
+
+void TC_STATIC_iot_make_evt_data_json_success(void **state)
+{
+    iot_error_t err;
+    struct iot_cap_handle handle;
+    IOT_EVENT *event[3];
+    iot_cap_val_t value;
+    iot_cap_msg_t msg;
+    cJSON *root;
+    cJSON *item;
+    UNUSED(*state);
+
+    // Given
+    memset(&handle, 0, sizeof(struct iot_cap_handle));
+    handle.component = "main";
+    handle.capability = "switchLevel";
+    event[0] = st_cap_attr_create_int("level", 50, "%");
+    event[1] = st_cap_attr_create_string("name", "line\n\"quoted\"", NULL);
+    value.type = IOT_CAP_VAL_TYPE_JSON_OBJECT;
+    value.json_object = "{ \"x\": [1, 2.5, true] }";
+    event[2] = st_cap_attr_create("obj", &value, NULL, "{\"key\":\"data\"}");
+    memset(&msg, 0, sizeof(iot_cap_msg_t));
+    // When
+    err = _iot_make_evt_data_json(&handle, 3, (iot_cap_evt_data_t **)event, 7, "1559347200000", &msg);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_non_null(msg.msg);
+    assert_int_equal(msg.msglen, strlen(msg.msg));
+    root = cJSON_Parse(msg.msg);
+    assert_non_null(root);
+    item = cJSON_GetObjectItem(root, "deviceEvents");
+    assert_int_equal(cJSON_GetArraySize(item), 3);
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 0), "component")->valuestring, "main");
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 0), "capability")->valuestring, "switchLevel");
+    assert_int_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 0), "value")->valueint, 50);
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 0), "unit")->valuestring, "%");
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 1), "value")->valuestring, "line\n\"quoted\"");
+    assert_int_equal(cJSON_GetArraySize(cJSON_GetObjectItem(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 2), "value"), "x")), 3);
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 2), "data"), "key")->valuestring, "data");
+    item = cJSON_GetObjectItem(cJSON_GetArrayItem(item, 2), "providerData");
+    assert_int_equal(cJSON_GetObjectItem(item, "sequenceNumber")->valueint, 7);
+    assert_string_equal(cJSON_GetObjectItem(item, "timestamp")->valuestring, "1559347200000");
+    // Teardown
+    cJSON_Delete(root);
+    iot_os_free(msg.msg);
+    for (int i = 0; i < 3; i++) {
+        st_cap_attr_free(event[i]);
+    }
+}
+
+void TC_STATIC_iot_make_evt_data_json_invalid_json_object(void **state)
+{
+    iot_error_t err;
+    struct iot_cap_handle handle;
+    IOT_EVENT *event[1];
+    iot_cap_val_t value;
+    iot_cap_msg_t msg;
+    UNUSED(*state);
+
+    // Given
+    memset(&handle, 0, sizeof(struct iot_cap_handle));
+    handle.component = "main";
+    handle.capability = "switchLevel";
+    value.type = IOT_CAP_VAL_TYPE_JSON_OBJECT;
+    value.json_object = "{ \"x\": [1, 2.5, }";
+    event[0] = st_cap_attr_create("obj", &value, NULL, NULL);
+    memset(&msg, 0, sizeof(iot_cap_msg_t));
+    // When: malformed json object value
+    err = _iot_make_evt_data_json(&handle, 1, (iot_cap_evt_data_t **)event, 7, NULL, &msg);
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+    assert_null(msg.msg);
+    // Teardown
+    st_cap_attr_free(event[0]);
+}
+
+void TC_STATIC_iot_parse_noti_data_success(void **state)
+{
+    iot_error_t err;
+    iot_noti_data_t noti_data;
+    const char *rate_limit = "{\"event\":\"rate.limit.reached\",\"deviceId\":\"c236f527-5d8d-4d0b-86f6-0add22717f0e\","
+            "\"count\":31,\"threshold\":30,\"remainingTime\":10950,\"sequenceNumber\":137}";
+    const char *quota = " { \"limit\" : 524288 , \"used\" : 524300 , \"event\" : \"quota.reached\" } ";
+    const char *deleted = "{\"event\":\"device.deleted\",\"deviceId\":\"c236f527-5d8d-4d0b-86f6-0add22717f0e\"}";
+    UNUSED(state);
+
+    // Given: payload is not null terminated
+    memset(&noti_data, 0, sizeof(noti_data));
+    // When
+    err = _iot_parse_noti_data((void *)rate_limit, strlen(rate_limit), &noti_data);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(noti_data.type, IOT_NOTI_TYPE_RATE_LIMIT);
+    assert_int_equal(noti_data.raw.rate_limit.count, 31);
+    assert_int_equal(noti_data.raw.rate_limit.threshold, 30);
+    assert_int_equal(noti_data.raw.rate_limit.remainingTime, 10950);
+    assert_int_equal(noti_data.raw.rate_limit.sequenceNumber, 137);
+
+    // Given
+    memset(&noti_data, 0, sizeof(noti_data));
+    // When
+    err = _iot_parse_noti_data((void *)quota, strlen(quota), &noti_data);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(noti_data.type, IOT_NOTI_TYPE_QUOTA_REACHED);
+    assert_int_equal(noti_data.raw.quota.used, 524300);
+    assert_int_equal(noti_data.raw.quota.limit, 524288);
+
+    // Given
+    memset(&noti_data, 0, sizeof(noti_data));
+    // When
+    err = _iot_parse_noti_data((void *)deleted, strlen(deleted), &noti_data);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(noti_data.type, IOT_NOTI_TYPE_DEV_DELETED);
+}
+
+void TC_STATIC_iot_parse_noti_data_malformed(void **state)
+{
+    iot_error_t err;
+    iot_noti_data_t noti_data;
+    char buf[160];
+    const char *valid = "{\"event\":\"quota.reached\",\"used\":10,\"limit\":20}";
+    const char *corpus[] = {
+            "",
+            "{",
+            "[\"event\",\"quota.reached\"]",
+            "{\"event\":\"quota.reached\",\"used\":10}",
+            "{\"event\":\"quota.reached\",\"used\":\"10\",\"limit\":20}",
+            "{\"event\":\"unknown.event\"}",
+            "{\"event\":7}",
+            "{\"event\":\"device.deleted\"",
+            "{\"event\" \"device.deleted\"}",
+            "{\"event\":\"device.deleted\\",
+            "{\"x\":[[[[[[[[[[[[[[[[[[[[1]]]]]]]]]]]]]]]]]]],\"event\":\"device.deleted\"}",
+    };
+    UNUSED(state);
+
+    for (int i = 0; i < sizeof(corpus)/sizeof(corpus[0]); i++) {
+        // When
+        memset(&noti_data, 0, sizeof(noti_data));
+        err = _iot_parse_noti_data((void *)corpus[i], strlen(corpus[i]), &noti_data);
+        // Then
+        assert_int_not_equal(err, IOT_ERROR_NONE);
+    }
+
+    // Given: every truncation of valid payload, copied to exactly sized buffer
+    for (size_t len = 1; len < strlen(valid); len++) {
+        memcpy(buf, valid, len);
+        memset(buf + len, 'A', sizeof(buf) - len);
+        // When
+        err = _iot_parse_noti_data(buf, len, &noti_data);
+        // Then
+        assert_int_not_equal(err, IOT_ERROR_NONE);
+    }
+
+    // When: null parameters
+    err = _iot_parse_noti_data(NULL, 10, &noti_data);
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+    // When
+    err = _iot_parse_noti_data((void *)valid, strlen(valid), NULL);
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+}
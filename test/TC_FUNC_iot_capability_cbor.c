@@ -0,0 +1,272 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <st_dev.h>
+#include <string.h>
+#include <iot_capability.h>
+#include <iot_serialize.h>
+#include <cJSON.h>
+#include <cbor.h>
+#include "TC_MOCK_functions.h"
+
+#define UNUSED(x) (void*)(x)
+
+extern iot_error_t _iot_make_evt_tmpl_cbor(struct iot_cap_handle *handle);
+extern iot_error_t _iot_make_evt_data_cbor(struct iot_cap_handle *handle,
+        uint8_t arr_size, iot_cap_evt_data_t** evt_data_arr,
+        int32_t seq_num, const char *time_in_ms, iot_cap_msg_t *msg);
+
+int TC_iot_capability_cbor_setup(void **state)
+{
+    UNUSED(*state);
+
+    set_mock_detect_memory_leak(true);
+
+    return 0;
+}
+
+int TC_iot_capability_cbor_teardown(void **state)
+{
+    UNUSED(*state);
+
+    set_mock_detect_memory_leak(false);
+
+    return 0;
+}
+
+/* same deviceEvents encoded by tinycbor, in the order of _iot_make_evt_data_cbor() */
+static size_t _encode_evt_data_tinycbor(const char *component, const char *capability,
+        uint8_t arr_size, iot_cap_evt_data_t **evt_data_arr,
+        int32_t seq_num, const char *time_in_ms, uint8_t *buf, size_t buflen)
+{
+    CborEncoder root;
+    CborEncoder root_map;
+    CborEncoder event_array;
+    CborEncoder event_map;
+    CborEncoder sub_array;
+    CborEncoder provider_map;
+    iot_cap_evt_data_t *evt_data;
+    int i;
+    int j;
+
+    cbor_encoder_init(&root, buf, buflen, 0);
+    assert_int_equal(cbor_encoder_create_map(&root, &root_map, 1), CborNoError);
+    cbor_encode_text_stringz(&root_map, "deviceEvents");
+    cbor_encoder_create_array(&root_map, &event_array, arr_size);
+    for (i = 0; i < arr_size; i++) {
+        evt_data = evt_data_arr[i];
+        cbor_encoder_create_map(&event_array, &event_map,
+                evt_data->evt_unit.type == IOT_CAP_UNIT_TYPE_STRING ? 6 : 5);
+        cbor_encode_text_stringz(&event_map, "component");
+        cbor_encode_text_stringz(&event_map, component);
+        cbor_encode_text_stringz(&event_map, "capability");
+        cbor_encode_text_stringz(&event_map, capability);
+        cbor_encode_text_stringz(&event_map, "attribute");
+        cbor_encode_text_stringz(&event_map, evt_data->evt_type);
+        cbor_encode_text_stringz(&event_map, "value");
+        switch (evt_data->evt_value.type) {
+        case IOT_CAP_VAL_TYPE_INTEGER:
+            cbor_encode_int(&event_map, evt_data->evt_value.integer);
+            break;
+        case IOT_CAP_VAL_TYPE_NUMBER:
+            cbor_encode_double(&event_map, evt_data->evt_value.number);
+            break;
+        case IOT_CAP_VAL_TYPE_STRING:
+            cbor_encode_text_stringz(&event_map, evt_data->evt_value.string);
+            break;
+        case IOT_CAP_VAL_TYPE_STR_ARRAY:
+            cbor_encoder_create_array(&event_map, &sub_array, evt_data->evt_value.str_num);
+            for (j = 0; j < evt_data->evt_value.str_num; j++) {
+                cbor_encode_text_stringz(&sub_array, evt_data->evt_value.strings[j]);
+            }
+            cbor_encoder_close_container_checked(&event_map, &sub_array);
+            break;
+        default:
+            fail();
+        }
+        if (evt_data->evt_unit.type == IOT_CAP_UNIT_TYPE_STRING) {
+            cbor_encode_text_stringz(&event_map, "unit");
+            cbor_encode_text_stringz(&event_map, evt_data->evt_unit.string);
+        }
+        cbor_encode_text_stringz(&event_map, "providerData");
+        cbor_encoder_create_map(&event_map, &provider_map, time_in_ms ? 2 : 1);
+        cbor_encode_text_stringz(&provider_map, "sequenceNumber");
+        cbor_encode_int(&provider_map, seq_num);
+        if (time_in_ms) {
+            cbor_encode_text_stringz(&provider_map, "timestamp");
+            cbor_encode_text_stringz(&provider_map, time_in_ms);
+        }
+        cbor_encoder_close_container_checked(&event_map, &provider_map);
+        cbor_encoder_close_container_checked(&event_array, &event_map);
+    }
+    cbor_encoder_close_container_checked(&root_map, &event_array);
+    assert_int_equal(cbor_encoder_close_container_checked(&root, &root_map), CborNoError);
+
+    return cbor_encoder_get_buffer_size(&root, buf);
+}
+
+void TC_STATIC_iot_make_evt_data_cbor_success(void **state)
+{
+    iot_error_t err;
+    struct iot_cap_handle handle;
+    IOT_EVENT *event[4];
+    char *modes[] = { "auto", "cool" };
+    iot_cap_msg_t msg;
+    CborParser parser;
+    CborValue it;
+    char *json = NULL;
+    size_t json_len;
+    cJSON *root;
+    cJSON *item;
+    UNUSED(*state);
+
+    // Given
+    memset(&handle, 0, sizeof(struct iot_cap_handle));
+    handle.component = "main";
+    handle.capability = "switchLevel";
+    err = _iot_make_evt_tmpl_cbor(&handle);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    event[0] = st_cap_attr_create_int("level", 50, "%");
+    event[1] = st_cap_attr_create_number("temperature", -23.5, "C");
+    event[2] = st_cap_attr_create_string("name", "line\n\"quoted\"", NULL);
+    event[3] = st_cap_attr_create_string_array("modes", 2, modes, NULL);
+    memset(&msg, 0, sizeof(iot_cap_msg_t));
+    // When
+    err = _iot_make_evt_data_cbor(&handle, 4, (iot_cap_evt_data_t **)event, 7, "1559347200000", &msg);
+    // Then: one well-formed item fills the payload
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_non_null(msg.msg);
+    assert_int_equal(cbor_parser_init((uint8_t *)msg.msg, msg.msglen, 0, &parser, &it), CborNoError);
+    assert_int_equal(cbor_value_validate_basic(&it), CborNoError);
+    assert_int_equal(cbor_value_advance(&it), CborNoError);
+    assert_ptr_equal(cbor_value_get_next_byte(&it), (uint8_t *)msg.msg + msg.msglen);
+    // Then: decodes back to the events
+    err = iot_serialize_cbor2json((uint8_t *)msg.msg, msg.msglen, &json, &json_len);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    root = cJSON_Parse(json);
+    assert_non_null(root);
+    item = cJSON_GetObjectItem(root, "deviceEvents");
+    assert_int_equal(cJSON_GetArraySize(item), 4);
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 0), "component")->valuestring, "main");
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 0), "capability")->valuestring, "switchLevel");
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 0), "attribute")->valuestring, "level");
+    assert_int_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 0), "value")->valueint, 50);
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 0), "unit")->valuestring, "%");
+    assert_true(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 1), "value")->valuedouble == -23.5);
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 1), "unit")->valuestring, "C");
+    assert_string_equal(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 2), "value")->valuestring, "line\n\"quoted\"");
+    assert_null(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 2), "unit"));
+    assert_int_equal(cJSON_GetArraySize(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 3), "value")), 2);
+    assert_string_equal(cJSON_GetArrayItem(cJSON_GetObjectItem(cJSON_GetArrayItem(item, 3), "value"), 1)->valuestring, "cool");
+    item = cJSON_GetObjectItem(cJSON_GetArrayItem(item, 3), "providerData");
+    assert_int_equal(cJSON_GetObjectItem(item, "sequenceNumber")->valueint, 7);
+    assert_string_equal(cJSON_GetObjectItem(item, "timestamp")->valuestring, "1559347200000");
+    // Teardown
+    cJSON_Delete(root);
+    iot_os_free(json);
+    iot_os_free(msg.msg);
+    iot_os_free(handle.evt_tmpl);
+    for (int i = 0; i < 4; i++) {
+        st_cap_attr_free(event[i]);
+    }
+}
+
+void TC_STATIC_iot_make_evt_data_cbor_same_as_tinycbor(void **state)
+{
+    iot_error_t err;
+    struct iot_cap_handle handle;
+    IOT_EVENT *event[5];
+    char *modes[] = { "auto", "", "a string longer than twenty three bytes" };
+    const char *timestamp[] = { NULL, "1559347200000" };
+    char long_unit[257];
+    uint8_t expected[1024];
+    size_t expected_len;
+    iot_cap_msg_t msg;
+    UNUSED(*state);
+
+    // Given: heads with 0, 1, 2 and 4 bytes of argument
+    memset(&handle, 0, sizeof(struct iot_cap_handle));
+    handle.component = "main";
+    handle.capability = "switchLevel";
+    err = _iot_make_evt_tmpl_cbor(&handle);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    memset(long_unit, 'u', sizeof(long_unit) - 1);
+    long_unit[sizeof(long_unit) - 1] = '\0';
+    event[0] = st_cap_attr_create_int("level", -25, long_unit);
+    event[1] = st_cap_attr_create_int("level", 1000, NULL);
+    event[2] = st_cap_attr_create_int("level", -2147483647 - 1, NULL);
+    event[3] = st_cap_attr_create_number("level", 0.1, "F");
+    event[4] = st_cap_attr_create_string_array("modes", 3, modes, NULL);
+    for (int i = 0; i < 2; i++) {
+        expected_len = _encode_evt_data_tinycbor(handle.component, handle.capability,
+                5, (iot_cap_evt_data_t **)event, 0x12345, timestamp[i], expected, sizeof(expected));
+        memset(&msg, 0, sizeof(iot_cap_msg_t));
+        // When
+        err = _iot_make_evt_data_cbor(&handle, 5, (iot_cap_evt_data_t **)event, 0x12345, timestamp[i], &msg);
+        // Then: byte for byte
+        assert_int_equal(err, IOT_ERROR_NONE);
+        assert_int_equal(msg.msglen, expected_len);
+        assert_memory_equal(msg.msg, expected, expected_len);
+        iot_os_free(msg.msg);
+    }
+    // Teardown
+    iot_os_free(handle.evt_tmpl);
+    for (int i = 0; i < 5; i++) {
+        st_cap_attr_free(event[i]);
+    }
+}
+
+void TC_STATIC_iot_make_evt_data_cbor_too_large(void **state)
+{
+    iot_error_t err;
+    struct iot_cap_handle handle;
+    IOT_EVENT *event[1];
+    char long_string[IOT_CBOR_MAX_BUF_LEN];
+    iot_cap_msg_t msg;
+    UNUSED(*state);
+
+    // Given
+    memset(&handle, 0, sizeof(struct iot_cap_handle));
+    handle.component = "main";
+    handle.capability = "switchLevel";
+    memset(long_string, 'a', sizeof(long_string) - 1);
+    long_string[sizeof(long_string) - 1] = '\0';
+    event[0] = st_cap_attr_create_string("name", long_string, NULL);
+    memset(&msg, 0, sizeof(iot_cap_msg_t));
+    // When: template is not made
+    err = _iot_make_evt_data_cbor(&handle, 1, (iot_cap_evt_data_t **)event, 7, NULL, &msg);
+    // Then
+    assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+    assert_null(msg.msg);
+
+    // Given
+    err = _iot_make_evt_tmpl_cbor(&handle);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    // When: payload exceeds IOT_CBOR_MAX_BUF_LEN
+    err = _iot_make_evt_data_cbor(&handle, 1, (iot_cap_evt_data_t **)event, 7, NULL, &msg);
+    // Then: rejected before allocating
+    assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+    assert_null(msg.msg);
+    // Teardown
+    iot_os_free(handle.evt_tmpl);
+    st_cap_attr_free(event[0]);
+}
@@ -93,6 +93,7 @@ int TC_iot_crypto_pk_teardown(void **state)
 	pk_info = context->info;
 	assert_non_null(pk_info);
 
+	iot_crypto_pk_free(context);
 	free(pk_info->pubkey);
 	free(pk_info->seckey);
 	free(pk_info);
@@ -160,6 +161,7 @@ void TC_iot_crypto_pk_free(void **state)
 	UNUSED(state);
 
 	// Given: set pk_info
+	memset(&context, 0, sizeof(context));
 	context.info = &pk_info;
 	// When
 	iot_crypto_pk_free(&context);
@@ -198,6 +200,88 @@ void TC_iot_crypto_pk_ed25519_success(void **state)
 	assert_int_equal(err, IOT_ERROR_NONE);
 }
 
+void TC_iot_crypto_pk_sign_batch_ed25519(void **state)
+{
+	iot_error_t err;
+	iot_crypto_pk_context_t *context;
+	iot_crypto_pk_sign_req_t reqs[3];
+	unsigned char input[3][64];
+	unsigned char sig[3][IOT_CRYPTO_SIGNATURE_LEN];
+	unsigned char single[IOT_CRYPTO_SIGNATURE_LEN];
+	size_t single_len;
+	size_t done;
+	int i;
+	int j;
+
+	context = (iot_crypto_pk_context_t *)*state;
+	assert_non_null(context);
+	// Given: key material is prepared by init
+	assert_non_null(context->key);
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < sizeof(input[i]); j++) {
+			input[i][j] = (unsigned char)(i * 64 + j);
+		}
+		reqs[i].input = input[i];
+		reqs[i].ilen = sizeof(input[i]);
+		reqs[i].sig = sig[i];
+		reqs[i].slen = 0;
+	}
+	// When
+	err = iot_crypto_pk_sign_batch(context, reqs, 3, &done);
+	// Then
+	assert_int_equal(err, IOT_ERROR_NONE);
+	assert_int_equal(done, 3);
+	for (i = 0; i < 3; i++) {
+		assert_int_equal(reqs[i].slen, IOT_CRYPTO_SIGNATURE_LEN);
+		err = iot_crypto_pk_verify(context, input[i], sizeof(input[i]), sig[i], reqs[i].slen);
+		assert_int_equal(err, IOT_ERROR_NONE);
+	}
+
+	// When: ed25519 is deterministic, single sign gives the same signature
+	err = iot_crypto_pk_sign(context, input[1], sizeof(input[1]), single, &single_len);
+	// Then
+	assert_int_equal(err, IOT_ERROR_NONE);
+	assert_int_equal(single_len, reqs[1].slen);
+	assert_memory_equal(single, sig[1], single_len);
+}
+
+void TC_iot_crypto_pk_sign_batch_invalid_parameter(void **state)
+{
+	iot_error_t err;
+	iot_crypto_pk_context_t *context;
+	iot_crypto_pk_sign_req_t reqs[2];
+	unsigned char input[32] = { 0, };
+	unsigned char sig[IOT_CRYPTO_SIGNATURE_LEN];
+	size_t done;
+
+	context = (iot_crypto_pk_context_t *)*state;
+	assert_non_null(context);
+
+	// When: null context
+	err = iot_crypto_pk_sign_batch(NULL, reqs, 2, &done);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_PK_INVALID_CTX);
+	assert_int_equal(done, 0);
+
+	// When: null requests
+	err = iot_crypto_pk_sign_batch(context, NULL, 2, &done);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_PK_INVALID_ARG);
+
+	// Given: second request has no signature buffer
+	reqs[0].input = input;
+	reqs[0].ilen = sizeof(input);
+	reqs[0].sig = sig;
+	reqs[1].input = input;
+	reqs[1].ilen = sizeof(input);
+	reqs[1].sig = NULL;
+	// When
+	err = iot_crypto_pk_sign_batch(context, reqs, 2, &done);
+	// Then: stops at the bad one
+	assert_int_equal(err, IOT_ERROR_CRYPTO_PK_INVALID_ARG);
+	assert_int_equal(done, 1);
+}
+
 int TC_iot_crypto_cipher_aes_setup(void **state)
 {
 	iot_crypto_cipher_info_t *cipher_info;
@@ -427,6 +511,168 @@ void TC_iot_crypto_cipher_aes_success(void **state)
 	free(plain);
 }
 
+void TC_iot_crypto_cipher_session_invalid_parameter(void **state)
+{
+	iot_error_t err;
+	iot_crypto_cipher_info_t *cipher_info;
+	iot_crypto_cipher_ctx_t cipher_ctx;
+	unsigned char buf[64];
+	size_t olen;
+	size_t key_len;
+
+	cipher_info = (iot_crypto_cipher_info_t *)*state;
+	assert_non_null(cipher_info);
+	memset(&cipher_ctx, 0, sizeof(cipher_ctx));
+	memset(buf, 0x5a, sizeof(buf));
+
+	// When: null parameters
+	err = iot_crypto_cipher_init(NULL, cipher_info);
+	// Then
+	assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+	// When
+	err = iot_crypto_cipher_init(&cipher_ctx, NULL);
+	// Then
+	assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+
+	// Given: wrong key length
+	key_len = cipher_info->key_len;
+	cipher_info->key_len = key_len - 1;
+	// When
+	err = iot_crypto_cipher_init(&cipher_ctx, cipher_info);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_CIPHER_KEYLEN);
+	assert_null(cipher_ctx.state);
+	cipher_info->key_len = key_len;
+
+	// When: session is not initialized
+	err = iot_crypto_cipher_start(&cipher_ctx, IOT_CRYPTO_CIPHER_ENCRYPT, cipher_info->iv, cipher_info->iv_len);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_CIPHER_INVALID_CTX);
+
+	// Given
+	err = iot_crypto_cipher_init(&cipher_ctx, cipher_info);
+	assert_int_equal(err, IOT_ERROR_NONE);
+	// When: message is not started
+	err = iot_crypto_cipher_update(&cipher_ctx, buf, 16, buf, &olen, sizeof(buf));
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_CIPHER_INVALID_CTX);
+	// When: invalid mode
+	err = iot_crypto_cipher_start(&cipher_ctx, -1, cipher_info->iv, cipher_info->iv_len);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_CIPHER_UNKNOWN_MODE);
+	// When: wrong iv length
+	err = iot_crypto_cipher_start(&cipher_ctx, IOT_CRYPTO_CIPHER_ENCRYPT, cipher_info->iv, cipher_info->iv_len - 1);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_CIPHER_IVLEN);
+
+	// Given
+	err = iot_crypto_cipher_start(&cipher_ctx, IOT_CRYPTO_CIPHER_ENCRYPT, cipher_info->iv, cipher_info->iv_len);
+	assert_int_equal(err, IOT_ERROR_NONE);
+	// When: two blocks don't fit in one block of output
+	err = iot_crypto_cipher_update(&cipher_ctx, buf, 40, buf, &olen, 31);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_CIPHER_OUTSIZE);
+	// When: padded last block doesn't fit
+	err = iot_crypto_cipher_finish(&cipher_ctx, buf, &olen, IOT_CRYPTO_IV_LEN - 1);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_CIPHER_OUTSIZE);
+
+	// When
+	iot_crypto_cipher_free(&cipher_ctx);
+	// Then: freeing twice is harmless
+	assert_null(cipher_ctx.state);
+	iot_crypto_cipher_free(&cipher_ctx);
+}
+
+void TC_iot_crypto_cipher_session_success(void **state)
+{
+	iot_error_t err;
+	iot_crypto_cipher_info_t *cipher_info;
+	iot_crypto_cipher_ctx_t cipher_ctx;
+	unsigned char *plain;
+	unsigned char *expected;
+	unsigned char *stream;
+	size_t chunk_sizes[] = { 1, 15, 16, 17, 100, 1000 };
+	size_t plain_len = 1000;
+	size_t required_len;
+	size_t expected_len;
+	size_t stream_len;
+	size_t offset;
+	size_t chunk;
+	size_t olen;
+	int i;
+
+	cipher_info = (iot_crypto_cipher_info_t *)*state;
+	assert_non_null(cipher_info);
+
+	plain = (unsigned char *)malloc(plain_len);
+	assert_non_null(plain);
+	for (i = 0; i < plain_len; i++) {
+		plain[i] = (unsigned char)(iot_bsp_random() & 0xff);
+	}
+	required_len = iot_crypto_cipher_get_align_size(cipher_info->type, plain_len);
+	expected = (unsigned char *)malloc(required_len);
+	assert_non_null(expected);
+	stream = (unsigned char *)malloc(required_len + IOT_CRYPTO_IV_LEN);
+	assert_non_null(stream);
+
+	cipher_info->mode = IOT_CRYPTO_CIPHER_ENCRYPT;
+	err = iot_crypto_cipher_aes(cipher_info, plain, plain_len, expected, &expected_len, required_len);
+	assert_int_equal(err, IOT_ERROR_NONE);
+
+	// Given: session is keyed once for every message below
+	memset(&cipher_ctx, 0, sizeof(cipher_ctx));
+	err = iot_crypto_cipher_init(&cipher_ctx, cipher_info);
+	assert_int_equal(err, IOT_ERROR_NONE);
+
+	for (i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++) {
+		// When: encrypt in chunks
+		err = iot_crypto_cipher_start(&cipher_ctx, IOT_CRYPTO_CIPHER_ENCRYPT, cipher_info->iv, cipher_info->iv_len);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		stream_len = 0;
+		for (offset = 0; offset < plain_len; offset += chunk) {
+			chunk = plain_len - offset;
+			if (chunk > chunk_sizes[i])
+				chunk = chunk_sizes[i];
+			err = iot_crypto_cipher_update(&cipher_ctx, plain + offset, chunk,
+					stream + stream_len, &olen, chunk + IOT_CRYPTO_IV_LEN);
+			assert_int_equal(err, IOT_ERROR_NONE);
+			stream_len += olen;
+		}
+		err = iot_crypto_cipher_finish(&cipher_ctx, stream + stream_len, &olen, IOT_CRYPTO_IV_LEN);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		stream_len += olen;
+		// Then: same as one-shot
+		assert_int_equal(stream_len, expected_len);
+		assert_memory_equal(stream, expected, expected_len);
+
+		// When: decrypt in chunks
+		err = iot_crypto_cipher_start(&cipher_ctx, IOT_CRYPTO_CIPHER_DECRYPT, cipher_info->iv, cipher_info->iv_len);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		stream_len = 0;
+		for (offset = 0; offset < expected_len; offset += chunk) {
+			chunk = expected_len - offset;
+			if (chunk > chunk_sizes[i])
+				chunk = chunk_sizes[i];
+			err = iot_crypto_cipher_update(&cipher_ctx, expected + offset, chunk,
+					stream + stream_len, &olen, chunk + IOT_CRYPTO_IV_LEN);
+			assert_int_equal(err, IOT_ERROR_NONE);
+			stream_len += olen;
+		}
+		err = iot_crypto_cipher_finish(&cipher_ctx, stream + stream_len, &olen, IOT_CRYPTO_IV_LEN);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		stream_len += olen;
+		// Then
+		assert_int_equal(stream_len, plain_len);
+		assert_memory_equal(stream, plain, plain_len);
+	}
+
+	iot_crypto_cipher_free(&cipher_ctx);
+	free(stream);
+	free(expected);
+	free(plain);
+}
+
 void TC_iot_crypto_cipher_get_align_size(void **state)
 {
 	iot_crypto_cipher_type_t cipher_type;
@@ -967,6 +1213,110 @@ void TC_iot_crypto_base64_urlsafe_decode_success(void **state)
 	free(dst);
 }
 
+/* RFC 4648 test vectors, every tail length of the last group */
+static const char *b64_rfc4648_plain[] = {
+	"f", "fo", "foo", "foob", "fooba", "foobar",
+};
+
+static const char *b64_rfc4648_encoded[] = {
+	"Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy",
+};
+
+void TC_iot_crypto_base64_vectors(void **state)
+{
+	iot_error_t err;
+	unsigned char dst[16];
+	size_t out_len;
+	size_t plain_len;
+	size_t b64_len;
+	int i;
+	UNUSED(state);
+
+	for (i = 0; i < (sizeof(b64_rfc4648_plain) / sizeof(b64_rfc4648_plain[0])); i++) {
+		// Given
+		plain_len = strlen(b64_rfc4648_plain[i]);
+		b64_len = strlen(b64_rfc4648_encoded[i]);
+		// When
+		err = iot_crypto_base64_encode((const unsigned char *)b64_rfc4648_plain[i], plain_len,
+				dst, sizeof(dst), &out_len);
+		// Then
+		assert_int_equal(err, IOT_ERROR_NONE);
+		assert_int_equal(out_len, b64_len);
+		assert_string_equal(dst, b64_rfc4648_encoded[i]);
+
+		// When
+		err = iot_crypto_base64_decode((const unsigned char *)b64_rfc4648_encoded[i], b64_len,
+				dst, sizeof(dst), &out_len);
+		// Then
+		assert_int_equal(err, IOT_ERROR_NONE);
+		assert_int_equal(out_len, plain_len);
+		assert_memory_equal(dst, b64_rfc4648_plain[i], plain_len);
+
+		// When: urlsafe string without '='
+		while (b64_len > 0 && b64_rfc4648_encoded[i][b64_len - 1] == '=')
+			b64_len--;
+		err = iot_crypto_base64_decode_urlsafe((const unsigned char *)b64_rfc4648_encoded[i], b64_len,
+				dst, sizeof(dst), &out_len);
+		// Then
+		assert_int_equal(err, IOT_ERROR_NONE);
+		assert_int_equal(out_len, plain_len);
+		assert_memory_equal(dst, b64_rfc4648_plain[i], plain_len);
+	}
+}
+
+void TC_iot_crypto_base64_all_lengths(void **state)
+{
+	iot_error_t err;
+	unsigned char src[256];
+	unsigned char b64[IOT_CRYPTO_CAL_B64_LEN(256)];
+	unsigned char url[IOT_CRYPTO_CAL_B64_LEN(256)];
+	unsigned char dst[256];
+	size_t b64_len;
+	size_t url_len;
+	size_t out_len;
+	size_t len;
+	size_t i;
+	UNUSED(state);
+
+	// Given: every byte value in every position of a group
+	for (i = 0; i < sizeof(src); i++)
+		src[i] = (unsigned char)(i * 7 + 3);
+
+	for (len = 0; len <= sizeof(src); len++) {
+		// When
+		err = iot_crypto_base64_encode(src, len, b64, sizeof(b64), &b64_len);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		err = iot_crypto_base64_encode_urlsafe(src, len, url, sizeof(url), &url_len);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		// Then: same string apart from the two alphabet characters
+		assert_int_equal(b64_len, IOT_CRYPTO_CAL_B64_LEN(len) - 1);
+		assert_int_equal(url_len, b64_len);
+		assert_int_equal(b64[b64_len], '\0');
+		for (i = 0; i < b64_len; i++) {
+			if (b64[i] == '+')
+				assert_int_equal(url[i], '-');
+			else if (b64[i] == '/')
+				assert_int_equal(url[i], '_');
+			else
+				assert_int_equal(url[i], b64[i]);
+		}
+
+		// When
+		err = iot_crypto_base64_decode(b64, b64_len, dst, len, &out_len);
+		// Then
+		assert_int_equal(err, IOT_ERROR_NONE);
+		assert_int_equal(out_len, len);
+		assert_memory_equal(dst, src, len);
+
+		// When
+		err = iot_crypto_base64_decode_urlsafe(url, url_len, dst, len, &out_len);
+		// Then
+		assert_int_equal(err, IOT_ERROR_NONE);
+		assert_int_equal(out_len, len);
+		assert_memory_equal(dst, src, len);
+	}
+}
+
 static const size_t b64_encode_len_input[] = {
 	2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
 	17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31
@@ -1016,4 +1366,300 @@ void TC_iot_crypto_base64_buffer_size(void **state)
 		// Then
 		assert_int_equal(required_len, expected[i] + 1);
 	}
-}
\ No newline at end of file
+}
+
+void TC_iot_crypto_random_invalid_parameter(void **state)
+{
+	iot_error_t err;
+	unsigned char buf[IOT_CRYPTO_IV_LEN];
+	UNUSED(state);
+
+	// When: null buffer
+	err = iot_crypto_random(NULL, sizeof(buf));
+	// Then
+	assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+
+	// When: zero length
+	err = iot_crypto_random(buf, 0);
+	// Then
+	assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+}
+
+void TC_iot_crypto_random_success(void **state)
+{
+	iot_error_t err;
+	unsigned char first[IOT_CRYPTO_SECRET_LEN];
+	unsigned char second[IOT_CRYPTO_SECRET_LEN];
+	unsigned char *large;
+	size_t large_len = 4096;
+	UNUSED(state);
+
+	// When
+	err = iot_crypto_random(first, sizeof(first));
+	// Then
+	assert_int_equal(err, IOT_ERROR_NONE);
+
+	// When: shared DRBG is already seeded
+	err = iot_crypto_random(second, sizeof(second));
+	// Then
+	assert_int_equal(err, IOT_ERROR_NONE);
+	assert_memory_not_equal(first, second, sizeof(first));
+
+	// Given: larger than a single DRBG request
+	large = (unsigned char *)malloc(large_len);
+	assert_non_null(large);
+	// When
+	err = iot_crypto_random(large, large_len);
+	// Then
+	assert_int_equal(err, IOT_ERROR_NONE);
+
+	free(large);
+}
+
+/* FIPS 180-2 "abc" and the two block message */
+static const char *sha256_vector_msg[] = {
+	"abc",
+	"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+};
+
+static const unsigned char sha256_vector_digest[][IOT_CRYPTO_SHA256_LEN] = {
+	{
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+		0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+		0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+	},
+	{
+		0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8,
+		0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+		0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67,
+		0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1
+	},
+};
+
+void TC_iot_crypto_sha256_invalid_parameter(void **state)
+{
+	iot_error_t err;
+	iot_crypto_sha256_ctx_t ctx;
+	iot_crypto_hmac_sha256_ctx_t hmac;
+	unsigned char digest[IOT_CRYPTO_SHA256_LEN];
+	UNUSED(state);
+
+	// When: null context
+	err = iot_crypto_sha256_init(NULL);
+	// Then
+	assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+
+	// Given
+	err = iot_crypto_sha256_init(&ctx);
+	assert_int_equal(err, IOT_ERROR_NONE);
+	// When: null input with length
+	err = iot_crypto_sha256_update(&ctx, NULL, 4);
+	// Then
+	assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+	// When: null digest buffer
+	err = iot_crypto_sha256_final(&ctx, NULL);
+	// Then
+	assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+	// When: finished context
+	err = iot_crypto_sha256_final(&ctx, digest);
+	assert_int_equal(err, IOT_ERROR_NONE);
+	err = iot_crypto_sha256_update(&ctx, (unsigned char *)"abc", 3);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_SHA256_INVALID_CTX);
+	err = iot_crypto_sha256_final(&ctx, digest);
+	assert_int_equal(err, IOT_ERROR_CRYPTO_SHA256_INVALID_CTX);
+
+	// When: backend without functions
+	err = iot_crypto_sha256_set_funcs(&(iot_crypto_sha256_funcs_t){ .name = "empty" });
+	// Then
+	assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+
+	// When: null key with length
+	err = iot_crypto_hmac_sha256_init(&hmac, NULL, 16);
+	// Then
+	assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+
+	// Given
+	err = iot_crypto_hmac_sha256_init(&hmac, (unsigned char *)"key", 3);
+	assert_int_equal(err, IOT_ERROR_NONE);
+	// When: abandoned context
+	iot_crypto_hmac_sha256_free(&hmac);
+	err = iot_crypto_hmac_sha256_final(&hmac, digest);
+	// Then
+	assert_int_equal(err, IOT_ERROR_CRYPTO_SHA256_INVALID_CTX);
+}
+
+void TC_iot_crypto_sha256_success(void **state)
+{
+	iot_error_t err;
+	iot_crypto_sha256_ctx_t ctx;
+	unsigned char digest[IOT_CRYPTO_SHA256_LEN];
+	const unsigned char *msg;
+	size_t msg_len;
+	size_t i;
+	int v;
+	UNUSED(state);
+
+	for (v = 0; v < (sizeof(sha256_vector_msg) / sizeof(sha256_vector_msg[0])); v++) {
+		// Given
+		msg = (const unsigned char *)sha256_vector_msg[v];
+		msg_len = strlen(sha256_vector_msg[v]);
+		// When
+		err = iot_crypto_sha256((unsigned char *)msg, msg_len, digest);
+		// Then
+		assert_int_equal(err, IOT_ERROR_NONE);
+		assert_memory_equal(digest, sha256_vector_digest[v], sizeof(digest));
+
+		// When: one byte at a time
+		err = iot_crypto_sha256_init(&ctx);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		for (i = 0; i < msg_len; i++) {
+			err = iot_crypto_sha256_update(&ctx, msg + i, 1);
+			assert_int_equal(err, IOT_ERROR_NONE);
+		}
+		err = iot_crypto_sha256_final(&ctx, digest);
+		// Then
+		assert_int_equal(err, IOT_ERROR_NONE);
+		assert_memory_equal(digest, sha256_vector_digest[v], sizeof(digest));
+	}
+}
+
+static const iot_crypto_sha256_funcs_t *sha256_test_base;
+static int sha256_test_calls;
+
+static iot_error_t _sha256_test_init(iot_crypto_sha256_ctx_t *ctx)
+{
+	sha256_test_calls++;
+	return sha256_test_base->init(ctx);
+}
+
+static iot_error_t _sha256_test_update(iot_crypto_sha256_ctx_t *ctx,
+		const unsigned char *input, size_t ilen)
+{
+	sha256_test_calls++;
+	return sha256_test_base->update(ctx, input, ilen);
+}
+
+static iot_error_t _sha256_test_final(iot_crypto_sha256_ctx_t *ctx, unsigned char *dst)
+{
+	sha256_test_calls++;
+	return sha256_test_base->final(ctx, dst);
+}
+
+static const iot_crypto_sha256_funcs_t sha256_test_funcs = {
+	.name = "test",
+	.init = _sha256_test_init,
+	.update = _sha256_test_update,
+	.final = _sha256_test_final,
+};
+
+void TC_iot_crypto_sha256_set_funcs(void **state)
+{
+	iot_error_t err;
+	unsigned char digest[IOT_CRYPTO_SHA256_LEN];
+	UNUSED(state);
+
+	// Given: a backend forwarding to the default one
+	sha256_test_base = iot_crypto_sha256_get_funcs();
+	assert_non_null(sha256_test_base);
+	sha256_test_calls = 0;
+	err = iot_crypto_sha256_set_funcs(&sha256_test_funcs);
+	assert_int_equal(err, IOT_ERROR_NONE);
+	assert_ptr_equal(iot_crypto_sha256_get_funcs(), &sha256_test_funcs);
+	// When
+	err = iot_crypto_sha256((unsigned char *)sha256_vector_msg[0],
+			strlen(sha256_vector_msg[0]), digest);
+	// Then: init, update and final went through the new backend
+	assert_int_equal(err, IOT_ERROR_NONE);
+	assert_int_equal(sha256_test_calls, 3);
+	assert_memory_equal(digest, sha256_vector_digest[0], sizeof(digest));
+
+	// When: default backend is restored
+	err = iot_crypto_sha256_set_funcs(NULL);
+	// Then
+	assert_int_equal(err, IOT_ERROR_NONE);
+	assert_ptr_equal(iot_crypto_sha256_get_funcs(), sha256_test_base);
+}
+
+/* RFC 4231 test cases 1, 2 and 6, the last one with a key longer than a block */
+static const unsigned char hmac_vector_key1[20] = {
+	0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+	0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b
+};
+
+static const struct {
+	const unsigned char *key;
+	size_t key_len;
+	const char *msg;
+	unsigned char mac[IOT_CRYPTO_SHA256_LEN];
+} hmac_vectors[] = {
+	{
+		hmac_vector_key1, sizeof(hmac_vector_key1), "Hi There",
+		{
+			0xb0, 0x34, 0x4c, 0x61, 0xd8, 0xdb, 0x38, 0x53,
+			0x5c, 0xa8, 0xaf, 0xce, 0xaf, 0x0b, 0xf1, 0x2b,
+			0x88, 0x1d, 0xc2, 0x00, 0xc9, 0x83, 0x3d, 0xa7,
+			0x26, 0xe9, 0x37, 0x6c, 0x2e, 0x32, 0xcf, 0xf7
+		}
+	},
+	{
+		(const unsigned char *)"Jefe", 4, "what do ya want for nothing?",
+		{
+			0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e,
+			0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+			0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+			0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+		}
+	},
+	{
+		NULL, 131, "Test Using Larger Than Block-Size Key - Hash Key First",
+		{
+			0x60, 0xe4, 0x31, 0x59, 0x1e, 0xe0, 0xb6, 0x7f,
+			0x0d, 0x8a, 0x26, 0xaa, 0xcb, 0xf5, 0xb7, 0x7f,
+			0x8e, 0x0b, 0xc6, 0x21, 0x37, 0x28, 0xc5, 0x14,
+			0x05, 0x46, 0x04, 0x0f, 0x0e, 0xe3, 0x7f, 0x54
+		}
+	},
+};
+
+void TC_iot_crypto_hmac_sha256_success(void **state)
+{
+	iot_error_t err;
+	iot_crypto_hmac_sha256_ctx_t ctx;
+	unsigned char long_key[131];
+	unsigned char mac[IOT_CRYPTO_SHA256_LEN];
+	const unsigned char *key;
+	const unsigned char *msg;
+	size_t msg_len;
+	size_t half;
+	int v;
+	UNUSED(state);
+
+	memset(long_key, 0xaa, sizeof(long_key));
+
+	for (v = 0; v < (sizeof(hmac_vectors) / sizeof(hmac_vectors[0])); v++) {
+		// Given
+		key = hmac_vectors[v].key ? hmac_vectors[v].key : long_key;
+		msg = (const unsigned char *)hmac_vectors[v].msg;
+		msg_len = strlen(hmac_vectors[v].msg);
+		// When
+		err = iot_crypto_hmac_sha256(key, hmac_vectors[v].key_len, msg, msg_len, mac);
+		// Then
+		assert_int_equal(err, IOT_ERROR_NONE);
+		assert_memory_equal(mac, hmac_vectors[v].mac, sizeof(mac));
+
+		// When: message in two parts
+		half = msg_len / 2;
+		err = iot_crypto_hmac_sha256_init(&ctx, key, hmac_vectors[v].key_len);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		err = iot_crypto_hmac_sha256_update(&ctx, msg, half);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		err = iot_crypto_hmac_sha256_update(&ctx, msg + half, msg_len - half);
+		assert_int_equal(err, IOT_ERROR_NONE);
+		err = iot_crypto_hmac_sha256_final(&ctx, mac);
+		// Then
+		assert_int_equal(err, IOT_ERROR_NONE);
+		assert_memory_equal(mac, hmac_vectors[v].mac, sizeof(mac));
+	}
+}
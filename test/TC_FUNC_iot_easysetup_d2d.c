@@ -30,6 +30,7 @@
 #include <regex.h>
 #include <errno.h>
 #include <iot_util.h>
+#include <iot_mem.h>
 #include "TC_MOCK_functions.h"
 
 #define UNUSED(x) (void**)(x)
@@ -142,6 +143,7 @@ int TC_iot_easysetup_d2d_teardown(void **state)
     iot_api_onboarding_config_mem_free(devconf);
     iot_api_device_info_mem_free(device_info);
     _free_cipher(cipher_info);
+    iot_crypto_cipher_free(&context->es_crypto_cipher_ctx);
 
     err = iot_nv_erase_prov_data();
     assert_int_equal(err, IOT_ERROR_NONE);
@@ -421,6 +423,44 @@ void TC_STATIC_es_wifiscaninfo_handler_success(void **state)
     free(out_payload);
 }
 
+void TC_STATIC_es_wifiscaninfo_handler_scan_cache(void **state)
+{
+    iot_error_t err;
+    char *out_payload = NULL;
+    char *cached_payload = NULL;
+    struct iot_context *context;
+    iot_crypto_cipher_info_t *server_cipher;
+
+    // Given
+    context = (struct iot_context *)*state;
+    context->es_crypto_cipher_info = _generate_device_cipher(NULL, 0);
+    server_cipher = _generate_server_cipher(context->es_crypto_cipher_info->iv, context->es_crypto_cipher_info->iv_len);
+    will_return(__wrap_iot_bsp_wifi_get_scan_result, 20);
+    err = iot_easysetup_scan_start(context);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    // When
+    err = _es_wifiscaninfo_handler(context, &out_payload);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_wifiscaninfo_payload(server_cipher, out_payload, 20);
+    assert_int_equal(context->scan_num, 20);
+
+    // When: asked again
+    err = _es_wifiscaninfo_handler(context, &cached_payload);
+    // Then: encrypted response is served as it is
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_non_null(cached_payload);
+    assert_string_equal(cached_payload, out_payload);
+
+    // Local teardown
+    iot_easysetup_scan_stop(context);
+    iot_mem_free(IOT_MEM_TAG_CORE, context->scan_result);
+    context->scan_result = NULL;
+    _free_cipher(server_cipher);
+    free(out_payload);
+    free(cached_payload);
+}
+
 // Static function of STDK declared to test
 extern iot_error_t _es_confirminfo_handler(struct iot_context *ctx, char *in_payload, char **out_payload);
 
@@ -502,7 +542,7 @@ void TC_STATIC_es_confirminfo_handler_justworks_and_pin(void **state)
     context->es_crypto_cipher_info = _generate_device_cipher(NULL, 0);
     context->usr_events = iot_os_eventgroup_create();
     context->iot_events = iot_os_eventgroup_create();
-    context->cmd_queue = iot_os_queue_create(IOT_QUEUE_LENGTH, sizeof(struct iot_command));
+    context->cmd_queue = iot_os_queue_create(IOT_QUEUE_LENGTH, sizeof(struct iot_command *));
     server_cipher = _generate_server_cipher(context->es_crypto_cipher_info->iv, context->es_crypto_cipher_info->iv_len);
 
     // Given: justworks payload
@@ -549,7 +589,7 @@ void TC_STATIC_es_confirminfo_handler_qr_code(void **state)
     context->es_crypto_cipher_info = _generate_device_cipher(NULL, 0);
     context->usr_events = iot_os_eventgroup_create();
     context->iot_events = iot_os_eventgroup_create();
-    context->cmd_queue = iot_os_queue_create(IOT_QUEUE_LENGTH, sizeof(struct iot_command));
+    context->cmd_queue = iot_os_queue_create(IOT_QUEUE_LENGTH, sizeof(struct iot_command *));
 
     // Given: valid serial number
     server_cipher = _generate_server_cipher(context->es_crypto_cipher_info->iv, context->es_crypto_cipher_info->iv_len);
@@ -598,7 +638,7 @@ void TC_STATIC_es_confirminfo_handler_button(void **state)
     context->es_crypto_cipher_info = _generate_device_cipher(NULL, 0);
     context->usr_events = iot_os_eventgroup_create();
     context->iot_events = iot_os_eventgroup_create();
-    context->cmd_queue = iot_os_queue_create(IOT_QUEUE_LENGTH, sizeof(struct iot_command));
+    context->cmd_queue = iot_os_queue_create(IOT_QUEUE_LENGTH, sizeof(struct iot_command *));
     server_cipher = _generate_server_cipher(context->es_crypto_cipher_info->iv, context->es_crypto_cipher_info->iv_len);
     in_payload = _generate_confirminfo_payload(server_cipher, OVF_BIT_BUTTON, NULL);
     out_payload = NULL;
@@ -0,0 +1,376 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <iot_main.h>
+#include <iot_easysetup.h>
+#include <iot_mem.h>
+
+#define UNUSED(x) (void**)(x)
+
+#define TEST_HTTPD_PORT             8888
+/* header buffer of the server, request line and headers have to fit in */
+#define TEST_HTTPD_RX_MAX           1024
+#define TEST_HTTPD_REPLY_MAX        1024
+#if defined(CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_MAX_BODY)
+#define TEST_HTTPD_MAX_BODY         CONFIG_STDK_IOT_CORE_EASYSETUP_HTTP_MAX_BODY
+#else
+#define TEST_HTTPD_MAX_BODY         4096
+#endif
+#define TEST_HTTPD_RECV_TIMEOUT_MS  3000
+#define TEST_HTTPD_CONNECT_RETRY    100
+
+/* unknown uri, answered with an error by http_packet_handle() without iot main task */
+#define TEST_HTTPD_GET      "GET /unknown HTTP/1.1\r\nHost: 192.168.4.1\r\n\r\n"
+
+struct test_httpd_reply {
+    char buf[TEST_HTTPD_REPLY_MAX];
+    int len;
+    bool conn_close;
+};
+
+int TC_iot_easysetup_httpd_setup(void **state)
+{
+    struct iot_context *context;
+
+    context = (struct iot_context *) malloc(sizeof(struct iot_context));
+    assert_non_null(context);
+    memset(context, '\0', sizeof(struct iot_context));
+
+    context->iot_events = iot_os_eventgroup_create();
+    assert_non_null(context->iot_events);
+    context->easysetup_req_queue = iot_os_queue_create(1, sizeof(struct iot_easysetup_payload *));
+    assert_non_null(context->easysetup_req_queue);
+    context->easysetup_resp_queue = iot_os_queue_create(1, sizeof(struct iot_easysetup_payload *));
+    assert_non_null(context->easysetup_resp_queue);
+    context->es_crypto_cipher_info = (iot_crypto_cipher_info_t *) malloc(sizeof(iot_crypto_cipher_info_t));
+    assert_non_null(context->es_crypto_cipher_info);
+    memset(context->es_crypto_cipher_info, '\0', sizeof(iot_crypto_cipher_info_t));
+
+    assert_int_equal(iot_easysetup_init(context), IOT_ERROR_NONE);
+
+    *state = context;
+    return 0;
+}
+
+int TC_iot_easysetup_httpd_teardown(void **state)
+{
+    struct iot_context *context = (struct iot_context *)*state;
+    struct iot_easysetup_payload *request;
+
+    iot_easysetup_deinit(context);
+
+    /* requests nobody has taken as there's no iot main task */
+    while (iot_os_queue_receive(context->easysetup_req_queue, (void **)&request, 0) == IOT_OS_TRUE)
+        iot_mem_free(IOT_MEM_TAG_EASYSETUP, request);
+
+    iot_os_queue_delete(context->easysetup_resp_queue);
+    iot_os_queue_delete(context->easysetup_req_queue);
+    iot_os_eventgroup_delete(context->iot_events);
+    free(context->es_crypto_cipher_info);
+    free(context);
+    return 0;
+}
+
+static int _test_httpd_connect(void)
+{
+    struct sockaddr_in addr;
+    struct timeval timeout;
+    int sock;
+    int i;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_HTTPD_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    /* server task may not be listening yet */
+    for (i = 0; i < TEST_HTTPD_CONNECT_RETRY; i++) {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        assert_true(sock >= 0);
+        if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            break;
+        close(sock);
+        sock = -1;
+        usleep(10 * 1000);
+    }
+    assert_true(sock >= 0);
+
+    timeout.tv_sec = TEST_HTTPD_RECV_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (TEST_HTTPD_RECV_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    return sock;
+}
+
+static void _test_httpd_send(int sock, const char *req, size_t len)
+{
+    assert_int_equal(send(sock, req, len, 0), (ssize_t)len);
+}
+
+/* Receives exactly one reply, framed by its Content-Length */
+static void _test_httpd_recv_reply(int sock, struct test_httpd_reply *reply)
+{
+    char *header_end = NULL;
+    char *content_len;
+    int header_len = 0, body_len = -1;
+    int rc;
+
+    memset(reply, 0, sizeof(*reply));
+    while (body_len < 0 || reply->len < header_len + body_len) {
+        rc = recv(sock, reply->buf + reply->len, (body_len < 0) ? 1 :
+                header_len + body_len - reply->len, 0);
+        assert_true(rc > 0);
+        reply->len += rc;
+
+        if (body_len < 0 && (header_end = strstr(reply->buf, "\r\n\r\n"))) {
+            header_len = header_end + 4 - reply->buf;
+            content_len = strstr(reply->buf, "Content-Length:");
+            assert_non_null(content_len);
+            body_len = atoi(content_len + strlen("Content-Length:"));
+        }
+        assert_true(reply->len < TEST_HTTPD_REPLY_MAX);
+    }
+
+    assert_true(!strncmp(reply->buf, "HTTP/1.1 ", strlen("HTTP/1.1 ")));
+    reply->conn_close = (strstr(reply->buf, "\r\nConnection: close\r\n") != NULL &&
+            strstr(reply->buf, "\r\nConnection: close\r\n") < header_end);
+}
+
+static void _test_httpd_expect_closed(int sock)
+{
+    char c;
+
+    assert_int_equal(recv(sock, &c, 1, 0), 0);
+}
+
+/* request on a connection which has been kept is served */
+static void _test_httpd_expect_kept(int sock)
+{
+    struct test_httpd_reply reply;
+
+    _test_httpd_send(sock, TEST_HTTPD_GET, strlen(TEST_HTTPD_GET));
+    _test_httpd_recv_reply(sock, &reply);
+    assert_false(reply.conn_close);
+}
+
+static void _test_httpd_expect_rejected(const char *req)
+{
+    struct test_httpd_reply reply;
+    int sock;
+
+    sock = _test_httpd_connect();
+    _test_httpd_send(sock, req, strlen(req));
+    _test_httpd_recv_reply(sock, &reply);
+    assert_true(reply.conn_close);
+    _test_httpd_expect_closed(sock);
+    close(sock);
+}
+
+void TC_iot_easysetup_httpd_content_length(void **state)
+{
+    struct test_httpd_reply reply;
+    char req[256];
+    int sock;
+    UNUSED(state);
+
+    // When: larger than the body limit
+    snprintf(req, sizeof(req), "POST /unknown HTTP/1.1\r\nContent-Length: %d\r\n\r\n",
+            TEST_HTTPD_MAX_BODY + 1);
+    // Then
+    _test_httpd_expect_rejected(req);
+    _test_httpd_expect_rejected("POST /unknown HTTP/1.1\r\nContent-Length: 99999999999999999999\r\n\r\n");
+
+    // When: not a number
+    // Then
+    _test_httpd_expect_rejected("POST /unknown HTTP/1.1\r\nContent-Length: 1a\r\n\r\n1a");
+    _test_httpd_expect_rejected("POST /unknown HTTP/1.1\r\nContent-Length: -1\r\n\r\n");
+    _test_httpd_expect_rejected("POST /unknown HTTP/1.1\r\nContent-Length: +2\r\n\r\n{}");
+    _test_httpd_expect_rejected("POST /unknown HTTP/1.1\r\nContent-Length:\r\n\r\n");
+    _test_httpd_expect_rejected("POST /unknown HTTP/1.1\r\nContent-Length: 1 2\r\n\r\n{}");
+
+    // When: duplicated with another value
+    // Then
+    _test_httpd_expect_rejected("POST /unknown HTTP/1.1\r\nContent-Length: 2\r\nContent-Length: 3\r\n\r\n{}");
+
+    // When: duplicated with same value
+    sock = _test_httpd_connect();
+    strcpy(req, "POST /unknown HTTP/1.1\r\nContent-Length: 2\r\ncontent-length: 2\r\n\r\n{}");
+    _test_httpd_send(sock, req, strlen(req));
+    _test_httpd_recv_reply(sock, &reply);
+    // Then: body is framed by it, connection is kept
+    assert_false(reply.conn_close);
+    _test_httpd_expect_kept(sock);
+    close(sock);
+}
+
+void TC_iot_easysetup_httpd_transfer_encoding(void **state)
+{
+    UNUSED(state);
+
+    // When: body has no length to frame it by
+    // Then
+    _test_httpd_expect_rejected("POST /unknown HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n2\r\n{}\r\n0\r\n\r\n");
+    _test_httpd_expect_rejected("POST /unknown HTTP/1.1\r\nContent-Length: 2\r\nTransfer-Encoding: chunked\r\n\r\n{}");
+}
+
+void TC_iot_easysetup_httpd_header_folding(void **state)
+{
+    UNUSED(state);
+
+    // When: obsolete line folding
+    // Then
+    _test_httpd_expect_rejected("GET /unknown HTTP/1.1\r\nHost: 192.168.4.1\r\nX-Folded: a\r\n b\r\n\r\n");
+    _test_httpd_expect_rejected("GET /unknown HTTP/1.1\r\nX-Folded: a\r\n\tContent-Length: 2\r\n\r\n{}");
+    // When: header without colon or name
+    // Then
+    _test_httpd_expect_rejected("GET /unknown HTTP/1.1\r\nHost 192.168.4.1\r\n\r\n");
+    _test_httpd_expect_rejected("GET /unknown HTTP/1.1\r\n: 192.168.4.1\r\n\r\n");
+    // When: broken request line
+    // Then
+    _test_httpd_expect_rejected("GET /unknown\r\n\r\n");
+    _test_httpd_expect_rejected("GET  HTTP/1.1\r\n\r\n");
+    _test_httpd_expect_rejected("GET /unknown HTTP/2.0\r\n\r\n");
+}
+
+void TC_iot_easysetup_httpd_header_too_large(void **state)
+{
+    char req[TEST_HTTPD_RX_MAX];
+    int len;
+    UNUSED(state);
+
+    // Given: fills the whole header buffer without the end of headers
+    len = snprintf(req, sizeof(req), "GET /unknown HTTP/1.1\r\nX-Pad: ");
+    memset(req + len, 'a', sizeof(req) - len);
+    req[sizeof(req) - 1] = '\0';
+
+    // When
+    // Then
+    _test_httpd_expect_rejected(req);
+}
+
+void TC_iot_easysetup_httpd_pipelined(void **state)
+{
+    struct test_httpd_reply reply;
+    const char req[] = TEST_HTTPD_GET
+            "POST /unknown HTTP/1.1\r\nContent-Length: 2\r\n\r\n{}"
+            TEST_HTTPD_GET;
+    int sock;
+    int i;
+    UNUSED(state);
+
+    // Given
+    sock = _test_httpd_connect();
+    // When: three requests in one segment
+    _test_httpd_send(sock, req, strlen(req));
+    // Then: each is answered in order, connection is kept
+    for (i = 0; i < 3; i++) {
+        _test_httpd_recv_reply(sock, &reply);
+        assert_false(reply.conn_close);
+    }
+    _test_httpd_expect_kept(sock);
+
+    // When: last of them asks to close
+    _test_httpd_send(sock, TEST_HTTPD_GET, strlen(TEST_HTTPD_GET));
+    _test_httpd_send(sock, "GET /unknown HTTP/1.1\r\nConnection: close\r\n\r\n",
+            strlen("GET /unknown HTTP/1.1\r\nConnection: close\r\n\r\n"));
+    // Then
+    _test_httpd_recv_reply(sock, &reply);
+    assert_false(reply.conn_close);
+    _test_httpd_recv_reply(sock, &reply);
+    assert_true(reply.conn_close);
+    _test_httpd_expect_closed(sock);
+    close(sock);
+}
+
+void TC_iot_easysetup_httpd_http10(void **state)
+{
+    struct test_httpd_reply reply;
+    const char req[] = "GET /unknown HTTP/1.0\r\n\r\n";
+    const char req_keep[] = "GET /unknown HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n";
+    int sock;
+    UNUSED(state);
+
+    // When: HTTP/1.0 without keep-alive
+    sock = _test_httpd_connect();
+    _test_httpd_send(sock, req, strlen(req));
+    // Then: closed after the reply, which says so
+    _test_httpd_recv_reply(sock, &reply);
+    assert_true(reply.conn_close);
+    _test_httpd_expect_closed(sock);
+    close(sock);
+
+    // When: HTTP/1.0 with keep-alive
+    sock = _test_httpd_connect();
+    _test_httpd_send(sock, req_keep, strlen(req_keep));
+    // Then
+    _test_httpd_recv_reply(sock, &reply);
+    assert_false(reply.conn_close);
+    _test_httpd_expect_kept(sock);
+    close(sock);
+}
+
+void TC_iot_easysetup_httpd_deinit_blocked(void **state)
+{
+    struct iot_context *context = (struct iot_context *)*state;
+    const char req[] = "GET " IOT_ES_URI_GET_LOGS_SYSTEMINFO " HTTP/1.1\r\n\r\n";
+    struct timespec start, end;
+    unsigned int elapsed_ms;
+    char buf[TEST_HTTPD_REPLY_MAX];
+    int sock;
+    int rc;
+
+    // Given: handler waits for iot main task, which never answers here
+    sock = _test_httpd_connect();
+    _test_httpd_send(sock, req, strlen(req));
+    usleep(500 * 1000);
+
+    // When: stopped from the task that would answer
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    iot_easysetup_deinit(context);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed_ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+
+    // Then: handler is released and the task has closed its connection
+    assert_true(elapsed_ms < TEST_HTTPD_RECV_TIMEOUT_MS);
+    do {
+        /* released handler may answer before the task sees the stop */
+        rc = recv(sock, buf, sizeof(buf), 0);
+    } while (rc > 0);
+    assert_int_equal(rc, 0);
+    close(sock);
+
+    // When: started again
+    assert_int_equal(iot_easysetup_init(context), IOT_ERROR_NONE);
+    // Then: served as before
+    sock = _test_httpd_connect();
+    _test_httpd_expect_kept(sock);
+    close(sock);
+}
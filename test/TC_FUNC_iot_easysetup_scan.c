@@ -0,0 +1,239 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <iot_error.h>
+#include <iot_main.h>
+#include <iot_easysetup.h>
+#include <iot_mem.h>
+#include <JSON.h>
+#include "TC_MOCK_functions.h"
+
+#define UNUSED(x)   (void**)(x)
+
+static void _set_scan_result(iot_wifi_scan_result_t *ap, uint8_t bssid_last, const char *ssid,
+                             int8_t rssi, uint16_t freq, iot_wifi_auth_mode_t authmode)
+{
+    uint8_t bssid[IOT_WIFI_MAX_BSSID_LEN] = { 0x00, 0x24, 0xb2, 0x10, 0x00, bssid_last };
+
+    memset(ap, 0, sizeof(iot_wifi_scan_result_t));
+    memcpy(ap->bssid, bssid, IOT_WIFI_MAX_BSSID_LEN);
+    strncpy((char *)ap->ssid, ssid, IOT_WIFI_MAX_SSID_LEN);
+    ap->rssi = rssi;
+    ap->freq = freq;
+    ap->authmode = authmode;
+}
+
+int TC_iot_easysetup_scan_setup(void **state)
+{
+    struct iot_context *context;
+
+    context = (struct iot_context *)malloc(sizeof(struct iot_context));
+    assert_non_null(context);
+    memset(context, '\0', sizeof(struct iot_context));
+
+    *state = context;
+    return 0;
+}
+
+int TC_iot_easysetup_scan_teardown(void **state)
+{
+    struct iot_context *context = (struct iot_context *)*state;
+
+    iot_easysetup_scan_stop(context);
+    assert_null(context->scan_cache);
+    if (context->scan_result)
+        iot_mem_free(IOT_MEM_TAG_CORE, context->scan_result);
+    free(context);
+
+    return 0;
+}
+
+void TC_iot_easysetup_scan_merge_bssid(void **state)
+{
+    iot_wifi_scan_result_t list[4];
+    uint16_t num;
+    UNUSED(state);
+
+    // Given: same BSSID reported twice, the second time stronger
+    _set_scan_result(&list[0], 0x01, "fakeSsid_01", -70, 2412, IOT_WIFI_AUTH_WPA2_PSK);
+    _set_scan_result(&list[1], 0x02, "fakeSsid_02", -60, 2437, IOT_WIFI_AUTH_OPEN);
+    _set_scan_result(&list[2], 0x01, "fakeSsid_01", -65, 2412, IOT_WIFI_AUTH_WPA2_PSK);
+    _set_scan_result(&list[3], 0x03, "fakeSsid_03", -80, 5180, IOT_WIFI_AUTH_WPA_WPA2_PSK);
+    // When
+    num = iot_easysetup_scan_merge(list, 4);
+    // Then: first found order is kept with the best rssi
+    assert_int_equal(num, 3);
+    assert_string_equal(list[0].ssid, "fakeSsid_01");
+    assert_int_equal(list[0].rssi, -65);
+    assert_string_equal(list[1].ssid, "fakeSsid_02");
+    assert_string_equal(list[2].ssid, "fakeSsid_03");
+
+    // Given: nothing to merge
+    // When
+    num = iot_easysetup_scan_merge(NULL, 4);
+    // Then
+    assert_int_equal(num, 0);
+}
+
+void TC_iot_easysetup_scan_merge_ssid(void **state)
+{
+    iot_wifi_scan_result_t list[5];
+    uint16_t num;
+    UNUSED(state);
+
+    // Given: a mesh network with three BSSIDs and two hidden APs
+    _set_scan_result(&list[0], 0x01, "fakeMesh", -72, 2412, IOT_WIFI_AUTH_WPA2_PSK);
+    _set_scan_result(&list[1], 0x10, "", -50, 2462, IOT_WIFI_AUTH_WPA2_PSK);
+    _set_scan_result(&list[2], 0x02, "fakeMesh", -48, 5180, IOT_WIFI_AUTH_WPA_WPA2_PSK);
+    _set_scan_result(&list[3], 0x11, "", -55, 2462, IOT_WIFI_AUTH_OPEN);
+    _set_scan_result(&list[4], 0x03, "fakeMesh", -61, 2437, IOT_WIFI_AUTH_WPA2_PSK);
+    // When
+    num = iot_easysetup_scan_merge(list, 5);
+    // Then: the mesh shows up once as its strongest AP, hidden ones aren't merged
+    assert_int_equal(num, 3);
+    assert_string_equal(list[0].ssid, "fakeMesh");
+    assert_int_equal(list[0].bssid[5], 0x02);
+    assert_int_equal(list[0].rssi, -48);
+    assert_int_equal(list[0].freq, 5180);
+    assert_int_equal(list[0].authmode, IOT_WIFI_AUTH_WPA_WPA2_PSK);
+    assert_int_equal(list[1].bssid[5], 0x10);
+    assert_int_equal(list[2].bssid[5], 0x11);
+}
+
+void TC_iot_easysetup_scan_serialize(void **state)
+{
+    iot_wifi_scan_result_t list[3];
+    iot_error_t err;
+    char *json = NULL;
+    JSON_H *root;
+    JSON_H *array;
+    JSON_H *item;
+    UNUSED(state);
+
+    // Given
+    _set_scan_result(&list[0], 0x01, "fakeSsid_01", -70, 2412, IOT_WIFI_AUTH_WPA2_PSK);
+    _set_scan_result(&list[1], 0x02, "fakeSsid_02", -60, 2437, IOT_WIFI_AUTH_WPA2_ENTERPRISE);
+    _set_scan_result(&list[2], 0x03, "fakeSsid_03", -80, 5180, IOT_WIFI_AUTH_OPEN);
+    // When
+    err = iot_easysetup_scan_serialize(list, 3, &json);
+    // Then: unsupported auth mode is left out
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_non_null(json);
+    root = JSON_PARSE(json);
+    assert_non_null(root);
+    array = JSON_GET_OBJECT_ITEM(root, "wifiScanInfo");
+    assert_non_null(array);
+    assert_int_equal(JSON_GET_ARRAY_SIZE(array), 2);
+    item = JSON_GET_ARRAY_ITEM(array, 1);
+    assert_string_equal(JSON_GET_STRING_VALUE(JSON_GET_OBJECT_ITEM(item, "bssid")), "00:24:B2:10:00:03");
+    assert_string_equal(JSON_GET_STRING_VALUE(JSON_GET_OBJECT_ITEM(item, "ssid")), "fakeSsid_03");
+    assert_int_equal(JSON_GET_OBJECT_ITEM(item, "rssi")->valueint, -80);
+    assert_int_equal(JSON_GET_OBJECT_ITEM(item, "frequency")->valueint, 5180);
+    assert_int_equal(JSON_GET_OBJECT_ITEM(item, "authType")->valueint, IOT_WIFI_AUTH_OPEN);
+
+    // Local teardown
+    JSON_DELETE(root);
+    JSON_FREE(json);
+
+    // Given: null list
+    json = NULL;
+    // When
+    err = iot_easysetup_scan_serialize(NULL, 3, &json);
+    // Then
+    assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+    assert_null(json);
+}
+
+void TC_iot_easysetup_scan_cache_success(void **state)
+{
+    iot_error_t err;
+    struct iot_context *context = (struct iot_context *)*state;
+    unsigned int generation = 0;
+    unsigned int generation_frozen = 0;
+    char *json = NULL;
+    char *payload = NULL;
+
+    // Given
+    will_return(__wrap_iot_bsp_wifi_get_scan_result, 20);
+    err = iot_easysetup_scan_start(context);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_non_null(context->scan_cache);
+    // When
+    err = iot_easysetup_scan_get(context, false, &generation, &json, &payload);
+    // Then: no payload is kept yet
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_not_equal(generation, 0);
+    assert_int_equal(context->scan_num, 20);
+    assert_non_null(context->scan_result);
+    assert_non_null(json);
+    assert_null(payload);
+    JSON_FREE(json);
+
+    // Given
+    err = iot_easysetup_scan_get(context, true, &generation_frozen, NULL, NULL);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    iot_easysetup_scan_set_payload(context, generation_frozen, "{\"message\":\"fakePayload\"}");
+    // When
+    err = iot_easysetup_scan_get(context, true, &generation, &json, &payload);
+    // Then: kept payload is returned instead of json
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(generation, generation_frozen);
+    assert_null(json);
+    assert_non_null(payload);
+    assert_string_equal(payload, "{\"message\":\"fakePayload\"}");
+    JSON_FREE(payload);
+
+    // Given: payload of other generation or dropped one
+    iot_easysetup_scan_set_payload(context, generation_frozen + 1, "{\"message\":\"fakePayload\"}");
+    // When
+    err = iot_easysetup_scan_get(context, true, &generation, &json, &payload);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_non_null(json);
+    assert_null(payload);
+    JSON_FREE(json);
+}
+
+void TC_iot_easysetup_scan_cache_no_ap(void **state)
+{
+    iot_error_t err;
+    struct iot_context *context = (struct iot_context *)*state;
+    char *json = NULL;
+
+    // Given
+    will_return(__wrap_iot_bsp_wifi_get_scan_result, 0);
+    err = iot_easysetup_scan_start(context);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    // When
+    err = iot_easysetup_scan_get(context, true, NULL, &json, NULL);
+    // Then
+    assert_int_equal(err, IOT_ERROR_EASYSETUP_WIFI_SCAN_NOT_FOUND);
+    assert_null(json);
+    assert_int_equal(context->scan_num, 0);
+
+    // Given: no cache
+    iot_easysetup_scan_stop(context);
+    // When
+    err = iot_easysetup_scan_get(context, true, NULL, &json, NULL);
+    // Then
+    assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+}
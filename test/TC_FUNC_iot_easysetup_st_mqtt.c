@@ -0,0 +1,301 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <iot_error.h>
+#include <iot_main.h>
+#include <iot_internal.h>
+#include <iot_nv_data.h>
+#include <iot_mqtt_client.h>
+#include "TC_MOCK_functions.h"
+
+#define UNUSED(x) (void**)(x)
+
+#define SAMPLE_PRIVATE_KEY  "ztqmQ24u86J9bpFLjaoMfwauUZwKLjUIGsnrDwwnDM8="
+#define SAMPLE_PUBLIC_KEY   "BKb7+m1Mo8OuMsodM91ohz/+rZKDc/otzUPSn4UkCUk="
+
+static char sample_device_info[] = {
+        "{\n"
+        "\t\"deviceInfo\": {\n"
+        "\t\t\"firmwareVersion\": \"testFirmwareVersion\",\n"
+        "\t\t\"privateKey\": \""SAMPLE_PRIVATE_KEY"\",\n"
+        "\t\t\"publicKey\": \""SAMPLE_PUBLIC_KEY"\",\n"
+        "\t\t\"serialNumber\": \"STDKtESt7968d226\"\n"
+        "\t}\n"
+        "}"
+};
+
+static long _elapsed_us(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000L;
+}
+
+int TC_iot_easysetup_st_mqtt_setup(void **state)
+{
+    iot_error_t err;
+    struct iot_context *ctx;
+
+#if !defined(CONFIG_STDK_IOT_CORE_SUPPORT_STNV_PARTITION)
+    err = iot_nv_init((unsigned char *)sample_device_info, strlen(sample_device_info));
+#else
+    err = iot_nv_init(NULL, 0);
+#endif
+    assert_int_equal(err, IOT_ERROR_NONE);
+
+    ctx = calloc(1, sizeof(struct iot_context));
+    assert_non_null(ctx);
+    ctx->devconf.pk_type = IOT_CRYPTO_PK_ED25519;
+    ctx->prov_data.cloud.broker_url = strdup("mock.broker.local");
+    ctx->prov_data.cloud.broker_port = 8883;
+    strncpy(ctx->iot_reg_data.deviceId, "c236f527-5d8d-4d0b-86f6-0add22717f0e", IOT_REG_UUID_STR_LEN);
+    ctx->iot_reg_data.updated = true;
+
+    set_mock_net_fault(false);
+    set_mock_net_session_present(false);
+    reset_mock_net_count();
+
+    *state = ctx;
+    return 0;
+}
+
+int TC_iot_easysetup_st_mqtt_teardown(void **state)
+{
+    iot_error_t err;
+    struct iot_context *ctx = (struct iot_context *)*state;
+
+    set_mock_net_fault(false);
+    if (ctx->evt_mqttcli)
+        iot_es_disconnect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    iot_es_release_warm_data(ctx);
+    free(ctx->prov_data.cloud.broker_url);
+    free(ctx);
+
+    err = iot_nv_deinit();
+    assert_int_equal(err, IOT_ERROR_NONE);
+    return 0;
+}
+
+void TC_iot_es_connect_warm_reconnect(void **state)
+{
+    iot_error_t err;
+    struct iot_context *ctx = (struct iot_context *)*state;
+    struct iot_mac sample_mac = { .addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+    st_mqtt_client first_cli;
+    void *first_key;
+    char client_id[IOT_MQTT_CLIENT_ID_LEN];
+    struct timespec start;
+    long cold_us;
+    long warm_us;
+
+    // Given: mac is read only once for the client id
+    will_return(__wrap_iot_bsp_wifi_get_mac, cast_ptr_to_largest_integral_type(sample_mac.addr));
+    will_return(__wrap_iot_bsp_wifi_get_mac, IOT_ERROR_NONE);
+
+    // When: cold connect
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    cold_us = _elapsed_us(&start);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_non_null(ctx->evt_mqttcli);
+    assert_non_null(ctx->mqtt_event_topic);
+    assert_int_equal(get_mock_net_connect_count(), 1);
+    assert_int_equal(get_mock_net_subscribe_count(), 1);
+    assert_int_equal(get_mock_net_subscribe_filter_count(), 2);
+    first_cli = ctx->evt_mqttcli;
+    memcpy(client_id, ctx->mqtt_warm.client_id, sizeof(client_id));
+    first_key = ctx->mqtt_warm.pk_ctx.key;
+    assert_non_null(first_key);
+
+    // When: link drops, main task sees yield failure and disconnects
+    set_mock_net_fault(true);
+    assert_true(st_mqtt_yield(ctx->evt_mqttcli, 0) < 0);
+    err = iot_es_disconnect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    set_mock_net_fault(false);
+    // Then: client is parked for warm reconnect
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_null(ctx->evt_mqttcli);
+    assert_null(ctx->mqtt_event_topic);
+    assert_ptr_equal(ctx->mqtt_warm.mqttcli, first_cli);
+
+    // When: warm reconnect
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    warm_us = _elapsed_us(&start);
+    // Then: same client and client id, clean session needs subscriptions again
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_ptr_equal(ctx->evt_mqttcli, first_cli);
+    assert_null(ctx->mqtt_warm.mqttcli);
+    assert_memory_equal(ctx->mqtt_warm.client_id, client_id, sizeof(client_id));
+    assert_ptr_equal(ctx->mqtt_warm.pk_ctx.key, first_key);
+    assert_non_null(strstr(ctx->mqtt_event_topic, ctx->iot_reg_data.deviceId));
+    assert_int_equal(get_mock_net_connect_count(), 2);
+    assert_int_equal(get_mock_net_subscribe_count(), 2);
+    assert_int_equal(get_mock_net_subscribe_filter_count(), 4);
+
+    print_message("time-to-reconnected : cold %ld us, warm %ld us\n", cold_us, warm_us);
+}
+
+static void _reconnect(struct iot_context *ctx)
+{
+    iot_error_t err;
+
+    set_mock_net_fault(true);
+    assert_true(st_mqtt_yield(ctx->evt_mqttcli, 0) < 0);
+    err = iot_es_disconnect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    set_mock_net_fault(false);
+
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    assert_int_equal(err, IOT_ERROR_NONE);
+}
+
+void TC_iot_es_connect_persistent_session(void **state)
+{
+    iot_error_t err;
+    struct iot_context *ctx = (struct iot_context *)*state;
+    struct iot_mac sample_mac = { .addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+    unsigned int batched_trips;
+    unsigned int resumed_trips;
+    unsigned int count;
+
+    // Given: persistent session and server keeps it
+    will_return(__wrap_iot_bsp_wifi_get_mac, cast_ptr_to_largest_integral_type(sample_mac.addr));
+    will_return(__wrap_iot_bsp_wifi_get_mac, IOT_ERROR_NONE);
+    ctx->mqtt_warm.persistent_session = true;
+    set_mock_net_session_present(true);
+
+    // When: cold connect
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    // Then: new client has no handlers, so subscribes anyway
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(get_mock_net_subscribe_count(), 1);
+
+    // When: warm reconnect, server resumes session
+    count = get_mock_net_connect_count() + get_mock_net_subscribe_count();
+    _reconnect(ctx);
+    // Then: no subscription and handlers are kept
+    assert_int_equal(get_mock_net_connect_count(), 2);
+    assert_int_equal(get_mock_net_subscribe_count(), 1);
+    assert_non_null(((MQTTClient *)ctx->evt_mqttcli)->subscriptions);
+    resumed_trips = get_mock_net_connect_count() + get_mock_net_subscribe_count() - count;
+
+    // When: server lost the session
+    set_mock_net_session_present(false);
+    count = get_mock_net_connect_count() + get_mock_net_subscribe_count();
+    _reconnect(ctx);
+    // Then: subscribes both topics with one packet
+    assert_int_equal(get_mock_net_subscribe_count(), 2);
+    assert_int_equal(get_mock_net_subscribe_filter_count(), 4);
+    batched_trips = get_mock_net_connect_count() + get_mock_net_subscribe_count() - count;
+
+    // When: device gets new deviceId, resumed session has old topics
+    set_mock_net_session_present(true);
+    strncpy(ctx->iot_reg_data.deviceId, "00000000-5d8d-4d0b-86f6-0add22717f0e", IOT_REG_UUID_STR_LEN);
+    _reconnect(ctx);
+    // Then
+    assert_int_equal(get_mock_net_subscribe_count(), 3);
+    assert_non_null(strstr(ctx->mqtt_event_topic, "00000000-5d8d"));
+
+    print_message("round trips per reconnect : separated 3, batched %u, resumed %u\n",
+            batched_trips, resumed_trips);
+}
+
+void TC_iot_es_connect_warm_reconnect_failure(void **state)
+{
+    iot_error_t err;
+    struct iot_context *ctx = (struct iot_context *)*state;
+    struct iot_mac sample_mac = { .addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+    st_mqtt_client first_cli;
+
+    // Given: persistent session is resumed once
+    will_return(__wrap_iot_bsp_wifi_get_mac, cast_ptr_to_largest_integral_type(sample_mac.addr));
+    will_return(__wrap_iot_bsp_wifi_get_mac, IOT_ERROR_NONE);
+    ctx->mqtt_warm.persistent_session = true;
+    set_mock_net_session_present(true);
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    first_cli = ctx->evt_mqttcli;
+    set_mock_net_fault(true);
+    assert_true(st_mqtt_yield(ctx->evt_mqttcli, 0) < 0);
+    err = iot_es_disconnect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    assert_int_equal(err, IOT_ERROR_NONE);
+
+    // When: warm reconnect fails while network is still down
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    // Then: client is parked again with its handlers
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+    assert_null(ctx->evt_mqttcli);
+    assert_ptr_equal(ctx->mqtt_warm.mqttcli, first_cli);
+    assert_non_null(((MQTTClient *)first_cli)->subscriptions);
+
+    // When: network is back
+    set_mock_net_fault(false);
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    // Then: still warm, resumed session needs no subscription
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_ptr_equal(ctx->evt_mqttcli, first_cli);
+    assert_null(ctx->mqtt_warm.mqttcli);
+    assert_int_equal(get_mock_net_connect_count(), 2);
+    assert_int_equal(get_mock_net_subscribe_count(), 1);
+}
+
+void TC_iot_es_connect_warm_subscribe_failure(void **state)
+{
+    iot_error_t err;
+    struct iot_context *ctx = (struct iot_context *)*state;
+    struct iot_mac sample_mac = { .addr = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 } };
+    st_mqtt_client first_cli;
+    unsigned int disconnect_count;
+
+    // Given: client is parked after first connection
+    will_return(__wrap_iot_bsp_wifi_get_mac, cast_ptr_to_largest_integral_type(sample_mac.addr));
+    will_return(__wrap_iot_bsp_wifi_get_mac, IOT_ERROR_NONE);
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    first_cli = ctx->evt_mqttcli;
+    err = iot_es_disconnect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    assert_int_equal(err, IOT_ERROR_NONE);
+    disconnect_count = get_mock_net_disconnect_count();
+
+    // When: broker refuses subscription on warm reconnect
+    set_mock_net_suback_refused(true);
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    // Then: disconnected once and parked again
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(get_mock_net_disconnect_count(), disconnect_count + 1);
+    assert_null(ctx->evt_mqttcli);
+    assert_ptr_equal(ctx->mqtt_warm.mqttcli, first_cli);
+    assert_false(((MQTTClient *)first_cli)->isconnected);
+
+    // When: broker accepts it again
+    set_mock_net_suback_refused(false);
+    err = iot_es_connect(ctx, IOT_CONNECT_TYPE_COMMUNICATION);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_ptr_equal(ctx->evt_mqttcli, first_cli);
+}
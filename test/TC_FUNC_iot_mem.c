@@ -0,0 +1,229 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <stdlib.h>
+#include <iot_error.h>
+#include <iot_mem.h>
+#include "TC_MOCK_functions.h"
+
+#define UNUSED(x) (void**)(x)
+
+static int test_alloc_count;
+static int test_dealloc_count;
+
+static void *test_alloc(size_t size)
+{
+    test_alloc_count++;
+    return malloc(size);
+}
+
+static void test_dealloc(void *ptr)
+{
+    test_dealloc_count++;
+    free(ptr);
+}
+
+void TC_iot_mem_stats(void **state)
+{
+    iot_mem_stats_t before;
+    iot_mem_stats_t after;
+    iot_mem_stats_t other;
+    void *ptr[3];
+    int i;
+    UNUSED(state);
+
+    // Given
+    assert_int_equal(iot_mem_get_stats(IOT_MEM_TAG_CRYPTO, &before), IOT_ERROR_NONE);
+    assert_int_equal(iot_mem_get_stats(IOT_MEM_TAG_NV, &other), IOT_ERROR_NONE);
+
+    // When: 3 allocations and 2 frees
+    for (i = 0; i < 3; i++) {
+        ptr[i] = iot_mem_malloc(IOT_MEM_TAG_CRYPTO, 100);
+        assert_non_null(ptr[i]);
+    }
+    iot_mem_free(IOT_MEM_TAG_CRYPTO, ptr[0]);
+    iot_mem_free(IOT_MEM_TAG_CRYPTO, ptr[1]);
+    assert_int_equal(iot_mem_get_stats(IOT_MEM_TAG_CRYPTO, &after), IOT_ERROR_NONE);
+    // Then
+    assert_int_equal(after.alloc_cnt - before.alloc_cnt, 3);
+    assert_int_equal(after.alloc_bytes - before.alloc_bytes, 300);
+    assert_int_equal(after.live, before.live + 1);
+    assert_true(after.peak >= before.live + 3);
+
+    // When: malloc failed
+    set_mock_iot_os_malloc_failure();
+    assert_null(iot_mem_malloc(IOT_MEM_TAG_CRYPTO, 1000));
+    do_not_use_mock_iot_os_malloc_failure();
+    // Then: only failure is counted
+    assert_int_equal(iot_mem_get_stats(IOT_MEM_TAG_CRYPTO, &before), IOT_ERROR_NONE);
+    assert_int_equal(before.fail_cnt, after.fail_cnt + 1);
+    assert_int_equal(before.alloc_cnt, after.alloc_cnt);
+    assert_int_equal(before.live, after.live);
+
+    // Then: other tag is not touched
+    assert_int_equal(iot_mem_get_stats(IOT_MEM_TAG_NV, &after), IOT_ERROR_NONE);
+    assert_memory_equal(&after, &other, sizeof(iot_mem_stats_t));
+
+    // Teardown
+    iot_mem_free(IOT_MEM_TAG_CRYPTO, ptr[2]);
+}
+
+void TC_iot_mem_get_stats_invalid_parameters(void **state)
+{
+    iot_mem_stats_t stats;
+    UNUSED(state);
+
+    // When: null stats
+    assert_int_equal(iot_mem_get_stats(IOT_MEM_TAG_CORE, NULL), IOT_ERROR_INVALID_ARGS);
+    // When: unknown tag
+    assert_int_equal(iot_mem_get_stats(IOT_MEM_TAG_MAX, &stats), IOT_ERROR_INVALID_ARGS);
+}
+
+void TC_iot_mem_calloc_realloc_strdup(void **state)
+{
+    const char sample_str[] = "STDK memory";
+    unsigned char zero[256];
+    unsigned char *buf;
+    unsigned char *tmp;
+    char *str;
+    UNUSED(state);
+
+    // When: calloc
+    buf = iot_mem_calloc(IOT_MEM_TAG_CORE, 16, sizeof(zero) / 16);
+    // Then: zero filled
+    assert_non_null(buf);
+    memset(zero, 0, sizeof(zero));
+    assert_memory_equal(buf, zero, sizeof(zero));
+
+    // When: grow
+    memset(buf, 'a', sizeof(zero));
+    tmp = iot_mem_realloc(IOT_MEM_TAG_CORE, buf, sizeof(zero), 1024);
+    assert_non_null(tmp);
+    buf = tmp;
+    // Then: contents are kept
+    memset(zero, 'a', sizeof(zero));
+    assert_memory_equal(buf, zero, sizeof(zero));
+
+    // When: shrink
+    tmp = iot_mem_realloc(IOT_MEM_TAG_CORE, buf, 1024, 8);
+    assert_non_null(tmp);
+    buf = tmp;
+    // Then
+    assert_memory_equal(buf, zero, 8);
+    iot_mem_free(IOT_MEM_TAG_CORE, buf);
+
+    // When: overflow of calloc
+    // Then
+    assert_null(iot_mem_calloc(IOT_MEM_TAG_CORE, (size_t)-1, 2));
+
+    // When: strdup
+    str = iot_mem_strdup(IOT_MEM_TAG_CORE, sample_str);
+    // Then
+    assert_non_null(str);
+    assert_string_equal(str, sample_str);
+    assert_null(iot_mem_strdup(IOT_MEM_TAG_CORE, NULL));
+
+    // Teardown
+    iot_mem_free(IOT_MEM_TAG_CORE, str);
+    iot_mem_free(IOT_MEM_TAG_CORE, NULL);
+}
+
+void TC_iot_mem_set_allocator(void **state)
+{
+    const iot_mem_allocator_t allocator = { test_alloc, test_dealloc };
+    const iot_mem_allocator_t wrong_allocator = { test_alloc, NULL };
+    void *ptr;
+    UNUSED(state);
+
+    // Given
+    test_alloc_count = 0;
+    test_dealloc_count = 0;
+
+    // When: custom backend
+    iot_mem_set_allocator(&allocator);
+    ptr = iot_mem_malloc(IOT_MEM_TAG_MQTT, 1024);
+    iot_mem_free(IOT_MEM_TAG_MQTT, ptr);
+    // Then
+    assert_non_null(ptr);
+    assert_int_equal(test_alloc_count, 1);
+    assert_int_equal(test_dealloc_count, 1);
+
+    // When: incomplete backend
+    iot_mem_set_allocator(&wrong_allocator);
+    ptr = iot_mem_malloc(IOT_MEM_TAG_MQTT, 1024);
+    iot_mem_free(IOT_MEM_TAG_MQTT, ptr);
+    // Then: default backend is used
+    assert_non_null(ptr);
+    assert_int_equal(test_alloc_count, 1);
+    assert_int_equal(test_dealloc_count, 1);
+
+    // Teardown
+    iot_mem_set_allocator(NULL);
+}
+
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+void TC_iot_mem_pool(void **state)
+{
+    const iot_mem_allocator_t allocator = { test_alloc, test_dealloc };
+    iot_mem_stats_t before;
+    iot_mem_stats_t after;
+    unsigned char *ptr;
+    unsigned char *tmp;
+    UNUSED(state);
+
+    // Given
+    test_alloc_count = 0;
+    test_dealloc_count = 0;
+    iot_mem_set_allocator(&allocator);
+    assert_int_equal(iot_mem_get_stats(IOT_MEM_TAG_CAP, &before), IOT_ERROR_NONE);
+
+    // When: small allocation
+    ptr = iot_mem_malloc(IOT_MEM_TAG_CAP, 20);
+    assert_non_null(ptr);
+    memset(ptr, 'p', 20);
+    // Then: served by the pools
+    assert_int_equal(test_alloc_count, 0);
+
+    // When: grow in the same class
+    tmp = iot_mem_realloc(IOT_MEM_TAG_CAP, ptr, 20, 32);
+    // Then: kept in place
+    assert_ptr_equal(tmp, ptr);
+
+    // When: grow out of the pools
+    tmp = iot_mem_realloc(IOT_MEM_TAG_CAP, ptr, 32, 512);
+    assert_non_null(tmp);
+    ptr = tmp;
+    // Then: moved to the heap backend with contents
+    assert_int_equal(test_alloc_count, 1);
+    assert_int_equal(ptr[0], 'p');
+    assert_int_equal(ptr[19], 'p');
+    iot_mem_free(IOT_MEM_TAG_CAP, ptr);
+    assert_int_equal(test_dealloc_count, 1);
+
+    assert_int_equal(iot_mem_get_stats(IOT_MEM_TAG_CAP, &after), IOT_ERROR_NONE);
+    assert_int_equal(after.pool_cnt - before.pool_cnt, 1);
+    assert_int_equal(after.live, before.live);
+
+    // Teardown
+    iot_mem_set_allocator(NULL);
+}
+#endif
@@ -0,0 +1,205 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdarg.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iot_main.h>
+#include <iot_mqtt_client.h>
+#include "TC_MOCK_functions.h"
+
+#define UNUSED(x) (void**)(x)
+
+#define TEST_EVENT_NUM      16
+#define TEST_EVENT_TOPIC    "/v1/deviceEvents/0fc9ae2b-3bfb-4c53-a7a5-1a4c94b1b1a3"
+#define TEST_EVENT_PAYLOAD  "{\"deviceEvents\":[{\"component\":\"main\",\"capability\":\"switch\"," \
+                            "\"attribute\":\"switch\",\"value\":\"on\"}]}"
+
+static st_mqtt_broker_info_t test_broker = { "localhost", 8883, NULL, 0, 0 };
+
+int TC_iot_mqtt_client_setup(void **state)
+{
+    UNUSED(state);
+
+    set_mock_net_fault(false);
+    set_mock_net_session_present(false);
+    set_mock_net_writev(true);
+    reset_mock_net_count();
+    return 0;
+}
+
+int TC_iot_mqtt_client_teardown(void **state)
+{
+    UNUSED(state);
+
+    set_mock_net_writev(true);
+    reset_mock_net_count();
+    return 0;
+}
+
+static void _connect_client(st_mqtt_client *client)
+{
+    st_mqtt_connect_data conn_data = st_mqtt_connect_data_initializer;
+
+    conn_data.clientid = "0fc9ae2b-3bfb-4c53-a7a5-1a4c94b1b1a3";
+    assert_int_equal(st_mqtt_create(client, 1000), 0);
+    assert_int_equal(st_mqtt_connect(*client, &test_broker, &conn_data), 0);
+}
+
+static void _init_event(st_mqtt_msg *msg)
+{
+    memset(msg, 0, sizeof(st_mqtt_msg));
+    msg->qos = st_mqtt_qos1;
+    msg->topic = TEST_EVENT_TOPIC;
+    msg->payload = TEST_EVENT_PAYLOAD;
+    msg->payloadlen = strlen(TEST_EVENT_PAYLOAD);
+}
+
+/* Returns the number of records written for TEST_EVENT_NUM events */
+static unsigned int _publish_events(bool batch)
+{
+    st_mqtt_client client;
+    st_mqtt_msg msgs[TEST_EVENT_NUM];
+    MQTTString topic = MQTTString_initializer;
+    unsigned int writes, bytes;
+    int i;
+
+    _connect_client(&client);
+    for (i = 0; i < TEST_EVENT_NUM; i++)
+        _init_event(&msgs[i]);
+
+    writes = get_mock_net_write_count();
+    bytes = get_mock_net_publish_bytes();
+    if (batch) {
+        assert_int_equal(st_mqtt_publish_many(client, msgs, TEST_EVENT_NUM), 0);
+    } else {
+        for (i = 0; i < TEST_EVENT_NUM; i++)
+            assert_int_equal(st_mqtt_publish(client, &msgs[i]), 0);
+    }
+    writes = get_mock_net_write_count() - writes;
+    bytes = get_mock_net_publish_bytes() - bytes;
+
+    // every publish reached broker whole
+    topic.cstring = TEST_EVENT_TOPIC;
+    assert_int_equal(bytes, TEST_EVENT_NUM * MQTTSerialize_publish_size(1, topic, strlen(TEST_EVENT_PAYLOAD)));
+    assert_string_equal(get_mock_net_publish_topic(), TEST_EVENT_TOPIC);
+
+    st_mqtt_disconnect(client);
+    st_mqtt_destroy(client);
+    return writes;
+}
+
+void TC_st_mqtt_publish_writev(void **state)
+{
+    unsigned int split, gathered, batched;
+    UNUSED(state);
+
+    // When: network has no writev
+    set_mock_net_writev(false);
+    split = _publish_events(false);
+    // Then: header and payload are written separately
+    assert_int_equal(split, 2 * TEST_EVENT_NUM);
+
+    // When: network has writev
+    set_mock_net_writev(true);
+    gathered = _publish_events(false);
+    // Then: one record for each event
+    assert_int_equal(gathered, TEST_EVENT_NUM);
+
+    // When: events are published together
+    batched = _publish_events(true);
+    // Then: one record for each st_mqtt_publish_max_msgs events
+    assert_int_equal(batched, (TEST_EVENT_NUM + st_mqtt_publish_max_msgs - 1) / st_mqtt_publish_max_msgs);
+
+    print_message("records per event : write %.2f, writev %.2f, batched writev %.2f\n",
+            (float)split / TEST_EVENT_NUM, (float)gathered / TEST_EVENT_NUM, (float)batched / TEST_EVENT_NUM);
+}
+
+void TC_st_mqtt_publish_many_failure(void **state)
+{
+    st_mqtt_client client;
+    st_mqtt_msg msgs[3];
+    int i;
+    UNUSED(state);
+
+    _connect_client(&client);
+    for (i = 0; i < 3; i++)
+        _init_event(&msgs[i]);
+
+    // When: invalid arguments
+    // Then
+    assert_int_equal(st_mqtt_publish_many(client, NULL, 3), E_ST_MQTT_FAILURE);
+    assert_int_equal(st_mqtt_publish_many(client, msgs, 0), E_ST_MQTT_FAILURE);
+
+    // When: network fails while batch is written
+    set_mock_net_fault(true);
+    // Then: failure is reported, not partial success
+    assert_int_equal(st_mqtt_publish_many(client, msgs, 3), E_ST_MQTT_FAILURE);
+    set_mock_net_fault(false);
+
+    // When: mixed QoS in a batch
+    msgs[1].qos = st_mqtt_qos0;
+    // Then: only QoS1 events wait for PUBACK
+    assert_int_equal(st_mqtt_publish_many(client, msgs, 3), 0);
+
+    st_mqtt_disconnect(client);
+    st_mqtt_destroy(client);
+}
+
+void TC_st_mqtt_stats(void **state)
+{
+    st_mqtt_client client;
+    st_mqtt_stats stats;
+    st_mqtt_msg msgs[TEST_EVENT_NUM];
+    unsigned int bytes;
+    int i;
+    UNUSED(state);
+
+    // Given
+    memset(&stats, 0, sizeof(stats));
+    for (i = 0; i < TEST_EVENT_NUM; i++)
+        _init_event(&msgs[i]);
+    _connect_client(&client);
+    st_mqtt_set_stats(client, &stats);
+
+    // When
+    bytes = get_mock_net_publish_bytes();
+    assert_int_equal(st_mqtt_publish_many(client, msgs, TEST_EVENT_NUM), 0);
+    bytes = get_mock_net_publish_bytes() - bytes;
+    // Then: every byte written and one PUBACK for each event are counted
+    assert_int_equal(stats.bytes_out, bytes);
+    assert_true(stats.bytes_in >= TEST_EVENT_NUM * 4);
+    assert_int_equal(stats.puback_timeout_cnt, 0);
+    assert_int_equal(stats.publish_retry_cnt, 0);
+
+    // When: counting is stopped
+    memset(&stats, 0, sizeof(stats));
+    st_mqtt_set_stats(client, NULL);
+    assert_int_equal(st_mqtt_publish_many(client, msgs, TEST_EVENT_NUM), 0);
+    // Then
+    assert_int_equal(stats.bytes_out, 0);
+    assert_int_equal(stats.bytes_in, 0);
+
+    st_mqtt_disconnect(client);
+    st_mqtt_destroy(client);
+}
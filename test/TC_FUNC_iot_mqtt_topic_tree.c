@@ -0,0 +1,304 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <iot_main.h>
+#include <iot_mqtt_client.h>
+
+#define UNUSED(x) (void**)(x)
+
+#define TEST_FILTER_NUM     500
+#define TEST_MESSAGE_NUM    20000
+
+struct test_delivery {
+    int count;
+    int last_id;
+    int hit[TEST_FILTER_NUM + 8];
+};
+
+static struct test_delivery delivery;
+static int handler_ids[TEST_FILTER_NUM + 8];
+
+static void _test_handler(st_mqtt_msg *message, void *user_data)
+{
+    int id = *(int *)user_data;
+
+    (void)message;
+    delivery.count++;
+    delivery.last_id = id;
+    delivery.hit[id]++;
+}
+
+static int _deliver(MQTTTopicNode *root, const char *topic)
+{
+    st_mqtt_msg msg;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&delivery, 0, sizeof(delivery));
+    msg.topic = (void *)topic;
+    msg.topiclen = strlen(topic);
+
+    return MQTTTopicTree_deliver(root, &msg);
+}
+
+static void _set_ids(void)
+{
+    int i;
+
+    for (i = 0; i < TEST_FILTER_NUM + 8; i++)
+        handler_ids[i] = i;
+}
+
+// previous per-slot matcher of MQTT client, kept as reference
+static char _linear_matched(const char *curf, const char *curn, const char *curn_end)
+{
+    while (*curf && curn < curn_end) {
+        if (*curn == '/' && *curf != '/')
+            break;
+        if (*curf != '+' && *curf != '#' && *curf != *curn)
+            break;
+        if (*curf == '+') {
+            const char *nextpos = curn + 1;
+            while (nextpos < curn_end && *nextpos != '/')
+                nextpos = ++curn + 1;
+        } else if (*curf == '#') {
+            curn = curn_end - 1;
+        }
+        curf++;
+        curn++;
+    }
+
+    return (curn == curn_end) && (*curf == '\0');
+}
+
+void TC_MQTTTopicTree_deliver_wildcards(void **state)
+{
+    MQTTTopicNode *root = NULL;
+    int count;
+    UNUSED(state);
+
+    // Given
+    _set_ids();
+    assert_int_equal(MQTTTopicTree_add(&root, "a/b/c", _test_handler, &handler_ids[0]), 0);
+    assert_int_equal(MQTTTopicTree_add(&root, "a/+/c", _test_handler, &handler_ids[1]), 0);
+    assert_int_equal(MQTTTopicTree_add(&root, "a/#", _test_handler, &handler_ids[2]), 0);
+    assert_int_equal(MQTTTopicTree_add(&root, "#", _test_handler, &handler_ids[3]), 0);
+    assert_int_equal(MQTTTopicTree_add(&root, "+/+", _test_handler, &handler_ids[4]), 0);
+    assert_int_equal(MQTTTopicTree_add(&root, "/x", _test_handler, &handler_ids[5]), 0);
+
+    // When: exact, '+' and '#' filters match the same topic
+    count = _deliver(root, "a/b/c");
+    // Then: every matching handler is called once
+    assert_int_equal(count, 4);
+    assert_int_equal(delivery.count, 4);
+    assert_int_equal(delivery.hit[0], 1);
+    assert_int_equal(delivery.hit[1], 1);
+    assert_int_equal(delivery.hit[2], 1);
+    assert_int_equal(delivery.hit[3], 1);
+
+    // When: '#' also matches parent level
+    count = _deliver(root, "a");
+    // Then
+    assert_int_equal(count, 2);
+    assert_int_equal(delivery.hit[2], 1);
+    assert_int_equal(delivery.hit[3], 1);
+
+    // When: '+' matches a level only
+    count = _deliver(root, "a/bb/c/d");
+    // Then
+    assert_int_equal(count, 2);
+    assert_int_equal(delivery.hit[1], 0);
+
+    // When: empty levels
+    count = _deliver(root, "/x");
+    // Then: "+/+", "/x" and "#"
+    assert_int_equal(count, 3);
+    assert_int_equal(delivery.hit[4], 1);
+    assert_int_equal(delivery.hit[5], 1);
+
+    // When: system topic
+    count = _deliver(root, "$SYS/a");
+    // Then: wildcards at first level don't match
+    assert_int_equal(count, 0);
+
+    MQTTTopicTree_free(&root);
+    assert_null(root);
+}
+
+void TC_MQTTTopicTree_add_invalid_filters(void **state)
+{
+    MQTTTopicNode *root = NULL;
+    const char *invalid[] = { "", "a/#/b", "a+", "+a/b", "a/b#", "##", NULL };
+    int i;
+    UNUSED(state);
+
+    _set_ids();
+    for (i = 0; invalid[i]; i++) {
+        // When
+        assert_int_equal(MQTTTopicTree_add(&root, invalid[i], _test_handler, &handler_ids[0]), E_ST_MQTT_FAILURE);
+        // Then: nothing is left
+        assert_null(root);
+    }
+
+    // When: NULL handler or filter
+    assert_int_equal(MQTTTopicTree_add(&root, "a", NULL, NULL), E_ST_MQTT_FAILURE);
+    assert_int_equal(MQTTTopicTree_add(&root, NULL, _test_handler, NULL), E_ST_MQTT_FAILURE);
+    assert_int_equal(MQTTTopicTree_remove(&root, "a"), E_ST_MQTT_FAILURE);
+    assert_int_equal(MQTTTopicTree_deliver(NULL, NULL), 0);
+}
+
+void TC_MQTTTopicTree_remove_and_replace(void **state)
+{
+    MQTTTopicNode *root = NULL;
+    UNUSED(state);
+
+    // Given
+    _set_ids();
+    assert_int_equal(MQTTTopicTree_add(&root, "a/b", _test_handler, &handler_ids[0]), 0);
+    assert_int_equal(MQTTTopicTree_add(&root, "a/b/c", _test_handler, &handler_ids[1]), 0);
+
+    // When: same filter again
+    assert_int_equal(MQTTTopicTree_add(&root, "a/b", _test_handler, &handler_ids[2]), 0);
+    // Then: handler is replaced
+    assert_int_equal(_deliver(root, "a/b"), 1);
+    assert_int_equal(delivery.last_id, 2);
+
+    // When: remove parent filter
+    assert_int_equal(MQTTTopicTree_remove(&root, "a/b"), 0);
+    // Then: child filter is kept
+    assert_int_equal(_deliver(root, "a/b"), 0);
+    assert_int_equal(_deliver(root, "a/b/c"), 1);
+    assert_int_equal(MQTTTopicTree_remove(&root, "a/b"), E_ST_MQTT_FAILURE);
+    assert_int_equal(MQTTTopicTree_remove(&root, "a/b/c/d"), E_ST_MQTT_FAILURE);
+
+    // When: remove last filter
+    assert_int_equal(MQTTTopicTree_remove(&root, "a/b/c"), 0);
+    // Then: all levels are freed
+    assert_null(root);
+}
+
+void TC_MQTTSetMessageHandler_unlimited(void **state)
+{
+    st_mqtt_client client = NULL;
+    char topic[64];
+    int i;
+    UNUSED(state);
+
+    // Given
+    _set_ids();
+    assert_int_equal(st_mqtt_create(&client, 0), 0);
+
+    // When: more handlers than previous fixed slots
+    for (i = 0; i < 100; i++) {
+        snprintf(topic, sizeof(topic), "/v1/commands/device-%03d", i);
+        assert_int_equal(MQTTSetMessageHandler(client, topic, _test_handler, &handler_ids[i]), 0);
+    }
+    // Then
+    assert_int_equal(_deliver(((MQTTClient *)client)->subscriptions, "/v1/commands/device-077"), 1);
+    assert_int_equal(delivery.last_id, 77);
+
+    // When: remove
+    assert_int_equal(MQTTSetMessageHandler(client, "/v1/commands/device-077", NULL, NULL), 0);
+    // Then
+    assert_int_equal(_deliver(((MQTTClient *)client)->subscriptions, "/v1/commands/device-077"), 0);
+    assert_int_equal(MQTTSetMessageHandler(client, "/v1/commands/device-077", NULL, NULL), E_ST_MQTT_FAILURE);
+
+    st_mqtt_destroy(client);
+}
+
+static long _elapsed_ns(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000000L + (now.tv_nsec - start->tv_nsec);
+}
+
+void TC_MQTTTopicTree_deliver_many_filters(void **state)
+{
+    MQTTTopicNode *root = NULL;
+    static char filters[TEST_FILTER_NUM][64];
+    static char topics[TEST_FILTER_NUM][64];
+    st_mqtt_msg msg;
+    struct timespec start;
+    long tree_ns;
+    long linear_ns;
+    int expected;
+    int i, j, n;
+    UNUSED(state);
+
+    // Given: per-device filters of a gateway with some wildcard filters
+    _set_ids();
+    for (i = 0; i < TEST_FILTER_NUM; i++) {
+        switch (i % 10) {
+        case 8:
+            snprintf(filters[i], sizeof(filters[i]), "/v1/notifications/+/%08x", i);
+            break;
+        case 9:
+            snprintf(filters[i], sizeof(filters[i]), "/v1/events/%08x/#", i);
+            break;
+        default:
+            snprintf(filters[i], sizeof(filters[i]), "/v1/commands/%08x-5d8d-4d0b-86f6-0add22717f0e", i);
+            break;
+        }
+        snprintf(topics[i], sizeof(topics[i]), "/v1/%s/%08x%s", (i % 10 == 9) ? "events" : "commands",
+                i, (i % 10 == 9) ? "/sub/level" : "-5d8d-4d0b-86f6-0add22717f0e");
+        assert_int_equal(MQTTTopicTree_add(&root, filters[i], _test_handler, &handler_ids[i]), 0);
+    }
+
+    // Then: same result as previous linear matcher
+    for (i = 0; i < TEST_FILTER_NUM; i++) {
+        expected = 0;
+        for (j = 0; j < TEST_FILTER_NUM; j++)
+            expected += _linear_matched(filters[j], topics[i], topics[i] + strlen(topics[i]));
+        assert_int_equal(_deliver(root, topics[i]), expected);
+    }
+
+    // When: measure delivery time
+    memset(&msg, 0, sizeof(msg));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; n < TEST_MESSAGE_NUM; n++) {
+        msg.topic = topics[n % TEST_FILTER_NUM];
+        msg.topiclen = strlen(msg.topic);
+        MQTTTopicTree_deliver(root, &msg);
+    }
+    tree_ns = _elapsed_ns(&start) / TEST_MESSAGE_NUM;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (n = 0; n < TEST_MESSAGE_NUM; n++) {
+        const char *topic = topics[n % TEST_FILTER_NUM];
+        size_t len = strlen(topic);
+        for (j = 0; j < TEST_FILTER_NUM; j++) {
+            if (_linear_matched(filters[j], topic, topic + len))
+                _test_handler(NULL, &handler_ids[j]);
+        }
+    }
+    linear_ns = _elapsed_ns(&start) / TEST_MESSAGE_NUM;
+
+    print_message("%d filters delivery : tree %ld ns/msg, linear %ld ns/msg\n",
+            TEST_FILTER_NUM, tree_ns, linear_ns);
+
+    MQTTTopicTree_free(&root);
+}
@@ -0,0 +1,258 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iot_main.h>
+#include <iot_mqtt_client.h>
+#include "TC_MOCK_functions.h"
+
+#define UNUSED(x) (void**)(x)
+
+#define TEST_EVENT_NUM      20
+#define TEST_EVENT_TOPIC    "/v1/deviceEvents/0fc9ae2b-3bfb-4c53-a7a5-1a4c94b1b1a3"
+#define TEST_EVENT_PAYLOAD  "{\"deviceEvents\":[{\"component\":\"main\",\"capability\":\"switch\"," \
+                            "\"attribute\":\"switch\",\"value\":\"on\"}]}"
+
+static st_mqtt_broker_info_t test_broker = { "localhost", 8883, NULL, 0, 0 };
+
+int TC_iot_mqtt_v5_setup(void **state)
+{
+    UNUSED(state);
+
+    set_mock_net_fault(false);
+    set_mock_net_session_present(false);
+    reset_mock_net_count();
+    return 0;
+}
+
+int TC_iot_mqtt_v5_teardown(void **state)
+{
+    UNUSED(state);
+
+    reset_mock_net_count();
+    return 0;
+}
+
+void TC_MQTTV5_serialize_publish(void **state)
+{
+    unsigned char buf3[256];
+    unsigned char buf5[256];
+    unsigned char *payload;
+    int len3, len5, payloadlen, qos;
+    unsigned char dup, retained;
+    unsigned short packetid;
+    MQTTString topic = MQTTString_initializer;
+    MQTTString read_topic = MQTTString_initializer;
+    MQTTV5Properties props = MQTTV5Properties_initializer;
+    MQTTV5Properties read_props;
+    UNUSED(state);
+
+    topic.cstring = TEST_EVENT_TOPIC;
+
+    // When: NULL properties
+    len3 = MQTTSerialize_publish(buf3, sizeof(buf3), 0, 1, 0, 7, topic,
+            (unsigned char *)TEST_EVENT_PAYLOAD, strlen(TEST_EVENT_PAYLOAD));
+    len5 = MQTTV5Serialize_publish(buf5, sizeof(buf5), 0, 1, 0, 7, topic, NULL,
+            (unsigned char *)TEST_EVENT_PAYLOAD, strlen(TEST_EVENT_PAYLOAD));
+    // Then: same as MQTT 3.1.1
+    assert_true(len3 > 0);
+    assert_int_equal(len5, len3);
+    assert_memory_equal(buf5, buf3, len3);
+
+    // When: alias with empty topic
+    props.present = MQTTV5_HAS_TOPIC_ALIAS;
+    props.topicAlias = 3;
+    topic.cstring = "";
+    len5 = MQTTV5Serialize_publish(buf5, sizeof(buf5), 0, 1, 0, 7, topic, &props,
+            (unsigned char *)TEST_EVENT_PAYLOAD, strlen(TEST_EVENT_PAYLOAD));
+    // Then: size function agrees and packet reads back
+    assert_int_equal(len5, MQTTV5Serialize_publish_size(1, topic, &props, strlen(TEST_EVENT_PAYLOAD)));
+    assert_true(len5 < len3);
+    assert_int_equal(MQTTV5Deserialize_publish(&dup, &qos, &retained, &packetid, &read_topic, &read_props,
+            &payload, &payloadlen, buf5, len5), 1);
+    assert_int_equal(qos, 1);
+    assert_int_equal(packetid, 7);
+    assert_int_equal(read_topic.lenstring.len, 0);
+    assert_true(read_props.present & MQTTV5_HAS_TOPIC_ALIAS);
+    assert_int_equal(read_props.topicAlias, 3);
+    assert_int_equal(payloadlen, strlen(TEST_EVENT_PAYLOAD));
+    assert_memory_equal(payload, TEST_EVENT_PAYLOAD, payloadlen);
+}
+
+void TC_MQTTV5_deserialize_ack(void **state)
+{
+    unsigned char connack[] = { 0x20, 0x13, 0x01, 0x00, 0x10,
+            0x21, 0x00, 0x20, 0x22, 0x00, 0x0a,
+            0x1f, 0x00, 0x02, 'o', 'k',             /* reason string is skipped */
+            0x27, 0x00, 0x00, 0x04, 0x00 };
+    unsigned char connack_bad[] = { 0x20, 0x05, 0x00, 0x00, 0x02, 0x7f, 0x00 };
+    unsigned char puback[] = { 0x40, 0x04, 0x00, 0x07, 0x97, 0x00 };
+    unsigned char puback_short[] = { 0x40, 0x02, 0x00, 0x07 };
+    MQTTV5Properties props;
+    unsigned char session_present, rc, type, dup, reason;
+    unsigned short packetid;
+    UNUSED(state);
+
+    // When: CONNACK with properties
+    assert_int_equal(MQTTV5Deserialize_connack(&props, &session_present, &rc, connack, sizeof(connack)), 1);
+    // Then
+    assert_int_equal(session_present, 1);
+    assert_int_equal(rc, 0);
+    assert_int_equal(props.receiveMaximum, 0x20);
+    assert_int_equal(props.topicAliasMaximum, 0x0a);
+    assert_int_equal(props.maximumPacketSize, 0x400);
+
+    // When: unknown property
+    // Then: malformed
+    assert_int_equal(MQTTV5Deserialize_connack(&props, &session_present, &rc, connack_bad, sizeof(connack_bad)), 0);
+
+    // When: PUBACK with reason code
+    assert_int_equal(MQTTV5Deserialize_ack(&type, &dup, &packetid, &reason, NULL, puback, sizeof(puback)), 1);
+    // Then
+    assert_int_equal(type, PUBACK);
+    assert_int_equal(packetid, 7);
+    assert_int_equal(reason, ST_MQTT_RC_QUOTA_EXCEEDED);
+
+    // When: PUBACK without reason code
+    assert_int_equal(MQTTV5Deserialize_ack(&type, &dup, &packetid, &reason, NULL, puback_short, sizeof(puback_short)), 1);
+    // Then: success
+    assert_int_equal(reason, ST_MQTT_RC_SUCCESS);
+}
+
+static unsigned int _publish_events(unsigned char mqtt_ver)
+{
+    st_mqtt_client client;
+    st_mqtt_connect_data conn_data = st_mqtt_connect_data_initializer;
+    st_mqtt_msg msg;
+    unsigned int bytes;
+    int i;
+
+    conn_data.mqtt_ver = mqtt_ver;
+    conn_data.clientid = "0fc9ae2b-3bfb-4c53-a7a5-1a4c94b1b1a3";
+    assert_int_equal(st_mqtt_create(&client, 1000), 0);
+    assert_int_equal(st_mqtt_connect(client, &test_broker, &conn_data), 0);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.qos = st_mqtt_qos1;
+    msg.topic = TEST_EVENT_TOPIC;
+    msg.payload = TEST_EVENT_PAYLOAD;
+    msg.payloadlen = strlen(TEST_EVENT_PAYLOAD);
+
+    bytes = get_mock_net_publish_bytes();
+    for (i = 0; i < TEST_EVENT_NUM; i++) {
+        assert_int_equal(st_mqtt_publish(client, &msg), 0);
+        // broker always resolves the topic of aliased publish
+        assert_string_equal(get_mock_net_publish_topic(), TEST_EVENT_TOPIC);
+    }
+    bytes = get_mock_net_publish_bytes() - bytes;
+
+    st_mqtt_disconnect(client);
+    st_mqtt_destroy(client);
+    return bytes;
+}
+
+void TC_st_mqtt_v5_topic_alias(void **state)
+{
+    unsigned int v3_bytes;
+    unsigned int v5_bytes;
+    unsigned int first, aliased;
+    MQTTString topic = MQTTString_initializer;
+    MQTTV5Properties props = MQTTV5Properties_initializer;
+    UNUSED(state);
+
+    // When: same events with MQTT 3.1.1 and MQTT 5.0
+    v3_bytes = _publish_events(4);
+    v5_bytes = _publish_events(MQTTV5_PROTOCOL_VERSION);
+
+    // Then: topic is sent only with the first event of 5.0
+    props.present = MQTTV5_HAS_TOPIC_ALIAS;
+    props.topicAlias = 1;
+    topic.cstring = TEST_EVENT_TOPIC;
+    first = MQTTV5Serialize_publish_size(1, topic, &props, strlen(TEST_EVENT_PAYLOAD));
+    assert_int_equal(v3_bytes, TEST_EVENT_NUM * MQTTSerialize_publish_size(1, topic, strlen(TEST_EVENT_PAYLOAD)));
+    topic.cstring = "";
+    aliased = MQTTV5Serialize_publish_size(1, topic, &props, strlen(TEST_EVENT_PAYLOAD));
+    assert_int_equal(v5_bytes, first + (TEST_EVENT_NUM - 1) * aliased);
+    assert_true(v5_bytes < v3_bytes);
+    print_message("bytes on wire for %d events : v3.1.1 %u, v5.0 %u\n",
+            TEST_EVENT_NUM, v3_bytes, v5_bytes);
+}
+
+void TC_st_mqtt_v5_reason_code(void **state)
+{
+    st_mqtt_client client;
+    st_mqtt_connect_data conn_data = st_mqtt_connect_data_initializer;
+    st_mqtt_msg msg;
+    st_mqtt_msg batch[3];
+    MQTTString topic = MQTTString_initializer;
+    MQTTV5Properties props = MQTTV5Properties_initializer;
+    unsigned int bytes;
+    int i;
+    UNUSED(state);
+
+    conn_data.mqtt_ver = MQTTV5_PROTOCOL_VERSION;
+    conn_data.clientid = "0fc9ae2b-3bfb-4c53-a7a5-1a4c94b1b1a3";
+    assert_int_equal(st_mqtt_create(&client, 1000), 0);
+
+    // When: server is busy
+    set_mock_net_reason_code(ST_MQTT_RC_SERVER_BUSY);
+    // Then: not a credential problem
+    assert_int_equal(st_mqtt_connect(client, &test_broker, &conn_data), E_ST_MQTT_SERVER_UNAVAILABLE);
+    assert_int_equal(st_mqtt_get_reason_code(client), ST_MQTT_RC_SERVER_BUSY);
+
+    // When: server refuses a publish
+    assert_int_equal(st_mqtt_connect(client, &test_broker, &conn_data), 0);
+    assert_int_equal(st_mqtt_get_reason_code(client), ST_MQTT_RC_SUCCESS);
+    memset(&msg, 0, sizeof(msg));
+    msg.qos = st_mqtt_qos1;
+    msg.topic = TEST_EVENT_TOPIC;
+    msg.payload = TEST_EVENT_PAYLOAD;
+    msg.payloadlen = strlen(TEST_EVENT_PAYLOAD);
+    set_mock_net_reason_code(ST_MQTT_RC_QUOTA_EXCEEDED);
+    bytes = get_mock_net_publish_bytes();
+    assert_int_equal(st_mqtt_publish(client, &msg), E_ST_MQTT_REFUSED);
+    bytes = get_mock_net_publish_bytes() - bytes;
+    // Then: no retry and connection is kept
+    assert_int_equal(st_mqtt_get_reason_code(client), ST_MQTT_RC_QUOTA_EXCEEDED);
+    assert_int_equal(st_mqtt_publish(client, &msg), 0);
+    topic.cstring = TEST_EVENT_TOPIC;
+    props.present = MQTTV5_HAS_TOPIC_ALIAS;
+    props.topicAlias = 1;
+    assert_int_equal(bytes, MQTTV5Serialize_publish_size(1, topic, &props, msg.payloadlen));
+    assert_int_equal(get_mock_net_connect_count(), 2);
+
+    // When: server refuses one event of a batch
+    for (i = 0; i < 3; i++)
+        memcpy(&batch[i], &msg, sizeof(msg));
+    batch[1].refused = 1;
+    set_mock_net_reason_code(ST_MQTT_RC_QUOTA_EXCEEDED);
+    assert_int_equal(st_mqtt_publish_many(client, batch, 3), E_ST_MQTT_REFUSED);
+    // Then: only the first one, which got the reason code, is marked
+    assert_int_equal(batch[0].refused, 1);
+    assert_int_equal(batch[1].refused, 0);
+    assert_int_equal(batch[2].refused, 0);
+
+    st_mqtt_disconnect(client);
+    st_mqtt_destroy(client);
+}
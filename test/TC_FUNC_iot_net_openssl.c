@@ -0,0 +1,378 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include <iot_main.h>
+
+#define UNUSED(x) (void**)(x)
+
+#define TEST_SOCK_BUF_SIZE      4096
+#define TEST_WRITE_TIMEOUT_MS   200
+#define TEST_RETRY_TIMEOUT_MS   5000
+#define TEST_BIG_SIZE           (256 * 1024)
+#define TEST_IOV_NUM            1024
+#define TEST_IOV_SIZE           100
+
+/* iot_net_init is wrapped by the mock network of other tests */
+iot_error_t __real_iot_net_init(iot_net_interface_t *n);
+
+struct test_tls_server {
+    int listen_sock;
+    int port;
+    int go[2];
+    SSL_CTX *ctx;
+    unsigned char *received;
+    int expected;
+    int received_len;
+    pthread_t thread;
+};
+
+static EVP_PKEY *_test_key_gen(void)
+{
+    EVP_PKEY_CTX *pctx;
+    EVP_PKEY *pkey = NULL;
+
+    pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+    if (pctx == NULL)
+        return NULL;
+    if (EVP_PKEY_keygen_init(pctx) <= 0 ||
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) <= 0 ||
+            EVP_PKEY_keygen(pctx, &pkey) <= 0)
+        pkey = NULL;
+    EVP_PKEY_CTX_free(pctx);
+    return pkey;
+}
+
+static SSL_CTX *_test_server_ctx(void)
+{
+    SSL_CTX *ctx;
+    EVP_PKEY *pkey;
+    X509 *x509;
+
+    pkey = _test_key_gen();
+    assert_non_null(pkey);
+
+    x509 = X509_new();
+    assert_non_null(x509);
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 3600);
+    X509_set_pubkey(x509, pkey);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(x509), "CN", MBSTRING_ASC,
+            (const unsigned char *)"localhost", -1, -1, 0);
+    X509_set_issuer_name(x509, X509_get_subject_name(x509));
+    assert_true(X509_sign(x509, pkey, EVP_sha256()) > 0);
+
+    ctx = SSL_CTX_new(TLS_server_method());
+    assert_non_null(ctx);
+    assert_int_equal(SSL_CTX_use_certificate(ctx, x509), 1);
+    assert_int_equal(SSL_CTX_use_PrivateKey(ctx, pkey), 1);
+
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+    return ctx;
+}
+
+/* Accepts one client and reads nothing until it is told to go, so that
+ * the client runs out of socket buffer in the middle of a write
+ */
+static void *_test_server_thread(void *arg)
+{
+    struct test_tls_server *server = arg;
+    SSL *ssl;
+    char go;
+    int sock;
+    int rc;
+
+    sock = accept(server->listen_sock, NULL, NULL);
+    if (sock < 0)
+        return NULL;
+
+    ssl = SSL_new(server->ctx);
+    SSL_set_fd(ssl, sock);
+    if (SSL_accept(ssl) == 1) {
+        if (read(server->go[0], &go, 1) == 1) {
+            while (server->received_len < server->expected) {
+                rc = SSL_read(ssl, server->received + server->received_len,
+                        server->expected - server->received_len);
+                if (rc <= 0)
+                    break;
+                server->received_len += rc;
+            }
+        }
+    }
+
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    close(sock);
+    return NULL;
+}
+
+static void _test_server_start(struct test_tls_server *server, int expected)
+{
+    struct sockaddr_in sin;
+    socklen_t sin_len = sizeof(sin);
+    int buf_size = TEST_SOCK_BUF_SIZE;
+
+    memset(server, 0, sizeof(*server));
+    server->ctx = _test_server_ctx();
+    server->expected = expected;
+    server->received = malloc(expected);
+    assert_non_null(server->received);
+    assert_int_equal(pipe(server->go), 0);
+
+    server->listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+    assert_true(server->listen_sock >= 0);
+    /* accepted socket inherits it, small window fills up quickly */
+    setsockopt(server->listen_sock, SOL_SOCKET, SO_RCVBUF, &buf_size, sizeof(buf_size));
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert_int_equal(bind(server->listen_sock, (struct sockaddr *)&sin, sizeof(sin)), 0);
+    assert_int_equal(listen(server->listen_sock, 1), 0);
+    assert_int_equal(getsockname(server->listen_sock, (struct sockaddr *)&sin, &sin_len), 0);
+    server->port = ntohs(sin.sin_port);
+
+    assert_int_equal(pthread_create(&server->thread, NULL, _test_server_thread, server), 0);
+}
+
+static void _test_server_finish(struct test_tls_server *server)
+{
+    char go = 1;
+
+    assert_int_equal(write(server->go[1], &go, 1), 1);
+    pthread_join(server->thread, NULL);
+
+    close(server->go[0]);
+    close(server->go[1]);
+    close(server->listen_sock);
+    SSL_CTX_free(server->ctx);
+}
+
+static void _test_client_connect(iot_net_interface_t *net, struct test_tls_server *server)
+{
+    int buf_size = TEST_SOCK_BUF_SIZE;
+    in_addr_t loopback = htonl(INADDR_LOOPBACK);
+
+    assert_int_equal(__real_iot_net_init(net), IOT_ERROR_NONE);
+    net->connection.port = server->port;
+    net->connection.addr[0].family = AF_INET;
+    memcpy(net->connection.addr[0].ip, &loopback, sizeof(loopback));
+    net->connection.addr_cnt = 1;
+
+    assert_int_equal(net->connect(net), IOT_ERROR_NONE);
+    setsockopt(net->context.socket, SOL_SOCKET, SO_SNDBUF, &buf_size, sizeof(buf_size));
+}
+
+static int _test_writev_timeout(iot_net_interface_t *net, iot_net_iovec_t *iov, int iovcnt, unsigned int timeout_ms)
+{
+    iot_os_timer timer = NULL;
+    int rc;
+
+    assert_int_equal(iot_os_timer_init(&timer), IOT_ERROR_NONE);
+    iot_os_timer_count_ms(timer, timeout_ms);
+    rc = net->writev(net, iov, iovcnt, timer);
+    iot_os_timer_destroy(&timer);
+
+    return rc;
+}
+
+/* Continues from sent bytes like the MQTT client does */
+static int _test_iov_advance(iot_net_iovec_t **iov, int *iovcnt, int sent)
+{
+    while (*iovcnt > 0 && sent >= (*iov)->len) {
+        sent -= (*iov)->len;
+        (*iov)++;
+        (*iovcnt)--;
+    }
+    if (*iovcnt > 0) {
+        (*iov)->base += sent;
+        (*iov)->len -= sent;
+    }
+    return *iovcnt;
+}
+
+void TC_iot_net_openssl_write_mode(void **state)
+{
+    struct test_tls_server server;
+    iot_net_interface_t net;
+    long mode;
+    UNUSED(state);
+
+    // Given
+    _test_server_start(&server, 1);
+    // When
+    _test_client_connect(&net, &server);
+    mode = SSL_get_mode(net.context.ssl);
+    // Then: retried write may move and records are reported one by one
+    assert_true(mode & SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    assert_true(mode & SSL_MODE_ENABLE_PARTIAL_WRITE);
+
+    // Local teardown
+    net.disconnect(&net);
+    _test_server_finish(&server);
+    free(server.received);
+}
+
+void TC_iot_net_openssl_writev_moved_retry(void **state)
+{
+    struct test_tls_server server;
+    iot_net_interface_t net;
+    iot_net_iovec_t iov_buf[2];
+    iot_net_iovec_t *iov = iov_buf;
+    unsigned char header[5] = {0x30, 0x80, 0x80, 0x10, 0x00};
+    unsigned char *payload;
+    unsigned char *expected;
+    unsigned char *moved;
+    int total = sizeof(header) + TEST_BIG_SIZE;
+    int iovcnt = 2;
+    int sent = 0;
+    int rc;
+    int i;
+    UNUSED(state);
+
+    // Given: peer doesn't read, a big packet can't go out in time
+    payload = malloc(TEST_BIG_SIZE);
+    expected = malloc(total);
+    assert_non_null(payload);
+    assert_non_null(expected);
+    for (i = 0; i < TEST_BIG_SIZE; i++)
+        payload[i] = (unsigned char)(i * 7 + (i >> 8));
+    memcpy(expected, header, sizeof(header));
+    memcpy(expected + sizeof(header), payload, TEST_BIG_SIZE);
+
+    _test_server_start(&server, total);
+    _test_client_connect(&net, &server);
+    iov_buf[0].base = header;
+    iov_buf[0].len = sizeof(header);
+    iov_buf[1].base = payload;
+    iov_buf[1].len = TEST_BIG_SIZE;
+
+    // When
+    rc = _test_writev_timeout(&net, iov, iovcnt, TEST_WRITE_TIMEOUT_MS);
+    // Then: only a part is written, a record is left pending
+    assert_true(rc > 0);
+    assert_true(rc < total);
+    sent = rc;
+    _test_iov_advance(&iov, &iovcnt, rc);
+
+    // When: rest is resent from another buffer after peer starts reading
+    moved = malloc(iov[iovcnt - 1].len);
+    assert_non_null(moved);
+    memcpy(moved, iov[iovcnt - 1].base, iov[iovcnt - 1].len);
+    iov[iovcnt - 1].base = moved;
+    memset(payload, 0, TEST_BIG_SIZE);
+    assert_int_equal(write(server.go[1], "", 1), 1);
+    while (iovcnt > 0) {
+        rc = _test_writev_timeout(&net, iov, iovcnt, TEST_RETRY_TIMEOUT_MS);
+        assert_true(rc > 0);
+        sent += rc;
+        _test_iov_advance(&iov, &iovcnt, rc);
+    }
+    pthread_join(server.thread, NULL);
+
+    // Then: peer gets the exact stream
+    assert_int_equal(sent, total);
+    assert_int_equal(server.received_len, total);
+    assert_memory_equal(server.received, expected, total);
+
+    // Local teardown
+    net.disconnect(&net);
+    close(server.go[0]);
+    close(server.go[1]);
+    close(server.listen_sock);
+    SSL_CTX_free(server.ctx);
+    free(server.received);
+    free(moved);
+    free(expected);
+    free(payload);
+}
+
+void TC_iot_net_openssl_writev_gathered_retry(void **state)
+{
+    struct test_tls_server server;
+    iot_net_interface_t net;
+    iot_net_iovec_t iov_buf[TEST_IOV_NUM];
+    iot_net_iovec_t *iov = iov_buf;
+    unsigned char *data;
+    int total = TEST_IOV_NUM * TEST_IOV_SIZE;
+    int iovcnt = TEST_IOV_NUM;
+    int sent = 0;
+    int rc;
+    int i;
+    UNUSED(state);
+
+    // Given: small buffers which are gathered before encryption
+    data = malloc(total);
+    assert_non_null(data);
+    for (i = 0; i < total; i++)
+        data[i] = (unsigned char)(i * 13 + (i >> 8));
+    for (i = 0; i < TEST_IOV_NUM; i++) {
+        iov_buf[i].base = data + i * TEST_IOV_SIZE;
+        iov_buf[i].len = TEST_IOV_SIZE;
+    }
+    _test_server_start(&server, total);
+    _test_client_connect(&net, &server);
+
+    // When
+    rc = _test_writev_timeout(&net, iov, iovcnt, TEST_WRITE_TIMEOUT_MS);
+    // Then: written count ends in the middle of gathered buffers
+    assert_true(rc > 0);
+    assert_true(rc < total);
+    sent = rc;
+    _test_iov_advance(&iov, &iovcnt, rc);
+
+    // When: rest is gathered again from where it stopped
+    assert_int_equal(write(server.go[1], "", 1), 1);
+    while (iovcnt > 0) {
+        rc = _test_writev_timeout(&net, iov, iovcnt, TEST_RETRY_TIMEOUT_MS);
+        assert_true(rc > 0);
+        sent += rc;
+        _test_iov_advance(&iov, &iovcnt, rc);
+    }
+    pthread_join(server.thread, NULL);
+
+    // Then
+    assert_int_equal(sent, total);
+    assert_int_equal(server.received_len, total);
+    assert_memory_equal(server.received, data, total);
+
+    // Local teardown
+    net.disconnect(&net);
+    close(server.go[0]);
+    close(server.go[1]);
+    close(server.listen_sock);
+    SSL_CTX_free(server.ctx);
+    free(server.received);
+    free(data);
+}
@@ -0,0 +1,239 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <iot_main.h>
+#include "TC_MOCK_functions.h"
+
+#define UNUSED(x) (void**)(x)
+
+#define TEST_RESOLVER_DELAY_MS  100
+#define TEST_CONNECT_NUM        10
+#define TEST_RESOLVE_THREADS    4
+
+int TC_iot_net_resolver_setup(void **state)
+{
+    UNUSED(state);
+
+    set_mock_resolver_delay(0);
+    set_mock_resolver_addr("127.0.0.1");
+    iot_net_resolve_invalidate(MOCK_RESOLVER_HOST);
+    return 0;
+}
+
+int TC_iot_net_resolver_teardown(void **state)
+{
+    UNUSED(state);
+
+    set_mock_resolver_delay(0);
+    set_mock_resolver_addr("127.0.0.1");
+    iot_net_resolve_invalidate(MOCK_RESOLVER_HOST);
+    return 0;
+}
+
+static unsigned int _elapsed_ms(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static int _listen_local(int *port)
+{
+    struct sockaddr_in sin;
+    socklen_t len = sizeof(sin);
+    int sock;
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    assert_true(sock >= 0);
+    assert_int_equal(bind(sock, (struct sockaddr *)&sin, sizeof(sin)), 0);
+    assert_int_equal(listen(sock, TEST_CONNECT_NUM), 0);
+    assert_int_equal(getsockname(sock, (struct sockaddr *)&sin, &len), 0);
+    *port = ntohs(sin.sin_port);
+    return sock;
+}
+
+void TC_iot_net_resolve_cache(void **state)
+{
+    iot_net_addr_t addr[IOT_NET_ADDR_MAX];
+    unsigned char loopback[] = { 127, 0, 0, 1 };
+    struct timespec start;
+    unsigned int count;
+    unsigned int elapsed;
+    UNUSED(state);
+
+    // When: nothing cached
+    set_mock_resolver_delay(TEST_RESOLVER_DELAY_MS);
+    count = get_mock_resolver_count();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert_int_equal(iot_net_resolve(MOCK_RESOLVER_HOST, addr, IOT_NET_ADDR_MAX, 1000), 1);
+    elapsed = _elapsed_ms(&start);
+    // Then: waits for lookup
+    assert_int_equal(get_mock_resolver_count(), count + 1);
+    assert_true(elapsed >= TEST_RESOLVER_DELAY_MS);
+    assert_int_equal(addr[0].family, AF_INET);
+    assert_memory_equal(addr[0].ip, loopback, sizeof(loopback));
+
+    // When: resolved again
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert_int_equal(iot_net_resolve(MOCK_RESOLVER_HOST, addr, IOT_NET_ADDR_MAX, 1000), 1);
+    elapsed = _elapsed_ms(&start);
+    // Then: cached
+    assert_int_equal(get_mock_resolver_count(), count + 1);
+    assert_true(elapsed < TEST_RESOLVER_DELAY_MS);
+
+    // When: lookup is slower than caller can wait
+    iot_net_resolve_invalidate(MOCK_RESOLVER_HOST);
+    assert_int_equal(iot_net_resolve(MOCK_RESOLVER_HOST, addr, IOT_NET_ADDR_MAX, 10), 0);
+    // Then: lookup goes on and next one gets its result
+    usleep(2 * TEST_RESOLVER_DELAY_MS * 1000);
+    assert_int_equal(iot_net_resolve(MOCK_RESOLVER_HOST, addr, IOT_NET_ADDR_MAX, 0), 1);
+    assert_int_equal(get_mock_resolver_count(), count + 2);
+
+    // When: name doesn't exist
+    iot_net_resolve_invalidate(MOCK_RESOLVER_HOST);
+    set_mock_resolver_addr(NULL);
+    // Then
+    assert_int_equal(iot_net_resolve(MOCK_RESOLVER_HOST, addr, IOT_NET_ADDR_MAX, 1000), 0);
+}
+
+static void *_resolve_thread(void *arg)
+{
+    iot_net_addr_t addr[IOT_NET_ADDR_MAX];
+
+    *(int *)arg = iot_net_resolve(MOCK_RESOLVER_HOST, addr, IOT_NET_ADDR_MAX, 1000);
+    return NULL;
+}
+
+void TC_iot_net_resolve_concurrent(void **state)
+{
+    pthread_t threads[TEST_RESOLVE_THREADS];
+    int addr_cnt[TEST_RESOLVE_THREADS];
+    struct timespec start;
+    unsigned int count;
+    unsigned int elapsed;
+    int i;
+    UNUSED(state);
+
+    // When: several tasks resolve the same name at once
+    set_mock_resolver_delay(TEST_RESOLVER_DELAY_MS);
+    count = get_mock_resolver_count();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < TEST_RESOLVE_THREADS; i++)
+        assert_int_equal(pthread_create(&threads[i], NULL, _resolve_thread, &addr_cnt[i]), 0);
+    for (i = 0; i < TEST_RESOLVE_THREADS; i++)
+        pthread_join(threads[i], NULL);
+    elapsed = _elapsed_ms(&start);
+
+    // Then: one lookup wakes all of them, none waits for its timeout
+    assert_int_equal(get_mock_resolver_count(), count + 1);
+    for (i = 0; i < TEST_RESOLVE_THREADS; i++)
+        assert_int_equal(addr_cnt[i], 1);
+    assert_true(elapsed < 5 * TEST_RESOLVER_DELAY_MS);
+}
+
+void TC_iot_net_connect_addr(void **state)
+{
+    iot_net_addr_t addr[2];
+    unsigned char blackhole[] = { 192, 0, 2, 1 };   /* TEST-NET-1 */
+    unsigned char loopback[] = { 127, 0, 0, 1 };
+    struct timespec start;
+    unsigned int elapsed;
+    int listener, port, sock;
+    UNUSED(state);
+
+    listener = _listen_local(&port);
+    addr[0].family = AF_INET;
+    memcpy(addr[0].ip, blackhole, sizeof(blackhole));
+    addr[1].family = AF_INET;
+    memcpy(addr[1].ip, loopback, sizeof(loopback));
+
+    // When: first address doesn't answer
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sock = iot_net_connect_addr(addr, 2, port, 5000);
+    elapsed = _elapsed_ms(&start);
+    // Then: next one is tried without waiting for the first to time out
+    assert_true(sock >= 0);
+    assert_true(elapsed < 4 * IOT_NET_CONNECT_ATTEMPT_DELAY_MS);
+    close(sock);
+
+    // When: nobody listens
+    close(listener);
+    sock = iot_net_connect_addr(&addr[1], 1, port, 1000);
+    // Then
+    assert_int_equal(sock, -1);
+
+    // When: no address
+    // Then
+    assert_int_equal(iot_net_connect_addr(addr, 0, port, 1000), -1);
+}
+
+static unsigned int _resolve_and_connect(int port)
+{
+    iot_net_addr_t addr[IOT_NET_ADDR_MAX];
+    struct timespec start;
+    unsigned int elapsed;
+    int addr_cnt, sock;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    addr_cnt = iot_net_resolve(MOCK_RESOLVER_HOST, addr, IOT_NET_ADDR_MAX, 1000);
+    sock = iot_net_connect_addr(addr, addr_cnt, port, 1000);
+    elapsed = _elapsed_ms(&start);
+    assert_true(sock >= 0);
+    close(sock);
+    return elapsed;
+}
+
+void TC_iot_net_connect_latency(void **state)
+{
+    unsigned int cold, warm = 0;
+    int listener, port, i;
+    UNUSED(state);
+
+    listener = _listen_local(&port);
+    set_mock_resolver_delay(TEST_RESOLVER_DELAY_MS);
+
+    // When: first connection, then reconnections
+    cold = _resolve_and_connect(port);
+    for (i = 0; i < TEST_CONNECT_NUM; i++)
+        warm += _resolve_and_connect(port);
+    warm /= TEST_CONNECT_NUM;
+
+    // Then: only first one waits for resolver
+    assert_true(cold >= TEST_RESOLVER_DELAY_MS);
+    assert_true(warm < TEST_RESOLVER_DELAY_MS);
+    print_message("connect latency with %d ms resolver : first %u ms, reconnect %u ms\n",
+            TEST_RESOLVER_DELAY_MS, cold, warm);
+
+    close(listener);
+}
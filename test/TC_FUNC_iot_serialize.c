@@ -0,0 +1,153 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <stdint.h>
+#include <iot_error.h>
+#include <iot_serialize.h>
+
+#define UNUSED(x) (void**)(x)
+
+/* {"name":"abc","num":5,"neg":-10,"flt":2.5f,"dbl":-7.9,"big":2^64-1} */
+static const uint8_t sample_cbor[] = {
+    0xa6,
+    0x64, 'n', 'a', 'm', 'e', 0x63, 'a', 'b', 'c',
+    0x63, 'n', 'u', 'm', 0x05,
+    0x63, 'n', 'e', 'g', 0x29,
+    0x63, 'f', 'l', 't', 0xfa, 0x40, 0x20, 0x00, 0x00,
+    0x63, 'd', 'b', 'l', 0xfb, 0xc0, 0x1f, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a,
+    0x63, 'b', 'i', 'g', 0x1b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+void TC_iot_serialize_cbor_get_string(void **state)
+{
+    iot_error_t err;
+    char buf[8];
+    UNUSED(state);
+
+    // When: key is found
+    err = iot_serialize_cbor_get_string(sample_cbor, sizeof(sample_cbor), "name", buf, sizeof(buf));
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_string_equal(buf, "abc");
+
+    // When: value and null terminator fit exactly
+    err = iot_serialize_cbor_get_string(sample_cbor, sizeof(sample_cbor), "name", buf, strlen("abc") + 1);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_string_equal(buf, "abc");
+
+    // When: buffer is too small
+    err = iot_serialize_cbor_get_string(sample_cbor, sizeof(sample_cbor), "name", buf, strlen("abc"));
+    // Then
+    assert_int_equal(err, IOT_ERROR_BAD_REQ);
+
+    // When: key does not exist
+    err = iot_serialize_cbor_get_string(sample_cbor, sizeof(sample_cbor), "deviceId", buf, sizeof(buf));
+    // Then
+    assert_int_equal(err, IOT_ERROR_BAD_REQ);
+
+    // When: value is not a text string
+    err = iot_serialize_cbor_get_string(sample_cbor, sizeof(sample_cbor), "num", buf, sizeof(buf));
+    // Then
+    assert_int_equal(err, IOT_ERROR_BAD_REQ);
+}
+
+void TC_iot_serialize_cbor_get_int(void **state)
+{
+    iot_error_t err;
+    int64_t val;
+    UNUSED(state);
+
+    // When: integers
+    err = iot_serialize_cbor_get_int(sample_cbor, sizeof(sample_cbor), "num", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(val, 5);
+    // When
+    err = iot_serialize_cbor_get_int(sample_cbor, sizeof(sample_cbor), "neg", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(val, -10);
+
+    // When: floating point numbers
+    err = iot_serialize_cbor_get_int(sample_cbor, sizeof(sample_cbor), "flt", &val);
+    // Then: truncated toward zero
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(val, 2);
+    // When
+    err = iot_serialize_cbor_get_int(sample_cbor, sizeof(sample_cbor), "dbl", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(val, -7);
+
+    // When: integer doesn't fit in int64_t
+    err = iot_serialize_cbor_get_int(sample_cbor, sizeof(sample_cbor), "big", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_BAD_REQ);
+
+    // When: key does not exist
+    err = iot_serialize_cbor_get_int(sample_cbor, sizeof(sample_cbor), "deviceId", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_BAD_REQ);
+
+    // When: value is not a number
+    err = iot_serialize_cbor_get_int(sample_cbor, sizeof(sample_cbor), "name", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_BAD_REQ);
+}
+
+void TC_iot_serialize_cbor_get_malformed(void **state)
+{
+    const uint8_t not_map[] = { 0x82, 0x01, 0x02 };
+    iot_error_t err;
+    int64_t val;
+    char buf[8];
+    UNUSED(state);
+
+    // When: payload ends before the key
+    err = iot_serialize_cbor_get_int(sample_cbor, 20, "flt", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_CBOR_PARSE);
+
+    // When: payload ends in the middle of the value
+    err = iot_serialize_cbor_get_string(sample_cbor, 8, "name", buf, sizeof(buf));
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+    // When
+    err = iot_serialize_cbor_get_int(sample_cbor, 30, "dbl", &val);
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+
+    // When: top level is not a map
+    err = iot_serialize_cbor_get_int(not_map, sizeof(not_map), "num", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_CBOR_PARSE);
+
+    // When: null parameters
+    err = iot_serialize_cbor_get_string(NULL, sizeof(sample_cbor), "name", buf, sizeof(buf));
+    // Then
+    assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+    // When
+    err = iot_serialize_cbor_get_int(sample_cbor, sizeof(sample_cbor), NULL, &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_INVALID_ARGS);
+}
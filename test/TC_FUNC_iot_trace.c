@@ -0,0 +1,169 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <string.h>
+#include <unistd.h>
+#include <iot_error.h>
+#include <iot_trace.h>
+
+#define UNUSED(x) (void**)(x)
+
+static void assert_stats_ordered(iot_trace_stats_t *stats)
+{
+    assert_true(stats->p50_us <= stats->p90_us);
+    assert_true(stats->p90_us <= stats->p99_us);
+    assert_true(stats->p99_us <= stats->max_us);
+    assert_true(stats->avg_us <= stats->max_us);
+}
+
+void TC_iot_trace_stages(void **state)
+{
+    iot_trace_stats_t stats;
+    iot_trace_stats_t total;
+    unsigned int seq;
+    UNUSED(state);
+
+    // Given
+    iot_trace_reset();
+    seq = iot_trace_begin();
+    assert_int_not_equal(seq, 0);
+
+    // When: event goes through stages
+    usleep(2000);
+    iot_trace_mark(seq, IOT_TRACE_EVT_ENCODE);
+    iot_trace_mark(seq, IOT_TRACE_EVT_WAKEUP);
+    iot_trace_end(seq, IOT_TRACE_EVT_TOTAL);
+    // Then: one sample for each marked stage
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_ENCODE, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 1);
+    assert_true(stats.max_us >= 2000);
+    assert_true(stats.p50_us >= 2000);
+    assert_stats_ordered(&stats);
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_WAKEUP, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 1);
+    assert_true(stats.max_us < 2000);
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_TOTAL, &total), IOT_ERROR_NONE);
+    assert_int_equal(total.count, 1);
+    assert_true(total.max_us >= 2000);
+    // Then: stage which isn't marked is empty
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_PUBACK, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 0);
+
+    // When: finished trace is marked again
+    iot_trace_mark(seq, IOT_TRACE_EVT_ENCODE);
+    iot_trace_end(seq, IOT_TRACE_EVT_TOTAL);
+    // Then: ignored
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_ENCODE, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 1);
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_TOTAL, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 1);
+
+    // When: reset
+    iot_trace_reset();
+    // Then
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_TOTAL, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 0);
+    assert_int_equal(stats.max_us, 0);
+}
+
+void TC_iot_trace_percentile(void **state)
+{
+    iot_trace_stats_t stats;
+    unsigned int seq;
+    int i;
+    UNUSED(state);
+
+    // Given
+    iot_trace_reset();
+
+    // When: 9 fast commands and a slow one
+    for (i = 0; i < 10; i++) {
+        seq = iot_trace_begin();
+        if (i == 9)
+            usleep(5000);
+        iot_trace_mark(seq, IOT_TRACE_CMD_READ);
+        iot_trace_end(seq, IOT_TRACE_STAGE_MAX);
+    }
+    // Then: only the tail sees the slow one
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_CMD_READ, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 10);
+    assert_true(stats.max_us >= 5000);
+    assert_true(stats.p50_us < 5000);
+    assert_true(stats.p99_us >= 5000);
+    assert_stats_ordered(&stats);
+    // Then: dropped traces don't record total
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_CMD_TOTAL, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 0);
+
+    // Teardown
+    iot_trace_reset();
+}
+
+void TC_iot_trace_inflight_overwrite(void **state)
+{
+    iot_trace_stats_t stats;
+    unsigned int oldest;
+    unsigned int seq;
+    int i;
+    UNUSED(state);
+
+    // Given
+    iot_trace_reset();
+    oldest = iot_trace_begin();
+
+    // When: a lot of traces are started meanwhile
+    for (i = 0; i < 64; i++) {
+        seq = iot_trace_begin();
+        assert_int_not_equal(seq, oldest);
+    }
+    iot_trace_mark(oldest, IOT_TRACE_EVT_PUBACK);
+    iot_trace_mark(seq, IOT_TRACE_EVT_PUBACK);
+    // Then: the oldest one is dropped
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_PUBACK, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 1);
+
+    // Teardown
+    iot_trace_end(seq, IOT_TRACE_STAGE_MAX);
+    iot_trace_reset();
+}
+
+void TC_iot_trace_invalid_parameters(void **state)
+{
+    iot_trace_stats_t stats;
+    UNUSED(state);
+
+    // Given
+    iot_trace_reset();
+
+    // When: null stats
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_TOTAL, NULL), IOT_ERROR_INVALID_ARGS);
+    // When: unknown stage
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_STAGE_MAX, &stats), IOT_ERROR_INVALID_ARGS);
+
+    // When: untraced message
+    iot_trace_mark(0, IOT_TRACE_EVT_ENCODE);
+    iot_trace_end(0, IOT_TRACE_EVT_TOTAL);
+    // Then: nothing is recorded
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_ENCODE, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 0);
+    assert_int_equal(iot_trace_get_stats(IOT_TRACE_EVT_TOTAL, &stats), IOT_ERROR_NONE);
+    assert_int_equal(stats.count, 0);
+}
@@ -20,6 +20,8 @@
 #include <setjmp.h>
 #include <cmocka.h>
 #include <string.h>
+#include <stdio.h>
+#include <pthread.h>
 #include <iot_util.h>
 #define UNUSED(x) (void**)(x)
 
@@ -150,4 +152,429 @@ void TC_iot_util_convert_str_uuid_null_parameters(void **state)
     err = iot_util_convert_str_uuid(sample_uuid_str, NULL);
     // Then
     assert_int_not_equal(err, IOT_ERROR_NONE);
-}
\ No newline at end of file
+}
+void TC_iot_util_convert_u64_str_success(void **state)
+{
+    iot_error_t err;
+    char str[21];
+    char expected[21];
+    uint64_t samples[] = { 0, 7, 10, 99, 100, 1234567, 1559347200000ULL, 18446744073709551615ULL };
+    UNUSED(state);
+
+    for (int i = 0; i < sizeof(samples)/sizeof(samples[0]); i++) {
+        // Given
+        memset(str, '\0', sizeof(str));
+        snprintf(expected, sizeof(expected), "%llu", (unsigned long long)samples[i]);
+        // When
+        err = iot_util_convert_u64_str(samples[i], str, sizeof(str));
+        // Then
+        assert_int_equal(err, IOT_ERROR_NONE);
+        assert_string_equal(str, expected);
+    }
+}
+
+void TC_iot_util_convert_u64_str_invalid_parameters(void **state)
+{
+    iot_error_t err;
+    char str[13];
+    UNUSED(state);
+
+    // When: str is null
+    err = iot_util_convert_u64_str(1234, NULL, 10);
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+
+    // When: buffer is too small for digits and null terminator
+    err = iot_util_convert_u64_str(1559347200000ULL, str, sizeof(str));
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+}
+
+void TC_iot_util_json_get_string_success(void **state)
+{
+    iot_error_t err;
+    char buf[40];
+    const char *json = "{ \"nested\" : {\"event\":\"wrong\"}, \"list\":[\"}\",1.5e3,null],"
+            " \"event\" : \"expired.jwt\", \"escaped\":\"a\\\"b\\\\c\\n\\u00e9\\/\" }";
+    UNUSED(state);
+
+    // When: key is found at top level only
+    err = iot_util_json_get_string(json, strlen(json), "event", buf, sizeof(buf));
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_string_equal(buf, "expired.jwt");
+
+    // When: value has escape sequences
+    err = iot_util_json_get_string(json, strlen(json), "escaped", buf, sizeof(buf));
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_string_equal(buf, "a\"b\\c\n\xc3\xa9/");
+
+    // When: value and null terminator fit exactly
+    err = iot_util_json_get_string(json, strlen(json), "event", buf, strlen("expired.jwt") + 1);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_string_equal(buf, "expired.jwt");
+}
+
+void TC_iot_util_json_get_string_invalid_parameters(void **state)
+{
+    iot_error_t err;
+    char buf[40];
+    const char *json = "{\"event\":\"expired.jwt\",\"count\":3}";
+    const char *bad_escape = "{\"event\":\"a\\xb\"}";
+    UNUSED(state);
+
+    // When: null parameters
+    err = iot_util_json_get_string(NULL, 10, "event", buf, sizeof(buf));
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+    // When
+    err = iot_util_json_get_string(json, strlen(json), "event", NULL, sizeof(buf));
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+
+    // When: buffer is too small
+    err = iot_util_json_get_string(json, strlen(json), "event", buf, strlen("expired.jwt"));
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+
+    // When: key does not exist
+    err = iot_util_json_get_string(json, strlen(json), "deviceId", buf, sizeof(buf));
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+
+    // When: value is not a string
+    err = iot_util_json_get_string(json, strlen(json), "count", buf, sizeof(buf));
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+
+    // When: value has an escape JSON doesn't define
+    err = iot_util_json_get_string(bad_escape, strlen(bad_escape), "event", buf, sizeof(buf));
+    // Then
+    assert_int_not_equal(err, IOT_ERROR_NONE);
+}
+
+void TC_iot_util_json_get_int_success(void **state)
+{
+    iot_error_t err;
+    int64_t val;
+    const char *json = "{\"a\":0,\"b\":-42,\"c\":1600000000123,\"d\":-3.7e1,\"e\":12.9}";
+    UNUSED(state);
+
+    // When
+    err = iot_util_json_get_int(json, strlen(json), "a", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(val, 0);
+    // When
+    err = iot_util_json_get_int(json, strlen(json), "b", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(val, -42);
+    // When
+    err = iot_util_json_get_int(json, strlen(json), "c", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_true(val == 1600000000123LL);
+    // When: fractional numbers are truncated
+    err = iot_util_json_get_int(json, strlen(json), "d", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(val, -37);
+    // When
+    err = iot_util_json_get_int(json, strlen(json), "e", &val);
+    // Then
+    assert_int_equal(err, IOT_ERROR_NONE);
+    assert_int_equal(val, 12);
+}
+
+void TC_iot_util_json_malformed_corpus(void **state)
+{
+    char buf[40];
+    char mutated[80];
+    int64_t val;
+    unsigned int seed = 0x5eed;
+    const char *valid = "{\"event\":\"rate.limit.reached\",\"count\":[1,{\"x\":true}],\"threshold\":30}";
+    const char *corpus[] = {
+            "", " ", "{", "}", "[1,2", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "{,}",
+            "{\"a\":tru}", "{\"a\":\"\\u12\"}", "{\"a\":\"x", "{\"a\":1 \"b\":2}",
+            "{\"a\":\"\x01\"}", "{\"a\":1}}", "{\"a\":-}",
+            "1-2", "1..2", "1e", "01", "-", "{\"a\":1-2}", "{\"a\":1..2}", "{\"a\":1e}",
+            "{\"a\":01}", "{\"a\":1.}", "{\"a\":.5}", "{\"a\":1e+}", "{\"a\":-01}",
+            "{\"a\":\"\\x\"}", "{\"a\":\"\\'\"}", "{\"a\":\"\\U00e9\"}",
+    };
+    const char *numbers[] = { "0", "-0", "10", "-1.5", "0.25e3", "1E+2", "2e-08", "-0.0E0" };
+    size_t len = strlen(valid);
+    UNUSED(state);
+
+    assert_true(iot_util_json_is_valid(valid, len));
+    for (int i = 0; i < sizeof(numbers)/sizeof(numbers[0]); i++)
+        assert_true(iot_util_json_is_valid(numbers[i], strlen(numbers[i])));
+
+    for (int i = 0; i < sizeof(corpus)/sizeof(corpus[0]); i++) {
+        assert_false(iot_util_json_is_valid(corpus[i], strlen(corpus[i])));
+        assert_int_not_equal(iot_util_json_get_string(corpus[i], strlen(corpus[i]), "a", buf, sizeof(buf)),
+                IOT_ERROR_NONE);
+    }
+
+    // Truncated input must be rejected without reading past the given length
+    for (size_t i = 0; i < len; i++) {
+        memcpy(mutated, valid, i);
+        assert_false(iot_util_json_is_valid(mutated, i));
+        iot_util_json_get_string(mutated, i, "event", buf, sizeof(buf));
+        iot_util_json_get_int(mutated, i, "threshold", &val);
+    }
+
+    // Randomly mutated input must never be read out of range
+    for (int i = 0; i < 2000; i++) {
+        memcpy(mutated, valid, len);
+        for (int k = 0; k < 3; k++) {
+            seed = seed * 1103515245 + 12345;
+            mutated[(seed >> 8) % len] = (char)(seed >> 16);
+        }
+        iot_util_json_is_valid(mutated, len);
+        if (iot_util_json_get_string(mutated, len, "event", buf, sizeof(buf)) == IOT_ERROR_NONE)
+            assert_true(strlen(buf) < sizeof(buf));
+        iot_util_json_get_int(mutated, len, "threshold", &val);
+    }
+}
+
+void TC_iot_util_backoff_bounds(void **state)
+{
+    struct iot_backoff backoff;
+    unsigned int prev;
+    unsigned int delay;
+    unsigned int max_delay = 0;
+    int i;
+    UNUSED(state);
+
+    // Given
+    iot_util_backoff_init(&backoff, 1000, 60000);
+    prev = backoff.base_ms;
+
+    for (i = 0; i < 500; i++) {
+        // When
+        delay = iot_util_backoff_next(&backoff);
+        // Then: between base and three times of previous delay, under cap
+        assert_in_range(delay, 1000, 60000);
+        assert_true(delay <= prev * 3);
+        if (delay > max_delay)
+            max_delay = delay;
+        prev = delay;
+    }
+    assert_int_equal(backoff.attempts, 500);
+    // Then: delay grows until it reaches near cap
+    assert_true(max_delay > 30000);
+
+    // Given: zero base and cap smaller than base
+    iot_util_backoff_init(&backoff, 0, 0);
+    // Then: delay is always 1 ms
+    assert_int_equal(iot_util_backoff_next(&backoff), 1);
+    iot_util_backoff_init(&backoff, 500, 100);
+    assert_int_equal(iot_util_backoff_next(&backoff), 500);
+
+    // When: NULL backoff
+    delay = iot_util_backoff_next(NULL);
+    // Then
+    assert_int_equal(delay, 0);
+}
+
+void TC_iot_util_backoff_reset_and_hint(void **state)
+{
+    struct iot_backoff backoff;
+    unsigned int delay;
+    int i;
+    UNUSED(state);
+
+    // Given: grown delay
+    iot_util_backoff_init(&backoff, 1000, 60000);
+    for (i = 0; i < 20; i++)
+        iot_util_backoff_next(&backoff);
+
+    // When: stable connection
+    iot_util_backoff_reset(&backoff);
+    // Then: start over from base delay
+    assert_int_equal(backoff.attempts, 0);
+    delay = iot_util_backoff_next(&backoff);
+    assert_in_range(delay, 1000, 3000);
+
+    // When: server unavailable
+    iot_util_backoff_hint(&backoff, 30000);
+    delay = iot_util_backoff_next(&backoff);
+    // Then: next delay starts from hint with jitter
+    assert_in_range(delay, 30000, 60000);
+
+    // When: hint bigger than cap
+    iot_util_backoff_reset(&backoff);
+    iot_util_backoff_hint(&backoff, 100000);
+    delay = iot_util_backoff_next(&backoff);
+    // Then: cap wins
+    assert_int_equal(delay, 60000);
+
+    // When: hint is consumed
+    iot_util_backoff_reset(&backoff);
+    iot_util_backoff_hint(&backoff, 30000);
+    iot_util_backoff_next(&backoff);
+    iot_util_backoff_reset(&backoff);
+    delay = iot_util_backoff_next(&backoff);
+    // Then
+    assert_in_range(delay, 1000, 3000);
+}
+
+#define SIM_DEVICES         2000
+#define SIM_OUTAGE_MS       30000
+#define SIM_BROKER_RATE     200     /* accepted connections per second */
+#define SIM_FIXED_RETRY_MS  2000
+#define SIM_DURATION_S      600
+
+/* Every device lost connection at 0 ms and the broker comes back at
+ * SIM_OUTAGE_MS, accepting SIM_BROKER_RATE connections per second.
+ * Returns peak connection trials per second after the broker came back.
+ */
+static int _simulate_fleet_reconnect(bool jitter, int *trials_per_sec, int *all_connected_s)
+{
+    static unsigned int next_ms[SIM_DEVICES];
+    static struct iot_backoff backoff[SIM_DEVICES];
+    bool connected[SIM_DEVICES];
+    int accepted[SIM_DURATION_S];
+    int remained = SIM_DEVICES;
+    int peak = 0;
+    unsigned int now;
+    int sec;
+    int i;
+
+    memset(connected, 0, sizeof(connected));
+    memset(accepted, 0, sizeof(accepted));
+    memset(trials_per_sec, 0, sizeof(int) * SIM_DURATION_S);
+    *all_connected_s = -1;
+
+    for (i = 0; i < SIM_DEVICES; i++) {
+        iot_util_backoff_init(&backoff[i], 1000, 60000);
+        next_ms[i] = jitter ? iot_util_backoff_next(&backoff[i]) : SIM_FIXED_RETRY_MS;
+    }
+
+    for (now = 0; now < SIM_DURATION_S * 1000 && remained; now += 10) {
+        sec = now / 1000;
+        for (i = 0; i < SIM_DEVICES; i++) {
+            if (connected[i] || next_ms[i] > now)
+                continue;
+
+            trials_per_sec[sec]++;
+            if (now >= SIM_OUTAGE_MS && accepted[sec] < SIM_BROKER_RATE) {
+                accepted[sec]++;
+                connected[i] = true;
+                remained--;
+            } else if (jitter) {
+                next_ms[i] = now + iot_util_backoff_next(&backoff[i]);
+            } else {
+                next_ms[i] = now + SIM_FIXED_RETRY_MS;
+            }
+        }
+        if (!remained)
+            *all_connected_s = sec;
+    }
+
+    for (sec = SIM_OUTAGE_MS / 1000; sec < SIM_DURATION_S; sec++) {
+        if (trials_per_sec[sec] > peak)
+            peak = trials_per_sec[sec];
+    }
+
+    return peak;
+}
+
+void TC_iot_util_backoff_fleet_simulation(void **state)
+{
+    static int fixed_curve[SIM_DURATION_S];
+    static int jitter_curve[SIM_DURATION_S];
+    int fixed_peak;
+    int jitter_peak;
+    int fixed_done_s;
+    int jitter_done_s;
+    int sec;
+    UNUSED(state);
+
+    // When
+    fixed_peak = _simulate_fleet_reconnect(false, fixed_curve, &fixed_done_s);
+    jitter_peak = _simulate_fleet_reconnect(true, jitter_curve, &jitter_done_s);
+
+    print_message("connection trials per second after broker recovery (fixed / jitter)\n");
+    for (sec = SIM_OUTAGE_MS / 1000; sec < SIM_OUTAGE_MS / 1000 + 60; sec += 5)
+        print_message("  %3ds : %5d / %5d\n", sec, fixed_curve[sec], jitter_curve[sec]);
+    print_message("peak %d / %d, all connected at %ds / %ds\n",
+            fixed_peak, jitter_peak, fixed_done_s, jitter_done_s);
+
+    // Then: every device comes back
+    assert_true(fixed_done_s > 0);
+    assert_true(jitter_done_s > 0);
+    // Then: fixed schedule hits broker with the whole fleet at once
+    assert_int_equal(fixed_peak, SIM_DEVICES);
+    // Then: jittered backoff flattens connection rate curve
+    assert_true(jitter_peak * 4 < fixed_peak);
+}
+
+void TC_iot_util_atomic_max(void **state)
+{
+    unsigned int hwm = 0;
+    UNUSED(state);
+
+    // When: bigger value
+    iot_util_atomic_max(&hwm, 5);
+    // Then
+    assert_int_equal(hwm, 5);
+
+    // When: smaller value
+    iot_util_atomic_max(&hwm, 3);
+    // Then: kept
+    assert_int_equal(hwm, 5);
+
+    // When: maximum
+    iot_util_atomic_max(&hwm, (unsigned int)-1);
+    // Then
+    assert_int_equal(hwm, (unsigned int)-1);
+}
+
+#define ONCE_MUTEX_THREADS 8
+#define ONCE_MUTEX_LOOPS 10000
+
+static iot_util_once_mutex_t once_mutex_test;
+static unsigned int once_mutex_count;
+
+static void *_once_mutex_thread(void *arg)
+{
+    int i;
+    int *errors = arg;
+
+    for (i = 0; i < ONCE_MUTEX_LOOPS; i++) {
+        if (iot_util_once_mutex_lock(&once_mutex_test) != IOT_ERROR_NONE) {
+            (*errors)++;
+            continue;
+        }
+        once_mutex_count++;
+        iot_util_once_mutex_unlock(&once_mutex_test);
+    }
+
+    return NULL;
+}
+
+void TC_iot_util_once_mutex_concurrent(void **state)
+{
+    pthread_t threads[ONCE_MUTEX_THREADS];
+    int errors[ONCE_MUTEX_THREADS] = {0};
+    int i;
+    UNUSED(state);
+
+    // Given: mutex not created yet
+    once_mutex_count = 0;
+
+    // When: every thread races for the first lock
+    for (i = 0; i < ONCE_MUTEX_THREADS; i++)
+        assert_int_equal(pthread_create(&threads[i], NULL, _once_mutex_thread, &errors[i]), 0);
+    for (i = 0; i < ONCE_MUTEX_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    // Then: every increment was done under the one mutex
+    for (i = 0; i < ONCE_MUTEX_THREADS; i++)
+        assert_int_equal(errors[i], 0);
+    assert_int_equal(once_mutex_count, ONCE_MUTEX_THREADS * ONCE_MUTEX_LOOPS);
+}
@@ -22,8 +22,12 @@
 #include <string.h>
 #include <iot_error.h>
 #include <iot_bsp_wifi.h>
+#include <iot_net.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <netdb.h>
+#include "TC_MOCK_functions.h"
 
 iot_error_t __wrap_iot_bsp_wifi_get_mac(struct iot_mac *wifi_mac)
 {
@@ -162,4 +166,388 @@ void *__wrap_iot_os_strdup(const char *src)
 void set_mock_detect_memory_leak(bool detect)
 {
     _mock_detect_memory_leak = detect;
-}
\ No newline at end of file
+}
+/*
+ * Mock broker for iot_net_init. It answers CONNECT with CONNACK and
+ * SUBSCRIBE with SUBACK, and fails every operation while fault is set.
+ * CONNACK reports session present flag given by set_mock_net_session_present.
+ * CONNECT with protocol level 5 gets MQTT 5.0 CONNACK with receive maximum and
+ * topic alias maximum, and QoS1 PUBLISH gets PUBACK. Aliases are resolved like
+ * a real broker does, so the last published topic can be checked.
+ * Each write or writev call counts as one TLS record.
+ */
+#define MOCK_BROKER_RX_SIZE 64
+#define MOCK_BROKER_TOPIC_SIZE 128
+#define MOCK_BROKER_TOPIC_ALIAS_MAX 4
+static unsigned char _mock_broker_rx[MOCK_BROKER_RX_SIZE];
+static int _mock_broker_rx_head;
+static int _mock_broker_rx_tail;
+static bool _mock_net_fault;
+static unsigned int _mock_net_connect_count;
+static unsigned int _mock_net_subscribe_count;
+static unsigned int _mock_net_subscribe_filter_count;
+static bool _mock_net_session_present;
+static bool _mock_net_suback_refused;
+static unsigned int _mock_net_disconnect_count;
+static bool _mock_net_v5;
+static unsigned char _mock_net_reason_code;
+static int _mock_net_packet_left;
+static int _mock_net_packet_type;
+static bool _mock_net_no_writev;
+static unsigned int _mock_net_write_count;
+static unsigned int _mock_net_publish_bytes;
+static char _mock_net_alias[MOCK_BROKER_TOPIC_ALIAS_MAX + 1][MOCK_BROKER_TOPIC_SIZE];
+static char _mock_net_publish_topic[MOCK_BROKER_TOPIC_SIZE];
+
+static void _mock_broker_reply(const unsigned char *buf, int len)
+{
+    /* move unread replies to the front, so long sessions don't run out of room */
+    memmove(_mock_broker_rx, &_mock_broker_rx[_mock_broker_rx_head], _mock_broker_rx_tail - _mock_broker_rx_head);
+    _mock_broker_rx_tail -= _mock_broker_rx_head;
+    _mock_broker_rx_head = 0;
+
+    if (_mock_broker_rx_tail + len > MOCK_BROKER_RX_SIZE)
+        return;
+    memcpy(&_mock_broker_rx[_mock_broker_rx_tail], buf, len);
+    _mock_broker_rx_tail += len;
+}
+
+static iot_error_t _mock_net_connect(iot_net_interface_t *net)
+{
+    if (_mock_net_fault)
+        return IOT_ERROR_NET_CONNECT;
+
+    _mock_broker_rx_head = _mock_broker_rx_tail = 0;
+    _mock_net_packet_left = 0;
+    memset(_mock_net_alias, 0, sizeof(_mock_net_alias));
+    _mock_net_connect_count++;
+    return IOT_ERROR_NONE;
+}
+
+static void _mock_net_disconnect(iot_net_interface_t *net)
+{
+    _mock_broker_rx_head = _mock_broker_rx_tail = 0;
+}
+
+static int _mock_net_select(iot_net_interface_t *net, unsigned int wait_time_ms)
+{
+    if (_mock_net_fault)
+        return -1;
+
+    return (_mock_broker_rx_tail > _mock_broker_rx_head) ? 1 : 0;
+}
+
+static int _mock_net_read(iot_net_interface_t *net, unsigned char *buf, int len, iot_os_timer timer)
+{
+    int avail = _mock_broker_rx_tail - _mock_broker_rx_head;
+
+    if (_mock_net_fault)
+        return -1;
+
+    if (len > avail)
+        len = avail;
+    memcpy(buf, &_mock_broker_rx[_mock_broker_rx_head], len);
+    _mock_broker_rx_head += len;
+    return len;
+}
+
+static int _mock_broker_varint(unsigned char *buf, int *pos)
+{
+    int value = 0;
+    int multiplier = 1;
+
+    do {
+        value += (buf[*pos] & 0x7f) * multiplier;
+        multiplier *= 128;
+    } while (buf[(*pos)++] & 0x80);
+    return value;
+}
+
+static void _mock_broker_publish(unsigned char *buf, int pos)
+{
+    unsigned char puback[] = { 0x40, 0x02, 0x00, 0x00, 0x00, 0x00 };
+    int qos = (buf[0] >> 1) & 0x03;
+    int topic_len;
+    char *topic;
+    int prop_end;
+    int alias = 0;
+
+    topic_len = (buf[pos] << 8) | buf[pos + 1];
+    topic = (char *)&buf[pos + 2];
+    pos += 2 + topic_len;
+    if (qos) {
+        puback[2] = buf[pos];
+        puback[3] = buf[pos + 1];
+        pos += 2;
+    }
+    if (_mock_net_v5) {
+        prop_end = _mock_broker_varint(buf, &pos);
+        prop_end += pos;
+        while (pos < prop_end) {
+            if (buf[pos] == 0x23)
+                alias = (buf[pos + 1] << 8) | buf[pos + 2];
+            pos += 3;
+        }
+    }
+
+    if (topic_len && topic_len < MOCK_BROKER_TOPIC_SIZE) {
+        memcpy(_mock_net_publish_topic, topic, topic_len);
+        _mock_net_publish_topic[topic_len] = '\0';
+        if (alias && alias <= MOCK_BROKER_TOPIC_ALIAS_MAX)
+            strcpy(_mock_net_alias[alias], _mock_net_publish_topic);
+    } else if (alias && alias <= MOCK_BROKER_TOPIC_ALIAS_MAX) {
+        strcpy(_mock_net_publish_topic, _mock_net_alias[alias]);
+    } else {
+        _mock_net_publish_topic[0] = '\0';
+    }
+
+    if (qos != 1)
+        return;
+    if (_mock_net_v5 && _mock_net_reason_code) {
+        puback[1] = 0x04;
+        puback[4] = _mock_net_reason_code;
+        _mock_net_reason_code = 0;
+    }
+    _mock_broker_reply(puback, puback[1] + 2);
+}
+
+/* Handles a packet at buf, or rest of a packet which was written separately
+ * like publish payload. Returns the number of bytes used.
+ */
+static int _mock_broker_packet(unsigned char *buf, int len)
+{
+    unsigned char connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    unsigned char connack_v5[] = { 0x20, 0x09, 0x00, 0x00, 0x06,
+            0x21, 0x00, 0x10, 0x22, 0x00, MOCK_BROKER_TOPIC_ALIAS_MAX };
+    unsigned char suback[5 + 16] = { 0x90, 0x02 };
+    int pos = 1;
+    int end, used, prop_len;
+    int filters = 0;
+    int props = 0;
+
+    if (_mock_net_packet_left > 0) {
+        used = (len < _mock_net_packet_left) ? len : _mock_net_packet_left;
+        _mock_net_packet_left -= used;
+        if (_mock_net_packet_type == 0x30)
+            _mock_net_publish_bytes += used;
+        return used;
+    }
+
+    end = _mock_broker_varint(buf, &pos);
+    end += pos;
+    used = (end < len) ? end : len;
+    _mock_net_packet_left = end - used;
+    _mock_net_packet_type = buf[0] & 0xf0;
+
+    switch (_mock_net_packet_type) {
+    case 0x10: /* CONNECT */
+        _mock_net_v5 = (buf[pos + 6] == 5);
+        if (_mock_net_v5) {
+            connack_v5[2] = _mock_net_session_present ? 1 : 0;
+            connack_v5[3] = _mock_net_reason_code;
+            _mock_net_reason_code = 0;
+            _mock_broker_reply(connack_v5, sizeof(connack_v5));
+        } else {
+            connack[2] = _mock_net_session_present ? 1 : 0;
+            _mock_broker_reply(connack, sizeof(connack));
+        }
+        break;
+    case 0x30: /* PUBLISH */
+        _mock_net_publish_bytes += used;
+        _mock_broker_publish(buf, pos);
+        break;
+    case 0x80: /* SUBSCRIBE */
+        suback[2] = buf[pos];
+        suback[3] = buf[pos + 1];
+        pos += 2;
+        if (_mock_net_v5) {
+            prop_len = _mock_broker_varint(buf, &pos); /* skip properties */
+            pos += prop_len;
+            suback[4 + props++] = 0x00;
+        }
+        while (pos < end && filters < 16) {
+            pos += 2 + ((buf[pos] << 8) | buf[pos + 1]) + 1;
+            suback[4 + props + filters++] = _mock_net_suback_refused ? 0x80 : 0x01;
+        }
+        suback[1] = 2 + props + filters;
+        _mock_broker_reply(suback, 4 + props + filters);
+        _mock_net_subscribe_count++;
+        _mock_net_subscribe_filter_count += filters;
+        break;
+    case 0xe0: /* DISCONNECT */
+        _mock_net_disconnect_count++;
+        break;
+    default:
+        break;
+    }
+    return used;
+}
+
+static int _mock_net_write(iot_net_interface_t *net, unsigned char *buf, int len, iot_os_timer timer)
+{
+    int used = 0;
+
+    if (_mock_net_fault)
+        return -1;
+
+    _mock_net_write_count++;
+    while (used < len)
+        used += _mock_broker_packet(buf + used, len - used);
+    return len;
+}
+
+/* Like TLS ports, all buffers of one writev make one record */
+static int _mock_net_writev(iot_net_interface_t *net, iot_net_iovec_t *iov, int iovcnt, iot_os_timer timer)
+{
+    int len = 0;
+    int used;
+    int i;
+
+    if (_mock_net_fault)
+        return -1;
+
+    _mock_net_write_count++;
+    for (i = 0; i < iovcnt; i++) {
+        used = 0;
+        while (used < iov[i].len)
+            used += _mock_broker_packet(iov[i].base + used, iov[i].len - used);
+        len += iov[i].len;
+    }
+    return len;
+}
+
+iot_error_t __wrap_iot_net_init(iot_net_interface_t *net)
+{
+    if (net == NULL) {
+        return IOT_ERROR_NET_INVALID_INTERFACE;
+    }
+
+    net->connect = _mock_net_connect;
+    net->disconnect = _mock_net_disconnect;
+    net->select = _mock_net_select;
+    net->read = _mock_net_read;
+    net->write = _mock_net_write;
+    net->writev = _mock_net_no_writev ? NULL : _mock_net_writev;
+    net->show_status = NULL;
+    return IOT_ERROR_NONE;
+}
+
+void set_mock_net_fault(bool fault)
+{
+    _mock_net_fault = fault;
+}
+
+void reset_mock_net_count(void)
+{
+    _mock_net_connect_count = 0;
+    _mock_net_subscribe_count = 0;
+    _mock_net_subscribe_filter_count = 0;
+    _mock_net_publish_bytes = 0;
+    _mock_net_reason_code = 0;
+    _mock_net_write_count = 0;
+    _mock_net_suback_refused = false;
+    _mock_net_disconnect_count = 0;
+}
+
+void set_mock_net_session_present(bool present)
+{
+    _mock_net_session_present = present;
+}
+
+unsigned int get_mock_net_connect_count(void)
+{
+    return _mock_net_connect_count;
+}
+
+unsigned int get_mock_net_subscribe_count(void)
+{
+    return _mock_net_subscribe_count;
+}
+
+unsigned int get_mock_net_subscribe_filter_count(void)
+{
+    return _mock_net_subscribe_filter_count;
+}
+
+void set_mock_net_suback_refused(bool refused)
+{
+    _mock_net_suback_refused = refused;
+}
+
+unsigned int get_mock_net_disconnect_count(void)
+{
+    return _mock_net_disconnect_count;
+}
+
+void set_mock_net_reason_code(unsigned char reason_code)
+{
+    _mock_net_reason_code = reason_code;
+}
+
+unsigned int get_mock_net_publish_bytes(void)
+{
+    return _mock_net_publish_bytes;
+}
+
+const char *get_mock_net_publish_topic(void)
+{
+    return _mock_net_publish_topic;
+}
+
+void set_mock_net_writev(bool use)
+{
+    _mock_net_no_writev = !use;
+}
+
+unsigned int get_mock_net_write_count(void)
+{
+    return _mock_net_write_count;
+}
+
+/*
+ * Resolver stand-in for getaddrinfo. MOCK_RESOLVER_HOST is answered with
+ * the address given by set_mock_resolver_addr after the delay given by
+ * set_mock_resolver_delay, like a DNS server on network would do.
+ * Other names go to the system resolver.
+ */
+int __real_getaddrinfo(const char *node, const char *service,
+        const struct addrinfo *hints, struct addrinfo **res);
+
+static unsigned int _mock_resolver_delay_ms;
+static unsigned int _mock_resolver_count;
+static const char *_mock_resolver_addr = "127.0.0.1";
+
+int __wrap_getaddrinfo(const char *node, const char *service,
+        const struct addrinfo *hints, struct addrinfo **res)
+{
+    struct addrinfo numeric;
+
+    if (node == NULL || strcmp(node, MOCK_RESOLVER_HOST))
+        return __real_getaddrinfo(node, service, hints, res);
+
+    _mock_resolver_count++;
+    usleep(_mock_resolver_delay_ms * 1000);
+    if (_mock_resolver_addr == NULL)
+        return EAI_NONAME;
+
+    memset(&numeric, 0, sizeof(numeric));
+    if (hints)
+        numeric = *hints;
+    numeric.ai_flags |= AI_NUMERICHOST;
+    return __real_getaddrinfo(_mock_resolver_addr, service, &numeric, res);
+}
+
+void set_mock_resolver_delay(unsigned int delay_ms)
+{
+    _mock_resolver_delay_ms = delay_ms;
+}
+
+void set_mock_resolver_addr(const char *addr)
+{
+    _mock_resolver_addr = addr;
+}
+
+unsigned int get_mock_resolver_count(void)
+{
+    return _mock_resolver_count;
+}
@@ -21,9 +21,27 @@
 
 #include <stdbool.h>
 
+#define MOCK_RESOLVER_HOST  "broker.resolver.test"
+
 void set_mock_iot_os_malloc_failure_with_index(unsigned int index);
 void set_mock_iot_os_malloc_failure();
 void do_not_use_mock_iot_os_malloc_failure();
 void set_mock_detect_memory_leak(bool detect);
+void set_mock_net_fault(bool fault);
+void reset_mock_net_count(void);
+unsigned int get_mock_net_connect_count(void);
+void set_mock_net_session_present(bool present);
+unsigned int get_mock_net_subscribe_count(void);
+unsigned int get_mock_net_subscribe_filter_count(void);
+void set_mock_net_suback_refused(bool refused);
+unsigned int get_mock_net_disconnect_count(void);
+void set_mock_net_reason_code(unsigned char reason_code);
+unsigned int get_mock_net_publish_bytes(void);
+const char *get_mock_net_publish_topic(void);
+void set_mock_net_writev(bool use);
+unsigned int get_mock_net_write_count(void);
+void set_mock_resolver_delay(unsigned int delay_ms);
+void set_mock_resolver_addr(const char *addr);
+unsigned int get_mock_resolver_count(void);
 
 #endif //ST_DEVICE_SDK_C_TC_MOCK_FUNCTIONS_H
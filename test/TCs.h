@@ -25,6 +25,57 @@ void TC_iot_util_convert_str_mac_success(void **state);
 void TC_iot_util_convert_str_mac_invalid_parameters(void **state);
 void TC_iot_util_convert_str_uuid_success(void **state);
 void TC_iot_util_convert_str_uuid_null_parameters(void **state);
+void TC_iot_util_convert_u64_str_success(void **state);
+void TC_iot_util_convert_u64_str_invalid_parameters(void **state);
+void TC_iot_util_json_get_string_success(void **state);
+void TC_iot_util_json_get_string_invalid_parameters(void **state);
+void TC_iot_util_json_get_int_success(void **state);
+void TC_iot_util_json_malformed_corpus(void **state);
+void TC_iot_util_backoff_bounds(void **state);
+void TC_iot_util_backoff_reset_and_hint(void **state);
+void TC_iot_util_backoff_fleet_simulation(void **state);
+void TC_iot_util_atomic_max(void **state);
+void TC_iot_util_once_mutex_concurrent(void **state);
+
+// TCs for iot_serialize.c
+void TC_iot_serialize_cbor_get_string(void **state);
+void TC_iot_serialize_cbor_get_int(void **state);
+void TC_iot_serialize_cbor_get_malformed(void **state);
+
+// TCs for iot_mqtt_topic_tree.c
+void TC_MQTTTopicTree_deliver_wildcards(void **state);
+void TC_MQTTTopicTree_add_invalid_filters(void **state);
+void TC_MQTTTopicTree_remove_and_replace(void **state);
+void TC_MQTTSetMessageHandler_unlimited(void **state);
+void TC_MQTTTopicTree_deliver_many_filters(void **state);
+
+// TCs for iot_mqtt_client.c
+int TC_iot_mqtt_client_setup(void **state);
+int TC_iot_mqtt_client_teardown(void **state);
+void TC_st_mqtt_publish_writev(void **state);
+void TC_st_mqtt_publish_many_failure(void **state);
+void TC_st_mqtt_stats(void **state);
+
+// TCs for iot_mqtt_v5.c
+int TC_iot_mqtt_v5_setup(void **state);
+int TC_iot_mqtt_v5_teardown(void **state);
+void TC_MQTTV5_serialize_publish(void **state);
+void TC_MQTTV5_deserialize_ack(void **state);
+void TC_st_mqtt_v5_topic_alias(void **state);
+void TC_st_mqtt_v5_reason_code(void **state);
+
+// TCs for iot_net_resolver.c
+int TC_iot_net_resolver_setup(void **state);
+int TC_iot_net_resolver_teardown(void **state);
+void TC_iot_net_resolve_cache(void **state);
+void TC_iot_net_resolve_concurrent(void **state);
+void TC_iot_net_connect_addr(void **state);
+void TC_iot_net_connect_latency(void **state);
+
+// TCs for iot_net_openssl.c
+void TC_iot_net_openssl_write_mode(void **state);
+void TC_iot_net_openssl_writev_moved_retry(void **state);
+void TC_iot_net_openssl_writev_gathered_retry(void **state);
 
 // TCs for iot_api.c
 int TC_iot_api_memleak_detect_setup(void **state);
@@ -51,6 +102,21 @@ void TC_iot_uuid_from_mac_internal_failure(void **state);
 void TC_iot_random_uuid_from_mac(void **state);
 void TC_iot_random_uuid_from_mac_internal_failure(void **state);
 
+// TCs for iot_mem.c
+void TC_iot_mem_stats(void **state);
+void TC_iot_mem_get_stats_invalid_parameters(void **state);
+void TC_iot_mem_calloc_realloc_strdup(void **state);
+void TC_iot_mem_set_allocator(void **state);
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+void TC_iot_mem_pool(void **state);
+#endif
+
+// TCs for iot_trace.c
+void TC_iot_trace_stages(void **state);
+void TC_iot_trace_percentile(void **state);
+void TC_iot_trace_inflight_overwrite(void **state);
+void TC_iot_trace_invalid_parameters(void **state);
+
 // TCs for iot_capability.c
 int TC_iot_capability_setup(void **state);
 int TC_iot_capability_teardown(void **state);
@@ -73,6 +139,17 @@ void TC_st_conn_set_noti_cb_null_parameters(void **state);
 void TC_st_conn_set_noti_cb_success(void **state);
 void TC_st_cap_cmd_set_cb_invalid_parameters(void **state);
 void TC_st_cap_cmd_set_cb_success(void **state);
+void TC_STATIC_iot_make_evt_data_json_success(void **state);
+void TC_STATIC_iot_make_evt_data_json_invalid_json_object(void **state);
+void TC_STATIC_iot_parse_noti_data_success(void **state);
+void TC_STATIC_iot_parse_noti_data_malformed(void **state);
+
+// TCs for iot_capability.c with STDK_IOT_CORE_SERIALIZE_CBOR
+int TC_iot_capability_cbor_setup(void **state);
+int TC_iot_capability_cbor_teardown(void **state);
+void TC_STATIC_iot_make_evt_data_cbor_success(void **state);
+void TC_STATIC_iot_make_evt_data_cbor_same_as_tinycbor(void **state);
+void TC_STATIC_iot_make_evt_data_cbor_too_large(void **state);
 
 // TCs for iot_crypto.c
 int TC_iot_crypto_pk_setup(void **state);
@@ -82,11 +159,15 @@ void TC_iot_crypto_pk_init_ed25519(void **state);
 void TC_iot_crypto_pk_init_invalid_type(void **state);
 void TC_iot_crypto_pk_free(void **state);
 void TC_iot_crypto_pk_ed25519_success(void **state);
+void TC_iot_crypto_pk_sign_batch_ed25519(void **state);
+void TC_iot_crypto_pk_sign_batch_invalid_parameter(void **state);
 int TC_iot_crypto_cipher_aes_setup(void **state);
 int TC_iot_crypto_cipher_aes_teardown(void **state);
 void TC_iot_crypto_cipher_aes_null_parameter(void **state);
 void TC_iot_crypto_cipher_aes_invalid_parameter(void **state);
 void TC_iot_crypto_cipher_aes_success(void **state);
+void TC_iot_crypto_cipher_session_invalid_parameter(void **state);
+void TC_iot_crypto_cipher_session_success(void **state);
 void TC_iot_crypto_cipher_get_align_size(void **state);
 int TC_iot_crypto_ecdh_setup(void **state);
 int TC_iot_crypto_ecdh_teardown(void **state);
@@ -105,6 +186,14 @@ void TC_iot_crypto_base64_decode_success(void **state);
 void TC_iot_crypto_base64_urlsafe_encode_success(void **state);
 void TC_iot_crypto_base64_urlsafe_decode_success(void **state);
 void TC_iot_crypto_base64_buffer_size(void **state);
+void TC_iot_crypto_base64_vectors(void **state);
+void TC_iot_crypto_base64_all_lengths(void **state);
+void TC_iot_crypto_random_invalid_parameter(void **state);
+void TC_iot_crypto_random_success(void **state);
+void TC_iot_crypto_sha256_invalid_parameter(void **state);
+void TC_iot_crypto_sha256_success(void **state);
+void TC_iot_crypto_sha256_set_funcs(void **state);
+void TC_iot_crypto_hmac_sha256_success(void **state);
 
 // TCs for iot_nv_data.c
 int TC_iot_nv_data_setup(void **state);
@@ -124,6 +213,34 @@ void TC_iot_es_crypto_load_pk_success(void** state);
 void TC_iot_es_crypto_load_pk_invalid_parameters(void **state);
 void TC_iot_es_crypto_init_pk(void **state);
 
+// TCs for iot_easysetup_scan.c
+int TC_iot_easysetup_scan_setup(void **state);
+int TC_iot_easysetup_scan_teardown(void **state);
+void TC_iot_easysetup_scan_merge_bssid(void **state);
+void TC_iot_easysetup_scan_merge_ssid(void **state);
+void TC_iot_easysetup_scan_serialize(void **state);
+void TC_iot_easysetup_scan_cache_success(void **state);
+void TC_iot_easysetup_scan_cache_no_ap(void **state);
+
+// TCs for iot_easysetup_tcp_httpd.c
+int TC_iot_easysetup_httpd_setup(void **state);
+int TC_iot_easysetup_httpd_teardown(void **state);
+void TC_iot_easysetup_httpd_content_length(void **state);
+void TC_iot_easysetup_httpd_transfer_encoding(void **state);
+void TC_iot_easysetup_httpd_header_folding(void **state);
+void TC_iot_easysetup_httpd_header_too_large(void **state);
+void TC_iot_easysetup_httpd_pipelined(void **state);
+void TC_iot_easysetup_httpd_http10(void **state);
+void TC_iot_easysetup_httpd_deinit_blocked(void **state);
+
+// TCs for iot_easysetup_st_mqtt.c
+int TC_iot_easysetup_st_mqtt_setup(void **state);
+int TC_iot_easysetup_st_mqtt_teardown(void **state);
+void TC_iot_es_connect_warm_reconnect(void **state);
+void TC_iot_es_connect_persistent_session(void **state);
+void TC_iot_es_connect_warm_reconnect_failure(void **state);
+void TC_iot_es_connect_warm_subscribe_failure(void **state);
+
 // TCs for iot_easysetup_d2d.c
 int TC_iot_easysetup_d2d_setup(void **state);
 int TC_iot_easysetup_d2d_teardown(void **state);
@@ -137,6 +254,7 @@ void TC_STATIC_es_wifiprovisioninginfo_handler_success(void **state);
 void TC_STATIC_es_crypto_cipher_gen_iv_success(void **state);
 void TC_STATIC_es_wifiscaninfo_handler_invalid_parameters(void **state);
 void TC_STATIC_es_wifiscaninfo_handler_success(void **state);
+void TC_STATIC_es_wifiscaninfo_handler_scan_cache(void **state);
 void TC_STATIC_es_confirminfo_handler_null_parameters(void **state);
 void TC_STATIC_es_confirminfo_handler_out_ranged_otm_feature(void **state);
 void TC_STATIC_es_confirminfo_handler_justworks_and_pin(void **state);
@@ -65,6 +65,10 @@ int TEST_FUNC_iot_capability(void)
             cmocka_unit_test_setup_teardown(TC_st_conn_set_noti_cb_success, TC_iot_capability_setup, TC_iot_capability_teardown),
             cmocka_unit_test_setup_teardown(TC_st_cap_cmd_set_cb_invalid_parameters, TC_iot_capability_setup, TC_iot_capability_teardown),
             cmocka_unit_test_setup_teardown(TC_st_cap_cmd_set_cb_success, TC_iot_capability_setup, TC_iot_capability_teardown),
+            cmocka_unit_test_setup_teardown(TC_STATIC_iot_make_evt_data_json_success, TC_iot_capability_setup, TC_iot_capability_teardown),
+            cmocka_unit_test_setup_teardown(TC_STATIC_iot_make_evt_data_json_invalid_json_object, TC_iot_capability_setup, TC_iot_capability_teardown),
+            cmocka_unit_test_setup_teardown(TC_STATIC_iot_parse_noti_data_success, TC_iot_capability_setup, TC_iot_capability_teardown),
+            cmocka_unit_test_setup_teardown(TC_STATIC_iot_parse_noti_data_malformed, TC_iot_capability_setup, TC_iot_capability_teardown),
     };
     return cmocka_run_group_tests_name("iot_capability.c", tests, NULL, NULL);
 }
@@ -77,9 +81,13 @@ int TEST_FUNC_iot_crypto(void)
             cmocka_unit_test(TC_iot_crypto_pk_init_invalid_type),
             cmocka_unit_test(TC_iot_crypto_pk_free),
             cmocka_unit_test_setup_teardown(TC_iot_crypto_pk_ed25519_success, TC_iot_crypto_pk_setup, TC_iot_crypto_pk_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_crypto_pk_sign_batch_ed25519, TC_iot_crypto_pk_setup, TC_iot_crypto_pk_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_crypto_pk_sign_batch_invalid_parameter, TC_iot_crypto_pk_setup, TC_iot_crypto_pk_teardown),
             cmocka_unit_test_setup_teardown(TC_iot_crypto_cipher_aes_null_parameter, TC_iot_crypto_cipher_aes_setup, TC_iot_crypto_cipher_aes_teardown),
             cmocka_unit_test_setup_teardown(TC_iot_crypto_cipher_aes_invalid_parameter, TC_iot_crypto_cipher_aes_setup, TC_iot_crypto_cipher_aes_teardown),
             cmocka_unit_test_setup_teardown(TC_iot_crypto_cipher_aes_success, TC_iot_crypto_cipher_aes_setup, TC_iot_crypto_cipher_aes_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_crypto_cipher_session_invalid_parameter, TC_iot_crypto_cipher_aes_setup, TC_iot_crypto_cipher_aes_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_crypto_cipher_session_success, TC_iot_crypto_cipher_aes_setup, TC_iot_crypto_cipher_aes_teardown),
             cmocka_unit_test(TC_iot_crypto_cipher_get_align_size),
             cmocka_unit_test_setup_teardown(TC_iot_crypto_ecdh_invalid_parameter, TC_iot_crypto_ecdh_setup, TC_iot_crypto_ecdh_teardown),
             cmocka_unit_test_setup_teardown(TC_iot_crypto_ecdh_success, TC_iot_crypto_ecdh_setup, TC_iot_crypto_ecdh_teardown),
@@ -94,6 +102,14 @@ int TEST_FUNC_iot_crypto(void)
             cmocka_unit_test(TC_iot_crypto_base64_urlsafe_encode_success),
             cmocka_unit_test(TC_iot_crypto_base64_urlsafe_decode_success),
             cmocka_unit_test(TC_iot_crypto_base64_buffer_size),
+            cmocka_unit_test(TC_iot_crypto_base64_vectors),
+            cmocka_unit_test(TC_iot_crypto_base64_all_lengths),
+            cmocka_unit_test(TC_iot_crypto_random_invalid_parameter),
+            cmocka_unit_test(TC_iot_crypto_random_success),
+            cmocka_unit_test(TC_iot_crypto_sha256_invalid_parameter),
+            cmocka_unit_test(TC_iot_crypto_sha256_success),
+            cmocka_unit_test(TC_iot_crypto_sha256_set_funcs),
+            cmocka_unit_test(TC_iot_crypto_hmac_sha256_success),
     };
     return cmocka_run_group_tests_name("iot_crypto.c", tests, NULL, NULL);
 }
@@ -121,10 +137,31 @@ int TEST_FUNC_iot_util(void)
             cmocka_unit_test(TC_iot_util_convert_str_mac_invalid_parameters),
             cmocka_unit_test(TC_iot_util_convert_str_uuid_success),
             cmocka_unit_test(TC_iot_util_convert_str_uuid_null_parameters),
+            cmocka_unit_test(TC_iot_util_convert_u64_str_success),
+            cmocka_unit_test(TC_iot_util_convert_u64_str_invalid_parameters),
+            cmocka_unit_test(TC_iot_util_json_get_string_success),
+            cmocka_unit_test(TC_iot_util_json_get_string_invalid_parameters),
+            cmocka_unit_test(TC_iot_util_json_get_int_success),
+            cmocka_unit_test(TC_iot_util_json_malformed_corpus),
+            cmocka_unit_test(TC_iot_util_backoff_bounds),
+            cmocka_unit_test(TC_iot_util_backoff_reset_and_hint),
+            cmocka_unit_test(TC_iot_util_backoff_fleet_simulation),
+            cmocka_unit_test(TC_iot_util_atomic_max),
+            cmocka_unit_test(TC_iot_util_once_mutex_concurrent),
     };
     return cmocka_run_group_tests_name("iot_util.c", tests, NULL, NULL);
 }
 
+int TEST_FUNC_iot_serialize(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(TC_iot_serialize_cbor_get_string),
+            cmocka_unit_test(TC_iot_serialize_cbor_get_int),
+            cmocka_unit_test(TC_iot_serialize_cbor_get_malformed),
+    };
+    return cmocka_run_group_tests_name("iot_serialize.c", tests, NULL, NULL);
+}
+
 int TEST_FUNC_iot_uuid(void)
 {
     const struct CMUnitTest tests[] = {
@@ -136,6 +173,31 @@ int TEST_FUNC_iot_uuid(void)
     return cmocka_run_group_tests_name("iot_uuid.c", tests, NULL, NULL);
 }
 
+int TEST_FUNC_iot_mem(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(TC_iot_mem_stats),
+            cmocka_unit_test(TC_iot_mem_get_stats_invalid_parameters),
+            cmocka_unit_test(TC_iot_mem_calloc_realloc_strdup),
+            cmocka_unit_test(TC_iot_mem_set_allocator),
+#if defined(CONFIG_STDK_IOT_CORE_MEM_POOL)
+            cmocka_unit_test(TC_iot_mem_pool),
+#endif
+    };
+    return cmocka_run_group_tests_name("iot_mem.c", tests, NULL, NULL);
+}
+
+int TEST_FUNC_iot_trace(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(TC_iot_trace_stages),
+            cmocka_unit_test(TC_iot_trace_percentile),
+            cmocka_unit_test(TC_iot_trace_inflight_overwrite),
+            cmocka_unit_test(TC_iot_trace_invalid_parameters),
+    };
+    return cmocka_run_group_tests_name("iot_trace.c", tests, NULL, NULL);
+}
+
 int TEST_FUNC_iot_easysetup_d2d(void)
 {
     const struct CMUnitTest tests[] = {
@@ -149,6 +211,7 @@ int TEST_FUNC_iot_easysetup_d2d(void)
             cmocka_unit_test_setup_teardown(TC_STATIC_es_wifiprovisioninginfo_handler_success, TC_iot_easysetup_d2d_setup, TC_iot_easysetup_d2d_teardown),
             cmocka_unit_test_setup_teardown(TC_STATIC_es_wifiscaninfo_handler_invalid_parameters, TC_iot_easysetup_d2d_setup, TC_iot_easysetup_d2d_teardown),
             cmocka_unit_test_setup_teardown(TC_STATIC_es_wifiscaninfo_handler_success, TC_iot_easysetup_d2d_setup, TC_iot_easysetup_d2d_teardown),
+            cmocka_unit_test_setup_teardown(TC_STATIC_es_wifiscaninfo_handler_scan_cache, TC_iot_easysetup_d2d_setup, TC_iot_easysetup_d2d_teardown),
             cmocka_unit_test_setup_teardown(TC_STATIC_es_confirminfo_handler_null_parameters, TC_iot_easysetup_d2d_setup, TC_iot_easysetup_d2d_teardown),
             cmocka_unit_test_setup_teardown(TC_STATIC_es_confirminfo_handler_out_ranged_otm_feature, TC_iot_easysetup_d2d_setup, TC_iot_easysetup_d2d_teardown),
             cmocka_unit_test_setup_teardown(TC_STATIC_es_confirminfo_handler_justworks_and_pin, TC_iot_easysetup_d2d_setup, TC_iot_easysetup_d2d_teardown),
@@ -172,6 +235,76 @@ int TEST_FUNC_iot_easysetup_crypto(void)
 
 }
 
+int TEST_FUNC_iot_easysetup_scan(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(TC_iot_easysetup_scan_merge_bssid),
+            cmocka_unit_test(TC_iot_easysetup_scan_merge_ssid),
+            cmocka_unit_test(TC_iot_easysetup_scan_serialize),
+            cmocka_unit_test_setup_teardown(TC_iot_easysetup_scan_cache_success, TC_iot_easysetup_scan_setup, TC_iot_easysetup_scan_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_easysetup_scan_cache_no_ap, TC_iot_easysetup_scan_setup, TC_iot_easysetup_scan_teardown),
+    };
+    return cmocka_run_group_tests_name("iot_easysetup_scan.c", tests, NULL, NULL);
+}
+
+int TEST_FUNC_iot_easysetup_httpd(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test_setup_teardown(TC_iot_easysetup_httpd_content_length, TC_iot_easysetup_httpd_setup, TC_iot_easysetup_httpd_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_easysetup_httpd_transfer_encoding, TC_iot_easysetup_httpd_setup, TC_iot_easysetup_httpd_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_easysetup_httpd_header_folding, TC_iot_easysetup_httpd_setup, TC_iot_easysetup_httpd_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_easysetup_httpd_header_too_large, TC_iot_easysetup_httpd_setup, TC_iot_easysetup_httpd_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_easysetup_httpd_pipelined, TC_iot_easysetup_httpd_setup, TC_iot_easysetup_httpd_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_easysetup_httpd_http10, TC_iot_easysetup_httpd_setup, TC_iot_easysetup_httpd_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_easysetup_httpd_deinit_blocked, TC_iot_easysetup_httpd_setup, TC_iot_easysetup_httpd_teardown),
+    };
+    return cmocka_run_group_tests_name("iot_easysetup_tcp_httpd.c", tests, NULL, NULL);
+}
+
+int TEST_FUNC_iot_easysetup_st_mqtt(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test_setup_teardown(TC_iot_es_connect_warm_reconnect, TC_iot_easysetup_st_mqtt_setup, TC_iot_easysetup_st_mqtt_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_es_connect_persistent_session, TC_iot_easysetup_st_mqtt_setup, TC_iot_easysetup_st_mqtt_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_es_connect_warm_reconnect_failure, TC_iot_easysetup_st_mqtt_setup, TC_iot_easysetup_st_mqtt_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_es_connect_warm_subscribe_failure, TC_iot_easysetup_st_mqtt_setup, TC_iot_easysetup_st_mqtt_teardown),
+    };
+    return cmocka_run_group_tests_name("iot_easysetup_st_mqtt.c", tests, NULL, NULL);
+}
+
+int TEST_FUNC_iot_mqtt_topic_tree(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(TC_MQTTTopicTree_deliver_wildcards),
+            cmocka_unit_test(TC_MQTTTopicTree_add_invalid_filters),
+            cmocka_unit_test(TC_MQTTTopicTree_remove_and_replace),
+            cmocka_unit_test(TC_MQTTSetMessageHandler_unlimited),
+            cmocka_unit_test(TC_MQTTTopicTree_deliver_many_filters),
+    };
+    return cmocka_run_group_tests_name("iot_mqtt_topic_tree.c", tests, NULL, NULL);
+}
+
+int TEST_FUNC_iot_mqtt_client(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test_setup_teardown(TC_st_mqtt_publish_writev, TC_iot_mqtt_client_setup, TC_iot_mqtt_client_teardown),
+            cmocka_unit_test_setup_teardown(TC_st_mqtt_publish_many_failure, TC_iot_mqtt_client_setup, TC_iot_mqtt_client_teardown),
+            cmocka_unit_test_setup_teardown(TC_st_mqtt_stats, TC_iot_mqtt_client_setup, TC_iot_mqtt_client_teardown),
+    };
+    return cmocka_run_group_tests_name("iot_mqtt_client.c", tests, NULL, NULL);
+}
+
+int TEST_FUNC_iot_mqtt_v5(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(TC_MQTTV5_serialize_publish),
+            cmocka_unit_test(TC_MQTTV5_deserialize_ack),
+            cmocka_unit_test_setup_teardown(TC_st_mqtt_v5_topic_alias, TC_iot_mqtt_v5_setup, TC_iot_mqtt_v5_teardown),
+            cmocka_unit_test_setup_teardown(TC_st_mqtt_v5_reason_code, TC_iot_mqtt_v5_setup, TC_iot_mqtt_v5_teardown),
+    };
+    return cmocka_run_group_tests_name("iot_mqtt_v5.c", tests, NULL, NULL);
+}
+
 int TEST_FUNC_iot_main()
 {
     const struct CMUnitTest tests[] = {
@@ -183,6 +316,17 @@ int TEST_FUNC_iot_main()
     return cmocka_run_group_tests_name("iot_main.c", tests, NULL, NULL);
 }
 
+int TEST_FUNC_iot_net_resolver(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test_setup_teardown(TC_iot_net_resolve_cache, TC_iot_net_resolver_setup, TC_iot_net_resolver_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_net_resolve_concurrent, TC_iot_net_resolver_setup, TC_iot_net_resolver_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_net_connect_addr, TC_iot_net_resolver_setup, TC_iot_net_resolver_teardown),
+            cmocka_unit_test_setup_teardown(TC_iot_net_connect_latency, TC_iot_net_resolver_setup, TC_iot_net_resolver_teardown),
+    };
+    return cmocka_run_group_tests_name("iot_net_resolver.c", tests, NULL, NULL);
+}
+
 int main(void) {
     int err = 0;
 
@@ -191,10 +335,20 @@ int main(void) {
     err += TEST_FUNC_iot_crypto();
     err += TEST_FUNC_iot_nv_data();
     err += TEST_FUNC_iot_util();
+    err += TEST_FUNC_iot_serialize();
     err += TEST_FUNC_iot_uuid();
+    err += TEST_FUNC_iot_mem();
+    err += TEST_FUNC_iot_trace();
     err += TEST_FUNC_iot_easysetup_d2d();
     err += TEST_FUNC_iot_easysetup_crypto();
+    err += TEST_FUNC_iot_easysetup_scan();
+    err += TEST_FUNC_iot_easysetup_httpd();
+    err += TEST_FUNC_iot_easysetup_st_mqtt();
     err += TEST_FUNC_iot_main();
+    err += TEST_FUNC_iot_mqtt_topic_tree();
+    err += TEST_FUNC_iot_mqtt_v5();
+    err += TEST_FUNC_iot_mqtt_client();
+    err += TEST_FUNC_iot_net_resolver();
 
     return err;
 }
@@ -0,0 +1,40 @@
+/* ***************************************************************************
+ *
+ * Copyright (c) 2020 Samsung Electronics All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific
+ * language governing permissions and limitations under the License.
+ *
+ ****************************************************************************/
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include "TCs.h"
+
+int TEST_FUNC_iot_net_openssl(void)
+{
+    const struct CMUnitTest tests[] = {
+            cmocka_unit_test(TC_iot_net_openssl_write_mode),
+            cmocka_unit_test(TC_iot_net_openssl_writev_moved_retry),
+            cmocka_unit_test(TC_iot_net_openssl_writev_gathered_retry),
+    };
+    return cmocka_run_group_tests_name("iot_net_openssl.c", tests, NULL, NULL);
+}
+
+int main(void) {
+    int err = 0;
+
+    err += TEST_FUNC_iot_net_openssl();
+
+    return err;
+}